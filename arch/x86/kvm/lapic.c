@@ -312,6 +312,19 @@ static inline void kvm_apic_set_xapic_id(struct kvm_lapic *apic, u8 id)
 	atomic_set_release(&apic->vcpu->kvm->arch.apic_map_dirty, DIRTY);
 }
 
+/*
+ * Hardware IPI virtualization looks up the destination's posted interrupt
+ * descriptor by APIC ID, which KVM sets up assuming APIC ID == vcpu_id.
+ */
+static void kvm_lapic_xapic_id_updated(struct kvm_lapic *apic)
+{
+	if (kvm_xapic_id(apic) == apic->vcpu->vcpu_id)
+		return;
+
+	kvm_request_apicv_update(apic->vcpu->kvm, false,
+				 APICV_INHIBIT_REASON_APIC_ID_MODIFIED);
+}
+
 static inline void kvm_apic_set_ldr(struct kvm_lapic *apic, u32 id)
 {
 	kvm_lapic_set_reg(apic, APIC_LDR, id);
@@ -1292,6 +1305,7 @@ void kvm_apic_send_ipi(struct kvm_lapic *apic, u32 icr_low, u32 icr_high)
 		irq.dest_id = GET_APIC_DEST_FIELD(icr_high);
 
 	trace_kvm_apic_ipi(icr_low, irq.dest_id);
+	++apic->vcpu->stat.ipi_exits;
 
 	kvm_irq_delivery_to_apic(apic->vcpu->kvm, apic, &irq, NULL);
 }
@@ -2008,10 +2022,12 @@ int kvm_lapic_reg_write(struct kvm_lapic *apic, u32 reg, u32 val)
 
 	switch (reg) {
 	case APIC_ID:		/* Local APIC ID */
-		if (!apic_x2apic_mode(apic))
+		if (!apic_x2apic_mode(apic)) {
 			kvm_apic_set_xapic_id(apic, val >> 24);
-		else
+			kvm_lapic_xapic_id_updated(apic);
+		} else {
 			ret = 1;
+		}
 		break;
 
 	case APIC_TASKPRI:
@@ -2195,6 +2211,18 @@ void kvm_apic_write_nodecode(struct kvm_vcpu *vcpu, u32 offset)
 	/* hw has done the conditional check and inst decode */
 	offset &= 0xff0;
 
+	/*
+	 * With IPI virtualization x2APIC ICR writes are not intercepted, and
+	 * the ones the CPU doesn't virtualize trap here with the full 64-bit
+	 * value at offset 0x300 of the virtual APIC page.
+	 */
+	if (apic_x2apic_mode(vcpu->arch.apic) && offset == APIC_ICR) {
+		kvm_lapic_reg_write(vcpu->arch.apic, APIC_ICR2,
+				    kvm_lapic_get_reg(vcpu->arch.apic,
+						      APIC_ICR + 4));
+		kvm_lapic_set_reg(vcpu->arch.apic, APIC_ICR + 4, 0);
+	}
+
 	kvm_lapic_reg_read(vcpu->arch.apic, offset, 4, &val);
 
 	/* TODO: optimize to just emulate side effect w/o one more write */
@@ -2626,6 +2654,8 @@ int kvm_apic_set_state(struct kvm_vcpu *vcpu, struct kvm_lapic_state *s)
 	memcpy(vcpu->arch.apic->regs, s->regs, sizeof(*s));
 
 	atomic_set_release(&apic->vcpu->kvm->arch.apic_map_dirty, DIRTY);
+	if (!apic_x2apic_mode(apic))
+		kvm_lapic_xapic_id_updated(apic);
 	kvm_recalculate_apic_map(vcpu->kvm);
 	kvm_apic_set_version(vcpu);
 
@@ -856,7 +856,12 @@ static void flush_tlb_func(void *info)
 
 static bool tlb_is_not_lazy(int cpu, void *data)
 {
-	return !per_cpu(cpu_tlbstate_shared.is_lazy, cpu);
+	bool not_lazy = !per_cpu(cpu_tlbstate_shared.is_lazy, cpu);
+
+	if (cpu != smp_processor_id())
+		count_vm_tlb_event(not_lazy ? NR_TLB_REMOTE_FLUSH_IPI :
+					      NR_TLB_REMOTE_FLUSH_LAZY_SKIP);
+	return not_lazy;
 }
 
 DEFINE_PER_CPU_SHARED_ALIGNED(struct tlb_state_shared, cpu_tlbstate_shared);
@@ -886,10 +891,17 @@ STATIC_NOPV void native_flush_tlb_multi(const struct cpumask *cpumask,
 	 * IPI everywhere, to prevent CPUs in lazy TLB mode from tripping
 	 * up on the new contents of what used to be page tables, while
 	 * doing a speculative memory access.
+	 *
+	 * nr_tlb_remote_flush_ipi over nr_tlb_remote_flush gives the average
+	 * fan-out of a shootdown.
 	 */
-	if (info->freed_tables)
+	if (info->freed_tables) {
+		if (IS_ENABLED(CONFIG_DEBUG_TLBFLUSH))
+			count_vm_tlb_events(NR_TLB_REMOTE_FLUSH_IPI,
+					    cpumask_weight(cpumask) -
+					    cpumask_test_cpu(smp_processor_id(), cpumask));
 		on_each_cpu_mask(cpumask, flush_tlb_func, (void *)info, true);
-	else
+	} else
 		on_each_cpu_cond_mask(tlb_is_not_lazy, flush_tlb_func,
 				(void *)info, 1, cpumask);
 }
@@ -124,11 +124,13 @@
 #include <linux/sbitmap.h>
 #include <linux/delay.h>
 #include <linux/backing-dev.h>
+#include <linux/sched/clock.h>
 
 #include <trace/events/block.h>
 
 #include "blk.h"
 #include "blk-mq.h"
+#include "blk-mq-debugfs.h"
 #include "blk-mq-tag.h"
 #include "blk-mq-sched.h"
 #include "bfq-iosched.h"
@@ -4948,6 +4950,67 @@ static bool bfq_has_work(struct blk_mq_hw_ctx *hctx)
 		bfq_tot_busy_queues(bfqd) > 0;
 }
 
+#ifdef CONFIG_BLK_DEBUG_FS
+static inline u64 bfq_lock_stats_start(void)
+{
+	return local_clock();
+}
+
+static inline void bfq_lock_stats_end(struct bfq_lock_stats *stats, u64 start)
+{
+	u64 delta = local_clock() - start;
+
+	stats->count++;
+	stats->total_ns += delta;
+	if (delta > stats->max_ns)
+		stats->max_ns = delta;
+}
+
+static inline void bfq_inc_fast_dispatches(struct bfq_data *bfqd)
+{
+	bfqd->fast_dispatches++;
+}
+#else
+static inline u64 bfq_lock_stats_start(void)
+{
+	return 0;
+}
+
+static inline void bfq_lock_stats_end(struct bfq_lock_stats *stats,
+				      u64 start) {}
+static inline void bfq_inc_fast_dispatches(struct bfq_data *bfqd) {}
+#endif /* CONFIG_BLK_DEBUG_FS */
+
+/*
+ * Return the in-service queue if it is the only busy queue and it can
+ * just go on being served, i.e., if bfq_select_queue() would keep it
+ * without expiring it, idling or injecting. In that case none of the
+ * queue-selection machinery needs to run. Return NULL otherwise.
+ */
+static struct bfq_queue *bfq_fast_path_queue(struct bfq_data *bfqd)
+{
+	struct bfq_queue *bfqq = bfqd->in_service_queue;
+
+	if (!bfqq || bfq_tot_busy_queues(bfqd) != 1 || !bfqq->next_rq)
+		return NULL;
+
+	/*
+	 * Weight-raised queues are left to the full path, and so are
+	 * queues whose idle timer is pending, as bfq_select_queue()
+	 * must cancel it.
+	 */
+	if (bfqq->wr_coeff > 1 || bfq_bfqq_wait_request(bfqq))
+		return NULL;
+
+	if (bfq_bfqq_budget_timeout(bfqq) ||
+	    bfq_serv_to_charge(bfqq->next_rq, bfqq) >
+	    bfq_bfqq_budget_left(bfqq))
+		return NULL;
+
+	bfq_inc_fast_dispatches(bfqd);
+	return bfqq;
+}
+
 static struct request *__bfq_dispatch_request(struct blk_mq_hw_ctx *hctx)
 {
 	struct bfq_data *bfqd = hctx->queue->elevator->elevator_data;
@@ -5020,7 +5083,9 @@ static struct request *__bfq_dispatch_request(struct blk_mq_hw_ctx *hctx)
 	if (bfqd->strict_guarantees && bfqd->rq_in_driver > 0)
 		goto exit;
 
-	bfqq = bfq_select_queue(bfqd);
+	bfqq = bfq_fast_path_queue(bfqd);
+	if (!bfqq)
+		bfqq = bfq_select_queue(bfqd);
 	if (!bfqq)
 		goto exit;
 
@@ -5094,8 +5159,10 @@ static struct request *bfq_dispatch_request(struct blk_mq_hw_ctx *hctx)
 	struct request *rq;
 	struct bfq_queue *in_serv_queue;
 	bool waiting_rq, idle_timer_disabled = false;
+	u64 lock_start;
 
 	spin_lock_irq(&bfqd->lock);
+	lock_start = bfq_lock_stats_start();
 
 	in_serv_queue = bfqd->in_service_queue;
 	waiting_rq = in_serv_queue && bfq_bfqq_wait_request(in_serv_queue);
@@ -5106,6 +5173,7 @@ static struct request *bfq_dispatch_request(struct blk_mq_hw_ctx *hctx)
 			waiting_rq && !bfq_bfqq_wait_request(in_serv_queue);
 	}
 
+	bfq_lock_stats_end(&bfqd->dispatch_lock_stats, lock_start);
 	spin_unlock_irq(&bfqd->lock);
 	bfq_update_dispatch_stats(hctx->queue, rq,
 			idle_timer_disabled ? in_serv_queue : NULL,
@@ -5999,6 +6067,7 @@ static void bfq_insert_request(struct blk_mq_hw_ctx *hctx, struct request *rq,
 	struct bfq_queue *bfqq;
 	bool idle_timer_disabled = false;
 	unsigned int cmd_flags;
+	u64 lock_start;
 	LIST_HEAD(free);
 
 #ifdef CONFIG_BFQ_GROUP_IOSCHED
@@ -6006,8 +6075,10 @@ static void bfq_insert_request(struct blk_mq_hw_ctx *hctx, struct request *rq,
 		bfqg_stats_update_legacy_io(q, rq);
 #endif
 	spin_lock_irq(&bfqd->lock);
+	lock_start = bfq_lock_stats_start();
 	bfqq = bfq_init_rq(rq);
 	if (blk_mq_sched_try_insert_merge(q, rq, &free)) {
+		bfq_lock_stats_end(&bfqd->insert_lock_stats, lock_start);
 		spin_unlock_irq(&bfqd->lock);
 		blk_mq_free_requests(&free);
 		return;
@@ -6042,6 +6113,7 @@ static void bfq_insert_request(struct blk_mq_hw_ctx *hctx, struct request *rq,
 	 * merge).
 	 */
 	cmd_flags = rq->cmd_flags;
+	bfq_lock_stats_end(&bfqd->insert_lock_stats, lock_start);
 	spin_unlock_irq(&bfqd->lock);
 
 	bfq_update_insert_stats(q, bfqq, idle_timer_disabled,
@@ -7286,6 +7358,58 @@ static struct elv_fs_entry bfq_attrs[] = {
 	__ATTR_NULL
 };
 
+#ifdef CONFIG_BLK_DEBUG_FS
+static void bfq_lock_stats_show(struct seq_file *m, struct bfq_data *bfqd,
+				struct bfq_lock_stats *stats)
+{
+	u64 count, total_ns, max_ns;
+
+	spin_lock_irq(&bfqd->lock);
+	count = stats->count;
+	total_ns = stats->total_ns;
+	max_ns = stats->max_ns;
+	spin_unlock_irq(&bfqd->lock);
+
+	seq_printf(m, "count=%llu total_ns=%llu max_ns=%llu avg_ns=%llu\n",
+		   count, total_ns, max_ns,
+		   count ? div64_u64(total_ns, count) : 0);
+}
+
+static int bfq_dispatch_lock_show(void *data, struct seq_file *m)
+{
+	struct request_queue *q = data;
+	struct bfq_data *bfqd = q->elevator->elevator_data;
+
+	bfq_lock_stats_show(m, bfqd, &bfqd->dispatch_lock_stats);
+	return 0;
+}
+
+static int bfq_insert_lock_show(void *data, struct seq_file *m)
+{
+	struct request_queue *q = data;
+	struct bfq_data *bfqd = q->elevator->elevator_data;
+
+	bfq_lock_stats_show(m, bfqd, &bfqd->insert_lock_stats);
+	return 0;
+}
+
+static int bfq_fast_dispatches_show(void *data, struct seq_file *m)
+{
+	struct request_queue *q = data;
+	struct bfq_data *bfqd = q->elevator->elevator_data;
+
+	seq_printf(m, "%llu\n", READ_ONCE(bfqd->fast_dispatches));
+	return 0;
+}
+
+static const struct blk_mq_debugfs_attr bfq_queue_debugfs_attrs[] = {
+	{"dispatch_lock", 0400, bfq_dispatch_lock_show},
+	{"insert_lock", 0400, bfq_insert_lock_show},
+	{"fast_dispatches", 0400, bfq_fast_dispatches_show},
+	{},
+};
+#endif
+
 static struct elevator_type iosched_bfq_mq = {
 	.ops = {
 		.limit_depth		= bfq_limit_depth,
@@ -7312,6 +7436,9 @@ static struct elevator_type iosched_bfq_mq = {
 	.icq_size =		sizeof(struct bfq_io_cq),
 	.icq_align =		__alignof__(struct bfq_io_cq),
 	.elevator_attrs =	bfq_attrs,
+#ifdef CONFIG_BLK_DEBUG_FS
+	.queue_debugfs_attrs =	bfq_queue_debugfs_attrs,
+#endif
 	.elevator_name =	"bfq",
 	.elevator_owner =	THIS_MODULE,
 };
@@ -469,6 +469,13 @@ struct bfq_io_cq {
 	unsigned int requests;	/* Number of requests this process has in flight */
 };
 
+/* hold-time statistics for bfqd->lock, reported through debugfs */
+struct bfq_lock_stats {
+	u64 count;
+	u64 total_ns;
+	u64 max_ns;
+};
+
 /**
  * struct bfq_data - per-device data structure.
  *
@@ -752,6 +759,14 @@ struct bfq_data {
 
 	spinlock_t lock;
 
+#ifdef CONFIG_BLK_DEBUG_FS
+	/* hold times of @lock in the dispatch and insert hooks */
+	struct bfq_lock_stats dispatch_lock_stats;
+	struct bfq_lock_stats insert_lock_stats;
+	/* number of dispatches that did not go through bfq_select_queue */
+	u64 fast_dispatches;
+#endif
+
 	/*
 	 * bic associated with the task issuing current bio for
 	 * merging. This and the next field are used as a support to
@@ -24,6 +24,7 @@
 #include <trace/events/block.h>
 #include "blk.h"
 #include "blk-rq-qos.h"
+#include "blk-throttle.h"
 
 struct bio_alloc_cache {
 	struct bio_list		free_list;
@@ -1450,6 +1451,7 @@ void bio_endio(struct bio *bio)
 		return;
 
 	rq_qos_done_bio(bio);
+	blk_zone_write_plug_bio_endio(bio);
 
 	if (bio->bi_bdev && bio_flagged(bio, BIO_TRACE_COMPLETION)) {
 		trace_block_bio_complete(bdev_get_queue(bio->bi_bdev), bio);
@@ -50,6 +50,7 @@
 #include "blk-mq-sched.h"
 #include "blk-pm.h"
 #include "blk-rq-qos.h"
+#include "blk-throttle.h"
 
 struct dentry *blk_debugfs_root;
 
@@ -782,7 +783,7 @@ static inline blk_status_t blk_check_zone_append(struct request_queue *q,
 		return BLK_STS_IOERR;
 
 	/* Make sure the BIO is small enough and will not get split */
-	if (nr_sectors > q->limits.max_zone_append_sectors)
+	if (nr_sectors > queue_max_zone_append_sectors(q))
 		return BLK_STS_IOERR;
 
 	bio->bi_opf |= REQ_NOMERGE;
@@ -1007,6 +1008,19 @@ static blk_qc_t __submit_bio_noacct_mq(struct bio *bio)
 	return ret;
 }
 
+/*
+ * Issue a bio to a blk-mq queue that already went through
+ * submit_bio_checks() once, e.g. a write held back by a zone write plug.
+ * Throttling, cgroup accounting and the queue tracepoint are skipped, they
+ * were done when the bio was first submitted.
+ */
+void submit_bio_noacct_nocheck(struct bio *bio)
+{
+	if (unlikely(bio_queue_enter(bio) != 0))
+		return;
+	blk_mq_submit_bio(bio);
+}
+
 /**
  * submit_bio_noacct - re-submit a bio to the block device layer for I/O
  * @bio:  The bio describing the location in memory and on the device.
@@ -1667,6 +1681,22 @@ EXPORT_SYMBOL(kblockd_mod_delayed_work_on);
  *   this kind of deadlock.
  */
 void blk_start_plug(struct blk_plug *plug)
+{
+	blk_start_plug_nr_ios(plug, 1);
+}
+EXPORT_SYMBOL(blk_start_plug);
+
+/**
+ * blk_start_plug_nr_ios - initialize blk_plug for a known number of I/Os
+ * @plug:	The &struct blk_plug that needs to be initialized
+ * @nr_ios:	Number of I/Os the caller is about to submit
+ *
+ * Description:
+ *   Like blk_start_plug(), but lets blk-mq allocate the requests for up to
+ *   @nr_ios I/Os (capped at %BLK_MAX_REQUEST_COUNT) with a single tag
+ *   allocation. Requests left unused are freed when the plug is flushed.
+ */
+void blk_start_plug_nr_ios(struct blk_plug *plug, unsigned short nr_ios)
 {
 	struct task_struct *tsk = current;
 
@@ -1678,6 +1708,8 @@ void blk_start_plug(struct blk_plug *plug)
 
 	INIT_LIST_HEAD(&plug->mq_list);
 	INIT_LIST_HEAD(&plug->cb_list);
+	INIT_LIST_HEAD(&plug->cached_rqs);
+	plug->nr_ios = min_t(unsigned short, nr_ios, BLK_MAX_REQUEST_COUNT);
 	plug->rq_count = 0;
 	plug->multiple_queues = false;
 	plug->nowait = false;
@@ -1688,7 +1720,7 @@ void blk_start_plug(struct blk_plug *plug)
 	 */
 	tsk->plug = plug;
 }
-EXPORT_SYMBOL(blk_start_plug);
+EXPORT_SYMBOL(blk_start_plug_nr_ios);
 
 static void flush_plug_callbacks(struct blk_plug *plug, bool from_schedule)
 {
@@ -1738,6 +1770,13 @@ void blk_flush_plug_list(struct blk_plug *plug, bool from_schedule)
 
 	if (!list_empty(&plug->mq_list))
 		blk_mq_flush_plug_list(plug, from_schedule);
+
+	/*
+	 * Cached requests hold queue references, don't let a blocked task
+	 * hold up a queue freeze with them.
+	 */
+	if (unlikely(!list_empty(&plug->cached_rqs)))
+		blk_mq_free_plug_rqs(plug);
 }
 
 /**
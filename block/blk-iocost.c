@@ -43,6 +43,14 @@
  * parameters can be configured from userspace via
  * /sys/fs/cgroup/io.cost.model.
  *
+ * Writing "ctrl=calib" to io.cost.model instead makes iocost fit the
+ * linear model online.  Completion latencies are sampled per IO class
+ * (read/write, seq/rand) against IO size and, once a second, scaled down
+ * by the average number of IOs in flight to estimate device occupancy.
+ * A least squares fit of occupancy against size over exponentially
+ * decaying sums then yields the per-page and per-IO costs, which are
+ * published through io.cost.model as usual.
+ *
  * If needed, tools/cgroup/iocost_coef_gen.py can be used to generate
  * device-specific coefficients.
  *
@@ -260,6 +268,18 @@ enum {
 
 	/* switch iff the conditions are met for longer than this */
 	AUTOP_CYCLE_NSEC	= 10LLU * NSEC_PER_SEC,
+
+	/*
+	 * Online cost model calibration folds new samples every second and
+	 * keeps 3/4 of the history on each fold, so the fitted model
+	 * follows the device within a few tens of seconds.  Classes with
+	 * fewer than CALIB_MIN_SAMPLES weighted samples are left alone.
+	 */
+	CALIB_INTV_USEC		= USEC_PER_SEC,
+	CALIB_MIN_SAMPLES	= 64,
+	CALIB_MAX_PAGES		= 1024,
+	CALIB_MAX_LAT_NSEC	= NSEC_PER_SEC,
+	CALIB_CONC_SHIFT	= 10,
 };
 
 enum {
@@ -366,6 +386,24 @@ enum {
 	NR_LCOEFS,
 };
 
+/* cost model calibration classes and sums */
+enum {
+	CALIB_RSEQ,
+	CALIB_RRAND,
+	CALIB_WSEQ,
+	CALIB_WRAND,
+	NR_CALIB_CLASSES,
+};
+
+enum {
+	CALIB_NR,
+	CALIB_X,		/* pages */
+	CALIB_Y,		/* latency or occupancy in nsecs */
+	CALIB_XX,
+	CALIB_XY,
+	NR_CALIB_SUMS,
+};
+
 enum {
 	AUTOP_INVALID,
 	AUTOP_HDD,
@@ -400,6 +438,11 @@ struct ioc_pcpu_stat {
 
 	local64_t			rq_wait_ns;
 	u64				last_rq_wait_ns;
+
+	/* cost model calibration samples, see ioc_calib_sample() */
+	local64_t			calib[NR_CALIB_CLASSES][NR_CALIB_SUMS];
+	u64				last_calib[NR_CALIB_CLASSES][NR_CALIB_SUMS];
+	sector_t			calib_cursor[2];
 };
 
 /* per device */
@@ -445,6 +488,12 @@ struct ioc {
 	int				autop_idx;
 	bool				user_qos_params:1;
 	bool				user_cost_model:1;
+	bool				cost_calib:1;
+
+	/* online cost model calibration */
+	u64				calib_at;
+	u64				calib_pending[NR_CALIB_CLASSES][NR_CALIB_SUMS];
+	u64				calib_sums[NR_CALIB_CLASSES][NR_CALIB_SUMS];
 };
 
 struct iocg_pcpu_stat {
@@ -1606,6 +1655,180 @@ static void ioc_lat_stat(struct ioc *ioc, u32 *missed_ppm_ar, u32 *rq_wait_pct_p
 				   ioc->period_us * NSEC_PER_USEC);
 }
 
+static void ioc_calib_reset(struct ioc *ioc)
+{
+	lockdep_assert_held(&ioc->lock);
+
+	ioc->calib_at = 0;
+	memset(ioc->calib_pending, 0, sizeof(ioc->calib_pending));
+	memset(ioc->calib_sums, 0, sizeof(ioc->calib_sums));
+}
+
+/* collect the calibration samples recorded by ioc_rqos_done() */
+static void ioc_calib_stat(struct ioc *ioc)
+{
+	int cpu, c, i;
+
+	lockdep_assert_held(&ioc->lock);
+
+	for_each_online_cpu(cpu) {
+		struct ioc_pcpu_stat *stat = per_cpu_ptr(ioc->pcpu_stat, cpu);
+
+		for (c = 0; c < NR_CALIB_CLASSES; c++) {
+			for (i = 0; i < NR_CALIB_SUMS; i++) {
+				u64 this = local64_read(&stat->calib[c][i]);
+
+				ioc->calib_pending[c][i] +=
+					this - stat->last_calib[c][i];
+				stat->last_calib[c][i] = this;
+			}
+		}
+	}
+}
+
+enum {
+	CALIB_FIT_PAGE		= 1 << 0,
+	CALIB_FIT_SEQIO		= 1 << 1,
+	CALIB_FIT_RANDIO	= 1 << 2,
+};
+
+/*
+ * Fit occupancy = base + pages * @page for one IO direction.  @page is
+ * determined from whichever class shows more size variation and, if
+ * neither does, the current coefficient is kept.  The base costs of the
+ * seq and rand classes, @seqio and @randio, are then fitted against the
+ * common @page.  Returns CALIB_FIT_* flags for the coefficients found.
+ */
+static int ioc_calib_fit(u64 (*sums)[NR_CALIB_SUMS], u64 *page,
+			 u64 *seqio, u64 *randio)
+{
+	u64 best_var = 0;
+	int c, ret = 0;
+
+	for (c = 0; c < 2; c++) {
+		u64 *sm = sums[c];
+		u64 xx, xy, var;
+
+		if (sm[CALIB_NR] < CALIB_MIN_SAMPLES)
+			continue;
+
+		/*
+		 * The sums decay and round independently, so a class with
+		 * (nearly) constant IO sizes can end up with sum(x)^2 / n
+		 * slightly above sum(x^2).  Clamp instead of wrapping.
+		 */
+		xx = mul_u64_u64_div_u64(sm[CALIB_X], sm[CALIB_X], sm[CALIB_NR]);
+		var = sm[CALIB_XX] > xx ? sm[CALIB_XX] - xx : 0;
+		/* require at least a page of spread per sample on average */
+		if (var < sm[CALIB_NR] || var <= best_var)
+			continue;
+
+		xy = mul_u64_u64_div_u64(sm[CALIB_X], sm[CALIB_Y], sm[CALIB_NR]);
+		*page = sm[CALIB_XY] > xy ? div64_u64(sm[CALIB_XY] - xy, var) : 0;
+		best_var = var;
+		ret |= CALIB_FIT_PAGE;
+	}
+
+	for (c = 0; c < 2; c++) {
+		u64 *sm = sums[c];
+		u64 size_cost = sm[CALIB_X] * *page;
+		u64 base;
+
+		if (sm[CALIB_NR] < CALIB_MIN_SAMPLES)
+			continue;
+
+		base = sm[CALIB_Y] > size_cost ?
+			div64_u64(sm[CALIB_Y] - size_cost, sm[CALIB_NR]) : 0;
+		if (c == 0) {
+			*seqio = base;
+			ret |= CALIB_FIT_SEQIO;
+		} else {
+			*randio = base;
+			ret |= CALIB_FIT_RANDIO;
+		}
+	}
+
+	return ret;
+}
+
+/*
+ * Fold the samples collected over the last calibration interval into the
+ * decaying sums and refit the linear model.  Completion latency overstates
+ * the device time an IO occupies by the number of IOs which are being
+ * processed in parallel.  Scale latencies by the average concurrency,
+ * obtained from Little's law as the sum of latencies over the elapsed
+ * wallclock time.
+ */
+static void ioc_calib_update(struct ioc *ioc, struct ioc_now *now)
+{
+	u64 *u = ioc->params.i_lcoefs;
+	u64 *lc = ioc->params.lcoefs;
+	u64 y_sum = 0, conc, dur_ns;
+	int c, rw, i;
+
+	lockdep_assert_held(&ioc->lock);
+
+	if (!ioc->cost_calib)
+		return;
+
+	ioc_calib_stat(ioc);
+
+	if (!ioc->calib_at) {
+		memset(ioc->calib_pending, 0, sizeof(ioc->calib_pending));
+		ioc->calib_at = now->now;
+		return;
+	}
+	if (now->now - ioc->calib_at < CALIB_INTV_USEC)
+		return;
+
+	dur_ns = (now->now - ioc->calib_at) * NSEC_PER_USEC;
+	for (c = 0; c < NR_CALIB_CLASSES; c++)
+		y_sum += ioc->calib_pending[c][CALIB_Y];
+	conc = max_t(u64, mul_u64_u64_div_u64(y_sum, 1 << CALIB_CONC_SHIFT,
+					      dur_ns),
+		     1 << CALIB_CONC_SHIFT);
+
+	for (c = 0; c < NR_CALIB_CLASSES; c++) {
+		u64 *pend = ioc->calib_pending[c];
+
+		pend[CALIB_Y] = mul_u64_u64_div_u64(pend[CALIB_Y],
+						    1 << CALIB_CONC_SHIFT, conc);
+		pend[CALIB_XY] = mul_u64_u64_div_u64(pend[CALIB_XY],
+						     1 << CALIB_CONC_SHIFT, conc);
+
+		for (i = 0; i < NR_CALIB_SUMS; i++) {
+			u64 *sum = &ioc->calib_sums[c][i];
+
+			*sum = *sum - (*sum >> 2) + pend[i];
+			pend[i] = 0;
+		}
+	}
+	ioc->calib_at = now->now;
+
+	for (rw = READ; rw <= WRITE; rw++) {
+		int lidx = rw == READ ? LCOEF_RPAGE : LCOEF_WPAGE;
+		int iidx = rw == READ ? I_LCOEF_RBPS : I_LCOEF_WBPS;
+		u64 page = div64_u64(lc[lidx], VTIME_PER_NSEC);
+		u64 seqio = 0, randio = 0;
+		int fit;
+
+		fit = ioc_calib_fit(&ioc->calib_sums[rw * 2], &page,
+				    &seqio, &randio);
+		page = max_t(u64, page, 1);
+
+		/* I_LCOEF_[RW]{BPS,SEQIOPS,RANDIOPS} are consecutive */
+		if (fit & CALIB_FIT_PAGE)
+			u[iidx] = div64_u64((u64)IOC_PAGE_SIZE * NSEC_PER_SEC,
+					    page);
+		if (fit & CALIB_FIT_SEQIO)
+			u[iidx + 1] = div64_u64(NSEC_PER_SEC, seqio + page);
+		if (fit & CALIB_FIT_RANDIO)
+			u[iidx + 2] = div64_u64(NSEC_PER_SEC, randio + page);
+	}
+
+	ioc_refresh_lcoefs(ioc);
+}
+
 /* was iocg idle this period? */
 static bool iocg_is_idle(struct ioc_gq *iocg)
 {
@@ -2415,6 +2638,7 @@ static void ioc_timer_fn(struct timer_list *timer)
 			      prev_busy_level, missed_ppm);
 
 	ioc_refresh_params(ioc, false);
+	ioc_calib_update(ioc, &now);
 
 	ioc_forgive_debts(ioc, usage_us_sum, nr_debtors, &now);
 
@@ -2776,11 +3000,47 @@ static void ioc_rqos_done_bio(struct rq_qos *rqos, struct bio *bio)
 		atomic64_add(bio->bi_iocost_cost, &iocg->done_vtime);
 }
 
+/*
+ * Record @rq's device latency against its size for cost model calibration.
+ * Whether an IO is sequential is judged from the end of the last IO in the
+ * same direction completed on this CPU, which is a good enough
+ * approximation for streams which complete where they were issued.
+ */
+static void ioc_calib_sample(struct ioc_pcpu_stat *ccs, struct request *rq,
+			     int rw, u64 now_ns)
+{
+	sector_t pos = blk_rq_pos(rq);
+	u64 lat = now_ns - rq->io_start_time_ns;
+	u64 pages, seek_pages;
+	local64_t *sm;
+	int c;
+
+	seek_pages = abs((s64)(pos - ccs->calib_cursor[rw])) >>
+		IOC_SECT_TO_PAGE_SHIFT;
+	ccs->calib_cursor[rw] = pos + blk_rq_stats_sectors(rq);
+
+	if (lat > CALIB_MAX_LAT_NSEC)
+		return;
+
+	pages = clamp_t(u64, blk_rq_stats_sectors(rq) >> IOC_SECT_TO_PAGE_SHIFT,
+			1, CALIB_MAX_PAGES);
+	c = rw == READ ? CALIB_RSEQ : CALIB_WSEQ;
+	if (seek_pages > LCOEF_RANDIO_PAGES)
+		c++;
+
+	sm = ccs->calib[c];
+	local64_inc(&sm[CALIB_NR]);
+	local64_add(pages, &sm[CALIB_X]);
+	local64_add(lat, &sm[CALIB_Y]);
+	local64_add(pages * pages, &sm[CALIB_XX]);
+	local64_add(pages * lat, &sm[CALIB_XY]);
+}
+
 static void ioc_rqos_done(struct rq_qos *rqos, struct request *rq)
 {
 	struct ioc *ioc = rqos_to_ioc(rqos);
 	struct ioc_pcpu_stat *ccs;
-	u64 on_q_ns, rq_wait_ns, size_nsec;
+	u64 now_ns, on_q_ns, rq_wait_ns, size_nsec;
 	int pidx, rw;
 
 	if (!ioc->enabled || !rq->alloc_time_ns || !rq->start_time_ns)
@@ -2799,7 +3059,8 @@ static void ioc_rqos_done(struct rq_qos *rqos, struct request *rq)
 		return;
 	}
 
-	on_q_ns = ktime_get_ns() - rq->alloc_time_ns;
+	now_ns = ktime_get_ns();
+	on_q_ns = now_ns - rq->alloc_time_ns;
 	rq_wait_ns = rq->start_time_ns - rq->alloc_time_ns;
 	size_nsec = div64_u64(calc_size_vtime_cost(rq, ioc), VTIME_PER_NSEC);
 
@@ -2813,6 +3074,9 @@ static void ioc_rqos_done(struct rq_qos *rqos, struct request *rq)
 
 	local64_add(rq_wait_ns, &ccs->rq_wait_ns);
 
+	if (ioc->cost_calib && rq->io_start_time_ns)
+		ioc_calib_sample(ccs, rq, rw, now_ns);
+
 	put_cpu_ptr(ccs);
 }
 
@@ -2833,6 +3097,8 @@ static void ioc_rqos_exit(struct rq_qos *rqos)
 
 	spin_lock_irq(&ioc->lock);
 	ioc->running = IOC_STOP;
+	if (ioc->cost_calib)
+		blk_stat_disable_accounting(rqos->q);
 	spin_unlock_irq(&ioc->lock);
 
 	del_timer_sync(&ioc->timer);
@@ -2873,6 +3139,12 @@ static int blk_iocost_init(struct request_queue *q)
 			local_set(&ccs->missed[i].nr_missed, 0);
 		}
 		local64_set(&ccs->rq_wait_ns, 0);
+		for (i = 0; i < NR_CALIB_CLASSES; i++) {
+			int j;
+
+			for (j = 0; j < NR_CALIB_SUMS; j++)
+				local64_set(&ccs->calib[i][j], 0);
+		}
 	}
 
 	rqos = &ioc->rqos;
@@ -3320,7 +3592,8 @@ static u64 ioc_cost_model_prfill(struct seq_file *sf,
 	seq_printf(sf, "%s ctrl=%s model=linear "
 		   "rbps=%llu rseqiops=%llu rrandiops=%llu "
 		   "wbps=%llu wseqiops=%llu wrandiops=%llu\n",
-		   dname, ioc->user_cost_model ? "user" : "auto",
+		   dname, ioc->cost_calib ? "calib" :
+		   ioc->user_cost_model ? "user" : "auto",
 		   u[I_LCOEF_RBPS], u[I_LCOEF_RSEQIOPS], u[I_LCOEF_RRANDIOPS],
 		   u[I_LCOEF_WBPS], u[I_LCOEF_WSEQIOPS], u[I_LCOEF_WRANDIOPS]);
 	return 0;
@@ -3357,7 +3630,7 @@ static ssize_t ioc_cost_model_write(struct kernfs_open_file *of, char *input,
 	struct block_device *bdev;
 	struct ioc *ioc;
 	u64 u[NR_I_LCOEFS];
-	bool user;
+	bool user, calib;
 	char *p;
 	int ret;
 
@@ -3376,6 +3649,7 @@ static ssize_t ioc_cost_model_write(struct kernfs_open_file *of, char *input,
 	spin_lock_irq(&ioc->lock);
 	memcpy(u, ioc->params.i_lcoefs, sizeof(u));
 	user = ioc->user_cost_model;
+	calib = ioc->cost_calib;
 	spin_unlock_irq(&ioc->lock);
 
 	while ((p = strsep(&input, " \t\n"))) {
@@ -3390,12 +3664,17 @@ static ssize_t ioc_cost_model_write(struct kernfs_open_file *of, char *input,
 		switch (match_token(p, cost_ctrl_tokens, args)) {
 		case COST_CTRL:
 			match_strlcpy(buf, &args[0], sizeof(buf));
-			if (!strcmp(buf, "auto"))
+			if (!strcmp(buf, "auto")) {
 				user = false;
-			else if (!strcmp(buf, "user"))
+				calib = false;
+			} else if (!strcmp(buf, "user")) {
 				user = true;
-			else
+				calib = false;
+			} else if (!strcmp(buf, "calib")) {
+				calib = true;
+			} else {
 				goto einval;
+			}
 			continue;
 		case COST_MODEL:
 			match_strlcpy(buf, &args[0], sizeof(buf));
@@ -3414,12 +3693,21 @@ static ssize_t ioc_cost_model_write(struct kernfs_open_file *of, char *input,
 	}
 
 	spin_lock_irq(&ioc->lock);
-	if (user) {
+	/* calibration starts from the current or the given coefficients */
+	if (user || calib) {
 		memcpy(ioc->params.i_lcoefs, u, sizeof(u));
 		ioc->user_cost_model = true;
 	} else {
 		ioc->user_cost_model = false;
 	}
+	/* calibration needs rq->io_start_time_ns */
+	if (calib && !ioc->cost_calib) {
+		blk_stat_enable_accounting(ioc->rqos.q);
+		ioc_calib_reset(ioc);
+	} else if (!calib && ioc->cost_calib) {
+		blk_stat_disable_accounting(ioc->rqos.q);
+	}
+	ioc->cost_calib = calib;
 	ioc_refresh_params(ioc, true);
 	spin_unlock_irq(&ioc->lock);
 
@@ -13,6 +13,7 @@
 
 #include "blk.h"
 #include "blk-rq-qos.h"
+#include "blk-throttle.h"
 
 static inline bool bio_will_gap(struct request_queue *q,
 		struct request *prev_rq, struct bio *prev, struct bio *next)
@@ -224,6 +225,28 @@ static bool bvec_split_segs(const struct request_queue *q,
 	return len > 0 || bv->bv_len > max_len;
 }
 
+/*
+ * Bios built from a single large folio, as direct IO to huge page backed
+ * buffers produces, consist of one physically contiguous multi-page bvec.
+ * If that bvec is within the queue's size limits and fits in one segment,
+ * the bio needs no splitting and the segment walk of blk_bio_segment_split()
+ * can be skipped altogether.
+ */
+static bool bio_is_single_segment(struct request_queue *q, struct bio *bio)
+{
+	struct bio_vec bv;
+
+	if (!bio_has_data(bio))
+		return false;
+
+	bv = mp_bvec_iter_bvec(bio->bi_io_vec, bio->bi_iter);
+	if (bv.bv_len != bio->bi_iter.bi_size)
+		return false;
+
+	return bio_sectors(bio) <= get_max_io_size(q, bio) &&
+		bv.bv_len <= get_max_segment_size(q, bv.bv_page, bv.bv_offset);
+}
+
 /**
  * blk_bio_segment_split - split a bio in two bios
  * @q:    [in] request queue pointer
@@ -347,6 +370,10 @@ void __blk_queue_split(struct bio **bio, unsigned int *nr_segs)
 			*nr_segs = 1;
 			break;
 		}
+		if (bio_is_single_segment(q, *bio)) {
+			*nr_segs = 1;
+			break;
+		}
 		split = blk_bio_segment_split(q, *bio, &q->bio_split, nr_segs);
 		if (IS_ERR(split))
 			*bio = split = NULL;
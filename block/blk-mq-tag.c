@@ -179,6 +179,40 @@ unsigned int blk_mq_get_tag(struct blk_mq_alloc_data *data)
 	return tag + tag_offset;
 }
 
+/*
+ * Grab up to @nr_tags normal tags with a single sbitmap operation. Only done
+ * for the simple case: no scheduler, no depth limiting and no sharing of the
+ * tags with other queues, everything else goes through blk_mq_get_tag().
+ */
+unsigned long blk_mq_get_tags(struct blk_mq_alloc_data *data, int nr_tags,
+			      unsigned int *offset)
+{
+	struct blk_mq_tags *tags = blk_mq_tags_from_data(data);
+	struct sbitmap_queue *bt = tags->bitmap_tags;
+	unsigned long ret;
+	int i;
+
+	if (data->q->elevator || data->shallow_depth ||
+	    (data->flags & BLK_MQ_REQ_RESERVED) ||
+	    (data->hctx->flags & BLK_MQ_F_TAG_QUEUE_SHARED))
+		return 0;
+
+	ret = __sbitmap_queue_get_batch(bt, nr_tags, offset);
+	if (!ret)
+		return 0;
+
+	*offset += tags->nr_reserved_tags;
+
+	/* See blk_mq_get_tag() */
+	if (unlikely(test_bit(BLK_MQ_S_INACTIVE, &data->hctx->state))) {
+		for (i = 0; i < BITS_PER_LONG; i++)
+			if (ret & (1UL << i))
+				blk_mq_put_tag(tags, data->ctx, *offset + i);
+		return 0;
+	}
+	return ret;
+}
+
 void blk_mq_put_tag(struct blk_mq_tags *tags, struct blk_mq_ctx *ctx,
 		    unsigned int tag)
 {
@@ -193,6 +227,13 @@ void blk_mq_put_tag(struct blk_mq_tags *tags, struct blk_mq_ctx *ctx,
 	}
 }
 
+/* Free a batch of normal (non-reserved) tags */
+void blk_mq_put_tags(struct blk_mq_tags *tags, int *tag_array, int nr_tags)
+{
+	sbitmap_queue_clear_batch(tags->bitmap_tags, tags->nr_reserved_tags,
+				  tag_array, nr_tags);
+}
+
 struct bt_iter_data {
 	struct blk_mq_hw_ctx *hctx;
 	busy_iter_fn *fn;
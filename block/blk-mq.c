@@ -272,15 +272,6 @@ void blk_mq_wake_waiters(struct request_queue *q)
 			blk_mq_tag_wakeup_all(hctx->tags, true);
 }
 
-/*
- * Only need start/end time stamping if we have iostat or
- * blk stats enabled, or using an IO scheduler.
- */
-static inline bool blk_mq_need_time_stamp(struct request *rq)
-{
-	return (rq->rq_flags & (RQF_IO_STAT | RQF_STATS)) || rq->q->elevator;
-}
-
 static struct request *blk_mq_rq_ctx_init(struct blk_mq_alloc_data *data,
 		unsigned int tag, u64 alloc_time_ns)
 {
@@ -352,11 +343,43 @@ static struct request *blk_mq_rq_ctx_init(struct blk_mq_alloc_data *data,
 	return rq;
 }
 
+/*
+ * Allocate up to data->nr_tags requests at once, return one of them and put
+ * the others on data->cached_rqs. Each cached request holds its own queue
+ * reference, as if it had been allocated by a bio of its own.
+ */
+static struct request *
+__blk_mq_alloc_requests_batch(struct blk_mq_alloc_data *data,
+			      u64 alloc_time_ns)
+{
+	unsigned int tag_offset;
+	struct request *rq = NULL;
+	unsigned long tags;
+	int i, nr = 0;
+
+	tags = blk_mq_get_tags(data, data->nr_tags, &tag_offset);
+	if (unlikely(!tags))
+		return NULL;
+
+	for (i = 0; tags; i++) {
+		if (!(tags & (1UL << i)))
+			continue;
+		tags &= ~(1UL << i);
+		if (rq)
+			list_add_tail(&rq->queuelist, data->cached_rqs);
+		rq = blk_mq_rq_ctx_init(data, tag_offset + i, alloc_time_ns);
+		nr++;
+	}
+	percpu_ref_get_many(&data->q->q_usage_counter, nr - 1);
+	return rq;
+}
+
 static struct request *__blk_mq_alloc_request(struct blk_mq_alloc_data *data)
 {
 	struct request_queue *q = data->q;
 	struct elevator_queue *e = q->elevator;
 	u64 alloc_time_ns = 0;
+	struct request *rq;
 	unsigned int tag;
 
 	/* alloc_time includes depth and tag waits */
@@ -385,6 +408,13 @@ static struct request *__blk_mq_alloc_request(struct blk_mq_alloc_data *data)
 	if (!e)
 		blk_mq_tag_busy(data->hctx);
 
+	if (data->nr_tags > 1) {
+		rq = __blk_mq_alloc_requests_batch(data, alloc_time_ns);
+		if (rq)
+			return rq;
+		data->nr_tags = 1;
+	}
+
 	/*
 	 * Waiting allocations only fail because of an inactive hctx.  In that
 	 * case just retry the hctx assignment and tag allocation as CPU hotplug
@@ -406,6 +436,46 @@ static struct request *__blk_mq_alloc_request(struct blk_mq_alloc_data *data)
 	return blk_mq_rq_ctx_init(data, tag, alloc_time_ns);
 }
 
+/*
+ * Use a request pre-allocated by an earlier bio in the same plug, as long as
+ * it was allocated for this queue and maps to the hardware queue this bio
+ * would have gone to.
+ */
+static struct request *blk_mq_get_cached_request(struct request_queue *q,
+		struct blk_plug *plug, struct bio *bio)
+{
+	struct request *rq;
+
+	if (!plug || list_empty(&plug->cached_rqs))
+		return NULL;
+
+	rq = list_first_entry(&plug->cached_rqs, struct request, queuelist);
+	if (rq->q != q ||
+	    blk_mq_map_queue(q, bio->bi_opf, rq->mq_ctx) != rq->mq_hctx)
+		return NULL;
+
+	list_del_init(&rq->queuelist);
+	rq->cmd_flags = bio->bi_opf;
+	if (blk_mq_need_time_stamp(rq))
+		rq->start_time_ns = ktime_get_ns();
+
+	/* The request holds its own reference, drop the one of the bio */
+	blk_queue_exit(q);
+	return rq;
+}
+
+void blk_mq_free_plug_rqs(struct blk_plug *plug)
+{
+	struct request *rq;
+
+	while (!list_empty(&plug->cached_rqs)) {
+		rq = list_first_entry(&plug->cached_rqs, struct request,
+				      queuelist);
+		list_del_init(&rq->queuelist);
+		blk_mq_free_request(rq);
+	}
+}
+
 struct request *blk_mq_alloc_request(struct request_queue *q, unsigned int op,
 		blk_mq_req_flags_t flags)
 {
@@ -545,13 +615,8 @@ void blk_mq_free_request(struct request *rq)
 }
 EXPORT_SYMBOL_GPL(blk_mq_free_request);
 
-inline void __blk_mq_end_request(struct request *rq, blk_status_t error)
+static inline void __blk_mq_end_request_acct(struct request *rq, u64 now)
 {
-	u64 now = 0;
-
-	if (blk_mq_need_time_stamp(rq))
-		now = ktime_get_ns();
-
 	if (rq->rq_flags & RQF_STATS) {
 		blk_mq_poll_stats_start(rq->q);
 		blk_stat_add(rq, now);
@@ -560,6 +625,16 @@ inline void __blk_mq_end_request(struct request *rq, blk_status_t error)
 	blk_mq_sched_completed_request(rq, now);
 
 	blk_account_io_done(rq, now);
+}
+
+inline void __blk_mq_end_request(struct request *rq, blk_status_t error)
+{
+	u64 now = 0;
+
+	if (blk_mq_need_time_stamp(rq))
+		now = ktime_get_ns();
+
+	__blk_mq_end_request_acct(rq, now);
 
 	if (rq->end_io) {
 		rq_qos_done(rq->q, rq);
@@ -578,6 +653,84 @@ void blk_mq_end_request(struct request *rq, blk_status_t error)
 }
 EXPORT_SYMBOL(blk_mq_end_request);
 
+#define TAG_COMP_BATCH		32
+
+static inline void blk_mq_flush_tag_batch(struct blk_mq_hw_ctx *hctx,
+					  int *tag_array, int nr_tags)
+{
+	struct request_queue *q = hctx->queue;
+
+	blk_mq_put_tags(hctx->tags, tag_array, nr_tags);
+	blk_mq_sched_restart(hctx);
+	percpu_ref_put_many(&q->q_usage_counter, nr_tags);
+}
+
+/**
+ * blk_mq_end_request_batch - end all requests collected in a batch
+ * @iob: batch built with blk_mq_add_to_batch()
+ *
+ * Same as calling blk_mq_end_request(rq, BLK_STS_OK) on each request, except
+ * that the tags are returned to the sbitmap a word at a time and the queue
+ * references are dropped in one go.
+ */
+void blk_mq_end_request_batch(struct io_comp_batch *iob)
+{
+	int tags[TAG_COMP_BATCH], nr_tags = 0;
+	struct blk_mq_hw_ctx *cur_hctx = NULL;
+	struct request *rq, *next;
+	u64 now = 0;
+
+	if (iob->need_ts)
+		now = ktime_get_ns();
+
+	for (rq = iob->req_list; rq; rq = next) {
+		struct blk_mq_hw_ctx *hctx = rq->mq_hctx;
+		struct request_queue *q = rq->q;
+
+		next = rq->rq_next;
+		prefetch(rq->bio);
+		prefetch(next);
+
+		blk_update_request(rq, BLK_STS_OK, blk_rq_bytes(rq));
+		if (iob->need_ts)
+			__blk_mq_end_request_acct(rq, now);
+
+		rq->mq_ctx->rq_completed[rq_is_sync(rq)]++;
+		if (unlikely(laptop_mode && !blk_rq_is_passthrough(rq)))
+			laptop_io_completion(q->disk->bdi);
+		rq_qos_done(q, rq);
+
+		WRITE_ONCE(rq->state, MQ_RQ_IDLE);
+		if (!refcount_dec_and_test(&rq->ref))
+			continue;
+
+		blk_crypto_free_request(rq);
+		blk_pm_mark_last_busy(rq);
+		rq->mq_hctx = NULL;
+
+		if (unlikely(blk_mq_tag_is_reserved(hctx->tags, rq->tag))) {
+			blk_mq_put_tag(hctx->tags, rq->mq_ctx, rq->tag);
+			blk_mq_sched_restart(hctx);
+			blk_queue_exit(q);
+			continue;
+		}
+
+		if (nr_tags == TAG_COMP_BATCH || cur_hctx != hctx) {
+			if (cur_hctx)
+				blk_mq_flush_tag_batch(cur_hctx, tags, nr_tags);
+			nr_tags = 0;
+			cur_hctx = hctx;
+		}
+		tags[nr_tags++] = rq->tag;
+	}
+
+	if (nr_tags)
+		blk_mq_flush_tag_batch(cur_hctx, tags, nr_tags);
+
+	iob->req_list = NULL;
+}
+EXPORT_SYMBOL_GPL(blk_mq_end_request_batch);
+
 static void blk_complete_reqs(struct llist_head *list)
 {
 	struct llist_node *entry = llist_reverse_order(llist_del_all(list));
@@ -1915,14 +2068,70 @@ static int plug_rq_cmp(void *priv, const struct list_head *a,
 	return blk_rq_pos(rqa) > blk_rq_pos(rqb);
 }
 
+/*
+ * Hand the whole plug list to the driver in one go, if it has a ->queue_rqs()
+ * hook. Only done for a queue without a scheduler and without shared tags,
+ * as this skips the hctx dispatch path and its active request accounting.
+ * The requests may map to several hctxs if the task migrated while plugged,
+ * all of them have to allow direct issue.
+ *
+ * Returns true if the unplug was traced, whatever the driver left behind.
+ */
+static bool blk_mq_plug_issue_rqs(struct list_head *list, bool from_schedule,
+				  unsigned int depth)
+{
+	struct request *rq = list_first_entry(list, struct request, queuelist);
+	struct request_queue *q = rq->q;
+	bool traced = false;
+
+	if (!q->mq_ops->queue_rqs || q->elevator)
+		return false;
+
+	list_for_each_entry(rq, list, queuelist) {
+		struct blk_mq_hw_ctx *hctx = rq->mq_hctx;
+
+		if ((hctx->flags &
+		     (BLK_MQ_F_TAG_QUEUE_SHARED | BLK_MQ_F_BLOCKING)) ||
+		    blk_mq_hctx_stopped(hctx))
+			return false;
+	}
+
+	rcu_read_lock();
+	if (!blk_queue_quiesced(q)) {
+		trace_block_unplug(q, depth, !from_schedule);
+		traced = true;
+		list_for_each_entry(rq, list, queuelist)
+			rq->mq_hctx->tags->rqs[rq->tag] = rq;
+		q->mq_ops->queue_rqs(list);
+
+		/* the driver may have started a request before giving up */
+		list_for_each_entry(rq, list, queuelist)
+			if (blk_mq_request_started(rq))
+				__blk_mq_requeue_request(rq);
+	}
+	rcu_read_unlock();
+
+	return traced;
+}
+
 void blk_mq_flush_plug_list(struct blk_plug *plug, bool from_schedule)
 {
 	LIST_HEAD(list);
+	bool traced = false;
 
 	if (list_empty(&plug->mq_list))
 		return;
 	list_splice_init(&plug->mq_list, &list);
 
+	if (!plug->multiple_queues && !from_schedule) {
+		traced = blk_mq_plug_issue_rqs(&list, from_schedule,
+					       plug->rq_count);
+		if (list_empty(&list)) {
+			plug->rq_count = 0;
+			return;
+		}
+	}
+
 	if (plug->rq_count > 2 && plug->multiple_queues)
 		list_sort(NULL, &list, plug_rq_cmp);
 
@@ -1945,7 +2154,8 @@ void blk_mq_flush_plug_list(struct blk_plug *plug, bool from_schedule)
 		}
 
 		list_cut_before(&rq_list, &list, pos);
-		trace_block_unplug(head_rq->q, depth, !from_schedule);
+		if (!traced)
+			trace_block_unplug(head_rq->q, depth, !from_schedule);
 		blk_mq_sched_insert_requests(this_hctx, this_ctx, &rq_list,
 						from_schedule);
 	} while(!list_empty(&list));
@@ -2197,6 +2407,9 @@ blk_qc_t blk_mq_submit_bio(struct bio *bio)
 	if (!bio)
 		goto queue_exit;
 
+	if (blk_zone_plug_bio(bio))
+		goto queue_exit;
+
 	if (!bio_integrity_prep(bio))
 		goto queue_exit;
 
@@ -2211,7 +2424,20 @@ blk_qc_t blk_mq_submit_bio(struct bio *bio)
 
 	hipri = bio->bi_opf & REQ_HIPRI;
 
+	plug = blk_mq_plug(q, bio);
+	rq = blk_mq_get_cached_request(q, plug, bio);
+	if (rq) {
+		data.ctx = rq->mq_ctx;
+		data.hctx = rq->mq_hctx;
+		goto got_rq;
+	}
+
 	data.cmd_flags = bio->bi_opf;
+	if (plug) {
+		data.nr_tags = plug->nr_ios;
+		plug->nr_ios = 1;
+		data.cached_rqs = &plug->cached_rqs;
+	}
 	rq = __blk_mq_alloc_request(&data);
 	if (unlikely(!rq)) {
 		rq_qos_cleanup(q, bio);
@@ -2220,6 +2446,8 @@ blk_qc_t blk_mq_submit_bio(struct bio *bio)
 		goto queue_exit;
 	}
 
+got_rq:
+
 	trace_block_getrq(bio);
 
 	rq_qos_track(q, rq, bio);
@@ -2236,7 +2464,6 @@ blk_qc_t blk_mq_submit_bio(struct bio *bio)
 		return BLK_QC_T_NONE;
 	}
 
-	plug = blk_mq_plug(q, bio);
 	if (unlikely(is_flush_fua)) {
 		/* Bypass scheduler for flush requests */
 		blk_insert_flush(rq);
@@ -157,6 +157,10 @@ struct blk_mq_alloc_data {
 	unsigned int shallow_depth;
 	unsigned int cmd_flags;
 
+	/* allocate multiple requests/tags in one go */
+	unsigned int nr_tags;
+	struct list_head *cached_rqs;
+
 	/* input & output parameter */
 	struct blk_mq_ctx *ctx;
 	struct blk_mq_hw_ctx *hctx;
@@ -304,6 +308,8 @@ static inline struct blk_plug *blk_mq_plug(struct request_queue *q,
 	return NULL;
 }
 
+void blk_mq_free_plug_rqs(struct blk_plug *plug);
+
 /* Free all requests on the list */
 static inline void blk_mq_free_requests(struct list_head *list)
 {
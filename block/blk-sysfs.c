@@ -17,6 +17,7 @@
 #include "blk-mq.h"
 #include "blk-mq-debugfs.h"
 #include "blk-wbt.h"
+#include "blk-throttle.h"
 
 struct queue_sysfs_entry {
 	struct attribute attr;
@@ -230,7 +231,7 @@ static ssize_t queue_zone_write_granularity_show(struct request_queue *q,
 
 static ssize_t queue_zone_append_max_show(struct request_queue *q, char *page)
 {
-	unsigned long long max_sectors = q->limits.max_zone_append_sectors;
+	unsigned long long max_sectors = queue_max_zone_append_sectors(q);
 
 	return sprintf(page, "%llu\n", max_sectors << SECTOR_SHIFT);
 }
@@ -808,6 +809,7 @@ static void blk_release_queue(struct kobject *kobj)
 	blk_exit_queue(q);
 
 	blk_queue_free_zone_bitmaps(q);
+	blk_queue_free_zone_wplugs(q);
 
 	if (queue_is_mq(q))
 		blk_mq_release(q);
@@ -457,6 +457,361 @@ int blkdev_zone_mgmt_ioctl(struct block_device *bdev, fmode_t mode,
 	return ret;
 }
 
+/*
+ * Zone write plugging: writes to a sequential zone are serialized at the bio
+ * level, before a request is allocated, so that at most one write per zone is
+ * in flight. This removes any dependency on the I/O scheduler for preserving
+ * the write order and allows emulating zone append operations with regular
+ * writes for devices that do not support them natively.
+ */
+struct blk_zone_wplug {
+	spinlock_t		lock;
+	unsigned int		flags;
+	/* Write pointer and capacity of the zone, relative to its start */
+	unsigned int		wp_offset;
+	unsigned int		capacity;
+	/* Start offset of the in-flight emulated zone append */
+	unsigned int		append_offset;
+	struct bio		*inflight;
+	struct bio_list		bio_list;
+	struct work_struct	work;
+	struct request_queue	*q;
+};
+
+/* The zone write pointer is unknown, e.g. after a write error */
+#define BLK_ZONE_WPLUG_NEED_WP_UPDATE	(1U << 0)
+/* The in-flight write is an emulated zone append */
+#define BLK_ZONE_WPLUG_APPEND		(1U << 1)
+
+static inline sector_t blk_zone_wplug_start(struct blk_zone_wplug *plug)
+{
+	struct request_queue *q = plug->q;
+
+	return (sector_t)(plug - q->zone_wplugs) <<
+		ilog2(blk_queue_zone_sectors(q));
+}
+
+static void blk_zone_wplug_set_wp(struct blk_zone_wplug *plug,
+				  struct blk_zone *zone)
+{
+	plug->capacity = zone->capacity;
+
+	switch (zone->cond) {
+	case BLK_ZONE_COND_EMPTY:
+		plug->wp_offset = 0;
+		break;
+	case BLK_ZONE_COND_IMP_OPEN:
+	case BLK_ZONE_COND_EXP_OPEN:
+	case BLK_ZONE_COND_CLOSED:
+		plug->wp_offset = zone->wp - zone->start;
+		break;
+	default:
+		/* Full, read-only and offline zones cannot be written */
+		plug->wp_offset = plug->capacity;
+		break;
+	}
+	plug->flags &= ~BLK_ZONE_WPLUG_NEED_WP_UPDATE;
+}
+
+static int blk_zone_wplug_report_zone_cb(struct blk_zone *zone,
+					 unsigned int idx, void *data)
+{
+	struct blk_zone_wplug *plug = data;
+	unsigned long flags;
+
+	spin_lock_irqsave(&plug->lock, flags);
+	blk_zone_wplug_set_wp(plug, zone);
+	spin_unlock_irqrestore(&plug->lock, flags);
+
+	return 0;
+}
+
+static void blk_zone_wplug_refresh_wp(struct blk_zone_wplug *plug)
+{
+	struct gendisk *disk = plug->q->disk;
+	unsigned int noio_flag;
+
+	noio_flag = memalloc_noio_save();
+	disk->fops->report_zones(disk, blk_zone_wplug_start(plug), 1,
+				 blk_zone_wplug_report_zone_cb, plug);
+	memalloc_noio_restore(noio_flag);
+}
+
+/*
+ * Prepare @bio for being issued as the zone in-flight write. Emulated zone
+ * append operations are turned into regular writes at the zone write pointer.
+ * Called with the plug lock held. Returns false if @bio must be failed.
+ */
+static bool blk_zone_wplug_prepare_bio(struct blk_zone_wplug *plug,
+				       struct bio *bio)
+{
+	unsigned int nr_sectors = bio_sectors(bio);
+
+	if (bio_op(bio) == REQ_OP_ZONE_APPEND) {
+		if (plug->flags & BLK_ZONE_WPLUG_NEED_WP_UPDATE ||
+		    plug->wp_offset + nr_sectors > plug->capacity)
+			return false;
+
+		bio->bi_opf = (bio->bi_opf & ~REQ_OP_MASK) | REQ_OP_WRITE;
+		bio->bi_iter.bi_sector += plug->wp_offset;
+		plug->append_offset = plug->wp_offset;
+		plug->flags |= BLK_ZONE_WPLUG_APPEND;
+	}
+
+	plug->wp_offset = bio->bi_iter.bi_sector - blk_zone_wplug_start(plug) +
+		nr_sectors;
+	plug->inflight = bio;
+
+	return true;
+}
+
+static void blk_zone_wplug_work(struct work_struct *work)
+{
+	struct blk_zone_wplug *plug =
+		container_of(work, struct blk_zone_wplug, work);
+	unsigned long flags;
+	struct bio *bio;
+
+	if (plug->flags & BLK_ZONE_WPLUG_NEED_WP_UPDATE)
+		blk_zone_wplug_refresh_wp(plug);
+
+again:
+	spin_lock_irqsave(&plug->lock, flags);
+	/* The completion of the in-flight write reschedules us */
+	if (plug->inflight) {
+		spin_unlock_irqrestore(&plug->lock, flags);
+		return;
+	}
+
+	bio = bio_list_pop(&plug->bio_list);
+	if (!bio) {
+		spin_unlock_irqrestore(&plug->lock, flags);
+		return;
+	}
+
+	if (!blk_zone_wplug_prepare_bio(plug, bio)) {
+		spin_unlock_irqrestore(&plug->lock, flags);
+		bio_io_error(bio);
+		goto again;
+	}
+	spin_unlock_irqrestore(&plug->lock, flags);
+
+	submit_bio_noacct_nocheck(bio);
+}
+
+static void blk_zone_wplugs_update(struct request_queue *q, enum req_opf op,
+				   sector_t sector)
+{
+	unsigned int zno, start = 0, end = q->nr_zones;
+	struct blk_zone_wplug *plug;
+	unsigned long flags;
+
+	if (op != REQ_OP_ZONE_RESET_ALL) {
+		start = blk_queue_zone_no(q, sector);
+		end = start + 1;
+	}
+
+	for (zno = start; zno < end; zno++) {
+		if (!blk_queue_zone_is_seq(q, blk_queue_zone_sectors(q) * zno))
+			continue;
+
+		plug = &q->zone_wplugs[zno];
+		spin_lock_irqsave(&plug->lock, flags);
+		plug->wp_offset = op == REQ_OP_ZONE_FINISH ? plug->capacity : 0;
+		plug->flags &= ~BLK_ZONE_WPLUG_NEED_WP_UPDATE;
+		spin_unlock_irqrestore(&plug->lock, flags);
+	}
+}
+
+/**
+ * __blk_zone_plug_bio - zone write plug a bio
+ * @bio:	The bio being submitted
+ *
+ * Called from blk_mq_submit_bio() after the bio has been split. Writes to a
+ * sequential zone that already has a write in flight are added to the zone
+ * plug and issued once the previous write completes. The zone write pointer
+ * offset is tracked across zone resets and finishes so that zone append
+ * operations can be emulated. Returns true if the bio was plugged or
+ * completed, in which case the caller must not issue it.
+ */
+bool __blk_zone_plug_bio(struct bio *bio)
+{
+	struct request_queue *q = bdev_get_queue(bio->bi_bdev);
+	sector_t sector = bio->bi_iter.bi_sector;
+	struct blk_zone_wplug *plug;
+	unsigned long flags;
+
+	switch (bio_op(bio)) {
+	case REQ_OP_ZONE_RESET:
+	case REQ_OP_ZONE_RESET_ALL:
+	case REQ_OP_ZONE_FINISH:
+		blk_zone_wplugs_update(q, bio_op(bio), sector);
+		return false;
+	case REQ_OP_ZONE_APPEND:
+		if (!blk_queue_emulates_zone_append(q))
+			return false;
+		break;
+	case REQ_OP_WRITE:
+	case REQ_OP_WRITE_ZEROES:
+		break;
+	default:
+		return false;
+	}
+
+	if (!bio_sectors(bio) || !blk_queue_zone_is_seq(q, sector))
+		return false;
+
+	plug = &q->zone_wplugs[blk_queue_zone_no(q, sector)];
+	spin_lock_irqsave(&plug->lock, flags);
+
+	/* Plugged bio being issued by blk_zone_wplug_work() */
+	if (plug->inflight == bio) {
+		spin_unlock_irqrestore(&plug->lock, flags);
+		return false;
+	}
+
+	if (plug->inflight || !bio_list_empty(&plug->bio_list) ||
+	    (bio_op(bio) == REQ_OP_ZONE_APPEND &&
+	     plug->flags & BLK_ZONE_WPLUG_NEED_WP_UPDATE)) {
+		/*
+		 * The bio is issued later from a work item, which can neither
+		 * poll for it nor report EAGAIN to the submitter.
+		 */
+		bio_clear_hipri(bio);
+		bio->bi_opf &= ~REQ_NOWAIT;
+		bio_list_add(&plug->bio_list, bio);
+		if (!plug->inflight)
+			kblockd_schedule_work(&plug->work);
+		spin_unlock_irqrestore(&plug->lock, flags);
+		return true;
+	}
+
+	if (!blk_zone_wplug_prepare_bio(plug, bio)) {
+		spin_unlock_irqrestore(&plug->lock, flags);
+		bio_io_error(bio);
+		return true;
+	}
+	spin_unlock_irqrestore(&plug->lock, flags);
+
+	return false;
+}
+
+/*
+ * Called from bio_endio() for zoned queues with zone write plugs: release the
+ * zone write plug if @bio is its in-flight write and kick the next plugged
+ * write.
+ */
+void __blk_zone_write_plug_bio_endio(struct bio *bio)
+{
+	struct request_queue *q = bdev_get_queue(bio->bi_bdev);
+	struct blk_zone_wplug *plugs = READ_ONCE(q->zone_wplugs);
+	sector_t sector = bio->bi_iter.bi_sector;
+	struct blk_zone_wplug *plug;
+	unsigned long flags;
+	unsigned int zno;
+
+	if (!plugs ||
+	    (bio_op(bio) != REQ_OP_WRITE && bio_op(bio) != REQ_OP_WRITE_ZEROES))
+		return;
+
+	/* A fully completed bio has been advanced to the end of its range */
+	if (!bio->bi_iter.bi_size) {
+		if (!sector)
+			return;
+		sector--;
+	}
+	zno = blk_queue_zone_no(q, sector);
+	if (zno >= q->nr_zones)
+		return;
+
+	plug = &plugs[zno];
+	if (READ_ONCE(plug->inflight) != bio)
+		return;
+
+	spin_lock_irqsave(&plug->lock, flags);
+	if (plug->flags & BLK_ZONE_WPLUG_APPEND) {
+		bio->bi_opf = (bio->bi_opf & ~REQ_OP_MASK) | REQ_OP_ZONE_APPEND;
+		bio->bi_iter.bi_sector = blk_zone_wplug_start(plug) +
+			plug->append_offset;
+		plug->flags &= ~BLK_ZONE_WPLUG_APPEND;
+	}
+	if (bio->bi_status)
+		plug->flags |= BLK_ZONE_WPLUG_NEED_WP_UPDATE;
+	plug->inflight = NULL;
+	if (!bio_list_empty(&plug->bio_list))
+		kblockd_schedule_work(&plug->work);
+	spin_unlock_irqrestore(&plug->lock, flags);
+}
+
+static struct blk_zone_wplug *blk_alloc_zone_wplugs(struct request_queue *q,
+						    unsigned int nr_zones)
+{
+	struct blk_zone_wplug *plugs;
+	unsigned int i;
+
+	plugs = kvcalloc(nr_zones, sizeof(*plugs), GFP_KERNEL);
+	if (!plugs)
+		return NULL;
+
+	for (i = 0; i < nr_zones; i++) {
+		spin_lock_init(&plugs[i].lock);
+		bio_list_init(&plugs[i].bio_list);
+		INIT_WORK(&plugs[i].work, blk_zone_wplug_work);
+		plugs[i].q = q;
+	}
+
+	return plugs;
+}
+
+/*
+ * Free a zone write plug array that is no longer referenced by the queue,
+ * failing any write still plugged. Must not be called with the queue frozen.
+ */
+static void blk_free_zone_wplugs(struct blk_zone_wplug *plugs,
+				 unsigned int nr_zones)
+{
+	struct bio_list bios = BIO_EMPTY_LIST;
+	struct bio *bio;
+	unsigned int i;
+
+	if (!plugs)
+		return;
+
+	for (i = 0; i < nr_zones; i++) {
+		cancel_work_sync(&plugs[i].work);
+		spin_lock_irq(&plugs[i].lock);
+		bio_list_merge(&bios, &plugs[i].bio_list);
+		bio_list_init(&plugs[i].bio_list);
+		spin_unlock_irq(&plugs[i].lock);
+	}
+
+	while ((bio = bio_list_pop(&bios)))
+		bio_io_error(bio);
+
+	kvfree(plugs);
+}
+
+static void blk_update_zone_wplugs(struct blk_zone_wplug *plugs,
+				   struct blk_zone_wplug *new_plugs,
+				   unsigned int nr_zones)
+{
+	unsigned int i;
+
+	for (i = 0; i < nr_zones; i++) {
+		spin_lock_irq(&plugs[i].lock);
+		plugs[i].wp_offset = new_plugs[i].wp_offset;
+		plugs[i].capacity = new_plugs[i].capacity;
+		plugs[i].flags &= ~BLK_ZONE_WPLUG_NEED_WP_UPDATE;
+		spin_unlock_irq(&plugs[i].lock);
+	}
+}
+
+void blk_queue_free_zone_wplugs(struct request_queue *q)
+{
+	blk_free_zone_wplugs(q->zone_wplugs, q->nr_zones);
+	q->zone_wplugs = NULL;
+}
+
 void blk_queue_free_zone_bitmaps(struct request_queue *q)
 {
 	kfree(q->conv_zones_bitmap);
@@ -469,6 +824,7 @@ struct blk_revalidate_zone_args {
 	struct gendisk	*disk;
 	unsigned long	*conv_zones_bitmap;
 	unsigned long	*seq_zones_wlock;
+	struct blk_zone_wplug *zone_wplugs;
 	unsigned int	nr_zones;
 	sector_t	zone_sectors;
 	sector_t	sector;
@@ -538,6 +894,13 @@ static int blk_revalidate_zone_cb(struct blk_zone *zone, unsigned int idx,
 			if (!args->seq_zones_wlock)
 				return -ENOMEM;
 		}
+		if (!args->zone_wplugs) {
+			args->zone_wplugs =
+				blk_alloc_zone_wplugs(q, args->nr_zones);
+			if (!args->zone_wplugs)
+				return -ENOMEM;
+		}
+		blk_zone_wplug_set_wp(&args->zone_wplugs[idx], zone);
 		break;
 	default:
 		pr_warn("%s: Invalid zone type 0x%x at sectors %llu\n",
@@ -570,7 +933,7 @@ int blk_revalidate_disk_zones(struct gendisk *disk,
 	struct blk_revalidate_zone_args args = {
 		.disk		= disk,
 	};
-	unsigned int noio_flag;
+	unsigned int noio_flag, nr_wplugs;
 	int ret;
 
 	if (WARN_ON_ONCE(!blk_queue_is_zoned(q)))
@@ -609,9 +972,23 @@ int blk_revalidate_disk_zones(struct gendisk *disk,
 	 * stopped and all I/Os are completed (i.e. a scheduler is not
 	 * referencing the bitmaps).
 	 */
+	nr_wplugs = args.nr_zones;
 	blk_mq_freeze_queue(q);
 	if (ret > 0) {
 		blk_queue_chunk_sectors(q, args.zone_sectors);
+		if (q->zone_wplugs && args.zone_wplugs &&
+		    q->nr_zones == args.nr_zones) {
+			/*
+			 * Plugged writes do not hold a queue reference, so keep
+			 * the current zone write plugs and only refresh their
+			 * write pointers.
+			 */
+			blk_update_zone_wplugs(q->zone_wplugs, args.zone_wplugs,
+					       args.nr_zones);
+		} else {
+			swap(q->zone_wplugs, args.zone_wplugs);
+			nr_wplugs = q->nr_zones;
+		}
 		q->nr_zones = args.nr_zones;
 		swap(q->seq_zones_wlock, args.seq_zones_wlock);
 		swap(q->conv_zones_bitmap, args.conv_zones_bitmap);
@@ -624,6 +1001,7 @@ int blk_revalidate_disk_zones(struct gendisk *disk,
 	}
 	blk_mq_unfreeze_queue(q);
 
+	blk_free_zone_wplugs(args.zone_wplugs, nr_wplugs);
 	kfree(args.seq_zones_wlock);
 	kfree(args.conv_zones_bitmap);
 	return ret;
@@ -632,9 +1010,15 @@ EXPORT_SYMBOL_GPL(blk_revalidate_disk_zones);
 
 void blk_queue_clear_zone_settings(struct request_queue *q)
 {
+	struct blk_zone_wplug *zone_wplugs;
+	unsigned int nr_zones;
+
 	blk_mq_freeze_queue(q);
 
 	blk_queue_free_zone_bitmaps(q);
+	zone_wplugs = q->zone_wplugs;
+	nr_zones = q->nr_zones;
+	q->zone_wplugs = NULL;
 	blk_queue_flag_clear(QUEUE_FLAG_ZONE_RESETALL, q);
 	q->required_elevator_features &= ~ELEVATOR_F_ZBD_SEQ_WRITE;
 	q->nr_zones = 0;
@@ -645,4 +1029,6 @@ void blk_queue_clear_zone_settings(struct request_queue *q)
 	q->limits.max_zone_append_sectors = 0;
 
 	blk_mq_unfreeze_queue(q);
+
+	blk_free_zone_wplugs(zone_wplugs, nr_zones);
 }
@@ -227,6 +227,7 @@ ssize_t part_timeout_store(struct device *, struct device_attribute *,
 				const char *, size_t);
 
 void __blk_queue_split(struct bio **bio, unsigned int *nr_segs);
+void submit_bio_noacct_nocheck(struct bio *bio);
 int ll_back_merge_fn(struct request *req, struct bio *bio,
 		unsigned int nr_segs);
 bool blk_attempt_req_merge(struct request_queue *q, struct request *rq,
@@ -291,33 +292,6 @@ void ioc_clear_queue(struct request_queue *q);
 
 int create_task_io_context(struct task_struct *task, gfp_t gfp_mask, int node);
 
-/*
- * Internal throttling interface
- */
-#ifdef CONFIG_BLK_DEV_THROTTLING
-extern int blk_throtl_init(struct request_queue *q);
-extern void blk_throtl_exit(struct request_queue *q);
-extern void blk_throtl_register_queue(struct request_queue *q);
-extern void blk_throtl_charge_bio_split(struct bio *bio);
-bool blk_throtl_bio(struct bio *bio);
-#else /* CONFIG_BLK_DEV_THROTTLING */
-static inline int blk_throtl_init(struct request_queue *q) { return 0; }
-static inline void blk_throtl_exit(struct request_queue *q) { }
-static inline void blk_throtl_register_queue(struct request_queue *q) { }
-static inline void blk_throtl_charge_bio_split(struct bio *bio) { }
-static inline bool blk_throtl_bio(struct bio *bio) { return false; }
-#endif /* CONFIG_BLK_DEV_THROTTLING */
-#ifdef CONFIG_BLK_DEV_THROTTLING_LOW
-extern ssize_t blk_throtl_sample_time_show(struct request_queue *q, char *page);
-extern ssize_t blk_throtl_sample_time_store(struct request_queue *q,
-	const char *page, size_t count);
-extern void blk_throtl_bio_endio(struct bio *bio);
-extern void blk_throtl_stat_add(struct request *rq, u64 time);
-#else
-static inline void blk_throtl_bio_endio(struct bio *bio) { }
-static inline void blk_throtl_stat_add(struct request *rq, u64 time) { }
-#endif
-
 void __blk_queue_bounce(struct request_queue *q, struct bio **bio);
 
 static inline bool blk_queue_may_bounce(struct request_queue *q)
@@ -343,10 +317,32 @@ struct bio *blk_next_bio(struct bio *bio, unsigned int nr_pages, gfp_t gfp);
 
 #ifdef CONFIG_BLK_DEV_ZONED
 void blk_queue_free_zone_bitmaps(struct request_queue *q);
+void blk_queue_free_zone_wplugs(struct request_queue *q);
 void blk_queue_clear_zone_settings(struct request_queue *q);
+bool __blk_zone_plug_bio(struct bio *bio);
+void __blk_zone_write_plug_bio_endio(struct bio *bio);
+
+static inline bool blk_zone_plug_bio(struct bio *bio)
+{
+	if (!bdev_get_queue(bio->bi_bdev)->zone_wplugs)
+		return false;
+	return __blk_zone_plug_bio(bio);
+}
+
+static inline void blk_zone_write_plug_bio_endio(struct bio *bio)
+{
+	if (bio->bi_bdev && bdev_get_queue(bio->bi_bdev)->zone_wplugs)
+		__blk_zone_write_plug_bio_endio(bio);
+}
 #else
 static inline void blk_queue_free_zone_bitmaps(struct request_queue *q) {}
+static inline void blk_queue_free_zone_wplugs(struct request_queue *q) {}
 static inline void blk_queue_clear_zone_settings(struct request_queue *q) {}
+static inline bool blk_zone_plug_bio(struct bio *bio)
+{
+	return false;
+}
+static inline void blk_zone_write_plug_bio_endio(struct bio *bio) {}
 #endif
 
 int blk_alloc_ext_minor(void);
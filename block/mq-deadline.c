@@ -101,6 +101,24 @@ struct deadline_data {
 
 	spinlock_t lock;
 	spinlock_t zone_lock;
+
+	/*
+	 * Requests are staged here by the insert path, which only takes
+	 * insert_lock, and moved into the sort/fifo lists under lock by the
+	 * next dispatch or bio merge attempt.
+	 */
+	struct {
+		spinlock_t lock;
+		struct list_head at_head;
+		struct list_head at_tail;
+	} insert ____cacheline_aligned_in_smp;
+
+	/* DD_DISPATCHING: a CPU is in dd_dispatch_request() */
+	unsigned long run_state;
+};
+
+enum {
+	DD_DISPATCHING	= 0,
 };
 
 /* Count one event of type 'event_type' and with I/O priority 'prio' */
@@ -524,6 +542,8 @@ static struct request *__dd_dispatch_request(struct deadline_data *dd,
 	return rq;
 }
 
+static void dd_do_insert(struct request_queue *q);
+
 /*
  * Called from blk_mq_run_hw_queue() -> __blk_mq_sched_dispatch_requests().
  *
@@ -538,12 +558,25 @@ static struct request *dd_dispatch_request(struct blk_mq_hw_ctx *hctx)
 	struct request *rq;
 	enum dd_prio prio;
 
+	/*
+	 * If another CPU is already dispatching, let it do the work instead
+	 * of piling up on dd->lock. Returning NULL makes
+	 * blk_mq_do_dispatch_sched() rerun the queue later if nothing got
+	 * dispatched, and the CPU that is dispatching keeps going for as long
+	 * as dd_has_work() says there is work, including what we inserted.
+	 */
+	if (test_bit(DD_DISPATCHING, &dd->run_state) ||
+	    test_and_set_bit_lock(DD_DISPATCHING, &dd->run_state))
+		return NULL;
+
 	spin_lock(&dd->lock);
+	dd_do_insert(hctx->queue);
 	for (prio = 0; prio <= DD_PRIO_MAX; prio++) {
 		rq = __dd_dispatch_request(dd, &dd->per_prio[prio]);
 		if (rq)
 			break;
 	}
+	clear_bit_unlock(DD_DISPATCHING, &dd->run_state);
 	spin_unlock(&dd->lock);
 
 	return rq;
@@ -598,6 +631,8 @@ static void dd_exit_sched(struct elevator_queue *e)
 		WARN_ON_ONCE(!list_empty(&per_prio->fifo_list[DD_READ]));
 		WARN_ON_ONCE(!list_empty(&per_prio->fifo_list[DD_WRITE]));
 	}
+	WARN_ON_ONCE(!list_empty(&dd->insert.at_head));
+	WARN_ON_ONCE(!list_empty(&dd->insert.at_tail));
 
 	free_percpu(dd->stats);
 
@@ -646,6 +681,9 @@ static int dd_init_sched(struct request_queue *q, struct elevator_type *e)
 	dd->fifo_batch = fifo_batch;
 	spin_lock_init(&dd->lock);
 	spin_lock_init(&dd->zone_lock);
+	spin_lock_init(&dd->insert.lock);
+	INIT_LIST_HEAD(&dd->insert.at_head);
+	INIT_LIST_HEAD(&dd->insert.at_tail);
 
 	q->elevator = eq;
 	return 0;
@@ -702,6 +740,8 @@ static bool dd_bio_merge(struct request_queue *q, struct bio *bio,
 	bool ret;
 
 	spin_lock(&dd->lock);
+	/* staged requests must be visible for merging */
+	dd_do_insert(q);
 	ret = blk_mq_sched_try_merge(q, bio, nr_segs, &free);
 	spin_unlock(&dd->lock);
 
@@ -714,10 +754,9 @@ static bool dd_bio_merge(struct request_queue *q, struct bio *bio,
 /*
  * add rq to rbtree and fifo
  */
-static void dd_insert_request(struct blk_mq_hw_ctx *hctx, struct request *rq,
+static void dd_insert_request(struct request_queue *q, struct request *rq,
 			      bool at_head)
 {
-	struct request_queue *q = hctx->queue;
 	struct deadline_data *dd = q->elevator->elevator_data;
 	const enum dd_data_dir data_dir = rq_data_dir(rq);
 	u16 ioprio = req_get_ioprio(rq);
@@ -765,23 +804,79 @@ static void dd_insert_request(struct blk_mq_hw_ctx *hctx, struct request *rq,
 	}
 }
 
+/*
+ * Move the requests staged by dd_insert_requests() into the scheduler lists.
+ */
+static void dd_do_insert(struct request_queue *q)
+{
+	struct deadline_data *dd = q->elevator->elevator_data;
+	struct request *rq;
+	LIST_HEAD(at_head);
+	LIST_HEAD(at_tail);
+
+	lockdep_assert_held(&dd->lock);
+
+	if (list_empty_careful(&dd->insert.at_head) &&
+	    list_empty_careful(&dd->insert.at_tail))
+		return;
+
+	spin_lock(&dd->insert.lock);
+	list_splice_init(&dd->insert.at_head, &at_head);
+	list_splice_init(&dd->insert.at_tail, &at_tail);
+	spin_unlock(&dd->insert.lock);
+
+	while (!list_empty(&at_head)) {
+		rq = list_first_entry(&at_head, struct request, queuelist);
+		list_del_init(&rq->queuelist);
+		dd_insert_request(q, rq, true);
+	}
+
+	while (!list_empty(&at_tail)) {
+		rq = list_first_entry(&at_tail, struct request, queuelist);
+		list_del_init(&rq->queuelist);
+		dd_insert_request(q, rq, false);
+	}
+}
+
 /*
  * Called from blk_mq_sched_insert_request() or blk_mq_sched_insert_requests().
+ *
+ * Only stage the requests here, so that the insert path never contends on
+ * dd->lock with dispatching.
  */
 static void dd_insert_requests(struct blk_mq_hw_ctx *hctx,
 			       struct list_head *list, bool at_head)
 {
 	struct request_queue *q = hctx->queue;
 	struct deadline_data *dd = q->elevator->elevator_data;
+	struct request *rq;
+	unsigned long flags;
+
+	if (!blk_queue_is_zoned(q)) {
+		spin_lock(&dd->insert.lock);
+		list_splice_tail_init(list, at_head ? &dd->insert.at_head :
+							&dd->insert.at_tail);
+		spin_unlock(&dd->insert.lock);
+		return;
+	}
 
+	/*
+	 * This may be a requeue of write requests that have locked their
+	 * target zones. Release the zone locks and stage the requests under
+	 * dd->lock, so that dispatch never sees a zone unlocked before the
+	 * requeued write to it is back in the fifo, which would let a later
+	 * write to that zone overtake it.
+	 */
 	spin_lock(&dd->lock);
-	while (!list_empty(list)) {
-		struct request *rq;
+	spin_lock_irqsave(&dd->zone_lock, flags);
+	list_for_each_entry(rq, list, queuelist)
+		blk_req_zone_write_unlock(rq);
+	spin_unlock_irqrestore(&dd->zone_lock, flags);
 
-		rq = list_first_entry(list, struct request, queuelist);
-		list_del_init(&rq->queuelist);
-		dd_insert_request(hctx, rq, at_head);
-	}
+	spin_lock(&dd->insert.lock);
+	list_splice_tail_init(list, at_head ? &dd->insert.at_head :
+						&dd->insert.at_tail);
+	spin_unlock(&dd->insert.lock);
 	spin_unlock(&dd->lock);
 }
 
@@ -796,6 +891,11 @@ static bool dd_has_write_work(struct blk_mq_hw_ctx *hctx)
 	struct deadline_data *dd = hctx->queue->elevator->elevator_data;
 	enum dd_prio p;
 
+	/* staged requests have not been sorted by direction yet */
+	if (!list_empty_careful(&dd->insert.at_head) ||
+	    !list_empty_careful(&dd->insert.at_tail))
+		return true;
+
 	for (p = 0; p <= DD_PRIO_MAX; p++)
 		if (!list_empty_careful(&dd->per_prio[p].fifo_list[DD_WRITE]))
 			return true;
@@ -859,6 +959,10 @@ static bool dd_has_work(struct blk_mq_hw_ctx *hctx)
 	struct deadline_data *dd = hctx->queue->elevator->elevator_data;
 	enum dd_prio prio;
 
+	if (!list_empty_careful(&dd->insert.at_head) ||
+	    !list_empty_careful(&dd->insert.at_tail))
+		return true;
+
 	for (prio = 0; prio <= DD_PRIO_MAX; prio++)
 		if (dd_has_work_for_prio(&dd->per_prio[prio]))
 			return true;
@@ -31,6 +31,10 @@ static unsigned int cryptd_max_cpu_qlen = 1000;
 module_param(cryptd_max_cpu_qlen, uint, 0);
 MODULE_PARM_DESC(cryptd_max_cpu_qlen, "Set cryptd Max queue depth");
 
+static unsigned int cryptd_max_batch = 16;
+module_param(cryptd_max_batch, uint, 0644);
+MODULE_PARM_DESC(cryptd_max_batch, "Max requests handled per cryptd work run");
+
 static struct workqueue_struct *cryptd_wq;
 
 struct cryptd_cpu_queue {
@@ -156,29 +160,37 @@ static int cryptd_enqueue_request(struct cryptd_queue *queue,
 	return err;
 }
 
-/* Called in workqueue context, do one real cryption work (via
- * req->complete) and reschedule itself if there are more work to
- * do. */
+/* Called in workqueue context, do up to cryptd_max_batch real cryption
+ * works (via req->complete) and reschedule itself if there are more work
+ * to do. */
 static void cryptd_queue_worker(struct work_struct *work)
 {
 	struct cryptd_cpu_queue *cpu_queue;
 	struct crypto_async_request *req, *backlog;
+	unsigned int batch = max(READ_ONCE(cryptd_max_batch), 1U);
 
 	cpu_queue = container_of(work, struct cryptd_cpu_queue, work);
 	/*
-	 * Only handle one request at a time to avoid hogging crypto workqueue.
+	 * Drain a bounded batch of requests per run: a burst of small
+	 * requests then costs one work item dispatch rather than one per
+	 * request, while the bound keeps us from hogging crypto workqueue.
 	 */
-	local_bh_disable();
-	backlog = crypto_get_backlog(&cpu_queue->queue);
-	req = crypto_dequeue_request(&cpu_queue->queue);
-	local_bh_enable();
+	while (batch--) {
+		local_bh_disable();
+		backlog = crypto_get_backlog(&cpu_queue->queue);
+		req = crypto_dequeue_request(&cpu_queue->queue);
+		local_bh_enable();
 
-	if (!req)
-		return;
+		if (!req)
+			return;
 
-	if (backlog)
-		backlog->complete(backlog, -EINPROGRESS);
-	req->complete(req, 0);
+		if (backlog)
+			backlog->complete(backlog, -EINPROGRESS);
+		req->complete(req, 0);
+
+		/* the batch can be large, do not starve other tasks */
+		cond_resched();
+	}
 
 	if (cpu_queue->queue.qlen)
 		queue_work(cryptd_wq, &cpu_queue->work);
@@ -60,6 +60,7 @@ static bool initcalls_done;
 /* Save the async probe drivers' name from kernel cmdline */
 #define ASYNC_DRV_NAMES_MAX_LEN	256
 static char async_probe_drv_names[ASYNC_DRV_NAMES_MAX_LEN];
+static bool async_probe_default;
 
 /*
  * In some cases, like suspend to RAM or hibernation, It might be reasonable
@@ -800,16 +801,27 @@ static int driver_probe_device(struct device_driver *drv, struct device *dev)
 
 static inline bool cmdline_requested_async_probing(const char *drv_name)
 {
-	return parse_option_str(async_probe_drv_names, drv_name);
+	bool async_drv;
+
+	/* With "*", the listed drivers are the ones to probe synchronously */
+	async_drv = parse_option_str(async_probe_drv_names, drv_name);
+
+	return async_probe_default != async_drv;
 }
 
-/* The option format is "driver_async_probe=drv_name1,drv_name2,..." */
+/*
+ * The option format is "driver_async_probe=drv_name1,drv_name2,...".
+ * A "*" entry makes asynchronous probing the default for all drivers that
+ * do not force synchronous probing, except for the other drivers listed.
+ */
 static int __init save_async_options(char *buf)
 {
 	if (strlen(buf) >= ASYNC_DRV_NAMES_MAX_LEN)
 		pr_warn("Too long list of driver names for 'driver_async_probe'!\n");
 
 	strlcpy(async_probe_drv_names, buf, ASYNC_DRV_NAMES_MAX_LEN);
+	async_probe_default = parse_option_str(async_probe_drv_names, "*");
+
 	return 1;
 }
 __setup("driver_async_probe=", save_async_options);
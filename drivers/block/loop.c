@@ -133,6 +133,7 @@ static void loop_global_unlock(struct loop_device *lo, bool global)
 
 static int max_part;
 static int part_shift;
+static bool direct_io;
 
 static int transfer_xor(struct loop_device *lo, int cmd,
 			struct page *raw_page, unsigned raw_off,
@@ -1256,6 +1257,13 @@ static int loop_configure(struct loop_device *lo, fmode_t mode,
 	    !file->f_op->write_iter)
 		lo->lo_flags |= LO_FLAGS_READ_ONLY;
 
+	/*
+	 * Ask for direct I/O as if userspace had, loop_update_dio() drops it
+	 * again if the offset or block size don't allow it.
+	 */
+	if (direct_io)
+		lo->lo_flags |= LO_FLAGS_DIRECT_IO;
+
 	lo->workqueue = alloc_workqueue("loop%d",
 					WQ_UNBOUND | WQ_FREEZABLE,
 					0,
@@ -1288,7 +1296,8 @@ static int loop_configure(struct loop_device *lo, fmode_t mode,
 
 	if (config->block_size)
 		bsize = config->block_size;
-	else if ((lo->lo_backing_file->f_flags & O_DIRECT) && inode->i_sb->s_bdev)
+	else if (((lo->lo_backing_file->f_flags & O_DIRECT) ||
+		  (lo->lo_flags & LO_FLAGS_DIRECT_IO)) && inode->i_sb->s_bdev)
 		/* In case of direct I/O, match underlying block size */
 		bsize = bdev_logical_block_size(inode->i_sb->s_bdev);
 	else
@@ -2122,6 +2131,8 @@ module_param(max_loop, int, 0444);
 MODULE_PARM_DESC(max_loop, "Maximum number of loop devices");
 module_param(max_part, int, 0444);
 MODULE_PARM_DESC(max_part, "Maximum number of partitions per loop device");
+module_param(direct_io, bool, 0644);
+MODULE_PARM_DESC(direct_io, "Use direct I/O to the backing file whenever alignment allows, avoiding double caching (default: false)");
 MODULE_LICENSE("GPL");
 MODULE_ALIAS_BLOCKDEV_MAJOR(LOOP_MAJOR);
 
@@ -358,6 +358,34 @@ static blk_status_t virtio_queue_rq(struct blk_mq_hw_ctx *hctx,
 	return BLK_STS_OK;
 }
 
+/*
+ * Queue a plug list, notifying the device once per virtqueue instead of once
+ * per request.
+ */
+static void virtio_queue_rqs(struct list_head *rqlist)
+{
+	struct request *req, *next;
+	LIST_HEAD(requeue_list);
+
+	list_for_each_entry_safe(req, next, rqlist, queuelist) {
+		struct blk_mq_hw_ctx *hctx = req->mq_hctx;
+		struct blk_mq_queue_data bd = {
+			.rq	= req,
+			.last	= list_entry_is_head(next, rqlist, queuelist) ||
+				  next->mq_hctx != hctx,
+		};
+
+		list_del_init(&req->queuelist);
+		if (virtio_queue_rq(hctx, &bd) != BLK_STS_OK) {
+			list_add_tail(&req->queuelist, &requeue_list);
+			if (bd.last)
+				virtio_commit_rqs(hctx);
+		}
+	}
+
+	list_splice(&requeue_list, rqlist);
+}
+
 /* return id (s/n) string for *disk to *id_str
  */
 static int virtblk_get_id(struct gendisk *disk, char *id_str)
@@ -725,6 +753,7 @@ static int virtblk_map_queues(struct blk_mq_tag_set *set)
 
 static const struct blk_mq_ops virtio_mq_ops = {
 	.queue_rq	= virtio_queue_rq,
+	.queue_rqs	= virtio_queue_rqs,
 	.commit_rqs	= virtio_commit_rqs,
 	.complete	= virtblk_request_done,
 	.map_queues	= virtblk_map_queues,
@@ -312,6 +312,11 @@ static int menu_select(struct cpuidle_driver *drv, struct cpuidle_device *dev,
 	predicted_ns = (u64)min(predicted_us,
 				get_typical_interval(data, predicted_us)) *
 				NSEC_PER_USEC;
+	/*
+	 * The scheduler may know of a task wakeup coming in before any of
+	 * the above, so take its expectation into account too.
+	 */
+	predicted_ns = min(predicted_ns, sched_idle_wakeup_ns(dev->cpu));
 
 	if (tick_nohz_tick_stopped()) {
 		/*
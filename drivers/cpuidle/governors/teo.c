@@ -105,6 +105,7 @@
 #include <linux/jiffies.h>
 #include <linux/kernel.h>
 #include <linux/sched/clock.h>
+#include <linux/sched/stat.h>
 #include <linux/tick.h>
 
 /*
@@ -298,6 +299,7 @@ static int teo_select(struct cpuidle_driver *drv, struct cpuidle_device *dev,
 	bool alt_intercepts, alt_recent;
 	ktime_t delta_tick;
 	s64 duration_ns;
+	u64 wakeup_ns;
 	int i;
 
 	if (dev->last_state_idx >= 0) {
@@ -310,6 +312,15 @@ static int teo_select(struct cpuidle_driver *drv, struct cpuidle_device *dev,
 	duration_ns = tick_nohz_get_sleep_length(&delta_tick);
 	cpu_data->sleep_length_ns = duration_ns;
 
+	/*
+	 * A task wakeup expected by the scheduler shortens the idle duration
+	 * just like a timer would. Keep sleep_length_ns as is, though, the
+	 * metrics are about timers.
+	 */
+	wakeup_ns = sched_idle_wakeup_ns(dev->cpu);
+	if (duration_ns > 0 && wakeup_ns < duration_ns)
+		duration_ns = wakeup_ns;
+
 	/* Check if there is any choice in the first place. */
 	if (drv->state_count < 2) {
 		idx = 0;
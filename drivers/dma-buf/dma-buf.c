@@ -15,6 +15,8 @@
 #include <linux/slab.h>
 #include <linux/dma-buf.h>
 #include <linux/dma-fence.h>
+#include <linux/dma-fence-array.h>
+#include <linux/sync_file.h>
 #include <linux/anon_inodes.h>
 #include <linux/export.h>
 #include <linux/debugfs.h>
@@ -361,6 +363,215 @@ static long dma_buf_set_name(struct dma_buf *dmabuf, const char __user *buf)
 	return ret;
 }
 
+#if IS_ENABLED(CONFIG_SYNC_FILE)
+/*
+ * Collapse @count fences into a single one, so that a consumer waits for
+ * all of them at once instead of installing one callback per fence.  Takes
+ * ownership of the @fences array and of the references it holds.
+ *
+ * Fences which already signalled are dropped, and dma_fence_arrays are
+ * replaced by their members, so that repeated imports and exports don't
+ * build ever deeper arrays.  Arrays are never nested by their creators,
+ * one level of unpacking is enough.
+ */
+static struct dma_fence *dma_buf_merge_fences(struct dma_fence **fences,
+					      unsigned int count)
+{
+	struct dma_fence_array *array;
+	struct dma_fence **flat;
+	struct dma_fence *fence;
+	unsigned int i, j, n = 0;
+
+	for (i = 0; i < count; i++) {
+		array = to_dma_fence_array(fences[i]);
+		n += array ? array->num_fences : 1;
+	}
+
+	flat = kmalloc_array(max(n, 1U), sizeof(*flat), GFP_KERNEL);
+	if (!flat) {
+		fence = NULL;
+		goto out_put;
+	}
+
+	n = 0;
+	for (i = 0; i < count; i++) {
+		array = to_dma_fence_array(fences[i]);
+		if (!array) {
+			if (!dma_fence_is_signaled(fences[i]))
+				flat[n++] = dma_fence_get(fences[i]);
+			continue;
+		}
+		for (j = 0; j < array->num_fences; j++) {
+			if (!dma_fence_is_signaled(array->fences[j]))
+				flat[n++] = dma_fence_get(array->fences[j]);
+		}
+	}
+
+	if (n <= 1) {
+		fence = n ? flat[0] : dma_fence_get_stub();
+		kfree(flat);
+		goto out_put;
+	}
+
+	array = dma_fence_array_create(n, flat, dma_fence_context_alloc(1),
+				       1, false);
+	if (!array) {
+		while (n--)
+			dma_fence_put(flat[n]);
+		kfree(flat);
+		fence = NULL;
+		goto out_put;
+	}
+	fence = &array->base;
+
+out_put:
+	while (count--)
+		dma_fence_put(fences[count]);
+	kfree(fences);
+	return fence;
+}
+
+static long dma_buf_export_sync_file(struct dma_buf *dmabuf,
+				     void __user *user_data)
+{
+	struct dma_buf_export_sync_file arg;
+	struct dma_fence **fences = NULL;
+	struct sync_file *sync_file;
+	struct dma_fence *fence;
+	unsigned int count = 0;
+	int ret, fd;
+
+	if (copy_from_user(&arg, user_data, sizeof(arg)))
+		return -EFAULT;
+
+	if (arg.flags & ~DMA_BUF_SYNC_RW)
+		return -EINVAL;
+
+	if ((arg.flags & DMA_BUF_SYNC_RW) == 0)
+		return -EINVAL;
+
+	fd = get_unused_fd_flags(O_CLOEXEC);
+	if (fd < 0)
+		return fd;
+
+	if (arg.flags & DMA_BUF_SYNC_WRITE) {
+		/* Writers have to wait for all readers and writers */
+		ret = dma_resv_get_fences(dmabuf->resv, NULL, &count, &fences);
+		if (ret)
+			goto err_put_fd;
+	} else {
+		/* Readers only have to wait for the last writer */
+		fence = dma_resv_get_excl_unlocked(dmabuf->resv);
+		if (fence) {
+			fences = kmalloc(sizeof(*fences), GFP_KERNEL);
+			if (!fences) {
+				dma_fence_put(fence);
+				ret = -ENOMEM;
+				goto err_put_fd;
+			}
+			fences[count++] = fence;
+		}
+	}
+
+	fence = dma_buf_merge_fences(fences, count);
+	if (!fence) {
+		ret = -ENOMEM;
+		goto err_put_fd;
+	}
+
+	sync_file = sync_file_create(fence);
+	dma_fence_put(fence);
+	if (!sync_file) {
+		ret = -ENOMEM;
+		goto err_put_fd;
+	}
+
+	arg.fd = fd;
+	if (copy_to_user(user_data, &arg, sizeof(arg))) {
+		ret = -EFAULT;
+		goto err_put_file;
+	}
+
+	fd_install(fd, sync_file->file);
+
+	return 0;
+
+err_put_file:
+	fput(sync_file->file);
+err_put_fd:
+	put_unused_fd(fd);
+	return ret;
+}
+
+static long dma_buf_import_sync_file(struct dma_buf *dmabuf,
+				     const void __user *user_data)
+{
+	struct dma_buf_import_sync_file arg;
+	struct dma_fence **fences, **tmp;
+	struct dma_fence *fence;
+	unsigned int count;
+	int ret;
+
+	if (copy_from_user(&arg, user_data, sizeof(arg)))
+		return -EFAULT;
+
+	if (arg.flags & ~DMA_BUF_SYNC_RW)
+		return -EINVAL;
+
+	if ((arg.flags & DMA_BUF_SYNC_RW) == 0)
+		return -EINVAL;
+
+	fence = sync_file_get_fence(arg.fd);
+	if (!fence)
+		return -EINVAL;
+
+	dma_resv_lock(dmabuf->resv, NULL);
+
+	if (!(arg.flags & DMA_BUF_SYNC_WRITE)) {
+		ret = dma_resv_reserve_shared(dmabuf->resv, 1);
+		if (!ret)
+			dma_resv_add_shared_fence(dmabuf->resv, fence);
+		dma_fence_put(fence);
+		goto out_unlock;
+	}
+
+	/*
+	 * Setting the exclusive fence drops all shared fences, so it has to
+	 * wait for them as well as for the imported fence.
+	 */
+	ret = dma_resv_get_fences(dmabuf->resv, NULL, &count, &fences);
+	if (ret) {
+		dma_fence_put(fence);
+		goto out_unlock;
+	}
+
+	tmp = krealloc(fences, (count + 1) * sizeof(*fences), GFP_KERNEL);
+	if (!tmp) {
+		while (count--)
+			dma_fence_put(fences[count]);
+		kfree(fences);
+		dma_fence_put(fence);
+		ret = -ENOMEM;
+		goto out_unlock;
+	}
+	fences = tmp;
+	fences[count++] = fence;
+
+	fence = dma_buf_merge_fences(fences, count);
+	if (!fence) {
+		ret = -ENOMEM;
+		goto out_unlock;
+	}
+
+	dma_resv_add_excl_fence(dmabuf->resv, fence);
+	dma_fence_put(fence);
+
+out_unlock:
+	dma_resv_unlock(dmabuf->resv);
+	return ret;
+}
+#endif
+
 static long dma_buf_ioctl(struct file *file,
 			  unsigned int cmd, unsigned long arg)
 {
@@ -404,6 +615,13 @@ static long dma_buf_ioctl(struct file *file,
 	case DMA_BUF_SET_NAME_B:
 		return dma_buf_set_name(dmabuf, (const char __user *)arg);
 
+#if IS_ENABLED(CONFIG_SYNC_FILE)
+	case DMA_BUF_IOCTL_EXPORT_SYNC_FILE:
+		return dma_buf_export_sync_file(dmabuf, (void __user *)arg);
+	case DMA_BUF_IOCTL_IMPORT_SYNC_FILE:
+		return dma_buf_import_sync_file(dmabuf, (const void __user *)arg);
+#endif
+
 	default:
 		return -ENOTTY;
 	}
@@ -37,15 +37,13 @@ rdma_dim_prof[RDMA_DIM_PARAMS_NUM_PROFILES] = {
 	{32,  0, 32, 0},
 };
 
-static void ib_cq_rdma_dim_work(struct work_struct *w)
+static void ib_cq_set_moderation(struct dim_irq_moder *m, int ix,
+				 struct dim_cq_moder moder)
 {
-	struct dim *dim = container_of(w, struct dim, work);
-	struct ib_cq *cq = dim->priv;
+	struct ib_cq *cq = m->dim.priv;
 
-	u16 usec = rdma_dim_prof[dim->profile_ix].usec;
-	u16 comps = rdma_dim_prof[dim->profile_ix].comps;
-
-	dim->state = DIM_START_MEASURE;
+	u16 usec = rdma_dim_prof[ix].usec;
+	u16 comps = rdma_dim_prof[ix].comps;
 
 	trace_cq_modify(cq, comps, usec);
 	cq->device->ops.modify_cq(cq, comps, usec);
@@ -53,23 +51,21 @@ static void ib_cq_rdma_dim_work(struct work_struct *w)
 
 static void rdma_dim_init(struct ib_cq *cq)
 {
-	struct dim *dim;
+	struct dim_irq_moder *dim;
 
 	if (!cq->device->ops.modify_cq || !cq->device->use_cq_dim ||
 	    cq->poll_ctx == IB_POLL_DIRECT)
 		return;
 
-	dim = kzalloc(sizeof(struct dim), GFP_KERNEL);
+	dim = kzalloc(sizeof(*dim), GFP_KERNEL);
 	if (!dim)
 		return;
 
-	dim->state = DIM_START_MEASURE;
-	dim->tune_state = DIM_GOING_RIGHT;
-	dim->profile_ix = RDMA_DIM_START_PROFILE;
-	dim->priv = cq;
+	dim_irq_moder_init(dim, DIM_IRQ_COMPLETIONS,
+			   DIM_CQ_PERIOD_MODE_START_FROM_EQE,
+			   ib_cq_set_moderation);
+	dim->dim.priv = cq;
 	cq->dim = dim;
-
-	INIT_WORK(&dim->work, ib_cq_rdma_dim_work);
 }
 
 static void rdma_dim_destroy(struct ib_cq *cq)
@@ -77,7 +73,7 @@ static void rdma_dim_destroy(struct ib_cq *cq)
 	if (!cq->dim)
 		return;
 
-	cancel_work_sync(&cq->dim->work);
+	dim_irq_moder_unregister(cq->dim);
 	kfree(cq->dim);
 }
 
@@ -152,7 +148,7 @@ static void ib_cq_completion_direct(struct ib_cq *cq, void *private)
 static int ib_poll_handler(struct irq_poll *iop, int budget)
 {
 	struct ib_cq *cq = container_of(iop, struct ib_cq, iop);
-	struct dim *dim = cq->dim;
+	struct dim_irq_moder *dim = cq->dim;
 	int completed;
 
 	completed = __ib_process_cq(cq, budget, cq->wc, IB_POLL_BATCH);
@@ -165,7 +161,7 @@ static int ib_poll_handler(struct irq_poll *iop, int budget)
 	}
 
 	if (dim)
-		rdma_dim(dim, completed);
+		dim_irq_moder_sample(dim, completed, 0);
 
 	return completed;
 }
@@ -187,7 +183,7 @@ static void ib_cq_poll_work(struct work_struct *work)
 	    ib_req_notify_cq(cq, IB_POLL_FLAGS) > 0)
 		queue_work(cq->comp_wq, &cq->work);
 	else if (cq->dim)
-		rdma_dim(cq->dim, completed);
+		dim_irq_moder_sample(cq->dim, completed, 0);
 }
 
 static void ib_cq_completion_workqueue(struct ib_cq *cq, void *private)
@@ -64,6 +64,26 @@ static int __init iommu_dma_forcedac_setup(char *str)
 }
 early_param("iommu.forcedac", iommu_dma_forcedac_setup);
 
+/*
+ * Flush queue tuning for non-strict mode: bigger per-CPU queues and a
+ * longer timeout let more unmaps share one IOTLB invalidation.  Zero keeps
+ * the IOVA library defaults.
+ */
+static unsigned int iommu_dma_fq_size __read_mostly;
+static unsigned int iommu_dma_fq_timeout __read_mostly;
+
+static int __init iommu_dma_fq_size_setup(char *str)
+{
+	return kstrtouint(str, 0, &iommu_dma_fq_size);
+}
+early_param("iommu.fq_size", iommu_dma_fq_size_setup);
+
+static int __init iommu_dma_fq_timeout_setup(char *str)
+{
+	return kstrtouint(str, 0, &iommu_dma_fq_timeout);
+}
+early_param("iommu.fq_timeout", iommu_dma_fq_timeout_setup);
+
 static void iommu_dma_entry_dtor(unsigned long data)
 {
 	struct page *freelist = (struct page *)data;
@@ -332,7 +352,8 @@ int iommu_dma_init_fq(struct iommu_domain *domain)
 		return 0;
 
 	ret = init_iova_flush_queue(&cookie->iovad, iommu_dma_flush_iotlb_all,
-				    iommu_dma_entry_dtor);
+				    iommu_dma_entry_dtor, iommu_dma_fq_size,
+				    iommu_dma_fq_timeout);
 	if (ret) {
 		pr_warn("iova flush queue initialization failed\n");
 		return ret;
@@ -455,7 +476,7 @@ static dma_addr_t iommu_dma_alloc_iova(struct iommu_domain *domain,
 	 * rounding up anything cacheable to make sure that can't happen. The
 	 * order of the unadjusted size will still match upon freeing.
 	 */
-	if (iova_len < (1 << (IOVA_RANGE_CACHE_MAX_SIZE - 1)))
+	if (iova_len < (1 << (iovad->rcache_max_size - 1)))
 		iova_len = roundup_pow_of_two(iova_len);
 
 	dma_limit = min_not_zero(dma_limit, dev->bus_dma_limit);
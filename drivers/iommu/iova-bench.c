@@ -0,0 +1,164 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * IOVA allocator benchmark
+ *
+ * Runs one thread per online CPU against a single shared iova_domain and
+ * reports the average cost of an alloc_iova_fast()/free_iova_fast() pair
+ * for every range size from one page up to 2^max_order pages.  Sizes below
+ * the rcache limit (iova.rcache_max_size) exercise the per-CPU magazines,
+ * larger ones the rbtree and its lock.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/atomic.h>
+#include <linux/cpumask.h>
+#include <linux/dma-mapping.h>
+#include <linux/iova.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/wait_bit.h>
+
+#define IOVA_BENCH_BATCH	64
+
+static unsigned int max_order = 9;
+module_param(max_order, uint, 0444);
+MODULE_PARM_DESC(max_order, "Largest range size to test, as log2 of pages (default: 9)");
+
+static unsigned int iterations = 100000;
+module_param(iterations, uint, 0444);
+MODULE_PARM_DESC(iterations, "Alloc/free pairs per thread and size (default: 100000)");
+
+static unsigned int nr_threads;
+module_param(nr_threads, uint, 0444);
+MODULE_PARM_DESC(nr_threads, "Number of threads (default: number of online CPUs)");
+
+struct iova_bench_thread {
+	struct iova_domain *iovad;
+	unsigned long size;
+	u64 ns;
+	unsigned long failed;
+};
+
+static atomic_t iova_bench_running;
+
+static int iova_bench_fn(void *data)
+{
+	struct iova_bench_thread *t = data;
+	unsigned long limit = DMA_BIT_MASK(48) >> iova_shift(t->iovad);
+	unsigned long pfns[IOVA_BENCH_BATCH];
+	unsigned int done, i, n;
+	ktime_t start;
+
+	start = ktime_get();
+	for (done = 0; done < iterations; done += n) {
+		n = min_t(unsigned int, iterations - done, IOVA_BENCH_BATCH);
+
+		for (i = 0; i < n; i++) {
+			pfns[i] = alloc_iova_fast(t->iovad, t->size, limit, true);
+			if (!pfns[i])
+				t->failed++;
+		}
+		for (i = 0; i < n; i++) {
+			if (pfns[i])
+				free_iova_fast(t->iovad, pfns[i], t->size);
+		}
+		cond_resched();
+	}
+	t->ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	if (atomic_dec_and_test(&iova_bench_running))
+		wake_up_var(&iova_bench_running);
+
+	return 0;
+}
+
+static int iova_bench_run(struct iova_bench_thread *threads,
+			  unsigned int nr, unsigned long size)
+{
+	struct iova_domain iovad;
+	unsigned long failed = 0;
+	unsigned int i, started = 0;
+	u64 ns = 0;
+
+	init_iova_domain(&iovad, PAGE_SIZE, 1);
+
+	atomic_set(&iova_bench_running, 1);
+	for (i = 0; i < nr; i++) {
+		struct task_struct *tsk;
+
+		threads[i] = (struct iova_bench_thread) {
+			.iovad = &iovad,
+			.size = size,
+		};
+		tsk = kthread_create_on_cpu(iova_bench_fn, &threads[i],
+					    cpumask_local_spread(i, NUMA_NO_NODE),
+					    "iova_bench/%u");
+		if (IS_ERR(tsk))
+			break;
+
+		atomic_inc(&iova_bench_running);
+		wake_up_process(tsk);
+		started++;
+	}
+
+	/* Drop the initial reference and wait for all threads to finish */
+	if (!atomic_dec_and_test(&iova_bench_running))
+		wait_var_event(&iova_bench_running,
+			       !atomic_read(&iova_bench_running));
+
+	put_iova_domain(&iovad);
+
+	if (!started)
+		return -ENOMEM;
+
+	for (i = 0; i < started; i++) {
+		ns += threads[i].ns;
+		failed += threads[i].failed;
+	}
+
+	pr_info("size %5lu pages: %u threads, %llu ns per alloc+free, %lu failed\n",
+		size, started, div64_u64(ns, (u64)started * iterations), failed);
+
+	return 0;
+}
+
+static int __init iova_bench_init(void)
+{
+	struct iova_bench_thread *threads;
+	unsigned int nr, order;
+	int ret;
+
+	if (!iterations || max_order >= BITS_PER_LONG)
+		return -EINVAL;
+
+	ret = iova_cache_get();
+	if (ret)
+		return ret;
+
+	nr = nr_threads ?: num_online_cpus();
+	threads = kcalloc(nr, sizeof(*threads), GFP_KERNEL);
+	if (!threads) {
+		ret = -ENOMEM;
+		goto out_put;
+	}
+
+	for (order = 0; order <= max_order; order++) {
+		ret = iova_bench_run(threads, nr, 1UL << order);
+		if (ret)
+			break;
+	}
+
+	kfree(threads);
+out_put:
+	iova_cache_put();
+
+	/* Nothing to keep around once the results have been printed */
+	return ret ?: -EAGAIN;
+}
+
+module_init(iova_bench_init);
+MODULE_DESCRIPTION("IOVA allocator benchmark");
+MODULE_LICENSE("GPL");
@@ -15,6 +15,22 @@
 /* The anchor node sits above the top of the usable address space */
 #define IOVA_ANCHOR	~0UL
 
+/*
+ * Allocations up to 2^(rcache_max_size - 1) pages are served from the
+ * per-CPU range caches; anything larger goes to the rbtree.  Raising this
+ * helps devices that map large buffers at a high rate (e.g. TSO on fast
+ * NICs), at the cost of more memory pinned in cached ranges.
+ */
+static unsigned int rcache_max_size = IOVA_RANGE_CACHE_DEFAULT_SIZE;
+module_param(rcache_max_size, uint, 0444);
+MODULE_PARM_DESC(rcache_max_size,
+	"Number of power-of-two IOVA range caches (default: 6, max: 10)");
+
+static unsigned int depot_max_mags = MAX_GLOBAL_MAGS;
+module_param(depot_max_mags, uint, 0444);
+MODULE_PARM_DESC(depot_max_mags,
+	"Maximum number of full magazines per range cache and NUMA node (default: 32)");
+
 static bool iova_rcache_insert(struct iova_domain *iovad,
 			       unsigned long pfn,
 			       unsigned long size);
@@ -63,6 +79,8 @@ init_iova_domain(struct iova_domain *iovad, unsigned long granule,
 	iovad->start_pfn = start_pfn;
 	iovad->dma_32bit_pfn = 1UL << (32 - iova_shift(iovad));
 	iovad->max32_alloc_size = iovad->dma_32bit_pfn;
+	iovad->rcache_max_size = clamp_val(rcache_max_size, 1,
+					   IOVA_RANGE_CACHE_MAX_SIZE);
 	iovad->flush_cb = NULL;
 	iovad->fq = NULL;
 	iovad->anchor.pfn_lo = iovad->anchor.pfn_hi = IOVA_ANCHOR;
@@ -94,8 +112,22 @@ static void free_iova_flush_queue(struct iova_domain *iovad)
 	iovad->entry_dtor = NULL;
 }
 
+/**
+ * init_iova_flush_queue - set up deferred IOTLB flushing for a domain
+ * @iovad: iova domain in question
+ * @flush_cb: callback flushing the IOTLB of the whole domain
+ * @entry_dtor: optional destructor for the per-entry data
+ * @fq_size: entries per CPU queue, rounded down to a power of two
+ *	     (0 selects IOVA_FQ_SIZE)
+ * @fq_timeout: maximum time in ms an entry may stay queued
+ *		(0 selects IOVA_FQ_TIMEOUT)
+ *
+ * Larger queues and timeouts batch more unmaps into a single IOTLB
+ * invalidation, at the cost of keeping stale translations around longer.
+ */
 int init_iova_flush_queue(struct iova_domain *iovad,
-			  iova_flush_cb flush_cb, iova_entry_dtor entry_dtor)
+			  iova_flush_cb flush_cb, iova_entry_dtor entry_dtor,
+			  unsigned int fq_size, unsigned int fq_timeout)
 {
 	struct iova_fq __percpu *queue;
 	int cpu;
@@ -103,7 +135,12 @@ int init_iova_flush_queue(struct iova_domain *iovad,
 	atomic64_set(&iovad->fq_flush_start_cnt,  0);
 	atomic64_set(&iovad->fq_flush_finish_cnt, 0);
 
-	queue = alloc_percpu(struct iova_fq);
+	if (!fq_size)
+		fq_size = IOVA_FQ_SIZE;
+	fq_size = rounddown_pow_of_two(clamp_val(fq_size, 2, IOVA_FQ_MAX_SIZE));
+
+	queue = __alloc_percpu(struct_size(queue, entries, fq_size),
+			       __alignof__(*queue));
 	if (!queue)
 		return -ENOMEM;
 
@@ -116,11 +153,13 @@ int init_iova_flush_queue(struct iova_domain *iovad,
 		fq = per_cpu_ptr(queue, cpu);
 		fq->head = 0;
 		fq->tail = 0;
+		fq->mod_mask = fq_size - 1;
 
 		spin_lock_init(&fq->lock);
 	}
 
 	iovad->fq = queue;
+	iovad->fq_timeout = fq_timeout ?: IOVA_FQ_TIMEOUT;
 
 	timer_setup(&iovad->fq_timer, fq_flush_timeout, 0);
 	atomic_set(&iovad->fq_timer_on, 0);
@@ -540,12 +579,12 @@ free_iova_fast(struct iova_domain *iovad, unsigned long pfn, unsigned long size)
 EXPORT_SYMBOL_GPL(free_iova_fast);
 
 #define fq_ring_for_each(i, fq) \
-	for ((i) = (fq)->head; (i) != (fq)->tail; (i) = ((i) + 1) % IOVA_FQ_SIZE)
+	for ((i) = (fq)->head; (i) != (fq)->tail; (i) = ((i) + 1) & (fq)->mod_mask)
 
 static inline bool fq_full(struct iova_fq *fq)
 {
 	assert_spin_locked(&fq->lock);
-	return (((fq->tail + 1) % IOVA_FQ_SIZE) == fq->head);
+	return (((fq->tail + 1) & fq->mod_mask) == fq->head);
 }
 
 static inline unsigned fq_ring_add(struct iova_fq *fq)
@@ -554,7 +593,7 @@ static inline unsigned fq_ring_add(struct iova_fq *fq)
 
 	assert_spin_locked(&fq->lock);
 
-	fq->tail = (idx + 1) % IOVA_FQ_SIZE;
+	fq->tail = (idx + 1) & fq->mod_mask;
 
 	return idx;
 }
@@ -578,7 +617,7 @@ static void fq_ring_free(struct iova_domain *iovad, struct iova_fq *fq)
 			       fq->entries[idx].iova_pfn,
 			       fq->entries[idx].pages);
 
-		fq->head = (fq->head + 1) % IOVA_FQ_SIZE;
+		fq->head = (fq->head + 1) & fq->mod_mask;
 	}
 }
 
@@ -674,7 +713,7 @@ void queue_iova(struct iova_domain *iovad,
 	if (!atomic_read(&iovad->fq_timer_on) &&
 	    !atomic_xchg(&iovad->fq_timer_on, 1))
 		mod_timer(&iovad->fq_timer,
-			  jiffies + msecs_to_jiffies(IOVA_FQ_TIMEOUT));
+			  jiffies + msecs_to_jiffies(iovad->fq_timeout));
 }
 
 /**
@@ -811,6 +850,17 @@ struct iova_cpu_rcache {
 	struct iova_magazine *prev;
 };
 
+/*
+ * Full magazines are kept in a depot per NUMA node, so that CPUs on
+ * different nodes don't bounce a single depot lock and ranges freed on
+ * a node are preferably reused there.
+ */
+struct iova_depot {
+	spinlock_t lock;
+	unsigned long size;
+	struct iova_magazine *mags[MAX_GLOBAL_MAGS];
+};
+
 static struct iova_magazine *iova_magazine_alloc(gfp_t flags)
 {
 	return kzalloc(sizeof(struct iova_magazine), flags);
@@ -888,13 +938,16 @@ static void init_iova_rcaches(struct iova_domain *iovad)
 {
 	struct iova_cpu_rcache *cpu_rcache;
 	struct iova_rcache *rcache;
-	unsigned int cpu;
-	int i;
+	unsigned int cpu, i, nid;
 
-	for (i = 0; i < IOVA_RANGE_CACHE_MAX_SIZE; ++i) {
+	for (i = 0; i < iovad->rcache_max_size; ++i) {
 		rcache = &iovad->rcaches[i];
-		spin_lock_init(&rcache->lock);
-		rcache->depot_size = 0;
+		rcache->depots = kcalloc(nr_node_ids, sizeof(*rcache->depots),
+					 GFP_KERNEL);
+		if (!WARN_ON(!rcache->depots)) {
+			for (nid = 0; nid < nr_node_ids; nid++)
+				spin_lock_init(&rcache->depots[nid].lock);
+		}
 		rcache->cpu_rcaches = __alloc_percpu(sizeof(*cpu_rcache), cache_line_size());
 		if (WARN_ON(!rcache->cpu_rcaches))
 			continue;
@@ -907,6 +960,61 @@ static void init_iova_rcaches(struct iova_domain *iovad)
 	}
 }
 
+static bool iova_depot_push(struct iova_rcache *rcache,
+			    struct iova_magazine *mag)
+{
+	unsigned long limit = min_t(unsigned long, depot_max_mags,
+				    MAX_GLOBAL_MAGS);
+	struct iova_depot *depot;
+	bool pushed = false;
+
+	if (!rcache->depots)
+		return false;
+
+	depot = &rcache->depots[numa_node_id()];
+	spin_lock(&depot->lock);
+	if (depot->size < limit) {
+		depot->mags[depot->size++] = mag;
+		pushed = true;
+	}
+	spin_unlock(&depot->lock);
+
+	return pushed;
+}
+
+/*
+ * Replace the empty loaded magazine of 'cpu_rcache' with a full one from
+ * the depot, trying the local node first and then the remote ones.
+ */
+static bool iova_depot_pop(struct iova_rcache *rcache,
+			   struct iova_cpu_rcache *cpu_rcache)
+{
+	unsigned int local, i;
+
+	if (!rcache->depots)
+		return false;
+
+	local = numa_node_id();
+	for (i = 0; i < nr_node_ids; i++) {
+		struct iova_depot *depot;
+
+		depot = &rcache->depots[(local + i) % nr_node_ids];
+		if (!READ_ONCE(depot->size))
+			continue;
+
+		spin_lock(&depot->lock);
+		if (depot->size > 0) {
+			iova_magazine_free(cpu_rcache->loaded);
+			cpu_rcache->loaded = depot->mags[--depot->size];
+			spin_unlock(&depot->lock);
+			return true;
+		}
+		spin_unlock(&depot->lock);
+	}
+
+	return false;
+}
+
 /*
  * Try inserting IOVA range starting with 'iova_pfn' into 'rcache', and
  * return true on success.  Can fail if rcache is full and we can't free
@@ -934,14 +1042,8 @@ static bool __iova_rcache_insert(struct iova_domain *iovad,
 		struct iova_magazine *new_mag = iova_magazine_alloc(GFP_ATOMIC);
 
 		if (new_mag) {
-			spin_lock(&rcache->lock);
-			if (rcache->depot_size < MAX_GLOBAL_MAGS) {
-				rcache->depot[rcache->depot_size++] =
-						cpu_rcache->loaded;
-			} else {
+			if (!iova_depot_push(rcache, cpu_rcache->loaded))
 				mag_to_free = cpu_rcache->loaded;
-			}
-			spin_unlock(&rcache->lock);
 
 			cpu_rcache->loaded = new_mag;
 			can_insert = true;
@@ -966,7 +1068,7 @@ static bool iova_rcache_insert(struct iova_domain *iovad, unsigned long pfn,
 {
 	unsigned int log_size = order_base_2(size);
 
-	if (log_size >= IOVA_RANGE_CACHE_MAX_SIZE)
+	if (log_size >= iovad->rcache_max_size)
 		return false;
 
 	return __iova_rcache_insert(iovad, &iovad->rcaches[log_size], pfn);
@@ -994,13 +1096,7 @@ static unsigned long __iova_rcache_get(struct iova_rcache *rcache,
 		swap(cpu_rcache->prev, cpu_rcache->loaded);
 		has_pfn = true;
 	} else {
-		spin_lock(&rcache->lock);
-		if (rcache->depot_size > 0) {
-			iova_magazine_free(cpu_rcache->loaded);
-			cpu_rcache->loaded = rcache->depot[--rcache->depot_size];
-			has_pfn = true;
-		}
-		spin_unlock(&rcache->lock);
+		has_pfn = iova_depot_pop(rcache, cpu_rcache);
 	}
 
 	if (has_pfn)
@@ -1022,7 +1118,7 @@ static unsigned long iova_rcache_get(struct iova_domain *iovad,
 {
 	unsigned int log_size = order_base_2(size);
 
-	if (log_size >= IOVA_RANGE_CACHE_MAX_SIZE)
+	if (log_size >= iovad->rcache_max_size)
 		return 0;
 
 	return __iova_rcache_get(&iovad->rcaches[log_size], limit_pfn - size);
@@ -1035,10 +1131,10 @@ static void free_iova_rcaches(struct iova_domain *iovad)
 {
 	struct iova_rcache *rcache;
 	struct iova_cpu_rcache *cpu_rcache;
-	unsigned int cpu;
+	unsigned int cpu, nid;
 	int i, j;
 
-	for (i = 0; i < IOVA_RANGE_CACHE_MAX_SIZE; ++i) {
+	for (i = 0; i < iovad->rcache_max_size; ++i) {
 		rcache = &iovad->rcaches[i];
 		for_each_possible_cpu(cpu) {
 			cpu_rcache = per_cpu_ptr(rcache->cpu_rcaches, cpu);
@@ -1046,8 +1142,15 @@ static void free_iova_rcaches(struct iova_domain *iovad)
 			iova_magazine_free(cpu_rcache->prev);
 		}
 		free_percpu(rcache->cpu_rcaches);
-		for (j = 0; j < rcache->depot_size; ++j)
-			iova_magazine_free(rcache->depot[j]);
+		if (!rcache->depots)
+			continue;
+		for (nid = 0; nid < nr_node_ids; nid++) {
+			struct iova_depot *depot = &rcache->depots[nid];
+
+			for (j = 0; j < depot->size; ++j)
+				iova_magazine_free(depot->mags[j]);
+		}
+		kfree(rcache->depots);
 	}
 }
 
@@ -1061,7 +1164,7 @@ static void free_cpu_cached_iovas(unsigned int cpu, struct iova_domain *iovad)
 	unsigned long flags;
 	int i;
 
-	for (i = 0; i < IOVA_RANGE_CACHE_MAX_SIZE; ++i) {
+	for (i = 0; i < iovad->rcache_max_size; ++i) {
 		rcache = &iovad->rcaches[i];
 		cpu_rcache = per_cpu_ptr(rcache->cpu_rcaches, cpu);
 		spin_lock_irqsave(&cpu_rcache->lock, flags);
@@ -1078,17 +1181,24 @@ static void free_global_cached_iovas(struct iova_domain *iovad)
 {
 	struct iova_rcache *rcache;
 	unsigned long flags;
+	unsigned int nid;
 	int i, j;
 
-	for (i = 0; i < IOVA_RANGE_CACHE_MAX_SIZE; ++i) {
+	for (i = 0; i < iovad->rcache_max_size; ++i) {
 		rcache = &iovad->rcaches[i];
-		spin_lock_irqsave(&rcache->lock, flags);
-		for (j = 0; j < rcache->depot_size; ++j) {
-			iova_magazine_free_pfns(rcache->depot[j], iovad);
-			iova_magazine_free(rcache->depot[j]);
+		if (!rcache->depots)
+			continue;
+		for (nid = 0; nid < nr_node_ids; nid++) {
+			struct iova_depot *depot = &rcache->depots[nid];
+
+			spin_lock_irqsave(&depot->lock, flags);
+			for (j = 0; j < depot->size; ++j) {
+				iova_magazine_free_pfns(depot->mags[j], iovad);
+				iova_magazine_free(depot->mags[j]);
+			}
+			depot->size = 0;
+			spin_unlock_irqrestore(&depot->lock, flags);
 		}
-		rcache->depot_size = 0;
-		spin_unlock_irqrestore(&rcache->lock, flags);
 	}
 }
 MODULE_AUTHOR("Anil S Keshavamurthy <anil.s.keshavamurthy@intel.com>");
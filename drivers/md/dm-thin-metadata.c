@@ -1871,6 +1871,26 @@ int dm_pool_commit_metadata(struct dm_pool_metadata *pmd)
 {
 	int r = -EINVAL;
 
+	/*
+	 * Write back the bulk of the dirty metadata with only the read lock
+	 * held, so that block lookups from thin_map() are not stalled behind
+	 * that I/O.  Shadowed blocks are not referenced by the on-disk
+	 * superblock until the commit, so writing them early is harmless.
+	 * The write-locked commit below is then left with the blocks dirtied
+	 * since, and the superblock.
+	 */
+	down_read(&pmd->root_lock);
+	if (pmd->fail_io) {
+		up_read(&pmd->root_lock);
+		return r;
+	}
+	r = pmd->in_service ? dm_bm_flush(pmd->bm) : 0;
+	up_read(&pmd->root_lock);
+	if (r < 0)
+		return r;
+
+	r = -EINVAL;
+
 	/*
 	 * Care is taken to not have commit be what
 	 * triggers putting the thin-pool in-service.
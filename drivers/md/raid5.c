@@ -416,7 +416,7 @@ static inline void remove_hash(struct stripe_head *sh)
 	pr_debug("remove_hash(), stripe %llu\n",
 		(unsigned long long)sh->sector);
 
-	hlist_del_init(&sh->hash);
+	hlist_del_init_rcu(&sh->hash);
 }
 
 static inline void insert_hash(struct r5conf *conf, struct stripe_head *sh)
@@ -426,7 +426,7 @@ static inline void insert_hash(struct r5conf *conf, struct stripe_head *sh)
 	pr_debug("insert_hash(), stripe %llu\n",
 		(unsigned long long)sh->sector);
 
-	hlist_add_head(&sh->hash, hp);
+	hlist_add_head_rcu(&sh->hash, hp);
 }
 
 /* find an idle stripe, make sure it is unhashed, and return it. */
@@ -618,6 +618,44 @@ static struct stripe_head *__find_stripe(struct r5conf *conf, sector_t sector,
 	return NULL;
 }
 
+/*
+ * Lockless lookup of a stripe that is already active.  The stripe_head slab
+ * is SLAB_TYPESAFE_BY_RCU and stripes get recycled for other sectors under
+ * the hash lock, so a match only counts if a reference could be taken and
+ * the stripe still matches afterwards.  Idle stripes (count == 0) have to be
+ * taken off the inactive lists under device_lock and are left to the slow
+ * path in raid5_get_active_stripe().
+ */
+static struct stripe_head *find_get_active_stripe(struct r5conf *conf,
+						  sector_t sector, int previous)
+{
+	struct stripe_head *sh;
+	short generation;
+	int seq;
+
+	rcu_read_lock();
+	seq = read_seqcount_begin(&conf->gen_lock);
+	generation = conf->generation - previous;
+	hlist_for_each_entry_rcu(sh, stripe_hash(conf, sector), hash) {
+		if (sh->sector != sector || sh->generation != generation)
+			continue;
+		if (!atomic_inc_not_zero(&sh->count))
+			break;
+		if (sh->sector == sector && sh->generation == generation &&
+		    !hlist_unhashed(&sh->hash) &&
+		    !read_seqcount_retry(&conf->gen_lock, seq)) {
+			rcu_read_unlock();
+			return sh;
+		}
+		/* recycled or reshaped between the match and the reference */
+		rcu_read_unlock();
+		raid5_release_stripe(sh);
+		return NULL;
+	}
+	rcu_read_unlock();
+	return NULL;
+}
+
 /*
  * Need to check if array has failed when deciding whether to:
  *  - start an array
@@ -710,6 +748,17 @@ raid5_get_active_stripe(struct r5conf *conf, sector_t sector,
 
 	pr_debug("get_stripe, sector %llu\n", (unsigned long long)sector);
 
+	/*
+	 * Leave it to the slow path to wait for quiesce.  A getter racing
+	 * with raid5_quiesce() only shares a stripe that is already active,
+	 * which quiesce has to wait for anyway.
+	 */
+	if (!READ_ONCE(conf->quiesce) || noquiesce) {
+		sh = find_get_active_stripe(conf, sector, previous);
+		if (sh)
+			return sh;
+	}
+
 	spin_lock_irq(conf->hash_locks + hash);
 
 	do {
@@ -2371,7 +2420,7 @@ static int grow_stripes(struct r5conf *conf, int num)
 	conf->active_name = 0;
 	sc = kmem_cache_create(conf->cache_name[conf->active_name],
 			       sizeof(struct stripe_head)+(devs-1)*sizeof(struct r5dev),
-			       0, 0, NULL);
+			       0, SLAB_TYPESAFE_BY_RCU, NULL);
 	if (!sc)
 		return 1;
 	conf->slab_cache = sc;
@@ -2497,7 +2546,7 @@ static int resize_stripes(struct r5conf *conf, int newsize)
 	/* Step 1 */
 	sc = kmem_cache_create(conf->cache_name[1-conf->active_name],
 			       sizeof(struct stripe_head)+(newsize-1)*sizeof(struct r5dev),
-			       0, 0, NULL);
+			       0, SLAB_TYPESAFE_BY_RCU, NULL);
 	if (!sc)
 		return -ENOMEM;
 
@@ -1415,11 +1415,15 @@ static void bond_compute_features(struct bonding *bond)
 	struct list_head *iter;
 	struct slave *slave;
 	unsigned short max_hard_header_len = ETH_HLEN;
+	unsigned int tso_max_size = GSO_MAX_SIZE;
 	unsigned int gso_max_size = GSO_MAX_SIZE;
 	u16 gso_max_segs = GSO_MAX_SEGS;
 
-	if (!bond_has_slaves(bond))
+	if (!bond_has_slaves(bond)) {
+		tso_max_size = GSO_LEGACY_MAX_SIZE;
+		gso_max_size = GSO_LEGACY_MAX_SIZE;
 		goto done;
+	}
 	vlan_features &= NETIF_F_ALL_FOR_ALL;
 	mpls_features &= NETIF_F_ALL_FOR_ALL;
 
@@ -1445,6 +1449,7 @@ static void bond_compute_features(struct bonding *bond)
 		if (slave->dev->hard_header_len > max_hard_header_len)
 			max_hard_header_len = slave->dev->hard_header_len;
 
+		tso_max_size = min(tso_max_size, slave->dev->tso_max_size);
 		gso_max_size = min(gso_max_size, slave->dev->gso_max_size);
 		gso_max_segs = min(gso_max_segs, slave->dev->gso_max_segs);
 	}
@@ -1460,6 +1465,7 @@ static void bond_compute_features(struct bonding *bond)
 #endif /* CONFIG_XFRM_OFFLOAD */
 	bond_dev->mpls_features = mpls_features;
 	bond_dev->gso_max_segs = gso_max_segs;
+	bond_dev->tso_max_size = tso_max_size;
 	netif_set_gso_max_size(bond_dev, gso_max_size);
 
 	bond_dev->priv_flags &= ~IFF_XMIT_DST_RELEASE;
@@ -4843,17 +4849,19 @@ static struct slave *bond_xmit_3ad_xor_slave_get(struct bonding *bond,
 						 struct sk_buff *skb,
 						 struct bond_up_slave *slaves)
 {
-	struct slave *slave;
 	unsigned int count;
 	u32 hash;
 
-	hash = bond_xmit_hash(bond, skb);
 	count = slaves ? READ_ONCE(slaves->count) : 0;
 	if (unlikely(!count))
 		return NULL;
 
-	slave = slaves->arr[hash % count];
-	return slave;
+	/* Nothing to balance over, don't bother dissecting the packet */
+	if (count == 1)
+		return slaves->arr[0];
+
+	hash = bond_xmit_hash(bond, skb);
+	return slaves->arr[hash % count];
 }
 
 static struct slave *bond_xdp_xmit_3ad_xor_slave_get(struct bonding *bond,
@@ -4863,12 +4871,15 @@ static struct slave *bond_xdp_xmit_3ad_xor_slave_get(struct bonding *bond,
 	unsigned int count;
 	u32 hash;
 
-	hash = bond_xmit_hash_xdp(bond, xdp);
 	slaves = rcu_dereference(bond->usable_slaves);
 	count = slaves ? READ_ONCE(slaves->count) : 0;
 	if (unlikely(!count))
 		return NULL;
 
+	if (count == 1)
+		return slaves->arr[0];
+
+	hash = bond_xmit_hash_xdp(bond, xdp);
 	return slaves->arr[hash % count];
 }
 
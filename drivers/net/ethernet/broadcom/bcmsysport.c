@@ -661,7 +661,8 @@ static int bcm_sysport_set_coalesce(struct net_device *dev,
 	pkts = priv->rx_max_coalesced_frames;
 
 	if (ec->use_adaptive_rx_coalesce && !priv->dim.use_dim) {
-		moder = net_dim_get_def_rx_moderation(priv->dim.dim.mode);
+		moder = net_dim_get_rx_moderation(priv->dim.moder.dim.mode,
+						  READ_ONCE(priv->dim.moder.cur_ix));
 		usecs = moder.usec;
 		pkts = moder.pkts;
 	}
@@ -1016,7 +1017,6 @@ static int bcm_sysport_poll(struct napi_struct *napi, int budget)
 {
 	struct bcm_sysport_priv *priv =
 		container_of(napi, struct bcm_sysport_priv, napi);
-	struct dim_sample dim_sample = {};
 	unsigned int work_done = 0;
 
 	work_done = bcm_sysport_desc_rx(priv, budget);
@@ -1039,11 +1039,9 @@ static int bcm_sysport_poll(struct napi_struct *napi, int budget)
 		intrl2_0_mask_clear(priv, INTRL2_0_RDMA_MBDONE);
 	}
 
-	if (priv->dim.use_dim) {
-		dim_update_sample(priv->dim.event_ctr, priv->dim.packets,
-				  priv->dim.bytes, &dim_sample);
-		net_dim(&priv->dim.dim, dim_sample);
-	}
+	if (priv->dim.use_dim)
+		dim_irq_moder_sample(&priv->dim.moder, priv->dim.packets,
+				     priv->dim.bytes);
 
 	return work_done;
 }
@@ -1109,18 +1107,17 @@ static void bcm_sysport_resume_from_wol(struct bcm_sysport_priv *priv)
 	netif_dbg(priv, wol, priv->netdev, "resumed from WOL\n");
 }
 
-static void bcm_sysport_dim_work(struct work_struct *work)
+static void bcm_sysport_set_moderation(struct dim_irq_moder *m, int ix,
+				       struct dim_cq_moder moder)
 {
-	struct dim *dim = container_of(work, struct dim, work);
 	struct bcm_sysport_net_dim *ndim =
-			container_of(dim, struct bcm_sysport_net_dim, dim);
+			container_of(m, struct bcm_sysport_net_dim, moder);
 	struct bcm_sysport_priv *priv =
 			container_of(ndim, struct bcm_sysport_priv, dim);
-	struct dim_cq_moder cur_profile = net_dim_get_rx_moderation(dim->mode,
-								    dim->profile_ix);
 
-	bcm_sysport_set_rx_coalesce(priv, cur_profile.usec, cur_profile.pkts);
-	dim->state = DIM_START_MEASURE;
+	/* a profile pinned through sysfs only applies once DIM is enabled */
+	if (ndim->use_dim)
+		bcm_sysport_set_rx_coalesce(priv, moder.usec, moder.pkts);
 }
 
 /* RX and misc interrupt routine */
@@ -1141,7 +1138,6 @@ static irqreturn_t bcm_sysport_rx_isr(int irq, void *dev_id)
 	}
 
 	if (priv->irq0_stat & INTRL2_0_RDMA_MBDONE) {
-		priv->dim.event_ctr++;
 		if (likely(napi_schedule_prep(&priv->napi))) {
 			/* disable RX interrupts */
 			intrl2_0_mask_set(priv, INTRL2_0_RDMA_MBDONE);
@@ -1468,15 +1464,19 @@ static void bcm_sysport_adj_link(struct net_device *dev)
 }
 
 static void bcm_sysport_init_dim(struct bcm_sysport_priv *priv,
-				 void (*cb)(struct work_struct *work))
+				 dim_irq_set_moder_t cb)
 {
 	struct bcm_sysport_net_dim *dim = &priv->dim;
 
-	INIT_WORK(&dim->dim.work, cb);
-	dim->dim.mode = DIM_CQ_PERIOD_MODE_START_FROM_EQE;
-	dim->event_ctr = 0;
+	dim_irq_moder_init(&dim->moder, DIM_IRQ_NET_RX,
+			   DIM_CQ_PERIOD_MODE_START_FROM_EQE, cb);
 	dim->packets = 0;
 	dim->bytes = 0;
+
+	/* sysfs exposure is best effort, DIM works without it */
+	if (dim_irq_moder_register(&dim->moder, priv->irq0))
+		netif_dbg(priv, ifup, priv->netdev,
+			  "RX moderation not exposed in sysfs\n");
 }
 
 static void bcm_sysport_init_rx_coalesce(struct bcm_sysport_priv *priv)
@@ -1488,9 +1488,10 @@ static void bcm_sysport_init_rx_coalesce(struct bcm_sysport_priv *priv)
 	usecs = priv->rx_coalesce_usecs;
 	pkts = priv->rx_max_coalesced_frames;
 
-	/* If DIM was enabled, re-apply default parameters */
+	/* If DIM was enabled, apply the profile it starts out from */
 	if (dim->use_dim) {
-		moder = net_dim_get_def_rx_moderation(dim->dim.mode);
+		moder = net_dim_get_rx_moderation(dim->moder.dim.mode,
+						  dim->moder.cur_ix);
 		usecs = moder.usec;
 		pkts = moder.pkts;
 	}
@@ -1889,7 +1890,7 @@ static void bcm_sysport_netif_start(struct net_device *dev)
 	struct bcm_sysport_priv *priv = netdev_priv(dev);
 
 	/* Enable NAPI */
-	bcm_sysport_init_dim(priv, bcm_sysport_dim_work);
+	bcm_sysport_init_dim(priv, bcm_sysport_set_moderation);
 	bcm_sysport_init_rx_coalesce(priv);
 	napi_enable(&priv->napi);
 
@@ -2082,7 +2083,7 @@ static void bcm_sysport_netif_stop(struct net_device *dev)
 	/* stop all software from updating hardware */
 	netif_tx_disable(dev);
 	napi_disable(&priv->napi);
-	cancel_work_sync(&priv->dim.dim.work);
+	dim_irq_moder_unregister(&priv->dim.moder);
 	phy_stop(dev->phydev);
 
 	/* mask all interrupts */
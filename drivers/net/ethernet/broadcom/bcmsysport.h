@@ -668,10 +668,9 @@ struct bcm_sysport_hw_params {
 
 struct bcm_sysport_net_dim {
 	u16			use_dim;
-	u16			event_ctr;
 	unsigned long		packets;
 	unsigned long		bytes;
-	struct dim		dim;
+	struct dim_irq_moder	moder;
 };
 
 /* Software view of the TX ring */
@@ -63,6 +63,7 @@ struct veth_rq {
 	struct xdp_mem_info	xdp_mem;
 	struct veth_rq_stats	stats;
 	bool			rx_notify_masked;
+	bool			xmit_flush_pending;
 	struct ptr_ring		xdp_ring;
 	struct xdp_rxq_info	xdp_rxq;
 };
@@ -279,6 +280,26 @@ static void __veth_xdp_flush(struct veth_rq *rq)
 	}
 }
 
+/* All the skbs of a single dev_hard_start_xmit() bulk share one tx queue,
+ * hence one peer rq: only kick the peer NAPI after the last of them.
+ * Skbs not queued to the ring still flush what earlier ones left pending.
+ */
+static void veth_xmit_flush(struct veth_rq *rq, bool queued)
+{
+	if (netdev_xmit_more()) {
+		if (queued && !READ_ONCE(rq->xmit_flush_pending))
+			WRITE_ONCE(rq->xmit_flush_pending, true);
+		return;
+	}
+
+	if (READ_ONCE(rq->xmit_flush_pending))
+		WRITE_ONCE(rq->xmit_flush_pending, false);
+	else if (!queued)
+		return;
+
+	__veth_xdp_flush(rq);
+}
+
 static int veth_xdp_rx(struct veth_rq *rq, struct sk_buff *skb)
 {
 	if (unlikely(ptr_ring_produce(&rq->xdp_ring, skb))) {
@@ -327,7 +348,7 @@ static netdev_tx_t veth_xmit(struct sk_buff *skb, struct net_device *dev)
 
 	rcu_read_lock();
 	rcv = rcu_dereference(priv->peer);
-	if (unlikely(!rcv) || !pskb_may_pull(skb, ETH_HLEN)) {
+	if (unlikely(!rcv)) {
 		kfree_skb(skb);
 		goto drop;
 	}
@@ -345,6 +366,11 @@ static netdev_tx_t veth_xmit(struct sk_buff *skb, struct net_device *dev)
 			   veth_skb_is_eligible_for_gro(dev, rcv, skb);
 	}
 
+	if (unlikely(!pskb_may_pull(skb, ETH_HLEN))) {
+		kfree_skb(skb);
+		goto drop;
+	}
+
 	skb_tx_timestamp(skb);
 	if (likely(veth_forward_skb(rcv, skb, rq, use_napi) == NET_RX_SUCCESS)) {
 		if (!use_napi)
@@ -354,8 +380,8 @@ static netdev_tx_t veth_xmit(struct sk_buff *skb, struct net_device *dev)
 		atomic64_inc(&priv->dropped);
 	}
 
-	if (use_napi)
-		__veth_xdp_flush(rq);
+	if (rq)
+		veth_xmit_flush(rq, use_napi);
 
 	rcu_read_unlock();
 
@@ -989,6 +1015,7 @@ static void veth_napi_del_range(struct net_device *dev, int start, int end)
 		struct veth_rq *rq = &priv->rq[i];
 
 		rq->rx_notify_masked = false;
+		rq->xmit_flush_pending = false;
 		ptr_ring_cleanup(&rq->xdp_ring, veth_ptr_free);
 	}
 }
@@ -1590,6 +1617,7 @@ static void veth_setup(struct net_device *dev)
 	dev->hw_features = VETH_FEATURES;
 	dev->hw_enc_features = VETH_FEATURES;
 	dev->mpls_features = NETIF_F_HW_CSUM | NETIF_F_GSO_SOFTWARE;
+	netif_set_tso_max_size(dev, GSO_MAX_SIZE);
 }
 
 /*
@@ -94,6 +94,44 @@ void nvme_failover_req(struct request *req)
 	kblockd_schedule_work(&ns->head->requeue_work);
 }
 
+/*
+ * Per-path load tracking for the queue-depth and service-time policies.  The
+ * counters live in the path's own nvme_ns, so paths never share a cacheline
+ * and nothing is tracked while another policy is selected.
+ */
+void nvme_mpath_start_request(struct request *rq)
+{
+	struct nvme_ns *ns = rq->q->queuedata;
+	int iopolicy;
+
+	/* admin requests come here too, their queue has no namespace */
+	if (!(rq->cmd_flags & REQ_NVME_MPATH) ||
+	    (nvme_req(rq)->flags & NVME_MPATH_IO_STATS))
+		return;
+
+	iopolicy = READ_ONCE(ns->ctrl->subsys->iopolicy);
+	if (iopolicy != NVME_IOPOLICY_QD && iopolicy != NVME_IOPOLICY_ST)
+		return;
+
+	atomic_inc(&ns->nr_active);
+	nvme_req(rq)->flags |= NVME_MPATH_IO_STATS;
+	nvme_req(rq)->start_time =
+		iopolicy == NVME_IOPOLICY_ST ? ktime_get_ns() : 0;
+}
+
+void nvme_mpath_complete_request(struct request *rq)
+{
+	struct nvme_ns *ns = rq->q->queuedata;
+	u64 start = nvme_req(rq)->start_time;
+
+	if (!(nvme_req(rq)->flags & NVME_MPATH_IO_STATS) || !start)
+		return;
+
+	/* Racy updates from concurrent completions only lose a sample */
+	ewma_nvme_lat_add(&ns->lat,
+		max_t(u64, div_u64(ktime_get_ns() - start, NSEC_PER_USEC), 1));
+}
+
 void nvme_kick_requeue_lists(struct nvme_ctrl *ctrl)
 {
 	struct nvme_ns *ns;
@@ -273,6 +311,58 @@ static struct nvme_ns *nvme_round_robin_path(struct nvme_ns_head *head,
 	return found;
 }
 
+static u64 nvme_path_cost(struct nvme_ns *ns, int iopolicy)
+{
+	u64 depth = atomic_read(&ns->nr_active);
+
+	if (iopolicy == NVME_IOPOLICY_QD)
+		return depth;
+
+	/*
+	 * Expected time for a new command to complete behind the ones already
+	 * queued on this path.  A path without latency samples yet costs
+	 * nothing, so that it gets probed.
+	 */
+	return (depth + 1) * ewma_nvme_lat_read(&ns->lat);
+}
+
+/*
+ * Pick the cheapest usable path for the queue-depth and service-time
+ * policies, preferring optimized over non-optimized paths.  The choice is
+ * made per I/O, so head->current_path is not used.
+ */
+static struct nvme_ns *nvme_least_loaded_path(struct nvme_ns_head *head,
+		int iopolicy)
+{
+	u64 found_cost = U64_MAX, fallback_cost = U64_MAX, cost;
+	struct nvme_ns *found = NULL, *fallback = NULL, *ns;
+
+	list_for_each_entry_rcu(ns, &head->list, siblings) {
+		if (nvme_path_is_disabled(ns))
+			continue;
+
+		cost = nvme_path_cost(ns, iopolicy);
+		switch (ns->ana_state) {
+		case NVME_ANA_OPTIMIZED:
+			if (cost < found_cost) {
+				found_cost = cost;
+				found = ns;
+			}
+			break;
+		case NVME_ANA_NONOPTIMIZED:
+			if (cost < fallback_cost) {
+				fallback_cost = cost;
+				fallback = ns;
+			}
+			break;
+		default:
+			break;
+		}
+	}
+
+	return found ? found : fallback;
+}
+
 static inline bool nvme_path_is_optimized(struct nvme_ns *ns)
 {
 	return ns->ctrl->state == NVME_CTRL_LIVE &&
@@ -281,14 +371,18 @@ static inline bool nvme_path_is_optimized(struct nvme_ns *ns)
 
 inline struct nvme_ns *nvme_find_path(struct nvme_ns_head *head)
 {
+	int iopolicy = READ_ONCE(head->subsys->iopolicy);
 	int node = numa_node_id();
 	struct nvme_ns *ns;
 
+	if (iopolicy == NVME_IOPOLICY_QD || iopolicy == NVME_IOPOLICY_ST)
+		return nvme_least_loaded_path(head, iopolicy);
+
 	ns = srcu_dereference(head->current_path[node], &head->srcu);
 	if (unlikely(!ns))
 		return __nvme_find_path(head, node);
 
-	if (READ_ONCE(head->subsys->iopolicy) == NVME_IOPOLICY_RR)
+	if (iopolicy == NVME_IOPOLICY_RR)
 		return nvme_round_robin_path(head, node, ns);
 	if (unlikely(!nvme_path_is_optimized(ns)))
 		return __nvme_find_path(head, node);
@@ -424,6 +518,7 @@ static const struct file_operations nvme_ns_head_chr_fops = {
 	.release	= nvme_ns_head_chr_release,
 	.unlocked_ioctl	= nvme_ns_head_chr_ioctl,
 	.compat_ioctl	= compat_ptr_ioctl,
+	.uring_cmd	= nvme_ns_head_chr_uring_cmd,
 };
 
 static int nvme_add_ns_head_cdev(struct nvme_ns_head *head)
@@ -713,6 +808,8 @@ void nvme_mpath_stop(struct nvme_ctrl *ctrl)
 static const char *nvme_iopolicy_names[] = {
 	[NVME_IOPOLICY_NUMA]	= "numa",
 	[NVME_IOPOLICY_RR]	= "round-robin",
+	[NVME_IOPOLICY_QD]	= "queue-depth",
+	[NVME_IOPOLICY_ST]	= "service-time",
 };
 
 static ssize_t nvme_subsys_iopolicy_show(struct device *dev,
@@ -760,6 +857,24 @@ static ssize_t ana_state_show(struct device *dev, struct device_attribute *attr,
 }
 DEVICE_ATTR_RO(ana_state);
 
+static ssize_t queue_depth_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct nvme_ns *ns = nvme_get_ns_from_dev(dev);
+
+	return sysfs_emit(buf, "%d\n", atomic_read(&ns->nr_active));
+}
+DEVICE_ATTR_RO(queue_depth);
+
+static ssize_t service_time_us_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct nvme_ns *ns = nvme_get_ns_from_dev(dev);
+
+	return sysfs_emit(buf, "%lu\n", ewma_nvme_lat_read(&ns->lat));
+}
+DEVICE_ATTR_RO(service_time_us);
+
 static int nvme_lookup_ana_group_desc(struct nvme_ctrl *ctrl,
 		struct nvme_ana_group_desc *desc, void *data)
 {
@@ -30,6 +30,16 @@ static int so_priority;
 module_param(so_priority, int, 0644);
 MODULE_PARM_DESC(so_priority, "nvme tcp socket optimize priority");
 
+/*
+ * Maximum number of nvme_tcp_try_send() calls io_work makes before it looks
+ * at the receive side again.  Each call sends at most one request, or part
+ * of one.  Sending back to back lets the PDUs be coalesced through MSG_MORE
+ * instead of going out one segment each.
+ */
+static int send_batch = 16;
+module_param(send_batch, int, 0644);
+MODULE_PARM_DESC(send_batch, "nvme tcp max send attempts per io_work iteration");
+
 #ifdef CONFIG_DEBUG_LOCK_ALLOC
 /* lockdep can detect a circular dependency of the form
  *   sk_lock -> mmap_lock (page fault) -> fs locks -> sk_lock
@@ -1175,12 +1185,33 @@ static int nvme_tcp_try_recv(struct nvme_tcp_queue *queue)
 	rd_desc.arg.data = queue;
 	rd_desc.count = 1;
 	lock_sock(sk);
+	/*
+	 * read_sock() doesn't go through recvmsg(), so record the flow here
+	 * for RFS, and accelerated RFS steers the receive processing of this
+	 * connection to io_cpu.
+	 */
+	sock_rps_record_flow(sk);
 	queue->nr_cqe = 0;
 	consumed = sock->ops->read_sock(sk, &rd_desc, nvme_tcp_recv_skb);
 	release_sock(sk);
 	return consumed;
 }
 
+static int nvme_tcp_try_send_batch(struct nvme_tcp_queue *queue)
+{
+	int budget = max(send_batch, 1);
+	int ret, sent = 0;
+
+	do {
+		ret = nvme_tcp_try_send(queue);
+		if (ret <= 0)
+			break;
+		sent++;
+	} while (--budget);
+
+	return ret < 0 ? ret : sent;
+}
+
 static void nvme_tcp_io_work(struct work_struct *w)
 {
 	struct nvme_tcp_queue *queue =
@@ -1192,7 +1223,7 @@ static void nvme_tcp_io_work(struct work_struct *w)
 		int result;
 
 		if (mutex_trylock(&queue->send_mutex)) {
-			result = nvme_tcp_try_send(queue);
+			result = nvme_tcp_try_send_batch(queue);
 			mutex_unlock(&queue->send_mutex);
 			if (result > 0)
 				pending = true;
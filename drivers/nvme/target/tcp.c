@@ -13,6 +13,7 @@
 #include <net/tcp.h>
 #include <linux/inet.h>
 #include <linux/llist.h>
+#include <linux/kthread.h>
 #include <crypto/hash.h>
 
 #include "nvmet.h"
@@ -39,6 +40,16 @@ module_param(idle_poll_period_usecs, int, 0644);
 MODULE_PARM_DESC(idle_poll_period_usecs,
 		"nvmet tcp io_work poll till idle time period in usecs");
 
+/* Run io_work of each new queue in a dedicated kthread, affine to the CPU
+ * that receives the connection's packets, rather than on the shared
+ * nvmet_tcp_wq.  This keeps busy queues from delaying each other behind
+ * the same per-CPU worker pool and avoids workqueue dispatch overhead.
+ */
+static bool io_threads;
+module_param(io_threads, bool, 0644);
+MODULE_PARM_DESC(io_threads,
+		"nvmet tcp use a dedicated kthread per queue (default: false)");
+
 #define NVMET_TCP_RECV_BUDGET		8
 #define NVMET_TCP_SEND_BUDGET		8
 #define NVMET_TCP_IO_WORK_BUDGET	64
@@ -104,6 +115,8 @@ struct nvmet_tcp_queue {
 	struct socket		*sock;
 	struct nvmet_tcp_port	*port;
 	struct work_struct	io_work;
+	struct kthread_worker	*io_worker;
+	struct kthread_work	io_kwork;
 	struct nvmet_cq		nvme_cq;
 	struct nvmet_sq		nvme_sq;
 
@@ -234,6 +247,14 @@ static inline int queue_cpu(struct nvmet_tcp_queue *queue)
 	return queue->sock->sk->sk_incoming_cpu;
 }
 
+static inline void nvmet_tcp_queue_io_work(struct nvmet_tcp_queue *queue)
+{
+	if (queue->io_worker)
+		kthread_queue_work(queue->io_worker, &queue->io_kwork);
+	else
+		queue_work_on(queue_cpu(queue), nvmet_tcp_wq, &queue->io_work);
+}
+
 static inline u8 nvmet_tcp_hdgst_len(struct nvmet_tcp_queue *queue)
 {
 	return queue->hdr_digest ? NVME_TCP_DIGEST_LENGTH : 0;
@@ -556,7 +577,7 @@ static void nvmet_tcp_queue_response(struct nvmet_req *req)
 	}
 
 	llist_add(&cmd->lentry, &queue->resp_list);
-	queue_work_on(queue_cpu(queue), nvmet_tcp_wq, &cmd->queue->io_work);
+	nvmet_tcp_queue_io_work(queue);
 }
 
 static void nvmet_tcp_execute_request(struct nvmet_tcp_cmd *cmd)
@@ -1280,10 +1301,8 @@ static bool nvmet_tcp_check_queue_deadline(struct nvmet_tcp_queue *queue,
 	return !time_after(jiffies, queue->poll_end);
 }
 
-static void nvmet_tcp_io_work(struct work_struct *w)
+static void nvmet_tcp_do_io_work(struct nvmet_tcp_queue *queue)
 {
-	struct nvmet_tcp_queue *queue =
-		container_of(w, struct nvmet_tcp_queue, io_work);
 	bool pending;
 	int ret, ops = 0;
 
@@ -1309,7 +1328,52 @@ static void nvmet_tcp_io_work(struct work_struct *w)
 	 * ops activity was recorded during the do-while loop above.
 	 */
 	if (nvmet_tcp_check_queue_deadline(queue, ops) || pending)
-		queue_work_on(queue_cpu(queue), nvmet_tcp_wq, &queue->io_work);
+		nvmet_tcp_queue_io_work(queue);
+}
+
+static void nvmet_tcp_io_work(struct work_struct *w)
+{
+	nvmet_tcp_do_io_work(container_of(w, struct nvmet_tcp_queue, io_work));
+}
+
+static void nvmet_tcp_io_kwork(struct kthread_work *w)
+{
+	nvmet_tcp_do_io_work(container_of(w, struct nvmet_tcp_queue, io_kwork));
+}
+
+static int nvmet_tcp_create_io_worker(struct nvmet_tcp_queue *queue)
+{
+	struct kthread_worker *worker;
+	int cpu = queue_cpu(queue);
+
+	if (cpu < 0 || !cpu_online(cpu))
+		cpu = cpumask_local_spread(queue->idx, NUMA_NO_NODE);
+
+	worker = kthread_create_worker(0, "nvmet_tcp/%d", queue->idx);
+	if (IS_ERR(worker))
+		return PTR_ERR(worker);
+
+	/* match the WQ_HIGHPRI workqueue this replaces */
+	set_user_nice(worker->task, MIN_NICE);
+	set_cpus_allowed_ptr(worker->task, cpumask_of(cpu));
+	queue->io_worker = worker;
+	return 0;
+}
+
+static void nvmet_tcp_flush_io_work(struct nvmet_tcp_queue *queue)
+{
+	if (queue->io_worker)
+		kthread_flush_work(&queue->io_kwork);
+	else
+		flush_work(&queue->io_work);
+}
+
+static void nvmet_tcp_cancel_io_work(struct nvmet_tcp_queue *queue)
+{
+	if (queue->io_worker)
+		kthread_cancel_work_sync(&queue->io_kwork);
+	else
+		cancel_work_sync(&queue->io_work);
 }
 
 static int nvmet_tcp_alloc_cmd(struct nvmet_tcp_queue *queue,
@@ -1449,11 +1513,13 @@ static void nvmet_tcp_release_queue_work(struct work_struct *w)
 	mutex_unlock(&nvmet_tcp_queue_mutex);
 
 	nvmet_tcp_restore_socket_callbacks(queue);
-	flush_work(&queue->io_work);
+	nvmet_tcp_flush_io_work(queue);
 
 	nvmet_tcp_uninit_data_in_cmds(queue);
 	nvmet_sq_destroy(&queue->nvme_sq);
-	cancel_work_sync(&queue->io_work);
+	nvmet_tcp_cancel_io_work(queue);
+	if (queue->io_worker)
+		kthread_destroy_worker(queue->io_worker);
 	sock_release(queue->sock);
 	nvmet_tcp_free_cmds(queue);
 	if (queue->hdr_digest || queue->data_digest)
@@ -1472,7 +1538,7 @@ static void nvmet_tcp_data_ready(struct sock *sk)
 	read_lock_bh(&sk->sk_callback_lock);
 	queue = sk->sk_user_data;
 	if (likely(queue))
-		queue_work_on(queue_cpu(queue), nvmet_tcp_wq, &queue->io_work);
+		nvmet_tcp_queue_io_work(queue);
 	read_unlock_bh(&sk->sk_callback_lock);
 }
 
@@ -1492,7 +1558,7 @@ static void nvmet_tcp_write_space(struct sock *sk)
 
 	if (sk_stream_is_writeable(sk)) {
 		clear_bit(SOCK_NOSPACE, &sk->sk_socket->flags);
-		queue_work_on(queue_cpu(queue), nvmet_tcp_wq, &queue->io_work);
+		nvmet_tcp_queue_io_work(queue);
 	}
 out:
 	read_unlock_bh(&sk->sk_callback_lock);
@@ -1573,7 +1639,7 @@ static int nvmet_tcp_set_queue_sock(struct nvmet_tcp_queue *queue)
 		sock->sk->sk_write_space = nvmet_tcp_write_space;
 		if (idle_poll_period_usecs)
 			nvmet_tcp_arm_queue_deadline(queue);
-		queue_work_on(queue_cpu(queue), nvmet_tcp_wq, &queue->io_work);
+		nvmet_tcp_queue_io_work(queue);
 	}
 	write_unlock_bh(&sock->sk->sk_callback_lock);
 
@@ -1592,6 +1658,7 @@ static int nvmet_tcp_alloc_queue(struct nvmet_tcp_port *port,
 
 	INIT_WORK(&queue->release_work, nvmet_tcp_release_queue_work);
 	INIT_WORK(&queue->io_work, nvmet_tcp_io_work);
+	kthread_init_work(&queue->io_kwork, nvmet_tcp_io_kwork);
 	queue->sock = newsock;
 	queue->port = port;
 	queue->nr_cmds = 0;
@@ -1607,9 +1674,15 @@ static int nvmet_tcp_alloc_queue(struct nvmet_tcp_port *port,
 		goto out_free_queue;
 	}
 
+	if (io_threads) {
+		ret = nvmet_tcp_create_io_worker(queue);
+		if (ret)
+			goto out_ida_remove;
+	}
+
 	ret = nvmet_tcp_alloc_cmd(queue, &queue->connect);
 	if (ret)
-		goto out_ida_remove;
+		goto out_destroy_worker;
 
 	ret = nvmet_sq_init(&queue->nvme_sq);
 	if (ret)
@@ -1633,6 +1706,9 @@ static int nvmet_tcp_alloc_queue(struct nvmet_tcp_port *port,
 	nvmet_sq_destroy(&queue->nvme_sq);
 out_free_connect:
 	nvmet_tcp_free_cmd(&queue->connect);
+out_destroy_worker:
+	if (queue->io_worker)
+		kthread_destroy_worker(queue->io_worker);
 out_ida_remove:
 	ida_simple_remove(&nvmet_tcp_queue_ida, queue->idx);
 out_free_queue:
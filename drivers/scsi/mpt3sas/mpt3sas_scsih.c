@@ -3505,7 +3505,7 @@ scsih_target_reset(struct scsi_cmnd *scmd)
 		MPI2_SCSITASKMGMT_TASKTYPE_TARGET_RESET, 0, 0,
 	    tr_timeout, tr_method);
 	/* Check for busy commands after reset */
-	if (r == SUCCESS && atomic_read(&starget->target_busy))
+	if (r == SUCCESS && scsi_target_busy(starget))
 		r = FAILED;
  out:
 	starget_printk(KERN_INFO, starget, "target reset: %s scmd(0x%p)\n",
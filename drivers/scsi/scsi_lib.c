@@ -289,15 +289,21 @@ static void scsi_dec_host_busy(struct Scsi_Host *shost, struct scsi_cmnd *cmd)
 	rcu_read_unlock();
 }
 
+static void scsi_target_put_budget(struct scsi_target *starget,
+				   struct scsi_cmnd *cmd)
+{
+	if (cmd->target_budget_token < 0)
+		return;
+	sbitmap_put(&starget->budget_map, cmd->target_budget_token);
+	cmd->target_budget_token = -1;
+}
+
 void scsi_device_unbusy(struct scsi_device *sdev, struct scsi_cmnd *cmd)
 {
 	struct Scsi_Host *shost = sdev->host;
-	struct scsi_target *starget = scsi_target(sdev);
 
 	scsi_dec_host_busy(shost, cmd);
-
-	if (starget->can_queue > 0)
-		atomic_dec(&starget->target_busy);
+	scsi_target_put_budget(scsi_target(sdev), cmd);
 
 	sbitmap_put(&sdev->budget_map, cmd->budget_token);
 	cmd->budget_token = -1;
@@ -366,7 +372,7 @@ static inline bool scsi_device_is_busy(struct scsi_device *sdev)
 static inline bool scsi_target_is_busy(struct scsi_target *starget)
 {
 	if (starget->can_queue > 0) {
-		if (atomic_read(&starget->target_busy) >= starget->can_queue)
+		if (scsi_target_busy(starget) >= starget->can_queue)
 			return true;
 		if (atomic_read(&starget->target_blocked) > 0)
 			return true;
@@ -1120,6 +1126,7 @@ void scsi_init_command(struct scsi_device *dev, struct scsi_cmnd *cmd)
 	int retries, to_clear;
 	bool in_flight;
 	int budget_token = cmd->budget_token;
+	int target_budget_token = cmd->target_budget_token;
 
 	if (!blk_rq_is_passthrough(rq) && !(flags & SCMD_INITIALIZED)) {
 		flags |= SCMD_INITIALIZED;
@@ -1150,6 +1157,7 @@ void scsi_init_command(struct scsi_device *dev, struct scsi_cmnd *cmd)
 	if (in_flight)
 		__set_bit(SCMD_STATE_INFLIGHT, &cmd->state);
 	cmd->budget_token = budget_token;
+	cmd->target_budget_token = target_budget_token;
 
 }
 
@@ -1267,12 +1275,14 @@ static inline int scsi_dev_queue_ready(struct request_queue *q,
 /*
  * scsi_target_queue_ready: checks if there we can send commands to target
  * @sdev: scsi device on starget to check.
+ * @cmd: command that gets a target budget token if the target has a limit.
  */
 static inline int scsi_target_queue_ready(struct Scsi_Host *shost,
-					   struct scsi_device *sdev)
+					   struct scsi_device *sdev,
+					   struct scsi_cmnd *cmd)
 {
 	struct scsi_target *starget = scsi_target(sdev);
-	unsigned int busy;
+	int token;
 
 	if (starget->single_lun) {
 		spin_lock_irq(shost->host_lock);
@@ -1285,12 +1295,16 @@ static inline int scsi_target_queue_ready(struct Scsi_Host *shost,
 		spin_unlock_irq(shost->host_lock);
 	}
 
+	cmd->target_budget_token = -1;
 	if (starget->can_queue <= 0)
 		return 1;
 
-	busy = atomic_inc_return(&starget->target_busy) - 1;
+	token = sbitmap_get(&starget->budget_map);
+	if (token < 0)
+		goto starved;
+
 	if (atomic_read(&starget->target_blocked) > 0) {
-		if (busy)
+		if (scsi_target_busy(starget) > 1)
 			goto starved;
 
 		/*
@@ -1303,9 +1317,7 @@ static inline int scsi_target_queue_ready(struct Scsi_Host *shost,
 				 "unblocking target at zero depth\n"));
 	}
 
-	if (busy >= starget->can_queue)
-		goto starved;
-
+	cmd->target_budget_token = token;
 	return 1;
 
 starved:
@@ -1313,8 +1325,8 @@ static inline int scsi_target_queue_ready(struct Scsi_Host *shost,
 	list_move_tail(&sdev->starved_entry, &shost->starved_list);
 	spin_unlock_irq(shost->host_lock);
 out_dec:
-	if (starget->can_queue > 0)
-		atomic_dec(&starget->target_busy);
+	if (token >= 0)
+		sbitmap_put(&starget->budget_map, token);
 	return 0;
 }
 
@@ -1662,7 +1674,7 @@ static blk_status_t scsi_queue_rq(struct blk_mq_hw_ctx *hctx,
 	}
 
 	ret = BLK_STS_RESOURCE;
-	if (!scsi_target_queue_ready(shost, sdev))
+	if (!scsi_target_queue_ready(shost, sdev, cmd))
 		goto out_put_budget;
 	if (!scsi_host_queue_ready(q, shost, sdev, cmd))
 		goto out_dec_target_busy;
@@ -1699,8 +1711,7 @@ static blk_status_t scsi_queue_rq(struct blk_mq_hw_ctx *hctx,
 out_dec_host_busy:
 	scsi_dec_host_busy(shost, cmd);
 out_dec_target_busy:
-	if (scsi_target(sdev)->can_queue > 0)
-		atomic_dec(&scsi_target(sdev)->target_busy);
+	scsi_target_put_budget(scsi_target(sdev), cmd);
 out_put_budget:
 	scsi_mq_put_budget(q, cmd->budget_token);
 	cmd->budget_token = -1;
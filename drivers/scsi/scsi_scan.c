@@ -393,6 +393,7 @@ static void scsi_target_dev_release(struct device *dev)
 	struct device *parent = dev->parent;
 	struct scsi_target *starget = to_scsi_target(dev);
 
+	sbitmap_free(&starget->budget_map);
 	kfree(starget);
 	put_device(parent);
 }
@@ -528,6 +529,17 @@ static struct scsi_target *scsi_alloc_target(struct device *parent,
 			return NULL;
 		}
 	}
+	/*
+	 * Like the per-device budget map, but only needed if the LLD limits
+	 * the commands per target; otherwise target busy is not tracked.
+	 */
+	if (starget->can_queue > 0 &&
+	    sbitmap_init_node(&starget->budget_map, starget->can_queue, -1,
+			      GFP_KERNEL, dev_to_node(parent), false, true)) {
+		dev_err(dev, "target budget map allocation failed\n");
+		scsi_target_destroy(starget);
+		return NULL;
+	}
 	get_device(dev);
 
 	return starget;
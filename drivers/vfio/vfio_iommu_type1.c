@@ -62,6 +62,11 @@ module_param_named(dma_entry_limit, dma_entry_limit, uint, 0644);
 MODULE_PARM_DESC(dma_entry_limit,
 		 "Maximum number of user DMA mappings per container (65535).");
 
+static unsigned int dma_map_threads __read_mostly = 8;
+module_param_named(dma_map_threads, dma_map_threads, uint, 0644);
+MODULE_PARM_DESC(dma_map_threads,
+		 "Maximum number of threads pinning and mapping a single large DMA mapping (8, 1 disables).");
+
 struct vfio_iommu {
 	struct list_head	domain_list;
 	struct list_head	iova_list;
@@ -443,9 +448,18 @@ static int vfio_lock_acct(struct vfio_dma *dma, long npage, bool async)
 	if (async && !mmget_not_zero(mm))
 		return -ESRCH; /* process exited */
 
-	ret = mm_lock_acct(dma->task, mm, dma->lock_cap, npage);
-	if (!ret)
-		dma->locked_vm += npage;
+	/*
+	 * dma->locked_vm is updated under mmap_lock, which also serializes
+	 * the threads of a parallel vfio_pin_map_dma().
+	 */
+	ret = mmap_write_lock_killable(mm);
+	if (!ret) {
+		ret = __account_locked_vm(mm, abs(npage), npage > 0, dma->task,
+					  dma->lock_cap);
+		if (!ret)
+			dma->locked_vm += npage;
+		mmap_write_unlock(mm);
+	}
 
 	if (async)
 		mmput(mm);
@@ -1101,22 +1115,19 @@ static size_t unmap_unpin_slow(struct vfio_domain *domain,
 	return unmapped;
 }
 
-static long vfio_unmap_unpin(struct vfio_iommu *iommu, struct vfio_dma *dma,
-			     bool do_accounting)
+/*
+ * Unmap and unpin [iova, iova + size) of @dma, which must be fully mapped.
+ */
+static long __vfio_unmap_unpin(struct vfio_iommu *iommu, struct vfio_dma *dma,
+			       dma_addr_t iova, size_t size, bool do_accounting)
 {
-	dma_addr_t iova = dma->iova, end = dma->iova + dma->size;
+	dma_addr_t end = iova + size;
 	struct vfio_domain *domain, *d;
 	LIST_HEAD(unmapped_region_list);
 	struct iommu_iotlb_gather iotlb_gather;
 	int unmapped_region_cnt = 0;
 	long unlocked = 0;
 
-	if (!dma->size)
-		return 0;
-
-	if (!IS_IOMMU_CAP_DOMAIN_IN_CONTAINER(iommu))
-		return 0;
-
 	/*
 	 * We use the IOMMU to track the physical addresses, otherwise we'd
 	 * need a much more complicated tracking system.  Unfortunately that
@@ -1128,7 +1139,7 @@ static long vfio_unmap_unpin(struct vfio_iommu *iommu, struct vfio_dma *dma,
 				      struct vfio_domain, next);
 
 	list_for_each_entry_continue(d, &iommu->domain_list, next) {
-		iommu_unmap(d->domain, dma->iova, dma->size);
+		iommu_unmap(d->domain, iova, size);
 		cond_resched();
 	}
 
@@ -1171,8 +1182,6 @@ static long vfio_unmap_unpin(struct vfio_iommu *iommu, struct vfio_dma *dma,
 		}
 	}
 
-	dma->iommu_mapped = false;
-
 	if (unmapped_region_cnt) {
 		unlocked += vfio_sync_unpin(dma, domain, &unmapped_region_list,
 					    &iotlb_gather);
@@ -1185,6 +1194,24 @@ static long vfio_unmap_unpin(struct vfio_iommu *iommu, struct vfio_dma *dma,
 	return unlocked;
 }
 
+static long vfio_unmap_unpin(struct vfio_iommu *iommu, struct vfio_dma *dma,
+			     bool do_accounting)
+{
+	long unlocked;
+
+	if (!dma->size)
+		return 0;
+
+	if (!IS_IOMMU_CAP_DOMAIN_IN_CONTAINER(iommu))
+		return 0;
+
+	unlocked = __vfio_unmap_unpin(iommu, dma, dma->iova, dma->size,
+				      do_accounting);
+	dma->iommu_mapped = false;
+
+	return unlocked;
+}
+
 static void vfio_remove_dma(struct vfio_iommu *iommu, struct vfio_dma *dma)
 {
 	WARN_ON(!RB_EMPTY_ROOT(&dma->pfn_list));
@@ -1508,22 +1535,26 @@ static int vfio_iommu_map(struct vfio_iommu *iommu, dma_addr_t iova,
 	return ret;
 }
 
-static int vfio_pin_map_dma(struct vfio_iommu *iommu, struct vfio_dma *dma,
-			    size_t map_size)
+/*
+ * Pin and map @size bytes at @offset into @dma.  On return *done holds how
+ * much of the range, starting at @offset, is pinned and mapped.
+ */
+static int vfio_pin_map_range(struct vfio_iommu *iommu, struct vfio_dma *dma,
+			      size_t offset, size_t size, unsigned long limit,
+			      size_t *done)
 {
-	dma_addr_t iova = dma->iova;
-	unsigned long vaddr = dma->vaddr;
+	dma_addr_t iova = dma->iova + offset;
+	unsigned long vaddr = dma->vaddr + offset;
 	struct vfio_batch batch;
-	size_t size = map_size;
 	long npage;
-	unsigned long pfn, limit = rlimit(RLIMIT_MEMLOCK) >> PAGE_SHIFT;
+	unsigned long pfn;
 	int ret = 0;
 
 	vfio_batch_init(&batch);
 
 	while (size) {
 		/* Pin a contiguous chunk of memory */
-		npage = vfio_pin_pages_remote(dma, vaddr + dma->size,
+		npage = vfio_pin_pages_remote(dma, vaddr + *done,
 					      size >> PAGE_SHIFT, &pfn, limit,
 					      &batch);
 		if (npage <= 0) {
@@ -1533,20 +1564,137 @@ static int vfio_pin_map_dma(struct vfio_iommu *iommu, struct vfio_dma *dma,
 		}
 
 		/* Map it! */
-		ret = vfio_iommu_map(iommu, iova + dma->size, pfn, npage,
+		ret = vfio_iommu_map(iommu, iova + *done, pfn, npage,
 				     dma->prot);
 		if (ret) {
-			vfio_unpin_pages_remote(dma, iova + dma->size, pfn,
+			vfio_unpin_pages_remote(dma, iova + *done, pfn,
 						npage, true);
 			vfio_batch_unpin(&batch, dma);
 			break;
 		}
 
 		size -= npage << PAGE_SHIFT;
-		dma->size += npage << PAGE_SHIFT;
+		*done += npage << PAGE_SHIFT;
 	}
 
 	vfio_batch_fini(&batch);
+
+	return ret;
+}
+
+/* Smallest piece of a DMA mapping handed to a separate thread */
+#define VFIO_DMA_MAP_CHUNK	SZ_1G
+
+struct vfio_pin_map_chunk {
+	struct work_struct	work;
+	struct vfio_iommu	*iommu;
+	struct vfio_dma		*dma;
+	size_t			offset;
+	size_t			size;
+	size_t			done;
+	unsigned long		limit;
+	int			ret;
+};
+
+static void vfio_pin_map_chunk_fn(struct work_struct *work)
+{
+	struct vfio_pin_map_chunk *chunk =
+		container_of(work, struct vfio_pin_map_chunk, work);
+
+	/* The caller keeps dma->mm alive until all chunks are done */
+	kthread_use_mm(chunk->dma->mm);
+	chunk->ret = vfio_pin_map_range(chunk->iommu, chunk->dma,
+					chunk->offset, chunk->size,
+					chunk->limit, &chunk->done);
+	kthread_unuse_mm(chunk->dma->mm);
+}
+
+/*
+ * Pinning is dominated by faulting in and pinning user pages, which scales
+ * with the number of CPUs doing it, so split large mappings into chunks
+ * pinned and mapped by unbound workers.  The calling thread takes the first
+ * chunk itself.
+ */
+static int vfio_pin_map_dma_mt(struct vfio_iommu *iommu, struct vfio_dma *dma,
+			       size_t map_size, unsigned long limit,
+			       unsigned int nr_threads)
+{
+	struct vfio_pin_map_chunk *chunks;
+	size_t chunk_size;
+	unsigned int i, nr;
+	int ret = 0;
+
+	chunk_size = round_up(DIV_ROUND_UP(map_size, nr_threads),
+			      VFIO_DMA_MAP_CHUNK);
+	nr = DIV_ROUND_UP(map_size, chunk_size);
+
+	chunks = kcalloc(nr, sizeof(*chunks), GFP_KERNEL);
+	if (!chunks)
+		return -ENOMEM;
+
+	for (i = 0; i < nr; i++) {
+		struct vfio_pin_map_chunk *chunk = &chunks[i];
+
+		chunk->iommu = iommu;
+		chunk->dma = dma;
+		chunk->offset = (size_t)i * chunk_size;
+		chunk->size = min(chunk_size, map_size - chunk->offset);
+		chunk->limit = limit;
+		INIT_WORK(&chunk->work, vfio_pin_map_chunk_fn);
+		if (i)
+			queue_work(system_unbound_wq, &chunk->work);
+	}
+
+	chunks[0].ret = vfio_pin_map_range(iommu, dma, 0, chunks[0].size,
+					   limit, &chunks[0].done);
+
+	for (i = 1; i < nr; i++)
+		flush_work(&chunks[i].work);
+
+	for (i = 0; i < nr && !ret; i++)
+		ret = chunks[i].ret;
+
+	if (!ret) {
+		dma->size = map_size;
+	} else {
+		/*
+		 * A failed chunk leaves a hole in the middle of the mapping,
+		 * which vfio_unmap_unpin() can't walk; undo each chunk's
+		 * mapped prefix separately.
+		 */
+		for (i = 0; i < nr; i++) {
+			if (chunks[i].done)
+				__vfio_unmap_unpin(iommu, dma,
+						   dma->iova + chunks[i].offset,
+						   chunks[i].done, true);
+		}
+		dma->size = 0;
+	}
+
+	kfree(chunks);
+	return ret;
+}
+
+static int vfio_pin_map_dma(struct vfio_iommu *iommu, struct vfio_dma *dma,
+			    size_t map_size)
+{
+	unsigned long limit = rlimit(RLIMIT_MEMLOCK) >> PAGE_SHIFT;
+	unsigned int nr_threads;
+	size_t done = 0;
+	int ret;
+
+	nr_threads = min_t(unsigned long, READ_ONCE(dma_map_threads),
+			   map_size / VFIO_DMA_MAP_CHUNK);
+	nr_threads = min(nr_threads, num_online_cpus());
+
+	if (nr_threads > 1) {
+		ret = vfio_pin_map_dma_mt(iommu, dma, map_size, limit,
+					  nr_threads);
+	} else {
+		ret = vfio_pin_map_range(iommu, dma, 0, map_size, limit, &done);
+		dma->size = done;
+	}
+
 	dma->iommu_mapped = true;
 
 	if (ret)
@@ -40,6 +40,15 @@ module_param(experimental_zcopytx, int, 0444);
 MODULE_PARM_DESC(experimental_zcopytx, "Enable Zero Copy TX;"
 		                       " 1 -Enable; 0 - Disable");
 
+/* Frames shorter than this are copied even when zerocopy TX is enabled:
+ * pinning the guest pages and waiting for the completion costs more than
+ * the copy for them.
+ */
+static unsigned int zcopytx_min_len = 256;
+module_param(zcopytx_min_len, uint, 0644);
+MODULE_PARM_DESC(zcopytx_min_len,
+		 "Minimum frame length for Zero Copy TX (default 256)");
+
 /* Max number of bytes transferred before requeueing the job.
  * Using this limit prevents one virtqueue from starving others. */
 #define VHOST_NET_WEIGHT 0x80000
@@ -52,7 +61,6 @@ MODULE_PARM_DESC(experimental_zcopytx, "Enable Zero Copy TX;"
 
 /* MAX number of TX used buffers for outstanding zerocopy */
 #define VHOST_MAX_PEND 128
-#define VHOST_GOODCOPY_LEN 256
 
 /*
  * For transmit, used buffer len is unused; we override it to track buffer
@@ -898,7 +906,7 @@ static void handle_tx_zerocopy(struct vhost_net *net, struct socket *sock)
 			break;
 		}
 
-		zcopy_used = len >= VHOST_GOODCOPY_LEN
+		zcopy_used = len >= READ_ONCE(zcopytx_min_len)
 			     && !vhost_exceeds_maxpend(net)
 			     && vhost_net_tx_select_zcopy(net);
 
@@ -1329,6 +1337,11 @@ static int vhost_net_open(struct inode *inode, struct file *f)
 	vqs[VHOST_NET_VQ_RX] = &n->vqs[VHOST_NET_VQ_RX].vq;
 	n->vqs[VHOST_NET_VQ_TX].vq.handle_kick = handle_tx_kick;
 	n->vqs[VHOST_NET_VQ_RX].vq.handle_kick = handle_rx_kick;
+	/* Copy TX uses buffers in order with a zero length.  Zerocopy TX
+	 * marks packets sent by copy used right away, ahead of earlier
+	 * zerocopy packets whose DMA is still in flight, so it is not. */
+	n->vqs[VHOST_NET_VQ_TX].vq.used_in_order_batch = !experimental_zcopytx;
+	n->vqs[VHOST_NET_VQ_RX].vq.used_in_order_batch = false;
 	for (i = 0; i < VHOST_NET_VQ_MAX; i++) {
 		n->vqs[i].ubufs = NULL;
 		n->vqs[i].ubuf_info = NULL;
@@ -1632,6 +1645,14 @@ static long vhost_net_reset_owner(struct vhost_net *n)
 	return err;
 }
 
+static u64 vhost_net_features(void)
+{
+	/* See vhost_net_open() for why zerocopy TX is not in order. */
+	if (experimental_zcopytx)
+		return VHOST_NET_FEATURES;
+	return VHOST_NET_FEATURES | (1ULL << VIRTIO_F_IN_ORDER);
+}
+
 static int vhost_net_set_features(struct vhost_net *n, u64 features)
 {
 	size_t vhost_hlen, sock_hlen, hdr_len;
@@ -1712,14 +1733,14 @@ static long vhost_net_ioctl(struct file *f, unsigned int ioctl,
 			return -EFAULT;
 		return vhost_net_set_backend(n, backend.index, backend.fd);
 	case VHOST_GET_FEATURES:
-		features = VHOST_NET_FEATURES;
+		features = vhost_net_features();
 		if (copy_to_user(featurep, &features, sizeof features))
 			return -EFAULT;
 		return 0;
 	case VHOST_SET_FEATURES:
 		if (copy_from_user(&features, featurep, sizeof features))
 			return -EFAULT;
-		if (features & ~VHOST_NET_FEATURES)
+		if (features & ~vhost_net_features())
 			return -EOPNOTSUPP;
 		return vhost_net_set_features(n, features);
 	case VHOST_GET_BACKEND_FEATURES:
@@ -2378,12 +2378,19 @@ static int __vhost_add_used_n(struct vhost_virtqueue *vq,
 			    unsigned count)
 {
 	vring_used_elem_t __user *used;
+	unsigned int skip = 0;
 	u16 old, new;
 	int start;
 
-	start = vq->last_used_idx & (vq->num - 1);
+	/* The driver consumes in-order buffers up to the used index and
+	 * only needs the entry of the last one. */
+	if (count && vq->used_in_order_batch &&
+	    vhost_has_feature(vq, VIRTIO_F_IN_ORDER))
+		skip = count - 1;
+
+	start = (vq->last_used_idx + skip) & (vq->num - 1);
 	used = vq->used->ring + start;
-	if (vhost_put_used(vq, heads, start, count)) {
+	if (vhost_put_used(vq, heads + skip, start, count - skip)) {
 		vq_err(vq, "Failed to write used");
 		return -EFAULT;
 	}
@@ -2392,7 +2399,7 @@ static int __vhost_add_used_n(struct vhost_virtqueue *vq,
 		smp_wmb();
 		/* Log used ring entry write. */
 		log_used(vq, ((void __user *)used - (void __user *)vq->used),
-			 count * sizeof *used);
+			 (count - skip) * sizeof *used);
 	}
 	old = vq->last_used_idx;
 	new = (vq->last_used_idx += count);
@@ -108,6 +108,11 @@ struct vhost_virtqueue {
 	/* Last used index value we have signalled on */
 	bool signalled_used_valid;
 
+	/* Set by the device if the driver never looks at the used length
+	 * (e.g. net TX).  With VIRTIO_F_IN_ORDER, a batch of used buffers
+	 * then only needs the used ring entry of its last buffer. */
+	bool used_in_order_batch;
+
 	/* Log writes to used structure. */
 	bool log_used;
 	u64 log_addr;
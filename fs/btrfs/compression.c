@@ -985,6 +985,8 @@ static void btrfs_init_workspace_manager(int type)
 	spin_lock_init(&wsm->ws_lock);
 	atomic_set(&wsm->total_ws, 0);
 	init_waitqueue_head(&wsm->ws_wait);
+	/* The per-cpu cache is only an optimization, we can live without it */
+	wsm->pcpu_ws = alloc_percpu(struct list_head *);
 
 	/*
 	 * Preallocate one workspace for each compression type so we can
@@ -1013,6 +1015,40 @@ static void btrfs_cleanup_workspace_manager(int type)
 		free_workspace(type, ws);
 		atomic_dec(&wsman->total_ws);
 	}
+
+	if (wsman->pcpu_ws) {
+		int cpu;
+
+		for_each_possible_cpu(cpu) {
+			ws = *per_cpu_ptr(wsman->pcpu_ws, cpu);
+			if (ws) {
+				free_workspace(type, ws);
+				atomic_dec(&wsman->total_ws);
+			}
+		}
+		free_percpu(wsman->pcpu_ws);
+		wsman->pcpu_ws = NULL;
+	}
+}
+
+/*
+ * Take a workspace cached by any cpu, used when we hit the limit of allocated
+ * workspaces and would have to wait otherwise.
+ */
+static struct list_head *steal_pcpu_workspace(struct workspace_manager *wsm)
+{
+	struct list_head *ws;
+	int cpu;
+
+	if (!wsm->pcpu_ws)
+		return NULL;
+
+	for_each_possible_cpu(cpu) {
+		ws = xchg(per_cpu_ptr(wsm->pcpu_ws, cpu), NULL);
+		if (ws)
+			return ws;
+	}
+	return NULL;
 }
 
 /*
@@ -1040,6 +1076,13 @@ struct list_head *btrfs_get_workspace(int type, unsigned int level)
 	ws_wait	 = &wsm->ws_wait;
 	free_ws	 = &wsm->free_ws;
 
+	/* Try the workspace this cpu used last, without touching ws_lock */
+	if (wsm->pcpu_ws) {
+		workspace = this_cpu_xchg(*wsm->pcpu_ws, NULL);
+		if (workspace)
+			return workspace;
+	}
+
 again:
 	spin_lock(ws_lock);
 	if (!list_empty(idle_ws)) {
@@ -1055,6 +1098,16 @@ struct list_head *btrfs_get_workspace(int type, unsigned int level)
 
 		spin_unlock(ws_lock);
 		prepare_to_wait(ws_wait, &wait, TASK_UNINTERRUPTIBLE);
+		/*
+		 * Idle workspaces may be sitting in the per-cpu caches, check
+		 * them after queueing ourselves so that we either see a cached
+		 * workspace or get woken by btrfs_put_workspace().
+		 */
+		workspace = steal_pcpu_workspace(wsm);
+		if (workspace) {
+			finish_wait(ws_wait, &wait);
+			return workspace;
+		}
 		if (atomic_read(total_ws) > cpus && !*free_ws)
 			schedule();
 		finish_wait(ws_wait, &wait);
@@ -1117,8 +1170,8 @@ static struct list_head *get_workspace(int type, int level)
 }
 
 /*
- * put a workspace struct back on the list or free it if we have enough
- * idle ones sitting around
+ * put a workspace struct back in the per-cpu cache or on the list, or free it
+ * if we have enough idle ones sitting around
  */
 void btrfs_put_workspace(int type, struct list_head *ws)
 {
@@ -1136,6 +1189,10 @@ void btrfs_put_workspace(int type, struct list_head *ws)
 	ws_wait	 = &wsm->ws_wait;
 	free_ws	 = &wsm->free_ws;
 
+	/* Keep it cached on this cpu if the slot is empty */
+	if (wsm->pcpu_ws && !this_cpu_cmpxchg(*wsm->pcpu_ws, NULL, ws))
+		goto wake;
+
 	spin_lock(ws_lock);
 	if (*free_ws <= num_online_cpus()) {
 		list_add(ws, idle_ws);
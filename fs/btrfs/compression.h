@@ -118,6 +118,8 @@ struct workspace_manager {
 	atomic_t total_ws;
 	/* Waiters for a free workspace */
 	wait_queue_head_t ws_wait;
+	/* One cached workspace per cpu, not accounted in free_ws */
+	struct list_head * __percpu *pcpu_ws;
 };
 
 struct list_head *btrfs_get_workspace(int type, unsigned int level);
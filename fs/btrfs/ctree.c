@@ -742,10 +742,11 @@ int btrfs_realloc_node(struct btrfs_trans_handle *trans,
  */
 static noinline int generic_bin_search(struct extent_buffer *eb,
 				       unsigned long p, int item_size,
+				       int nritems,
 				       const struct btrfs_key *key, int *slot)
 {
 	int low = 0;
-	int high = btrfs_header_nritems(eb);
+	int high = nritems;
 	int ret;
 	const int key_size = sizeof(struct btrfs_disk_key);
 
@@ -804,11 +805,13 @@ int btrfs_bin_search(struct extent_buffer *eb, const struct btrfs_key *key,
 	if (btrfs_header_level(eb) == 0)
 		return generic_bin_search(eb,
 					  offsetof(struct btrfs_leaf, items),
-					  sizeof(struct btrfs_item), key, slot);
+					  sizeof(struct btrfs_item),
+					  btrfs_header_nritems(eb), key, slot);
 	else
 		return generic_bin_search(eb,
 					  offsetof(struct btrfs_node, ptrs),
-					  sizeof(struct btrfs_key_ptr), key, slot);
+					  sizeof(struct btrfs_key_ptr),
+					  btrfs_header_nritems(eb), key, slot);
 }
 
 static void root_add_used(struct btrfs_root *root, u32 size)
@@ -1579,8 +1582,99 @@ int btrfs_find_item(struct btrfs_root *fs_root, struct btrfs_path *path,
 	return 0;
 }
 
+/*
+ * Try to step over the root node of a tree without taking its lock.
+ *
+ * Every search has to go through the root node, so for read-only searches its
+ * lock becomes the hottest lock of the tree even though the rwsem is taken for
+ * read most of the time.  Writers bump eb->lock_seq while they hold the write
+ * lock, so we can search the root node optimistically, read lock the child we
+ * found and then validate that the root wasn't write locked in the meantime.
+ *
+ * On success the root is left in the path unlocked (just as if the search
+ * already went past it) and the read locked child is returned.  Returns NULL
+ * if the caller must fall back to locking the root node.
+ */
+static struct extent_buffer *btrfs_search_root_lockless(struct btrfs_root *root,
+							struct btrfs_path *p,
+							const struct btrfs_key *key)
+{
+	struct btrfs_fs_info *fs_info = root->fs_info;
+	struct extent_buffer *b;
+	struct extent_buffer *child;
+	unsigned int seq;
+	u32 nritems;
+	u64 blockptr;
+	u64 gen;
+	int level;
+	int slot;
+	int ret;
+
+	b = btrfs_root_node(root);
+	seq = raw_read_seqcount(&b->lock_seq);
+	if (seq & 1)
+		goto fallback;
+
+	level = btrfs_header_level(b);
+	nritems = btrfs_header_nritems(b);
+	if (level == 0 || level >= BTRFS_MAX_LEVEL || level <= p->lowest_level ||
+	    nritems == 0 || nritems > BTRFS_NODEPTRS_PER_BLOCK(fs_info) ||
+	    !extent_buffer_uptodate(b))
+		goto fallback;
+
+	ret = generic_bin_search(b, offsetof(struct btrfs_node, ptrs),
+				 sizeof(struct btrfs_key_ptr), nritems, key,
+				 &slot);
+	if (ret < 0)
+		goto fallback;
+	if (ret && slot > 0)
+		slot--;
+	blockptr = btrfs_node_blockptr(b, slot);
+	gen = btrfs_node_ptr_generation(b, slot);
+	if (read_seqcount_retry(&b->lock_seq, seq))
+		goto fallback;
+
+	/* Only take the fast path if the child is cached and uptodate */
+	child = find_extent_buffer(fs_info, blockptr);
+	if (!child)
+		goto fallback;
+	if (btrfs_buffer_uptodate(child, gen, 1) <= 0 ||
+	    btrfs_header_level(child) != level - 1) {
+		free_extent_buffer(child);
+		goto fallback;
+	}
+
+	btrfs_maybe_reset_lockdep_class(root, child);
+	btrfs_tree_read_lock(child);
+
+	/*
+	 * If nobody write locked the root since we sampled the sequence the
+	 * pointer we followed is still valid and the child is what a locked
+	 * search would have found.
+	 */
+	if (read_seqcount_retry(&b->lock_seq, seq) ||
+	    rcu_access_pointer(root->node) != b) {
+		btrfs_tree_read_unlock(child);
+		free_extent_buffer(child);
+		goto fallback;
+	}
+
+	trace_btrfs_search_root_lockless(b);
+	p->nodes[level] = b;
+	p->slots[level] = slot;
+	p->locks[level] = 0;
+	p->locks[level - 1] = BTRFS_READ_LOCK;
+	return child;
+
+fallback:
+	trace_btrfs_search_root_lockless_fallback(b);
+	free_extent_buffer(b);
+	return NULL;
+}
+
 static struct extent_buffer *btrfs_search_slot_get_root(struct btrfs_root *root,
 							struct btrfs_path *p,
+							const struct btrfs_key *key,
 							int write_lock_level)
 {
 	struct extent_buffer *b;
@@ -1606,6 +1700,16 @@ static struct extent_buffer *btrfs_search_slot_get_root(struct btrfs_root *root,
 		goto out;
 	}
 
+	/*
+	 * Plain searches that don't keep locks don't need the root locked once
+	 * they moved past it, try to avoid taking its lock at all.
+	 */
+	if (write_lock_level < 0 && !p->keep_locks) {
+		b = btrfs_search_root_lockless(root, p, key);
+		if (b)
+			return b;
+	}
+
 	/* We try very hard to do read locks on the root */
 	root_lock = BTRFS_READ_LOCK;
 
@@ -1776,7 +1880,7 @@ int btrfs_search_slot(struct btrfs_trans_handle *trans, struct btrfs_root *root,
 
 again:
 	prev_cmp = -1;
-	b = btrfs_search_slot_get_root(root, p, write_lock_level);
+	b = btrfs_search_slot_get_root(root, p, key, write_lock_level);
 	if (IS_ERR(b)) {
 		ret = PTR_ERR(b);
 		goto done;
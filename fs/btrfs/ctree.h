@@ -970,6 +970,9 @@ struct btrfs_fs_info {
 	struct work_struct async_data_reclaim_work;
 	struct work_struct preempt_reclaim_work;
 
+	/* Runs delayed refs in the background while the transaction is open */
+	struct work_struct async_delayed_ref_work;
+
 	/* Reclaim partially filled block groups in the background */
 	struct work_struct reclaim_bgs_work;
 	struct list_head reclaim_bgs;
@@ -2703,6 +2706,8 @@ int btrfs_add_excluded_extent(struct btrfs_fs_info *fs_info,
 void btrfs_free_excluded_extents(struct btrfs_block_group *cache);
 int btrfs_run_delayed_refs(struct btrfs_trans_handle *trans,
 			   unsigned long count);
+void btrfs_init_async_delayed_ref_work(struct btrfs_fs_info *fs_info);
+void btrfs_kick_async_delayed_refs(struct btrfs_trans_handle *trans);
 void btrfs_cleanup_ref_head_accounting(struct btrfs_fs_info *fs_info,
 				  struct btrfs_delayed_ref_root *delayed_refs,
 				  struct btrfs_delayed_ref_head *head);
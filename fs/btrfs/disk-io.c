@@ -2256,24 +2256,27 @@ static int btrfs_init_workqueues(struct btrfs_fs_info *fs_info,
 
 	/*
 	 * endios are largely parallel and should have a very
-	 * low idle thresh
+	 * low idle thresh.  They mostly touch the bio and pages the
+	 * submitter just had in its cache, keep them within the LLC of
+	 * the completing CPU.
 	 */
 	fs_info->endio_workers =
-		btrfs_alloc_workqueue(fs_info, "endio", flags, max_active, 4);
+		btrfs_alloc_workqueue(fs_info, "endio",
+				      flags | WQ_CACHE_AFFINE, max_active, 4);
 	fs_info->endio_meta_workers =
-		btrfs_alloc_workqueue(fs_info, "endio-meta", flags,
-				      max_active, 4);
+		btrfs_alloc_workqueue(fs_info, "endio-meta",
+				      flags | WQ_CACHE_AFFINE, max_active, 4);
 	fs_info->endio_meta_write_workers =
-		btrfs_alloc_workqueue(fs_info, "endio-meta-write", flags,
-				      max_active, 2);
+		btrfs_alloc_workqueue(fs_info, "endio-meta-write",
+				      flags | WQ_CACHE_AFFINE, max_active, 2);
 	fs_info->endio_raid56_workers =
-		btrfs_alloc_workqueue(fs_info, "endio-raid56", flags,
-				      max_active, 4);
+		btrfs_alloc_workqueue(fs_info, "endio-raid56",
+				      flags | WQ_CACHE_AFFINE, max_active, 4);
 	fs_info->rmw_workers =
 		btrfs_alloc_workqueue(fs_info, "rmw", flags, max_active, 2);
 	fs_info->endio_write_workers =
-		btrfs_alloc_workqueue(fs_info, "endio-write", flags,
-				      max_active, 2);
+		btrfs_alloc_workqueue(fs_info, "endio-write",
+				      flags | WQ_CACHE_AFFINE, max_active, 2);
 	fs_info->endio_freespace_worker =
 		btrfs_alloc_workqueue(fs_info, "freespace-write", flags,
 				      max_active, 0);
@@ -2910,6 +2913,7 @@ void btrfs_init_fs_info(struct btrfs_fs_info *fs_info)
 #endif
 	btrfs_init_balance(fs_info);
 	btrfs_init_async_reclaim_work(fs_info);
+	btrfs_init_async_delayed_ref_work(fs_info);
 
 	spin_lock_init(&fs_info->block_group_cache_lock);
 	fs_info->block_group_cache_tree = RB_ROOT;
@@ -4443,6 +4447,9 @@ void __cold close_ctree(struct btrfs_fs_info *fs_info)
 			btrfs_err(fs_info, "commit super ret %d", ret);
 	}
 
+	/* Nothing can kick it anymore once the last transaction is committed */
+	cancel_work_sync(&fs_info->async_delayed_ref_work);
+
 	if (test_bit(BTRFS_FS_STATE_ERROR, &fs_info->fs_state) ||
 	    test_bit(BTRFS_FS_STATE_TRANS_ABORTED, &fs_info->fs_state))
 		btrfs_error_commit_super(fs_info);
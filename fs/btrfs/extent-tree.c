@@ -2179,6 +2179,91 @@ int btrfs_run_delayed_refs(struct btrfs_trans_handle *trans,
 	return 0;
 }
 
+/*
+ * Minimum number of ref heads a background pass runs before giving the
+ * transaction back, so that the join/end overhead stays amortized.
+ */
+#define BTRFS_ASYNC_DELAYED_REFS_BATCH	64
+
+/*
+ * Run delayed refs in the background while the transaction is still open.
+ *
+ * Instead of leaving everything queued for btrfs_commit_transaction() we keep
+ * draining ref heads as they come in, a quarter of the ready heads at a time.
+ * Each batch runs in its own short lived join handle so we never hold up a
+ * commit for longer than one batch, and we stop as soon as a commit started
+ * since it'll run whatever is left anyway.
+ */
+static void btrfs_async_run_delayed_refs(struct work_struct *work)
+{
+	struct btrfs_fs_info *fs_info;
+	struct btrfs_trans_handle *trans;
+	struct btrfs_delayed_ref_root *delayed_refs;
+	unsigned long ready;
+	unsigned long count;
+	int throttle;
+
+	fs_info = container_of(work, struct btrfs_fs_info,
+			       async_delayed_ref_work);
+
+	while (!btrfs_transaction_in_commit(fs_info)) {
+		trans = btrfs_join_transaction_nostart(fs_info->extent_root);
+		if (IS_ERR(trans))
+			return;
+
+		delayed_refs = &trans->transaction->delayed_refs;
+		ready = READ_ONCE(delayed_refs->num_heads_ready);
+		if (!ready || test_bit(BTRFS_DELAYED_REFS_FLUSHING,
+				       &delayed_refs->flags)) {
+			btrfs_end_transaction(trans);
+			return;
+		}
+
+		count = max_t(unsigned long, ready / 4,
+			      BTRFS_ASYNC_DELAYED_REFS_BATCH);
+		if (btrfs_run_delayed_refs(trans, count)) {
+			btrfs_end_transaction(trans);
+			return;
+		}
+
+		throttle = btrfs_should_throttle_delayed_refs(trans);
+		/* Refs come in faster than we can run them, let commit catch up */
+		if (READ_ONCE(delayed_refs->num_heads_ready) >= ready)
+			throttle = 0;
+		btrfs_end_transaction(trans);
+		if (!throttle)
+			return;
+		cond_resched();
+	}
+}
+
+void btrfs_init_async_delayed_ref_work(struct btrfs_fs_info *fs_info)
+{
+	INIT_WORK(&fs_info->async_delayed_ref_work,
+		  btrfs_async_run_delayed_refs);
+}
+
+/*
+ * Called when a transaction handle is released, start running delayed refs
+ * in the background once enough of them piled up.
+ */
+void btrfs_kick_async_delayed_refs(struct btrfs_trans_handle *trans)
+{
+	struct btrfs_fs_info *fs_info = trans->fs_info;
+	struct btrfs_transaction *cur_trans = trans->transaction;
+
+	if (current_work() == &fs_info->async_delayed_ref_work)
+		return;
+	if (cur_trans->state >= TRANS_STATE_COMMIT_START ||
+	    TRANS_ABORTED(trans) ||
+	    test_bit(BTRFS_DELAYED_REFS_FLUSHING, &cur_trans->delayed_refs.flags))
+		return;
+	if (!READ_ONCE(cur_trans->delayed_refs.num_heads_ready))
+		return;
+	if (btrfs_should_throttle_delayed_refs(trans))
+		queue_work(system_unbound_wq, &fs_info->async_delayed_ref_work);
+}
+
 int btrfs_set_disk_extent_flags(struct btrfs_trans_handle *trans,
 				struct extent_buffer *eb, u64 flags,
 				int level, int is_data)
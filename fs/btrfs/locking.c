@@ -114,6 +114,10 @@ void btrfs_maybe_reset_lockdep_class(struct btrfs_root *root, struct extent_buff
  *
  * The rwsem implementation does opportunistic spinning which reduces number of
  * times the locking task needs to sleep.
+ *
+ * Write lockers additionally make eb->lock_seq odd for as long as they hold
+ * the lock, so read-only searches can validate what they read from the root
+ * node without taking its lock (see btrfs_search_root_lockless()).
  */
 
 /*
@@ -163,6 +167,7 @@ int btrfs_try_tree_write_lock(struct extent_buffer *eb)
 {
 	if (down_write_trylock(&eb->lock)) {
 		eb->lock_owner = current->pid;
+		raw_write_seqcount_begin(&eb->lock_seq);
 		trace_btrfs_try_tree_write_lock(eb);
 		return 1;
 	}
@@ -195,6 +200,7 @@ void __btrfs_tree_lock(struct extent_buffer *eb, enum btrfs_lock_nesting nest)
 
 	down_write_nested(&eb->lock, nest);
 	eb->lock_owner = current->pid;
+	raw_write_seqcount_begin(&eb->lock_seq);
 	trace_btrfs_tree_lock(eb, start_ns);
 }
 
@@ -209,6 +215,7 @@ void btrfs_tree_lock(struct extent_buffer *eb)
 void btrfs_tree_unlock(struct extent_buffer *eb)
 {
 	trace_btrfs_tree_unlock(eb);
+	raw_write_seqcount_end(&eb->lock_seq);
 	eb->lock_owner = 0;
 	up_write(&eb->lock);
 }
@@ -1012,6 +1012,8 @@ static int __btrfs_end_transaction(struct btrfs_trans_handle *trans,
 
 	btrfs_create_pending_block_groups(trans);
 
+	btrfs_kick_async_delayed_refs(trans);
+
 	btrfs_trans_release_chunk_metadata(trans);
 
 	if (trans->type & __TRANS_FREEZABLE)
@@ -25,6 +25,7 @@
 #include <linux/sizes.h>
 #include <linux/mmu_notifier.h>
 #include <linux/iomap.h>
+#include <linux/memblock.h>
 #include <asm/pgalloc.h>
 
 #define CREATE_TRACE_POINTS
@@ -41,9 +42,13 @@ static inline unsigned int pe_order(enum page_entry_size pe_size)
 	return ~0;
 }
 
-/* We choose 4096 entries - same as per-zone page wait tables */
-#define DAX_WAIT_TABLE_BITS 12
-#define DAX_WAIT_TABLE_ENTRIES (1 << DAX_WAIT_TABLE_BITS)
+/*
+ * At least 4096 entries - same as per-zone page wait tables - and more on
+ * large machines, where many CPUs faulting on DAX files otherwise keep
+ * colliding on the same wait queues.
+ */
+#define DAX_WAIT_TABLE_MIN_BITS 12
+#define DAX_WAIT_TABLE_PER_CPU	256
 
 /* The 'colour' (ie low bits) within a PMD of a page offset.  */
 #define PG_PMD_COLOUR	((PMD_SIZE >> PAGE_SHIFT) - 1)
@@ -52,13 +57,20 @@ static inline unsigned int pe_order(enum page_entry_size pe_size)
 /* The order of a PMD entry */
 #define PMD_ORDER	(PMD_SHIFT - PAGE_SHIFT)
 
-static wait_queue_head_t wait_table[DAX_WAIT_TABLE_ENTRIES];
+static wait_queue_head_t *wait_table __read_mostly;
+static unsigned int wait_table_bits __read_mostly;
 
 static int __init init_dax_wait_table(void)
 {
-	int i;
-
-	for (i = 0; i < DAX_WAIT_TABLE_ENTRIES; i++)
+	unsigned long i;
+
+	wait_table = alloc_large_system_hash("DAX wait",
+					     sizeof(wait_queue_head_t),
+					     num_possible_cpus() *
+					     DAX_WAIT_TABLE_PER_CPU,
+					     0, 0, &wait_table_bits, NULL,
+					     1UL << DAX_WAIT_TABLE_MIN_BITS, 0);
+	for (i = 0; i < 1UL << wait_table_bits; i++)
 		init_waitqueue_head(wait_table + i);
 	return 0;
 }
@@ -170,7 +182,7 @@ static wait_queue_head_t *dax_entry_waitqueue(struct xa_state *xas,
 	key->xa = xas->xa;
 	key->entry_start = index;
 
-	hash = hash_long((unsigned long)xas->xa ^ index, DAX_WAIT_TABLE_BITS);
+	hash = hash_long((unsigned long)xas->xa ^ index, wait_table_bits);
 	return wait_table + hash;
 }
 
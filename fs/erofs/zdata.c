@@ -124,6 +124,9 @@ typedef tagptr1_t compressed_page_t;
 
 static struct workqueue_struct *z_erofs_workqueue __read_mostly;
 
+/* max pclusters decompressed by one background worker before splitting */
+#define Z_EROFS_DECOMPRESS_BATCH	4
+
 void z_erofs_exit_zip_subsystem(void)
 {
 	destroy_workqueue(z_erofs_workqueue);
@@ -1057,6 +1060,39 @@ static void z_erofs_decompress_queue(const struct z_erofs_decompressqueue *io,
 	}
 }
 
+/*
+ * Keep the first Z_EROFS_DECOMPRESS_BATCH pclusters of a background queue
+ * and hand the rest over to another erofs_unzipd worker, which splits it
+ * again in turn.  That way a large readahead is decompressed on several
+ * CPUs instead of by a single kworker.
+ */
+static void z_erofs_decompressqueue_split(struct z_erofs_decompressqueue *io)
+{
+	z_erofs_next_pcluster_t owned = io->head;
+	struct z_erofs_decompressqueue *q;
+	struct z_erofs_pcluster *pcl;
+	unsigned int nr = 0;
+
+	if (num_online_cpus() <= 1)
+		return;
+
+	do {
+		pcl = container_of(owned, struct z_erofs_pcluster, next);
+		owned = READ_ONCE(pcl->next);
+		if (owned == Z_EROFS_PCLUSTER_TAIL_CLOSED)
+			return;
+	} while (++nr < Z_EROFS_DECOMPRESS_BATCH);
+
+	q = kvzalloc(sizeof(*q), GFP_NOFS | __GFP_NOWARN);
+	if (!q)
+		return;		/* just decompress all of them here */
+	INIT_WORK(&q->u.work, z_erofs_decompressqueue_work);
+	q->sb = io->sb;
+	q->head = owned;
+	WRITE_ONCE(pcl->next, Z_EROFS_PCLUSTER_TAIL_CLOSED);
+	queue_work(z_erofs_workqueue, &q->u.work);
+}
+
 static void z_erofs_decompressqueue_work(struct work_struct *work)
 {
 	struct z_erofs_decompressqueue *bgq =
@@ -1064,6 +1100,7 @@ static void z_erofs_decompressqueue_work(struct work_struct *work)
 	LIST_HEAD(pagepool);
 
 	DBG_BUGON(bgq->head == Z_EROFS_PCLUSTER_TAIL_CLOSED);
+	z_erofs_decompressqueue_split(bgq);
 	z_erofs_decompress_queue(bgq, &pagepool);
 
 	put_pages_list(&pagepool);
@@ -220,6 +220,11 @@ struct eventpoll {
 #ifdef CONFIG_NET_RX_BUSY_POLL
 	/* used to track busy poll napi_id */
 	unsigned int napi_id;
+	/* busy poll timeout, 0 means use the global sysctl */
+	u32 busy_poll_usecs;
+	/* busy poll packet budget, 0 means BUSY_POLL_BUDGET */
+	u16 busy_poll_budget;
+	bool prefer_busy_poll;
 #endif
 
 #ifdef CONFIG_DEBUG_LOCK_ALLOC
@@ -376,26 +381,51 @@ static inline int ep_events_available(struct eventpoll *ep)
 }
 
 #ifdef CONFIG_NET_RX_BUSY_POLL
+/*
+ * Return the busy poll timeout of this instance, falling back to the global
+ * net.core.busy_poll sysctl if it wasn't set through EPIOCSPARAMS.
+ */
+static unsigned long ep_busy_poll_usecs(struct eventpoll *ep)
+{
+	return READ_ONCE(ep->busy_poll_usecs) ?: READ_ONCE(sysctl_net_busy_poll);
+}
+
+static bool ep_busy_loop_on(struct eventpoll *ep)
+{
+	return !!ep_busy_poll_usecs(ep);
+}
+
 static bool ep_busy_loop_end(void *p, unsigned long start_time)
 {
 	struct eventpoll *ep = p;
+	unsigned long bp_usec;
 
-	return ep_events_available(ep) || busy_loop_timeout(start_time);
+	if (ep_events_available(ep))
+		return true;
+
+	bp_usec = ep_busy_poll_usecs(ep);
+	return !bp_usec ||
+	       time_after(busy_loop_current_time(), start_time + bp_usec);
 }
 
 /*
- * Busy poll if globally on and supporting sockets found && no events,
- * busy loop will return if need_resched or ep_events_available.
+ * Busy poll if globally or per instance on and supporting sockets found &&
+ * no events, busy loop will return if need_resched or ep_events_available.
  *
  * we must do our busy polling with irqs enabled
  */
 static bool ep_busy_loop(struct eventpoll *ep, int nonblock)
 {
 	unsigned int napi_id = READ_ONCE(ep->napi_id);
+	u16 budget = READ_ONCE(ep->busy_poll_budget);
+	bool prefer_busy_poll = READ_ONCE(ep->prefer_busy_poll);
+
+	if (!budget)
+		budget = BUSY_POLL_BUDGET;
 
-	if ((napi_id >= MIN_NAPI_ID) && net_busy_loop_on()) {
-		napi_busy_loop(napi_id, nonblock ? NULL : ep_busy_loop_end, ep, false,
-			       BUSY_POLL_BUDGET);
+	if ((napi_id >= MIN_NAPI_ID) && ep_busy_loop_on(ep)) {
+		napi_busy_loop(napi_id, nonblock ? NULL : ep_busy_loop_end, ep,
+			       prefer_busy_poll, budget);
 		if (ep_events_available(ep))
 			return true;
 		/*
@@ -414,12 +444,12 @@ static bool ep_busy_loop(struct eventpoll *ep, int nonblock)
  */
 static inline void ep_set_busy_poll_napi_id(struct epitem *epi)
 {
-	struct eventpoll *ep;
+	struct eventpoll *ep = epi->ep;
 	unsigned int napi_id;
 	struct socket *sock;
 	struct sock *sk;
 
-	if (!net_busy_loop_on())
+	if (!ep_busy_loop_on(ep))
 		return;
 
 	sock = sock_from_file(epi->ffd.file);
@@ -431,7 +461,6 @@ static inline void ep_set_busy_poll_napi_id(struct epitem *epi)
 		return;
 
 	napi_id = READ_ONCE(sk->sk_napi_id);
-	ep = epi->ep;
 
 	/* Non-NAPI IDs can be rejected
 	 *	or
@@ -457,6 +486,61 @@ static inline void ep_set_busy_poll_napi_id(struct epitem *epi)
 
 #endif /* CONFIG_NET_RX_BUSY_POLL */
 
+#ifdef CONFIG_NET_RX_BUSY_POLL
+static long ep_eventpoll_bp_ioctl(struct file *file, unsigned int cmd,
+				  unsigned long arg)
+{
+	struct eventpoll *ep = file->private_data;
+	void __user *uarg = (void __user *)arg;
+	struct epoll_params epoll_params;
+
+	switch (cmd) {
+	case EPIOCSPARAMS:
+		if (copy_from_user(&epoll_params, uarg, sizeof(epoll_params)))
+			return -EFAULT;
+
+		/* pad byte must be zero */
+		if (epoll_params.__pad)
+			return -EINVAL;
+
+		if (epoll_params.busy_poll_usecs > S32_MAX)
+			return -EINVAL;
+
+		if (epoll_params.prefer_busy_poll > 1)
+			return -EINVAL;
+
+		/* Same limit as SO_BUSY_POLL_BUDGET for unprivileged users */
+		if (epoll_params.busy_poll_budget > NAPI_POLL_WEIGHT &&
+		    !capable(CAP_NET_ADMIN))
+			return -EPERM;
+
+		WRITE_ONCE(ep->busy_poll_usecs, epoll_params.busy_poll_usecs);
+		WRITE_ONCE(ep->busy_poll_budget, epoll_params.busy_poll_budget);
+		WRITE_ONCE(ep->prefer_busy_poll, epoll_params.prefer_busy_poll);
+		return 0;
+	case EPIOCGPARAMS:
+		memset(&epoll_params, 0, sizeof(epoll_params));
+		epoll_params.busy_poll_usecs = READ_ONCE(ep->busy_poll_usecs);
+		epoll_params.busy_poll_budget = READ_ONCE(ep->busy_poll_budget);
+		epoll_params.prefer_busy_poll = READ_ONCE(ep->prefer_busy_poll);
+		if (copy_to_user(uarg, &epoll_params, sizeof(epoll_params)))
+			return -EFAULT;
+		return 0;
+	default:
+		return -ENOIOCTLCMD;
+	}
+}
+
+#else
+
+static inline long ep_eventpoll_bp_ioctl(struct file *file, unsigned int cmd,
+					 unsigned long arg)
+{
+	return -EOPNOTSUPP;
+}
+
+#endif /* CONFIG_NET_RX_BUSY_POLL */
+
 /*
  * As described in commit 0ccf831cb lockdep: annotate epoll
  * the use of wait queues used by epoll is done in a very controlled
@@ -881,6 +965,18 @@ static void ep_show_fdinfo(struct seq_file *m, struct file *f)
 #endif
 
 /* File callbacks that implement the eventpoll file behaviour */
+static long ep_eventpoll_ioctl(struct file *file, unsigned int cmd,
+			       unsigned long arg)
+{
+	switch (cmd) {
+	case EPIOCSPARAMS:
+	case EPIOCGPARAMS:
+		return ep_eventpoll_bp_ioctl(file, cmd, arg);
+	default:
+		return -EINVAL;
+	}
+}
+
 static const struct file_operations eventpoll_fops = {
 #ifdef CONFIG_PROC_FS
 	.show_fdinfo	= ep_show_fdinfo,
@@ -888,6 +984,8 @@ static const struct file_operations eventpoll_fops = {
 	.release	= ep_eventpoll_release,
 	.poll		= ep_eventpoll_poll,
 	.llseek		= noop_llseek,
+	.unlocked_ioctl	= ep_eventpoll_ioctl,
+	.compat_ioctl	= compat_ptr_ioctl,
 };
 
 /*
@@ -1134,6 +1232,7 @@ static int ep_poll_callback(wait_queue_entry_t *wait, unsigned mode, int sync, v
 	__poll_t pollflags = key_to_poll(key);
 	unsigned long flags;
 	int ewake = 0;
+	bool queued = false;
 
 	read_lock_irqsave(&ep->lock, flags);
 
@@ -1164,19 +1263,28 @@ static int ep_poll_callback(wait_queue_entry_t *wait, unsigned mode, int sync, v
 	 * chained in ep->ovflist and requeued later on.
 	 */
 	if (READ_ONCE(ep->ovflist) != EP_UNACTIVE_PTR) {
-		if (chain_epi_lockless(epi))
+		if (chain_epi_lockless(epi)) {
 			ep_pm_stay_awake_rcu(epi);
+			queued = true;
+		}
 	} else if (!ep_is_linked(epi)) {
 		/* In the usual case, add event to ready list. */
-		if (list_add_tail_lockless(&epi->rdllink, &ep->rdllist))
+		if (list_add_tail_lockless(&epi->rdllink, &ep->rdllist)) {
 			ep_pm_stay_awake_rcu(epi);
+			queued = true;
+		}
 	}
 
 	/*
 	 * Wake up ( if active ) both the eventpoll wait list and the ->poll()
 	 * wait list.
+	 *
+	 * If the item was already queued, whoever queued it already woke up a
+	 * waiter that is going to harvest it, and ep_done_scan() wakes up the
+	 * next one if events are left behind. Waking up yet another exclusive
+	 * waiter would only have it contend on ep->mtx for nothing.
 	 */
-	if (waitqueue_active(&ep->wq)) {
+	if (queued && waitqueue_active(&ep->wq)) {
 		if ((epi->event.events & EPOLLEXCLUSIVE) &&
 					!(pollflags & POLLFREE)) {
 			switch (pollflags & EPOLLINOUT_BITS) {
@@ -1195,6 +1303,16 @@ static int ep_poll_callback(wait_queue_entry_t *wait, unsigned mode, int sync, v
 		}
 		wake_up(&ep->wq);
 	}
+
+	/*
+	 * An exclusive item that is already pending gets harvested by the
+	 * waiter woken when it was queued. Report the wakeup as consumed, so
+	 * that it isn't passed on to the next exclusive epoll instance.
+	 */
+	if (!queued && (epi->event.events & EPOLLEXCLUSIVE) &&
+	    !(pollflags & POLLFREE))
+		ewake = 1;
+
 	if (waitqueue_active(&ep->poll_wait))
 		pwake++;
 
@@ -1648,6 +1766,20 @@ static int ep_send_events(struct eventpoll *ep,
 	init_poll_funcptr(&pt, NULL);
 
 	mutex_lock(&ep->mtx);
+
+	/*
+	 * With many threads waiting on the same instance, a previous holder
+	 * of ep->mtx may have harvested everything while we were waiting for
+	 * it. Don't bother scanning an empty list in that case, since that
+	 * would also divert the poll callbacks to ->ovflist for nothing. If
+	 * an event shows up right after this check, the poll callback wakes
+	 * up ep->wq and ep_poll() rechecks under the lock before sleeping.
+	 */
+	if (!ep_events_available(ep)) {
+		mutex_unlock(&ep->mtx);
+		return 0;
+	}
+
 	ep_start_scan(ep, &txlist);
 
 	/*
@@ -1601,8 +1601,8 @@ struct ext4_sb_info {
 	unsigned int s_mb_max_inode_prealloc;
 	unsigned int s_max_dir_size_kb;
 	/* where last allocation was done - for stream allocation */
-	unsigned long s_mb_last_group;
-	unsigned long s_mb_last_start;
+	ext4_group_t *s_mb_last_groups;
+	unsigned int s_mb_nr_global_goals;
 	unsigned int s_mb_prefetch;
 	unsigned int s_mb_prefetch_limit;
 
@@ -1620,6 +1620,8 @@ struct ext4_sb_info {
 	atomic64_t s_bal_cX_groups_considered[4];
 	atomic64_t s_bal_cX_hits[4];
 	atomic64_t s_bal_cX_failed[4];		/* cX loop didn't find blocks */
+	atomic64_t s_bal_busy_skipped;	/* busy groups skipped at cr < 3 */
+	atomic64_t s_bal_lock_contended; /* group trylock failures */
 	atomic_t s_mb_buddies_generated;	/* number of buddies generated */
 	atomic64_t s_mb_generation_time;
 	atomic_t s_mb_lost_chunks;
@@ -2923,6 +2925,7 @@ void __ext4_fc_track_create(handle_t *handle, struct inode *inode,
 			    struct dentry *dentry);
 void ext4_fc_track_create(handle_t *handle, struct dentry *dentry);
 void ext4_fc_track_inode(handle_t *handle, struct inode *inode);
+bool ext4_fc_logs_inode_xattrs(struct super_block *sb);
 void ext4_fc_mark_ineligible(struct super_block *sb, int reason, handle_t *handle);
 void ext4_fc_start_update(struct inode *inode);
 void ext4_fc_stop_update(struct inode *inode);
@@ -3439,6 +3442,7 @@ struct ext4_group_info {
 	struct rw_semaphore alloc_sem;
 	struct rb_node	bb_avg_fragment_size_rb;
 	struct list_head bb_largest_free_order_node;
+	unsigned int	bb_contended;	/* nr of failed group trylocks */
 	ext4_grpblk_t	bb_counters[];	/* Nr of free power-of-two-block
 					 * regions, index is order.
 					 * bb_counters[3] = 5 means
@@ -3509,6 +3513,24 @@ static inline void ext4_lock_group(struct super_block *sb, ext4_group_t group)
 	}
 }
 
+/*
+ * Try to take the group lock without spinning.  Returns true if the lock
+ * was acquired; callers that can go look at another group use this to
+ * avoid serialising behind a busy one.
+ */
+static inline bool ext4_try_lock_group(struct super_block *sb,
+				       ext4_group_t group)
+{
+	if (!spin_trylock(ext4_group_lock_ptr(sb, group)))
+		return false;
+	/*
+	 * We're able to grab the lock right away, so drop the
+	 * lock contention counter.
+	 */
+	atomic_add_unless(&EXT4_SB(sb)->s_lock_busy, -1, 0);
+	return true;
+}
+
 static inline void ext4_unlock_group(struct super_block *sb,
 					ext4_group_t group)
 {
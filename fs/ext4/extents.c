@@ -5364,7 +5364,12 @@ static int ext4_collapse_range(struct file *file, loff_t offset, loff_t len)
 		ret = PTR_ERR(handle);
 		goto out_mmap;
 	}
-	ext4_fc_mark_ineligible(sb, EXT4_FC_REASON_FALLOC_RANGE, handle);
+	/*
+	 * Every extent from punch_start onwards moves, so log the whole tail
+	 * of the file: the fast commit records the new mapping and a
+	 * DEL_RANGE for what is left beyond the new end.
+	 */
+	ext4_fc_track_range(handle, inode, punch_start, EXT_MAX_BLOCKS - 1);
 
 	down_write(&EXT4_I(inode)->i_data_sem);
 	ext4_discard_preallocations(inode, 0);
@@ -5509,7 +5514,8 @@ static int ext4_insert_range(struct file *file, loff_t offset, loff_t len)
 		ret = PTR_ERR(handle);
 		goto out_mmap;
 	}
-	ext4_fc_mark_ineligible(sb, EXT4_FC_REASON_FALLOC_RANGE, handle);
+	/* As for collapse range, log everything from offset_lblk onwards */
+	ext4_fc_track_range(handle, inode, offset_lblk, EXT_MAX_BLOCKS - 1);
 
 	/* Expand file to avoid data loss if there is error while shifting */
 	inode->i_size += len;
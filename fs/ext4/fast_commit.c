@@ -40,7 +40,10 @@
  * - EXT4_FC_TAG_INODE		- record the inode that should be replayed
  *				  during recovery. Note that iblocks field is
  *				  not replayed and instead derived during
- *				  replay.
+ *				  replay. When it fits, the whole on-disk
+ *				  inode is recorded, so that changes to
+ *				  in-inode extended attributes are replayed
+ *				  too.
  * Commit Operation
  * ----------------
  * With fast commits, we maintain all the directory entry operations in the
@@ -67,7 +70,8 @@
  * -------------------------
  *
  * Not all operations are supported by fast commits today (e.g extended
- * attributes). Fast commit ineligibility is marked by calling
+ * attributes stored outside the inode, renames of directories). Fast commit
+ * ineligibility is marked by calling
  * ext4_fc_mark_ineligible(): This makes next fast commit operation to fall back
  * to full commit.
  *
@@ -786,6 +790,18 @@ static bool ext4_fc_add_dentry_tlv(struct super_block *sb, u32 *crc,
 	return true;
 }
 
+/*
+ * Returns true if an EXT4_FC_TAG_INODE record can carry the whole on-disk
+ * inode, including the in-inode extended attribute area, in one fast
+ * commit block.  Changes confined to that area can then be fast committed.
+ */
+bool ext4_fc_logs_inode_xattrs(struct super_block *sb)
+{
+	return EXT4_INODE_SIZE(sb) > EXT4_GOOD_OLD_INODE_SIZE &&
+		2 * EXT4_FC_TAG_BASE_LEN + sizeof(struct ext4_fc_inode) +
+		EXT4_INODE_SIZE(sb) <= sb->s_blocksize;
+}
+
 /*
  * Writes inode in the fast commit space under TLV with tag @tag.
  * Returns 0 on success, error on failure.
@@ -804,7 +820,9 @@ static int ext4_fc_write_inode(struct inode *inode, u32 *crc)
 	if (ret)
 		return ret;
 
-	if (EXT4_INODE_SIZE(inode->i_sb) > EXT4_GOOD_OLD_INODE_SIZE)
+	if (ext4_fc_logs_inode_xattrs(inode->i_sb))
+		inode_len = EXT4_INODE_SIZE(inode->i_sb);
+	else if (EXT4_INODE_SIZE(inode->i_sb) > EXT4_GOOD_OLD_INODE_SIZE)
 		inode_len += ei->i_extra_isize;
 
 	fc_inode.fc_ino = cpu_to_le32(inode->i_ino);
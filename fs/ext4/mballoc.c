@@ -2056,10 +2056,9 @@ static void ext4_mb_use_best_found(struct ext4_allocation_context *ac,
 	get_page(ac->ac_buddy_page);
 	/* store last allocated for subsequent stream allocation */
 	if (ac->ac_flags & EXT4_MB_STREAM_ALLOC) {
-		spin_lock(&sbi->s_md_lock);
-		sbi->s_mb_last_group = ac->ac_f_ex.fe_group;
-		sbi->s_mb_last_start = ac->ac_f_ex.fe_start;
-		spin_unlock(&sbi->s_md_lock);
+		int hash = ac->ac_inode->i_ino % sbi->s_mb_nr_global_goals;
+
+		WRITE_ONCE(sbi->s_mb_last_groups[hash], ac->ac_f_ex.fe_group);
 	}
 	/*
 	 * As we've just preallocated more space than
@@ -2650,6 +2649,20 @@ void ext4_mb_prefetch_fini(struct super_block *sb, ext4_group_t group,
 	}
 }
 
+/*
+ * Account a failed attempt to grab the group lock without waiting.  The
+ * per-group counter is only a hint for finding hot groups, so it is
+ * updated without holding the group lock.
+ */
+static void ext4_mb_stat_contended(struct super_block *sb, ext4_group_t group)
+{
+	struct ext4_group_info *grp = ext4_get_group_info(sb, group);
+
+	atomic64_inc(&EXT4_SB(sb)->s_bal_lock_contended);
+	if (grp)
+		WRITE_ONCE(grp->bb_contended, grp->bb_contended + 1);
+}
+
 static noinline_for_stack int
 ext4_mb_regular_allocator(struct ext4_allocation_context *ac)
 {
@@ -2702,13 +2715,19 @@ ext4_mb_regular_allocator(struct ext4_allocation_context *ac)
 							   MB_NUM_ORDERS(sb));
 	}
 
-	/* if stream allocation is enabled, use global goal */
+	/*
+	 * If stream allocation is enabled, use global goal.  There is one
+	 * goal per possible CPU (bounded by the number of groups), selected
+	 * by inode number so that concurrent streaming writers spread out
+	 * over the filesystem instead of all piling onto the same group,
+	 * while a single file keeps allocating close to where it left off.
+	 */
 	if (ac->ac_flags & EXT4_MB_STREAM_ALLOC) {
-		/* TBD: may be hot point */
-		spin_lock(&sbi->s_md_lock);
-		ac->ac_g_ex.fe_group = sbi->s_mb_last_group;
-		ac->ac_g_ex.fe_start = sbi->s_mb_last_start;
-		spin_unlock(&sbi->s_md_lock);
+		int hash = ac->ac_inode->i_ino % sbi->s_mb_nr_global_goals;
+
+		ac->ac_g_ex.fe_group = READ_ONCE(sbi->s_mb_last_groups[hash]);
+		if (ac->ac_g_ex.fe_group >= ngroups)
+			ac->ac_g_ex.fe_group = 0;
 	}
 
 	/* Let's just scan groups to find more-less suitable blocks */
@@ -2774,7 +2793,24 @@ ext4_mb_regular_allocator(struct ext4_allocation_context *ac)
 			if (err)
 				goto out;
 
-			ext4_lock_group(sb, group);
+			/*
+			 * Don't wait for a group somebody else is already
+			 * allocating from while we are still being picky:
+			 * another good group is likely just around the
+			 * corner.  Only the last, "take anything" pass
+			 * waits for the lock.
+			 */
+			if (!ext4_try_lock_group(sb, group)) {
+				if (sbi->s_mb_stats)
+					ext4_mb_stat_contended(sb, group);
+				if (cr < 3) {
+					if (sbi->s_mb_stats)
+						atomic64_inc(&sbi->s_bal_busy_skipped);
+					ext4_mb_unload_buddy(&e4b);
+					continue;
+				}
+				ext4_lock_group(sb, group);
+			}
 
 			/*
 			 * We need to check again after locking the
@@ -2938,6 +2974,29 @@ const struct seq_operations ext4_mb_seq_groups_ops = {
 	.show   = ext4_mb_seq_groups_show,
 };
 
+static void ext4_mb_seq_show_most_contended(struct seq_file *seq,
+					    struct super_block *sb)
+{
+	ext4_group_t ngroups = ext4_get_groups_count(sb);
+	ext4_group_t group, worst = 0;
+	unsigned int contended, max = 0;
+	struct ext4_group_info *grp;
+
+	for (group = 0; group < ngroups; group++) {
+		grp = ext4_get_group_info(sb, group);
+		if (!grp)
+			continue;
+		contended = READ_ONCE(grp->bb_contended);
+		if (contended > max) {
+			max = contended;
+			worst = group;
+		}
+	}
+	if (max)
+		seq_printf(seq, "\tmost_contended_group: %u (%u times)\n",
+			   worst, max);
+}
+
 int ext4_seq_mb_stats_show(struct seq_file *seq, void *offset)
 {
 	struct super_block *sb = (struct super_block *)seq->private;
@@ -2953,6 +3012,11 @@ int ext4_seq_mb_stats_show(struct seq_file *seq, void *offset)
 	seq_printf(seq, "\tsuccess: %u\n", atomic_read(&sbi->s_bal_success));
 
 	seq_printf(seq, "\tgroups_scanned: %u\n",  atomic_read(&sbi->s_bal_groups_scanned));
+	seq_printf(seq, "\tgroups_busy_skipped: %llu\n",
+		   atomic64_read(&sbi->s_bal_busy_skipped));
+	seq_printf(seq, "\tgroups_lock_contended: %llu\n",
+		   atomic64_read(&sbi->s_bal_lock_contended));
+	ext4_mb_seq_show_most_contended(seq, sb);
 
 	seq_puts(seq, "\tcr0_stats:\n");
 	seq_printf(seq, "\t\thits: %llu\n", atomic64_read(&sbi->s_bal_cX_hits[0]));
@@ -3448,6 +3512,15 @@ int ext4_mb_init(struct super_block *sb)
 		i++;
 	} while (i < MB_NUM_ORDERS(sb));
 
+	sbi->s_mb_nr_global_goals = min_t(unsigned int, num_possible_cpus(),
+			DIV_ROUND_UP(ext4_get_groups_count(sb), 4));
+	sbi->s_mb_last_groups = kcalloc(sbi->s_mb_nr_global_goals,
+					sizeof(ext4_group_t), GFP_KERNEL);
+	if (!sbi->s_mb_last_groups) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
 	sbi->s_mb_avg_fragment_size_root = RB_ROOT;
 	sbi->s_mb_largest_free_orders =
 		kmalloc_array(MB_NUM_ORDERS(sb), sizeof(struct list_head),
@@ -3540,6 +3613,8 @@ int ext4_mb_init(struct super_block *sb)
 out:
 	kfree(sbi->s_mb_largest_free_orders);
 	kfree(sbi->s_mb_largest_free_orders_locks);
+	kfree(sbi->s_mb_last_groups);
+	sbi->s_mb_last_groups = NULL;
 	kfree(sbi->s_mb_offsets);
 	sbi->s_mb_offsets = NULL;
 	kfree(sbi->s_mb_maxs);
@@ -3608,6 +3683,7 @@ int ext4_mb_release(struct super_block *sb)
 	}
 	kfree(sbi->s_mb_largest_free_orders);
 	kfree(sbi->s_mb_largest_free_orders_locks);
+	kfree(sbi->s_mb_last_groups);
 	kfree(sbi->s_mb_offsets);
 	kfree(sbi->s_mb_maxs);
 	iput(sbi->s_buddy_cache);
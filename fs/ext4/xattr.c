@@ -2310,6 +2310,9 @@ ext4_xattr_set_handle(handle_t *handle, struct inode *inode, int name_index,
 	struct ext4_xattr_block_find bs = {
 		.s = { .not_found = -ENODATA, },
 	};
+	ext4_fsblk_t old_file_acl;
+	bool old_ea_inode;
+	bool sb_update;
 	int no_expand;
 	int error;
 
@@ -2319,6 +2322,8 @@ ext4_xattr_set_handle(handle_t *handle, struct inode *inode, int name_index,
 		return -ERANGE;
 
 	ext4_write_lock_xattr(inode, &no_expand);
+	old_file_acl = EXT4_I(inode)->i_file_acl;
+	sb_update = !ext4_has_feature_xattr(inode->i_sb);
 
 	/* Check journal credits under write lock. */
 	if (ext4_handle_valid(handle)) {
@@ -2360,6 +2365,7 @@ ext4_xattr_set_handle(handle_t *handle, struct inode *inode, int name_index,
 		error = ext4_xattr_block_find(inode, &i, &bs);
 	if (error)
 		goto cleanup;
+	old_ea_inode = !is.s.not_found && is.s.here->e_value_inum;
 	if (is.s.not_found && bs.s.not_found) {
 		error = -ENODATA;
 		if (flags & XATTR_REPLACE)
@@ -2403,6 +2409,9 @@ ext4_xattr_set_handle(handle_t *handle, struct inode *inode, int name_index,
 				if (error)
 					goto cleanup;
 			}
+			/* The xattr block is about to change in place. */
+			ext4_fc_mark_ineligible(inode->i_sb,
+						EXT4_FC_REASON_XATTR, handle);
 			error = ext4_xattr_block_set(handle, inode, &i, &bs);
 			if (!error && !is.s.not_found) {
 				i.value = NULL;
@@ -2435,7 +2444,21 @@ ext4_xattr_set_handle(handle_t *handle, struct inode *inode, int name_index,
 		if (IS_SYNC(inode))
 			ext4_handle_sync(handle);
 	}
-	ext4_fc_mark_ineligible(inode->i_sb, EXT4_FC_REASON_XATTR, handle);
+	/*
+	 * A change confined to the in-inode xattr area is carried by the
+	 * fast commit inode record, which ext4_mark_iloc_dirty() took care
+	 * of above.  External xattr blocks, EA inodes and the superblock
+	 * feature flag are not logged by fast commits.  Inline data shares
+	 * the in-inode xattr area ("system.data"), and its layout is not
+	 * tracked by fast commits either, so leave such inodes out.
+	 */
+	if (!ext4_fc_logs_inode_xattrs(inode->i_sb) ||
+	    S_ISDIR(inode->i_mode) || ext4_has_inline_data(inode) ||
+	    !bs.s.not_found || i.in_inode ||
+	    old_ea_inode || sb_update ||
+	    EXT4_I(inode)->i_file_acl != old_file_acl)
+		ext4_fc_mark_ineligible(inode->i_sb, EXT4_FC_REASON_XATTR,
+					handle);
 
 cleanup:
 	brelse(is.iloc.bh);
@@ -2513,7 +2536,6 @@ ext4_xattr_set(struct inode *inode, int name_index, const char *name,
 		if (error == 0)
 			error = error2;
 	}
-	ext4_fc_mark_ineligible(inode->i_sb, EXT4_FC_REASON_XATTR, NULL);
 
 	return error;
 }
@@ -2616,6 +2638,7 @@ static int ext4_xattr_move_to_block(handle_t *handle, struct inode *inode,
 	error = ext4_xattr_block_set(handle, inode, &i, bs);
 	if (error)
 		goto out;
+	ext4_fc_mark_ineligible(inode->i_sb, EXT4_FC_REASON_XATTR, handle);
 
 	/* Remove the chosen entry from the inode */
 	i.value = NULL;
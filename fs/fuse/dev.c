@@ -21,6 +21,7 @@
 #include <linux/swap.h>
 #include <linux/splice.h>
 #include <linux/sched.h>
+#include <linux/percpu.h>
 
 MODULE_ALIAS_MISCDEV(FUSE_MINOR);
 MODULE_ALIAS("devname:fuse");
@@ -194,8 +195,7 @@ EXPORT_SYMBOL_GPL(fuse_len_args);
 
 u64 fuse_get_unique(struct fuse_iqueue *fiq)
 {
-	fiq->reqctr += FUSE_REQ_ID_STEP;
-	return fiq->reqctr;
+	return atomic64_add_return(FUSE_REQ_ID_STEP, &fiq->reqctr);
 }
 EXPORT_SYMBOL_GPL(fuse_get_unique);
 
@@ -233,6 +233,55 @@ __releases(fiq->lock)
 	fiq->ops->wake_pending_and_unlock(fiq);
 }
 
+/*
+ * Queue @req on the queue of the submitting CPU if a fuse device is bound to
+ * it. Returns false if the request must go to the shared input queue.
+ */
+static bool queue_request_cpu(struct fuse_iqueue *fiq, struct fuse_req *req)
+{
+	struct fuse_cpu_queue *queues = READ_ONCE(fiq->cpu_queues);
+	struct fuse_cpu_queue *cq;
+
+	if (!queues)
+		return false;
+
+	cq = raw_cpu_ptr(queues);
+	spin_lock(&cq->lock);
+	/* fuse_abort_conn() drains the CPU queues after clearing connected */
+	if (!cq->nr_devs || !READ_ONCE(fiq->connected)) {
+		spin_unlock(&cq->lock);
+		return false;
+	}
+	req->in.h.unique = fuse_get_unique(fiq);
+	req->in.h.len = sizeof(struct fuse_in_header) +
+		fuse_len_args(req->args->in_numargs,
+			      (struct fuse_arg *) req->args->in_args);
+	req->cq = cq;
+	list_add_tail(&req->list, &cq->pending);
+	wake_up(&cq->waitq);
+	spin_unlock(&cq->lock);
+
+	return true;
+}
+
+/*
+ * Lock the list @req is pending on. The request may be moved from a CPU queue
+ * to fiq->pending when the last device bound to the queue is released.
+ */
+static spinlock_t *lock_pending_request(struct fuse_iqueue *fiq,
+					struct fuse_req *req)
+{
+	for (;;) {
+		struct fuse_cpu_queue *cq = READ_ONCE(req->cq);
+		spinlock_t *lock = cq ? &cq->lock : &fiq->lock;
+
+		spin_lock(lock);
+		if (READ_ONCE(req->cq) == cq)
+			return lock;
+		spin_unlock(lock);
+	}
+}
+
 void fuse_queue_forget(struct fuse_conn *fc, struct fuse_forget_link *forget,
 		       u64 nodeid, u64 nlookup)
 {
@@ -263,6 +312,8 @@ static void flush_bg_queue(struct fuse_conn *fc)
 		req = list_first_entry(&fc->bg_queue, struct fuse_req, list);
 		list_del(&req->list);
 		fc->active_background++;
+		if (queue_request_cpu(fiq, req))
+			continue;
 		spin_lock(&fiq->lock);
 		req->in.h.unique = fuse_get_unique(fiq);
 		queue_request_and_unlock(fiq, req);
@@ -369,6 +420,7 @@ static void request_wait_answer(struct fuse_req *req)
 {
 	struct fuse_conn *fc = req->fm->fc;
 	struct fuse_iqueue *fiq = &fc->iq;
+	spinlock_t *lock;
 	int err;
 
 	if (!fc->no_interrupt) {
@@ -392,16 +444,17 @@ static void request_wait_answer(struct fuse_req *req)
 		if (!err)
 			return;
 
-		spin_lock(&fiq->lock);
+		lock = lock_pending_request(fiq, req);
+
 		/* Request is not yet in userspace, bail out */
 		if (test_bit(FR_PENDING, &req->flags)) {
 			list_del(&req->list);
-			spin_unlock(&fiq->lock);
+			spin_unlock(lock);
 			__fuse_put_request(req);
 			req->out.h.error = -EINTR;
 			return;
 		}
-		spin_unlock(&fiq->lock);
+		spin_unlock(lock);
 	}
 
 	/*
@@ -416,21 +469,24 @@ static void __fuse_request_send(struct fuse_req *req)
 	struct fuse_iqueue *fiq = &req->fm->fc->iq;
 
 	BUG_ON(test_bit(FR_BACKGROUND, &req->flags));
-	spin_lock(&fiq->lock);
-	if (!fiq->connected) {
-		spin_unlock(&fiq->lock);
-		req->out.h.error = -ENOTCONN;
-	} else {
+	/* acquire extra reference, since request is still needed
+	   after fuse_request_end() */
+	__fuse_get_request(req);
+	if (!queue_request_cpu(fiq, req)) {
+		spin_lock(&fiq->lock);
+		if (!fiq->connected) {
+			spin_unlock(&fiq->lock);
+			__fuse_put_request(req);
+			req->out.h.error = -ENOTCONN;
+			return;
+		}
 		req->in.h.unique = fuse_get_unique(fiq);
-		/* acquire extra reference, since request is still needed
-		   after fuse_request_end() */
-		__fuse_get_request(req);
 		queue_request_and_unlock(fiq, req);
-
-		request_wait_answer(req);
-		/* Pairs with smp_wmb() in fuse_request_end() */
-		smp_rmb();
 	}
+
+	request_wait_answer(req);
+	/* Pairs with smp_wmb() in fuse_request_end() */
+	smp_rmb();
 }
 
 static void fuse_adjust_compat(struct fuse_conn *fc, struct fuse_args *args)
@@ -1198,6 +1254,45 @@ __releases(fiq->lock)
 		return fuse_read_batch_forget(fiq, cs, nbytes);
 }
 
+/*
+ * Dequeue the next request of the CPU queue @cq, waiting for one unless the
+ * file is non-blocking.
+ */
+static struct fuse_req *fuse_cpu_queue_dequeue(struct fuse_conn *fc,
+					       struct fuse_cpu_queue *cq,
+					       struct file *file)
+{
+	struct fuse_iqueue *fiq = &fc->iq;
+	struct fuse_req *req;
+	int err;
+
+	for (;;) {
+		spin_lock(&cq->lock);
+		if (!fiq->connected) {
+			spin_unlock(&cq->lock);
+			return ERR_PTR(fc->aborted ? -ECONNABORTED : -ENODEV);
+		}
+		if (!list_empty(&cq->pending))
+			break;
+		spin_unlock(&cq->lock);
+
+		if (file->f_flags & O_NONBLOCK)
+			return ERR_PTR(-EAGAIN);
+		err = wait_event_interruptible_exclusive(cq->waitq,
+				!READ_ONCE(fiq->connected) ||
+				!list_empty(&cq->pending));
+		if (err)
+			return ERR_PTR(err);
+	}
+
+	req = list_first_entry(&cq->pending, struct fuse_req, list);
+	clear_bit(FR_PENDING, &req->flags);
+	list_del_init(&req->list);
+	spin_unlock(&cq->lock);
+
+	return req;
+}
+
 /*
  * Read a single request into the userspace filesystem's buffer.  This
  * function waits until a request is available, then removes it from
@@ -1238,6 +1333,14 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 		return -EINVAL;
 
  restart:
+	/* Bound devices only serve the requests of their CPU queue */
+	if (fud->cq) {
+		req = fuse_cpu_queue_dequeue(fc, fud->cq, file);
+		if (IS_ERR(req))
+			return PTR_ERR(req);
+		goto dequeued;
+	}
+
 	for (;;) {
 		spin_lock(&fiq->lock);
 		if (!fiq->connected || request_pending(fiq))
@@ -1276,6 +1379,7 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 	list_del_init(&req->list);
 	spin_unlock(&fiq->lock);
 
+ dequeued:
 	args = req->args;
 	reqsize = req->in.h.len;
 
@@ -2070,6 +2174,21 @@ static __poll_t fuse_dev_poll(struct file *file, poll_table *wait)
 		return EPOLLERR;
 
 	fiq = &fud->fc->iq;
+	if (fud->cq) {
+		struct fuse_cpu_queue *cq = fud->cq;
+
+		poll_wait(file, &cq->waitq, wait);
+
+		spin_lock(&cq->lock);
+		if (!fiq->connected)
+			mask = EPOLLERR;
+		else if (!list_empty(&cq->pending))
+			mask |= EPOLLIN | EPOLLRDNORM;
+		spin_unlock(&cq->lock);
+
+		return mask;
+	}
+
 	poll_wait(file, &fiq->waitq, wait);
 
 	spin_lock(&fiq->lock);
@@ -2181,6 +2300,21 @@ void fuse_abort_conn(struct fuse_conn *fc)
 			kfree(fuse_dequeue_forget(fiq, 1, NULL));
 		wake_up_all(&fiq->waitq);
 		spin_unlock(&fiq->lock);
+		if (fiq->cpu_queues) {
+			int cpu;
+
+			for_each_possible_cpu(cpu) {
+				struct fuse_cpu_queue *cq =
+					per_cpu_ptr(fiq->cpu_queues, cpu);
+
+				spin_lock(&cq->lock);
+				list_for_each_entry(req, &cq->pending, list)
+					clear_bit(FR_PENDING, &req->flags);
+				list_splice_tail_init(&cq->pending, &to_end);
+				wake_up_all(&cq->waitq);
+				spin_unlock(&cq->lock);
+			}
+		}
 		kill_fasync(&fiq->fasync, SIGIO, POLL_IN);
 		end_polls(fc);
 		wake_up_all(&fc->blocked_waitq);
@@ -2200,6 +2334,31 @@ void fuse_wait_aborted(struct fuse_conn *fc)
 	wait_event(fc->blocked_waitq, atomic_read(&fc->num_waiting) == 0);
 }
 
+/*
+ * Release the binding of a device to @cq. When the last bound device goes
+ * away, requests still pending on the queue are moved to fiq->pending so that
+ * the remaining devices serve them.
+ */
+static void fuse_dev_unbind_queue(struct fuse_conn *fc,
+				  struct fuse_cpu_queue *cq)
+{
+	struct fuse_iqueue *fiq = &fc->iq;
+	struct fuse_req *req;
+
+	spin_lock(&cq->lock);
+	if (--cq->nr_devs || list_empty(&cq->pending)) {
+		spin_unlock(&cq->lock);
+		return;
+	}
+
+	spin_lock(&fiq->lock);
+	list_for_each_entry(req, &cq->pending, list)
+		WRITE_ONCE(req->cq, NULL);
+	list_splice_tail_init(&cq->pending, &fiq->pending);
+	spin_unlock(&cq->lock);
+	fiq->ops->wake_pending_and_unlock(fiq);
+}
+
 int fuse_dev_release(struct inode *inode, struct file *file)
 {
 	struct fuse_dev *fud = fuse_get_dev(file);
@@ -2218,6 +2377,9 @@ int fuse_dev_release(struct inode *inode, struct file *file)
 
 		end_requests(&to_end);
 
+		if (fud->cq)
+			fuse_dev_unbind_queue(fc, fud->cq);
+
 		/* Are we the last open device? */
 		if (atomic_dec_and_test(&fc->dev_count)) {
 			WARN_ON(fc->iq.fasync != NULL);
@@ -2257,6 +2419,105 @@ static int fuse_device_clone(struct fuse_conn *fc, struct file *new)
 	return 0;
 }
 
+static struct fuse_cpu_queue __percpu *fuse_alloc_cpu_queues(void)
+{
+	struct fuse_cpu_queue __percpu *queues;
+	int cpu;
+
+	queues = alloc_percpu(struct fuse_cpu_queue);
+	if (!queues)
+		return NULL;
+
+	for_each_possible_cpu(cpu) {
+		struct fuse_cpu_queue *cq = per_cpu_ptr(queues, cpu);
+
+		spin_lock_init(&cq->lock);
+		init_waitqueue_head(&cq->waitq);
+		INIT_LIST_HEAD(&cq->pending);
+		cq->nr_devs = 0;
+	}
+
+	return queues;
+}
+
+static long fuse_dev_ioctl_bind_queue(struct file *file, __u32 __user *argp)
+{
+	struct fuse_dev *fud = fuse_get_dev(file);
+	struct fuse_cpu_queue __percpu *queues;
+	struct fuse_iqueue *fiq;
+	struct fuse_cpu_queue *cq;
+	__u32 cpu;
+
+	if (!fud)
+		return -EPERM;
+
+	fiq = &fud->fc->iq;
+	if (fiq->ops != &fuse_dev_fiq_ops)
+		return -EOPNOTSUPP;
+
+	if (get_user(cpu, argp))
+		return -EFAULT;
+
+	if (cpu >= nr_cpu_ids || !cpu_possible(cpu))
+		return -EINVAL;
+
+	queues = READ_ONCE(fiq->cpu_queues);
+	if (!queues) {
+		queues = fuse_alloc_cpu_queues();
+		if (!queues)
+			return -ENOMEM;
+		if (cmpxchg(&fiq->cpu_queues, NULL, queues)) {
+			free_percpu(queues);
+			queues = fiq->cpu_queues;
+		}
+	}
+
+	cq = per_cpu_ptr(queues, cpu);
+	if (cmpxchg(&fud->cq, NULL, cq))
+		return -EBUSY;
+
+	spin_lock(&cq->lock);
+	cq->nr_devs++;
+	spin_unlock(&cq->lock);
+
+	return 0;
+}
+
+static long fuse_dev_ioctl_backing_open(struct file *file,
+					struct fuse_backing_map __user *argp)
+{
+	struct fuse_dev *fud = fuse_get_dev(file);
+	struct fuse_backing_map map;
+
+	if (!fud)
+		return -EPERM;
+
+	if (!IS_ENABLED(CONFIG_FUSE_PASSTHROUGH))
+		return -EOPNOTSUPP;
+
+	if (copy_from_user(&map, argp, sizeof(map)))
+		return -EFAULT;
+
+	return fuse_backing_open(fud->fc, &map);
+}
+
+static long fuse_dev_ioctl_backing_close(struct file *file, __u32 __user *argp)
+{
+	struct fuse_dev *fud = fuse_get_dev(file);
+	int backing_id;
+
+	if (!fud)
+		return -EPERM;
+
+	if (!IS_ENABLED(CONFIG_FUSE_PASSTHROUGH))
+		return -EOPNOTSUPP;
+
+	if (get_user(backing_id, argp))
+		return -EFAULT;
+
+	return fuse_backing_close(fud->fc, backing_id);
+}
+
 static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
 			   unsigned long arg)
 {
@@ -2289,6 +2550,15 @@ static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
 			}
 		}
 		break;
+	case FUSE_DEV_IOC_BACKING_OPEN:
+		res = fuse_dev_ioctl_backing_open(file, (void __user *)arg);
+		break;
+	case FUSE_DEV_IOC_BACKING_CLOSE:
+		res = fuse_dev_ioctl_backing_close(file, (void __user *)arg);
+		break;
+	case FUSE_DEV_IOC_BIND_QUEUE:
+		res = fuse_dev_ioctl_bind_queue(file, (void __user *)arg);
+		break;
 	default:
 		res = -ENOTTY;
 		break;
@@ -81,8 +81,15 @@ struct fuse_file *fuse_file_alloc(struct fuse_mount *fm)
 	return ff;
 }
 
+static void fuse_file_put_passthrough(struct fuse_file *ff)
+{
+	if (FUSE_IS_PASSTHROUGH(ff))
+		fuse_backing_put(ff->passthrough);
+}
+
 void fuse_file_free(struct fuse_file *ff)
 {
+	fuse_file_put_passthrough(ff);
 	kfree(ff->release_args);
 	mutex_destroy(&ff->readdir.lock);
 	kfree(ff);
@@ -120,6 +127,7 @@ static void fuse_file_put(struct fuse_file *ff, bool sync, bool isdir)
 						   GFP_KERNEL | __GFP_NOFAIL))
 				fuse_release_end(ff->fm, args, -ENOTCONN);
 		}
+		fuse_file_put_passthrough(ff);
 		kfree(ff);
 	}
 }
@@ -146,6 +154,9 @@ struct fuse_file *fuse_file_open(struct fuse_mount *fm, u64 nodeid,
 		if (!err) {
 			ff->fh = outarg.fh;
 			ff->open_flags = outarg.open_flags;
+			if (IS_ENABLED(CONFIG_FUSE_PASSTHROUGH) && !isdir &&
+			    ff->open_flags & FOPEN_PASSTHROUGH)
+				fuse_passthrough_open(fc, ff, outarg.backing_id);
 
 		} else if (err != -ENOSYS) {
 			fuse_file_free(ff);
@@ -159,7 +170,7 @@ struct fuse_file *fuse_file_open(struct fuse_mount *fm, u64 nodeid,
 	}
 
 	if (isdir)
-		ff->open_flags &= ~FOPEN_DIRECT_IO;
+		ff->open_flags &= ~(FOPEN_DIRECT_IO | FOPEN_PASSTHROUGH);
 
 	ff->nodeid = nodeid;
 
@@ -1589,6 +1600,9 @@ static ssize_t fuse_file_read_iter(struct kiocb *iocb, struct iov_iter *to)
 	if (FUSE_IS_DAX(inode))
 		return fuse_dax_read_iter(iocb, to);
 
+	if (FUSE_IS_PASSTHROUGH(ff))
+		return fuse_passthrough_read_iter(iocb, to);
+
 	if (!(ff->open_flags & FOPEN_DIRECT_IO))
 		return fuse_cache_read_iter(iocb, to);
 	else
@@ -1607,6 +1621,9 @@ static ssize_t fuse_file_write_iter(struct kiocb *iocb, struct iov_iter *from)
 	if (FUSE_IS_DAX(inode))
 		return fuse_dax_write_iter(iocb, from);
 
+	if (FUSE_IS_PASSTHROUGH(ff))
+		return fuse_passthrough_write_iter(iocb, from);
+
 	if (!(ff->open_flags & FOPEN_DIRECT_IO))
 		return fuse_cache_write_iter(iocb, from);
 	else
@@ -2411,6 +2428,9 @@ static int fuse_file_mmap(struct file *file, struct vm_area_struct *vma)
 	if (FUSE_IS_DAX(file_inode(file)))
 		return fuse_dax_mmap(file, vma);
 
+	if (FUSE_IS_PASSTHROUGH(ff))
+		return fuse_passthrough_mmap(file, vma);
+
 	if (ff->open_flags & FOPEN_DIRECT_IO) {
 		/* Can't provide the coherency needed for MAP_SHARED */
 		if (vma->vm_flags & VM_MAYSHARE)
@@ -31,6 +31,7 @@
 #include <linux/pid_namespace.h>
 #include <linux/refcount.h>
 #include <linux/user_namespace.h>
+#include <linux/idr.h>
 
 /** Default max number of pages that can be used in a single read request */
 #define FUSE_DEFAULT_MAX_PAGES_PER_REQ 32
@@ -226,6 +227,9 @@ struct fuse_file {
 
 	/** Has flock been performed on this file? */
 	bool flock:1;
+
+	/** Backing file for FOPEN_PASSTHROUGH */
+	struct fuse_backing *passthrough;
 };
 
 /** One input argument of a request */
@@ -367,6 +371,9 @@ struct fuse_req {
 	/** Used to wake up the task waiting for completion of request*/
 	wait_queue_head_t waitq;
 
+	/** CPU queue the request is pending on, NULL for fiq->pending */
+	struct fuse_cpu_queue *cq;
+
 #if IS_ENABLED(CONFIG_VIRTIO_FS)
 	/** virtio-fs's physically contiguous buffer for in and out args */
 	void *argbuf;
@@ -414,6 +421,27 @@ struct fuse_iqueue_ops {
 /** /dev/fuse input queue operations */
 extern const struct fuse_iqueue_ops fuse_dev_fiq_ops;
 
+/**
+ * Per-CPU input queue of a /dev/fuse connection
+ *
+ * Requests submitted on a CPU that has fuse devices bound to it with
+ * FUSE_DEV_IOC_BIND_QUEUE are queued here and only read from those devices,
+ * so that they do not contend on the fiq lock and wait queue.
+ */
+struct fuse_cpu_queue {
+	/** Lock protecting accesses to members of this structure */
+	spinlock_t lock;
+
+	/** Readers bound to this queue are waiting on this */
+	wait_queue_head_t waitq;
+
+	/** The list of pending requests */
+	struct list_head pending;
+
+	/** Number of fuse devices bound to this queue */
+	unsigned int nr_devs;
+} ____cacheline_aligned_in_smp;
+
 struct fuse_iqueue {
 	/** Connection established */
 	unsigned connected;
@@ -425,7 +453,7 @@ struct fuse_iqueue {
 	wait_queue_head_t waitq;
 
 	/** The next unique request id */
-	u64 reqctr;
+	atomic64_t reqctr;
 
 	/** The list of pending requests */
 	struct list_head pending;
@@ -448,6 +476,9 @@ struct fuse_iqueue {
 
 	/** Device-specific state */
 	void *priv;
+
+	/** Per-CPU queues, allocated on the first FUSE_DEV_IOC_BIND_QUEUE */
+	struct fuse_cpu_queue __percpu *cpu_queues;
 };
 
 #define FUSE_PQ_HASH_BITS 8
@@ -479,6 +510,9 @@ struct fuse_dev {
 
 	/** list entry on fc->devices */
 	struct list_head entry;
+
+	/** CPU queue this device reads requests from, if bound */
+	struct fuse_cpu_queue *cq;
 };
 
 struct fuse_fs_context {
@@ -766,6 +800,9 @@ struct fuse_conn {
 	/* Propagate syncfs() to server */
 	unsigned int sync_fs:1;
 
+	/* Server may pass file I/O through to backing files */
+	unsigned int passthrough:1;
+
 	/** The number of requests waiting for completion */
 	atomic_t num_waiting;
 
@@ -807,6 +844,11 @@ struct fuse_conn {
 	struct fuse_conn_dax *dax;
 #endif
 
+#ifdef CONFIG_FUSE_PASSTHROUGH
+	/* Backing files registered by FUSE_DEV_IOC_BACKING_OPEN */
+	struct idr backing_files_map;
+#endif
+
 	/** List of filesystems using this connection */
 	struct list_head mounts;
 
@@ -1268,6 +1310,35 @@ void fuse_dax_inode_cleanup(struct inode *inode);
 bool fuse_dax_check_alignment(struct fuse_conn *fc, unsigned int map_alignment);
 void fuse_dax_cancel_work(struct fuse_conn *fc);
 
+/* passthrough.c */
+
+/*
+ * Maximum s_stack_depth of a backing file super block. The fuse super block
+ * gets this depth once passthrough is negotiated, so a passthrough mount
+ * cannot itself back another one.
+ */
+#define FUSE_PASSTHROUGH_MAX_STACK_DEPTH	1
+
+#define FUSE_IS_PASSTHROUGH(ff) \
+	(IS_ENABLED(CONFIG_FUSE_PASSTHROUGH) && (ff)->passthrough)
+
+struct fuse_backing {
+	struct file *file;
+	const struct cred *cred;
+	refcount_t count;
+};
+
+void fuse_backing_files_init(struct fuse_conn *fc);
+void fuse_backing_files_free(struct fuse_conn *fc);
+int fuse_backing_open(struct fuse_conn *fc, struct fuse_backing_map *map);
+int fuse_backing_close(struct fuse_conn *fc, int backing_id);
+void fuse_backing_put(struct fuse_backing *fb);
+void fuse_passthrough_open(struct fuse_conn *fc, struct fuse_file *ff,
+			   int backing_id);
+ssize_t fuse_passthrough_read_iter(struct kiocb *iocb, struct iov_iter *to);
+ssize_t fuse_passthrough_write_iter(struct kiocb *iocb, struct iov_iter *from);
+int fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma);
+
 /* ioctl.c */
 long fuse_file_ioctl(struct file *file, unsigned int cmd, unsigned long arg);
 long fuse_file_compat_ioctl(struct file *file, unsigned int cmd,
@@ -0,0 +1,254 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * FUSE passthrough: file data I/O redirected to a backing file
+ */
+
+#include "fuse_i.h"
+
+#include <linux/file.h>
+#include <linux/uio.h>
+#include <linux/cred.h>
+#include <linux/idr.h>
+
+void fuse_backing_files_init(struct fuse_conn *fc)
+{
+	idr_init(&fc->backing_files_map);
+}
+
+static int fuse_backing_id_free(int id, void *p, void *data)
+{
+	fuse_backing_put(p);
+	return 0;
+}
+
+void fuse_backing_files_free(struct fuse_conn *fc)
+{
+	idr_for_each(&fc->backing_files_map, fuse_backing_id_free, NULL);
+	idr_destroy(&fc->backing_files_map);
+}
+
+static struct fuse_backing *fuse_backing_get(struct fuse_backing *fb)
+{
+	refcount_inc(&fb->count);
+	return fb;
+}
+
+void fuse_backing_put(struct fuse_backing *fb)
+{
+	if (refcount_dec_and_test(&fb->count)) {
+		fput(fb->file);
+		put_cred(fb->cred);
+		kfree(fb);
+	}
+}
+
+/*
+ * Register the file @map->fd as a backing file of @fc. The file is accessed
+ * with the credentials of the caller, and I/O on fuse files opened with
+ * FOPEN_PASSTHROUGH and the returned id is forwarded to it.
+ */
+int fuse_backing_open(struct fuse_conn *fc, struct fuse_backing_map *map)
+{
+	struct fuse_backing *fb;
+	struct file *file;
+	int res;
+
+	if (!fc->passthrough)
+		return -EOPNOTSUPP;
+
+	/* The backing file is not visible to the process that owns it */
+	if (!capable(CAP_SYS_ADMIN))
+		return -EPERM;
+
+	if (map->flags || map->padding)
+		return -EINVAL;
+
+	file = fget(map->fd);
+	if (!file)
+		return -EBADF;
+
+	res = -EOPNOTSUPP;
+	if (!S_ISREG(file_inode(file)->i_mode) ||
+	    !file->f_op->read_iter || !file->f_op->write_iter)
+		goto out_fput;
+
+	res = -ELOOP;
+	if (file_inode(file)->i_sb->s_stack_depth >=
+	    FUSE_PASSTHROUGH_MAX_STACK_DEPTH)
+		goto out_fput;
+
+	res = -ENOMEM;
+	fb = kmalloc(sizeof(*fb), GFP_KERNEL);
+	if (!fb)
+		goto out_fput;
+
+	fb->file = file;
+	fb->cred = get_current_cred();
+	refcount_set(&fb->count, 1);
+
+	idr_preload(GFP_KERNEL);
+	spin_lock(&fc->lock);
+	res = idr_alloc_cyclic(&fc->backing_files_map, fb, 1, 0, GFP_ATOMIC);
+	spin_unlock(&fc->lock);
+	idr_preload_end();
+
+	if (res < 0)
+		fuse_backing_put(fb);
+
+	return res;
+
+out_fput:
+	fput(file);
+	return res;
+}
+
+int fuse_backing_close(struct fuse_conn *fc, int backing_id)
+{
+	struct fuse_backing *fb;
+
+	if (!fc->passthrough)
+		return -EOPNOTSUPP;
+
+	if (!capable(CAP_SYS_ADMIN))
+		return -EPERM;
+
+	if (backing_id <= 0)
+		return -EINVAL;
+
+	spin_lock(&fc->lock);
+	fb = idr_remove(&fc->backing_files_map, backing_id);
+	spin_unlock(&fc->lock);
+	if (!fb)
+		return -ENOENT;
+
+	fuse_backing_put(fb);
+	return 0;
+}
+
+/*
+ * Attach the backing file @backing_id to @ff when the server replied to open
+ * with FOPEN_PASSTHROUGH. Fall back to regular I/O through the server if the
+ * id is unknown.
+ */
+void fuse_passthrough_open(struct fuse_conn *fc, struct fuse_file *ff,
+			   int backing_id)
+{
+	struct fuse_backing *fb = NULL;
+
+	if (fc->passthrough) {
+		spin_lock(&fc->lock);
+		fb = idr_find(&fc->backing_files_map, backing_id);
+		if (fb)
+			fuse_backing_get(fb);
+		spin_unlock(&fc->lock);
+	}
+
+	if (!fb) {
+		pr_warn_ratelimited("fuse: invalid backing_id %d for passthrough open\n",
+				    backing_id);
+		ff->open_flags &= ~FOPEN_PASSTHROUGH;
+		return;
+	}
+
+	ff->passthrough = fb;
+}
+
+static rwf_t fuse_iocb_to_rwf(int ifl)
+{
+	rwf_t flags = 0;
+
+	if (ifl & IOCB_APPEND)
+		flags |= RWF_APPEND;
+	if (ifl & IOCB_NOWAIT)
+		flags |= RWF_NOWAIT;
+	if (ifl & IOCB_HIPRI)
+		flags |= RWF_HIPRI;
+	if (ifl & IOCB_DSYNC)
+		flags |= RWF_DSYNC;
+	if (ifl & IOCB_SYNC)
+		flags |= RWF_SYNC;
+
+	return flags;
+}
+
+ssize_t fuse_passthrough_read_iter(struct kiocb *iocb, struct iov_iter *to)
+{
+	struct file *file = iocb->ki_filp;
+	struct fuse_file *ff = file->private_data;
+	struct fuse_backing *fb = ff->passthrough;
+	const struct cred *old_cred;
+	ssize_t ret;
+
+	if (!iov_iter_count(to))
+		return 0;
+
+	old_cred = override_creds(fb->cred);
+	ret = vfs_iter_read(fb->file, to, &iocb->ki_pos,
+			    fuse_iocb_to_rwf(iocb->ki_flags));
+	revert_creds(old_cred);
+
+	fuse_invalidate_atime(file_inode(file));
+
+	return ret;
+}
+
+ssize_t fuse_passthrough_write_iter(struct kiocb *iocb, struct iov_iter *from)
+{
+	struct file *file = iocb->ki_filp;
+	struct fuse_file *ff = file->private_data;
+	struct fuse_backing *fb = ff->passthrough;
+	struct inode *inode = file_inode(file);
+	const struct cred *old_cred;
+	ssize_t ret;
+
+	if (!iov_iter_count(from))
+		return 0;
+
+	inode_lock(inode);
+	/* With the caller's creds, like the write paths in file.c */
+	ret = file_remove_privs(file);
+	if (ret)
+		goto out_unlock;
+
+	old_cred = override_creds(fb->cred);
+	file_start_write(fb->file);
+	ret = vfs_iter_write(fb->file, from, &iocb->ki_pos,
+			     fuse_iocb_to_rwf(iocb->ki_flags));
+	file_end_write(fb->file);
+	revert_creds(old_cred);
+
+	/* Size and times are owned by the server, it sees the backing file */
+	if (ret > 0)
+		fuse_write_update_size(inode, iocb->ki_pos);
+	fuse_invalidate_attr(inode);
+out_unlock:
+	inode_unlock(inode);
+
+	return ret;
+}
+
+int fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct fuse_file *ff = file->private_data;
+	struct fuse_backing *fb = ff->passthrough;
+	const struct cred *old_cred;
+	int ret;
+
+	if (!fb->file->f_op->mmap)
+		return -ENODEV;
+
+	/* The server may have registered a backing file it cannot write */
+	if ((vma->vm_flags & VM_SHARED) && (vma->vm_flags & VM_MAYWRITE) &&
+	    !(fb->file->f_mode & FMODE_WRITE))
+		return -EACCES;
+
+	vma_set_file(vma, fb->file);
+
+	old_cred = override_creds(fb->cred);
+	ret = call_mmap(vma->vm_file, vma);
+	revert_creds(old_cred);
+
+	fuse_invalidate_atime(file_inode(file));
+
+	return ret;
+}
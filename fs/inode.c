@@ -34,8 +34,8 @@
  *   inode->i_sb->s_inodes, inode->i_sb_list
  * bdi->wb.list_lock protects:
  *   bdi->wb.b_{dirty,io,more_io,dirty_time}, inode->i_io_list
- * inode_hash_lock protects:
- *   inode_hashtable, inode->i_hash
+ * inode hash locks protect:
+ *   inode_hashtable, inode->i_hash, inode->i_hash_lock
  *
  * Lock ordering:
  *
@@ -46,18 +46,25 @@
  * bdi->wb.list_lock
  *   inode->i_lock
  *
- * inode_hash_lock
+ * inode hash lock
  *   inode->i_sb->s_inode_list_lock
  *   inode->i_lock
  *
  * iunique_lock
- *   inode_hash_lock
+ *   inode hash lock
+ *
+ * The inode hash is protected by an array of spinlocks instead of a single
+ * global one, each lock covering the buckets whose index matches it modulo
+ * the size of the array. Only one hash lock is ever held at a time.
  */
 
 static unsigned int i_hash_mask __read_mostly;
 static unsigned int i_hash_shift __read_mostly;
 static struct hlist_head *inode_hashtable __read_mostly;
-static __cacheline_aligned_in_smp DEFINE_SPINLOCK(inode_hash_lock);
+
+#define I_HASH_LOCKS_PER_CPU	256
+static unsigned int i_hash_lock_mask __read_mostly;
+static spinlock_t *inode_hash_locks __read_mostly;
 
 /*
  * Empty aops. Can be used for the cases where the user does not
@@ -160,6 +167,7 @@ int inode_init_always(struct super_block *sb, struct inode *inode)
 	inode->i_dir_seq = 0;
 	inode->i_rdev = 0;
 	inode->dirtied_when = 0;
+	inode->i_hash_lock = NULL;
 
 #ifdef CONFIG_CGROUP_WRITEBACK
 	inode->i_wb_frn_winner = 0;
@@ -394,6 +402,7 @@ void inode_init_once(struct inode *inode)
 {
 	memset(inode, 0, sizeof(*inode));
 	INIT_HLIST_NODE(&inode->i_hash);
+	inode->i_hash_lock = NULL;
 	INIT_LIST_HEAD(&inode->i_devices);
 	INIT_LIST_HEAD(&inode->i_io_list);
 	INIT_LIST_HEAD(&inode->i_wb_list);
@@ -487,6 +496,11 @@ static unsigned long hash(struct super_block *sb, unsigned long hashval)
 	return tmp & i_hash_mask;
 }
 
+static inline spinlock_t *inode_hash_lock(struct hlist_head *head)
+{
+	return &inode_hash_locks[(head - inode_hashtable) & i_hash_lock_mask];
+}
+
 /**
  *	__insert_inode_hash - hash an inode
  *	@inode: unhashed inode
@@ -498,12 +512,14 @@ static unsigned long hash(struct super_block *sb, unsigned long hashval)
 void __insert_inode_hash(struct inode *inode, unsigned long hashval)
 {
 	struct hlist_head *b = inode_hashtable + hash(inode->i_sb, hashval);
+	spinlock_t *lock = inode_hash_lock(b);
 
-	spin_lock(&inode_hash_lock);
+	spin_lock(lock);
 	spin_lock(&inode->i_lock);
+	inode->i_hash_lock = lock;
 	hlist_add_head_rcu(&inode->i_hash, b);
 	spin_unlock(&inode->i_lock);
-	spin_unlock(&inode_hash_lock);
+	spin_unlock(lock);
 }
 EXPORT_SYMBOL(__insert_inode_hash);
 
@@ -515,11 +531,21 @@ EXPORT_SYMBOL(__insert_inode_hash);
  */
 void __remove_inode_hash(struct inode *inode)
 {
-	spin_lock(&inode_hash_lock);
+	/*
+	 * Only the owner of the inode hashes and unhashes it, so the bucket
+	 * lock can't change under us. An inode that was never hashed has
+	 * nothing to remove.
+	 */
+	spinlock_t *lock = inode->i_hash_lock;
+
+	if (!lock)
+		return;
+
+	spin_lock(lock);
 	spin_lock(&inode->i_lock);
 	hlist_del_init_rcu(&inode->i_hash);
 	spin_unlock(&inode->i_lock);
-	spin_unlock(&inode_hash_lock);
+	spin_unlock(lock);
 }
 EXPORT_SYMBOL(__remove_inode_hash);
 
@@ -816,7 +842,7 @@ long prune_icache_sb(struct super_block *sb, struct shrink_control *sc)
 	return freed;
 }
 
-static void __wait_on_freeing_inode(struct inode *inode);
+static void __wait_on_freeing_inode(struct inode *inode, spinlock_t *lock);
 /*
  * Called with the inode lock held.
  */
@@ -835,7 +861,7 @@ static struct inode *find_inode(struct super_block *sb,
 			continue;
 		spin_lock(&inode->i_lock);
 		if (inode->i_state & (I_FREEING|I_WILL_FREE)) {
-			__wait_on_freeing_inode(inode);
+			__wait_on_freeing_inode(inode, inode_hash_lock(head));
 			goto repeat;
 		}
 		if (unlikely(inode->i_state & I_CREATING)) {
@@ -866,7 +892,7 @@ static struct inode *find_inode_fast(struct super_block *sb,
 			continue;
 		spin_lock(&inode->i_lock);
 		if (inode->i_state & (I_FREEING|I_WILL_FREE)) {
-			__wait_on_freeing_inode(inode);
+			__wait_on_freeing_inode(inode, inode_hash_lock(head));
 			goto repeat;
 		}
 		if (unlikely(inode->i_state & I_CREATING)) {
@@ -1117,7 +1143,7 @@ EXPORT_SYMBOL(unlock_two_nondirectories);
  * return it locked, hashed, and with the I_NEW flag set. The file system gets
  * to fill it in before unlocking it via unlock_new_inode().
  *
- * Note both @test and @set are called with the inode_hash_lock held, so can't
+ * Note both @test and @set are called with the inode hash lock held, so can't
  * sleep.
  */
 struct inode *inode_insert5(struct inode *inode, unsigned long hashval,
@@ -1125,18 +1151,19 @@ struct inode *inode_insert5(struct inode *inode, unsigned long hashval,
 			    int (*set)(struct inode *, void *), void *data)
 {
 	struct hlist_head *head = inode_hashtable + hash(inode->i_sb, hashval);
+	spinlock_t *lock = inode_hash_lock(head);
 	struct inode *old;
 	bool creating = inode->i_state & I_CREATING;
 
 again:
-	spin_lock(&inode_hash_lock);
+	spin_lock(lock);
 	old = find_inode(inode->i_sb, head, test, data);
 	if (unlikely(old)) {
 		/*
 		 * Uhhuh, somebody else created the same inode under us.
 		 * Use the old inode instead of the preallocated one.
 		 */
-		spin_unlock(&inode_hash_lock);
+		spin_unlock(lock);
 		if (IS_ERR(old))
 			return NULL;
 		wait_on_inode(old);
@@ -1158,12 +1185,13 @@ struct inode *inode_insert5(struct inode *inode, unsigned long hashval,
 	 */
 	spin_lock(&inode->i_lock);
 	inode->i_state |= I_NEW;
+	inode->i_hash_lock = lock;
 	hlist_add_head_rcu(&inode->i_hash, head);
 	spin_unlock(&inode->i_lock);
 	if (!creating)
 		inode_sb_list_add(inode);
 unlock:
-	spin_unlock(&inode_hash_lock);
+	spin_unlock(lock);
 
 	return inode;
 }
@@ -1186,7 +1214,7 @@ EXPORT_SYMBOL(inode_insert5);
  * hashed, and with the I_NEW flag set. The file system gets to fill it in
  * before unlocking it via unlock_new_inode().
  *
- * Note both @test and @set are called with the inode_hash_lock held, so can't
+ * Note both @test and @set are called with the inode hash lock held, so can't
  * sleep.
  */
 struct inode *iget5_locked(struct super_block *sb, unsigned long hashval,
@@ -1225,11 +1253,12 @@ EXPORT_SYMBOL(iget5_locked);
 struct inode *iget_locked(struct super_block *sb, unsigned long ino)
 {
 	struct hlist_head *head = inode_hashtable + hash(sb, ino);
+	spinlock_t *lock = inode_hash_lock(head);
 	struct inode *inode;
 again:
-	spin_lock(&inode_hash_lock);
+	spin_lock(lock);
 	inode = find_inode_fast(sb, head, ino);
-	spin_unlock(&inode_hash_lock);
+	spin_unlock(lock);
 	if (inode) {
 		if (IS_ERR(inode))
 			return NULL;
@@ -1245,17 +1274,18 @@ struct inode *iget_locked(struct super_block *sb, unsigned long ino)
 	if (inode) {
 		struct inode *old;
 
-		spin_lock(&inode_hash_lock);
+		spin_lock(lock);
 		/* We released the lock, so.. */
 		old = find_inode_fast(sb, head, ino);
 		if (!old) {
 			inode->i_ino = ino;
 			spin_lock(&inode->i_lock);
 			inode->i_state = I_NEW;
+			inode->i_hash_lock = lock;
 			hlist_add_head_rcu(&inode->i_hash, head);
 			spin_unlock(&inode->i_lock);
 			inode_sb_list_add(inode);
-			spin_unlock(&inode_hash_lock);
+			spin_unlock(lock);
 
 			/* Return the locked inode with I_NEW set, the
 			 * caller is responsible for filling in the contents
@@ -1268,7 +1298,7 @@ struct inode *iget_locked(struct super_block *sb, unsigned long ino)
 		 * us. Use the old inode instead of the one we just
 		 * allocated.
 		 */
-		spin_unlock(&inode_hash_lock);
+		spin_unlock(lock);
 		destroy_inode(inode);
 		if (IS_ERR(old))
 			return NULL;
@@ -1374,17 +1404,18 @@ EXPORT_SYMBOL(igrab);
  * Note: I_NEW is not waited upon so you have to be very careful what you do
  * with the returned inode.  You probably should be using ilookup5() instead.
  *
- * Note2: @test is called with the inode_hash_lock held, so can't sleep.
+ * Note2: @test is called with the inode hash lock held, so can't sleep.
  */
 struct inode *ilookup5_nowait(struct super_block *sb, unsigned long hashval,
 		int (*test)(struct inode *, void *), void *data)
 {
 	struct hlist_head *head = inode_hashtable + hash(sb, hashval);
+	spinlock_t *lock = inode_hash_lock(head);
 	struct inode *inode;
 
-	spin_lock(&inode_hash_lock);
+	spin_lock(lock);
 	inode = find_inode(sb, head, test, data);
-	spin_unlock(&inode_hash_lock);
+	spin_unlock(lock);
 
 	return IS_ERR(inode) ? NULL : inode;
 }
@@ -1405,7 +1436,7 @@ EXPORT_SYMBOL(ilookup5_nowait);
  * This is a generalized version of ilookup() for file systems where the
  * inode number is not sufficient for unique identification of an inode.
  *
- * Note: @test is called with the inode_hash_lock held, so can't sleep.
+ * Note: @test is called with the inode hash lock held, so can't sleep.
  */
 struct inode *ilookup5(struct super_block *sb, unsigned long hashval,
 		int (*test)(struct inode *, void *), void *data)
@@ -1435,11 +1466,12 @@ EXPORT_SYMBOL(ilookup5);
 struct inode *ilookup(struct super_block *sb, unsigned long ino)
 {
 	struct hlist_head *head = inode_hashtable + hash(sb, ino);
+	spinlock_t *lock = inode_hash_lock(head);
 	struct inode *inode;
 again:
-	spin_lock(&inode_hash_lock);
+	spin_lock(lock);
 	inode = find_inode_fast(sb, head, ino);
-	spin_unlock(&inode_hash_lock);
+	spin_unlock(lock);
 
 	if (inode) {
 		if (IS_ERR(inode))
@@ -1468,7 +1500,7 @@ EXPORT_SYMBOL(ilookup);
  * taking the i_lock spin_lock and checking i_state for an inode being
  * freed or being initialized, and incrementing the reference count
  * before returning 1.  It also must not sleep, since it is called with
- * the inode_hash_lock spinlock held.
+ * the inode hash lock held.
  *
  * This is a even more generalized version of ilookup5() when the
  * function must never block --- find_inode() can block in
@@ -1484,10 +1516,11 @@ struct inode *find_inode_nowait(struct super_block *sb,
 				void *data)
 {
 	struct hlist_head *head = inode_hashtable + hash(sb, hashval);
+	spinlock_t *lock = inode_hash_lock(head);
 	struct inode *inode, *ret_inode = NULL;
 	int mval;
 
-	spin_lock(&inode_hash_lock);
+	spin_lock(lock);
 	hlist_for_each_entry(inode, head, i_hash) {
 		if (inode->i_sb != sb)
 			continue;
@@ -1499,7 +1532,7 @@ struct inode *find_inode_nowait(struct super_block *sb,
 		goto out;
 	}
 out:
-	spin_unlock(&inode_hash_lock);
+	spin_unlock(lock);
 	return ret_inode;
 }
 EXPORT_SYMBOL(find_inode_nowait);
@@ -1587,10 +1620,11 @@ int insert_inode_locked(struct inode *inode)
 	struct super_block *sb = inode->i_sb;
 	ino_t ino = inode->i_ino;
 	struct hlist_head *head = inode_hashtable + hash(sb, ino);
+	spinlock_t *lock = inode_hash_lock(head);
 
 	while (1) {
 		struct inode *old = NULL;
-		spin_lock(&inode_hash_lock);
+		spin_lock(lock);
 		hlist_for_each_entry(old, head, i_hash) {
 			if (old->i_ino != ino)
 				continue;
@@ -1606,19 +1640,20 @@ int insert_inode_locked(struct inode *inode)
 		if (likely(!old)) {
 			spin_lock(&inode->i_lock);
 			inode->i_state |= I_NEW | I_CREATING;
+			inode->i_hash_lock = lock;
 			hlist_add_head_rcu(&inode->i_hash, head);
 			spin_unlock(&inode->i_lock);
-			spin_unlock(&inode_hash_lock);
+			spin_unlock(lock);
 			return 0;
 		}
 		if (unlikely(old->i_state & I_CREATING)) {
 			spin_unlock(&old->i_lock);
-			spin_unlock(&inode_hash_lock);
+			spin_unlock(lock);
 			return -EBUSY;
 		}
 		__iget(old);
 		spin_unlock(&old->i_lock);
-		spin_unlock(&inode_hash_lock);
+		spin_unlock(lock);
 		wait_on_inode(old);
 		if (unlikely(!inode_unhashed(old))) {
 			iput(old);
@@ -2064,17 +2099,17 @@ EXPORT_SYMBOL(inode_needs_sync);
  * wake_up_bit(&inode->i_state, __I_NEW) after removing from the hash list
  * will DTRT.
  */
-static void __wait_on_freeing_inode(struct inode *inode)
+static void __wait_on_freeing_inode(struct inode *inode, spinlock_t *lock)
 {
 	wait_queue_head_t *wq;
 	DEFINE_WAIT_BIT(wait, &inode->i_state, __I_NEW);
 	wq = bit_waitqueue(&inode->i_state, __I_NEW);
 	prepare_to_wait(wq, &wait.wq_entry, TASK_UNINTERRUPTIBLE);
 	spin_unlock(&inode->i_lock);
-	spin_unlock(&inode_hash_lock);
+	spin_unlock(lock);
 	schedule();
 	finish_wait(wq, &wait.wq_entry);
-	spin_lock(&inode_hash_lock);
+	spin_lock(lock);
 }
 
 static __initdata unsigned long ihash_entries;
@@ -2110,6 +2145,27 @@ void __init inode_init_early(void)
 					0);
 }
 
+/*
+ * Size the hash lock array by the number of cpus that could contend on it,
+ * there is no point in having more locks than buckets.
+ */
+static void __init inode_hash_locks_init(void)
+{
+	unsigned long nr;
+	unsigned long i;
+
+	nr = roundup_pow_of_two(num_possible_cpus() * I_HASH_LOCKS_PER_CPU);
+	nr = min_t(unsigned long, nr, (unsigned long)i_hash_mask + 1);
+
+	inode_hash_locks = kvmalloc_array(nr, sizeof(spinlock_t), GFP_KERNEL);
+	if (!inode_hash_locks)
+		panic("Failed to allocate inode hash locks\n");
+
+	for (i = 0; i < nr; i++)
+		spin_lock_init(&inode_hash_locks[i]);
+	i_hash_lock_mask = nr - 1;
+}
+
 void __init inode_init(void)
 {
 	/* inode slab cache */
@@ -2121,19 +2177,19 @@ void __init inode_init(void)
 					 init_once);
 
 	/* Hash may have been set up in inode_init_early */
-	if (!hashdist)
-		return;
-
-	inode_hashtable =
-		alloc_large_system_hash("Inode-cache",
-					sizeof(struct hlist_head),
-					ihash_entries,
-					14,
-					HASH_ZERO,
-					&i_hash_shift,
-					&i_hash_mask,
-					0,
-					0);
+	if (hashdist)
+		inode_hashtable =
+			alloc_large_system_hash("Inode-cache",
+						sizeof(struct hlist_head),
+						ihash_entries,
+						14,
+						HASH_ZERO,
+						&i_hash_shift,
+						&i_hash_mask,
+						0,
+						0);
+
+	inode_hash_locks_init();
 }
 
 void init_special_inode(struct inode *inode, umode_t mode, dev_t rdev)
@@ -23,13 +23,17 @@
 
 /*
  * Structure allocated for each page or THP when block size < page size
- * to track sub-page uptodate status and I/O completions.
+ * to track sub-page uptodate and dirty status and I/O completions.
+ *
+ * The state bitmap holds one uptodate bit per block, followed by one dirty
+ * bit per block.  Dirty bits are only maintained for mappings that use
+ * iomap_set_page_dirty(), see iomap_page_tracks_dirty().
  */
 struct iomap_page {
 	atomic_t		read_bytes_pending;
 	atomic_t		write_bytes_pending;
-	spinlock_t		uptodate_lock;
-	unsigned long		uptodate[];
+	spinlock_t		state_lock;
+	unsigned long		state[];
 };
 
 static inline struct iomap_page *to_iomap_page(struct page *page)
@@ -57,11 +61,13 @@ iomap_page_create(struct inode *inode, struct page *page)
 	if (iop || nr_blocks <= 1)
 		return iop;
 
-	iop = kzalloc(struct_size(iop, uptodate, BITS_TO_LONGS(nr_blocks)),
+	iop = kzalloc(struct_size(iop, state, BITS_TO_LONGS(2 * nr_blocks)),
 			GFP_NOFS | __GFP_NOFAIL);
-	spin_lock_init(&iop->uptodate_lock);
+	spin_lock_init(&iop->state_lock);
 	if (PageUptodate(page))
-		bitmap_fill(iop->uptodate, nr_blocks);
+		bitmap_set(iop->state, 0, nr_blocks);
+	if (PageDirty(page))
+		bitmap_set(iop->state, nr_blocks, nr_blocks);
 	attach_page_private(page, iop);
 	return iop;
 }
@@ -76,7 +82,7 @@ iomap_page_release(struct page *page)
 		return;
 	WARN_ON_ONCE(atomic_read(&iop->read_bytes_pending));
 	WARN_ON_ONCE(atomic_read(&iop->write_bytes_pending));
-	WARN_ON_ONCE(bitmap_full(iop->uptodate, nr_blocks) !=
+	WARN_ON_ONCE(bitmap_full(iop->state, nr_blocks) !=
 			PageUptodate(page));
 	kfree(iop);
 }
@@ -107,7 +113,7 @@ iomap_adjust_read_range(struct inode *inode, struct iomap_page *iop,
 
 		/* move forward for each leading block marked uptodate */
 		for (i = first; i <= last; i++) {
-			if (!test_bit(i, iop->uptodate))
+			if (!test_bit(i, iop->state))
 				break;
 			*pos += block_size;
 			poff += block_size;
@@ -117,7 +123,7 @@ iomap_adjust_read_range(struct inode *inode, struct iomap_page *iop,
 
 		/* truncate len if we find any trailing uptodate block(s) */
 		for ( ; i <= last; i++) {
-			if (test_bit(i, iop->uptodate)) {
+			if (test_bit(i, iop->state)) {
 				plen -= (last - i + 1) * block_size;
 				last = i - 1;
 				break;
@@ -150,11 +156,11 @@ iomap_iop_set_range_uptodate(struct page *page, unsigned off, unsigned len)
 	unsigned last = (off + len - 1) >> inode->i_blkbits;
 	unsigned long flags;
 
-	spin_lock_irqsave(&iop->uptodate_lock, flags);
-	bitmap_set(iop->uptodate, first, last - first + 1);
-	if (bitmap_full(iop->uptodate, i_blocks_per_page(inode, page)))
+	spin_lock_irqsave(&iop->state_lock, flags);
+	bitmap_set(iop->state, first, last - first + 1);
+	if (bitmap_full(iop->state, i_blocks_per_page(inode, page)))
 		SetPageUptodate(page);
-	spin_unlock_irqrestore(&iop->uptodate_lock, flags);
+	spin_unlock_irqrestore(&iop->state_lock, flags);
 }
 
 static void
@@ -169,6 +175,57 @@ iomap_set_range_uptodate(struct page *page, unsigned off, unsigned len)
 		SetPageUptodate(page);
 }
 
+static bool iomap_page_tracks_dirty(struct page *page)
+{
+	return page->mapping->a_ops->set_page_dirty == iomap_set_page_dirty;
+}
+
+static void
+iomap_iop_update_range_dirty(struct page *page, unsigned off, unsigned len,
+		bool dirty)
+{
+	struct iomap_page *iop = to_iomap_page(page);
+	struct inode *inode = page->mapping->host;
+	unsigned int nr_blocks = i_blocks_per_page(inode, page);
+	unsigned first = off >> inode->i_blkbits;
+	unsigned last = (off + len - 1) >> inode->i_blkbits;
+	unsigned long flags;
+
+	spin_lock_irqsave(&iop->state_lock, flags);
+	if (dirty)
+		bitmap_set(iop->state, nr_blocks + first, last - first + 1);
+	else
+		bitmap_clear(iop->state, nr_blocks + first, last - first + 1);
+	spin_unlock_irqrestore(&iop->state_lock, flags);
+}
+
+static void
+iomap_set_range_dirty(struct page *page, unsigned off, unsigned len)
+{
+	if (len && page_has_private(page))
+		iomap_iop_update_range_dirty(page, off, len, true);
+}
+
+static void
+iomap_clear_range_dirty(struct page *page, unsigned off, unsigned len)
+{
+	if (len && page_has_private(page))
+		iomap_iop_update_range_dirty(page, off, len, false);
+}
+
+/*
+ * Mark all blocks of a page dirty, e.g. when it is dirtied through a shared
+ * mapping.  Writes through iomap_write_iter() only dirty the blocks they
+ * cover, so that writeback does not rewrite clean blocks of a large page.
+ */
+int
+iomap_set_page_dirty(struct page *page)
+{
+	iomap_set_range_dirty(page, 0, PAGE_SIZE);
+	return __set_page_dirty_nobuffers(page);
+}
+EXPORT_SYMBOL_GPL(iomap_set_page_dirty);
+
 static void
 iomap_read_page_end_io(struct bio_vec *bvec, int error)
 {
@@ -448,7 +505,7 @@ iomap_is_partially_uptodate(struct page *page, unsigned long from,
 
 	if (iop) {
 		for (i = first; i <= last; i++)
-			if (!test_bit(i, iop->uptodate))
+			if (!test_bit(i, iop->state))
 				return 0;
 		return 1;
 	}
@@ -670,6 +727,7 @@ static size_t __iomap_write_end(struct inode *inode, loff_t pos, size_t len,
 	if (unlikely(copied < len && !PageUptodate(page)))
 		return 0;
 	iomap_set_range_uptodate(page, offset_in_page(pos), len);
+	iomap_set_range_dirty(page, offset_in_page(pos), copied);
 	__set_page_dirty_nobuffers(page);
 	return copied;
 }
@@ -1297,13 +1355,17 @@ iomap_writepage_map(struct iomap_writepage_ctx *wpc,
 		struct writeback_control *wbc, struct inode *inode,
 		struct page *page, u64 end_offset)
 {
-	struct iomap_page *iop = iomap_page_create(inode, page);
+	struct iomap_page *iop = to_iomap_page(page);
+	bool track_dirty = iop && iomap_page_tracks_dirty(page);
 	struct iomap_ioend *ioend, *next;
 	unsigned len = i_blocksize(inode);
+	unsigned int nr_blocks = i_blocks_per_page(inode, page);
 	u64 file_offset; /* file offset of page */
 	int error = 0, count = 0, i;
 	LIST_HEAD(submit_list);
 
+	if (!iop)
+		iop = iomap_page_create(inode, page);
 	WARN_ON_ONCE(iop && atomic_read(&iop->write_bytes_pending) != 0);
 
 	/*
@@ -1314,7 +1376,10 @@ iomap_writepage_map(struct iomap_writepage_ctx *wpc,
 	for (i = 0, file_offset = page_offset(page);
 	     i < (PAGE_SIZE >> inode->i_blkbits) && file_offset < end_offset;
 	     i++, file_offset += len) {
-		if (iop && !test_bit(i, iop->uptodate))
+		if (iop && !test_bit(i, iop->state))
+			continue;
+		/* Skip clean blocks if the page tracks per-block dirty state */
+		if (track_dirty && !test_bit(nr_blocks + i, iop->state))
 			continue;
 
 		error = wpc->ops->map_blocks(wpc, inode, file_offset);
@@ -1334,6 +1399,12 @@ iomap_writepage_map(struct iomap_writepage_ctx *wpc,
 	WARN_ON_ONCE(PageWriteback(page));
 	WARN_ON_ONCE(PageDirty(page));
 
+	/*
+	 * The page dirty bit was cleared before ->writepage, and redirtying
+	 * the blocks requires the page lock, so the whole page is clean now.
+	 */
+	iomap_clear_range_dirty(page, 0, PAGE_SIZE);
+
 	/*
 	 * We cannot cancel the ioend directly here on error.  We may have
 	 * already set other pages under writeback and hence we have to run I/O
@@ -1678,15 +1678,47 @@ static struct dentry *lookup_slow(const struct qstr *name,
 	return res;
 }
 
+static inline bool no_acl_inode(struct inode *inode)
+{
+#ifdef CONFIG_FS_POSIX_ACL
+	return likely(!IS_POSIXACL(inode) || !READ_ONCE(inode->i_acl));
+#else
+	return true;
+#endif
+}
+
+/*
+ * Search permission on a directory, checked for every component of every
+ * path walk.
+ *
+ * Most directories on the way are searchable by everyone and have no ACL.
+ * For those generic_permission() can only ever grant MAY_EXEC, whoever the
+ * caller is, so skip straight to the LSM hook. Anything else, including
+ * inodes with their own ->permission() (IOP_FASTPERM not set yet), goes
+ * through inode_permission() as usual.
+ */
+static inline int lookup_inode_permission_may_exec(struct user_namespace *mnt_userns,
+						   struct inode *inode, int mask)
+{
+	mask |= MAY_EXEC;
+
+	if (unlikely(!(inode->i_opflags & IOP_FASTPERM)) ||
+	    (inode->i_mode & S_IXUGO) != S_IXUGO || !no_acl_inode(inode))
+		return inode_permission(mnt_userns, inode, mask);
+
+	return security_inode_permission(inode, mask);
+}
+
 static inline int may_lookup(struct user_namespace *mnt_userns,
 			     struct nameidata *nd)
 {
 	if (nd->flags & LOOKUP_RCU) {
-		int err = inode_permission(mnt_userns, nd->inode, MAY_EXEC|MAY_NOT_BLOCK);
+		int err = lookup_inode_permission_may_exec(mnt_userns, nd->inode,
+							   MAY_NOT_BLOCK);
 		if (err != -ECHILD || !try_to_unlazy(nd))
 			return err;
 	}
-	return inode_permission(mnt_userns, nd->inode, MAY_EXEC);
+	return lookup_inode_permission_may_exec(mnt_userns, nd->inode, 0);
 }
 
 static int reserve_stack(struct nameidata *nd, struct path *link, unsigned seq)
@@ -204,6 +204,7 @@ static int ovl_copy_up_data(struct ovl_fs *ofs, struct path *old,
 	loff_t data_pos = -1;
 	loff_t hole_len;
 	bool skip_hole = false;
+	bool try_copy_range;
 	int error = 0;
 
 	if (len == 0)
@@ -225,6 +226,18 @@ static int ovl_copy_up_data(struct ovl_fs *ofs, struct path *old,
 		goto out;
 	/* Couldn't clone, so now we try to copy the data */
 
+	/*
+	 * Let an upper fs that can offload the copy (e.g. server side copy)
+	 * do so.  This calls ->copy_file_range() directly rather than going
+	 * through vfs_copy_file_range(), as we already hold freeze
+	 * protection on the upper fs via ovl_want_write().  Like
+	 * vfs_copy_file_range(), only do that when both files share the
+	 * same method; implementations assume both files are their own.
+	 */
+	try_copy_range = new_file->f_op->copy_file_range &&
+			 old_file->f_op->copy_file_range ==
+			 new_file->f_op->copy_file_range;
+
 	/* Check if lower fs supports seek operation */
 	if (old_file->f_mode & FMODE_LSEEK &&
 	    old_file->f_op->llseek)
@@ -272,9 +285,23 @@ static int ovl_copy_up_data(struct ovl_fs *ofs, struct path *old,
 			}
 		}
 
-		bytes = do_splice_direct(old_file, &old_pos,
-					 new_file, &new_pos,
-					 this_len, SPLICE_F_MOVE);
+		bytes = 0;
+		if (try_copy_range) {
+			bytes = new_file->f_op->copy_file_range(old_file,
+						old_pos, new_file, new_pos,
+						this_len, 0);
+			if (bytes > 0) {
+				old_pos += bytes;
+				new_pos += bytes;
+			} else {
+				/* Not supported or failed, use splice */
+				try_copy_range = false;
+			}
+		}
+		if (bytes <= 0)
+			bytes = do_splice_direct(old_file, &old_pos,
+						 new_file, &new_pos,
+						 this_len, SPLICE_F_MOVE);
 		if (bytes <= 0) {
 			error = bytes;
 			break;
@@ -400,6 +400,23 @@ static inline int is_packetized(struct file *file)
 	return (file->f_flags & O_DIRECT) != 0;
 }
 
+/* Maximum number of ring slots pipe_write() reserves per lock round trip */
+#define PIPE_WRITE_BATCH 16
+
+/* Return pages pipe_write() allocated but did not use */
+static void pipe_put_spare_pages(struct pipe_inode_info *pipe,
+				 struct page **pages, unsigned int nr)
+{
+	unsigned int i;
+
+	for (i = 0; i < nr; i++) {
+		if (!pipe->tmp_page)
+			pipe->tmp_page = pages[i];
+		else
+			__free_page(pages[i]);
+	}
+}
+
 /* Done while waiting without holding the pipe lock - thus the READ_ONCE() */
 static inline bool pipe_writable(const struct pipe_inode_info *pipe)
 {
@@ -487,57 +504,100 @@ pipe_write(struct kiocb *iocb, struct iov_iter *from)
 		head = pipe->head;
 		if (!pipe_full(head, pipe->tail, pipe->max_usage)) {
 			unsigned int mask = pipe->ring_size - 1;
-			struct pipe_buffer *buf = &pipe->bufs[head & mask];
-			struct page *page = pipe->tmp_page;
-			int copied;
-
-			if (!page) {
-				page = alloc_page(GFP_HIGHUSER | __GFP_ACCOUNT);
-				if (unlikely(!page)) {
-					ret = ret ? : -ENOMEM;
-					break;
+			struct page *pages[PIPE_WRITE_BATCH];
+			unsigned int i, nr, used;
+			bool fault = false;
+
+			/*
+			 * Fill as many slots as the remaining data needs (up
+			 * to PIPE_WRITE_BATCH) per trip round the loop, so a
+			 * large write takes the ring lock once per batch
+			 * rather than once per page.
+			 */
+			nr = min_t(size_t, DIV_ROUND_UP(iov_iter_count(from), PAGE_SIZE),
+				   PIPE_WRITE_BATCH);
+			nr = min(nr, pipe->max_usage -
+				     pipe_occupancy(head, pipe->tail));
+
+			for (i = 0; i < nr; i++) {
+				struct page *page = pipe->tmp_page;
+
+				if (page) {
+					pipe->tmp_page = NULL;
+				} else {
+					page = alloc_page(GFP_HIGHUSER | __GFP_ACCOUNT);
+					if (unlikely(!page))
+						break;
 				}
-				pipe->tmp_page = page;
+				pages[i] = page;
+			}
+			if (unlikely(!i)) {
+				ret = ret ? : -ENOMEM;
+				break;
 			}
+			nr = i;
 
-			/* Allocate a slot in the ring in advance and attach an
-			 * empty buffer.  If we fault or otherwise fail to use
-			 * it, either the reader will consume it or it'll still
-			 * be there for the next write.
+			/* Allocate the slots in the ring in advance.  We hold
+			 * the pipe mutex, so nobody but us can consume them,
+			 * and whatever we don't fill is handed back below.
 			 */
 			spin_lock_irq(&pipe->rd_wait.lock);
 
 			head = pipe->head;
-			if (pipe_full(head, pipe->tail, pipe->max_usage)) {
+			nr = min(nr, pipe->max_usage -
+				     pipe_occupancy(head, pipe->tail));
+			if (!nr) {
 				spin_unlock_irq(&pipe->rd_wait.lock);
+				pipe_put_spare_pages(pipe, pages, i);
 				continue;
 			}
 
-			pipe->head = head + 1;
+			pipe->head = head + nr;
 			spin_unlock_irq(&pipe->rd_wait.lock);
 
-			/* Insert it into the buffer array */
-			buf = &pipe->bufs[head & mask];
-			buf->page = page;
-			buf->ops = &anon_pipe_buf_ops;
-			buf->offset = 0;
-			buf->len = 0;
-			if (is_packetized(filp))
-				buf->flags = PIPE_BUF_FLAG_PACKET;
-			else
-				buf->flags = PIPE_BUF_FLAG_CAN_MERGE;
-			pipe->tmp_page = NULL;
-
-			copied = copy_page_from_iter(page, 0, PAGE_SIZE, from);
-			if (unlikely(copied < PAGE_SIZE && iov_iter_count(from))) {
+			for (used = 0; used < nr; used++) {
+				struct pipe_buffer *buf;
+				int copied;
+
+				copied = copy_page_from_iter(pages[used], 0,
+							     PAGE_SIZE, from);
+				if (unlikely(copied < PAGE_SIZE &&
+					     iov_iter_count(from))) {
+					fault = true;
+					break;
+				}
+
+				/* Insert it into the buffer array */
+				buf = &pipe->bufs[(head + used) & mask];
+				buf->page = pages[used];
+				buf->ops = &anon_pipe_buf_ops;
+				buf->offset = 0;
+				buf->len = copied;
+				if (is_packetized(filp))
+					buf->flags = PIPE_BUF_FLAG_PACKET;
+				else
+					buf->flags = PIPE_BUF_FLAG_CAN_MERGE;
+				ret += copied;
+
+				if (!iov_iter_count(from)) {
+					used++;
+					break;
+				}
+			}
+
+			/* Give back the slots and pages we didn't fill */
+			if (used < nr) {
+				spin_lock_irq(&pipe->rd_wait.lock);
+				pipe->head = head + used;
+				spin_unlock_irq(&pipe->rd_wait.lock);
+			}
+			pipe_put_spare_pages(pipe, pages + used, i - used);
+
+			if (unlikely(fault)) {
 				if (!ret)
 					ret = -EFAULT;
 				break;
 			}
-			ret += copied;
-			buf->offset = 0;
-			buf->len = copied;
-
 			if (!iov_iter_count(from))
 				break;
 		}
@@ -796,6 +796,50 @@ static long do_splice_to(struct file *in, loff_t *ppos,
 	return in->f_op->splice_read(in, ppos, pipe, len, flags);
 }
 
+/*
+ * Every round trip through the internal pipe of splice_direct_to_actor()
+ * moves at most ->max_usage pages, read from the input and then pushed to the
+ * actor. With the default 16 slots a large sendfile() goes through the read
+ * and send paths once per 64k; grow the ring for large transfers, up to the
+ * pipe_max_size limit that applies to user pipes, so each round batches more.
+ * References to page cache pages are still what moves through the pipe, so
+ * this only costs the pipe_buffer array.  The slots are charged to the user
+ * like those of F_SETPIPE_SZ, and the pipe isn't grown past their limits.
+ */
+static void splice_direct_grow_pipe(struct pipe_inode_info *pipe, size_t len)
+{
+	unsigned long user_bufs;
+	unsigned int nr_slots;
+
+	if (len <= (size_t)pipe->max_usage << PAGE_SHIFT)
+		return;
+
+	nr_slots = READ_ONCE(pipe_max_size) >> PAGE_SHIFT;
+	if (len < (size_t)nr_slots << PAGE_SHIFT)
+		nr_slots = roundup_pow_of_two(DIV_ROUND_UP(len, PAGE_SIZE));
+	nr_slots = rounddown_pow_of_two(nr_slots);
+	if (nr_slots <= pipe->max_usage)
+		return;
+
+	user_bufs = account_pipe_buffers(pipe->user, pipe->nr_accounted,
+					 nr_slots);
+	if ((too_many_pipe_buffers_hard(user_bufs) ||
+	     too_many_pipe_buffers_soft(user_bufs)) &&
+	    pipe_is_unprivileged_user())
+		goto out_revert_acct;
+
+	/* The pipe is empty here, so this can only fail on allocation */
+	if (pipe_resize_ring(pipe, nr_slots))
+		goto out_revert_acct;
+
+	pipe->max_usage = nr_slots;
+	pipe->nr_accounted = nr_slots;
+	return;
+
+out_revert_acct:
+	(void) account_pipe_buffers(pipe->user, nr_slots, pipe->nr_accounted);
+}
+
 /**
  * splice_direct_to_actor - splices data directly between two non-pipes
  * @in:		file to splice from
@@ -847,6 +891,8 @@ ssize_t splice_direct_to_actor(struct file *in, struct splice_desc *sd,
 		current->splice_pipe = pipe;
 	}
 
+	splice_direct_grow_pipe(pipe, sd->total_len);
+
 	/*
 	 * Do the splice.
 	 */
@@ -173,6 +173,11 @@ struct backing_dev_info {
 	unsigned long ra_pages;	/* max readahead in PAGE_SIZE units */
 	unsigned long io_pages;	/* max allowed IO size */
 
+	/* readahead feedback, in pages */
+	atomic_long_t ra_submitted;	/* read via readahead */
+	atomic_long_t ra_consumed;	/* used by sequential readers */
+	atomic_long_t ra_wasted;	/* evicted before they were used */
+
 	struct kref refcnt;	/* Reference counter for the structure */
 	unsigned int capabilities; /* Device capabilities */
 	unsigned int min_ratio;
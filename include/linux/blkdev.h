@@ -38,6 +38,7 @@ struct rq_qos;
 struct blk_queue_stats;
 struct blk_stat_callback;
 struct blk_keyslot_manager;
+struct blk_zone_wplug;
 
 #define BLKDEV_MIN_RQ	4
 #define BLKDEV_MAX_RQ	128	/* Default maximum */
@@ -133,7 +134,10 @@ struct request {
 	struct bio *bio;
 	struct bio *biotail;
 
-	struct list_head queuelist;
+	union {
+		struct list_head queuelist;
+		struct request *rq_next;
+	};
 
 	/*
 	 * The hash is used inside the scheduler, and killed once the
@@ -492,6 +496,11 @@ struct request_queue {
 	 * Stacking drivers (device mappers) may or may not initialize
 	 * these fields.
 	 *
+	 * zone_wplugs is an array of nr_zones zone write plugs, allocated for
+	 * blk-mq zoned devices, which serializes writes to sequential zones at
+	 * the bio level and emulates zone append for devices without native
+	 * support for it.
+	 *
 	 * Reads of this information must be protected with blk_queue_enter() /
 	 * blk_queue_exit(). Modifying this information is only allowed while
 	 * no requests are being processed. See also blk_mq_freeze_queue() and
@@ -500,6 +509,7 @@ struct request_queue {
 	unsigned int		nr_zones;
 	unsigned long		*conv_zones_bitmap;
 	unsigned long		*seq_zones_wlock;
+	struct blk_zone_wplug	*zone_wplugs;
 	unsigned int		max_open_zones;
 	unsigned int		max_active_zones;
 #endif /* CONFIG_BLK_DEV_ZONED */
@@ -1201,11 +1211,26 @@ void blk_mark_disk_dead(struct gendisk *disk);
 struct blk_plug {
 	struct list_head mq_list; /* blk-mq requests */
 	struct list_head cb_list; /* md requires an unplug callback */
+	struct list_head cached_rqs; /* pre-allocated, unused requests */
+	unsigned short nr_ios; /* requests to allocate at once */
 	unsigned short rq_count;
 	bool multiple_queues;
 	bool nowait;
 };
 
+/*
+ * Completion side counterpart of struct blk_plug: a driver reaping several
+ * completions collects the successful ones here, and ends them all with a
+ * single call to ->complete(), which frees their tags in bulk.
+ */
+struct io_comp_batch {
+	struct request *req_list;
+	bool need_ts;
+	void (*complete)(struct io_comp_batch *);
+};
+
+#define DEFINE_IO_COMP_BATCH(name)	struct io_comp_batch name = { }
+
 struct blk_plug_cb;
 typedef void (*blk_plug_cb_fn)(struct blk_plug_cb *, bool);
 struct blk_plug_cb {
@@ -1216,6 +1241,7 @@ struct blk_plug_cb {
 extern struct blk_plug_cb *blk_check_plugged(blk_plug_cb_fn unplug,
 					     void *data, int size);
 extern void blk_start_plug(struct blk_plug *);
+extern void blk_start_plug_nr_ios(struct blk_plug *, unsigned short);
 extern void blk_finish_plug(struct blk_plug *);
 extern void blk_flush_plug_list(struct blk_plug *, bool);
 
@@ -1241,7 +1267,8 @@ static inline bool blk_needs_flush_plug(struct task_struct *tsk)
 
 	return plug &&
 		 (!list_empty(&plug->mq_list) ||
-		 !list_empty(&plug->cb_list));
+		 !list_empty(&plug->cb_list) ||
+		 !list_empty(&plug->cached_rqs));
 }
 
 int blkdev_issue_flush(struct block_device *bdev);
@@ -1254,6 +1281,11 @@ static inline void blk_start_plug(struct blk_plug *plug)
 {
 }
 
+static inline void blk_start_plug_nr_ios(struct blk_plug *plug,
+					 unsigned short nr_ios)
+{
+}
+
 static inline void blk_finish_plug(struct blk_plug *plug)
 {
 }
@@ -1379,11 +1411,23 @@ static inline unsigned int queue_max_segment_size(const struct request_queue *q)
 	return q->limits.max_segment_size;
 }
 
+static inline bool blk_queue_emulates_zone_append(const struct request_queue *q)
+{
+#ifdef CONFIG_BLK_DEV_ZONED
+	return q->zone_wplugs && !q->limits.max_zone_append_sectors;
+#else
+	return false;
+#endif
+}
+
 static inline unsigned int queue_max_zone_append_sectors(const struct request_queue *q)
 {
 
 	const struct queue_limits *l = &q->limits;
 
+	/* Emulated zone append writes are regular writes within a zone */
+	if (blk_queue_emulates_zone_append(q))
+		return min(l->chunk_sectors, l->max_sectors);
 	return min(l->max_zone_append_sectors, l->max_sectors);
 }
 
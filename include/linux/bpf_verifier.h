@@ -448,6 +448,9 @@ struct bpf_subprog_info {
 	bool tail_call_reachable;
 	bool has_ld_abs;
 	bool is_async_cb;
+	/* verifier statistics, attributed to the function being executed */
+	u32 insn_processed;
+	u32 total_states;
 };
 
 /* single container for all structs
@@ -334,4 +334,81 @@ void net_dim(struct dim *dim, struct dim_sample end_sample);
  */
 void rdma_dim(struct dim *dim, u64 completions);
 
+/* Generic interrupt moderation */
+
+#define NET_DIM_PARAMS_NUM_PROFILES 5
+
+/**
+ * enum dim_irq_type - What the samples of a moderated interrupt count
+ *
+ * @DIM_IRQ_NET_RX: Received packets and bytes, tuned by net_dim()
+ * @DIM_IRQ_NET_TX: Sent packets and bytes, tuned by net_dim()
+ * @DIM_IRQ_COMPLETIONS: Completions, e.g. of block requests, tuned by rdma_dim()
+ */
+enum dim_irq_type {
+	DIM_IRQ_NET_RX,
+	DIM_IRQ_NET_TX,
+	DIM_IRQ_COMPLETIONS,
+};
+
+struct dim_irq_moder;
+
+/*
+ * Program the device with moderation profile @ix. For the net types,
+ * @moder holds the values of the net_dim profile; completion based users
+ * map @ix to their own table.
+ */
+typedef void (*dim_irq_set_moder_t)(struct dim_irq_moder *m, int ix,
+				    struct dim_cq_moder moder);
+
+/**
+ * struct dim_irq_hist - Statistics of one moderation profile
+ *
+ * @events: Number of interrupts taken while the profile was active
+ * @items: Number of packets or completions handled by those interrupts
+ */
+struct dim_irq_hist {
+	u64 events;
+	u64 items;
+};
+
+/**
+ * struct dim_irq_moder - Adaptive moderation state of one interrupt vector
+ *
+ * @dim: DIM algorithm state
+ * @type: What the samples count
+ * @set_moderation: Callback programming the device
+ * @irq: Interrupt number if registered with the irq core, -1 otherwise
+ * @cur_ix: Profile currently programmed into the device
+ * @fixed_ix: Profile pinned through sysfs, -1 if DIM is in charge
+ * @event_ctr: Number of interrupts fed to net_dim()
+ * @packets: Number of packets fed to net_dim()
+ * @bytes: Number of bytes fed to net_dim()
+ * @changes: Number of times the device was reprogrammed
+ * @hist: Per-profile statistics
+ */
+struct dim_irq_moder {
+	struct dim dim;
+	enum dim_irq_type type;
+	dim_irq_set_moder_t set_moderation;
+	int irq;
+	int cur_ix;
+	int fixed_ix;
+	u16 event_ctr;
+	u64 packets;
+	u64 bytes;
+	unsigned long changes;
+	struct dim_irq_hist hist[RDMA_DIM_PARAMS_NUM_PROFILES];
+};
+
+void dim_irq_moder_init(struct dim_irq_moder *m, enum dim_irq_type type,
+			u8 cq_period_mode, dim_irq_set_moder_t set_moderation);
+int dim_irq_moder_register(struct dim_irq_moder *m, unsigned int irq);
+void dim_irq_moder_unregister(struct dim_irq_moder *m);
+void dim_irq_moder_sample(struct dim_irq_moder *m, u64 items, u64 bytes);
+
+ssize_t dim_irq_moder_show(struct dim_irq_moder *m, char *buf);
+ssize_t dim_irq_moder_store(struct dim_irq_moder *m, const char *buf);
+ssize_t dim_irq_moder_hist_show(struct dim_irq_moder *m, char *buf);
+
 #endif /* DIM_H */
@@ -679,6 +679,7 @@ struct inode {
 	unsigned long		dirtied_time_when;
 
 	struct hlist_node	i_hash;
+	spinlock_t		*i_hash_lock;	/* lock of the i_hash bucket */
 	struct list_head	i_io_list;	/* backing dev IO list */
 #ifdef CONFIG_CGROUP_WRITEBACK
 	struct bdi_writeback	*i_wb;		/* the associated cgroup wb */
@@ -945,6 +946,8 @@ struct fown_struct {
  * @async_size: Start next readahead when this many pages are left.
  * @ra_pages: Maximum size of a readahead request.
  * @mmap_miss: How many mmap accesses missed in the page cache.
+ * @consumed: Readahead pages used since @ra_pages was last adjusted.
+ * @wasted: Readahead pages evicted unused since @ra_pages was last adjusted.
  * @prev_pos: The last byte in the most recent read request.
  */
 struct file_ra_state {
@@ -953,6 +956,8 @@ struct file_ra_state {
 	unsigned int async_size;
 	unsigned int ra_pages;
 	unsigned int mmap_miss;
+	unsigned int consumed;
+	unsigned int wasted;
 	loff_t prev_pos;
 };
 
@@ -2009,6 +2014,7 @@ struct dir_context {
 #define COPY_FILE_SPLICE		(1 << 0)
 
 struct iov_iter;
+struct io_uring_cmd;
 
 struct file_operations {
 	struct module *owner;
@@ -2050,6 +2056,7 @@ struct file_operations {
 				   struct file *file_out, loff_t pos_out,
 				   loff_t len, unsigned int remap_flags);
 	int (*fadvise)(struct file *, loff_t, loff_t, int);
+	int (*uring_cmd)(struct io_uring_cmd *ioucmd, unsigned int issue_flags);
 } __randomize_layout;
 
 struct inode_operations {
@@ -448,6 +448,9 @@ static inline void enable_irq_lockdep_irqrestore(unsigned int irq, unsigned long
 /* IRQ wakeup (PM) control: */
 extern int irq_set_irq_wake(unsigned int irq, unsigned int on);
 
+struct dim_irq_moder;
+extern int irq_set_moderation(unsigned int irq, struct dim_irq_moder *moder);
+
 static inline int enable_irq_wake(unsigned int irq)
 {
 	return irq_set_irq_wake(irq, 1);
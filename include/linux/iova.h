@@ -24,14 +24,14 @@ struct iova {
 
 struct iova_magazine;
 struct iova_cpu_rcache;
+struct iova_depot;
 
-#define IOVA_RANGE_CACHE_MAX_SIZE 6	/* log of max cached IOVA range size (in pages) */
-#define MAX_GLOBAL_MAGS 32	/* magazines per bin */
+#define IOVA_RANGE_CACHE_MAX_SIZE 10	/* upper bound for log of cached IOVA range size (in pages) */
+#define IOVA_RANGE_CACHE_DEFAULT_SIZE 6	/* default log of max cached IOVA range size */
+#define MAX_GLOBAL_MAGS 32	/* magazines per bin and NUMA node */
 
 struct iova_rcache {
-	spinlock_t lock;
-	unsigned long depot_size;
-	struct iova_magazine *depot[MAX_GLOBAL_MAGS];
+	struct iova_depot *depots;	/* one per NUMA node */
 	struct iova_cpu_rcache __percpu *cpu_rcaches;
 };
 
@@ -43,8 +43,9 @@ typedef void (* iova_flush_cb)(struct iova_domain *domain);
 /* Destructor for per-entry data */
 typedef void (* iova_entry_dtor)(unsigned long data);
 
-/* Number of entries per Flush Queue */
+/* Default and maximum number of entries per Flush Queue */
 #define IOVA_FQ_SIZE	256
+#define IOVA_FQ_MAX_SIZE	512
 
 /* Timeout (in ms) after which entries are flushed from the Flush-Queue */
 #define IOVA_FQ_TIMEOUT	10
@@ -59,9 +60,10 @@ struct iova_fq_entry {
 
 /* Per-CPU Flush Queue structure */
 struct iova_fq {
-	struct iova_fq_entry entries[IOVA_FQ_SIZE];
 	unsigned head, tail;
+	unsigned mod_mask;	/* number of entries - 1 */
 	spinlock_t lock;
+	struct iova_fq_entry entries[];
 };
 
 /* holds all the iova translations for a domain */
@@ -83,6 +85,7 @@ struct iova_domain {
 						   have been finished */
 
 	struct iova	anchor;		/* rbtree lookup anchor */
+	unsigned int	rcache_max_size; /* number of rcaches in use */
 	struct iova_rcache rcaches[IOVA_RANGE_CACHE_MAX_SIZE];	/* IOVA range caches */
 
 	iova_flush_cb	flush_cb;	/* Call-Back function to flush IOMMU
@@ -95,6 +98,7 @@ struct iova_domain {
 						   flush-queues */
 	atomic_t fq_timer_on;			/* 1 when timer is active, 0
 						   when not */
+	unsigned int fq_timeout;		/* Flush timeout in ms */
 	struct hlist_node	cpuhp_dead;
 };
 
@@ -154,7 +158,8 @@ struct iova *reserve_iova(struct iova_domain *iovad, unsigned long pfn_lo,
 void init_iova_domain(struct iova_domain *iovad, unsigned long granule,
 	unsigned long start_pfn);
 int init_iova_flush_queue(struct iova_domain *iovad,
-			  iova_flush_cb flush_cb, iova_entry_dtor entry_dtor);
+			  iova_flush_cb flush_cb, iova_entry_dtor entry_dtor,
+			  unsigned int fq_size, unsigned int fq_timeout);
 struct iova *find_iova(struct iova_domain *iovad, unsigned long pfn);
 void put_iova_domain(struct iova_domain *iovad);
 #else
@@ -218,7 +223,9 @@ static inline void init_iova_domain(struct iova_domain *iovad,
 
 static inline int init_iova_flush_queue(struct iova_domain *iovad,
 					iova_flush_cb flush_cb,
-					iova_entry_dtor entry_dtor)
+					iova_entry_dtor entry_dtor,
+					unsigned int fq_size,
+					unsigned int fq_timeout)
 {
 	return -ENODEV;
 }
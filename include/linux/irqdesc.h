@@ -16,6 +16,7 @@ struct module;
 struct irq_desc;
 struct irq_domain;
 struct pt_regs;
+struct dim_irq_moder;
 
 /**
  * struct irq_desc - interrupt descriptor
@@ -48,6 +49,7 @@ struct pt_regs;
  * @rcu:		rcu head for delayed free
  * @kobj:		kobject used to represent this struct in sysfs
  * @request_mutex:	mutex to protect request/free before locking desc->lock
+ * @moder:		adaptive moderation state, protected by request_mutex
  * @dir:		/proc/irq/ procfs entry
  * @debugfs_file:	dentry for the debugfs file
  * @name:		flow handler name for /proc/interrupts output
@@ -99,6 +101,9 @@ struct irq_desc {
 	struct kobject		kobj;
 #endif
 	struct mutex		request_mutex;
+#ifdef CONFIG_DIMLIB
+	struct dim_irq_moder	*moder;
+#endif
 	int			parent_irq;
 	struct module		*owner;
 	const char		*name;
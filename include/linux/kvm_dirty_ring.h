@@ -2,6 +2,7 @@
 #define KVM_DIRTY_RING_H
 
 #include <linux/kvm.h>
+#include <linux/mutex.h>
 
 /**
  * kvm_dirty_ring: KVM internal dirty ring structure
@@ -15,7 +16,13 @@
  * @soft_limit:  when the number of dirty pages in the list reaches this
  *               limit, vcpu that owns this ring should exit to userspace
  *               to allow userspace to harvest all the dirty pages
+ * @notify_limit: when the number of dirty pages in the list reaches this
+ *               limit, @notify is signalled so that userspace can start
+ *               harvesting before the vcpu has to exit
  * @dirty_gfns:  the array to keep the dirty gfns
+ * @notify:      optional eventfd, see @notify_limit
+ * @reset_lock:  serializes resets of this ring, which may come from both
+ *               KVM_RESET_DIRTY_RINGS and the per-vcpu KVM_RESET_DIRTY_RING
  * @index:       index of this dirty ring
  */
 struct kvm_dirty_ring {
@@ -23,7 +30,10 @@ struct kvm_dirty_ring {
 	u32 reset_index;
 	u32 size;
 	u32 soft_limit;
+	u32 notify_limit;
 	struct kvm_dirty_gfn *dirty_gfns;
+	struct eventfd_ctx *notify;
+	struct mutex reset_lock;
 	int index;
 };
 
@@ -81,8 +91,8 @@ int kvm_dirty_ring_alloc(struct kvm_dirty_ring *ring, int index, u32 size);
 struct kvm_dirty_ring *kvm_dirty_ring_get(struct kvm *kvm);
 
 /*
- * called with kvm->slots_lock held, returns the number of
- * processed pages.
+ * called with kvm->slots_lock held or inside a kvm->srcu read side
+ * critical section, returns the number of processed pages.
  */
 int kvm_dirty_ring_reset(struct kvm *kvm, struct kvm_dirty_ring *ring);
 
@@ -319,6 +319,9 @@ struct kvm_vcpu {
 	sigset_t sigset;
 	unsigned int halt_poll_ns;
 	bool valid_wakeup;
+	/* Decaying log2 histogram of block times, for adaptive polling */
+	u32 halt_block_hist[HALT_POLL_HIST_COUNT];
+	u32 halt_block_samples;
 
 #ifdef CONFIG_HAS_IOMEM
 	int mmio_needed;
@@ -722,7 +725,14 @@ struct kvm {
 	struct srcu_struct irq_srcu;
 	pid_t userspace_pid;
 	unsigned int max_halt_poll_ns;
+	unsigned int halt_poll_grow;
+	unsigned int halt_poll_grow_start;
+	unsigned int halt_poll_shrink;
+	bool override_halt_poll_params;
+	bool halt_poll_adaptive;
 	u32 dirty_ring_size;
+	struct eventfd_ctx *dirty_ring_notify;
+	u32 dirty_ring_notify_limit;
 	bool vm_bugged;
 
 #ifdef CONFIG_HAVE_KVM_PM_NOTIFIER
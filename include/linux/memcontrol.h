@@ -87,6 +87,13 @@ struct memcg_vmstats_percpu {
 	/* Cgroup1: threshold notifications & softlimit tree updates */
 	unsigned long		nr_page_events;
 	unsigned long		targets[MEM_CGROUP_NTARGETS];
+
+	/* Stats updates since the last flush */
+	unsigned int		stats_updates;
+
+	/* Cached pointers for fast iteration in memcg_rstat_updated() */
+	struct memcg_vmstats_percpu	*parent;
+	struct memcg_vmstats		*vmstats;
 };
 
 struct memcg_vmstats {
@@ -97,6 +104,9 @@ struct memcg_vmstats {
 	/* Pending child counts during tree propagation */
 	long			state_pending[MEMCG_NR_STAT];
 	unsigned long		events_pending[NR_VM_EVENT_ITEMS];
+
+	/* Stats updates in the subtree since the last flush */
+	atomic64_t		stats_updates;
 };
 
 struct mem_cgroup_reclaim_iter {
@@ -358,9 +368,12 @@ struct mem_cgroup {
 
 /*
  * size of first charge trial. "32" comes from vmscan.c's magic value.
- * TODO: maybe necessary to use big numbers in big irons.
+ * Machines with many cpus charge in bigger batches while the memcg is far
+ * from its limits, see memcg_charge_batch(), but never more than
+ * MEMCG_CHARGE_BATCH_MAX pages at once.
  */
 #define MEMCG_CHARGE_BATCH 32U
+#define MEMCG_CHARGE_BATCH_MAX 256U
 
 extern struct mem_cgroup *root_mem_cgroup;
 
@@ -1041,8 +1054,8 @@ static inline unsigned long lruvec_page_state_local(struct lruvec *lruvec,
 	return x;
 }
 
-void mem_cgroup_flush_stats(void);
-void mem_cgroup_flush_stats_delayed(void);
+void mem_cgroup_flush_stats(struct mem_cgroup *memcg);
+void mem_cgroup_flush_stats_delayed(struct mem_cgroup *memcg);
 
 void __mod_memcg_lruvec_state(struct lruvec *lruvec, enum node_stat_item idx,
 			      int val);
@@ -1476,11 +1489,11 @@ static inline unsigned long lruvec_page_state_local(struct lruvec *lruvec,
 	return node_page_state(lruvec_pgdat(lruvec), idx);
 }
 
-static inline void mem_cgroup_flush_stats(void)
+static inline void mem_cgroup_flush_stats(struct mem_cgroup *memcg)
 {
 }
 
-static inline void mem_cgroup_flush_stats_delayed(void)
+static inline void mem_cgroup_flush_stats_delayed(struct mem_cgroup *memcg)
 {
 }
 
@@ -385,6 +385,19 @@ struct vm_area_struct {
 	struct mempolicy *vm_policy;	/* NUMA policy for the VMA */
 #endif
 	struct vm_userfaultfd_ctx vm_userfaultfd_ctx;
+#ifdef CONFIG_PER_VMA_LOCK
+	/*
+	 * Page faults may run under vm_lock instead of the mmap_lock. The vma
+	 * is write-locked while vm_lock_seq == vm_mm->mm_lock_seq, which lasts
+	 * until the mmap_lock is dropped. See vma_start_write().
+	 */
+	int vm_lock_seq;
+	/* Set once the vma has been removed from the mm's tree */
+	bool detached;
+	struct rw_semaphore vm_lock;
+	/* Lockless lookups may still see a vma after it was freed */
+	struct rcu_head vm_rcu;
+#endif
 } __randomize_layout;
 
 struct core_thread {
@@ -471,6 +484,13 @@ struct mm_struct {
 		 * cacheline.
 		 */
 		struct rw_semaphore mmap_lock;
+#ifdef CONFIG_PER_VMA_LOCK
+		/*
+		 * Bumped on every mmap_write_unlock(), which releases all
+		 * vma write locks taken under it at once.
+		 */
+		int mm_lock_seq;
+#endif
 
 		struct list_head mmlist; /* List of maybe swapped mm's.	These
 					  * are globally strung together off
@@ -14,6 +14,15 @@
 DECLARE_TRACEPOINT(mmap_lock_start_locking);
 DECLARE_TRACEPOINT(mmap_lock_acquire_returned);
 DECLARE_TRACEPOINT(mmap_lock_released);
+DECLARE_TRACEPOINT(mmap_lock_vma_fault);
+
+/* Outcome of trying to handle a page fault under the per-VMA lock */
+enum vma_lock_fault {
+	VMA_LOCK_SUCCESS,	/* handled without the mmap_lock */
+	VMA_LOCK_ABORT,		/* no suitable vma, fall back to the mmap_lock */
+	VMA_LOCK_RETRY,		/* handler wants a retry under the mmap_lock */
+	VMA_LOCK_MISS,		/* vma was detached under us, look it up again */
+};
 
 #ifdef CONFIG_TRACING
 
@@ -21,6 +30,9 @@ void __mmap_lock_do_trace_start_locking(struct mm_struct *mm, bool write);
 void __mmap_lock_do_trace_acquire_returned(struct mm_struct *mm, bool write,
 					   bool success);
 void __mmap_lock_do_trace_released(struct mm_struct *mm, bool write);
+void __mmap_lock_do_trace_vma_fault(struct mm_struct *mm,
+				    unsigned long address,
+				    enum vma_lock_fault result);
 
 static inline void __mmap_lock_trace_start_locking(struct mm_struct *mm,
 						   bool write)
@@ -42,6 +54,14 @@ static inline void __mmap_lock_trace_released(struct mm_struct *mm, bool write)
 		__mmap_lock_do_trace_released(mm, write);
 }
 
+static inline void mmap_lock_trace_vma_fault(struct mm_struct *mm,
+					     unsigned long address,
+					     enum vma_lock_fault result)
+{
+	if (tracepoint_enabled(mmap_lock_vma_fault))
+		__mmap_lock_do_trace_vma_fault(mm, address, result);
+}
+
 #else /* !CONFIG_TRACING */
 
 static inline void __mmap_lock_trace_start_locking(struct mm_struct *mm,
@@ -58,11 +78,37 @@ static inline void __mmap_lock_trace_released(struct mm_struct *mm, bool write)
 {
 }
 
+static inline void mmap_lock_trace_vma_fault(struct mm_struct *mm,
+					     unsigned long address,
+					     enum vma_lock_fault result)
+{
+}
+
 #endif /* CONFIG_TRACING */
 
+#ifdef CONFIG_PER_VMA_LOCK
+/*
+ * Drop all vma write locks taken under the mmap_lock. Called with the
+ * mmap_lock held for write, so the update itself can't race.
+ */
+static inline void vma_end_write_all(struct mm_struct *mm)
+{
+	smp_store_release(&mm->mm_lock_seq, mm->mm_lock_seq + 1);
+}
+
+static inline void mm_lock_seq_init(struct mm_struct *mm)
+{
+	mm->mm_lock_seq = 0;
+}
+#else
+static inline void vma_end_write_all(struct mm_struct *mm) {}
+static inline void mm_lock_seq_init(struct mm_struct *mm) {}
+#endif
+
 static inline void mmap_init_lock(struct mm_struct *mm)
 {
 	init_rwsem(&mm->mmap_lock);
+	mm_lock_seq_init(mm);
 }
 
 static inline void mmap_write_lock(struct mm_struct *mm)
@@ -102,12 +148,14 @@ static inline bool mmap_write_trylock(struct mm_struct *mm)
 static inline void mmap_write_unlock(struct mm_struct *mm)
 {
 	__mmap_lock_trace_released(mm, true);
+	vma_end_write_all(mm);
 	up_write(&mm->mmap_lock);
 }
 
 static inline void mmap_write_downgrade(struct mm_struct *mm)
 {
 	__mmap_lock_trace_acquire_returned(mm, false, true);
+	vma_end_write_all(mm);
 	downgrade_write(&mm->mmap_lock);
 }
 
@@ -210,6 +210,10 @@ enum node_stat_item {
 	NR_PAGETABLE,		/* used for pagetables */
 #ifdef CONFIG_SWAP
 	NR_SWAPCACHE,
+#endif
+#ifdef CONFIG_NUMA_BALANCING
+	PGPROMOTE_SUCCESS,	/* promote successfully */
+	PGPROMOTE_CANDIDATE,	/* candidate pages to promote */
 #endif
 	NR_VM_NODE_STAT_ITEMS
 };
@@ -670,11 +674,15 @@ enum zone_watermarks {
 #define high_wmark_pages(z) (z->_watermark[WMARK_HIGH] + z->watermark_boost)
 #define wmark_pages(z, i) (z->_watermark[i] + z->watermark_boost)
 
-/* Fields and list protected by pagesets local_lock in page_alloc.c */
+/* Fields and list protected by pcp->lock, see page_alloc.c */
 struct per_cpu_pages {
+	spinlock_t lock;	/* Protects lists field */
 	int count;		/* number of pages in the list */
 	int high;		/* high watermark, emptying needed */
+	int high_min;		/* min high watermark */
+	int high_max;		/* max high watermark */
 	int batch;		/* chunk size for buddy add/remove */
+	int free_count;		/* consecutive free count */
 	short free_factor;	/* batch scaling factor during free */
 #ifdef CONFIG_NUMA
 	short expire;		/* When 0, remote pagesets are drained */
@@ -831,7 +839,8 @@ struct zone {
 	 * the high and batch values are copied to individual pagesets for
 	 * faster access
 	 */
-	int pageset_high;
+	int pageset_high_min;
+	int pageset_high_max;
 	int pageset_batch;
 
 #ifndef CONFIG_SPARSEMEM
@@ -1103,6 +1112,26 @@ struct deferred_split {
 };
 #endif
 
+#define MAX_KSWAPD_THREADS	16
+
+struct kswapd_thread {
+	struct task_struct *task;	/* Protected by
+					   mem_hotplug_begin/end() */
+	struct pglist_data *pgdat;
+
+	/* Reclaim done by this thread, shown in /proc/zoneinfo */
+	unsigned long nr_wakeups;
+	unsigned long nr_scanned;
+	unsigned long nr_reclaimed;
+};
+
+/*
+ * Proactive compaction round latency histogram: bucket 0 counts rounds
+ * under 1ms, bucket n those in [2^(n-1), 2^n) ms and the last one all
+ * longer rounds.
+ */
+#define NR_PROACTIVE_COMPACT_LAT	10
+
 /*
  * On NUMA machines, each NUMA node would have a pg_data_t to describe
  * it's memory layout. On UMA machines there is a single pglist_data which
@@ -1155,8 +1184,8 @@ typedef struct pglist_data {
 	int node_id;
 	wait_queue_head_t kswapd_wait;
 	wait_queue_head_t pfmemalloc_wait;
-	struct task_struct *kswapd;	/* Protected by
-					   mem_hotplug_begin/end() */
+	/* Up to kswapd_threads are running, see kswapd_run() */
+	struct kswapd_thread kswapd[MAX_KSWAPD_THREADS];
 	int kswapd_order;
 	enum zone_type kswapd_highest_zoneidx;
 
@@ -1168,6 +1197,12 @@ typedef struct pglist_data {
 	wait_queue_head_t kcompactd_wait;
 	struct task_struct *kcompactd;
 	bool proactive_compact_trigger;
+	/* Per-node override of vm.compaction_proactiveness, -1 if none */
+	int compaction_proactiveness;
+	/* Proactive compaction rounds, those reaching the target, latency */
+	unsigned long proactive_compact_runs;
+	unsigned long proactive_compact_success;
+	unsigned long proactive_compact_lat[NR_PROACTIVE_COMPACT_LAT];
 #endif
 	/*
 	 * This is a per-node reserve of pages that are not available
@@ -1198,6 +1233,13 @@ typedef struct pglist_data {
 	struct deferred_split deferred_split_queue;
 #endif
 
+#ifdef CONFIG_NUMA_BALANCING
+	/* start time in ms of current promote rate limit period */
+	unsigned int nbp_rl_start;
+	/* number of promote candidate pages at start time of current period */
+	unsigned long nbp_rl_nr_cand;
+#endif
+
 	/* Fields commonly accessed by the page reclaim scanner */
 
 	/*
@@ -1384,6 +1426,8 @@ int min_free_kbytes_sysctl_handler(struct ctl_table *, int, void *, size_t *,
 		loff_t *);
 int watermark_scale_factor_sysctl_handler(struct ctl_table *, int, void *,
 		size_t *, loff_t *);
+int kswapd_threads_sysctl_handler(struct ctl_table *, int, void *,
+		size_t *, loff_t *);
 extern int sysctl_lowmem_reserve_ratio[MAX_NR_ZONES];
 int lowmem_reserve_ratio_sysctl_handler(struct ctl_table *, int, void *,
 		size_t *, loff_t *);
@@ -768,6 +768,13 @@ struct perf_event {
 
 #ifdef CONFIG_CGROUP_PERF
 	struct perf_cgroup		*cgrp; /* cgroup event is attach to */
+
+	/* per cgroup counts, see PERF_EVENT_IOC_ATTACH_CGROUP */
+	struct perf_cgroup_node		*cgrp_nodes;
+	struct hlist_head		*cgrp_node_hash;
+	int				cgrp_node_hash_bits;
+	u64				cgrp_node_count;
+	struct list_head		cgrp_node_entry;
 #endif
 
 #ifdef CONFIG_SECURITY
@@ -34,6 +34,7 @@ __poll_t psi_trigger_poll(void **trigger_ptr, struct file *file,
 #ifdef CONFIG_CGROUPS
 int psi_cgroup_alloc(struct cgroup *cgrp);
 void psi_cgroup_free(struct cgroup *cgrp);
+void psi_cgroup_set_enabled(struct cgroup *cgrp, bool enabled);
 void cgroup_move_task(struct task_struct *p, struct css_set *to);
 #endif
 
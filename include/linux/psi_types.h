@@ -143,6 +143,9 @@ struct psi_trigger {
 };
 
 struct psi_group {
+	/* Accounting of stall times enabled, see cgroup.pressure */
+	bool enabled;
+
 	/* Protects data used by the aggregator */
 	struct mutex avgs_lock;
 
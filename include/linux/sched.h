@@ -521,6 +521,8 @@ struct sched_statistics {
 	u64				nr_wakeups_affine_attempts;
 	u64				nr_wakeups_passive;
 	u64				nr_wakeups_idle;
+	u64				nr_wakeups_same_llc;
+	u64				nr_wakeups_llc_pack;
 #endif
 } ____cacheline_aligned;
 
@@ -538,6 +540,9 @@ struct sched_entity {
 
 	u64				nr_migrations;
 
+	/* Wakeup preemption and slice bias from latency nice, in ns */
+	long				latency_offset;
+
 #ifdef CONFIG_FAIR_GROUP_SCHED
 	int				depth;
 	struct sched_entity		*parent;
@@ -0,0 +1,24 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _LINUX_SCHED_BPF_H
+#define _LINUX_SCHED_BPF_H
+
+struct task_struct;
+
+#define SCHED_POLICY_NAME_MAX	16
+
+/**
+ * struct sched_policy_ops - BPF implemented placement policy for fair tasks
+ * @select_cpu:	Pick the CPU a fair task is woken up, forked or exec'ed on.
+ *		A negative return value, or a CPU which is not active or not
+ *		in the task's affinity mask, makes CFS choose as usual.
+ * @name:	Name of the policy.
+ *
+ * Implemented through BPF struct_ops; at most one policy is registered at
+ * any time, and unregistering it reverts to plain CFS placement.
+ */
+struct sched_policy_ops {
+	int (*select_cpu)(struct task_struct *p, int prev_cpu, int wake_flags);
+	char name[SCHED_POLICY_NAME_MAX];
+};
+
+#endif /* _LINUX_SCHED_BPF_H */
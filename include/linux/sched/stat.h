@@ -21,6 +21,7 @@ extern unsigned int nr_running(void);
 extern bool single_task_running(void);
 extern unsigned int nr_iowait(void);
 extern unsigned int nr_iowait_cpu(int cpu);
+extern u64 sched_idle_wakeup_ns(int cpu);
 
 static inline int sched_info_on(void)
 {
@@ -75,8 +75,20 @@ struct sched_domain_shared {
 	atomic_t	nr_busy_cpus;
 	int		has_idle_cores;
 	int		nr_idle_scan;
+
+	/*
+	 * CPUs of this LLC that entered idle and have not left it since.
+	 * Each CPU only ever updates its own bit, on idle entry and exit;
+	 * select_idle_cpu() uses it to skip known busy CPUs.
+	 */
+	unsigned long	idle_cpus[];
 };
 
+static inline struct cpumask *sds_idle_cpus(struct sched_domain_shared *sds)
+{
+	return to_cpumask(sds->idle_cpus);
+}
+
 struct sched_domain {
 	/* These fields must be setup */
 	struct sched_domain __rcu *parent;	/* top domain must be null terminated */
@@ -133,6 +145,9 @@ struct sched_domain {
 	unsigned int ttwu_wake_remote;
 	unsigned int ttwu_move_affine;
 	unsigned int ttwu_move_balance;
+
+	/* newidle_balance() stats */
+	unsigned int newidle_lb_skipped;
 #endif
 #ifdef CONFIG_SCHED_DEBUG
 	char *name;
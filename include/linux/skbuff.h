@@ -703,6 +703,7 @@ typedef unsigned char *sk_buff_data_t;
  *	@nf_bridge: Saved data about a bridged frame - see br_netfilter.c
  *	@skb_iif: ifindex of device we arrived on
  *	@tc_index: Traffic control index
+ *	@alloc_cpu: CPU which did the skb allocation.
  *	@hash: the packet hash
  *	@queue_mapping: Queue mapping for multiqueue devices
  *	@head_frag: skb was allocated from page fragments,
@@ -924,6 +925,7 @@ struct sk_buff {
 	__u16			tc_index;	/* traffic control index */
 #endif
 
+	u16			alloc_cpu;
 	union {
 		__wsum		csum;
 		struct {
@@ -3049,6 +3051,7 @@ void napi_consume_skb(struct sk_buff *skb, int budget);
 
 void napi_skb_free_stolen_head(struct sk_buff *skb);
 void __kfree_skb_defer(struct sk_buff *skb);
+void skb_attempt_defer_free(struct sk_buff *skb);
 
 /**
  * __dev_alloc_pages - allocate page for network Rx
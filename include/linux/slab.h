@@ -93,6 +93,9 @@
 /* Avoid kmemleak tracing */
 #define SLAB_NOLEAKTRACE	((slab_flags_t __force)0x00800000U)
 
+/* Cache objects in percpu arrays (SLUB only) */
+#define SLAB_PERCPU_SHEAVES	((slab_flags_t __force)0x01000000U)
+
 /* Fault injection mark */
 #ifdef CONFIG_FAILSLAB
 # define SLAB_FAILSLAB		((slab_flags_t __force)0x02000000U)
@@ -191,6 +194,15 @@ bool kmem_valid_obj(void *object);
 void kmem_dump_obj(void *object);
 #endif
 
+#ifdef CONFIG_SLUB
+bool kfree_rcu_sheaf(void *obj);
+#else
+static inline bool kfree_rcu_sheaf(void *obj)
+{
+	return false;
+}
+#endif
+
 #ifdef CONFIG_HAVE_HARDENED_USERCOPY_ALLOCATOR
 void __check_heap_object(const void *ptr, unsigned long n, struct page *page,
 			bool to_user);
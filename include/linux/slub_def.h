@@ -39,6 +39,11 @@ enum stat_item {
 	CPU_PARTIAL_FREE,	/* Refill cpu partial on free */
 	CPU_PARTIAL_NODE,	/* Refill cpu partial from node partial */
 	CPU_PARTIAL_DRAIN,	/* Drain cpu partial to node partial */
+	ALLOC_PCS,		/* Allocation from percpu sheaf */
+	FREE_PCS,		/* Free to percpu sheaf */
+	SHEAF_REFILL,		/* Percpu sheaf refilled from slabs */
+	SHEAF_FLUSH,		/* Percpu sheaf flushed to slabs */
+	FREE_RCU_SHEAF,		/* kfree_rcu() queued on percpu sheaf */
 	NR_SLUB_STAT_ITEMS };
 
 /*
@@ -89,6 +94,9 @@ struct kmem_cache_order_objects {
  */
 struct kmem_cache {
 	struct kmem_cache_cpu __percpu *cpu_slab;
+	/* Percpu object arrays, only with SLAB_PERCPU_SHEAVES */
+	struct slub_percpu_sheaves __percpu *cpu_sheaves;
+	unsigned int sheaf_capacity;	/* Objects per sheaf */
 	/* Used for retrieving partial slabs, etc. */
 	slab_flags_t flags;
 	unsigned long min_partial;
@@ -43,6 +43,7 @@ do {						\
  * flush_smp_call_function_queue() in detail.
  */
 extern void __smp_call_single_queue(int cpu, struct llist_node *node);
+extern bool __smp_call_single_queue_noipi(int cpu, struct llist_node *node);
 
 /* total number of cpus in this system (may exceed NR_CPUS) */
 extern unsigned int total_cpus;
@@ -280,7 +280,10 @@ struct rpc_xprt {
 		unsigned long long	req_u,		/* average requests on the wire */
 					bklog_u,	/* backlog queue utilization */
 					sending_u,	/* send q utilization */
-					pending_u;	/* pend q utilization */
+					pending_u,	/* pend q utilization */
+					bytes_sent,	/* request bytes sent */
+					bytes_recv,	/* reply bytes received */
+					rtt_us;		/* total reply RTT */
 	} stat;
 
 	struct net		*xprt_net;
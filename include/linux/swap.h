@@ -411,6 +411,7 @@ static inline bool node_reclaim_enabled(void)
 
 extern void check_move_unevictable_pages(struct pagevec *pvec);
 
+extern int kswapd_threads;
 extern void kswapd_run(int nid);
 extern void kswapd_stop(int nid);
 
@@ -125,6 +125,22 @@ struct rcu_work {
 	struct workqueue_struct *wq;
 };
 
+/*
+ * Affinity scopes of unbound workqueues. CPUs are grouped into pods of the
+ * selected scope and work items are executed by workers of the pod which
+ * contains the CPU the work item was issued on.
+ */
+enum wq_affn_scope {
+	WQ_AFFN_DFL,			/* use system default */
+	WQ_AFFN_CPU,			/* one pod per CPU */
+	WQ_AFFN_SMT,			/* one pod per SMT core */
+	WQ_AFFN_CACHE,			/* one pod per last level cache */
+	WQ_AFFN_NUMA,			/* one pod per NUMA node */
+	WQ_AFFN_SYSTEM,			/* one pod across the whole system */
+
+	WQ_AFFN_NR_TYPES,
+};
+
 /**
  * struct workqueue_attrs - A struct for workqueue attributes.
  *
@@ -142,13 +158,32 @@ struct workqueue_attrs {
 	cpumask_var_t cpumask;
 
 	/**
-	 * @no_numa: disable NUMA affinity
+	 * @__pod_cpumask: CPUs of the pod a worker_pool serves
+	 *
+	 * Internal use only. A workqueue is served by one worker_pool per pod
+	 * and this is the subset of ``cpumask`` belonging to the pod. Whether
+	 * the workers are confined to it depends on ``affn_strict``.
+	 */
+	cpumask_var_t __pod_cpumask;
+
+	/**
+	 * @affn_strict: confine workers to their pod
 	 *
-	 * Unlike other fields, ``no_numa`` isn't a property of a worker_pool. It
-	 * only modifies how :c:func:`apply_workqueue_attrs` select pools and thus
-	 * doesn't participate in pool hash calculations or equality comparisons.
+	 * If clear, workers may run on any CPU in ``cpumask`` and are only
+	 * steered towards their pod when woken up. If set, workers are
+	 * restricted to the CPUs of their pod.
 	 */
-	bool no_numa;
+	bool affn_strict;
+
+	/**
+	 * @affn_scope: unbound CPU affinity scope
+	 *
+	 * Unlike other fields, ``affn_scope`` isn't a property of a worker_pool.
+	 * It only modifies how :c:func:`apply_workqueue_attrs` select pools and
+	 * thus doesn't participate in pool hash calculations or equality
+	 * comparisons.
+	 */
+	enum wq_affn_scope affn_scope;
 };
 
 static inline struct delayed_work *to_delayed_work(struct work_struct *work)
@@ -336,6 +371,16 @@ enum {
 	 */
 	WQ_POWER_EFFICIENT	= 1 << 7,
 
+	/*
+	 * Unbound workqueues are served by one worker pool per NUMA node
+	 * by default. Work items which mostly touch data that is still
+	 * hot in the issuing CPU's cache, e.g. IO completions, are better
+	 * off executing within the same last level cache. This flag
+	 * selects the "cache" affinity scope for such a workqueue. It has
+	 * no effect on per-cpu workqueues.
+	 */
+	WQ_CACHE_AFFINE		= 1 << 8,
+
 	__WQ_DRAINING		= 1 << 16, /* internal: workqueue is draining */
 	__WQ_ORDERED		= 1 << 17, /* internal: workqueue is ordered */
 	__WQ_LEGACY		= 1 << 18, /* internal: create*_workqueue() */
@@ -663,5 +708,6 @@ int workqueue_offline_cpu(unsigned int cpu);
 
 void __init workqueue_init_early(void);
 void __init workqueue_init(void);
+void __init workqueue_init_topology(void);
 
 #endif
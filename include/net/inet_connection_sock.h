@@ -225,15 +225,21 @@ static inline void inet_csk_reset_xmit_timer(struct sock *sk, const int what,
 		when = max_when;
 	}
 
+	/*
+	 * Both timer handlers re-arm themselves when they fire before
+	 * icsk_timeout / icsk_ack.timeout, so a pending timer only needs
+	 * to be touched when the new deadline is earlier. This keeps the
+	 * per-ACK re-arm from churning the timer wheel.
+	 */
 	if (what == ICSK_TIME_RETRANS || what == ICSK_TIME_PROBE0 ||
 	    what == ICSK_TIME_LOSS_PROBE || what == ICSK_TIME_REO_TIMEOUT) {
 		icsk->icsk_pending = what;
 		icsk->icsk_timeout = jiffies + when;
-		sk_reset_timer(sk, &icsk->icsk_retransmit_timer, icsk->icsk_timeout);
+		sk_reduce_timer(sk, &icsk->icsk_retransmit_timer, icsk->icsk_timeout);
 	} else if (what == ICSK_TIME_DACK) {
 		icsk->icsk_ack.pending |= ICSK_ACK_TIMER;
 		icsk->icsk_ack.timeout = jiffies + when;
-		sk_reset_timer(sk, &icsk->icsk_delack_timer, icsk->icsk_ack.timeout);
+		sk_reduce_timer(sk, &icsk->icsk_delack_timer, icsk->icsk_ack.timeout);
 	} else {
 		pr_debug("inet_csk BUG: unknown timer value\n");
 	}
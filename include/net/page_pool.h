@@ -80,6 +80,7 @@ struct page_pool_params {
 	enum dma_data_direction dma_dir; /* DMA mapping direction */
 	unsigned int	max_len; /* max DMA sync memory size */
 	unsigned int	offset;  /* DMA addr offset */
+	struct napi_struct *napi; /* NAPI consuming the pages, if any */
 };
 
 #ifdef CONFIG_PAGE_POOL_STATS
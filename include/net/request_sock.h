@@ -174,15 +174,18 @@ struct request_sock_queue {
 	spinlock_t		rskq_lock;
 	u8			rskq_defer_accept;
 
-	u32			synflood_warned;
-	atomic_t		qlen;
-	atomic_t		young;
-
 	struct request_sock	*rskq_accept_head;
 	struct request_sock	*rskq_accept_tail;
 	struct fastopen_queue	fastopenq;  /* Check max_qlen != 0 to determine
 					     * if TFO is enabled.
 					     */
+
+	/* Updated for every SYN received on the listener, from softirq on
+	 * any cpu: keep them apart from the accept() side fields above.
+	 */
+	atomic_t		qlen;
+	atomic_t		young;
+	u32			synflood_warned;
 };
 
 void reqsk_queue_alloc(struct request_sock_queue *queue);
@@ -1254,7 +1254,9 @@ struct proto {
 	/* Memory pressure */
 	void			(*enter_memory_pressure)(struct sock *sk);
 	void			(*leave_memory_pressure)(struct sock *sk);
-	atomic_long_t		*memory_allocated;	/* Current allocated memory. */
+	/* Current allocated memory. */
+	atomic_long_t		*memory_allocated;
+	int  __percpu		*per_cpu_fw_alloc;
 	struct percpu_counter	*sockets_allocated;	/* Current number of sockets. */
 	/*
 	 * Pressure flag: try to collapse.
@@ -1399,16 +1401,52 @@ sk_memory_allocated(const struct sock *sk)
 	return atomic_long_read(sk->sk_prot->memory_allocated);
 }
 
-static inline long
+/* 1 MB per cpu, in page units */
+#define SK_MEMORY_PCPU_RESERVE (1 << (20 - PAGE_SHIFT))
+
+/* Protocols providing per_cpu_fw_alloc batch their updates to the shared
+ * memory_allocated counter: each cpu accumulates up to
+ * SK_MEMORY_PCPU_RESERVE pages locally before folding them in, so the
+ * global value may be off by that much per cpu.
+ */
+static inline void
 sk_memory_allocated_add(struct sock *sk, int amt)
 {
-	return atomic_long_add_return(amt, sk->sk_prot->memory_allocated);
+	struct proto *prot = sk->sk_prot;
+	int local_reserve;
+
+	if (!prot->per_cpu_fw_alloc) {
+		atomic_long_add(amt, prot->memory_allocated);
+		return;
+	}
+
+	preempt_disable();
+	local_reserve = __this_cpu_add_return(*prot->per_cpu_fw_alloc, amt);
+	if (local_reserve >= SK_MEMORY_PCPU_RESERVE) {
+		__this_cpu_sub(*prot->per_cpu_fw_alloc, local_reserve);
+		atomic_long_add(local_reserve, prot->memory_allocated);
+	}
+	preempt_enable();
 }
 
 static inline void
 sk_memory_allocated_sub(struct sock *sk, int amt)
 {
-	atomic_long_sub(amt, sk->sk_prot->memory_allocated);
+	struct proto *prot = sk->sk_prot;
+	int local_reserve;
+
+	if (!prot->per_cpu_fw_alloc) {
+		atomic_long_sub(amt, prot->memory_allocated);
+		return;
+	}
+
+	preempt_disable();
+	local_reserve = __this_cpu_sub_return(*prot->per_cpu_fw_alloc, amt);
+	if (local_reserve <= -SK_MEMORY_PCPU_RESERVE) {
+		__this_cpu_sub(*prot->per_cpu_fw_alloc, local_reserve);
+		atomic_long_add(local_reserve, prot->memory_allocated);
+	}
+	preempt_enable();
 }
 
 #define SK_ALLOC_PERCPU_COUNTER_BATCH 16
@@ -1440,7 +1478,7 @@ proto_sockets_allocated_sum_positive(struct proto *prot)
 static inline long
 proto_memory_allocated(struct proto *prot)
 {
-	return atomic_long_read(prot->memory_allocated);
+	return max(0L, atomic_long_read(prot->memory_allocated));
 }
 
 static inline bool
@@ -2358,6 +2396,9 @@ static inline void skb_prepare_for_gro(struct sk_buff *skb)
 void sk_reset_timer(struct sock *sk, struct timer_list *timer,
 		    unsigned long expires);
 
+void sk_reduce_timer(struct sock *sk, struct timer_list *timer,
+		     unsigned long expires);
+
 void sk_stop_timer(struct sock *sk, struct timer_list *timer);
 
 void sk_stop_timer_sync(struct sock *sk, struct timer_list *timer);
@@ -1580,7 +1580,7 @@ struct ib_cq {
 		struct work_struct	work;
 	};
 	struct workqueue_struct *comp_wq;
-	struct dim *dim;
+	struct dim_irq_moder *dim;
 
 	/* updated only by trace points */
 	ktime_t timestamp;
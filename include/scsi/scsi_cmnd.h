@@ -76,6 +76,7 @@ struct scsi_cmnd {
 	int eh_eflags;		/* Used by error handlr */
 
 	int budget_token;
+	int target_budget_token;
 
 	/*
 	 * This is set to jiffies as it was when the command was first
@@ -2152,6 +2152,7 @@ DECLARE_EVENT_CLASS(btrfs_sleep_tree_lock,
 		__field(	u64,	end_ns		)
 		__field(	u64,	diff_ns		)
 		__field(	u64,	owner		)
+		__field(	int,	level		)
 		__field(	int,	is_log_tree	)
 	),
 
@@ -2162,14 +2163,15 @@ DECLARE_EVENT_CLASS(btrfs_sleep_tree_lock,
 		__entry->end_ns		= ktime_get_ns();
 		__entry->diff_ns	= __entry->end_ns - start_ns;
 		__entry->owner		= btrfs_header_owner(eb);
+		__entry->level		= btrfs_header_level(eb);
 		__entry->is_log_tree	= (eb->log_index >= 0);
 	),
 
 	TP_printk_btrfs(
-"block=%llu generation=%llu start_ns=%llu end_ns=%llu diff_ns=%llu owner=%llu is_log_tree=%d",
+"block=%llu generation=%llu start_ns=%llu end_ns=%llu diff_ns=%llu owner=%llu level=%d is_log_tree=%d",
 		__entry->block, __entry->generation,
 		__entry->start_ns, __entry->end_ns, __entry->diff_ns,
-		__entry->owner, __entry->is_log_tree)
+		__entry->owner, __entry->level, __entry->is_log_tree)
 );
 
 DEFINE_EVENT(btrfs_sleep_tree_lock, btrfs_tree_read_lock,
@@ -2193,6 +2195,7 @@ DECLARE_EVENT_CLASS(btrfs_locking_events,
 		__field(	u64,	block		)
 		__field(	u64,	generation	)
 		__field(	u64,	owner		)
+		__field(	int,	level		)
 		__field(	int,	is_log_tree	)
 	),
 
@@ -2200,12 +2203,13 @@ DECLARE_EVENT_CLASS(btrfs_locking_events,
 		__entry->block		= eb->start;
 		__entry->generation	= btrfs_header_generation(eb);
 		__entry->owner		= btrfs_header_owner(eb);
+		__entry->level		= btrfs_header_level(eb);
 		__entry->is_log_tree	= (eb->log_index >= 0);
 	),
 
-	TP_printk_btrfs("block=%llu generation=%llu owner=%llu is_log_tree=%d",
+	TP_printk_btrfs("block=%llu generation=%llu owner=%llu level=%d is_log_tree=%d",
 		__entry->block, __entry->generation,
-		__entry->owner, __entry->is_log_tree)
+		__entry->owner, __entry->level, __entry->is_log_tree)
 );
 
 #define DEFINE_BTRFS_LOCK_EVENT(name)				\
@@ -2223,6 +2227,8 @@ DEFINE_BTRFS_LOCK_EVENT(btrfs_set_lock_blocking_write);
 DEFINE_BTRFS_LOCK_EVENT(btrfs_try_tree_read_lock);
 DEFINE_BTRFS_LOCK_EVENT(btrfs_try_tree_write_lock);
 DEFINE_BTRFS_LOCK_EVENT(btrfs_tree_read_lock_atomic);
+DEFINE_BTRFS_LOCK_EVENT(btrfs_search_root_lockless);
+DEFINE_BTRFS_LOCK_EVENT(btrfs_search_root_lockless_fallback);
 
 DECLARE_EVENT_CLASS(btrfs__space_info_update,
 
@@ -5,6 +5,7 @@
 #if !defined(_TRACE_MMAP_LOCK_H) || defined(TRACE_HEADER_MULTI_READ)
 #define _TRACE_MMAP_LOCK_H
 
+#include <linux/mmap_lock.h>
 #include <linux/tracepoint.h>
 #include <linux/types.h>
 
@@ -101,6 +102,47 @@ TRACE_EVENT_FN(mmap_lock_released,
 	trace_mmap_lock_reg, trace_mmap_lock_unreg
 );
 
+TRACE_DEFINE_ENUM(VMA_LOCK_SUCCESS);
+TRACE_DEFINE_ENUM(VMA_LOCK_ABORT);
+TRACE_DEFINE_ENUM(VMA_LOCK_RETRY);
+TRACE_DEFINE_ENUM(VMA_LOCK_MISS);
+
+TRACE_EVENT_FN(mmap_lock_vma_fault,
+
+	TP_PROTO(struct mm_struct *mm, const char *memcg_path,
+		unsigned long address, int result),
+
+	TP_ARGS(mm, memcg_path, address, result),
+
+	TP_STRUCT__entry(
+		__field(struct mm_struct *, mm)
+		__string(memcg_path, memcg_path)
+		__field(unsigned long, address)
+		__field(int, result)
+	),
+
+	TP_fast_assign(
+		__entry->mm = mm;
+		__assign_str(memcg_path, memcg_path);
+		__entry->address = address;
+		__entry->result = result;
+	),
+
+	TP_printk(
+		"mm=%p memcg_path=%s address=%lx result=%s\n",
+		__entry->mm,
+		__get_str(memcg_path),
+		__entry->address,
+		__print_symbolic(__entry->result,
+				 { VMA_LOCK_SUCCESS,	"success" },
+				 { VMA_LOCK_ABORT,	"abort" },
+				 { VMA_LOCK_RETRY,	"retry" },
+				 { VMA_LOCK_MISS,	"miss" })
+	),
+
+	trace_mmap_lock_reg, trace_mmap_lock_unreg
+);
+
 #endif /* _TRACE_MMAP_LOCK_H */
 
 /* This part must be outside protection */
@@ -149,6 +149,30 @@ DEFINE_EVENT(cpu, cpu_frequency,
 	TP_ARGS(frequency, cpu_id)
 );
 
+TRACE_EVENT(sugov_burst_decision,
+
+	TP_PROTO(unsigned int cpu_id, unsigned long util, u64 latency_ns),
+
+	TP_ARGS(cpu_id, util, latency_ns),
+
+	TP_STRUCT__entry(
+		__field(u32, cpu_id)
+		__field(unsigned long, util)
+		__field(u64, latency_ns)
+	),
+
+	TP_fast_assign(
+		__entry->cpu_id = cpu_id;
+		__entry->util = util;
+		__entry->latency_ns = latency_ns;
+	),
+
+	TP_printk("cpu_id=%lu util=%lu latency_ns=%llu",
+		  (unsigned long)__entry->cpu_id,
+		  __entry->util,
+		  (unsigned long long)__entry->latency_ns)
+);
+
 TRACE_EVENT(cpu_frequency_limits,
 
 	TP_PROTO(struct cpufreq_policy *policy),
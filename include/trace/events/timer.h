@@ -81,6 +81,58 @@ TRACE_EVENT(timer_start,
 		  decode_timer_flags(__entry->flags & TIMER_TRACE_FLAGMASK))
 );
 
+/* How a pending timer was re-armed, see timer_rearm */
+#define TIMER_REARM_UNCHANGED	0	/* same expiry time */
+#define TIMER_REARM_KEPT	1	/* timer_reduce() to a later time */
+#define TIMER_REARM_BUCKET	2	/* new expiry in the same bucket */
+#define TIMER_REARM_REQUEUE	3	/* dequeued and enqueued again */
+
+#define decode_timer_rearm(how)				\
+	__print_symbolic(how,				\
+		{ TIMER_REARM_UNCHANGED,	"unchanged" },	\
+		{ TIMER_REARM_KEPT,		"kept" },	\
+		{ TIMER_REARM_BUCKET,		"bucket" },	\
+		{ TIMER_REARM_REQUEUE,		"requeue" })
+
+/**
+ * timer_rearm - called when a pending timer is modified
+ * @timer:	pointer to struct timer_list
+ * @expires:	the requested expiry time
+ * @how:	TIMER_REARM_* outcome
+ *
+ * Allows to measure timer re-arm churn and how much of it is absorbed
+ * without touching the timer wheel.
+ */
+TRACE_EVENT(timer_rearm,
+
+	TP_PROTO(struct timer_list *timer,
+		unsigned long expires,
+		unsigned int how),
+
+	TP_ARGS(timer, expires, how),
+
+	TP_STRUCT__entry(
+		__field( void *,	timer		)
+		__field( void *,	function	)
+		__field( unsigned long,	expires		)
+		__field( unsigned long,	now		)
+		__field( unsigned int,	how		)
+	),
+
+	TP_fast_assign(
+		__entry->timer		= timer;
+		__entry->function	= timer->function;
+		__entry->expires	= expires;
+		__entry->now		= jiffies;
+		__entry->how		= how;
+	),
+
+	TP_printk("timer=%p function=%ps expires=%lu [timeout=%ld] %s",
+		  __entry->timer, __entry->function, __entry->expires,
+		  (long)__entry->expires - __entry->now,
+		  decode_timer_rearm(__entry->how))
+);
+
 /**
  * timer_expire_entry - called immediately before the timer callback
  * @timer:	pointer to struct timer_list
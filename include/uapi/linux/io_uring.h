@@ -22,6 +22,10 @@ struct io_uring_sqe {
 	union {
 		__u64	off;	/* offset into file */
 		__u64	addr2;
+		struct {
+			__u32	cmd_op;
+			__u32	__pad1;
+		};
 	};
 	union {
 		__u64	addr;	/* pointer to buffer or iovecs */
@@ -45,6 +49,7 @@ struct io_uring_sqe {
 		__u32		rename_flags;
 		__u32		unlink_flags;
 		__u32		hardlink_flags;
+		__u32		xattr_flags;
 	};
 	__u64	user_data;	/* data to be passed back at completion time */
 	/* pack this to avoid bogus arm OABI complaints */
@@ -60,7 +65,17 @@ struct io_uring_sqe {
 		__s32	splice_fd_in;
 		__u32	file_index;
 	};
-	__u64	__pad2[2];
+	union {
+		struct {
+			__u64	addr3;
+			__u64	__pad2[1];
+		};
+		/*
+		 * If the ring is initialized with IORING_SETUP_SQE128, then
+		 * this field is used for 80 bytes of arbitrary command data
+		 */
+		__u8	cmd[0];
+	};
 };
 
 enum {
@@ -98,6 +113,19 @@ enum {
 #define IORING_SETUP_CLAMP	(1U << 4)	/* clamp SQ/CQ ring sizes */
 #define IORING_SETUP_ATTACH_WQ	(1U << 5)	/* attach to existing wq */
 #define IORING_SETUP_R_DISABLED	(1U << 6)	/* start with ring disabled */
+#define IORING_SETUP_SQE128	(1U << 7)	/* SQEs are 128 byte */
+#define IORING_SETUP_CQE32	(1U << 8)	/* CQEs are 32 byte */
+/*
+ * Defer running task_work to get events, rather than notifying the task as
+ * soon as a completion arrives. Only the task that created the ring may
+ * submit and wait on it.
+ */
+#define IORING_SETUP_DEFER_TASKRUN	(1U << 9)
+/*
+ * With IORING_SETUP_IOPOLL, sleep for part of the expected completion time
+ * before polling, rather than spinning from the moment a request is issued.
+ */
+#define IORING_SETUP_HYBRID_IOPOLL	(1U << 10)
 
 enum {
 	IORING_OP_NOP,
@@ -140,6 +168,13 @@ enum {
 	IORING_OP_MKDIRAT,
 	IORING_OP_SYMLINKAT,
 	IORING_OP_LINKAT,
+	IORING_OP_SEND_ZC,
+	IORING_OP_URING_CMD,
+	IORING_OP_FSETXATTR,
+	IORING_OP_SETXATTR,
+	IORING_OP_FGETXATTR,
+	IORING_OP_GETXATTR,
+	IORING_OP_SOCKET,
 
 	/* this goes last, obviously */
 	IORING_OP_LAST,
@@ -181,6 +216,31 @@ enum {
 #define IORING_POLL_UPDATE_EVENTS	(1U << 1)
 #define IORING_POLL_UPDATE_USER_DATA	(1U << 2)
 
+/*
+ * accept flags stored in sqe->ioprio
+ *
+ * IORING_ACCEPT_MULTISHOT	Multishot accept. Keeps the request armed on
+ *				the listening socket and posts a CQE with
+ *				IORING_CQE_F_MORE set for every accepted
+ *				connection.
+ */
+#define IORING_ACCEPT_MULTISHOT	(1U << 0)
+
+/*
+ * send/recv flags stored in sqe->ioprio
+ *
+ * IORING_RECV_MULTISHOT	Multishot recv. Requires IOSQE_BUFFER_SELECT and
+ *				a zero sqe->len. A new buffer is picked from the
+ *				group for every chunk of data received, each
+ *				CQE has IORING_CQE_F_MORE set while the request
+ *				stays armed.
+ *
+ * IORING_RECVSEND_FIXED_BUF	Use a registered buffer, sqe->buf_index
+ *				is its index. Only IORING_OP_SEND_ZC.
+ */
+#define IORING_RECV_MULTISHOT		(1U << 1)
+#define IORING_RECVSEND_FIXED_BUF	(1U << 2)
+
 /*
  * IO completion data structure (Completion Queue Entry)
  */
@@ -188,6 +248,12 @@ struct io_uring_cqe {
 	__u64	user_data;	/* sqe->data submission passed back */
 	__s32	res;		/* result code for this event */
 	__u32	flags;
+
+	/*
+	 * If the ring is initialized with IORING_SETUP_CQE32, then this field
+	 * contains 16-bytes of padding, doubling the size of the CQE.
+	 */
+	__u64	big_cqe[];
 };
 
 /*
@@ -195,9 +261,12 @@ struct io_uring_cqe {
  *
  * IORING_CQE_F_BUFFER	If set, the upper 16 bits are the buffer ID
  * IORING_CQE_F_MORE	If set, parent SQE will generate more CQE entries
+ * IORING_CQE_F_NOTIF	Set for IORING_OP_SEND_ZC notifications, the data
+ *			buffer of the request can be reused
  */
 #define IORING_CQE_F_BUFFER		(1U << 0)
 #define IORING_CQE_F_MORE		(1U << 1)
+#define IORING_CQE_F_NOTIF		(1U << 2)
 
 enum {
 	IORING_CQE_BUFFER_SHIFT		= 16,
@@ -257,6 +326,7 @@ struct io_cqring_offsets {
 #define IORING_ENTER_SQ_WAKEUP	(1U << 1)
 #define IORING_ENTER_SQ_WAIT	(1U << 2)
 #define IORING_ENTER_EXT_ARG	(1U << 3)
+#define IORING_ENTER_REGISTERED_RING	(1U << 4)
 
 /*
  * Passed in for io_uring_setup(2). Copied back with updated info on success
@@ -320,6 +390,17 @@ enum {
 	/* set/get max number of io-wq workers */
 	IORING_REGISTER_IOWQ_MAX_WORKERS	= 19,
 
+	/* register/unregister a mapped provided buffer ring */
+	IORING_REGISTER_PBUF_RING		= 20,
+	IORING_UNREGISTER_PBUF_RING		= 21,
+
+	/* register/unregister io_uring fd with the ring */
+	IORING_REGISTER_RING_FDS		= 22,
+	IORING_UNREGISTER_RING_FDS		= 23,
+
+	/* select io-wq node placement for async work, IORING_IOWQ_PLACE_* */
+	IORING_REGISTER_IOWQ_PLACEMENT		= 24,
+
 	/* this goes last */
 	IORING_REGISTER_LAST
 };
@@ -330,6 +411,19 @@ enum {
 	IO_WQ_UNBOUND,
 };
 
+/*
+ * io-wq placement for IORING_REGISTER_IOWQ_PLACEMENT
+ *
+ * IORING_IOWQ_PLACE_ISSUER	Queue async work on the NUMA node of the CPU
+ *				that punted it (default).
+ * IORING_IOWQ_PLACE_DEVICE	Queue async work on the NUMA node of the block
+ *				device backing the file, if there is one.
+ */
+enum {
+	IORING_IOWQ_PLACE_ISSUER,
+	IORING_IOWQ_PLACE_DEVICE,
+};
+
 /* deprecated, see struct io_uring_rsrc_update */
 struct io_uring_files_update {
 	__u32 offset;
@@ -360,6 +454,38 @@ struct io_uring_rsrc_update2 {
 	__u32 resv2;
 };
 
+struct io_uring_buf {
+	__u64	addr;
+	__u32	len;
+	__u16	bid;
+	__u16	resv;
+};
+
+struct io_uring_buf_ring {
+	union {
+		/*
+		 * To avoid spilling into more pages than we need to, the
+		 * ring tail is overlaid with the io_uring_buf->resv field.
+		 */
+		struct {
+			__u64	resv1;
+			__u32	resv2;
+			__u16	resv3;
+			__u16	tail;
+		};
+		struct io_uring_buf	bufs[0];
+	};
+};
+
+/* argument for IORING_(UN)REGISTER_PBUF_RING */
+struct io_uring_buf_reg {
+	__u64	ring_addr;
+	__u32	ring_entries;
+	__u16	bgid;
+	__u16	pad;
+	__u64	resv[3];
+};
+
 /* Skip updating fd indexes set to this value in the fd table */
 #define IORING_REGISTER_FILES_SKIP	(-2)
 
@@ -292,6 +292,9 @@ enum
 	LINUX_MIB_TCPDSACKIGNOREDDUBIOUS,	/* TCPDSACKIgnoredDubious */
 	LINUX_MIB_TCPMIGRATEREQSUCCESS,		/* TCPMigrateReqSuccess */
 	LINUX_MIB_TCPMIGRATEREQFAILURE,		/* TCPMigrateReqFailure */
+	LINUX_MIB_TCPZEROCOPYRXMAPPED,		/* TCPZeroCopyRxMapped */
+	LINUX_MIB_TCPZEROCOPYRXCOPIED,		/* TCPZeroCopyRxCopied */
+	LINUX_MIB_TCPTSQTHROTTLED,		/* TCPTSQThrottled */
 	__LINUX_MIB_MAX
 };
 
@@ -344,6 +347,8 @@ enum
 	LINUX_MIB_TLSRXDEVICE,			/* TlsRxDevice */
 	LINUX_MIB_TLSDECRYPTERROR,		/* TlsDecryptError */
 	LINUX_MIB_TLSRXDEVICERESYNC,		/* TlsRxDeviceResync */
+	LINUX_MIB_TLSRXDECRYPTZC,		/* TlsRxDecryptZc */
+	LINUX_MIB_TLSRXDECRYPTCOPY,		/* TlsRxDecryptCopy */
 	__LINUX_MIB_TLSMAX
 };
 
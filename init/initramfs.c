@@ -16,6 +16,7 @@
 #include <linux/namei.h>
 #include <linux/init_syscalls.h>
 #include <linux/umh.h>
+#include <linux/ktime.h>
 
 static ssize_t __init xwrite(struct file *file, const char *p, size_t count,
 		loff_t *pos)
@@ -670,6 +671,7 @@ static void __init populate_initrd_image(char *err)
 
 static void __init do_populate_rootfs(void *unused, async_cookie_t cookie)
 {
+	ktime_t start = ktime_get();
 	/* Load the built in initramfs */
 	char *err = unpack_to_rootfs(__initramfs_start, __initramfs_size);
 	if (err)
@@ -703,6 +705,10 @@ static void __init do_populate_rootfs(void *unused, async_cookie_t cookie)
 	initrd_end = 0;
 
 	flush_delayed_fput();
+
+	if (initcall_debug)
+		pr_info("initramfs: unpacked in %lld usecs\n",
+			ktime_us_delta(ktime_get(), start));
 }
 
 static ASYNC_DOMAIN_EXCLUSIVE(initramfs_domain);
@@ -710,6 +716,8 @@ static async_cookie_t initramfs_cookie;
 
 void wait_for_initramfs(void)
 {
+	ktime_t start;
+
 	if (!initramfs_cookie) {
 		/*
 		 * Something before rootfs_initcall wants to access
@@ -720,7 +728,16 @@ void wait_for_initramfs(void)
 		pr_warn_once("wait_for_initramfs() called before rootfs_initcalls\n");
 		return;
 	}
+	start = ktime_get();
 	async_synchronize_cookie_domain(initramfs_cookie + 1, &initramfs_domain);
+	/* Unpack time minus the waits is what async unpacking saved */
+	if (initcall_debug) {
+		s64 waited = ktime_us_delta(ktime_get(), start);
+
+		if (waited)
+			pr_info("initramfs: %pS waited %lld usecs for unpacking\n",
+				__builtin_return_address(0), waited);
+	}
 }
 EXPORT_SYMBOL_GPL(wait_for_initramfs);
 
@@ -102,6 +102,13 @@ struct io_wqe {
 	struct io_wq_work *hash_tail[IO_WQ_NR_HASH_BUCKETS];
 
 	cpumask_var_t cpu_mask;
+
+	/* stats, worker counts under ->lock, hash ones under hash->wait.lock */
+	unsigned long nr_created;
+	unsigned long nr_exited;
+	unsigned long nr_hash_stalls;
+	u64 hash_stall_ns;
+	u64 hash_stall_start;
 };
 
 /*
@@ -223,6 +230,7 @@ static void io_worker_exit(struct io_worker *worker)
 	if (worker->flags & IO_WORKER_F_FREE)
 		hlist_nulls_del_rcu(&worker->nulls_node);
 	list_del_rcu(&worker->all_list);
+	wqe->nr_exited++;
 	preempt_disable();
 	io_wqe_dec_running(worker);
 	worker->flags = 0;
@@ -448,6 +456,9 @@ static bool io_wait_on_hash(struct io_wqe *wqe, unsigned int hash)
 			__set_current_state(TASK_RUNNING);
 			list_del_init(&wqe->wait.entry);
 			ret = true;
+		} else {
+			wqe->nr_hash_stalls++;
+			wqe->hash_stall_start = ktime_get_ns();
 		}
 	}
 	spin_unlock_irq(&wq->hash->wait.lock);
@@ -713,6 +724,7 @@ static void io_init_new_worker(struct io_wqe *wqe, struct io_worker *worker,
 	hlist_nulls_add_head_rcu(&worker->nulls_node, &wqe->free_list);
 	list_add_tail_rcu(&worker->all_list, &wqe->all_list);
 	worker->flags |= IO_WORKER_F_FREE;
+	wqe->nr_created++;
 	raw_spin_unlock(&wqe->lock);
 	wake_up_new_task(tsk);
 }
@@ -951,10 +963,20 @@ static void io_wqe_enqueue(struct io_wqe *wqe, struct io_wq_work *work)
 	}
 }
 
-void io_wq_enqueue(struct io_wq *wq, struct io_wq_work *work)
+/*
+ * Queue @work on the pool of @node. NUMA_NO_NODE, or a node that currently
+ * can't run any of our workers, means the node of the issuing CPU.
+ */
+void io_wq_enqueue(struct io_wq *wq, struct io_wq_work *work, int node)
 {
-	struct io_wqe *wqe = wq->wqes[numa_node_id()];
+	struct io_wqe *wqe;
+
+	if (node == NUMA_NO_NODE || (unsigned int)node >= nr_node_ids ||
+	    !node_online(node) ||
+	    !cpumask_intersects(wq->wqes[node]->cpu_mask, cpu_online_mask))
+		node = numa_node_id();
 
+	wqe = wq->wqes[node];
 	io_wqe_enqueue(wqe, work);
 }
 
@@ -1108,6 +1130,7 @@ static int io_wqe_hash_wake(struct wait_queue_entry *wait, unsigned mode,
 	int i;
 
 	list_del_init(&wait->entry);
+	wqe->hash_stall_ns += ktime_get_ns() - wqe->hash_stall_start;
 
 	rcu_read_lock();
 	for (i = 0; i < IO_WQ_ACCT_NR; i++) {
@@ -1390,6 +1413,26 @@ int io_wq_max_workers(struct io_wq *wq, int *new_count)
 	return 0;
 }
 
+void io_wq_node_stats(struct io_wq *wq, int node, struct io_wq_node_stats *st)
+{
+	struct io_wqe *wqe = wq->wqes[node];
+	int i;
+
+	raw_spin_lock(&wqe->lock);
+	for (i = 0; i < IO_WQ_ACCT_NR; i++) {
+		st->nr_workers[i] = wqe->acct[i].nr_workers;
+		st->max_workers[i] = wqe->acct[i].max_workers;
+	}
+	st->workers_created = wqe->nr_created;
+	st->workers_exited = wqe->nr_exited;
+	raw_spin_unlock(&wqe->lock);
+
+	spin_lock_irq(&wq->hash->wait.lock);
+	st->hash_stalls = wqe->nr_hash_stalls;
+	st->hash_stall_ns = wqe->hash_stall_ns;
+	spin_unlock_irq(&wq->hash->wait.lock);
+}
+
 static __init int io_wq_init(void)
 {
 	int ret;
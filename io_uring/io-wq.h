@@ -124,12 +124,25 @@ struct io_wq *io_wq_create(unsigned bounded, struct io_wq_data *data);
 void io_wq_exit_start(struct io_wq *wq);
 void io_wq_put_and_exit(struct io_wq *wq);
 
-void io_wq_enqueue(struct io_wq *wq, struct io_wq_work *work);
+void io_wq_enqueue(struct io_wq *wq, struct io_wq_work *work, int node);
 void io_wq_hash_work(struct io_wq_work *work, void *val);
 
 int io_wq_cpu_affinity(struct io_wq *wq, cpumask_var_t mask);
 int io_wq_max_workers(struct io_wq *wq, int *new_count);
 
+struct io_wq_node_stats {
+	unsigned int	nr_workers[2];
+	unsigned int	max_workers[2];
+	/* worker threads created/exited over the lifetime of the pool */
+	unsigned long	workers_created;
+	unsigned long	workers_exited;
+	/* times the pool stalled on a busy hash, and total time stalled */
+	unsigned long	hash_stalls;
+	u64		hash_stall_ns;
+};
+
+void io_wq_node_stats(struct io_wq *wq, int node, struct io_wq_node_stats *st);
+
 static inline bool io_wq_is_hashed(struct io_wq_work *work)
 {
 	return work->flags & IO_WQ_WORK_HASHED;
@@ -71,6 +71,7 @@
 #include <linux/hugetlb.h>
 #include <linux/highmem.h>
 #include <linux/namei.h>
+#include <linux/mount.h>
 #include <linux/fsnotify.h>
 #include <linux/fadvise.h>
 #include <linux/eventpoll.h>
@@ -90,6 +91,7 @@
 
 #define IORING_MAX_ENTRIES	32768
 #define IORING_MAX_CQ_ENTRIES	(2 * IORING_MAX_ENTRIES)
+#define IO_RINGFD_REG_MAX	16
 #define IORING_SQPOLL_CAP_ENTRIES_VALUE 8
 
 /* only define max */
@@ -194,9 +196,10 @@ struct io_rings {
 	struct io_uring_cqe	cqes[] ____cacheline_aligned_in_smp;
 };
 
-enum io_uring_cmd_flags {
-	IO_URING_F_NONBLOCK		= 1,
-	IO_URING_F_COMPLETE_DEFER	= 2,
+enum {
+	IOU_OK			= 0,
+	/* multishot request is done, final CQE is stored in the request */
+	IOU_STOP_MULTISHOT	= 1,
 };
 
 struct io_mapped_ubuf {
@@ -210,8 +213,9 @@ struct io_mapped_ubuf {
 struct io_ring_ctx;
 
 struct io_overflow_cqe {
-	struct io_uring_cqe cqe;
 	struct list_head list;
+	/* must be last, followed by big_cqe[] space for IORING_SETUP_CQE32 */
+	struct io_uring_cqe cqe;
 };
 
 struct io_fixed_file {
@@ -262,6 +266,21 @@ struct io_buffer {
 	__u16 bid;
 };
 
+/*
+ * Provided buffer group mapped from userspace. The application fills
+ * entries and bumps the tail, the kernel consumes from head without any
+ * allocation or list handling. Both are only touched under uring_lock.
+ */
+struct io_buffer_ring {
+	struct io_uring_buf_ring	*buf_ring;
+	struct page			**buf_pages;
+	int				buf_nr_pages;
+	__u16				head;
+	__u16				mask;
+};
+
+#define IO_BUF_RING_PER_PAGE	(PAGE_SIZE / sizeof(struct io_uring_buf))
+
 struct io_restriction {
 	DECLARE_BITMAP(register_op, IORING_REGISTER_LAST);
 	DECLARE_BITMAP(sqe_op, IORING_OP_LAST);
@@ -378,6 +397,7 @@ struct io_ring_ctx {
 		struct list_head	ltimeout_list;
 		struct list_head	cq_overflow_list;
 		struct xarray		io_buffers;
+		struct xarray		io_buf_rings;
 		struct xarray		personalities;
 		u32			pers_next;
 		unsigned		sq_thread_idle;
@@ -389,6 +409,8 @@ struct io_ring_ctx {
 
 	const struct cred	*sq_creds;	/* cred used for __io_sq_thread() */
 	struct io_sq_data	*sq_data;	/* if using sq thread polling */
+	/* the only task allowed to submit and reap, IORING_SETUP_DEFER_TASKRUN */
+	struct task_struct	*submitter_task;
 
 	struct wait_queue_head	sqo_sq_wait;
 	struct list_head	sqd_list;
@@ -411,6 +433,9 @@ struct io_ring_ctx {
 
 		spinlock_t		timeout_lock;
 
+		/* deferred task_work, run by the submitter when it waits */
+		struct llist_head	work_llist;
+
 		/*
 		 * ->iopoll_list is protected by the ctx->uring_lock for
 		 * io_uring instances that don't use IORING_SETUP_SQPOLL.
@@ -421,6 +446,8 @@ struct io_ring_ctx {
 		struct hlist_head	*cancel_hash;
 		unsigned		cancel_hash_bits;
 		bool			poll_multi_queue;
+		/* running average of polled IO latency, nsecs */
+		u64			hybrid_poll_time;
 	} ____cacheline_aligned_in_smp;
 
 	struct io_restriction		restrictions;
@@ -458,6 +485,8 @@ struct io_ring_ctx {
 		struct completion		ref_comp;
 		u32				iowq_limits[2];
 		bool				iowq_limits_set;
+		/* IORING_IOWQ_PLACE_*, which io-wq node async work goes to */
+		u8				iowq_placement;
 	};
 };
 
@@ -476,6 +505,9 @@ struct io_uring_task {
 	struct io_wq_work_list	task_list;
 	struct callback_head	task_work;
 	bool			task_running;
+
+	/* ring fds registered by this task, see IORING_REGISTER_RING_FDS */
+	struct file		*registered_rings[IO_RINGFD_REG_MAX];
 };
 
 /*
@@ -580,10 +612,36 @@ struct io_sr_msg {
 	int				bgid;
 	size_t				len;
 	size_t				done_io;
-	struct io_buffer		*kbuf;
+	union {
+		struct io_buffer	*kbuf;
+		/* valid IFF REQ_F_BUFFER_RING is set */
+		void __user		*ring_buf;
+	};
 	void __user			*msg_control;
 };
 
+struct io_sendzc {
+	struct file			*file;
+	void __user			*buf;
+	size_t				len;
+	size_t				done_io;
+	unsigned			msg_flags;
+	unsigned			flags;
+	struct io_notif			*notif;
+};
+
+/*
+ * Zerocopy send notification. The network stack holds a reference for
+ * every skb that still points into the user buffer, a CQE with
+ * IORING_CQE_F_NOTIF is posted once the last one goes away.
+ */
+struct io_notif {
+	struct ubuf_info		uarg;
+	struct io_ring_ctx		*ctx;
+	u64				user_data;
+	struct work_struct		work;
+};
+
 struct io_open {
 	struct file			*file;
 	int				dfd;
@@ -693,6 +751,22 @@ struct io_hardlink {
 	int				flags;
 };
 
+struct io_xattr {
+	struct file			*file;
+	struct xattr_ctx		ctx;
+	struct filename			*filename;
+};
+
+struct io_socket {
+	struct file			*file;
+	int				domain;
+	int				type;
+	int				protocol;
+	int				flags;
+	u32				file_slot;
+	unsigned long			nofile;
+};
+
 struct io_completion {
 	struct file			*file;
 	u32				cflags;
@@ -743,6 +817,9 @@ enum {
 	REQ_F_REFCOUNT_BIT,
 	REQ_F_ARM_LTIMEOUT_BIT,
 	REQ_F_PARTIAL_IO_BIT,
+	REQ_F_APOLL_MULTISHOT_BIT,
+	REQ_F_BUFFER_RING_BIT,
+	REQ_F_IOPOLL_STATE_BIT,
 	/* keep async read/write and isreg together and in order */
 	REQ_F_NOWAIT_READ_BIT,
 	REQ_F_NOWAIT_WRITE_BIT,
@@ -800,6 +877,12 @@ enum {
 	REQ_F_ARM_LTIMEOUT	= BIT(REQ_F_ARM_LTIMEOUT_BIT),
 	/* request has already done partial IO */
 	REQ_F_PARTIAL_IO	= BIT(REQ_F_PARTIAL_IO_BIT),
+	/* fast poll multishot mode */
+	REQ_F_APOLL_MULTISHOT	= BIT(REQ_F_APOLL_MULTISHOT_BIT),
+	/* selected buffer comes from a mapped ring, bid is in ->buf_index */
+	REQ_F_BUFFER_RING	= BIT(REQ_F_BUFFER_RING_BIT),
+	/* hybrid iopoll has already slept for this request */
+	REQ_F_IOPOLL_STATE	= BIT(REQ_F_IOPOLL_STATE_BIT),
 };
 
 struct async_poll {
@@ -841,6 +924,7 @@ struct io_kiocb {
 		struct io_timeout_rem	timeout_rem;
 		struct io_connect	connect;
 		struct io_sr_msg	sr_msg;
+		struct io_sendzc	sendzc;
 		struct io_open		open;
 		struct io_close		close;
 		struct io_rsrc_update	rsrc_update;
@@ -856,6 +940,9 @@ struct io_kiocb {
 		struct io_mkdir		mkdir;
 		struct io_symlink	symlink;
 		struct io_hardlink	hardlink;
+		struct io_uring_cmd	uring_cmd;
+		struct io_xattr		xattr;
+		struct io_socket	sock;
 		/* use only after cleaning per-op data, see io_clean_op() */
 		struct io_completion	compl;
 	};
@@ -880,6 +967,8 @@ struct io_kiocb {
 
 	/* used with ctx->iopoll_list with reads/writes */
 	struct list_head		inflight_entry;
+	/* issue time, for IORING_SETUP_HYBRID_IOPOLL */
+	u64				iopoll_start;
 	struct io_task_work		io_task_work;
 	/* for polled requests, i.e. IORING_OP_POLL_ADD and async armed poll */
 	struct hlist_node		hash_node;
@@ -1074,6 +1163,27 @@ static const struct io_op_def io_op_defs[] = {
 	[IORING_OP_MKDIRAT] = {},
 	[IORING_OP_SYMLINKAT] = {},
 	[IORING_OP_LINKAT] = {},
+	[IORING_OP_SEND_ZC] = {
+		.needs_file		= 1,
+		.unbound_nonreg_file	= 1,
+		.pollout		= 1,
+	},
+	[IORING_OP_URING_CMD] = {
+		.needs_file		= 1,
+		.plug			= 1,
+		.needs_async_setup	= 1,
+		.async_size		= 2 * sizeof(struct io_uring_sqe) -
+					  offsetof(struct io_uring_sqe, cmd),
+	},
+	[IORING_OP_FSETXATTR] = {
+		.needs_file		= 1
+	},
+	[IORING_OP_SETXATTR] = {},
+	[IORING_OP_FGETXATTR] = {
+		.needs_file		= 1
+	},
+	[IORING_OP_GETXATTR] = {},
+	[IORING_OP_SOCKET] = {},
 };
 
 /* requests with any of those set should undergo io_disarm_next() */
@@ -1100,6 +1210,7 @@ static struct file *io_file_get(struct io_ring_ctx *ctx,
 				struct io_kiocb *req, int fd, bool fixed,
 				unsigned int issue_flags);
 static void __io_queue_sqe(struct io_kiocb *req);
+static int io_issue_sqe(struct io_kiocb *req, unsigned int issue_flags);
 static void io_rsrc_put_work(struct work_struct *work);
 
 static void io_req_task_queue(struct io_kiocb *req);
@@ -1345,6 +1456,7 @@ static struct io_ring_ctx *io_ring_ctx_alloc(struct io_uring_params *p)
 	INIT_LIST_HEAD(&ctx->cq_overflow_list);
 	init_completion(&ctx->ref_comp);
 	xa_init_flags(&ctx->io_buffers, XA_FLAGS_ALLOC1);
+	xa_init(&ctx->io_buf_rings);
 	xa_init_flags(&ctx->personalities, XA_FLAGS_ALLOC1);
 	mutex_init(&ctx->uring_lock);
 	init_waitqueue_head(&ctx->cq_wait);
@@ -1362,6 +1474,7 @@ static struct io_ring_ctx *io_ring_ctx_alloc(struct io_uring_params *p)
 	INIT_LIST_HEAD(&ctx->submit_state.free_list);
 	INIT_LIST_HEAD(&ctx->locked_free_list);
 	INIT_DELAYED_WORK(&ctx->fallback_work, io_fallback_req_func);
+	init_llist_head(&ctx->work_llist);
 	return ctx;
 err:
 	kfree(ctx->dummy_ubuf);
@@ -1473,11 +1586,30 @@ static void io_prep_async_link(struct io_kiocb *req)
 	}
 }
 
+/* NUMA node of the block device backing @file, if there is one */
+static int io_file_numa_node(struct file *file)
+{
+#ifdef CONFIG_BLOCK
+	struct inode *inode = file_inode(file);
+	struct block_device *bdev = NULL;
+
+	if (S_ISBLK(inode->i_mode))
+		bdev = I_BDEV(file->f_mapping->host);
+	else if (S_ISREG(inode->i_mode))
+		bdev = inode->i_sb->s_bdev;
+
+	if (bdev && bdev->bd_disk)
+		return bdev->bd_disk->node_id;
+#endif
+	return NUMA_NO_NODE;
+}
+
 static void io_queue_async_work(struct io_kiocb *req, bool *locked)
 {
 	struct io_ring_ctx *ctx = req->ctx;
 	struct io_kiocb *link = io_prep_linked_timeout(req);
 	struct io_uring_task *tctx = req->task->io_uring;
+	int node = NUMA_NO_NODE;
 
 	/* must not take the lock, NULL it as a precaution */
 	locked = NULL;
@@ -1500,7 +1632,10 @@ static void io_queue_async_work(struct io_kiocb *req, bool *locked)
 
 	trace_io_uring_queue_async_work(ctx, io_wq_is_hashed(&req->work), req,
 					&req->work, req->flags);
-	io_wq_enqueue(tctx->io_wq, &req->work);
+	if (READ_ONCE(ctx->iowq_placement) == IORING_IOWQ_PLACE_DEVICE &&
+	    req->file)
+		node = io_file_numa_node(req->file);
+	io_wq_enqueue(tctx->io_wq, &req->work, node);
 	if (link)
 		io_queue_linked_timeout(link);
 }
@@ -1621,6 +1756,8 @@ static inline struct io_uring_cqe *io_get_cqe(struct io_ring_ctx *ctx)
 		return NULL;
 
 	tail = ctx->cached_cq_tail++;
+	if (ctx->flags & IORING_SETUP_CQE32)
+		return &rings->cqes[(tail & mask) << 1];
 	return &rings->cqes[tail & mask];
 }
 
@@ -1680,10 +1817,14 @@ static void io_cqring_ev_posted_iopoll(struct io_ring_ctx *ctx)
 static bool __io_cqring_overflow_flush(struct io_ring_ctx *ctx, bool force)
 {
 	bool all_flushed, posted;
+	size_t cqe_size = sizeof(struct io_uring_cqe);
 
 	if (!force && __io_cqring_events(ctx) == ctx->cq_entries)
 		return false;
 
+	if (ctx->flags & IORING_SETUP_CQE32)
+		cqe_size <<= 1;
+
 	posted = false;
 	spin_lock(&ctx->completion_lock);
 	while (!list_empty(&ctx->cq_overflow_list)) {
@@ -1695,7 +1836,7 @@ static bool __io_cqring_overflow_flush(struct io_ring_ctx *ctx, bool force)
 		ocqe = list_first_entry(&ctx->cq_overflow_list,
 					struct io_overflow_cqe, list);
 		if (cqe)
-			memcpy(cqe, &ocqe->cqe, sizeof(*cqe));
+			memcpy(cqe, &ocqe->cqe, cqe_size);
 		else
 			io_account_cq_overflow(ctx);
 
@@ -1781,11 +1922,17 @@ static __cold void io_uring_drop_tctx_refs(struct task_struct *task)
 }
 
 static bool io_cqring_event_overflow(struct io_ring_ctx *ctx, u64 user_data,
-				     s32 res, u32 cflags)
+				     s32 res, u32 cflags, u64 extra1,
+				     u64 extra2)
 {
 	struct io_overflow_cqe *ocqe;
+	size_t ocq_size = sizeof(struct io_overflow_cqe);
+	bool is_cqe32 = (ctx->flags & IORING_SETUP_CQE32);
+
+	if (is_cqe32)
+		ocq_size += sizeof(struct io_uring_cqe);
 
-	ocqe = kmalloc(sizeof(*ocqe), GFP_ATOMIC | __GFP_ACCOUNT);
+	ocqe = kmalloc(ocq_size, GFP_ATOMIC | __GFP_ACCOUNT);
 	if (!ocqe) {
 		/*
 		 * If we're in ring overflow flush mode, or in task cancel mode,
@@ -1804,12 +1951,16 @@ static bool io_cqring_event_overflow(struct io_ring_ctx *ctx, u64 user_data,
 	ocqe->cqe.user_data = user_data;
 	ocqe->cqe.res = res;
 	ocqe->cqe.flags = cflags;
+	if (is_cqe32) {
+		ocqe->cqe.big_cqe[0] = extra1;
+		ocqe->cqe.big_cqe[1] = extra2;
+	}
 	list_add_tail(&ocqe->list, &ctx->cq_overflow_list);
 	return true;
 }
 
-static inline bool __io_fill_cqe(struct io_ring_ctx *ctx, u64 user_data,
-				 s32 res, u32 cflags)
+static inline bool __io_fill_cqe32(struct io_ring_ctx *ctx, u64 user_data,
+				   s32 res, u32 cflags, u64 extra1, u64 extra2)
 {
 	struct io_uring_cqe *cqe;
 
@@ -1825,9 +1976,20 @@ static inline bool __io_fill_cqe(struct io_ring_ctx *ctx, u64 user_data,
 		WRITE_ONCE(cqe->user_data, user_data);
 		WRITE_ONCE(cqe->res, res);
 		WRITE_ONCE(cqe->flags, cflags);
+		if (ctx->flags & IORING_SETUP_CQE32) {
+			WRITE_ONCE(cqe->big_cqe[0], extra1);
+			WRITE_ONCE(cqe->big_cqe[1], extra2);
+		}
 		return true;
 	}
-	return io_cqring_event_overflow(ctx, user_data, res, cflags);
+	return io_cqring_event_overflow(ctx, user_data, res, cflags, extra1,
+					extra2);
+}
+
+static inline bool __io_fill_cqe(struct io_ring_ctx *ctx, u64 user_data,
+				 s32 res, u32 cflags)
+{
+	return __io_fill_cqe32(ctx, user_data, res, cflags, 0, 0);
 }
 
 static noinline void io_fill_cqe_req(struct io_kiocb *req, s32 res, u32 cflags)
@@ -1842,13 +2004,13 @@ static noinline bool io_fill_cqe_aux(struct io_ring_ctx *ctx, u64 user_data,
 	return __io_fill_cqe(ctx, user_data, res, cflags);
 }
 
-static void io_req_complete_post(struct io_kiocb *req, s32 res,
-				 u32 cflags)
+static void io_req_complete_post32(struct io_kiocb *req, s32 res,
+				   u32 cflags, u64 extra1, u64 extra2)
 {
 	struct io_ring_ctx *ctx = req->ctx;
 
 	spin_lock(&ctx->completion_lock);
-	__io_fill_cqe(ctx, req->user_data, res, cflags);
+	__io_fill_cqe32(ctx, req->user_data, res, cflags, extra1, extra2);
 	/*
 	 * If we're the last reference to this request, add to our locked
 	 * free_list cache.
@@ -1879,6 +2041,12 @@ static void io_req_complete_post(struct io_kiocb *req, s32 res,
 	}
 }
 
+static void io_req_complete_post(struct io_kiocb *req, s32 res,
+				 u32 cflags)
+{
+	io_req_complete_post32(req, res, cflags, 0, 0);
+}
+
 static inline bool io_req_needs_clean(struct io_kiocb *req)
 {
 	return req->flags & IO_REQ_CLEAN_FLAGS;
@@ -2232,6 +2400,93 @@ static void tctx_task_work(struct callback_head *cb)
 		io_uring_drop_tctx_refs(current);
 }
 
+static void io_fallback_tw_add(struct io_kiocb *req)
+{
+	if (llist_add(&req->io_task_work.fallback_node,
+		      &req->ctx->fallback_llist))
+		schedule_delayed_work(&req->ctx->fallback_work, 1);
+}
+
+/*
+ * IORING_SETUP_DEFER_TASKRUN: queue task_work on the ring instead of the
+ * task, it's run in batches by the submitter once it waits for completions.
+ * No notification is sent other than waking up the waiters.
+ */
+static void io_req_local_work_add(struct io_kiocb *req)
+{
+	struct io_ring_ctx *ctx = req->ctx;
+
+	if (unlikely(ctx->submitter_task->flags & PF_EXITING)) {
+		io_fallback_tw_add(req);
+		return;
+	}
+	if (!llist_add(&req->io_task_work.fallback_node, &ctx->work_llist))
+		return;
+
+	if (wq_has_sleeper(&ctx->cq_wait))
+		__wake_up(&ctx->cq_wait, TASK_NORMAL, 0,
+				poll_to_key(EPOLL_URING_WAKE | EPOLLIN));
+	if (waitqueue_active(&ctx->poll_wait))
+		__wake_up(&ctx->poll_wait, TASK_INTERRUPTIBLE, 0,
+				poll_to_key(EPOLL_URING_WAKE | EPOLLIN));
+}
+
+static int __io_run_local_work(struct io_ring_ctx *ctx, bool *locked)
+{
+	struct llist_node *node;
+	int ret = 0;
+
+	if (WARN_ON_ONCE(ctx->submitter_task != current))
+		return -EEXIST;
+
+	while ((node = llist_del_all(&ctx->work_llist)) != NULL) {
+		/* llist is LIFO, run the entries in the order they came in */
+		node = llist_reverse_order(node);
+		while (node) {
+			struct llist_node *next = node->next;
+			struct io_kiocb *req = container_of(node, struct io_kiocb,
+						io_task_work.fallback_node);
+
+			req->io_task_work.func(req, locked);
+			ret++;
+			node = next;
+		}
+	}
+
+	if (*locked && ctx->submit_state.compl_nr)
+		io_submit_flush_completions(ctx);
+	return ret;
+}
+
+static int io_run_local_work(struct io_ring_ctx *ctx)
+{
+	bool locked;
+	int ret;
+
+	if (llist_empty(&ctx->work_llist))
+		return 0;
+
+	/* if not contended, grab and improve batching */
+	locked = mutex_trylock(&ctx->uring_lock);
+	ret = __io_run_local_work(ctx, &locked);
+	if (locked)
+		mutex_unlock(&ctx->uring_lock);
+	return ret;
+}
+
+/* hand deferred task_work to the fallback worker, the submitter is gone */
+static bool io_move_task_work_from_local(struct io_ring_ctx *ctx)
+{
+	struct llist_node *node = llist_del_all(&ctx->work_llist);
+	struct io_kiocb *req, *tmp;
+
+	if (!node)
+		return false;
+	llist_for_each_entry_safe(req, tmp, node, io_task_work.fallback_node)
+		io_fallback_tw_add(req);
+	return true;
+}
+
 static void io_req_task_work_add(struct io_kiocb *req)
 {
 	struct task_struct *tsk = req->task;
@@ -2241,6 +2496,11 @@ static void io_req_task_work_add(struct io_kiocb *req)
 	unsigned long flags;
 	bool running;
 
+	if (req->ctx->flags & IORING_SETUP_DEFER_TASKRUN) {
+		io_req_local_work_add(req);
+		return;
+	}
+
 	WARN_ON_ONCE(!tctx);
 
 	spin_lock_irqsave(&tctx->task_lock, flags);
@@ -2275,9 +2535,7 @@ static void io_req_task_work_add(struct io_kiocb *req)
 	while (node) {
 		req = container_of(node, struct io_kiocb, io_task_work.node);
 		node = node->next;
-		if (llist_add(&req->io_task_work.fallback_node,
-			      &req->ctx->fallback_llist))
-			schedule_delayed_work(&req->ctx->fallback_work, 1);
+		io_fallback_tw_add(req);
 	}
 }
 
@@ -2461,13 +2719,85 @@ static unsigned int io_put_kbuf(struct io_kiocb *req, struct io_buffer *kbuf)
 {
 	unsigned int cflags;
 
-	cflags = kbuf->bid << IORING_CQE_BUFFER_SHIFT;
+	if (req->flags & REQ_F_BUFFER_RING) {
+		/* ring entries are consumed at selection, nothing to free */
+		cflags = req->buf_index << IORING_CQE_BUFFER_SHIFT;
+		req->flags &= ~REQ_F_BUFFER_RING;
+	} else {
+		cflags = kbuf->bid << IORING_CQE_BUFFER_SHIFT;
+		kfree(kbuf);
+	}
 	cflags |= IORING_CQE_F_BUFFER;
 	req->flags &= ~REQ_F_BUFFER_SELECTED;
-	kfree(kbuf);
 	return cflags;
 }
 
+static struct io_uring_buf *io_ring_buf_entry(struct io_buffer_ring *br,
+					      __u16 head)
+{
+	struct io_uring_buf *buf;
+
+	head &= br->mask;
+	if (head < IO_BUF_RING_PER_PAGE)
+		return &br->buf_ring->bufs[head];
+	buf = page_address(br->buf_pages[head / IO_BUF_RING_PER_PAGE]);
+	return buf + (head & (IO_BUF_RING_PER_PAGE - 1));
+}
+
+/*
+ * Give back a selected buffer that wasn't consumed, so that the next
+ * request picking from the group gets it first. A ring buffer can only be
+ * handed back while it is still the last entry consumed from the ring;
+ * if another request has selected since, the request keeps it instead.
+ */
+static void io_kbuf_recycle(struct io_kiocb *req, struct io_buffer *kbuf,
+			    int bgid)
+{
+	struct io_ring_ctx *ctx = req->ctx;
+	struct io_buffer *head;
+
+	lockdep_assert_held(&ctx->uring_lock);
+
+	if (req->flags & REQ_F_BUFFER_RING) {
+		struct io_buffer_ring *br = xa_load(&ctx->io_buf_rings, bgid);
+
+		/* the bid is ours until completion, nobody else can hold it */
+		if (br && READ_ONCE(io_ring_buf_entry(br, br->head - 1)->bid) ==
+			  req->buf_index) {
+			br->head--;
+			req->flags &= ~(REQ_F_BUFFER_SELECTED |
+					REQ_F_BUFFER_RING);
+		}
+		return;
+	}
+	req->flags &= ~REQ_F_BUFFER_SELECTED;
+	head = xa_load(&ctx->io_buffers, bgid);
+	if (head) {
+		list_add_tail(&kbuf->list, &head->list);
+		return;
+	}
+	INIT_LIST_HEAD(&kbuf->list);
+	if (xa_insert(&ctx->io_buffers, bgid, kbuf, GFP_KERNEL_ACCOUNT))
+		kfree(kbuf);
+}
+
+/*
+ * Terminate a multishot request with a final CQE. Before the request is
+ * armed it's completed directly, afterwards the poll task_work has to
+ * tear down the poll entries first, see io_apoll_task_func().
+ */
+static int io_multishot_stop(struct io_kiocb *req, unsigned int issue_flags,
+			     s32 res, u32 cflags)
+{
+	if (!(issue_flags & IO_URING_F_MULTISHOT)) {
+		__io_req_complete(req, issue_flags, res, cflags);
+		return IOU_OK;
+	}
+	req->result = res;
+	req->compl.cflags = cflags;
+	return IOU_STOP_MULTISHOT;
+}
+
 static inline unsigned int io_put_rw_kbuf(struct io_kiocb *req)
 {
 	struct io_buffer *kbuf;
@@ -2525,10 +2855,14 @@ static void io_iopoll_complete(struct io_ring_ctx *ctx, unsigned int *nr_events,
 			WRITE_ONCE(cqe->user_data, req->user_data);
 			WRITE_ONCE(cqe->res, req->result);
 			WRITE_ONCE(cqe->flags, cflags);
+			if (ctx->flags & IORING_SETUP_CQE32) {
+				WRITE_ONCE(cqe->big_cqe[0], 0);
+				WRITE_ONCE(cqe->big_cqe[1], 0);
+			}
 		} else {
 			spin_lock(&ctx->completion_lock);
 			io_cqring_event_overflow(ctx, req->user_data,
-							req->result, cflags);
+						 req->result, cflags, 0, 0);
 			spin_unlock(&ctx->completion_lock);
 		}
 
@@ -2546,6 +2880,60 @@ static void io_iopoll_complete(struct io_ring_ctx *ctx, unsigned int *nr_events,
 	io_req_free_batch_finish(ctx, &rb);
 }
 
+/*
+ * IORING_SETUP_HYBRID_IOPOLL: before spinning on a request, sleep until about
+ * half of the ring's average completion latency has passed since it was
+ * issued. Polled queues don't raise interrupts, so nothing can complete while
+ * we sleep and oversleeping directly costs latency, hence only half.
+ */
+static void io_iopoll_hybrid_sleep(struct io_ring_ctx *ctx,
+				   struct io_kiocb *req)
+{
+	struct hrtimer_sleeper timer;
+	u64 elapsed, sleep_ns;
+
+	if (req->flags & REQ_F_IOPOLL_STATE)
+		return;
+	req->flags |= REQ_F_IOPOLL_STATE;
+
+	/* no samples yet, spin to get the first one */
+	if (!ctx->hybrid_poll_time)
+		return;
+	sleep_ns = ctx->hybrid_poll_time / 2;
+	elapsed = ktime_get_ns() - req->iopoll_start;
+	if (elapsed >= sleep_ns)
+		return;
+	sleep_ns -= elapsed;
+
+	hrtimer_init_sleeper_on_stack(&timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	hrtimer_set_expires(&timer.timer, ns_to_ktime(sleep_ns));
+	set_current_state(TASK_INTERRUPTIBLE);
+	hrtimer_sleeper_start_expires(&timer, HRTIMER_MODE_REL);
+	if (timer.task)
+		io_schedule();
+	hrtimer_cancel(&timer.timer);
+	__set_current_state(TASK_RUNNING);
+	destroy_hrtimer_on_stack(&timer.timer);
+}
+
+/*
+ * Fold the latency of a request we spun on into the average. Only requests
+ * that completed while we were actively spinning are sampled, anything else
+ * may have sat completed for a while and would skew the estimate upwards.
+ * There is a single average per ring, not one per request size or direction,
+ * so mixed workloads sleep for half of their overall mean latency.
+ */
+static void io_iopoll_hybrid_sample(struct io_ring_ctx *ctx,
+				    struct io_kiocb *req)
+{
+	u64 lat = ktime_get_ns() - req->iopoll_start;
+
+	if (!ctx->hybrid_poll_time)
+		ctx->hybrid_poll_time = lat;
+	else
+		ctx->hybrid_poll_time = (ctx->hybrid_poll_time * 7 + lat) >> 3;
+}
+
 static int io_do_iopoll(struct io_ring_ctx *ctx, unsigned int *nr_events,
 			long min)
 {
@@ -2561,6 +2949,7 @@ static int io_do_iopoll(struct io_ring_ctx *ctx, unsigned int *nr_events,
 
 	list_for_each_entry_safe(req, tmp, &ctx->iopoll_list, inflight_entry) {
 		struct kiocb *kiocb = &req->rw.kiocb;
+		bool hybrid;
 		int ret;
 
 		/*
@@ -2575,6 +2964,14 @@ static int io_do_iopoll(struct io_ring_ctx *ctx, unsigned int *nr_events,
 		if (!list_empty(&done))
 			break;
 
+		/*
+		 * Only a single device can be sampled meaningfully, which is
+		 * also the only case where we spin.
+		 */
+		hybrid = spin && (ctx->flags & IORING_SETUP_HYBRID_IOPOLL);
+		if (hybrid)
+			io_iopoll_hybrid_sleep(ctx, req);
+
 		ret = kiocb->ki_filp->f_op->iopoll(kiocb, spin);
 		if (unlikely(ret < 0))
 			return ret;
@@ -2582,8 +2979,11 @@ static int io_do_iopoll(struct io_ring_ctx *ctx, unsigned int *nr_events,
 			spin = false;
 
 		/* iopoll may have completed current req */
-		if (READ_ONCE(req->iopoll_completed))
+		if (READ_ONCE(req->iopoll_completed)) {
+			if (hybrid)
+				io_iopoll_hybrid_sample(ctx, req);
 			list_move_tail(&req->inflight_entry, &done);
+		}
 	}
 
 	if (!list_empty(&done))
@@ -2660,6 +3060,8 @@ static int io_iopoll_check(struct io_ring_ctx *ctx, long min)
 
 			mutex_unlock(&ctx->uring_lock);
 			io_run_task_work();
+			if (ctx->flags & IORING_SETUP_DEFER_TASKRUN)
+				io_run_local_work(ctx);
 			mutex_lock(&ctx->uring_lock);
 
 			/* some requests don't go through iopoll_list */
@@ -3108,11 +3510,11 @@ static void kiocb_done(struct kiocb *kiocb, ssize_t ret,
 	}
 }
 
-static int __io_import_fixed(struct io_kiocb *req, int rw, struct iov_iter *iter,
-			     struct io_mapped_ubuf *imu)
+static int __io_import_fixed(int rw, struct iov_iter *iter,
+			     struct io_mapped_ubuf *imu, u64 buf_addr,
+			     size_t len)
 {
-	size_t len = req->rw.len;
-	u64 buf_end, buf_addr = req->rw.addr;
+	u64 buf_end;
 	size_t offset;
 
 	if (unlikely(check_add_overflow(buf_addr, (u64)len, &buf_end)))
@@ -3170,7 +3572,7 @@ static int io_import_fixed(struct io_kiocb *req, int rw, struct iov_iter *iter)
 {
 	if (WARN_ON_ONCE(!req->imu))
 		return -EFAULT;
-	return __io_import_fixed(req, rw, iter, req->imu);
+	return __io_import_fixed(rw, iter, req->imu, req->rw.addr, req->rw.len);
 }
 
 static void io_ring_submit_unlock(struct io_ring_ctx *ctx, bool needs_lock)
@@ -3191,54 +3593,97 @@ static void io_ring_submit_lock(struct io_ring_ctx *ctx, bool needs_lock)
 		mutex_lock(&ctx->uring_lock);
 }
 
-static struct io_buffer *io_buffer_select(struct io_kiocb *req, size_t *len,
-					  int bgid, struct io_buffer *kbuf,
-					  bool needs_lock)
+static void __user *io_ring_buffer_select(struct io_kiocb *req, size_t *len,
+					  struct io_buffer_ring *br)
+{
+	struct io_uring_buf_ring *ring = br->buf_ring;
+	struct io_uring_buf *buf;
+	__u16 head = br->head;
+	__u32 buf_len;
+
+	/* pairs with the tail store of the application */
+	if (unlikely(smp_load_acquire(&ring->tail) == head))
+		return ERR_PTR(-ENOBUFS);
+
+	buf = io_ring_buf_entry(br, head);
+	buf_len = READ_ONCE(buf->len);
+	if (*len > buf_len)
+		*len = buf_len;
+	req->buf_index = READ_ONCE(buf->bid);
+	req->flags |= REQ_F_BUFFER_RING;
+	br->head++;
+	return u64_to_user_ptr(READ_ONCE(buf->addr));
+}
+
+/*
+ * Pick a buffer from group @bgid. For classic provided buffers the
+ * io_buffer is handed back in @kbuf, ring buffers set REQ_F_BUFFER_RING.
+ */
+static void __user *io_buffer_select(struct io_kiocb *req, size_t *len,
+				     int bgid, struct io_buffer **kbuf,
+				     bool needs_lock)
 {
+	struct io_ring_ctx *ctx = req->ctx;
+	struct io_buffer_ring *br;
 	struct io_buffer *head;
+	void __user *ret;
 
-	if (req->flags & REQ_F_BUFFER_SELECTED)
-		return kbuf;
+	io_ring_submit_lock(ctx, needs_lock);
 
-	io_ring_submit_lock(req->ctx, needs_lock);
+	lockdep_assert_held(&ctx->uring_lock);
 
-	lockdep_assert_held(&req->ctx->uring_lock);
+	br = xa_load(&ctx->io_buf_rings, bgid);
+	if (br) {
+		ret = io_ring_buffer_select(req, len, br);
+		goto out;
+	}
 
-	head = xa_load(&req->ctx->io_buffers, bgid);
+	head = xa_load(&ctx->io_buffers, bgid);
 	if (head) {
 		if (!list_empty(&head->list)) {
-			kbuf = list_last_entry(&head->list, struct io_buffer,
+			*kbuf = list_last_entry(&head->list, struct io_buffer,
 							list);
-			list_del(&kbuf->list);
+			list_del(&(*kbuf)->list);
 		} else {
-			kbuf = head;
-			xa_erase(&req->ctx->io_buffers, bgid);
+			*kbuf = head;
+			xa_erase(&ctx->io_buffers, bgid);
 		}
-		if (*len > kbuf->len)
-			*len = kbuf->len;
+		if (*len > (*kbuf)->len)
+			*len = (*kbuf)->len;
+		ret = u64_to_user_ptr((*kbuf)->addr);
 	} else {
-		kbuf = ERR_PTR(-ENOBUFS);
+		ret = ERR_PTR(-ENOBUFS);
 	}
+out:
+	io_ring_submit_unlock(ctx, needs_lock);
 
-	io_ring_submit_unlock(req->ctx, needs_lock);
-
-	return kbuf;
+	return ret;
 }
 
 static void __user *io_rw_buffer_select(struct io_kiocb *req, size_t *len,
 					bool needs_lock)
 {
 	struct io_buffer *kbuf;
-	u16 bgid;
+	void __user *buf;
 
-	kbuf = (struct io_buffer *) (unsigned long) req->rw.addr;
-	bgid = req->buf_index;
-	kbuf = io_buffer_select(req, len, bgid, kbuf, needs_lock);
-	if (IS_ERR(kbuf))
-		return kbuf;
-	req->rw.addr = (u64) (unsigned long) kbuf;
+	if (req->flags & REQ_F_BUFFER_SELECTED) {
+		if (req->flags & REQ_F_BUFFER_RING)
+			return u64_to_user_ptr(req->rw.addr);
+		kbuf = (struct io_buffer *) (unsigned long) req->rw.addr;
+		return u64_to_user_ptr(kbuf->addr);
+	}
+
+	buf = io_buffer_select(req, len, req->buf_index, &kbuf, needs_lock);
+	if (IS_ERR(buf))
+		return buf;
+	if (req->flags & REQ_F_BUFFER_RING) {
+		req->rw.addr = (u64) (unsigned long) buf;
+		req->rw.len = *len;
+	} else {
+		req->rw.addr = (u64) (unsigned long) kbuf;
+	}
 	req->flags |= REQ_F_BUFFER_SELECTED;
-	return u64_to_user_ptr(kbuf->addr);
+	return buf;
 }
 
 #ifdef CONFIG_COMPAT
@@ -3292,6 +3737,11 @@ static ssize_t __io_iov_buffer_select(struct io_kiocb *req, struct iovec *iov,
 static ssize_t io_iov_buffer_select(struct io_kiocb *req, struct iovec *iov,
 				    bool needs_lock)
 {
+	if (req->flags & REQ_F_BUFFER_RING) {
+		iov[0].iov_base = u64_to_user_ptr(req->rw.addr);
+		iov[0].iov_len = req->rw.len;
+		return 0;
+	}
 	if (req->flags & REQ_F_BUFFER_SELECTED) {
 		struct io_buffer *kbuf;
 
@@ -4076,65 +4526,320 @@ static int io_linkat(struct io_kiocb *req, int issue_flags)
 	return 0;
 }
 
-static int io_shutdown_prep(struct io_kiocb *req,
-			    const struct io_uring_sqe *sqe)
+static void __io_xattr_finish(struct io_kiocb *req)
 {
-#if defined(CONFIG_NET)
-	if (unlikely(req->ctx->flags & IORING_SETUP_IOPOLL))
-		return -EINVAL;
-	if (unlikely(sqe->ioprio || sqe->off || sqe->addr || sqe->rw_flags ||
-		     sqe->buf_index || sqe->splice_fd_in))
-		return -EINVAL;
+	struct io_xattr *ix = &req->xattr;
 
-	req->shutdown.how = READ_ONCE(sqe->len);
-	return 0;
-#else
-	return -EOPNOTSUPP;
-#endif
+	if (ix->filename)
+		putname(ix->filename);
+
+	kfree(ix->ctx.kname);
+	kvfree(ix->ctx.kvalue);
 }
 
-static int io_shutdown(struct io_kiocb *req, unsigned int issue_flags)
+static void io_xattr_finish(struct io_kiocb *req, int ret)
 {
-#if defined(CONFIG_NET)
-	struct socket *sock;
-	int ret;
-
-	if (issue_flags & IO_URING_F_NONBLOCK)
-		return -EAGAIN;
-
-	sock = sock_from_file(req->file);
-	if (unlikely(!sock))
-		return -ENOTSOCK;
+	req->flags &= ~REQ_F_NEED_CLEANUP;
 
-	ret = __sys_shutdown_sock(sock, req->shutdown.how);
+	__io_xattr_finish(req);
 	if (ret < 0)
 		req_set_fail(req);
 	io_req_complete(req, ret);
-	return 0;
-#else
-	return -EOPNOTSUPP;
-#endif
 }
 
-static int __io_splice_prep(struct io_kiocb *req,
-			    const struct io_uring_sqe *sqe)
+static int __io_getxattr_prep(struct io_kiocb *req,
+			      const struct io_uring_sqe *sqe)
 {
-	struct io_splice *sp = &req->splice;
-	unsigned int valid_flags = SPLICE_F_FD_IN_FIXED | SPLICE_F_ALL;
+	struct io_xattr *ix = &req->xattr;
+	const char __user *name;
+	int ret;
 
 	if (unlikely(req->ctx->flags & IORING_SETUP_IOPOLL))
 		return -EINVAL;
+	if (sqe->ioprio || sqe->buf_index || sqe->splice_fd_in)
+		return -EINVAL;
 
-	sp->len = READ_ONCE(sqe->len);
-	sp->flags = READ_ONCE(sqe->splice_flags);
-	if (unlikely(sp->flags & ~valid_flags))
+	ix->filename = NULL;
+	ix->ctx.kvalue = NULL;
+	name = u64_to_user_ptr(READ_ONCE(sqe->addr));
+	ix->ctx.value = u64_to_user_ptr(READ_ONCE(sqe->addr2));
+	ix->ctx.size = READ_ONCE(sqe->len);
+	ix->ctx.flags = READ_ONCE(sqe->xattr_flags);
+
+	if (ix->ctx.flags)
 		return -EINVAL;
-	sp->splice_fd_in = READ_ONCE(sqe->splice_fd_in);
-	return 0;
-}
 
-static int io_tee_prep(struct io_kiocb *req,
-		       const struct io_uring_sqe *sqe)
+	ix->ctx.kname = kmalloc(sizeof(*ix->ctx.kname), GFP_KERNEL);
+	if (!ix->ctx.kname)
+		return -ENOMEM;
+
+	ret = strncpy_from_user(ix->ctx.kname->name, name,
+				sizeof(ix->ctx.kname->name));
+	if (!ret || ret == sizeof(ix->ctx.kname->name))
+		ret = -ERANGE;
+	if (ret < 0) {
+		kfree(ix->ctx.kname);
+		return ret;
+	}
+
+	req->flags |= REQ_F_NEED_CLEANUP;
+	return 0;
+}
+
+static int io_fgetxattr_prep(struct io_kiocb *req,
+			     const struct io_uring_sqe *sqe)
+{
+	if (sqe->addr3)
+		return -EINVAL;
+	return __io_getxattr_prep(req, sqe);
+}
+
+static int io_getxattr_prep(struct io_kiocb *req,
+			    const struct io_uring_sqe *sqe)
+{
+	struct io_xattr *ix = &req->xattr;
+	const char __user *path;
+	int ret;
+
+	if (unlikely(req->flags & REQ_F_FIXED_FILE))
+		return -EBADF;
+
+	ret = __io_getxattr_prep(req, sqe);
+	if (ret)
+		return ret;
+
+	path = u64_to_user_ptr(READ_ONCE(sqe->addr3));
+
+	ix->filename = getname_flags(path, LOOKUP_FOLLOW, NULL);
+	if (IS_ERR(ix->filename)) {
+		ret = PTR_ERR(ix->filename);
+		ix->filename = NULL;
+	}
+
+	return ret;
+}
+
+static int io_fgetxattr(struct io_kiocb *req, unsigned int issue_flags)
+{
+	struct io_xattr *ix = &req->xattr;
+	int ret;
+
+	if (issue_flags & IO_URING_F_NONBLOCK)
+		return -EAGAIN;
+
+	ret = do_getxattr(mnt_user_ns(req->file->f_path.mnt),
+			  req->file->f_path.dentry, &ix->ctx);
+
+	io_xattr_finish(req, ret);
+	return 0;
+}
+
+static int io_getxattr(struct io_kiocb *req, unsigned int issue_flags)
+{
+	struct io_xattr *ix = &req->xattr;
+	unsigned int lookup_flags = LOOKUP_FOLLOW;
+	struct path path;
+	int ret;
+
+	if (issue_flags & IO_URING_F_NONBLOCK)
+		return -EAGAIN;
+
+retry:
+	ret = filename_lookup(AT_FDCWD, ix->filename, lookup_flags, &path, NULL);
+	if (!ret) {
+		ret = do_getxattr(mnt_user_ns(path.mnt), path.dentry, &ix->ctx);
+
+		path_put(&path);
+		if (retry_estale(ret, lookup_flags)) {
+			/* do_getxattr() allocates a new one on every call */
+			kvfree(ix->ctx.kvalue);
+			ix->ctx.kvalue = NULL;
+			lookup_flags |= LOOKUP_REVAL;
+			goto retry;
+		}
+	}
+
+	io_xattr_finish(req, ret);
+	return 0;
+}
+
+static int __io_setxattr_prep(struct io_kiocb *req,
+			      const struct io_uring_sqe *sqe)
+{
+	struct io_xattr *ix = &req->xattr;
+	const char __user *name;
+	int ret;
+
+	if (unlikely(req->ctx->flags & IORING_SETUP_IOPOLL))
+		return -EINVAL;
+	if (sqe->ioprio || sqe->buf_index || sqe->splice_fd_in)
+		return -EINVAL;
+
+	ix->filename = NULL;
+	name = u64_to_user_ptr(READ_ONCE(sqe->addr));
+	ix->ctx.cvalue = u64_to_user_ptr(READ_ONCE(sqe->addr2));
+	ix->ctx.kvalue = NULL;
+	ix->ctx.size = READ_ONCE(sqe->len);
+	ix->ctx.flags = READ_ONCE(sqe->xattr_flags);
+
+	ix->ctx.kname = kmalloc(sizeof(*ix->ctx.kname), GFP_KERNEL);
+	if (!ix->ctx.kname)
+		return -ENOMEM;
+
+	/* the value is copied in here, so the SQE memory may be reused */
+	ret = setxattr_copy(name, &ix->ctx);
+	if (ret) {
+		kfree(ix->ctx.kname);
+		return ret;
+	}
+
+	req->flags |= REQ_F_NEED_CLEANUP;
+	return 0;
+}
+
+static int io_fsetxattr_prep(struct io_kiocb *req,
+			     const struct io_uring_sqe *sqe)
+{
+	if (sqe->addr3)
+		return -EINVAL;
+	return __io_setxattr_prep(req, sqe);
+}
+
+static int io_setxattr_prep(struct io_kiocb *req,
+			    const struct io_uring_sqe *sqe)
+{
+	struct io_xattr *ix = &req->xattr;
+	const char __user *path;
+	int ret;
+
+	if (unlikely(req->flags & REQ_F_FIXED_FILE))
+		return -EBADF;
+
+	ret = __io_setxattr_prep(req, sqe);
+	if (ret)
+		return ret;
+
+	path = u64_to_user_ptr(READ_ONCE(sqe->addr3));
+
+	ix->filename = getname_flags(path, LOOKUP_FOLLOW, NULL);
+	if (IS_ERR(ix->filename)) {
+		ret = PTR_ERR(ix->filename);
+		ix->filename = NULL;
+	}
+
+	return ret;
+}
+
+static int __io_setxattr(struct io_kiocb *req, struct path *path)
+{
+	struct io_xattr *ix = &req->xattr;
+	int ret;
+
+	ret = mnt_want_write(path->mnt);
+	if (!ret) {
+		ret = do_setxattr(mnt_user_ns(path->mnt), path->dentry, &ix->ctx);
+		mnt_drop_write(path->mnt);
+	}
+
+	return ret;
+}
+
+static int io_fsetxattr(struct io_kiocb *req, unsigned int issue_flags)
+{
+	int ret;
+
+	if (issue_flags & IO_URING_F_NONBLOCK)
+		return -EAGAIN;
+
+	ret = __io_setxattr(req, &req->file->f_path);
+	io_xattr_finish(req, ret);
+	return 0;
+}
+
+static int io_setxattr(struct io_kiocb *req, unsigned int issue_flags)
+{
+	struct io_xattr *ix = &req->xattr;
+	unsigned int lookup_flags = LOOKUP_FOLLOW;
+	struct path path;
+	int ret;
+
+	if (issue_flags & IO_URING_F_NONBLOCK)
+		return -EAGAIN;
+
+retry:
+	ret = filename_lookup(AT_FDCWD, ix->filename, lookup_flags, &path, NULL);
+	if (!ret) {
+		ret = __io_setxattr(req, &path);
+		path_put(&path);
+		if (retry_estale(ret, lookup_flags)) {
+			lookup_flags |= LOOKUP_REVAL;
+			goto retry;
+		}
+	}
+
+	io_xattr_finish(req, ret);
+	return 0;
+}
+
+static int io_shutdown_prep(struct io_kiocb *req,
+			    const struct io_uring_sqe *sqe)
+{
+#if defined(CONFIG_NET)
+	if (unlikely(req->ctx->flags & IORING_SETUP_IOPOLL))
+		return -EINVAL;
+	if (unlikely(sqe->ioprio || sqe->off || sqe->addr || sqe->rw_flags ||
+		     sqe->buf_index || sqe->splice_fd_in))
+		return -EINVAL;
+
+	req->shutdown.how = READ_ONCE(sqe->len);
+	return 0;
+#else
+	return -EOPNOTSUPP;
+#endif
+}
+
+static int io_shutdown(struct io_kiocb *req, unsigned int issue_flags)
+{
+#if defined(CONFIG_NET)
+	struct socket *sock;
+	int ret;
+
+	if (issue_flags & IO_URING_F_NONBLOCK)
+		return -EAGAIN;
+
+	sock = sock_from_file(req->file);
+	if (unlikely(!sock))
+		return -ENOTSOCK;
+
+	ret = __sys_shutdown_sock(sock, req->shutdown.how);
+	if (ret < 0)
+		req_set_fail(req);
+	io_req_complete(req, ret);
+	return 0;
+#else
+	return -EOPNOTSUPP;
+#endif
+}
+
+static int __io_splice_prep(struct io_kiocb *req,
+			    const struct io_uring_sqe *sqe)
+{
+	struct io_splice *sp = &req->splice;
+	unsigned int valid_flags = SPLICE_F_FD_IN_FIXED | SPLICE_F_ALL;
+
+	if (unlikely(req->ctx->flags & IORING_SETUP_IOPOLL))
+		return -EINVAL;
+
+	sp->len = READ_ONCE(sqe->len);
+	sp->flags = READ_ONCE(sqe->splice_flags);
+	if (unlikely(sp->flags & ~valid_flags))
+		return -EINVAL;
+	sp->splice_fd_in = READ_ONCE(sqe->splice_fd_in);
+	return 0;
+}
+
+static int io_tee_prep(struct io_kiocb *req,
+		       const struct io_uring_sqe *sqe)
 {
 	if (READ_ONCE(sqe->splice_off_in) || READ_ONCE(sqe->off))
 		return -EINVAL;
@@ -4579,6 +5284,12 @@ static int io_provide_buffers(struct io_kiocb *req, unsigned int issue_flags)
 
 	lockdep_assert_held(&ctx->uring_lock);
 
+	/* a group is either classic or ring mapped */
+	if (unlikely(xa_load(&ctx->io_buf_rings, p->bgid))) {
+		ret = -EEXIST;
+		goto out;
+	}
+
 	list = head = xa_load(&ctx->io_buffers, p->bgid);
 
 	ret = io_add_buffers(p, &head);
@@ -4588,6 +5299,7 @@ static int io_provide_buffers(struct io_kiocb *req, unsigned int issue_flags)
 		if (ret < 0)
 			__io_remove_buffers(ctx, head, p->bgid, -1U);
 	}
+out:
 	if (ret < 0)
 		req_set_fail(req);
 	/* complete before unlock, IOPOLL may need the lock */
@@ -4851,6 +5563,162 @@ static int io_sync_file_range(struct io_kiocb *req, unsigned int issue_flags)
 	return 0;
 }
 
+static void io_notif_complete(struct work_struct *work)
+{
+	struct io_notif *notif = container_of(work, struct io_notif, work);
+	struct io_ring_ctx *ctx = notif->ctx;
+
+	spin_lock(&ctx->completion_lock);
+	io_fill_cqe_aux(ctx, notif->user_data, 0, IORING_CQE_F_NOTIF);
+	io_commit_cqring(ctx);
+	spin_unlock(&ctx->completion_lock);
+	io_cqring_ev_posted(ctx);
+
+	percpu_ref_put(&ctx->refs);
+	kfree(notif);
+}
+
+static void io_notif_callback(struct sk_buff *skb, struct ubuf_info *uarg,
+			      bool success)
+{
+	struct io_notif *notif = container_of(uarg, struct io_notif, uarg);
+
+	/* may be called from any context, CQ posting needs a task */
+	if (refcount_dec_and_test(&uarg->refcnt))
+		queue_work(system_unbound_wq, &notif->work);
+}
+
+static struct io_notif *io_notif_alloc(struct io_kiocb *req)
+{
+	struct io_ring_ctx *ctx = req->ctx;
+	struct io_notif *notif;
+
+	notif = kzalloc(sizeof(*notif), GFP_KERNEL);
+	if (!notif)
+		return NULL;
+	notif->uarg.callback = io_notif_callback;
+	notif->uarg.flags = SKBFL_ZEROCOPY_FRAG;
+	refcount_set(&notif->uarg.refcnt, 1);
+	notif->ctx = ctx;
+	notif->user_data = req->user_data;
+	INIT_WORK(&notif->work, io_notif_complete);
+	percpu_ref_get(&ctx->refs);
+	return notif;
+}
+
+/*
+ * Drop the request's notification reference when it didn't complete
+ * through io_sendzc(). If no skb ever took the buffer, there is nothing
+ * to notify about, otherwise the notification CQE still follows.
+ */
+static void io_notif_release(struct io_notif *notif)
+{
+	if (refcount_read(&notif->uarg.refcnt) == 1) {
+		percpu_ref_put(&notif->ctx->refs);
+		kfree(notif);
+		return;
+	}
+	net_zcopy_put(&notif->uarg);
+}
+
+static void io_uring_cmd_work(struct io_kiocb *req, bool *locked)
+{
+	req->uring_cmd.task_work_cb(&req->uring_cmd);
+}
+
+void io_uring_cmd_complete_in_task(struct io_uring_cmd *ioucmd,
+			void (*task_work_cb)(struct io_uring_cmd *))
+{
+	struct io_kiocb *req = container_of(ioucmd, struct io_kiocb, uring_cmd);
+
+	ioucmd->task_work_cb = task_work_cb;
+	req->io_task_work.func = io_uring_cmd_work;
+	io_req_task_work_add(req);
+}
+EXPORT_SYMBOL_GPL(io_uring_cmd_complete_in_task);
+
+/*
+ * Called by consumers of io_uring_cmd, if they originally returned
+ * -EIOCBQUEUED upon receiving the command. Must be called from task
+ * context, see io_uring_cmd_complete_in_task().
+ */
+void io_uring_cmd_done(struct io_uring_cmd *ioucmd, ssize_t ret, ssize_t res2)
+{
+	struct io_kiocb *req = container_of(ioucmd, struct io_kiocb, uring_cmd);
+
+	if (ret < 0)
+		req_set_fail(req);
+	if (req->ctx->flags & IORING_SETUP_CQE32)
+		io_req_complete_post32(req, ret, 0, res2, 0);
+	else
+		io_req_complete_post(req, ret, 0);
+}
+EXPORT_SYMBOL_GPL(io_uring_cmd_done);
+
+static inline size_t uring_cmd_pdu_size(bool is_sqe128)
+{
+	if (is_sqe128)
+		return 2 * sizeof(struct io_uring_sqe) -
+			offsetof(struct io_uring_sqe, cmd);
+	return sizeof(struct io_uring_sqe) - offsetof(struct io_uring_sqe, cmd);
+}
+
+static int io_uring_cmd_prep_async(struct io_kiocb *req)
+{
+	size_t cmd_size;
+
+	cmd_size = uring_cmd_pdu_size(req->ctx->flags & IORING_SETUP_SQE128);
+	memcpy(req->async_data, req->uring_cmd.cmd, cmd_size);
+	req->uring_cmd.cmd = req->async_data;
+	return 0;
+}
+
+static int io_uring_cmd_prep(struct io_kiocb *req,
+			     const struct io_uring_sqe *sqe)
+{
+	struct io_uring_cmd *ioucmd = &req->uring_cmd;
+
+	if (req->ctx->flags & IORING_SETUP_IOPOLL)
+		return -EOPNOTSUPP;
+	if (sqe->rw_flags || sqe->__pad1 || sqe->ioprio || sqe->buf_index)
+		return -EINVAL;
+	ioucmd->cmd = sqe->cmd;
+	ioucmd->cmd_op = READ_ONCE(sqe->cmd_op);
+	return 0;
+}
+
+static int io_uring_cmd(struct io_kiocb *req, unsigned int issue_flags)
+{
+	struct io_uring_cmd *ioucmd = &req->uring_cmd;
+	struct io_ring_ctx *ctx = req->ctx;
+	struct file *file = req->file;
+	int ret;
+
+	if (!file->f_op->uring_cmd)
+		return -EOPNOTSUPP;
+
+	if (ctx->flags & IORING_SETUP_SQE128)
+		issue_flags |= IO_URING_F_SQE128;
+	if (ctx->flags & IORING_SETUP_CQE32)
+		issue_flags |= IO_URING_F_CQE32;
+
+	ret = file->f_op->uring_cmd(ioucmd, issue_flags);
+	if (ret == -EAGAIN) {
+		/* the SQE may be reused before io-wq gets to the request */
+		if (!req->async_data) {
+			if (io_alloc_async_data(req))
+				return -ENOMEM;
+			io_uring_cmd_prep_async(req);
+		}
+		return -EAGAIN;
+	}
+
+	/* -EIOCBQUEUED: the driver calls io_uring_cmd_done() later */
+	if (ret != -EIOCBQUEUED)
+		io_uring_cmd_done(ioucmd, ret, 0);
+	return 0;
+}
+
 #if defined(CONFIG_NET)
 static bool io_net_retry(struct socket *sock, int flags)
 {
@@ -5013,6 +5881,7 @@ static int io_send(struct io_kiocb *req, unsigned int issue_flags)
 	msg.msg_control = NULL;
 	msg.msg_controllen = 0;
 	msg.msg_namelen = 0;
+	msg.msg_ubuf = NULL;
 
 	flags = req->sr_msg.msg_flags;
 	if (issue_flags & IO_URING_F_NONBLOCK)
@@ -5131,19 +6000,29 @@ static int io_recvmsg_copy_hdr(struct io_kiocb *req,
 	return __io_recvmsg_copy_hdr(req, iomsg);
 }
 
-static struct io_buffer *io_recv_buffer_select(struct io_kiocb *req,
-					       bool needs_lock)
+static void __user *io_recv_buffer_select(struct io_kiocb *req,
+					  bool needs_lock)
 {
 	struct io_sr_msg *sr = &req->sr_msg;
 	struct io_buffer *kbuf;
+	void __user *buf;
 
-	kbuf = io_buffer_select(req, &sr->len, sr->bgid, sr->kbuf, needs_lock);
-	if (IS_ERR(kbuf))
-		return kbuf;
+	if (req->flags & REQ_F_BUFFER_SELECTED) {
+		if (req->flags & REQ_F_BUFFER_RING)
+			return sr->ring_buf;
+		return u64_to_user_ptr(sr->kbuf->addr);
+	}
+
+	buf = io_buffer_select(req, &sr->len, sr->bgid, &kbuf, needs_lock);
+	if (IS_ERR(buf))
+		return buf;
 
-	sr->kbuf = kbuf;
+	if (req->flags & REQ_F_BUFFER_RING)
+		sr->ring_buf = buf;
+	else
+		sr->kbuf = kbuf;
 	req->flags |= REQ_F_BUFFER_SELECTED;
-	return kbuf;
+	return buf;
 }
 
 static inline unsigned int io_put_recv_kbuf(struct io_kiocb *req)
@@ -5164,13 +6043,12 @@ static int io_recvmsg_prep_async(struct io_kiocb *req)
 static int io_recvmsg_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 {
 	struct io_sr_msg *sr = &req->sr_msg;
+	unsigned flags;
 
 	if (unlikely(req->ctx->flags & IORING_SETUP_IOPOLL))
 		return -EINVAL;
 	if (unlikely(sqe->addr2 || sqe->file_index))
 		return -EINVAL;
-	if (unlikely(sqe->addr2 || sqe->file_index || sqe->ioprio))
-		return -EINVAL;
 
 	sr->umsg = u64_to_user_ptr(READ_ONCE(sqe->addr));
 	sr->len = READ_ONCE(sqe->len);
@@ -5179,6 +6057,19 @@ static int io_recvmsg_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 	if (sr->msg_flags & MSG_DONTWAIT)
 		req->flags |= REQ_F_NOWAIT;
 
+	flags = READ_ONCE(sqe->ioprio);
+	if (flags & ~IORING_RECV_MULTISHOT)
+		return -EINVAL;
+	if (flags & IORING_RECV_MULTISHOT) {
+		if (req->opcode != IORING_OP_RECV)
+			return -EINVAL;
+		if (!(req->flags & REQ_F_BUFFER_SELECT))
+			return -EINVAL;
+		if (sr->len || (sr->msg_flags & MSG_WAITALL))
+			return -EINVAL;
+		req->flags |= REQ_F_APOLL_MULTISHOT;
+	}
+
 #ifdef CONFIG_COMPAT
 	if (req->ctx->compat)
 		sr->msg_flags |= MSG_CMSG_COMPAT;
@@ -5192,7 +6083,7 @@ static int io_recvmsg(struct io_kiocb *req, unsigned int issue_flags)
 	struct io_async_msghdr iomsg, *kmsg;
 	struct io_sr_msg *sr = &req->sr_msg;
 	struct socket *sock;
-	struct io_buffer *kbuf;
+	void __user *buf;
 	unsigned flags;
 	int min_ret = 0;
 	int ret, cflags = 0;
@@ -5211,10 +6102,10 @@ static int io_recvmsg(struct io_kiocb *req, unsigned int issue_flags)
 	}
 
 	if (req->flags & REQ_F_BUFFER_SELECT) {
-		kbuf = io_recv_buffer_select(req, !force_nonblock);
-		if (IS_ERR(kbuf))
-			return PTR_ERR(kbuf);
-		kmsg->fast_iov[0].iov_base = u64_to_user_ptr(kbuf->addr);
+		buf = io_recv_buffer_select(req, !force_nonblock);
+		if (IS_ERR(buf))
+			return PTR_ERR(buf);
+		kmsg->fast_iov[0].iov_base = buf;
 		kmsg->fast_iov[0].iov_len = req->sr_msg.len;
 		iov_iter_init(&kmsg->msg.msg_iter, READ, kmsg->fast_iov,
 				1, req->sr_msg.len);
@@ -5259,7 +6150,6 @@ static int io_recvmsg(struct io_kiocb *req, unsigned int issue_flags)
 
 static int io_recv(struct io_kiocb *req, unsigned int issue_flags)
 {
-	struct io_buffer *kbuf;
 	struct io_sr_msg *sr = &req->sr_msg;
 	struct msghdr msg;
 	void __user *buf = sr->buf;
@@ -5274,11 +6164,15 @@ static int io_recv(struct io_kiocb *req, unsigned int issue_flags)
 	if (unlikely(!sock))
 		return -ENOTSOCK;
 
+retry_multishot:
 	if (req->flags & REQ_F_BUFFER_SELECT) {
-		kbuf = io_recv_buffer_select(req, !force_nonblock);
-		if (IS_ERR(kbuf))
-			return PTR_ERR(kbuf);
-		buf = u64_to_user_ptr(kbuf->addr);
+		/* multishot fills whatever buffer it is given */
+		if ((req->flags & REQ_F_APOLL_MULTISHOT) &&
+		    !(req->flags & REQ_F_BUFFER_SELECTED))
+			sr->len = MAX_RW_COUNT;
+		buf = io_recv_buffer_select(req, !force_nonblock);
+		if (IS_ERR(buf))
+			return PTR_ERR(buf);
 	}
 
 	ret = import_single_range(READ, buf, sr->len, &iov, &msg.msg_iter);
@@ -5300,8 +6194,14 @@ static int io_recv(struct io_kiocb *req, unsigned int issue_flags)
 
 	ret = sock_recvmsg(sock, &msg, flags);
 	if (ret < min_ret) {
-		if (ret == -EAGAIN && force_nonblock)
+		if (ret == -EAGAIN && force_nonblock) {
+			/* still armed, wait for the next poll wakeup */
+			if (issue_flags & IO_URING_F_MULTISHOT) {
+				io_kbuf_recycle(req, sr->kbuf, sr->bgid);
+				return 0;
+			}
 			return -EAGAIN;
+		}
 		if (ret == -ERESTARTSYS)
 			ret = -EINTR;
 		if (ret > 0 && io_net_retry(sock, flags)) {
@@ -5322,17 +6222,151 @@ static int io_recv(struct io_kiocb *req, unsigned int issue_flags)
 		ret += sr->done_io;
 	else if (sr->done_io)
 		ret = sr->done_io;
+
+	if (req->flags & REQ_F_APOLL_MULTISHOT) {
+		struct io_ring_ctx *ctx = req->ctx;
+		bool filled;
+
+		/* EOF and errors end it, so does a CQ we can't post into */
+		if (ret <= 0)
+			return io_multishot_stop(req, issue_flags, ret, cflags);
+
+		spin_lock(&ctx->completion_lock);
+		filled = io_fill_cqe_aux(ctx, req->user_data, ret,
+					 cflags | IORING_CQE_F_MORE);
+		io_commit_cqring(ctx);
+		spin_unlock(&ctx->completion_lock);
+		if (!filled)
+			return io_multishot_stop(req, issue_flags, ret, cflags);
+		io_cqring_ev_posted(ctx);
+		goto retry_multishot;
+	}
 	__io_req_complete(req, issue_flags, ret, cflags);
 	return 0;
 }
 
+static int io_sendzc_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
+{
+	struct io_sendzc *zc = &req->sendzc;
+	struct io_ring_ctx *ctx = req->ctx;
+
+	if (unlikely(ctx->flags & IORING_SETUP_IOPOLL))
+		return -EINVAL;
+	if (unlikely(sqe->addr2 || sqe->file_index))
+		return -EINVAL;
+
+	zc->flags = READ_ONCE(sqe->ioprio);
+	if (zc->flags & ~IORING_RECVSEND_FIXED_BUF)
+		return -EINVAL;
+	if (zc->flags & IORING_RECVSEND_FIXED_BUF) {
+		u16 index = READ_ONCE(sqe->buf_index);
+
+		if (unlikely(index >= ctx->nr_user_bufs))
+			return -EFAULT;
+		index = array_index_nospec(index, ctx->nr_user_bufs);
+		req->imu = ctx->user_bufs[index];
+		io_req_set_rsrc_node(req);
+	} else if (sqe->buf_index) {
+		return -EINVAL;
+	}
+
+	zc->buf = u64_to_user_ptr(READ_ONCE(sqe->addr));
+	zc->len = READ_ONCE(sqe->len);
+	zc->msg_flags = READ_ONCE(sqe->msg_flags) | MSG_ZEROCOPY;
+	if (zc->msg_flags & MSG_DONTWAIT)
+		req->flags |= REQ_F_NOWAIT;
+	zc->done_io = 0;
+
+	zc->notif = io_notif_alloc(req);
+	if (!zc->notif)
+		return -ENOMEM;
+	req->flags |= REQ_F_NEED_CLEANUP;
+	return 0;
+}
+
+static int io_sendzc(struct io_kiocb *req, unsigned int issue_flags)
+{
+	struct io_sendzc *zc = &req->sendzc;
+	struct io_notif *notif = zc->notif;
+	struct msghdr msg;
+	struct iovec iov;
+	struct socket *sock;
+	unsigned flags;
+	int min_ret = 0;
+	int ret;
+
+	sock = sock_from_file(req->file);
+	if (unlikely(!sock))
+		return -ENOTSOCK;
+	/* only TCP takes the caller's msg_ubuf, others would copy silently */
+	if (sock->sk->sk_type != SOCK_STREAM ||
+	    sock->sk->sk_protocol != IPPROTO_TCP)
+		return -EOPNOTSUPP;
+
+	if (zc->flags & IORING_RECVSEND_FIXED_BUF)
+		ret = __io_import_fixed(WRITE, &msg.msg_iter, req->imu,
+					(u64)(unsigned long)zc->buf, zc->len);
+	else
+		ret = import_single_range(WRITE, zc->buf, zc->len, &iov,
+					  &msg.msg_iter);
+	if (unlikely(ret))
+		return ret;
+
+	msg.msg_name = NULL;
+	msg.msg_control = NULL;
+	msg.msg_controllen = 0;
+	msg.msg_namelen = 0;
+	msg.msg_ubuf = &notif->uarg;
+
+	flags = zc->msg_flags;
+	if (issue_flags & IO_URING_F_NONBLOCK)
+		flags |= MSG_DONTWAIT;
+	if (flags & MSG_WAITALL)
+		min_ret = iov_iter_count(&msg.msg_iter);
+
+	msg.msg_flags = flags;
+	ret = sock_sendmsg(sock, &msg);
+	if (ret < min_ret) {
+		if (ret == -EAGAIN && (issue_flags & IO_URING_F_NONBLOCK))
+			return -EAGAIN;
+		if (ret == -ERESTARTSYS)
+			ret = -EINTR;
+		if (ret > 0 && io_net_retry(sock, flags)) {
+			zc->len -= ret;
+			zc->buf += ret;
+			zc->done_io += ret;
+			req->flags |= REQ_F_PARTIAL_IO;
+			return -EAGAIN;
+		}
+		req_set_fail(req);
+	}
+	if (ret >= 0)
+		ret += zc->done_io;
+	else if (zc->done_io)
+		ret = zc->done_io;
+
+	/*
+	 * Post the request CQE right away rather than batching it, so that
+	 * the notification can't overtake it.
+	 */
+	req->flags &= ~REQ_F_NEED_CLEANUP;
+	__io_req_complete(req, issue_flags & ~IO_URING_F_COMPLETE_DEFER, ret,
+			  IORING_CQE_F_MORE);
+	net_zcopy_put(&notif->uarg);
+	return 0;
+}
+
 static int io_accept_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 {
 	struct io_accept *accept = &req->accept;
+	unsigned flags;
 
 	if (unlikely(req->ctx->flags & IORING_SETUP_IOPOLL))
 		return -EINVAL;
-	if (sqe->ioprio || sqe->len || sqe->buf_index)
+	if (sqe->len || sqe->buf_index)
+		return -EINVAL;
+	flags = READ_ONCE(sqe->ioprio);
+	if (flags & ~IORING_ACCEPT_MULTISHOT)
 		return -EINVAL;
 
 	accept->addr = u64_to_user_ptr(READ_ONCE(sqe->addr));
@@ -5347,11 +6381,18 @@ static int io_accept_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 		return -EINVAL;
 	if (SOCK_NONBLOCK != O_NONBLOCK && (accept->flags & SOCK_NONBLOCK))
 		accept->flags = (accept->flags & ~SOCK_NONBLOCK) | O_NONBLOCK;
+	if (flags & IORING_ACCEPT_MULTISHOT) {
+		/* a single fixed slot can't take more than one connection */
+		if (accept->file_slot)
+			return -EINVAL;
+		req->flags |= REQ_F_APOLL_MULTISHOT;
+	}
 	return 0;
 }
 
 static int io_accept(struct io_kiocb *req, unsigned int issue_flags)
 {
+	struct io_ring_ctx *ctx = req->ctx;
 	struct io_accept *accept = &req->accept;
 	bool force_nonblock = issue_flags & IO_URING_F_NONBLOCK;
 	unsigned int file_flags = force_nonblock ? O_NONBLOCK : 0;
@@ -5359,6 +6400,11 @@ static int io_accept(struct io_kiocb *req, unsigned int issue_flags)
 	struct file *file;
 	int ret, fd;
 
+	/* reissued from poll task_work, see io_poll_check_events() */
+	if (issue_flags & IO_URING_F_MULTISHOT)
+		lockdep_assert_held(&ctx->uring_lock);
+
+retry:
 	if (!fixed) {
 		fd = __get_unused_fd_flags(accept->flags, accept->nofile);
 		if (unlikely(fd < 0))
@@ -5372,8 +6418,15 @@ static int io_accept(struct io_kiocb *req, unsigned int issue_flags)
 		ret = PTR_ERR(file);
 		/* safe to retry */
 		req->flags |= REQ_F_PARTIAL_IO;
-		if (ret == -EAGAIN && force_nonblock)
+		if (ret == -EAGAIN && force_nonblock) {
+			/*
+			 * An armed multishot request stays on the poll
+			 * waitqueue, the next wakeup will retry it.
+			 */
+			if (issue_flags & IO_URING_F_MULTISHOT)
+				return 0;
 			return -EAGAIN;
+		}
 		if (ret == -ERESTARTSYS)
 			ret = -EINTR;
 		req_set_fail(req);
@@ -5384,8 +6437,34 @@ static int io_accept(struct io_kiocb *req, unsigned int issue_flags)
 		ret = io_install_fixed_file(req, file, issue_flags,
 					    accept->file_slot - 1);
 	}
-	__io_req_complete(req, issue_flags, ret, 0);
-	return 0;
+
+	/*
+	 * From io-wq the accept above blocked, and looping on it would tie
+	 * up the worker for as long as connections keep coming. There is
+	 * no poll entry to fall back to there either, so post this one as
+	 * the final CQE and let the user rearm.
+	 */
+	if (!(req->flags & REQ_F_APOLL_MULTISHOT) || !force_nonblock) {
+		__io_req_complete(req, issue_flags, ret, 0);
+		return 0;
+	}
+	if (ret >= 0) {
+		bool filled;
+
+		spin_lock(&ctx->completion_lock);
+		filled = io_fill_cqe_aux(ctx, req->user_data, ret,
+					 IORING_CQE_F_MORE);
+		io_commit_cqring(ctx);
+		spin_unlock(&ctx->completion_lock);
+		if (filled) {
+			io_cqring_ev_posted(ctx);
+			goto retry;
+		}
+		/* CQ overflowed, terminate and let the user rearm */
+		ret = -ECANCELED;
+	}
+	/* the caller posts the final CQE without IORING_CQE_F_MORE */
+	return ret;
 }
 
 static int io_connect_prep_async(struct io_kiocb *req)
@@ -5451,6 +6530,62 @@ static int io_connect(struct io_kiocb *req, unsigned int issue_flags)
 	__io_req_complete(req, issue_flags, ret, 0);
 	return 0;
 }
+
+static int io_socket_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
+{
+	struct io_socket *sock = &req->sock;
+
+	if (unlikely(req->ctx->flags & IORING_SETUP_IOPOLL))
+		return -EINVAL;
+	if (sqe->ioprio || sqe->addr || sqe->rw_flags || sqe->buf_index)
+		return -EINVAL;
+
+	sock->domain = READ_ONCE(sqe->fd);
+	sock->type = READ_ONCE(sqe->off);
+	sock->protocol = READ_ONCE(sqe->len);
+	sock->file_slot = READ_ONCE(sqe->file_index);
+	sock->nofile = rlimit(RLIMIT_NOFILE);
+
+	sock->flags = sock->type & ~SOCK_TYPE_MASK;
+	if (sock->file_slot && (sock->flags & SOCK_CLOEXEC))
+		return -EINVAL;
+	if (sock->flags & ~(SOCK_CLOEXEC | SOCK_NONBLOCK))
+		return -EINVAL;
+	return 0;
+}
+
+static int io_socket(struct io_kiocb *req, unsigned int issue_flags)
+{
+	struct io_socket *sock = &req->sock;
+	bool fixed = !!sock->file_slot;
+	struct file *file;
+	int ret, fd;
+
+	if (!fixed) {
+		fd = __get_unused_fd_flags(sock->flags, sock->nofile);
+		if (unlikely(fd < 0))
+			return fd;
+	}
+	file = __sys_socket_file(sock->domain, sock->type, sock->protocol);
+	if (IS_ERR(file)) {
+		if (!fixed)
+			put_unused_fd(fd);
+		ret = PTR_ERR(file);
+		if (ret == -EAGAIN && (issue_flags & IO_URING_F_NONBLOCK))
+			return -EAGAIN;
+		if (ret == -ERESTARTSYS)
+			ret = -EINTR;
+		req_set_fail(req);
+	} else if (!fixed) {
+		fd_install(fd, file);
+		ret = fd;
+	} else {
+		ret = io_install_fixed_file(req, file, issue_flags,
+					    sock->file_slot - 1);
+	}
+	__io_req_complete(req, issue_flags, ret, 0);
+	return 0;
+}
 #else /* !CONFIG_NET */
 #define IO_NETOP_FN(op)							\
 static int io_##op(struct io_kiocb *req, unsigned int issue_flags)	\
@@ -5476,6 +6611,8 @@ IO_NETOP_PREP_ASYNC(sendmsg);
 IO_NETOP_PREP_ASYNC(recvmsg);
 IO_NETOP_PREP_ASYNC(connect);
 IO_NETOP_PREP(accept);
+IO_NETOP_PREP(sendzc);
+IO_NETOP_PREP(socket);
 IO_NETOP_FN(send);
 IO_NETOP_FN(recv);
 #endif /* CONFIG_NET */
@@ -5604,15 +6741,23 @@ static void io_poll_remove_entries(struct io_kiocb *req)
 	rcu_read_unlock();
 }
 
+enum {
+	IOU_POLL_DONE			= 0,
+	IOU_POLL_NO_ACTION		= 1,
+	IOU_POLL_REMOVE_POLL_USE_RES	= 2,
+};
+
 /*
  * All poll tw should go through this. Checks for poll events, manages
  * references, does rewait, etc.
  *
- * Returns a negative error on failure. >0 when no action require, which is
- * either spurious wakeup or multishot CQE is served. 0 when it's done with
- * the request, then the mask is stored in req->result.
+ * Returns a negative error on failure. IOU_POLL_NO_ACTION when no action
+ * required, which is either spurious wakeup or multishot CQE is served.
+ * IOU_POLL_DONE when it's done with the request, then the mask is stored in
+ * req->result. IOU_POLL_REMOVE_POLL_USE_RES when a multishot request ended
+ * and its final CQE is stored in req->result and req->compl.cflags.
  */
-static int io_poll_check_events(struct io_kiocb *req)
+static int io_poll_check_events(struct io_kiocb *req, bool *locked)
 {
 	struct io_ring_ctx *ctx = req->ctx;
 	struct io_poll_iocb *poll = io_poll_get_single(req);
@@ -5627,7 +6772,7 @@ static int io_poll_check_events(struct io_kiocb *req)
 
 		/* tw handler should be the owner, and so have some references */
 		if (WARN_ON_ONCE(!(v & IO_POLL_REF_MASK)))
-			return 0;
+			return IOU_POLL_DONE;
 		if (v & IO_POLL_CANCEL_FLAG)
 			return -ECANCELED;
 		/*
@@ -5656,19 +6801,36 @@ static int io_poll_check_events(struct io_kiocb *req)
 
 		/* multishot, just fill an CQE and proceed */
 		if (req->result && !(poll->events & EPOLLONESHOT)) {
-			__poll_t mask = mangle_poll(req->result & poll->events);
-			bool filled;
+			if (req->opcode == IORING_OP_POLL_ADD) {
+				__poll_t mask;
+				bool filled;
+
+				mask = mangle_poll(req->result & poll->events);
+				spin_lock(&ctx->completion_lock);
+				filled = io_fill_cqe_aux(ctx, req->user_data,
+							 mask, IORING_CQE_F_MORE);
+				io_commit_cqring(ctx);
+				spin_unlock(&ctx->completion_lock);
+				if (unlikely(!filled))
+					return -ECANCELED;
+				io_cqring_ev_posted(ctx);
+			} else {
+				int ret;
 
-			spin_lock(&ctx->completion_lock);
-			filled = io_fill_cqe_aux(ctx, req->user_data, mask,
-						 IORING_CQE_F_MORE);
-			io_commit_cqring(ctx);
-			spin_unlock(&ctx->completion_lock);
-			if (unlikely(!filled))
-				return -ECANCELED;
-			io_cqring_ev_posted(ctx);
+				/*
+				 * Multishot fast poll, the handler posts its
+				 * own CQEs and returns 0 while still armed.
+				 */
+				io_tw_lock(ctx, locked);
+				ret = io_issue_sqe(req, IO_URING_F_NONBLOCK |
+							IO_URING_F_MULTISHOT);
+				if (ret == IOU_STOP_MULTISHOT)
+					return IOU_POLL_REMOVE_POLL_USE_RES;
+				if (ret)
+					return ret;
+			}
 		} else if (req->result) {
-			return 0;
+			return IOU_POLL_DONE;
 		}
 
 		/* force the next iteration to vfs_poll() */
@@ -5681,7 +6843,7 @@ static int io_poll_check_events(struct io_kiocb *req)
 	} while (atomic_sub_return(v & IO_POLL_REF_MASK, &req->poll_refs) &
 					IO_POLL_REF_MASK);
 
-	return 1;
+	return IOU_POLL_NO_ACTION;
 }
 
 static void io_poll_task_func(struct io_kiocb *req, bool *locked)
@@ -5689,11 +6851,11 @@ static void io_poll_task_func(struct io_kiocb *req, bool *locked)
 	struct io_ring_ctx *ctx = req->ctx;
 	int ret;
 
-	ret = io_poll_check_events(req);
-	if (ret > 0)
+	ret = io_poll_check_events(req, locked);
+	if (ret == IOU_POLL_NO_ACTION)
 		return;
 
-	if (!ret) {
+	if (ret == IOU_POLL_DONE) {
 		req->result = mangle_poll(req->result & req->poll.events);
 	} else {
 		req->result = ret;
@@ -5712,8 +6874,8 @@ static void io_apoll_task_func(struct io_kiocb *req, bool *locked)
 	struct io_ring_ctx *ctx = req->ctx;
 	int ret;
 
-	ret = io_poll_check_events(req);
-	if (ret > 0)
+	ret = io_poll_check_events(req, locked);
+	if (ret == IOU_POLL_NO_ACTION)
 		return;
 
 	io_poll_remove_entries(req);
@@ -5721,10 +6883,18 @@ static void io_apoll_task_func(struct io_kiocb *req, bool *locked)
 	hash_del(&req->hash_node);
 	spin_unlock(&ctx->completion_lock);
 
-	if (!ret)
+	if (ret == IOU_POLL_REMOVE_POLL_USE_RES) {
+		io_req_complete_post(req, req->result, req->compl.cflags);
+	} else if (ret == IOU_POLL_DONE) {
+		/*
+		 * Multishot got downgraded to oneshot, finish with a final
+		 * CQE without IORING_CQE_F_MORE.
+		 */
+		req->flags &= ~REQ_F_APOLL_MULTISHOT;
 		io_req_task_submit(req, locked);
-	else
+	} else {
 		io_req_complete_failed(req, ret);
+	}
 }
 
 static void __io_poll_execute(struct io_kiocb *req, int mask)
@@ -5942,13 +7112,15 @@ static int io_arm_poll_handler(struct io_kiocb *req)
 	struct io_ring_ctx *ctx = req->ctx;
 	struct async_poll *apoll;
 	struct io_poll_table ipt;
-	__poll_t mask = EPOLLONESHOT | POLLERR | POLLPRI;
+	__poll_t mask = POLLERR | POLLPRI;
 	int ret;
 
 	if (!req->file || !file_can_poll(req->file))
 		return IO_APOLL_ABORTED;
 	if (!def->pollin && !def->pollout)
 		return IO_APOLL_ABORTED;
+	if (!(req->flags & REQ_F_APOLL_MULTISHOT))
+		mask |= EPOLLONESHOT;
 
 	if (def->pollin) {
 		mask |= POLLIN | POLLRDNORM;
@@ -6700,6 +7872,20 @@ static int io_req_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 		return io_symlinkat_prep(req, sqe);
 	case IORING_OP_LINKAT:
 		return io_linkat_prep(req, sqe);
+	case IORING_OP_SEND_ZC:
+		return io_sendzc_prep(req, sqe);
+	case IORING_OP_URING_CMD:
+		return io_uring_cmd_prep(req, sqe);
+	case IORING_OP_FSETXATTR:
+		return io_fsetxattr_prep(req, sqe);
+	case IORING_OP_SETXATTR:
+		return io_setxattr_prep(req, sqe);
+	case IORING_OP_FGETXATTR:
+		return io_fgetxattr_prep(req, sqe);
+	case IORING_OP_GETXATTR:
+		return io_getxattr_prep(req, sqe);
+	case IORING_OP_SOCKET:
+		return io_socket_prep(req, sqe);
 	}
 
 	printk_once(KERN_WARNING "io_uring: unhandled opcode %d\n",
@@ -6727,6 +7913,8 @@ static int io_req_prep_async(struct io_kiocb *req)
 		return io_recvmsg_prep_async(req);
 	case IORING_OP_CONNECT:
 		return io_connect_prep_async(req);
+	case IORING_OP_URING_CMD:
+		return io_uring_cmd_prep_async(req);
 	}
 	printk_once(KERN_WARNING "io_uring: prep_async() bad opcode %d\n",
 		    req->opcode);
@@ -6825,11 +8013,13 @@ static void io_clean_op(struct io_kiocb *req)
 		case IORING_OP_READV:
 		case IORING_OP_READ_FIXED:
 		case IORING_OP_READ:
-			kfree((void *)(unsigned long)req->rw.addr);
+			if (!(req->flags & REQ_F_BUFFER_RING))
+				kfree((void *)(unsigned long)req->rw.addr);
 			break;
 		case IORING_OP_RECVMSG:
 		case IORING_OP_RECV:
-			kfree(req->sr_msg.kbuf);
+			if (!(req->flags & REQ_F_BUFFER_RING))
+				kfree(req->sr_msg.kbuf);
 			break;
 		}
 	}
@@ -6877,6 +8067,15 @@ static void io_clean_op(struct io_kiocb *req)
 			putname(req->hardlink.oldpath);
 			putname(req->hardlink.newpath);
 			break;
+		case IORING_OP_SEND_ZC:
+			io_notif_release(req->sendzc.notif);
+			break;
+		case IORING_OP_FSETXATTR:
+		case IORING_OP_SETXATTR:
+		case IORING_OP_FGETXATTR:
+		case IORING_OP_GETXATTR:
+			__io_xattr_finish(req);
+			break;
 		}
 	}
 	if ((req->flags & REQ_F_POLLED) && req->apoll) {
@@ -6904,6 +8103,12 @@ static int io_issue_sqe(struct io_kiocb *req, unsigned int issue_flags)
 	if ((req->flags & REQ_F_CREDS) && req->creds != current_cred())
 		creds = override_creds(req->creds);
 
+	/* reissues restart the latency clock as well */
+	if (ctx->flags & IORING_SETUP_HYBRID_IOPOLL) {
+		req->flags &= ~REQ_F_IOPOLL_STATE;
+		req->iopoll_start = ktime_get_ns();
+	}
+
 	switch (req->opcode) {
 	case IORING_OP_NOP:
 		ret = io_nop(req, issue_flags);
@@ -7014,6 +8219,27 @@ static int io_issue_sqe(struct io_kiocb *req, unsigned int issue_flags)
 	case IORING_OP_LINKAT:
 		ret = io_linkat(req, issue_flags);
 		break;
+	case IORING_OP_SEND_ZC:
+		ret = io_sendzc(req, issue_flags);
+		break;
+	case IORING_OP_URING_CMD:
+		ret = io_uring_cmd(req, issue_flags);
+		break;
+	case IORING_OP_FSETXATTR:
+		ret = io_fsetxattr(req, issue_flags);
+		break;
+	case IORING_OP_SETXATTR:
+		ret = io_setxattr(req, issue_flags);
+		break;
+	case IORING_OP_FGETXATTR:
+		ret = io_fgetxattr(req, issue_flags);
+		break;
+	case IORING_OP_GETXATTR:
+		ret = io_getxattr(req, issue_flags);
+		break;
+	case IORING_OP_SOCKET:
+		ret = io_socket(req, issue_flags);
+		break;
 	default:
 		ret = -EINVAL;
 		break;
@@ -7369,7 +8595,7 @@ static int io_init_req(struct io_ring_ctx *ctx, struct io_kiocb *req,
 	 */
 	if (!state->plug_started && state->ios_left > 1 &&
 	    io_op_defs[req->opcode].plug) {
-		blk_start_plug(&state->plug);
+		blk_start_plug_nr_ios(&state->plug, state->ios_left);
 		state->plug_started = true;
 	}
 
@@ -7527,8 +8753,12 @@ static const struct io_uring_sqe *io_get_sqe(struct io_ring_ctx *ctx)
 	 *    though the application is the one updating it.
 	 */
 	head = READ_ONCE(ctx->sq_array[sq_idx]);
-	if (likely(head < ctx->sq_entries))
+	if (likely(head < ctx->sq_entries)) {
+		/* double index for 128-byte SQEs, twice as long */
+		if (ctx->flags & IORING_SETUP_SQE128)
+			head <<= 1;
 		return &ctx->sq_sqes[head];
+	}
 
 	/* drop invalid entries */
 	ctx->cq_extra--;
@@ -7788,7 +9018,8 @@ static int io_wake_function(struct wait_queue_entry *curr, unsigned int mode,
 	 * Cannot safely flush overflowed CQEs from here, ensure we wake up
 	 * the task, and the next invocation will do it.
 	 */
-	if (io_should_wake(iowq) || test_bit(0, &iowq->ctx->check_cq_overflow))
+	if (io_should_wake(iowq) || test_bit(0, &iowq->ctx->check_cq_overflow) ||
+	    !llist_empty(&iowq->ctx->work_llist))
 		return autoremove_wake_function(curr, mode, wake_flags, key);
 	return -1;
 }
@@ -7820,6 +9051,9 @@ static inline int io_cqring_wait_schedule(struct io_ring_ctx *ctx,
 {
 	int io_wait, ret;
 
+	/* deferred completions may be all we're waiting for */
+	if (!llist_empty(&ctx->work_llist))
+		return 1;
 	/* make sure we run task_work before checking for signals */
 	ret = io_run_task_work_sig();
 	if (ret || io_should_wake(iowq))
@@ -7857,6 +9091,8 @@ static int io_cqring_wait(struct io_ring_ctx *ctx, int min_events,
 	int ret;
 
 	do {
+		if (ctx->flags & IORING_SETUP_DEFER_TASKRUN)
+			io_run_local_work(ctx);
 		io_cqring_overflow_flush(ctx);
 		if (io_cqring_events(ctx) >= min_events)
 			return 0;
@@ -7894,6 +9130,8 @@ static int io_cqring_wait(struct io_ring_ctx *ctx, int min_events,
 
 	trace_io_uring_cqring_wait(ctx, min_events);
 	do {
+		if (ctx->flags & IORING_SETUP_DEFER_TASKRUN)
+			io_run_local_work(ctx);
 		/* if we can't even flush overflow, don't wait for more */
 		if (!io_cqring_overflow_flush(ctx)) {
 			ret = -EBUSY;
@@ -9084,13 +10322,18 @@ static void *io_mem_alloc(size_t size)
 	return (void *) __get_free_pages(gfp, get_order(size));
 }
 
-static unsigned long rings_size(unsigned sq_entries, unsigned cq_entries,
-				size_t *sq_offset)
+static unsigned long rings_size(struct io_ring_ctx *ctx, unsigned int sq_entries,
+				unsigned int cq_entries, size_t *sq_offset)
 {
 	struct io_rings *rings;
 	size_t off, sq_array_size;
 
 	off = struct_size(rings, cqes, cq_entries);
+	if (ctx->flags & IORING_SETUP_CQE32) {
+		if (check_shl_overflow(off, 1, &off))
+			return SIZE_MAX;
+	}
+
 	if (off == SIZE_MAX)
 		return SIZE_MAX;
 
@@ -9539,13 +10782,26 @@ static int io_eventfd_unregister(struct io_ring_ctx *ctx)
 	return -ENXIO;
 }
 
+static void io_free_buf_ring(struct io_buffer_ring *br)
+{
+	unpin_user_pages(br->buf_pages, br->buf_nr_pages);
+	kvfree(br->buf_pages);
+	kfree(br);
+}
+
 static void io_destroy_buffers(struct io_ring_ctx *ctx)
 {
+	struct io_buffer_ring *br;
 	struct io_buffer *buf;
 	unsigned long index;
 
 	xa_for_each(&ctx->io_buffers, index, buf)
 		__io_remove_buffers(ctx, buf, index, -1U);
+	xa_for_each(&ctx->io_buf_rings, index, br) {
+		xa_erase(&ctx->io_buf_rings, index);
+		io_free_buf_ring(br);
+	}
+	xa_destroy(&ctx->io_buf_rings);
 }
 
 static void io_req_cache_free(struct list_head *list)
@@ -9627,6 +10883,8 @@ static void io_ring_ctx_free(struct io_ring_ctx *ctx)
 	io_mem_free(ctx->rings);
 	io_mem_free(ctx->sq_sqes);
 
+	if (ctx->submitter_task)
+		put_task_struct(ctx->submitter_task);
 	percpu_ref_exit(&ctx->refs);
 	free_uid(ctx->user);
 	io_req_caches_free(ctx);
@@ -9664,7 +10922,8 @@ static __poll_t io_uring_poll(struct file *file, poll_table *wait)
 	 * Users may get EPOLLIN meanwhile seeing nothing in cqring, this
 	 * pushs them to do the flush.
 	 */
-	if (io_cqring_events(ctx) || test_bit(0, &ctx->check_cq_overflow))
+	if (io_cqring_events(ctx) || test_bit(0, &ctx->check_cq_overflow) ||
+	    !llist_empty(&ctx->work_llist))
 		mask |= EPOLLIN | EPOLLRDNORM;
 
 	return mask;
@@ -9962,6 +11221,12 @@ static void io_uring_try_cancel_requests(struct io_ring_ctx *ctx,
 		ret |= io_cancel_defer_files(ctx, task, cancel_all);
 		ret |= io_poll_remove_all(ctx, task, cancel_all);
 		ret |= io_kill_timeouts(ctx, task, cancel_all);
+		if (ctx->flags & IORING_SETUP_DEFER_TASKRUN) {
+			if (current == ctx->submitter_task)
+				ret |= io_run_local_work(ctx) > 0;
+			else
+				ret |= io_move_task_work_from_local(ctx);
+		}
 		if (task)
 			ret |= io_run_task_work();
 		if (!ret)
@@ -10051,6 +11316,143 @@ static void io_uring_del_tctx_node(unsigned long index)
 	kfree(node);
 }
 
+static int io_ring_add_registered_fd(struct io_uring_task *tctx, int fd,
+				     int start, int end)
+{
+	struct file *file;
+	int offset;
+
+	for (offset = start; offset < end; offset++) {
+		offset = array_index_nospec(offset, IO_RINGFD_REG_MAX);
+		if (tctx->registered_rings[offset])
+			continue;
+
+		file = fget(fd);
+		if (!file)
+			return -EBADF;
+		if (file->f_op != &io_uring_fops) {
+			fput(file);
+			return -EOPNOTSUPP;
+		}
+		tctx->registered_rings[offset] = file;
+		return offset;
+	}
+
+	return -EBUSY;
+}
+
+/*
+ * Register a ring fd to avoid fdget/fdput for each io_uring_enter()
+ * invocation. User passes in an array of struct io_uring_rsrc_update
+ * with ->data set to the ring_fd, and ->offset given for the desired
+ * index. If no index is desired, application may set ->offset == -1U
+ * and we'll find an available index. Returns number of entries
+ * successfully processed, or < 0 on error if none were processed.
+ */
+static int io_ringfd_register(struct io_ring_ctx *ctx, void __user *__arg,
+			      unsigned nr_args)
+{
+	struct io_uring_rsrc_update __user *arg = __arg;
+	struct io_uring_rsrc_update reg;
+	struct io_uring_task *tctx;
+	int ret, i;
+
+	if (!nr_args || nr_args > IO_RINGFD_REG_MAX)
+		return -EINVAL;
+
+	mutex_unlock(&ctx->uring_lock);
+	ret = io_uring_add_tctx_node(ctx);
+	mutex_lock(&ctx->uring_lock);
+	if (ret)
+		return ret;
+
+	tctx = current->io_uring;
+	for (i = 0; i < nr_args; i++) {
+		int start, end;
+
+		if (copy_from_user(&reg, &arg[i], sizeof(reg))) {
+			ret = -EFAULT;
+			break;
+		}
+		if (reg.resv) {
+			ret = -EINVAL;
+			break;
+		}
+
+		if (reg.offset == -1U) {
+			start = 0;
+			end = IO_RINGFD_REG_MAX;
+		} else {
+			if (reg.offset >= IO_RINGFD_REG_MAX) {
+				ret = -EINVAL;
+				break;
+			}
+			start = reg.offset;
+			end = start + 1;
+		}
+
+		ret = io_ring_add_registered_fd(tctx, reg.data, start, end);
+		if (ret < 0)
+			break;
+
+		reg.offset = ret;
+		if (copy_to_user(&arg[i], &reg, sizeof(reg))) {
+			fput(tctx->registered_rings[reg.offset]);
+			tctx->registered_rings[reg.offset] = NULL;
+			ret = -EFAULT;
+			break;
+		}
+	}
+
+	return i ? i : ret;
+}
+
+static int io_ringfd_unregister(struct io_ring_ctx *ctx, void __user *__arg,
+				unsigned nr_args)
+{
+	struct io_uring_rsrc_update __user *arg = __arg;
+	struct io_uring_task *tctx = current->io_uring;
+	struct io_uring_rsrc_update reg;
+	int ret = 0, i;
+
+	if (!nr_args || nr_args > IO_RINGFD_REG_MAX)
+		return -EINVAL;
+	if (!tctx)
+		return 0;
+
+	for (i = 0; i < nr_args; i++) {
+		if (copy_from_user(&reg, &arg[i], sizeof(reg))) {
+			ret = -EFAULT;
+			break;
+		}
+		if (reg.resv || reg.data || reg.offset >= IO_RINGFD_REG_MAX) {
+			ret = -EINVAL;
+			break;
+		}
+
+		reg.offset = array_index_nospec(reg.offset, IO_RINGFD_REG_MAX);
+		if (tctx->registered_rings[reg.offset]) {
+			fput(tctx->registered_rings[reg.offset]);
+			tctx->registered_rings[reg.offset] = NULL;
+		}
+	}
+
+	return i ? i : ret;
+}
+
+static void io_uring_unreg_ringfd(void)
+{
+	struct io_uring_task *tctx = current->io_uring;
+	int i;
+
+	for (i = 0; i < IO_RINGFD_REG_MAX; i++) {
+		if (tctx->registered_rings[i]) {
+			fput(tctx->registered_rings[i]);
+			tctx->registered_rings[i] = NULL;
+		}
+	}
+}
+
 static void io_uring_clean_tctx(struct io_uring_task *tctx)
 {
 	struct io_wq *wq = tctx->io_wq;
@@ -10149,6 +11551,7 @@ static void io_uring_cancel_generic(bool cancel_all, struct io_sq_data *sqd)
 
 void __io_uring_cancel(bool cancel_all)
 {
+	io_uring_unreg_ringfd();
 	io_uring_cancel_generic(cancel_all, NULL);
 }
 
@@ -10284,10 +11687,26 @@ SYSCALL_DEFINE6(io_uring_enter, unsigned int, fd, u32, to_submit,
 	io_run_task_work();
 
 	if (unlikely(flags & ~(IORING_ENTER_GETEVENTS | IORING_ENTER_SQ_WAKEUP |
-			       IORING_ENTER_SQ_WAIT | IORING_ENTER_EXT_ARG)))
+			       IORING_ENTER_SQ_WAIT | IORING_ENTER_EXT_ARG |
+			       IORING_ENTER_REGISTERED_RING)))
 		return -EINVAL;
 
-	f = fdget(fd);
+	/*
+	 * Ring fd has been registered via IORING_REGISTER_RING_FDS, we
+	 * need only dereference our task private array to find it.
+	 */
+	if (flags & IORING_ENTER_REGISTERED_RING) {
+		struct io_uring_task *tctx = current->io_uring;
+
+		if (!tctx || fd >= IO_RINGFD_REG_MAX)
+			return -EINVAL;
+		fd = array_index_nospec(fd, IO_RINGFD_REG_MAX);
+		/* the task holds a reference, fdput() below is a no-op */
+		f.file = tctx->registered_rings[fd];
+		f.flags = 0;
+	} else {
+		f = fdget(fd);
+	}
 	if (unlikely(!f.file))
 		return -EBADF;
 
@@ -10304,6 +11723,11 @@ SYSCALL_DEFINE6(io_uring_enter, unsigned int, fd, u32, to_submit,
 	if (unlikely(ctx->flags & IORING_SETUP_R_DISABLED))
 		goto out;
 
+	ret = -EEXIST;
+	if (unlikely((ctx->flags & IORING_SETUP_DEFER_TASKRUN) &&
+		     ctx->submitter_task != current))
+		goto out;
+
 	/*
 	 * For SQ polling, the thread will do all submissions and completions.
 	 * Just return the requested submit count, and wake the thread if
@@ -10446,6 +11870,33 @@ static void __io_uring_show_fdinfo(struct io_ring_ctx *ctx, struct seq_file *m)
 		xa_for_each(&ctx->personalities, index, cred)
 			io_uring_show_cred(m, index, cred);
 	}
+	if (has_lock && !list_empty(&ctx->tctx_list)) {
+		struct io_tctx_node *node;
+
+		seq_printf(m, "IoWq:\n");
+		list_for_each_entry(node, &ctx->tctx_list, ctx_node) {
+			struct io_uring_task *tctx = node->task->io_uring;
+			int nid;
+
+			if (!tctx || !tctx->io_wq)
+				continue;
+			for_each_node(nid) {
+				struct io_wq_node_stats st;
+
+				io_wq_node_stats(tctx->io_wq, nid, &st);
+				if (!st.workers_created && !st.hash_stalls)
+					continue;
+				seq_printf(m, "  task=%d node=%d bound=%u/%u unbound=%u/%u created=%lu exited=%lu hash_stalls=%lu hash_stall_ns=%llu\n",
+					   task_pid_nr(node->task), nid,
+					   st.nr_workers[IO_WQ_BOUND],
+					   st.max_workers[IO_WQ_BOUND],
+					   st.nr_workers[IO_WQ_UNBOUND],
+					   st.max_workers[IO_WQ_UNBOUND],
+					   st.workers_created, st.workers_exited,
+					   st.hash_stalls, st.hash_stall_ns);
+			}
+		}
+	}
 	seq_printf(m, "PollList:\n");
 	spin_lock(&ctx->completion_lock);
 	for (i = 0; i < (1U << ctx->cancel_hash_bits); i++) {
@@ -10495,7 +11946,7 @@ static int io_allocate_scq_urings(struct io_ring_ctx *ctx,
 	ctx->sq_entries = p->sq_entries;
 	ctx->cq_entries = p->cq_entries;
 
-	size = rings_size(p->sq_entries, p->cq_entries, &sq_array_offset);
+	size = rings_size(ctx, p->sq_entries, p->cq_entries, &sq_array_offset);
 	if (size == SIZE_MAX)
 		return -EOVERFLOW;
 
@@ -10510,7 +11961,10 @@ static int io_allocate_scq_urings(struct io_ring_ctx *ctx,
 	rings->sq_ring_entries = p->sq_entries;
 	rings->cq_ring_entries = p->cq_entries;
 
-	size = array_size(sizeof(struct io_uring_sqe), p->sq_entries);
+	if (p->flags & IORING_SETUP_SQE128)
+		size = array_size(2 * sizeof(struct io_uring_sqe), p->sq_entries);
+	else
+		size = array_size(sizeof(struct io_uring_sqe), p->sq_entries);
 	if (size == SIZE_MAX) {
 		io_mem_free(ctx->rings);
 		ctx->rings = NULL;
@@ -10619,9 +12073,20 @@ static int io_uring_create(unsigned entries, struct io_uring_params *p,
 		p->cq_entries = 2 * p->sq_entries;
 	}
 
+	if ((p->flags & IORING_SETUP_HYBRID_IOPOLL) &&
+	    !(p->flags & IORING_SETUP_IOPOLL))
+		return -EINVAL;
+
+	/* deferred task_work is run by the submitter, not the SQPOLL thread */
+	if ((p->flags & IORING_SETUP_DEFER_TASKRUN) &&
+	    (p->flags & IORING_SETUP_SQPOLL))
+		return -EINVAL;
+
 	ctx = io_ring_ctx_alloc(p);
 	if (!ctx)
 		return -ENOMEM;
+	if (ctx->flags & IORING_SETUP_DEFER_TASKRUN)
+		ctx->submitter_task = get_task_struct(current);
 	ctx->compat = in_compat_syscall();
 	if (!ns_capable_noaudit(&init_user_ns, CAP_IPC_LOCK))
 		ctx->user = get_uid(current_user());
@@ -10722,7 +12187,9 @@ static long io_uring_setup(u32 entries, struct io_uring_params __user *params)
 	if (p.flags & ~(IORING_SETUP_IOPOLL | IORING_SETUP_SQPOLL |
 			IORING_SETUP_SQ_AFF | IORING_SETUP_CQSIZE |
 			IORING_SETUP_CLAMP | IORING_SETUP_ATTACH_WQ |
-			IORING_SETUP_R_DISABLED))
+			IORING_SETUP_R_DISABLED | IORING_SETUP_SQE128 |
+			IORING_SETUP_CQE32 | IORING_SETUP_DEFER_TASKRUN |
+			IORING_SETUP_HYBRID_IOPOLL))
 		return -EINVAL;
 
 	return  io_uring_create(entries, &p, params);
@@ -11080,6 +12547,19 @@ static int io_register_iowq_max_workers(struct io_ring_ctx *ctx,
 	return ret;
 }
 
+static int io_register_iowq_placement(struct io_ring_ctx *ctx,
+				      void __user *arg)
+{
+	u32 mode;
+
+	if (copy_from_user(&mode, arg, sizeof(mode)))
+		return -EFAULT;
+	if (mode > IORING_IOWQ_PLACE_DEVICE)
+		return -EINVAL;
+	WRITE_ONCE(ctx->iowq_placement, mode);
+	return 0;
+}
+
 static bool io_register_op_must_quiesce(int op)
 {
 	switch (op) {
@@ -11098,6 +12578,11 @@ static bool io_register_op_must_quiesce(int op)
 	case IORING_REGISTER_IOWQ_AFF:
 	case IORING_UNREGISTER_IOWQ_AFF:
 	case IORING_REGISTER_IOWQ_MAX_WORKERS:
+	case IORING_REGISTER_PBUF_RING:
+	case IORING_UNREGISTER_PBUF_RING:
+	case IORING_REGISTER_RING_FDS:
+	case IORING_UNREGISTER_RING_FDS:
+	case IORING_REGISTER_IOWQ_PLACEMENT:
 		return false;
 	default:
 		return true;
@@ -11131,6 +12616,81 @@ static int io_ctx_quiesce(struct io_ring_ctx *ctx)
 	return ret;
 }
 
+static int io_register_pbuf_ring(struct io_ring_ctx *ctx, void __user *arg)
+{
+	struct io_uring_buf_reg reg;
+	struct io_buffer_ring *br;
+	struct page **pages;
+	unsigned long size;
+	int nr_pages, pret, ret;
+
+	if (copy_from_user(&reg, arg, sizeof(reg)))
+		return -EFAULT;
+	if (reg.pad || reg.resv[0] || reg.resv[1] || reg.resv[2])
+		return -EINVAL;
+	if (!reg.ring_addr || (reg.ring_addr & ~PAGE_MASK))
+		return -EINVAL;
+	if (!is_power_of_2(reg.ring_entries) || reg.ring_entries > 32768)
+		return -EINVAL;
+	if (xa_load(&ctx->io_buffers, reg.bgid) ||
+	    xa_load(&ctx->io_buf_rings, reg.bgid))
+		return -EEXIST;
+
+	size = reg.ring_entries * sizeof(struct io_uring_buf);
+	nr_pages = (size + PAGE_SIZE - 1) >> PAGE_SHIFT;
+
+	br = kzalloc(sizeof(*br), GFP_KERNEL_ACCOUNT);
+	if (!br)
+		return -ENOMEM;
+	pages = kvmalloc_array(nr_pages, sizeof(struct page *), GFP_KERNEL);
+	if (!pages) {
+		kfree(br);
+		return -ENOMEM;
+	}
+
+	mmap_read_lock(current->mm);
+	pret = pin_user_pages(reg.ring_addr, nr_pages,
+			      FOLL_WRITE | FOLL_LONGTERM, pages, NULL);
+	mmap_read_unlock(current->mm);
+	if (pret != nr_pages) {
+		if (pret > 0)
+			unpin_user_pages(pages, pret);
+		ret = pret < 0 ? pret : -EFAULT;
+		goto err;
+	}
+
+	br->buf_ring = page_address(pages[0]);
+	br->buf_pages = pages;
+	br->buf_nr_pages = nr_pages;
+	br->mask = reg.ring_entries - 1;
+
+	ret = xa_insert(&ctx->io_buf_rings, reg.bgid, br, GFP_KERNEL_ACCOUNT);
+	if (!ret)
+		return 0;
+	unpin_user_pages(pages, nr_pages);
+err:
+	kvfree(pages);
+	kfree(br);
+	return ret;
+}
+
+static int io_unregister_pbuf_ring(struct io_ring_ctx *ctx, void __user *arg)
+{
+	struct io_uring_buf_reg reg;
+	struct io_buffer_ring *br;
+
+	if (copy_from_user(&reg, arg, sizeof(reg)))
+		return -EFAULT;
+	if (reg.pad || reg.resv[0] || reg.resv[1] || reg.resv[2])
+		return -EINVAL;
+
+	br = xa_erase(&ctx->io_buf_rings, reg.bgid);
+	if (!br)
+		return -ENOENT;
+	io_free_buf_ring(br);
+	return 0;
+}
+
 static int __io_uring_register(struct io_ring_ctx *ctx, unsigned opcode,
 			       void __user *arg, unsigned nr_args)
 	__releases(ctx->uring_lock)
@@ -11258,6 +12818,30 @@ static int __io_uring_register(struct io_ring_ctx *ctx, unsigned opcode,
 			break;
 		ret = io_register_iowq_max_workers(ctx, arg);
 		break;
+	case IORING_REGISTER_PBUF_RING:
+		ret = -EINVAL;
+		if (!arg || nr_args != 1)
+			break;
+		ret = io_register_pbuf_ring(ctx, arg);
+		break;
+	case IORING_UNREGISTER_PBUF_RING:
+		ret = -EINVAL;
+		if (!arg || nr_args != 1)
+			break;
+		ret = io_unregister_pbuf_ring(ctx, arg);
+		break;
+	case IORING_REGISTER_RING_FDS:
+		ret = io_ringfd_register(ctx, arg, nr_args);
+		break;
+	case IORING_UNREGISTER_RING_FDS:
+		ret = io_ringfd_unregister(ctx, arg, nr_args);
+		break;
+	case IORING_REGISTER_IOWQ_PLACEMENT:
+		ret = -EINVAL;
+		if (!arg || nr_args != 1)
+			break;
+		ret = io_register_iowq_placement(ctx, arg);
+		break;
 	default:
 		ret = -EINVAL;
 		break;
@@ -11313,12 +12897,14 @@ static int __init io_uring_init(void)
 #define BUILD_BUG_SQE_ELEM(eoffset, etype, ename) \
 	__BUILD_BUG_VERIFY_ELEMENT(struct io_uring_sqe, eoffset, etype, ename)
 	BUILD_BUG_ON(sizeof(struct io_uring_sqe) != 64);
+	BUILD_BUG_ON(sizeof(struct io_uring_cmd) > 64);
 	BUILD_BUG_SQE_ELEM(0,  __u8,   opcode);
 	BUILD_BUG_SQE_ELEM(1,  __u8,   flags);
 	BUILD_BUG_SQE_ELEM(2,  __u16,  ioprio);
 	BUILD_BUG_SQE_ELEM(4,  __s32,  fd);
 	BUILD_BUG_SQE_ELEM(8,  __u64,  off);
 	BUILD_BUG_SQE_ELEM(8,  __u64,  addr2);
+	BUILD_BUG_SQE_ELEM(8,  __u32,  cmd_op);
 	BUILD_BUG_SQE_ELEM(16, __u64,  addr);
 	BUILD_BUG_SQE_ELEM(16, __u64,  splice_off_in);
 	BUILD_BUG_SQE_ELEM(24, __u32,  len);
@@ -11337,12 +12923,14 @@ static int __init io_uring_init(void)
 	BUILD_BUG_SQE_ELEM(28, __u32,  statx_flags);
 	BUILD_BUG_SQE_ELEM(28, __u32,  fadvise_advice);
 	BUILD_BUG_SQE_ELEM(28, __u32,  splice_flags);
+	BUILD_BUG_SQE_ELEM(28, __u32,  xattr_flags);
 	BUILD_BUG_SQE_ELEM(32, __u64,  user_data);
 	BUILD_BUG_SQE_ELEM(40, __u16,  buf_index);
 	BUILD_BUG_SQE_ELEM(40, __u16,  buf_group);
 	BUILD_BUG_SQE_ELEM(42, __u16,  personality);
 	BUILD_BUG_SQE_ELEM(44, __s32,  splice_fd_in);
 	BUILD_BUG_SQE_ELEM(44, __u32,  file_index);
+	BUILD_BUG_SQE_ELEM(48, __u64,  addr3);
 
 	BUILD_BUG_ON(sizeof(struct io_uring_files_update) !=
 		     sizeof(struct io_uring_rsrc_update));
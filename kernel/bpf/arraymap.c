@@ -687,6 +687,166 @@ static int bpf_for_each_array_elem(struct bpf_map *map, void *callback_fn,
 	return num_elems;
 }
 
+/* Read one CPU's copy of a per-cpu element a long at a time. With @reset
+ * each word is exchanged with zero. Only updates done with atomic adds are
+ * either returned now or kept for the next read; a plain increment racing
+ * with the exchange may be lost or counted twice. On 32-bit, u64 counters
+ * are read a half at a time and can tear while they are being updated.
+ */
+static void percpu_array_read_cpu(unsigned long *dst, unsigned long *src,
+				  u32 size, bool reset)
+{
+	u32 i;
+
+	for (i = 0; i < size / sizeof(long); i++)
+		dst[i] = reset ? xchg(&src[i], 0) : READ_ONCE(src[i]);
+}
+
+#define BPF_F_PERCPU_REDUCE	(BPF_F_PERCPU_SUM | BPF_F_PERCPU_MIN | \
+				 BPF_F_PERCPU_MAX)
+
+/* Fold one CPU's counters @src into @dst as requested by @reduce */
+static void percpu_array_reduce(u64 *dst, const u64 *src, u32 size,
+				u64 reduce)
+{
+	u32 i;
+
+	for (i = 0; i < size / sizeof(u64); i++) {
+		switch (reduce) {
+		case BPF_F_PERCPU_SUM:
+			dst[i] += src[i];
+			break;
+		case BPF_F_PERCPU_MIN:
+			dst[i] = min(dst[i], src[i]);
+			break;
+		case BPF_F_PERCPU_MAX:
+			dst[i] = max(dst[i], src[i]);
+			break;
+		}
+	}
+}
+
+static int
+__percpu_array_map_lookup_batch(struct bpf_map *map,
+				const union bpf_attr *attr,
+				union bpf_attr __user *uattr,
+				bool do_delete)
+{
+	struct bpf_array *array = container_of(map, struct bpf_array, map);
+	void __user *uobatch = u64_to_user_ptr(attr->batch.out_batch);
+	void __user *ubatch = u64_to_user_ptr(attr->batch.in_batch);
+	void __user *values = u64_to_user_ptr(attr->batch.values);
+	void __user *keys = u64_to_user_ptr(attr->batch.keys);
+	u64 elem_flags = attr->batch.elem_flags;
+	u64 reduce = elem_flags & BPF_F_PERCPU_REDUCE;
+	u32 index, cp, max_count, size, value_size;
+	void __percpu *pptr;
+	void *value, *cpu_buf;
+	int cpu, off, err = 0;
+	bool first;
+
+	if (elem_flags & ~BPF_F_PERCPU_REDUCE || attr->batch.flags)
+		return -EINVAL;
+
+	/* At most one reduction, which treats values as u64 counters */
+	if (reduce && (hweight64(reduce) > 1 ||
+		       !IS_ALIGNED(map->value_size, sizeof(u64))))
+		return -EINVAL;
+
+	max_count = attr->batch.count;
+	if (!max_count)
+		return 0;
+
+	if (put_user(0, &uattr->batch.count))
+		return -EFAULT;
+
+	index = 0;
+	if (ubatch) {
+		if (copy_from_user(&index, ubatch, sizeof(index)))
+			return -EFAULT;
+		/* in_batch is the last index returned by the previous call */
+		if (index >= map->max_entries - 1)
+			return -ENOENT;
+		index++;
+	}
+
+	/* per_cpu areas are rounded up to 8 bytes and zero-filled, see
+	 * bpf_percpu_array_copy()
+	 */
+	size = round_up(map->value_size, 8);
+	value_size = reduce ? size : size * num_possible_cpus();
+
+	value = kvmalloc(value_size + size, GFP_USER | __GFP_NOWARN);
+	if (!value)
+		return -ENOMEM;
+	cpu_buf = value + value_size;
+
+	for (cp = 0; cp < max_count; cp++, index++) {
+		if (index >= map->max_entries) {
+			err = -ENOENT;
+			break;
+		}
+
+		pptr = array->pptrs[index & array->index_mask];
+		off = 0;
+		first = true;
+		for_each_possible_cpu(cpu) {
+			if (!reduce) {
+				percpu_array_read_cpu(value + off,
+						      per_cpu_ptr(pptr, cpu),
+						      size, do_delete);
+				off += size;
+				continue;
+			}
+			if (first) {
+				percpu_array_read_cpu(value,
+						      per_cpu_ptr(pptr, cpu),
+						      size, do_delete);
+				first = false;
+				continue;
+			}
+			percpu_array_read_cpu(cpu_buf, per_cpu_ptr(pptr, cpu),
+					      size, do_delete);
+			percpu_array_reduce(value, cpu_buf, size, reduce);
+		}
+
+		if (copy_to_user(keys + cp * map->key_size, &index,
+				 sizeof(index)) ||
+		    copy_to_user(values + cp * value_size, value, value_size)) {
+			err = -EFAULT;
+			goto free_value;
+		}
+		cond_resched();
+	}
+
+	/* out_batch is the last index returned */
+	index--;
+	if (copy_to_user(&uattr->batch.count, &cp, sizeof(cp)) ||
+	    (cp && copy_to_user(uobatch, &index, sizeof(index))))
+		err = -EFAULT;
+
+free_value:
+	kvfree(value);
+	return err;
+}
+
+static int percpu_array_map_lookup_batch(struct bpf_map *map,
+					 const union bpf_attr *attr,
+					 union bpf_attr __user *uattr)
+{
+	return __percpu_array_map_lookup_batch(map, attr, uattr, false);
+}
+
+/* Array elements can't be removed, so "delete" resets the counters of
+ * every returned element to zero on all CPUs.
+ */
+static int percpu_array_map_lookup_and_delete_batch(struct bpf_map *map,
+						    const union bpf_attr *attr,
+						    union bpf_attr __user *uattr)
+{
+	return __percpu_array_map_lookup_batch(map, attr, uattr, true);
+}
+
 static int array_map_btf_id;
 const struct bpf_map_ops array_map_ops = {
 	.map_meta_equal = array_map_meta_equal,
@@ -725,7 +885,8 @@ const struct bpf_map_ops percpu_array_map_ops = {
 	.map_delete_elem = array_map_delete_elem,
 	.map_seq_show_elem = percpu_array_map_seq_show_elem,
 	.map_check_btf = array_map_check_btf,
-	.map_lookup_batch = generic_map_lookup_batch,
+	.map_lookup_batch = percpu_array_map_lookup_batch,
+	.map_lookup_and_delete_batch = percpu_array_map_lookup_and_delete_batch,
 	.map_update_batch = generic_map_update_batch,
 	.map_set_for_each_callback_args = map_set_for_each_callback_args,
 	.map_for_each_callback = bpf_for_each_array_elem,
@@ -4,6 +4,7 @@
 #include <linux/cpumask.h>
 #include <linux/spinlock.h>
 #include <linux/percpu.h>
+#include <linux/slab.h>
 
 #include "bpf_lru_list.h"
 
@@ -13,6 +14,9 @@
 #define PERCPU_FREE_TARGET		(4)
 #define PERCPU_NR_SCANS			PERCPU_FREE_TARGET
 
+/* Number of consecutive CPUs sharing one LRU list of a common LRU */
+#define LRU_SHARD_NR_CPUS		(8)
+
 /* Helpers to get the local list index */
 #define LOCAL_LIST_IDX(t)	((t) - BPF_LOCAL_LIST_T_OFFSET)
 #define LOCAL_FREE_LIST_IDX	LOCAL_LIST_IDX(BPF_LRU_LOCAL_LIST_T_FREE)
@@ -27,6 +31,18 @@ static int get_next_cpu(int cpu)
 	return cpu;
 }
 
+/* The common LRU is sharded by groups of LRU_SHARD_NR_CPUS CPUs, so that
+ * refilling the local free lists does not bounce a single lock between all
+ * CPUs of a large machine. Nodes flushed from a local pending list always
+ * enter the shard of that CPU, hence a node sitting in a shard's lists
+ * belongs to the shard of node->cpu.
+ */
+static struct bpf_lru_list *bpf_common_lru_list(struct bpf_common_lru *clru,
+						int cpu)
+{
+	return &clru->lru_lists[cpu / LRU_SHARD_NR_CPUS];
+}
+
 /* Local list helpers */
 static struct list_head *local_free_list(struct bpf_lru_locallist *loc_l)
 {
@@ -315,33 +331,82 @@ static void bpf_lru_list_push_free(struct bpf_lru_list *l,
 	raw_spin_unlock_irqrestore(&l->lock, flags);
 }
 
-static void bpf_lru_list_pop_free_to_local(struct bpf_lru *lru,
-					   struct bpf_lru_locallist *loc_l)
+static unsigned int __bpf_lru_list_free_to_local(struct bpf_lru_list *l,
+						 struct bpf_lru_locallist *loc_l,
+						 unsigned int tgt_nfree)
 {
-	struct bpf_lru_list *l = &lru->common_lru.lru_list;
 	struct bpf_lru_node *node, *tmp_node;
 	unsigned int nfree = 0;
 
+	list_for_each_entry_safe(node, tmp_node, &l->lists[BPF_LRU_LIST_T_FREE],
+				 list) {
+		__bpf_lru_node_move_to_free(l, node, local_free_list(loc_l),
+					    BPF_LRU_LOCAL_LIST_T_FREE);
+		if (++nfree == tgt_nfree)
+			break;
+	}
+
+	return nfree;
+}
+
+static void bpf_lru_list_pop_free_to_local(struct bpf_lru *lru,
+					   struct bpf_lru_locallist *loc_l,
+					   int cpu)
+{
+	struct bpf_common_lru *clru = &lru->common_lru;
+	struct bpf_lru_list *l = bpf_common_lru_list(clru, cpu);
+	struct bpf_lru_list *other;
+	unsigned int nfree;
+	u32 i;
+
 	raw_spin_lock(&l->lock);
 
 	__local_list_flush(l, loc_l);
 
 	__bpf_lru_list_rotate(lru, l);
 
-	list_for_each_entry_safe(node, tmp_node, &l->lists[BPF_LRU_LIST_T_FREE],
-				 list) {
-		__bpf_lru_node_move_to_free(l, node, local_free_list(loc_l),
-					    BPF_LRU_LOCAL_LIST_T_FREE);
-		if (++nfree == LOCAL_FREE_TARGET)
-			break;
+	nfree = __bpf_lru_list_free_to_local(l, loc_l, LOCAL_FREE_TARGET);
+
+	raw_spin_unlock(&l->lock);
+
+	/* Like a single LRU list, use up the free nodes of all shards
+	 * before evicting anything. Only one shard lock is held at a time.
+	 */
+	for (i = 0; i < clru->nr_shards && nfree < LOCAL_FREE_TARGET; i++) {
+		other = &clru->lru_lists[i];
+		if (other == l ||
+		    list_empty(&other->lists[BPF_LRU_LIST_T_FREE]))
+			continue;
+
+		raw_spin_lock(&other->lock);
+		nfree += __bpf_lru_list_free_to_local(other, loc_l,
+						      LOCAL_FREE_TARGET - nfree);
+		raw_spin_unlock(&other->lock);
 	}
 
-	if (nfree < LOCAL_FREE_TARGET)
-		__bpf_lru_list_shrink(lru, l, LOCAL_FREE_TARGET - nfree,
-				      local_free_list(loc_l),
-				      BPF_LRU_LOCAL_LIST_T_FREE);
+	if (nfree == LOCAL_FREE_TARGET)
+		return;
 
+	raw_spin_lock(&l->lock);
+	nfree += __bpf_lru_list_shrink(lru, l, LOCAL_FREE_TARGET - nfree,
+				       local_free_list(loc_l),
+				       BPF_LRU_LOCAL_LIST_T_FREE);
 	raw_spin_unlock(&l->lock);
+
+	/* Approximate global eviction: only when this shard has nothing to
+	 * evict, take the victims from the other shards.
+	 */
+	for (i = 0; i < clru->nr_shards && !nfree; i++) {
+		other = &clru->lru_lists[i];
+		if (other == l)
+			continue;
+
+		raw_spin_lock(&other->lock);
+		nfree = __bpf_lru_list_shrink(lru, other, LOCAL_FREE_TARGET,
+					      local_free_list(loc_l),
+					      BPF_LRU_LOCAL_LIST_T_FREE);
+		raw_spin_unlock(&other->lock);
+	}
 }
 
 static void __local_list_add_pending(struct bpf_lru *lru,
@@ -444,7 +509,7 @@ static struct bpf_lru_node *bpf_common_lru_pop_free(struct bpf_lru *lru,
 
 	node = __local_list_pop_free(loc_l);
 	if (!node) {
-		bpf_lru_list_pop_free_to_local(lru, loc_l);
+		bpf_lru_list_pop_free_to_local(lru, loc_l, cpu);
 		node = __local_list_pop_free(loc_l);
 	}
 
@@ -457,7 +522,7 @@ static struct bpf_lru_node *bpf_common_lru_pop_free(struct bpf_lru *lru,
 		return node;
 
 	/* No free nodes found from the local free list and
-	 * the global LRU list.
+	 * the LRU lists of all shards.
 	 *
 	 * Steal from the local free/pending list of the
 	 * current CPU and remote CPU in RR.  It starts
@@ -530,7 +595,8 @@ static void bpf_common_lru_push_free(struct bpf_lru *lru,
 	}
 
 check_lru_list:
-	bpf_lru_list_push_free(&lru->common_lru.lru_list, node);
+	bpf_lru_list_push_free(bpf_common_lru_list(&lru->common_lru, node->cpu),
+			       node);
 }
 
 static void bpf_percpu_lru_push_free(struct bpf_lru *lru,
@@ -560,13 +626,21 @@ static void bpf_common_lru_populate(struct bpf_lru *lru, void *buf,
 				    u32 node_offset, u32 elem_size,
 				    u32 nr_elems)
 {
-	struct bpf_lru_list *l = &lru->common_lru.lru_list;
-	u32 i;
+	struct bpf_common_lru *clru = &lru->common_lru;
+	u32 i, shard, shard_entries;
+	struct bpf_lru_list *l;
+
+	/* Spread the nodes evenly, the remainder goes to the last shard */
+	shard_entries = max_t(u32, nr_elems / clru->nr_shards, 1);
 
 	for (i = 0; i < nr_elems; i++) {
 		struct bpf_lru_node *node;
 
+		shard = min(i / shard_entries, clru->nr_shards - 1);
+		l = &clru->lru_lists[shard];
+
 		node = (struct bpf_lru_node *)(buf + node_offset);
+		node->cpu = shard * LRU_SHARD_NR_CPUS;
 		node->type = BPF_LRU_LIST_T_FREE;
 		node->ref = 0;
 		list_add(&node->list, &l->lists[BPF_LRU_LIST_T_FREE]);
@@ -662,10 +736,20 @@ int bpf_lru_init(struct bpf_lru *lru, bool percpu, u32 hash_offset,
 		lru->nr_scans = PERCPU_NR_SCANS;
 	} else {
 		struct bpf_common_lru *clru = &lru->common_lru;
+		u32 i;
+
+		clru->nr_shards = DIV_ROUND_UP(nr_cpu_ids, LRU_SHARD_NR_CPUS);
+		clru->lru_lists = kcalloc(clru->nr_shards,
+					  sizeof(*clru->lru_lists),
+					  GFP_USER | __GFP_ACCOUNT);
+		if (!clru->lru_lists)
+			return -ENOMEM;
 
 		clru->local_list = alloc_percpu(struct bpf_lru_locallist);
-		if (!clru->local_list)
+		if (!clru->local_list) {
+			kfree(clru->lru_lists);
 			return -ENOMEM;
+		}
 
 		for_each_possible_cpu(cpu) {
 			struct bpf_lru_locallist *loc_l;
@@ -674,7 +758,8 @@ int bpf_lru_init(struct bpf_lru *lru, bool percpu, u32 hash_offset,
 			bpf_lru_locallist_init(loc_l, cpu);
 		}
 
-		bpf_lru_list_init(&clru->lru_list);
+		for (i = 0; i < clru->nr_shards; i++)
+			bpf_lru_list_init(&clru->lru_lists[i]);
 		lru->nr_scans = LOCAL_NR_SCANS;
 	}
 
@@ -688,8 +773,10 @@ int bpf_lru_init(struct bpf_lru *lru, bool percpu, u32 hash_offset,
 
 void bpf_lru_destroy(struct bpf_lru *lru)
 {
-	if (lru->percpu)
+	if (lru->percpu) {
 		free_percpu(lru->percpu_lru);
-	else
+	} else {
 		free_percpu(lru->common_lru.local_list);
+		kfree(lru->common_lru.lru_lists);
+	}
 }
@@ -43,8 +43,10 @@ struct bpf_lru_locallist {
 };
 
 struct bpf_common_lru {
-	struct bpf_lru_list lru_list;
+	/* One LRU list per group of CPUs, see bpf_common_lru_list() */
+	struct bpf_lru_list *lru_lists;
 	struct bpf_lru_locallist __percpu *local_list;
+	u32 nr_shards;
 };
 
 typedef bool (*del_from_htab_func)(void *arg, struct bpf_lru_node *node);
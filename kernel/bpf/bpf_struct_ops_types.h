@@ -6,4 +6,8 @@
 #include <net/tcp.h>
 BPF_STRUCT_OPS_TYPE(tcp_congestion_ops)
 #endif
+#ifdef CONFIG_SCHED_BPF_POLICY
+#include <linux/sched/bpf.h>
+BPF_STRUCT_OPS_TYPE(sched_policy_ops)
+#endif
 #endif
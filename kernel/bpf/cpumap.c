@@ -40,6 +40,8 @@
  */
 
 #define CPU_MAP_BULK_SIZE 8  /* 8 == one cacheline on 64-bit archs */
+#define CPUMAP_BATCH 8       /* default frames handled per kthread round */
+#define CPUMAP_BATCH_MAX 64
 struct bpf_cpu_map_entry;
 struct bpf_cpu_map;
 
@@ -67,6 +69,11 @@ struct bpf_cpu_map_entry {
 	struct bpf_cpumap_val value;
 	struct bpf_prog *prog;
 
+	/* Only used by the kthread: GRO context and the current batch */
+	struct napi_struct napi;
+	void *frames[CPUMAP_BATCH_MAX];
+	void *skbs[CPUMAP_BATCH_MAX];
+
 	atomic_t refcnt; /* Control when this struct can be free'ed */
 	struct rcu_head rcu;
 
@@ -94,7 +101,8 @@ static struct bpf_map *cpu_map_alloc(union bpf_attr *attr)
 	/* check sanity of attributes */
 	if (attr->max_entries == 0 || attr->key_size != 4 ||
 	    (value_size != offsetofend(struct bpf_cpumap_val, qsize) &&
-	     value_size != offsetofend(struct bpf_cpumap_val, bpf_prog.fd)) ||
+	     value_size != offsetofend(struct bpf_cpumap_val, bpf_prog.fd) &&
+	     value_size != sizeof(struct bpf_cpumap_val)) ||
 	    attr->map_flags & ~BPF_F_NUMA_NODE)
 		return ERR_PTR(-EINVAL);
 
@@ -276,8 +284,6 @@ static int cpu_map_bpf_prog_run_xdp(struct bpf_cpu_map_entry *rcpu,
 	return nframes;
 }
 
-#define CPUMAP_BATCH 8
-
 static int cpu_map_bpf_prog_run(struct bpf_cpu_map_entry *rcpu, void **frames,
 				int xdp_n, struct xdp_cpumap_stats *stats,
 				struct list_head *list)
@@ -302,9 +308,34 @@ static int cpu_map_bpf_prog_run(struct bpf_cpu_map_entry *rcpu, void **frames,
 	return nframes;
 }
 
+/* Pass the frames built on this CPU through GRO, so that redirected TCP
+ * flows are still aggregated before they reach the stack.
+ */
+static u64 cpu_map_gro_receive(struct bpf_cpu_map_entry *rcpu,
+			       struct list_head *listp)
+{
+	struct sk_buff *skb, *tmp;
+	u64 merged = 0;
+
+	list_for_each_entry_safe(skb, tmp, listp, list) {
+		skb_list_del_init(skb);
+		switch (napi_gro_receive(&rcpu->napi, skb)) {
+		case GRO_MERGED:
+		case GRO_MERGED_FREE:
+			merged++;
+			break;
+		default:
+			break;
+		}
+	}
+
+	return merged;
+}
+
 static int cpu_map_kthread_run(void *data)
 {
 	struct bpf_cpu_map_entry *rcpu = data;
+	u32 batch = rcpu->value.batch;
 
 	complete(&rcpu->kthread_running);
 	set_current_state(TASK_INTERRUPTIBLE);
@@ -318,10 +349,13 @@ static int cpu_map_kthread_run(void *data)
 		struct xdp_cpumap_stats stats = {}; /* zero stats */
 		unsigned int kmem_alloc_drops = 0, sched = 0;
 		gfp_t gfp = __GFP_ZERO | GFP_ATOMIC;
-		int i, n, m, nframes, xdp_n;
-		void *frames[CPUMAP_BATCH];
-		void *skbs[CPUMAP_BATCH];
+		int i, n, m, nframes, xdp_n, built = 0;
+		void **frames = rcpu->frames;
+		void **skbs = rcpu->skbs;
+		LIST_HEAD(gro_list);
 		LIST_HEAD(list);
+		u64 merged;
+		bool empty;
 
 		/* Release CPU reschedule checks */
 		if (__ptr_ring_empty(rcpu->queue)) {
@@ -342,8 +376,7 @@ static int cpu_map_kthread_run(void *data)
 		 * kthread CPU pinned. Lockless access to ptr_ring
 		 * consume side valid as no-resize allowed of queue.
 		 */
-		n = __ptr_ring_consume_batched(rcpu->queue, frames,
-					       CPUMAP_BATCH);
+		n = __ptr_ring_consume_batched(rcpu->queue, frames, batch);
 		for (i = 0, xdp_n = 0; i < n; i++) {
 			void *f = frames[i];
 			struct page *page;
@@ -389,14 +422,36 @@ static int cpu_map_kthread_run(void *data)
 				continue;
 			}
 
-			list_add_tail(&skb->list, &list);
+			list_add_tail(&skb->list, &gro_list);
+			built++;
 		}
+
+		/* skbs from generic XDP have already been through GRO */
 		netif_receive_skb_list(&list);
 
+		merged = cpu_map_gro_receive(rcpu, &gro_list);
+
+		/* If the ring is not empty, there will be another round soon
+		 * and only packets older than a jiffy need to be completed,
+		 * provided a jiffy is short enough. Otherwise, do not hold
+		 * packets in GRO while sleeping.
+		 */
+		empty = __ptr_ring_empty(rcpu->queue);
+		napi_gro_flush_normal(&rcpu->napi, !empty && HZ >= 1000);
+
 		/* Feedback loop via tracepoint */
 		trace_xdp_cpumap_kthread(rcpu->map_id, n, kmem_alloc_drops,
 					 sched, &stats);
 
+		/* Single writer, read locklessly on map lookup */
+		WRITE_ONCE(rcpu->value.stats.packets,
+			   rcpu->value.stats.packets + n);
+		WRITE_ONCE(rcpu->value.stats.drops,
+			   rcpu->value.stats.drops + stats.drop +
+			   nframes - built);
+		WRITE_ONCE(rcpu->value.stats.gro_merged,
+			   rcpu->value.stats.gro_merged + merged);
+
 		local_bh_enable(); /* resched point, may call do_softirq() */
 	}
 	__set_current_state(TASK_RUNNING);
@@ -464,6 +519,8 @@ __cpu_map_entry_alloc(struct bpf_map *map, struct bpf_cpumap_val *value,
 	rcpu->cpu    = cpu;
 	rcpu->map_id = map->id;
 	rcpu->value.qsize  = value->qsize;
+	rcpu->value.batch  = value->batch ?: CPUMAP_BATCH;
+	napi_gro_init(&rcpu->napi);
 
 	if (fd > 0 && __cpu_map_load_bpf_program(rcpu, fd))
 		goto free_ptr_ring;
@@ -585,6 +642,8 @@ static int cpu_map_update_elem(struct bpf_map *map, void *key, void *value,
 		return -EEXIST;
 	if (unlikely(cpumap_value.qsize > 16384)) /* sanity limit on qsize */
 		return -EOVERFLOW;
+	if (unlikely(cpumap_value.batch > CPUMAP_BATCH_MAX))
+		return -EINVAL;
 
 	/* Make sure CPU is a valid possible cpu */
 	if (key_cpu >= nr_cpumask_bits || !cpu_possible(key_cpu))
@@ -10,6 +10,7 @@
 #include <linux/random.h>
 #include <uapi/linux/btf.h>
 #include <linux/rcupdate_trace.h>
+#include <linux/bpf_mem_alloc.h>
 #include "percpu_freelist.h"
 #include "bpf_lru_list.h"
 #include "map_in_map.h"
@@ -73,6 +74,9 @@
  * BPF maps which need dynamic allocation are only used from (forced)
  * thread context on RT and can therefore use regular spinlocks which in
  * turn allows to invoke memory allocations from the lock held section.
+ * The exception are non-preallocated plain hash maps: their elements come
+ * from bpf_mem_alloc, which never calls into the slab allocator from the
+ * lock held section, so they keep using raw spinlocks.
  *
  * On a non RT kernel this distinction is neither possible nor required.
  * spinlock maps to raw_spinlock and the extra code is optimized out by the
@@ -98,6 +102,7 @@ struct bpf_htab {
 		struct bpf_lru lru;
 	};
 	struct htab_elem *__percpu *extra_elems;
+	struct bpf_mem_alloc ma;
 	atomic_t count;	/* number of elements in this hashtable */
 	u32 n_buckets;	/* number of hash buckets */
 	u32 elem_size;	/* size of each element in bytes */
@@ -132,9 +137,20 @@ static inline bool htab_is_prealloc(const struct bpf_htab *htab)
 	return !(htab->map.map_flags & BPF_F_NO_PREALLOC);
 }
 
+/* Non-preallocated plain hash maps allocate their elements from
+ * bpf_mem_alloc, which is safe in any context. Per-cpu values still come
+ * from the percpu allocator, so per-cpu hash maps are not covered.
+ */
+static inline bool htab_use_mem_alloc(const struct bpf_htab *htab)
+{
+	return htab->map.map_type == BPF_MAP_TYPE_HASH &&
+	       !htab_is_prealloc(htab);
+}
+
 static inline bool htab_use_raw_lock(const struct bpf_htab *htab)
 {
-	return (!IS_ENABLED(CONFIG_PREEMPT_RT) || htab_is_prealloc(htab));
+	return (!IS_ENABLED(CONFIG_PREEMPT_RT) || htab_is_prealloc(htab) ||
+		htab_use_mem_alloc(htab));
 }
 
 static void htab_init_buckets(struct bpf_htab *htab)
@@ -556,6 +572,10 @@ static struct bpf_map *htab_map_alloc(union bpf_attr *attr)
 			if (err)
 				goto free_prealloc;
 		}
+	} else if (htab_use_mem_alloc(htab)) {
+		err = bpf_mem_alloc_init(&htab->ma, htab->elem_size);
+		if (err)
+			goto free_map_locked;
 	}
 
 	return &htab->map;
@@ -839,7 +859,10 @@ static void htab_elem_free(struct bpf_htab *htab, struct htab_elem *l)
 	if (htab->map.map_type == BPF_MAP_TYPE_PERCPU_HASH)
 		free_percpu(htab_elem_get_ptr(l, htab->map.key_size));
 	check_and_free_timer(htab, l);
-	kfree(l);
+	if (htab_use_mem_alloc(htab))
+		bpf_mem_cache_free(&htab->ma, l);
+	else
+		kfree(l);
 }
 
 static void htab_elem_free_rcu(struct rcu_head *head)
@@ -868,6 +891,13 @@ static void free_htab_elem(struct bpf_htab *htab, struct htab_elem *l)
 	if (htab_is_prealloc(htab)) {
 		check_and_free_timer(htab, l);
 		__pcpu_freelist_push(&htab->freelist, &l->fnode);
+	} else if (htab_use_mem_alloc(htab)) {
+		/* Like preallocated elements, the element may be reused
+		 * right away. bpf_mem_alloc defers returning it to the slab
+		 * allocator until RCU readers are done with it.
+		 */
+		atomic_dec(&htab->count);
+		htab_elem_free(htab, l);
 	} else {
 		atomic_dec(&htab->count);
 		l->htab = htab;
@@ -963,9 +993,12 @@ static struct htab_elem *alloc_htab_elem(struct bpf_htab *htab, void *key,
 				l_new = ERR_PTR(-E2BIG);
 				goto dec_count;
 			}
-		l_new = bpf_map_kmalloc_node(&htab->map, htab->elem_size,
-					     GFP_ATOMIC | __GFP_NOWARN,
-					     htab->map.numa_node);
+		if (htab_use_mem_alloc(htab))
+			l_new = bpf_mem_cache_alloc(&htab->ma);
+		else
+			l_new = bpf_map_kmalloc_node(&htab->map, htab->elem_size,
+						     GFP_ATOMIC | __GFP_NOWARN,
+						     htab->map.numa_node);
 		if (!l_new) {
 			l_new = ERR_PTR(-ENOMEM);
 			goto dec_count;
@@ -1408,6 +1441,8 @@ static void delete_all_elements(struct bpf_htab *htab)
 {
 	int i;
 
+	/* bpf_mem_cache_free() frees into the cache of the current cpu */
+	migrate_disable();
 	for (i = 0; i < htab->n_buckets; i++) {
 		struct hlist_nulls_head *head = select_bucket(htab, i);
 		struct hlist_nulls_node *n;
@@ -1418,6 +1453,7 @@ static void delete_all_elements(struct bpf_htab *htab)
 			htab_elem_free(htab, l);
 		}
 	}
+	migrate_enable();
 }
 
 static void htab_free_malloced_timers(struct bpf_htab *htab)
@@ -1469,6 +1505,7 @@ static void htab_map_free(struct bpf_map *map)
 	else
 		prealloc_destroy(htab);
 
+	bpf_mem_alloc_destroy(&htab->ma);
 	free_percpu(htab->extra_elems);
 	bpf_map_area_free(htab->buckets);
 	for (i = 0; i < HASHTAB_MAP_LOCK_COUNT; i++)
@@ -520,7 +520,8 @@ static bool is_ptr_cast_function(enum bpf_func_id func_id)
 static bool is_callback_calling_function(enum bpf_func_id func_id)
 {
 	return func_id == BPF_FUNC_for_each_map_elem ||
-	       func_id == BPF_FUNC_timer_set_callback;
+	       func_id == BPF_FUNC_timer_set_callback ||
+	       func_id == BPF_FUNC_user_ringbuf_drain;
 }
 
 static bool is_cmpxchg_insn(const struct bpf_insn *insn)
@@ -5093,7 +5094,10 @@ static int resolve_map_arg_type(struct bpf_verifier_env *env,
 			return -EINVAL;
 		}
 		break;
-
+	case BPF_MAP_TYPE_BLOOM_FILTER:
+		if (meta->func_id == BPF_FUNC_map_peek_elem)
+			*arg_type = ARG_PTR_TO_MAP_VALUE;
+		break;
 	default:
 		break;
 	}
@@ -5594,6 +5598,10 @@ static int check_map_func_compatibility(struct bpf_verifier_env *env,
 		    func_id != BPF_FUNC_ringbuf_query)
 			goto error;
 		break;
+	case BPF_MAP_TYPE_USER_RINGBUF:
+		if (func_id != BPF_FUNC_user_ringbuf_drain)
+			goto error;
+		break;
 	case BPF_MAP_TYPE_STACK_TRACE:
 		if (func_id != BPF_FUNC_get_stackid)
 			goto error;
@@ -5662,6 +5670,11 @@ static int check_map_func_compatibility(struct bpf_verifier_env *env,
 		    func_id != BPF_FUNC_map_push_elem)
 			goto error;
 		break;
+	case BPF_MAP_TYPE_BLOOM_FILTER:
+		if (func_id != BPF_FUNC_map_peek_elem &&
+		    func_id != BPF_FUNC_map_push_elem)
+			goto error;
+		break;
 	case BPF_MAP_TYPE_SK_STORAGE:
 		if (func_id != BPF_FUNC_sk_storage_get &&
 		    func_id != BPF_FUNC_sk_storage_delete)
@@ -5705,6 +5718,10 @@ static int check_map_func_compatibility(struct bpf_verifier_env *env,
 		if (map->map_type != BPF_MAP_TYPE_RINGBUF)
 			goto error;
 		break;
+	case BPF_FUNC_user_ringbuf_drain:
+		if (map->map_type != BPF_MAP_TYPE_USER_RINGBUF)
+			goto error;
+		break;
 	case BPF_FUNC_get_stackid:
 		if (map->map_type != BPF_MAP_TYPE_STACK_TRACE)
 			goto error;
@@ -5748,7 +5765,8 @@ static int check_map_func_compatibility(struct bpf_verifier_env *env,
 	case BPF_FUNC_map_pop_elem:
 	case BPF_FUNC_map_push_elem:
 		if (map->map_type != BPF_MAP_TYPE_QUEUE &&
-		    map->map_type != BPF_MAP_TYPE_STACK)
+		    map->map_type != BPF_MAP_TYPE_STACK &&
+		    map->map_type != BPF_MAP_TYPE_BLOOM_FILTER)
 			goto error;
 		break;
 	case BPF_FUNC_sk_storage_get:
@@ -6210,6 +6228,42 @@ static int set_timer_callback_state(struct bpf_verifier_env *env,
 	return 0;
 }
 
+static int set_user_ringbuf_callback_state(struct bpf_verifier_env *env,
+					   struct bpf_func_state *caller,
+					   struct bpf_func_state *callee,
+					   int insn_idx)
+{
+	struct bpf_map *map_ptr = caller->regs[BPF_REG_1].map_ptr;
+	struct bpf_reg_state *size_reg = &callee->regs[BPF_REG_2];
+
+	/* bpf_user_ringbuf_drain(struct bpf_map *map, void *callback_fn,
+	 *      void *callback_ctx, u64 flags);
+	 * callback_fn(void *sample, u32 size, void *callback_ctx);
+	 *
+	 * Samples are read in place, so they are read-only. The helper
+	 * never passes a sample larger than the map's value_size.
+	 */
+	callee->regs[BPF_REG_1].type = PTR_TO_MEM | MEM_RDONLY;
+	__mark_reg_known_zero(&callee->regs[BPF_REG_1]);
+	callee->regs[BPF_REG_1].mem_size = map_ptr->value_size;
+
+	__mark_reg_unknown(env, size_reg);
+	size_reg->smin_value = 0;
+	size_reg->s32_min_value = 0;
+	size_reg->smax_value = map_ptr->value_size;
+	size_reg->s32_max_value = map_ptr->value_size;
+	reg_bounds_sync(size_reg);
+
+	/* pointer to stack or null */
+	callee->regs[BPF_REG_3] = caller->regs[BPF_REG_3];
+
+	/* unused */
+	__mark_reg_not_init(env, &callee->regs[BPF_REG_4]);
+	__mark_reg_not_init(env, &callee->regs[BPF_REG_5]);
+	callee->in_callback_fn = true;
+	return 0;
+}
+
 static int prepare_func_exit(struct bpf_verifier_env *env, int *insn_idx)
 {
 	struct bpf_verifier_state *state = env->cur_state;
@@ -6578,6 +6632,13 @@ static int check_helper_call(struct bpf_verifier_env *env, struct bpf_insn *insn
 			return -EINVAL;
 	}
 
+	if (func_id == BPF_FUNC_user_ringbuf_drain) {
+		err = __check_func_call(env, insn, insn_idx_p, meta.subprogno,
+					set_user_ringbuf_callback_state);
+		if (err < 0)
+			return -EINVAL;
+	}
+
 	if (func_id == BPF_FUNC_snprintf) {
 		err = check_bpf_snprintf_call(env, regs);
 		if (err < 0)
@@ -11013,6 +11074,7 @@ static int is_state_visited(struct bpf_verifier_env *env, int insn_idx)
 	if (!new_sl)
 		return -ENOMEM;
 	env->total_states++;
+	env->subprog_info[cur->frame[cur->curframe]->subprogno].total_states++;
 	env->peak_states++;
 	env->prev_jmps_processed = env->jmps_processed;
 	env->prev_insn_processed = env->insn_processed;
@@ -11137,6 +11199,7 @@ static int do_check(struct bpf_verifier_env *env)
 				env->insn_processed);
 			return -E2BIG;
 		}
+		env->subprog_info[cur_func(env)->subprogno].insn_processed++;
 
 		err = is_state_visited(env, env->insn_idx);
 		if (err < 0)
@@ -11634,6 +11697,23 @@ static bool is_preallocated_map(struct bpf_map *map)
 	return true;
 }
 
+/* Non-preallocated plain hash maps allocate their elements from
+ * bpf_mem_alloc, which is safe to use in any context.
+ */
+static bool check_map_any_context(struct bpf_map *map)
+{
+	return check_map_prealloc(map) || map->map_type == BPF_MAP_TYPE_HASH;
+}
+
+static bool is_any_context_map(struct bpf_map *map)
+{
+	if (!check_map_any_context(map))
+		return false;
+	if (map->inner_map_meta && !check_map_any_context(map->inner_map_meta))
+		return false;
+	return true;
+}
+
 static int check_map_prog_compatibility(struct bpf_verifier_env *env,
 					struct bpf_map *map,
 					struct bpf_prog *prog)
@@ -11641,7 +11721,8 @@ static int check_map_prog_compatibility(struct bpf_verifier_env *env,
 {
 	enum bpf_prog_type prog_type = resolve_prog_type(prog);
 	/*
-	 * Validate that trace type programs use preallocated hash maps.
+	 * Validate that trace type programs use preallocated hash maps or
+	 * hash maps backed by the any context bpf_mem_alloc allocator.
 	 *
 	 * For programs attached to PERF events this is mandatory as the
 	 * perf NMI can hit any arbitrary code sequence.
@@ -11657,7 +11738,7 @@ static int check_map_prog_compatibility(struct bpf_verifier_env *env,
 	 * now, but warnings are emitted so developers are made aware of
 	 * the unsafety and can fix their programs before this is enforced.
 	 */
-	if (is_tracing_prog_type(prog_type) && !is_preallocated_map(map)) {
+	if (is_tracing_prog_type(prog_type) && !is_any_context_map(map)) {
 		if (prog_type == BPF_PROG_TYPE_PERF_EVENT) {
 			verbose(env, "perf_event programs can only use preallocated hash map\n");
 			return -EINVAL;
@@ -11722,6 +11803,7 @@ static int check_map_prog_compatibility(struct bpf_verifier_env *env,
 			}
 			break;
 		case BPF_MAP_TYPE_RINGBUF:
+		case BPF_MAP_TYPE_USER_RINGBUF:
 			break;
 		default:
 			verbose(env,
@@ -13505,6 +13587,17 @@ static void print_verification_stats(struct bpf_verifier_env *env)
 				verbose(env, "+");
 		}
 		verbose(env, "\n");
+		if (env->subprog_cnt > 1) {
+			verbose(env, "subprog insns processed ");
+			for (i = 0; i < env->subprog_cnt; i++)
+				verbose(env, "%s%u", i ? "+" : "",
+					env->subprog_info[i].insn_processed);
+			verbose(env, " total_states ");
+			for (i = 0; i < env->subprog_cnt; i++)
+				verbose(env, "%s%u", i ? "+" : "",
+					env->subprog_info[i].total_states);
+			verbose(env, "\n");
+		}
 	}
 	verbose(env, "processed %d insns (limit %d) max_states_per_insn %d "
 		"total_states %d peak_states %d mark_read %d\n",
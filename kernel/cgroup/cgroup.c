@@ -3762,6 +3762,46 @@ static void cgroup_pressure_release(struct kernfs_open_file *of)
 	psi_trigger_destroy(ctx->psi.trigger);
 }
 
+static int cgroup_psi_enable_show(struct seq_file *seq, void *v)
+{
+	struct cgroup *cgrp = seq_css(seq)->cgroup;
+
+	seq_printf(seq, "%d\n", cgrp->psi.enabled);
+
+	return 0;
+}
+
+/*
+ * Turn pressure stall accounting of a cgroup and all of its descendants on
+ * or off; cgroups created below it later inherit the setting.
+ */
+static ssize_t cgroup_psi_enable_write(struct kernfs_open_file *of,
+				       char *buf, size_t nbytes, loff_t off)
+{
+	struct cgroup_subsys_state *d_css;
+	struct cgroup *cgrp, *dsct;
+	ssize_t ret;
+	int enable;
+
+	ret = kstrtoint(strstrip(buf), 0, &enable);
+	if (ret)
+		return ret;
+
+	if (enable < 0 || enable > 1)
+		return -ERANGE;
+
+	cgrp = cgroup_kn_lock_live(of->kn, false);
+	if (!cgrp)
+		return -ENOENT;
+
+	cgroup_for_each_live_descendant_pre(dsct, d_css, cgrp)
+		psi_cgroup_set_enabled(dsct, enable);
+
+	cgroup_kn_unlock(of->kn);
+
+	return nbytes;
+}
+
 bool cgroup_psi_enabled(void)
 {
 	return (cgroup_feature_disable_mask & (1 << OPT_FEATURE_PRESSURE)) == 0;
@@ -5116,6 +5156,12 @@ static struct cftype cgroup_base_files[] = {
 		.seq_show = cpu_stat_show,
 	},
 #ifdef CONFIG_PSI
+	{
+		.name = "cgroup.pressure",
+		.flags = CFTYPE_NOT_ON_ROOT | CFTYPE_PRESSURE,
+		.seq_show = cgroup_psi_enable_show,
+		.write = cgroup_psi_enable_write,
+	},
 	{
 		.name = "io.pressure",
 		.flags = CFTYPE_PRESSURE,
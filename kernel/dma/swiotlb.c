@@ -36,6 +36,7 @@
 #include <linux/scatterlist.h>
 #include <linux/mem_encrypt.h>
 #include <linux/set_memory.h>
+#include <linux/slab.h>
 #ifdef CONFIG_DEBUG_FS
 #include <linux/debugfs.h>
 #endif
@@ -44,7 +45,6 @@
 #include <linux/of.h>
 #include <linux/of_fdt.h>
 #include <linux/of_reserved_mem.h>
-#include <linux/slab.h>
 #endif
 
 #include <asm/io.h>
@@ -68,6 +68,27 @@
 
 #define INVALID_PHYS_ADDR (~(phys_addr_t)0)
 
+/**
+ * struct io_tlb_area - IO TLB memory area descriptor
+ *
+ * This is a single area with a single lock.
+ *
+ * @used:	The number of used IO TLB block.
+ * @index:	The slot index to start searching in this area for next round.
+ * @lock:	The lock to protect the above data structures in the map and
+ *		unmap calls.
+ * @bounced:	The number of bytes copied to or from slots of this area.
+ * @contended:	The number of times a mapping found this area locked and
+ *		moved on to the next one.
+ */
+struct io_tlb_area {
+	unsigned long used;
+	unsigned int index;
+	spinlock_t lock;
+	atomic_long_t bounced;
+	atomic_long_t contended;
+} ____cacheline_aligned_in_smp;
+
 enum swiotlb_force swiotlb_force;
 
 struct io_tlb_mem io_tlb_default_mem;
@@ -80,6 +101,12 @@ static unsigned int max_segment;
 
 static unsigned long default_nslabs = IO_TLB_DEFAULT_SIZE >> IO_TLB_SHIFT;
 
+/* 0 means one area per possible CPU */
+static unsigned int default_nareas;
+
+/*
+ * swiotlb=<nslabs>[,<nareas>][,force|noforce]
+ */
 static int __init
 setup_io_tlb_npages(char *str)
 {
@@ -90,6 +117,11 @@ setup_io_tlb_npages(char *str)
 	}
 	if (*str == ',')
 		++str;
+	if (isdigit(*str)) {
+		default_nareas = simple_strtoul(str, &str, 0);
+		if (*str == ',')
+			++str;
+	}
 	if (!strcmp(str, "force"))
 		swiotlb_force = SWIOTLB_FORCE;
 	else if (!strcmp(str, "noforce"))
@@ -141,8 +173,8 @@ void swiotlb_print_info(void)
 		return;
 	}
 
-	pr_info("mapped [mem %pa-%pa] (%luMB)\n", &mem->start, &mem->end,
-	       (mem->nslabs << IO_TLB_SHIFT) >> 20);
+	pr_info("mapped [mem %pa-%pa] (%luMB, %u areas)\n", &mem->start,
+		&mem->end, (mem->nslabs << IO_TLB_SHIFT) >> 20, mem->nareas);
 }
 
 static inline unsigned long io_tlb_offset(unsigned long val)
@@ -155,6 +187,33 @@ static inline unsigned long nr_slots(u64 val)
 	return DIV_ROUND_UP(val, IO_TLB_SIZE);
 }
 
+/*
+ * Pick the number of areas for a pool of @nslabs slots: a power of two, by
+ * default one per possible CPU, such that every area is made of whole
+ * IO_TLB_SEGSIZE segments.  The free lists never cross a segment, so the
+ * areas can then be managed independently.
+ */
+static unsigned int swiotlb_nareas(unsigned long nslabs)
+{
+	unsigned int nareas = default_nareas ?: num_possible_cpus();
+
+	nareas = roundup_pow_of_two(max(nareas, 1U));
+	while (nareas > 1 && nslabs % ((unsigned long)nareas * IO_TLB_SEGSIZE))
+		nareas >>= 1;
+
+	return nareas;
+}
+
+static unsigned long mem_used(struct io_tlb_mem *mem)
+{
+	unsigned long used = 0;
+	int i;
+
+	for (i = 0; i < mem->nareas; i++)
+		used += READ_ONCE(mem->areas[i].used);
+	return used;
+}
+
 /*
  * Early SWIOTLB allocation may be too early to allow an architecture to
  * perform the desired operations.  This function allows the architecture to
@@ -176,7 +235,8 @@ void __init swiotlb_update_mem_attributes(void)
 }
 
 static void swiotlb_init_io_tlb_mem(struct io_tlb_mem *mem, phys_addr_t start,
-				    unsigned long nslabs, bool late_alloc)
+				    unsigned long nslabs, bool late_alloc,
+				    unsigned int nareas)
 {
 	void *vaddr = phys_to_virt(start);
 	unsigned long bytes = nslabs << IO_TLB_SHIFT, i;
@@ -184,13 +244,21 @@ static void swiotlb_init_io_tlb_mem(struct io_tlb_mem *mem, phys_addr_t start,
 	mem->nslabs = nslabs;
 	mem->start = start;
 	mem->end = mem->start + bytes;
-	mem->index = 0;
 	mem->late_alloc = late_alloc;
+	mem->nareas = nareas;
+	mem->area_nslabs = nslabs / nareas;
 
 	if (swiotlb_force == SWIOTLB_FORCE)
 		mem->force_bounce = true;
 
-	spin_lock_init(&mem->lock);
+	for (i = 0; i < mem->nareas; i++) {
+		spin_lock_init(&mem->areas[i].lock);
+		mem->areas[i].index = 0;
+		mem->areas[i].used = 0;
+		atomic_long_set(&mem->areas[i].bounced, 0);
+		atomic_long_set(&mem->areas[i].contended, 0);
+	}
+
 	for (i = 0; i < mem->nslabs; i++) {
 		mem->slots[i].list = IO_TLB_SEGSIZE - io_tlb_offset(i);
 		mem->slots[i].orig_addr = INVALID_PHYS_ADDR;
@@ -202,6 +270,7 @@ static void swiotlb_init_io_tlb_mem(struct io_tlb_mem *mem, phys_addr_t start,
 int __init swiotlb_init_with_tbl(char *tlb, unsigned long nslabs, int verbose)
 {
 	struct io_tlb_mem *mem = &io_tlb_default_mem;
+	unsigned int nareas = swiotlb_nareas(nslabs);
 	size_t alloc_size;
 
 	if (swiotlb_force == SWIOTLB_NO_FORCE)
@@ -217,7 +286,12 @@ int __init swiotlb_init_with_tbl(char *tlb, unsigned long nslabs, int verbose)
 		panic("%s: Failed to allocate %zu bytes align=0x%lx\n",
 		      __func__, alloc_size, PAGE_SIZE);
 
-	swiotlb_init_io_tlb_mem(mem, __pa(tlb), nslabs, false);
+	alloc_size = array_size(sizeof(*mem->areas), nareas);
+	mem->areas = memblock_alloc(alloc_size, SMP_CACHE_BYTES);
+	if (!mem->areas)
+		panic("%s: Failed to allocate mem->areas.\n", __func__);
+
+	swiotlb_init_io_tlb_mem(mem, __pa(tlb), nslabs, false, nareas);
 
 	if (verbose)
 		swiotlb_print_info();
@@ -305,6 +379,7 @@ swiotlb_late_init_with_tbl(char *tlb, unsigned long nslabs)
 {
 	struct io_tlb_mem *mem = &io_tlb_default_mem;
 	unsigned long bytes = nslabs << IO_TLB_SHIFT;
+	unsigned int nareas = swiotlb_nareas(nslabs);
 
 	if (swiotlb_force == SWIOTLB_NO_FORCE)
 		return 0;
@@ -313,13 +388,20 @@ swiotlb_late_init_with_tbl(char *tlb, unsigned long nslabs)
 	if (WARN_ON_ONCE(mem->nslabs))
 		return -ENOMEM;
 
+	mem->areas = kcalloc(nareas, sizeof(*mem->areas), GFP_KERNEL);
+	if (!mem->areas)
+		return -ENOMEM;
+
 	mem->slots = (void *)__get_free_pages(GFP_KERNEL | __GFP_ZERO,
 		get_order(array_size(sizeof(*mem->slots), nslabs)));
-	if (!mem->slots)
+	if (!mem->slots) {
+		kfree(mem->areas);
+		mem->areas = NULL;
 		return -ENOMEM;
+	}
 
 	set_memory_decrypted((unsigned long)tlb, bytes >> PAGE_SHIFT);
-	swiotlb_init_io_tlb_mem(mem, virt_to_phys(tlb), nslabs, true);
+	swiotlb_init_io_tlb_mem(mem, virt_to_phys(tlb), nslabs, true, nareas);
 
 	swiotlb_print_info();
 	swiotlb_set_max_segment(mem->nslabs << IO_TLB_SHIFT);
@@ -330,7 +412,7 @@ void __init swiotlb_exit(void)
 {
 	struct io_tlb_mem *mem = &io_tlb_default_mem;
 	unsigned long tbl_vaddr;
-	size_t tbl_size, slots_size;
+	size_t tbl_size, slots_size, areas_size;
 
 	if (!mem->nslabs)
 		return;
@@ -339,14 +421,17 @@ void __init swiotlb_exit(void)
 	tbl_vaddr = (unsigned long)phys_to_virt(mem->start);
 	tbl_size = PAGE_ALIGN(mem->end - mem->start);
 	slots_size = PAGE_ALIGN(array_size(sizeof(*mem->slots), mem->nslabs));
+	areas_size = array_size(sizeof(*mem->areas), mem->nareas);
 
 	set_memory_encrypted(tbl_vaddr, tbl_size >> PAGE_SHIFT);
 	if (mem->late_alloc) {
 		free_pages(tbl_vaddr, get_order(tbl_size));
 		free_pages((unsigned long)mem->slots, get_order(slots_size));
+		kfree(mem->areas);
 	} else {
 		memblock_free_late(mem->start, tbl_size);
 		memblock_free_late(__pa(mem->slots), slots_size);
+		memblock_free_late(__pa(mem->areas), areas_size);
 	}
 
 	memset(mem, 0, sizeof(*mem));
@@ -404,6 +489,8 @@ static void swiotlb_bounce(struct device *dev, phys_addr_t tlb_addr, size_t size
 		size = alloc_size;
 	}
 
+	atomic_long_add(size, &mem->areas[index / mem->area_nslabs].bounced);
+
 	if (PageHighMem(pfn_to_page(pfn))) {
 		/* The buffer does not have a mapping.  Map it in and copy */
 		unsigned int offset = orig_addr & ~PAGE_MASK;
@@ -450,21 +537,24 @@ static inline unsigned long get_max_slots(unsigned long boundary_mask)
 	return nr_slots(boundary_mask + 1);
 }
 
-static unsigned int wrap_index(struct io_tlb_mem *mem, unsigned int index)
+static unsigned int wrap_area_index(struct io_tlb_mem *mem, unsigned int index)
 {
-	if (index >= mem->nslabs)
+	if (index >= mem->area_nslabs)
 		return 0;
 	return index;
 }
 
 /*
  * Find a suitable number of IO TLB entries size that will fit this request and
- * allocate a buffer from that IO TLB pool.
+ * allocate a buffer from the given area of the IO TLB pool.  Unless @may_spin
+ * is set, give up right away if the area is locked by another CPU.
  */
-static int swiotlb_find_slots(struct device *dev, phys_addr_t orig_addr,
-			      size_t alloc_size, unsigned int alloc_align_mask)
+static int swiotlb_area_find_slots(struct device *dev, int area_index,
+		phys_addr_t orig_addr, size_t alloc_size,
+		unsigned int alloc_align_mask, bool may_spin, bool *busy)
 {
 	struct io_tlb_mem *mem = dev->dma_io_tlb_mem;
+	struct io_tlb_area *area = mem->areas + area_index;
 	unsigned long boundary_mask = dma_get_seg_boundary(dev);
 	dma_addr_t tbl_dma_addr =
 		phys_to_dma_unencrypted(dev, mem->start) & boundary_mask;
@@ -474,6 +564,8 @@ static int swiotlb_find_slots(struct device *dev, phys_addr_t orig_addr,
 	unsigned int nslots = nr_slots(alloc_size), stride;
 	unsigned int index, wrap, count = 0, i;
 	unsigned int offset = swiotlb_align_offset(dev, orig_addr);
+	unsigned int slot_base = area_index * mem->area_nslabs;
+	unsigned int slot_index;
 	unsigned long flags;
 
 	BUG_ON(!nslots);
@@ -488,16 +580,25 @@ static int swiotlb_find_slots(struct device *dev, phys_addr_t orig_addr,
 		stride = max(stride, stride << (PAGE_SHIFT - IO_TLB_SHIFT));
 	stride = max(stride, (alloc_align_mask >> IO_TLB_SHIFT) + 1);
 
-	spin_lock_irqsave(&mem->lock, flags);
-	if (unlikely(nslots > mem->nslabs - mem->used))
+	if (!spin_trylock_irqsave(&area->lock, flags)) {
+		atomic_long_inc(&area->contended);
+		if (!may_spin) {
+			*busy = true;
+			return -1;
+		}
+		spin_lock_irqsave(&area->lock, flags);
+	}
+	if (unlikely(nslots > mem->area_nslabs - area->used))
 		goto not_found;
 
-	index = wrap = wrap_index(mem, ALIGN(mem->index, stride));
+	index = wrap = wrap_area_index(mem, ALIGN(area->index, stride));
 	do {
+		slot_index = slot_base + index;
+
 		if (orig_addr &&
-		    (slot_addr(tbl_dma_addr, index) & iotlb_align_mask) !=
+		    (slot_addr(tbl_dma_addr, slot_index) & iotlb_align_mask) !=
 			    (orig_addr & iotlb_align_mask)) {
-			index = wrap_index(mem, index + 1);
+			index = wrap_area_index(mem, index + 1);
 			continue;
 		}
 
@@ -506,26 +607,26 @@ static int swiotlb_find_slots(struct device *dev, phys_addr_t orig_addr,
 		 * contiguous buffers, we allocate the buffers from that slot
 		 * and mark the entries as '0' indicating unavailable.
 		 */
-		if (!iommu_is_span_boundary(index, nslots,
+		if (!iommu_is_span_boundary(slot_index, nslots,
 					    nr_slots(tbl_dma_addr),
 					    max_slots)) {
-			if (mem->slots[index].list >= nslots)
+			if (mem->slots[slot_index].list >= nslots)
 				goto found;
 		}
-		index = wrap_index(mem, index + stride);
+		index = wrap_area_index(mem, index + stride);
 	} while (index != wrap);
 
 not_found:
-	spin_unlock_irqrestore(&mem->lock, flags);
+	spin_unlock_irqrestore(&area->lock, flags);
 	return -1;
 
 found:
-	for (i = index; i < index + nslots; i++) {
+	for (i = slot_index; i < slot_index + nslots; i++) {
 		mem->slots[i].list = 0;
 		mem->slots[i].alloc_size =
-			alloc_size - (offset + ((i - index) << IO_TLB_SHIFT));
+			alloc_size - (offset + ((i - slot_index) << IO_TLB_SHIFT));
 	}
-	for (i = index - 1;
+	for (i = slot_index - 1;
 	     io_tlb_offset(i) != IO_TLB_SEGSIZE - 1 &&
 	     mem->slots[i].list; i--)
 		mem->slots[i].list = ++count;
@@ -533,14 +634,47 @@ static int swiotlb_find_slots(struct device *dev, phys_addr_t orig_addr,
 	/*
 	 * Update the indices to avoid searching in the next round.
 	 */
-	if (index + nslots < mem->nslabs)
-		mem->index = index + nslots;
+	if (index + nslots < mem->area_nslabs)
+		area->index = index + nslots;
 	else
-		mem->index = 0;
-	mem->used += nslots;
+		area->index = 0;
+	area->used += nslots;
 
-	spin_unlock_irqrestore(&mem->lock, flags);
-	return index;
+	spin_unlock_irqrestore(&area->lock, flags);
+	return slot_index;
+}
+
+/*
+ * Start searching in the area of the current CPU and walk the others from
+ * there.  Areas locked by another CPU are skipped on the first pass, and
+ * only waited for if no other area had room.
+ */
+static int swiotlb_find_slots(struct device *dev, phys_addr_t orig_addr,
+			      size_t alloc_size, unsigned int alloc_align_mask)
+{
+	struct io_tlb_mem *mem = dev->dma_io_tlb_mem;
+	int start = raw_smp_processor_id() & (mem->nareas - 1);
+	bool may_spin = mem->nareas == 1;
+	bool busy = false;
+	int i, index;
+
+	for (;;) {
+		i = start;
+		do {
+			index = swiotlb_area_find_slots(dev, i, orig_addr,
+							alloc_size,
+							alloc_align_mask,
+							may_spin, &busy);
+			if (index >= 0)
+				return index;
+			if (++i >= mem->nareas)
+				i = 0;
+		} while (i != start);
+
+		if (may_spin || !busy)
+			return -1;
+		may_spin = true;
+	}
 }
 
 phys_addr_t swiotlb_tbl_map_single(struct device *dev, phys_addr_t orig_addr,
@@ -572,7 +706,7 @@ phys_addr_t swiotlb_tbl_map_single(struct device *dev, phys_addr_t orig_addr,
 		if (!(attrs & DMA_ATTR_NO_WARN))
 			dev_warn_ratelimited(dev,
 	"swiotlb buffer is full (sz: %zd bytes), total %lu (slots), used %lu (slots)\n",
-				 alloc_size, mem->nslabs, mem->used);
+				 alloc_size, mem->nslabs, mem_used(mem));
 		return (phys_addr_t)DMA_MAPPING_ERROR;
 	}
 
@@ -602,6 +736,7 @@ static void swiotlb_release_slots(struct device *dev, phys_addr_t tlb_addr)
 	unsigned int offset = swiotlb_align_offset(dev, tlb_addr);
 	int index = (tlb_addr - offset - mem->start) >> IO_TLB_SHIFT;
 	int nslots = nr_slots(mem->slots[index].alloc_size + offset);
+	struct io_tlb_area *area = &mem->areas[index / mem->area_nslabs];
 	int count, i;
 
 	/*
@@ -610,7 +745,7 @@ static void swiotlb_release_slots(struct device *dev, phys_addr_t tlb_addr)
 	 * While returning the entries to the free list, we merge the entries
 	 * with slots below and above the pool being returned.
 	 */
-	spin_lock_irqsave(&mem->lock, flags);
+	spin_lock_irqsave(&area->lock, flags);
 	if (index + nslots < ALIGN(index + 1, IO_TLB_SEGSIZE))
 		count = mem->slots[index + nslots].list;
 	else
@@ -634,8 +769,8 @@ static void swiotlb_release_slots(struct device *dev, phys_addr_t tlb_addr)
 	     io_tlb_offset(i) != IO_TLB_SEGSIZE - 1 && mem->slots[i].list;
 	     i--)
 		mem->slots[i].list = ++count;
-	mem->used -= nslots;
-	spin_unlock_irqrestore(&mem->lock, flags);
+	area->used -= nslots;
+	spin_unlock_irqrestore(&area->lock, flags);
 }
 
 /*
@@ -734,10 +869,49 @@ EXPORT_SYMBOL_GPL(is_swiotlb_active);
 #ifdef CONFIG_DEBUG_FS
 static struct dentry *debugfs_dir;
 
+static int io_tlb_used_get(void *data, u64 *val)
+{
+	*val = mem_used(data);
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(fops_io_tlb_used, io_tlb_used_get, NULL, "%llu\n");
+
+static int io_tlb_bounced_get(void *data, u64 *val)
+{
+	struct io_tlb_mem *mem = data;
+	int i;
+
+	*val = 0;
+	for (i = 0; i < mem->nareas; i++)
+		*val += atomic_long_read(&mem->areas[i].bounced);
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(fops_io_tlb_bounced, io_tlb_bounced_get, NULL,
+			 "%llu\n");
+
+static int io_tlb_contended_get(void *data, u64 *val)
+{
+	struct io_tlb_mem *mem = data;
+	int i;
+
+	*val = 0;
+	for (i = 0; i < mem->nareas; i++)
+		*val += atomic_long_read(&mem->areas[i].contended);
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(fops_io_tlb_contended, io_tlb_contended_get, NULL,
+			 "%llu\n");
+
 static void swiotlb_create_debugfs_files(struct io_tlb_mem *mem)
 {
 	debugfs_create_ulong("io_tlb_nslabs", 0400, mem->debugfs, &mem->nslabs);
-	debugfs_create_ulong("io_tlb_used", 0400, mem->debugfs, &mem->used);
+	debugfs_create_u32("io_tlb_nareas", 0400, mem->debugfs, &mem->nareas);
+	debugfs_create_file_unsafe("io_tlb_used", 0400, mem->debugfs, mem,
+				   &fops_io_tlb_used);
+	debugfs_create_file_unsafe("io_tlb_bounced_bytes", 0400, mem->debugfs,
+				   mem, &fops_io_tlb_bounced);
+	debugfs_create_file_unsafe("io_tlb_contended", 0400, mem->debugfs, mem,
+				   &fops_io_tlb_contended);
 }
 
 static int __init swiotlb_create_default_debugfs(void)
@@ -807,6 +981,7 @@ static int rmem_swiotlb_device_init(struct reserved_mem *rmem,
 {
 	struct io_tlb_mem *mem = rmem->priv;
 	unsigned long nslabs = rmem->size >> IO_TLB_SHIFT;
+	unsigned int nareas = swiotlb_nareas(nslabs);
 
 	/*
 	 * Since multiple devices can share the same pool, the private data,
@@ -825,9 +1000,16 @@ static int rmem_swiotlb_device_init(struct reserved_mem *rmem,
 			return -ENOMEM;
 		}
 
+		mem->areas = kcalloc(nareas, sizeof(*mem->areas), GFP_KERNEL);
+		if (!mem->areas) {
+			kfree(mem->slots);
+			kfree(mem);
+			return -ENOMEM;
+		}
+
 		set_memory_decrypted((unsigned long)phys_to_virt(rmem->base),
 				     rmem->size >> PAGE_SHIFT);
-		swiotlb_init_io_tlb_mem(mem, rmem->base, nslabs, false);
+		swiotlb_init_io_tlb_mem(mem, rmem->base, nslabs, false, nareas);
 		mem->force_bounce = true;
 		mem->for_alloc = true;
 
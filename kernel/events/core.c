@@ -886,6 +886,245 @@ static void perf_cgroup_switch(struct task_struct *task, int mode)
 	local_irq_restore(flags);
 }
 
+/*
+ * Rescheduling cgroup events on every cgroup switch means reprogramming
+ * the PMU, which gets expensive with many monitored cgroups. Instead, a
+ * plain CPU event can be attached to a set of cgroups: it keeps running
+ * and, at each cgroup switch, the count delta since the previous switch
+ * is added to the cgroup switched out and to its attached ancestors.
+ *
+ * The events with attached cgroups are on a per-cpu list, protected by
+ * a per-cpu lock, and only touched with IRQs disabled on their CPU
+ * (except for removal, which only needs the lock).
+ */
+struct perf_cgroup_node {
+	struct hlist_node		node;
+	u64				id;
+	u64				count;
+};
+
+#define PERF_CGROUP_NODE_MAX	4096
+
+static DEFINE_PER_CPU(struct list_head, cgrp_node_list);
+static DEFINE_PER_CPU(raw_spinlock_t, cgrp_node_lock);
+
+static struct perf_cgroup_node *
+perf_cgroup_node_find(struct hlist_head *hash, int bits, u64 id)
+{
+	struct perf_cgroup_node *cgrp_node;
+
+	hlist_for_each_entry(cgrp_node, &hash[hash_64(id, bits)], node) {
+		if (cgrp_node->id == id)
+			return cgrp_node;
+	}
+
+	return NULL;
+}
+
+/*
+ * Attribute the count since the last update to @cgrp and its ancestors.
+ * Called on event->cpu with IRQs disabled and cgrp_node_lock held.
+ */
+static void perf_cgroup_node_update(struct perf_event *event,
+				    struct cgroup *cgrp)
+{
+	struct perf_cgroup_node *cgrp_node;
+	u64 count, delta;
+
+	if (event->state == PERF_EVENT_STATE_ACTIVE)
+		event->pmu->read(event);
+
+	/* CPU events are never inherited, there is no child_count */
+	count = local64_read(&event->count);
+	delta = count - event->cgrp_node_count;
+	event->cgrp_node_count = count;
+
+	/* PERF_EVENT_IOC_RESET moves the count backwards */
+	if ((s64)delta <= 0)
+		return;
+
+	for (; cgrp; cgrp = cgroup_parent(cgrp)) {
+		cgrp_node = perf_cgroup_node_find(event->cgrp_node_hash,
+						  event->cgrp_node_hash_bits,
+						  cgroup_id(cgrp));
+		if (cgrp_node)
+			cgrp_node->count += delta;
+	}
+}
+
+static void perf_cgroup_node_switch(struct perf_cgroup *cgrp)
+{
+	struct perf_event *event;
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(this_cpu_ptr(&cgrp_node_lock), flags);
+	list_for_each_entry(event, this_cpu_ptr(&cgrp_node_list), cgrp_node_entry)
+		perf_cgroup_node_update(event, cgrp->css.cgroup);
+	raw_spin_unlock_irqrestore(this_cpu_ptr(&cgrp_node_lock), flags);
+}
+
+static int __perf_cgroup_node_attach(void *info)
+{
+	struct perf_event *event = info;
+
+	raw_spin_lock(this_cpu_ptr(&cgrp_node_lock));
+
+	/* Only count from now on */
+	if (event->state == PERF_EVENT_STATE_ACTIVE)
+		event->pmu->read(event);
+	event->cgrp_node_count = local64_read(&event->count);
+
+	list_add_tail(&event->cgrp_node_entry, this_cpu_ptr(&cgrp_node_list));
+	/* Get perf_cgroup_sched_out() called on cgroup switches */
+	atomic_inc(this_cpu_ptr(&perf_cgroup_events));
+
+	raw_spin_unlock(this_cpu_ptr(&cgrp_node_lock));
+
+	return 0;
+}
+
+static int perf_cgroup_node_attach(struct perf_event *event,
+				   struct perf_event_attach_cgroup __user *uattach)
+{
+	struct perf_cgroup_node *nodes;
+	struct hlist_head *hash;
+	int bits, ret;
+	u32 nr, i;
+	u64 id;
+
+	/* Only counting CPU events scheduled on their own */
+	if (event->cpu < 0 || event->ctx->task || is_cgroup_event(event) ||
+	    is_sampling_event(event) || event->group_leader != event ||
+	    event->nr_siblings)
+		return -EINVAL;
+
+	if (event->cgrp_node_hash)
+		return -EBUSY;
+
+	if (get_user(nr, &uattach->nr))
+		return -EFAULT;
+
+	if (!nr || nr > PERF_CGROUP_NODE_MAX)
+		return -EINVAL;
+
+	bits = max_t(int, order_base_2(nr), 1);
+	hash = kcalloc(1 << bits, sizeof(*hash), GFP_KERNEL);
+	nodes = kcalloc(nr, sizeof(*nodes), GFP_KERNEL);
+	if (!hash || !nodes) {
+		ret = -ENOMEM;
+		goto err;
+	}
+
+	for (i = 0; i < nr; i++) {
+		if (get_user(id, &uattach->ids[i])) {
+			ret = -EFAULT;
+			goto err;
+		}
+
+		if (perf_cgroup_node_find(hash, bits, id)) {
+			ret = -EINVAL;
+			goto err;
+		}
+
+		nodes[i].id = id;
+		hlist_add_head(&nodes[i].node, &hash[hash_64(id, bits)]);
+	}
+
+	event->cgrp_nodes = nodes;
+	event->cgrp_node_hash = hash;
+	event->cgrp_node_hash_bits = bits;
+
+	ret = cpu_function_call(event->cpu, __perf_cgroup_node_attach, event);
+	if (ret) {
+		event->cgrp_nodes = NULL;
+		event->cgrp_node_hash = NULL;
+		goto err;
+	}
+
+	return 0;
+
+err:
+	kfree(nodes);
+	kfree(hash);
+	return ret;
+}
+
+static void perf_cgroup_node_detach(struct perf_event *event)
+{
+	raw_spinlock_t *lock;
+	unsigned long flags;
+
+	if (!event->cgrp_node_hash)
+		return;
+
+	lock = per_cpu_ptr(&cgrp_node_lock, event->cpu);
+	raw_spin_lock_irqsave(lock, flags);
+	list_del(&event->cgrp_node_entry);
+	raw_spin_unlock_irqrestore(lock, flags);
+
+	atomic_dec(&per_cpu(perf_cgroup_events, event->cpu));
+
+	kfree(event->cgrp_nodes);
+	kfree(event->cgrp_node_hash);
+	event->cgrp_nodes = NULL;
+	event->cgrp_node_hash = NULL;
+}
+
+struct perf_cgroup_node_read {
+	struct perf_event		*event;
+	struct perf_event_cgroup_read	read;
+};
+
+static int __perf_cgroup_node_read(void *info)
+{
+	struct perf_cgroup_node_read *data = info;
+	struct perf_event *event = data->event;
+	struct perf_cgroup_node *cgrp_node;
+	int ret = 0;
+
+	raw_spin_lock(this_cpu_ptr(&cgrp_node_lock));
+
+	/* Account what the running cgroup counted since the last switch */
+	rcu_read_lock();
+	perf_cgroup_node_update(event,
+				perf_cgroup_from_task(current, NULL)->css.cgroup);
+	rcu_read_unlock();
+
+	cgrp_node = perf_cgroup_node_find(event->cgrp_node_hash,
+					  event->cgrp_node_hash_bits,
+					  data->read.cgroup_id);
+	if (cgrp_node)
+		data->read.count = cgrp_node->count;
+	else
+		ret = -ENOENT;
+
+	raw_spin_unlock(this_cpu_ptr(&cgrp_node_lock));
+
+	return ret;
+}
+
+static int perf_cgroup_node_read(struct perf_event *event,
+				 struct perf_event_cgroup_read __user *uread)
+{
+	struct perf_cgroup_node_read data = { .event = event };
+	int ret;
+
+	if (!event->cgrp_node_hash)
+		return -EINVAL;
+
+	if (copy_from_user(&data.read, uread, sizeof(data.read)))
+		return -EFAULT;
+
+	ret = cpu_function_call(event->cpu, __perf_cgroup_node_read, &data);
+	if (ret)
+		return ret;
+
+	if (copy_to_user(uread, &data.read, sizeof(data.read)))
+		return -EFAULT;
+
+	return 0;
+}
+
 static inline void perf_cgroup_sched_out(struct task_struct *task,
 					 struct task_struct *next)
 {
@@ -906,8 +1145,10 @@ static inline void perf_cgroup_sched_out(struct task_struct *task,
 	 * that we are switching to a different cgroup. Otherwise,
 	 * do no touch the cgroup events.
 	 */
-	if (cgrp1 != cgrp2)
+	if (cgrp1 != cgrp2) {
+		perf_cgroup_node_switch(cgrp1);
 		perf_cgroup_switch(task, PERF_CGROUP_SWOUT);
+	}
 
 	rcu_read_unlock();
 }
@@ -1118,6 +1359,24 @@ static inline int perf_cgroup_connect(pid_t pid, struct perf_event *event,
 	return -EINVAL;
 }
 
+static inline int
+perf_cgroup_node_attach(struct perf_event *event,
+			struct perf_event_attach_cgroup __user *uattach)
+{
+	return -EINVAL;
+}
+
+static inline void perf_cgroup_node_detach(struct perf_event *event)
+{
+}
+
+static inline int
+perf_cgroup_node_read(struct perf_event *event,
+		      struct perf_event_cgroup_read __user *uread)
+{
+	return -EINVAL;
+}
+
 static inline void
 perf_cgroup_set_timestamp(struct task_struct *task,
 			  struct perf_event_context *ctx)
@@ -5094,6 +5353,8 @@ static void _free_event(struct perf_event *event)
 	if (is_cgroup_event(event))
 		perf_detach_cgroup(event);
 
+	perf_cgroup_node_detach(event);
+
 	if (!event->parent) {
 		if (event->attr.sample_type & PERF_SAMPLE_CALLCHAIN)
 			put_callchain_buffers();
@@ -5815,6 +6076,12 @@ static long _perf_ioctl(struct perf_event *event, unsigned int cmd, unsigned lon
 	case PERF_EVENT_IOC_QUERY_BPF:
 		return perf_event_query_prog_array(event, (void __user *)arg);
 
+	case PERF_EVENT_IOC_ATTACH_CGROUP:
+		return perf_cgroup_node_attach(event, (void __user *)arg);
+
+	case PERF_EVENT_IOC_READ_CGROUP:
+		return perf_cgroup_node_read(event, (void __user *)arg);
+
 	case PERF_EVENT_IOC_MODIFY_ATTRIBUTES: {
 		struct perf_event_attr new_attr;
 		int err = perf_copy_attr((struct perf_event_attr __user *)arg,
@@ -5864,6 +6131,8 @@ static long perf_compat_ioctl(struct file *file, unsigned int cmd,
 	case _IOC_NR(PERF_EVENT_IOC_ID):
 	case _IOC_NR(PERF_EVENT_IOC_QUERY_BPF):
 	case _IOC_NR(PERF_EVENT_IOC_MODIFY_ATTRIBUTES):
+	case _IOC_NR(PERF_EVENT_IOC_ATTACH_CGROUP):
+	case _IOC_NR(PERF_EVENT_IOC_READ_CGROUP):
 		/* Fix up pointer size (usually 4 -> 8 in 32-on-64-bit case */
 		if (_IOC_SIZE(cmd) == sizeof(compat_uptr_t)) {
 			cmd &= ~IOCSIZE_MASK;
@@ -10255,6 +10524,10 @@ int perf_event_set_bpf_prog(struct perf_event *event, struct bpf_prog *prog,
 	    (is_syscall_tp && prog->type != BPF_PROG_TYPE_TRACEPOINT))
 		return -EINVAL;
 
+	/* kprobe_multi programs are attached through a BPF link */
+	if (is_kprobe && prog->expected_attach_type == BPF_TRACE_KPROBE_MULTI)
+		return -EINVAL;
+
 	/* Kprobe override only works for kprobes, not uprobes. */
 	if (prog->kprobe_override &&
 	    !(event->tp_event->flags & TRACE_EVENT_FL_KPROBE))
@@ -13446,6 +13719,8 @@ static void __init perf_event_init_all_cpus(void)
 
 #ifdef CONFIG_CGROUP_PERF
 		INIT_LIST_HEAD(&per_cpu(cgrp_cpuctx_list, cpu));
+		INIT_LIST_HEAD(&per_cpu(cgrp_node_list, cpu));
+		raw_spin_lock_init(&per_cpu(cgrp_node_lock, cpu));
 #endif
 		INIT_LIST_HEAD(&per_cpu(sched_cb_list, cpu));
 	}
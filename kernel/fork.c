@@ -188,11 +188,18 @@ static inline void free_task_struct(struct task_struct *tsk)
 #ifdef CONFIG_VMAP_STACK
 /*
  * vmalloc() is a bit slow, and calling vfree() enough times will force a TLB
- * flush.  Try to minimize the number of calls by caching stacks.
+ * flush.  Try to minimize the number of calls by caching stacks.  Only
+ * stacks whose pages are on the nearest node with memory are cached, so that
+ * every CPU hands out node-local stacks, memoryless nodes included.
  */
 #define NR_CACHED_STACKS 2
 static DEFINE_PER_CPU(struct vm_struct *, cached_stacks[NR_CACHED_STACKS]);
 
+static inline bool vm_stack_is_local(struct vm_struct *vm)
+{
+	return page_to_nid(vm->pages[0]) == numa_mem_id();
+}
+
 static int free_vm_stack_cache(unsigned int cpu)
 {
 	struct vm_struct **cached_vm_stacks = per_cpu_ptr(cached_stacks, cpu);
@@ -218,6 +225,10 @@ static unsigned long *alloc_thread_stack_node(struct task_struct *tsk, int node)
 	void *stack;
 	int i;
 
+	/* The cache only holds stacks of the local node */
+	if (node != NUMA_NO_NODE && node != numa_mem_id())
+		goto alloc;
+
 	for (i = 0; i < NR_CACHED_STACKS; i++) {
 		struct vm_struct *s;
 
@@ -237,6 +248,7 @@ static unsigned long *alloc_thread_stack_node(struct task_struct *tsk, int node)
 		return s->addr;
 	}
 
+alloc:
 	/*
 	 * Allocated stacks are cached and later reused by new threads,
 	 * so memcg accounting is performed manually on assigning/releasing
@@ -281,6 +293,9 @@ static inline void free_thread_stack(struct task_struct *tsk)
 		for (i = 0; i < THREAD_SIZE / PAGE_SIZE; i++)
 			memcg_kmem_uncharge_page(vm->pages[i], 0);
 
+		if (!vm_stack_is_local(vm))
+			goto free;
+
 		for (i = 0; i < NR_CACHED_STACKS; i++) {
 			if (this_cpu_cmpxchg(cached_stacks[i],
 					NULL, tsk->stack_vm_area) != NULL)
@@ -288,7 +303,7 @@ static inline void free_thread_stack(struct task_struct *tsk)
 
 			return;
 		}
-
+free:
 		vfree_atomic(tsk->stack);
 		return;
 	}
@@ -366,13 +381,29 @@ struct vm_area_struct *vm_area_dup(struct vm_area_struct *orig)
 		*new = data_race(*orig);
 		INIT_LIST_HEAD(&new->anon_vma_chain);
 		new->vm_next = new->vm_prev = NULL;
+		vma_lock_init(new);
 	}
 	return new;
 }
 
+#ifdef CONFIG_PER_VMA_LOCK
+static void __vm_area_free(struct rcu_head *head)
+{
+	struct vm_area_struct *vma = container_of(head, struct vm_area_struct,
+						  vm_rcu);
+
+	kmem_cache_free(vm_area_cachep, vma);
+}
+#endif
+
 void vm_area_free(struct vm_area_struct *vma)
 {
+#ifdef CONFIG_PER_VMA_LOCK
+	/* lock_vma_under_rcu() may still be looking at it */
+	call_rcu(&vma->vm_rcu, __vm_area_free);
+#else
 	kmem_cache_free(vm_area_cachep, vma);
+#endif
 }
 
 static void account_kernel_stack(struct task_struct *tsk, int account)
@@ -533,6 +564,8 @@ static __latent_entropy int dup_mmap(struct mm_struct *mm,
 	for (mpnt = oldmm->mmap; mpnt; mpnt = mpnt->vm_next) {
 		struct file *file;
 
+		/* copy_page_range() write-protects the parent's ptes for COW */
+		vma_start_write(mpnt);
 		if (mpnt->vm_flags & VM_DONTCOPY) {
 			vm_stat_account(mm, mpnt->vm_flags, -vma_pages(mpnt));
 			continue;
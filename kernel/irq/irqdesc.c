@@ -16,6 +16,7 @@
 #include <linux/bitmap.h>
 #include <linux/irqdomain.h>
 #include <linux/sysfs.h>
+#include <linux/dim.h>
 
 #include "internals.h"
 
@@ -121,6 +122,9 @@ static void desc_set_defaults(unsigned int irq, struct irq_desc *desc, int node,
 	desc->irqs_unhandled = 0;
 	desc->tot_count = 0;
 	desc->name = NULL;
+#ifdef CONFIG_DIMLIB
+	desc->moder = NULL;
+#endif
 	desc->owner = owner;
 	for_each_possible_cpu(cpu)
 		*per_cpu_ptr(desc->kstat_irqs, cpu) = 0;
@@ -265,6 +269,55 @@ static ssize_t actions_show(struct kobject *kobj,
 }
 IRQ_ATTR_RO(actions);
 
+#ifdef CONFIG_DIMLIB
+static ssize_t moderation_show(struct kobject *kobj,
+			       struct kobj_attribute *attr, char *buf)
+{
+	struct irq_desc *desc = container_of(kobj, struct irq_desc, kobj);
+	ssize_t ret;
+
+	mutex_lock(&desc->request_mutex);
+	if (desc->moder)
+		ret = dim_irq_moder_show(desc->moder, buf);
+	else
+		ret = sysfs_emit(buf, "off\n");
+	mutex_unlock(&desc->request_mutex);
+
+	return ret;
+}
+
+static ssize_t moderation_store(struct kobject *kobj,
+				struct kobj_attribute *attr,
+				const char *buf, size_t count)
+{
+	struct irq_desc *desc = container_of(kobj, struct irq_desc, kobj);
+	ssize_t ret = -ENODEV;
+
+	mutex_lock(&desc->request_mutex);
+	if (desc->moder)
+		ret = dim_irq_moder_store(desc->moder, buf);
+	mutex_unlock(&desc->request_mutex);
+
+	return ret ?: count;
+}
+static struct kobj_attribute moderation_attr = __ATTR_RW(moderation);
+
+static ssize_t moderation_hist_show(struct kobject *kobj,
+				    struct kobj_attribute *attr, char *buf)
+{
+	struct irq_desc *desc = container_of(kobj, struct irq_desc, kobj);
+	ssize_t ret = 0;
+
+	mutex_lock(&desc->request_mutex);
+	if (desc->moder)
+		ret = dim_irq_moder_hist_show(desc->moder, buf);
+	mutex_unlock(&desc->request_mutex);
+
+	return ret;
+}
+IRQ_ATTR_RO(moderation_hist);
+#endif
+
 static struct attribute *irq_attrs[] = {
 	&per_cpu_count_attr.attr,
 	&chip_name_attr.attr,
@@ -273,6 +326,10 @@ static struct attribute *irq_attrs[] = {
 	&wakeup_attr.attr,
 	&name_attr.attr,
 	&actions_attr.attr,
+#ifdef CONFIG_DIMLIB
+	&moderation_attr.attr,
+	&moderation_hist_attr.attr,
+#endif
 	NULL
 };
 ATTRIBUTE_GROUPS(irq);
@@ -928,6 +928,34 @@ int irq_set_irq_wake(unsigned int irq, unsigned int on)
 }
 EXPORT_SYMBOL(irq_set_irq_wake);
 
+#ifdef CONFIG_DIMLIB
+/**
+ *	irq_set_moderation - attach adaptive moderation state to an irq
+ *	@irq:	interrupt number
+ *	@moder:	moderation state, or NULL to detach
+ *
+ *	Used by dim_irq_moder_register() and dim_irq_moder_unregister() to
+ *	expose the moderation of @irq in sysfs.
+ */
+int irq_set_moderation(unsigned int irq, struct dim_irq_moder *moder)
+{
+	struct irq_desc *desc = irq_to_desc(irq);
+	int ret = 0;
+
+	if (!desc)
+		return -EINVAL;
+
+	mutex_lock(&desc->request_mutex);
+	if (moder && desc->moder)
+		ret = -EBUSY;
+	else
+		desc->moder = moder;
+	mutex_unlock(&desc->request_mutex);
+
+	return ret;
+}
+#endif
+
 /*
  * Internal function that tells the architecture code whether a
  * particular irq has been exclusively allocated or is available
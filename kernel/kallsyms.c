@@ -52,6 +52,7 @@ extern const char kallsyms_token_table[] __weak;
 extern const u16 kallsyms_token_index[] __weak;
 
 extern const unsigned int kallsyms_markers[] __weak;
+extern const u8 kallsyms_seqs_of_names[] __weak;
 
 /*
  * Expand a compressed symbol data into the resulting uncompressed string,
@@ -185,12 +186,59 @@ static inline bool cleanup_symbol_name(char *s)
 static inline bool cleanup_symbol_name(char *s) { return false; }
 #endif
 
+/* Index of the symbol at position @pos in name order */
+static unsigned int get_symbol_seq(unsigned int pos)
+{
+	const u8 *seq = &kallsyms_seqs_of_names[3 * pos];
+
+	return (seq[0] << 16) | (seq[1] << 8) | seq[2];
+}
+
+/*
+ * Binary search kallsyms_seqs_of_names for @name.  Returns the index of the
+ * lowest addressed symbol of that name, or -ENOENT.
+ */
+static int kallsyms_lookup_seq(const char *name)
+{
+	char namebuf[KSYM_NAME_LEN];
+	int low = 0, high = (int)kallsyms_num_syms - 1;
+	int found = -ENOENT;
+
+	while (low <= high) {
+		int mid = low + (high - low) / 2;
+		unsigned int seq = get_symbol_seq(mid);
+		int ret;
+
+		kallsyms_expand_symbol(get_symbol_offset(seq), namebuf,
+				       ARRAY_SIZE(namebuf));
+		ret = strcmp(name, namebuf);
+		if (ret > 0) {
+			low = mid + 1;
+		} else {
+			if (!ret)
+				found = seq;
+			high = mid - 1;
+		}
+	}
+
+	return found;
+}
+
 /* Lookup the address for this symbol. Returns 0 if not found. */
 unsigned long kallsyms_lookup_name(const char *name)
 {
 	char namebuf[KSYM_NAME_LEN];
 	unsigned long i;
 	unsigned int off;
+	int seq;
+
+	seq = kallsyms_lookup_seq(name);
+	if (seq >= 0)
+		return kallsyms_sym_address(seq);
+
+	/* Names with a stripped suffix are not in the sorted index */
+	if (!IS_ENABLED(CONFIG_CFI_CLANG) || !IS_ENABLED(CONFIG_LTO_CLANG_THIN))
+		return module_kallsyms_lookup_name(name);
 
 	for (i = 0, off = 0; i < kallsyms_num_syms; i++) {
 		off = kallsyms_expand_symbol(off, namebuf, ARRAY_SIZE(namebuf));
@@ -204,7 +252,6 @@ unsigned long kallsyms_lookup_name(const char *name)
 	return module_kallsyms_lookup_name(name);
 }
 
-#ifdef CONFIG_LIVEPATCH
 /*
  * Iterate over all symbols in vmlinux.  For symbols from modules use
  * module_kallsyms_on_each_symbol instead.
@@ -226,7 +273,6 @@ int kallsyms_on_each_symbol(int (*fn)(void *, const char *, struct module *,
 	}
 	return 0;
 }
-#endif /* CONFIG_LIVEPATCH */
 
 static unsigned long get_symbol_pos(unsigned long addr,
 				    unsigned long *symbolsize,
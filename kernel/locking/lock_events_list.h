@@ -35,6 +35,16 @@ LOCK_EVENT(pv_wait_head)	/* # of vCPU wait's at the queue head	   */
 LOCK_EVENT(pv_wait_node)	/* # of vCPU wait's at non-head queue node */
 #endif /* CONFIG_PARAVIRT_SPINLOCKS */
 
+#ifdef CONFIG_NUMA_AWARE_SPINLOCKS
+/*
+ * Locking events for CNA qspinlock.
+ */
+LOCK_EVENT(lock_cna_intra)	/* # of MCS handoffs within a NUMA node	   */
+LOCK_EVENT(lock_cna_inter)	/* # of MCS handoffs across NUMA nodes	   */
+LOCK_EVENT(lock_cna_splice)	/* # of waiters moved to secondary queue   */
+LOCK_EVENT(lock_cna_flush)	/* # of secondary queue flushes		   */
+#endif /* CONFIG_NUMA_AWARE_SPINLOCKS */
+
 /*
  * Locking events for qspinlock
  *
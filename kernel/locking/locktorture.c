@@ -660,6 +660,25 @@ static struct lock_torture_ops percpu_rwsem_lock_ops = {
 	.name		= "percpu_rwsem_lock"
 };
 
+static void torture_percpu_rwsem_favor_writers_init(void)
+{
+	torture_percpu_rwsem_init();
+	percpu_rwsem_favor_writers(&pcpu_rwsem);
+}
+
+static struct lock_torture_ops percpu_rwsem_favor_writers_lock_ops = {
+	.init		= torture_percpu_rwsem_favor_writers_init,
+	.exit		= torture_percpu_rwsem_exit,
+	.writelock	= torture_percpu_rwsem_down_write,
+	.write_delay	= torture_rwsem_write_delay,
+	.task_boost     = torture_boost_dummy,
+	.writeunlock	= torture_percpu_rwsem_up_write,
+	.readlock       = torture_percpu_rwsem_down_read,
+	.read_delay     = torture_rwsem_read_delay,
+	.readunlock     = torture_percpu_rwsem_up_read,
+	.name		= "percpu_rwsem_favor_writers_lock"
+};
+
 /*
  * Lock torture writer kthread.  Repeatedly acquires and releases
  * the lock, checking for duplicate acquisitions.
@@ -912,6 +931,7 @@ static int __init lock_torture_init(void)
 #endif
 		&rwsem_lock_ops,
 		&percpu_rwsem_lock_ops,
+		&percpu_rwsem_favor_writers_lock_ops,
 	};
 
 	if (!torture_init_begin(torture_type, verbose))
@@ -45,6 +45,15 @@ do {									\
 	smp_store_release((l), 1)
 #endif
 
+#ifndef arch_mcs_lock_handoff
+/*
+ * As above, but pass an arbitrary non-zero value to the next waiter; used
+ * by the NUMA-aware qspinlock slowpath to hand over its secondary queue.
+ */
+#define arch_mcs_lock_handoff(l, val)					\
+	smp_store_release((l), (val))
+#endif
+
 /*
  * Note: the smp_load_acquire/smp_store_release pair is not
  * sufficient to form a full memory barrier across
@@ -8,6 +8,7 @@
 #include <linux/sched.h>
 #include <linux/sched/task.h>
 #include <linux/errno.h>
+#include <trace/events/lock.h>
 
 int __percpu_init_rwsem(struct percpu_rw_semaphore *sem,
 			const char *name, struct lock_class_key *key)
@@ -20,6 +21,7 @@ int __percpu_init_rwsem(struct percpu_rw_semaphore *sem,
 	rcuwait_init(&sem->writer);
 	init_waitqueue_head(&sem->waiters);
 	atomic_set(&sem->block, 0);
+	sem->favor_writers = false;
 #ifdef CONFIG_DEBUG_LOCK_ALLOC
 	debug_check_no_locks_freed((void *)sem, sizeof(*sem));
 	lockdep_init_map(&sem->dep_map, name, key, 0);
@@ -37,12 +39,32 @@ void percpu_free_rwsem(struct percpu_rw_semaphore *sem)
 	if (!sem->read_count)
 		return;
 
+	if (sem->favor_writers)
+		rcu_sync_exit(&sem->rss);
 	rcu_sync_dtor(&sem->rss);
 	free_percpu(sem->read_count);
 	sem->read_count = NULL; /* catch use after free bugs */
 }
 EXPORT_SYMBOL_GPL(percpu_free_rwsem);
 
+/**
+ * percpu_rwsem_favor_writers - make percpu_down_write() cheap
+ * @sem: the semaphore, initialized but not used yet
+ *
+ * By default percpu_down_write() waits for an RCU grace period, so that
+ * readers can get away with a plain per-CPU increment. For read-mostly
+ * locks that still see regular writers, keep the readers on the fully
+ * ordered per-CPU slowpath instead: they still only touch their own CPU's
+ * counter, while writers no longer wait for a grace period, only for the
+ * readers inside the critical section.
+ */
+void percpu_rwsem_favor_writers(struct percpu_rw_semaphore *sem)
+{
+	sem->favor_writers = true;
+	rcu_sync_enter_start(&sem->rss);
+}
+EXPORT_SYMBOL_GPL(percpu_rwsem_favor_writers);
+
 static bool __percpu_down_read_trylock(struct percpu_rw_semaphore *sem)
 {
 	this_cpu_inc(*sem->read_count);
@@ -170,9 +192,11 @@ bool __percpu_down_read(struct percpu_rw_semaphore *sem, bool try)
 	if (try)
 		return false;
 
+	trace_contention_begin(sem, LCB_F_PERCPU | LCB_F_READ);
 	preempt_enable();
 	percpu_rwsem_wait(sem, /* .reader = */ true);
 	preempt_disable();
+	trace_contention_end(sem, 0);
 
 	return true;
 }
@@ -216,6 +240,8 @@ void percpu_down_write(struct percpu_rw_semaphore *sem)
 	might_sleep();
 	rwsem_acquire(&sem->dep_map, 0, 0, _RET_IP_);
 
+	trace_contention_begin(sem, LCB_F_PERCPU | LCB_F_WRITE);
+
 	/* Notify readers to take the slow path. */
 	rcu_sync_enter(&sem->rss);
 
@@ -236,6 +262,7 @@ void percpu_down_write(struct percpu_rw_semaphore *sem)
 
 	/* Wait for all active readers to complete. */
 	rcuwait_wait_event(&sem->writer, readers_active_check(sem), TASK_UNINTERRUPTIBLE);
+	trace_contention_end(sem, 0);
 }
 EXPORT_SYMBOL_GPL(percpu_down_write);
 
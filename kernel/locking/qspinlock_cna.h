@@ -0,0 +1,308 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _GEN_CNA_LOCK_SLOWPATH
+#error "do not include this file"
+#endif
+
+#include <linux/topology.h>
+
+/*
+ * Implement a NUMA-aware version of MCS (aka CNA, or compact NUMA-aware lock).
+ *
+ * In CNA, spinning threads are organized in two queues, a primary queue for
+ * threads running on the same NUMA node as the current lock holder, and a
+ * secondary queue for threads running on other nodes. Schematically, it
+ * looks like this:
+ *
+ *    cna_node
+ *   +----------+     +--------+         +--------+
+ *   |mcs:next  | --> |mcs:next| --> ... |mcs:next| --> NULL  [Primary queue]
+ *   |mcs:locked| -.  +--------+         +--------+
+ *   +----------+  |
+ *                 `----------------------.
+ *                                        v
+ *                 +--------+         +--------+
+ *                 |mcs:next| --> ... |mcs:next|            [Secondary queue]
+ *                 +--------+         +--------+
+ *                     ^                    |
+ *                     `--------------------'
+ *
+ * N.B. locked := 1 if secondary queue is absent. Otherwise, it contains the
+ * encoded pointer to the tail of the secondary queue, which is organized as a
+ * circular list.
+ *
+ * While the queue head spins on the lock word, it moves waiters running on
+ * other NUMA nodes from the primary queue to the secondary queue, so that the
+ * MCS lock is handed over to a waiter on the same node whenever there is one.
+ * The secondary queue is spliced back in front of the primary queue when the
+ * primary queue runs empty, or after a bounded number of intra-node handoffs
+ * so that remote waiters cannot be starved.
+ *
+ * For more details, see https://arxiv.org/abs/1810.05600.
+ */
+
+struct cna_node {
+	struct mcs_spinlock	mcs;
+	int			numa_node;
+	u32			encoded_tail;	/* self */
+	u32			handoffs;	/* since the secondary queue formed */
+};
+
+/*
+ * Number of consecutive lock handoffs made while the secondary queue is not
+ * empty before it is spliced back into the primary queue. The default of
+ * 64K keeps the lock on one node for a few milliseconds at most under heavy
+ * contention.
+ */
+static unsigned int cna_handoff_threshold __ro_after_init = 1 << 16;
+
+static void __init cna_init_nodes_per_cpu(unsigned int cpu)
+{
+	struct mcs_spinlock *base = per_cpu_ptr(&qnodes[0].mcs, cpu);
+	int i;
+
+	for (i = 0; i < MAX_NODES; i++) {
+		struct cna_node *cn = (struct cna_node *)grab_mcs_node(base, i);
+
+		cn->numa_node = cpu_to_node(cpu);
+		cn->encoded_tail = encode_tail(cpu, i);
+		/*
+		 * make sure @encoded_tail is not confused with other valid
+		 * values for @locked (0 or 1)
+		 */
+		WARN_ON(cn->encoded_tail <= 1);
+	}
+}
+
+static void __init cna_init_nodes(void)
+{
+	unsigned int cpu;
+
+	/*
+	 * this will break on 32bit architectures, so we restrict
+	 * the use of CNA to 64bit only (see Kconfig)
+	 */
+	BUILD_BUG_ON(sizeof(struct cna_node) > sizeof(struct qnode));
+
+	for_each_possible_cpu(cpu)
+		cna_init_nodes_per_cpu(cpu);
+}
+
+/*
+ * @locked holds an encoded tail, which may not fit in a positive int;
+ * always look at it as unsigned.
+ */
+static __always_inline bool cna_has_secondary(struct mcs_spinlock *node)
+{
+	return (u32)node->locked > 1;
+}
+
+static __always_inline void cna_init_node(struct mcs_spinlock *node)
+{
+	((struct cna_node *)node)->handoffs = 0;
+}
+
+/*
+ * cna_splice_next -- splice the next node from the primary queue onto
+ * the secondary queue.
+ */
+static void cna_splice_next(struct mcs_spinlock *node,
+			    struct mcs_spinlock *next,
+			    struct mcs_spinlock *nnext)
+{
+	/* remove 'next' from the main queue */
+	node->next = nnext;
+
+	/* stick `next` on the secondary queue tail */
+	if (!cna_has_secondary(node)) {
+		/* create secondary queue */
+		next->next = next;
+	} else {
+		/* add to the tail of the secondary queue */
+		struct mcs_spinlock *tail_2nd = decode_tail(node->locked);
+		struct mcs_spinlock *head_2nd = tail_2nd->next;
+
+		tail_2nd->next = next;
+		next->next = head_2nd;
+	}
+
+	node->locked = ((struct cna_node *)next)->encoded_tail;
+	lockevent_inc(lock_cna_splice);
+}
+
+/*
+ * cna_order_queue - check whether the next waiter in the main queue is on
+ * the same NUMA node as the lock holder; if not, and it has a waiter behind
+ * it in the main queue, move the former onto the secondary queue.
+ * Returns true if the next waiter runs on the same NUMA node; false otherwise.
+ */
+static bool cna_order_queue(struct mcs_spinlock *node)
+{
+	struct mcs_spinlock *next = READ_ONCE(node->next);
+	struct mcs_spinlock *nnext;
+
+	if (!next)
+		return false;
+
+	if (((struct cna_node *)next)->numa_node ==
+	    ((struct cna_node *)node)->numa_node)
+		return true;
+
+	/*
+	 * The last waiter in the primary queue is also the lock tail and
+	 * cannot be moved without touching the lock word; leave it be.
+	 */
+	nnext = READ_ONCE(next->next);
+	if (nnext)
+		cna_splice_next(node, next, nnext);
+
+	return false;
+}
+
+/* Abuse the pv_wait_head_or_lock() hook to get some work done */
+static __always_inline u32 cna_wait_head_or_lock(struct qspinlock *lock,
+						 struct mcs_spinlock *node)
+{
+	struct cna_node *cn = (struct cna_node *)node;
+
+	/*
+	 * Try and put the time otherwise spent spin waiting on
+	 * _Q_LOCKED_PENDING_MASK to use by sorting our lists. Once the
+	 * threshold is reached, stop reordering so that the secondary
+	 * queue gets flushed at handoff time.
+	 */
+	if (cn->handoffs < cna_handoff_threshold) {
+		while ((atomic_read(&lock->val) & _Q_LOCKED_PENDING_MASK) &&
+		       !cna_order_queue(node))
+			cpu_relax();
+	}
+
+	return 0; /* we lock through the generic code */
+}
+
+/*
+ * cna_try_clear_tail - called when the lock holder is the last waiter in the
+ * primary queue. If the secondary queue is empty, clear the tail as usual.
+ * Otherwise, make the secondary queue the primary one and hand the MCS lock
+ * over to its head.
+ */
+static __always_inline bool cna_try_clear_tail(struct qspinlock *lock, u32 val,
+					       struct mcs_spinlock *node)
+{
+	struct mcs_spinlock *tail_2nd, *head_2nd;
+	u32 new;
+
+	/* if there are no waiters on the secondary queue, just clear the tail */
+	if (!cna_has_secondary(node))
+		return __try_clear_tail(lock, val, node);
+
+	tail_2nd = decode_tail(node->locked);
+	head_2nd = tail_2nd->next;
+	new = ((struct cna_node *)tail_2nd)->encoded_tail + _Q_LOCKED_VAL;
+
+	if (!atomic_try_cmpxchg_relaxed(&lock->val, &val, new))
+		return false;
+
+	/* the secondary queue is now the primary one; break the cycle */
+	tail_2nd->next = NULL;
+	((struct cna_node *)head_2nd)->handoffs = 0;
+
+	arch_mcs_lock_handoff(&head_2nd->locked, 1);
+	lockevent_inc(lock_cna_flush);
+
+	return true;
+}
+
+/*
+ * cna_pass_lock - hand the MCS lock over to the next waiter, which
+ * cna_order_queue() has made a waiter on the same node whenever possible,
+ * along with the secondary queue. Once the handoff threshold is reached, the
+ * secondary queue is put in front of the primary queue instead.
+ */
+static __always_inline void cna_pass_lock(struct mcs_spinlock *node,
+					  struct mcs_spinlock *next)
+{
+	struct cna_node *cn = (struct cna_node *)node;
+	u32 val = 1;
+
+	/* @next may have been moved to the secondary queue; reload it */
+	next = READ_ONCE(node->next);
+
+	if (cna_has_secondary(node)) {
+		if (cn->handoffs >= cna_handoff_threshold) {
+			struct mcs_spinlock *tail_2nd = decode_tail(node->locked);
+			struct mcs_spinlock *head_2nd = tail_2nd->next;
+
+			tail_2nd->next = next;
+			next = head_2nd;
+			lockevent_inc(lock_cna_flush);
+		} else {
+			val = node->locked;	/* preserve secondary queue */
+		}
+	}
+
+	((struct cna_node *)next)->handoffs = val > 1 ? cn->handoffs + 1 : 0;
+
+	if (((struct cna_node *)next)->numa_node == cn->numa_node)
+		lockevent_inc(lock_cna_intra);
+	else
+		lockevent_inc(lock_cna_inter);
+
+	arch_mcs_lock_handoff(&next->locked, val);
+}
+
+/*
+ * Constants used to decide whether to enable the NUMA-aware slowpath.
+ */
+enum {
+	NUMA_LOCKS_OFF,
+	NUMA_LOCKS_ON,
+	NUMA_LOCKS_AUTO,
+};
+
+static int numa_spinlock_flag __initdata = NUMA_LOCKS_AUTO;
+
+static int __init numa_spinlock_setup(char *str)
+{
+	if (!str)
+		return -EINVAL;
+
+	if (!strcmp(str, "auto")) {
+		numa_spinlock_flag = NUMA_LOCKS_AUTO;
+		return 0;
+	} else if (!strcmp(str, "on")) {
+		numa_spinlock_flag = NUMA_LOCKS_ON;
+		return 0;
+	} else if (!strcmp(str, "off")) {
+		numa_spinlock_flag = NUMA_LOCKS_OFF;
+		return 0;
+	}
+
+	return -EINVAL;
+}
+early_param("numa_spinlock", numa_spinlock_setup);
+
+static int __init numa_spinlock_threshold_setup(char *str)
+{
+	return kstrtouint(str, 0, &cna_handoff_threshold);
+}
+early_param("numa_spinlock_threshold", numa_spinlock_threshold_setup);
+
+/*
+ * Switch to the NUMA-friendly slow path for spinlocks when we have
+ * multiple NUMA nodes in native environment, unless the user has
+ * overridden this default behavior by setting the numa_spinlock flag.
+ */
+void __init cna_configure_spin_lock_slowpath(void)
+{
+	if (numa_spinlock_flag == NUMA_LOCKS_OFF ||
+	    (numa_spinlock_flag == NUMA_LOCKS_AUTO && nr_node_ids == 1) ||
+	    pv_ops.lock.queued_spin_lock_slowpath !=
+			native_queued_spin_lock_slowpath)
+		return;
+
+	cna_init_nodes();
+
+	pv_ops.lock.queued_spin_lock_slowpath = __cna_queued_spin_lock_slowpath;
+
+	pr_info("Enabling CNA spinlock\n");
+}
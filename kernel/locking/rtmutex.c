@@ -24,6 +24,8 @@
 #include <linux/sched/wake_q.h>
 #include <linux/ww_mutex.h>
 
+#include <trace/events/lock.h>
+
 #include "rtmutex_common.h"
 
 #ifndef WW_RT
@@ -1664,6 +1666,8 @@ static int __sched __rt_mutex_slowlock(struct rt_mutex_base *lock,
 		return 0;
 	}
 
+	trace_contention_begin(lock, LCB_F_RT);
+
 	set_current_state(state);
 
 	ret = task_blocks_on_rt_mutex(lock, waiter, current, ww_ctx, chwalk);
@@ -1688,6 +1692,9 @@ static int __sched __rt_mutex_slowlock(struct rt_mutex_base *lock,
 	 * unconditionally. We might have to fix that up.
 	 */
 	fixup_rt_mutex_waiters(lock, true);
+
+	trace_contention_end(lock, ret);
+
 	return ret;
 }
 
@@ -1767,6 +1774,8 @@ static void __sched rtlock_slowlock_locked(struct rt_mutex_base *lock)
 
 	rt_mutex_init_rtlock_waiter(&waiter);
 
+	trace_contention_begin(lock, LCB_F_RT);
+
 	/* Save current state and set state to TASK_RTLOCK_WAIT */
 	current_save_and_set_rtlock_wait_state();
 
@@ -1799,6 +1808,8 @@ static void __sched rtlock_slowlock_locked(struct rt_mutex_base *lock)
 	 */
 	fixup_rt_mutex_waiters(lock, true);
 	debug_rt_mutex_free_waiter(&waiter);
+
+	trace_contention_end(lock, 0);
 }
 
 static __always_inline void __sched rtlock_slowlock(struct rt_mutex_base *lock)
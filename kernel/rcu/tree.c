@@ -2965,7 +2965,7 @@ static void check_cb_ovld(struct rcu_data *rdp)
 
 /* Helper function for call_rcu() and friends.  */
 static void
-__call_rcu(struct rcu_head *head, rcu_callback_t func)
+__call_rcu(struct rcu_head *head, rcu_callback_t func, bool lazy)
 {
 	static atomic_t doublefrees;
 	unsigned long flags;
@@ -3006,7 +3006,7 @@ __call_rcu(struct rcu_head *head, rcu_callback_t func)
 	}
 
 	check_cb_ovld(rdp);
-	if (rcu_nocb_try_bypass(rdp, head, &was_alldone, flags))
+	if (rcu_nocb_try_bypass(rdp, head, &was_alldone, flags, lazy))
 		return; // Enqueued onto ->nocb_bypass, so just leave.
 	// If no-CBs CPU gets here, rcu_nocb_try_bypass() acquired ->nocb_lock.
 	rcu_segcblist_enqueue(&rdp->cblist, head);
@@ -3071,16 +3071,46 @@ __call_rcu(struct rcu_head *head, rcu_callback_t func)
  */
 void call_rcu(struct rcu_head *head, rcu_callback_t func)
 {
-	__call_rcu(head, func);
+	__call_rcu(head, func, false);
 }
 EXPORT_SYMBOL_GPL(call_rcu);
 
+#ifdef CONFIG_RCU_LAZY
+/**
+ * call_rcu_lazy() - Lazily queue an RCU callback.
+ * @head: structure to be used for queueing the RCU updates.
+ * @func: actual callback function to be invoked after the grace period
+ *
+ * Like call_rcu(), but on no-CBs CPUs the callback may be held back for
+ * up to rcutree.jiffies_till_flush before a grace period is started for
+ * it, so that bursts of callbacks share a single grace period instead of
+ * each waking up the grace-period machinery.  Use it only where the
+ * callback merely frees memory and nobody waits for it; memory pressure
+ * and rcu_barrier() flush lazy callbacks early.
+ */
+void call_rcu_lazy(struct rcu_head *head, rcu_callback_t func)
+{
+	__call_rcu(head, func, true);
+}
+EXPORT_SYMBOL_GPL(call_rcu_lazy);
+#endif
+
 
 /* Maximum number of jiffies to wait before draining a batch. */
 #define KFREE_DRAIN_JIFFIES (HZ / 50)
 #define KFREE_N_BATCHES 2
 #define FREE_N_CHANNELS 2
 
+/* Number of "Channel 3" objects handed to kfree_bulk() at a time. */
+#define KFREE_HEAD_BULK_ENTR 16
+
+/*
+ * Unbound, so that reclaim after a grace period runs in parallel on any
+ * housekeeping CPU instead of on the (possibly isolated) CPU that queued
+ * the objects.
+ */
+static struct workqueue_struct *rcu_reclaim_wq;
+
 /**
  * struct kvfree_rcu_bulk_data - single block to store kvfree_rcu() pointers
  * @nr_records: Number of active pointers in the array
@@ -3246,10 +3276,11 @@ static void kfree_rcu_work(struct work_struct *work)
 {
 	unsigned long flags;
 	struct kvfree_rcu_bulk_data *bkvhead[FREE_N_CHANNELS], *bnext;
+	void *objs[KFREE_HEAD_BULK_ENTR];
 	struct rcu_head *head, *next;
 	struct kfree_rcu_cpu *krcp;
 	struct kfree_rcu_cpu_work *krwp;
-	int i, j;
+	int i, j, nr_objs = 0;
 
 	krwp = container_of(to_rcu_work(work),
 			    struct kfree_rcu_cpu_work, rcu_work);
@@ -3309,7 +3340,8 @@ static void kfree_rcu_work(struct work_struct *work)
 	 * double-argument of kvfree_rcu().  This happens when the
 	 * page-cache is empty, which means that objects are instead
 	 * queued on a linked list through their rcu_head structures.
-	 * This list is named "Channel 3".
+	 * This list is named "Channel 3".  As for channel 1, kmalloc()ed
+	 * objects are returned to the slab allocator in batches.
 	 */
 	for (; head; head = next) {
 		unsigned long offset = (unsigned long)head->func;
@@ -3320,8 +3352,17 @@ static void kfree_rcu_work(struct work_struct *work)
 		rcu_lock_acquire(&rcu_callback_map);
 		trace_rcu_invoke_kvfree_callback(rcu_state.name, head, offset);
 
-		if (!WARN_ON_ONCE(!__is_kvfree_rcu_offset(offset)))
-			kvfree(ptr);
+		if (!WARN_ON_ONCE(!__is_kvfree_rcu_offset(offset))) {
+			if (is_vmalloc_addr(ptr))
+				vfree(ptr);
+			else
+				objs[nr_objs++] = ptr;
+		}
+
+		if (nr_objs == KFREE_HEAD_BULK_ENTR || (!next && nr_objs)) {
+			kfree_bulk(nr_objs, objs);
+			nr_objs = 0;
+		}
 
 		rcu_lock_release(&rcu_callback_map);
 		cond_resched_tasks_rcu_qs();
@@ -3398,7 +3439,7 @@ static void kfree_rcu_monitor(struct work_struct *work)
 			// be that the work is in the pending state when
 			// channels have been detached following by each
 			// other.
-			queue_rcu_work(system_wq, &krwp->rcu_work);
+			queue_rcu_work(rcu_reclaim_wq, &krwp->rcu_work);
 		}
 	}
 
@@ -3558,6 +3599,10 @@ void kvfree_call_rcu(struct rcu_head *head, rcu_callback_t func)
 
 	if (head) {
 		ptr = (void *) head - (unsigned long) func;
+
+		// Batch objects of caches with percpu sheaves there.
+		if (kfree_rcu_sheaf(ptr))
+			return;
 	} else {
 		/*
 		 * Please note there is a limitation for the head-less
@@ -3982,12 +4027,21 @@ static void rcu_barrier_func(void *cpu_in)
 {
 	uintptr_t cpu = (uintptr_t)cpu_in;
 	struct rcu_data *rdp = per_cpu_ptr(&rcu_data, cpu);
+	bool was_alldone, wake_nocb;
 
 	rcu_barrier_trace(TPS("IRQ"), -1, rcu_state.barrier_sequence);
 	rdp->barrier_head.func = rcu_barrier_callback;
 	debug_rcu_head_queue(&rdp->barrier_head);
 	rcu_nocb_lock(rdp);
+	/*
+	 * Flush the bypass and wake up the no-CBs GP kthread if that added
+	 * callbacks to an empty ->cblist, rather than waiting for the bypass
+	 * timer, which can be seconds away if only lazy callbacks are queued.
+	 */
+	was_alldone = rcu_rdp_is_offloaded(rdp) &&
+		      !rcu_segcblist_pend_cbs(&rdp->cblist);
 	WARN_ON_ONCE(!rcu_nocb_flush_bypass(rdp, NULL, jiffies));
+	wake_nocb = was_alldone && rcu_segcblist_pend_cbs(&rdp->cblist);
 	if (rcu_segcblist_entrain(&rdp->cblist, &rdp->barrier_head)) {
 		atomic_inc(&rcu_state.barrier_cpu_count);
 	} else {
@@ -3996,6 +4050,8 @@ static void rcu_barrier_func(void *cpu_in)
 				  rcu_state.barrier_sequence);
 	}
 	rcu_nocb_unlock(rdp);
+	if (wake_nocb)
+		wake_nocb_gp(rdp, false);
 }
 
 /**
@@ -4714,6 +4770,11 @@ static void __init kfree_rcu_batch_init(void)
 			rcu_delay_page_cache_fill_msec);
 	}
 
+	rcu_reclaim_wq = alloc_workqueue("kvfree_rcu_reclaim",
+					 WQ_UNBOUND | WQ_MEM_RECLAIM, 0);
+	if (WARN_ON(!rcu_reclaim_wq))
+		rcu_reclaim_wq = system_wq;
+
 	for_each_possible_cpu(cpu) {
 		struct kfree_rcu_cpu *krcp = per_cpu_ptr(&krc, cpu);
 
@@ -0,0 +1,171 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * BPF struct_ops hook for the placement of fair tasks.
+ *
+ * A registered struct sched_policy_ops gets the first say in
+ * select_task_rq_fair(); whatever it cannot legally use, CFS picks.
+ */
+#include <linux/bpf.h>
+#include <linux/bpf_verifier.h>
+#include <linux/btf.h>
+#include <linux/filter.h>
+#include <linux/sched/bpf.h>
+
+#include "sched.h"
+
+/* "extern" is to avoid sparse warning.  It is only used in bpf_struct_ops.c. */
+extern struct bpf_struct_ops bpf_sched_policy_ops;
+
+DEFINE_STATIC_KEY_FALSE(sched_policy_enabled);
+
+static struct sched_policy_ops __rcu *sched_policy;
+static DEFINE_MUTEX(sched_policy_mutex);
+
+int __sched_policy_select_cpu(struct task_struct *p, int prev_cpu, int wake_flags)
+{
+	struct sched_policy_ops *ops;
+	int cpu = -1;
+
+	rcu_read_lock();
+	ops = rcu_dereference(sched_policy);
+	if (ops)
+		cpu = ops->select_cpu(p, prev_cpu, wake_flags);
+	rcu_read_unlock();
+
+	if (cpu < 0 || cpu >= nr_cpu_ids)
+		return -1;
+
+	if (!cpumask_test_cpu(cpu, p->cpus_ptr) || !cpu_active(cpu))
+		return -1;
+
+	return cpu;
+}
+
+static int bpf_sched_policy_init(struct btf *btf)
+{
+	return 0;
+}
+
+static bool bpf_sched_policy_is_valid_access(int off, int size,
+					     enum bpf_access_type type,
+					     const struct bpf_prog *prog,
+					     struct bpf_insn_access_aux *info)
+{
+	if (off < 0 || off >= sizeof(__u64) * MAX_BPF_FUNC_ARGS)
+		return false;
+	if (type != BPF_READ)
+		return false;
+	if (off % size != 0)
+		return false;
+
+	return btf_ctx_access(off, size, type, prog, info);
+}
+
+static int bpf_sched_policy_btf_struct_access(struct bpf_verifier_log *log,
+					      const struct btf *btf,
+					      const struct btf_type *t, int off,
+					      int size, enum bpf_access_type atype,
+					      u32 *next_btf_id)
+{
+	if (atype == BPF_READ)
+		return btf_struct_access(log, btf, t, off, size, atype, next_btf_id);
+
+	bpf_log(log, "only read is supported\n");
+	return -EACCES;
+}
+
+static const struct bpf_func_proto *
+bpf_sched_policy_get_func_proto(enum bpf_func_id func_id,
+				const struct bpf_prog *prog)
+{
+	return bpf_base_func_proto(func_id);
+}
+
+static const struct bpf_verifier_ops bpf_sched_policy_verifier_ops = {
+	.get_func_proto		= bpf_sched_policy_get_func_proto,
+	.is_valid_access	= bpf_sched_policy_is_valid_access,
+	.btf_struct_access	= bpf_sched_policy_btf_struct_access,
+};
+
+static int bpf_sched_policy_init_member(const struct btf_type *t,
+					const struct btf_member *member,
+					void *kdata, const void *udata)
+{
+	const struct sched_policy_ops *uops;
+	struct sched_policy_ops *ops;
+	int prog_fd;
+	u32 moff;
+
+	uops = (const struct sched_policy_ops *)udata;
+	ops = (struct sched_policy_ops *)kdata;
+
+	moff = btf_member_bit_offset(t, member) / 8;
+	switch (moff) {
+	case offsetof(struct sched_policy_ops, name):
+		if (bpf_obj_name_cpy(ops->name, uops->name,
+				     sizeof(ops->name)) <= 0)
+			return -EINVAL;
+		return 1;
+	case offsetof(struct sched_policy_ops, select_cpu):
+		/* The only callback, so it is compulsory */
+		prog_fd = (int)(*(unsigned long *)(udata + moff));
+		if (!prog_fd)
+			return -EINVAL;
+		return 0;
+	}
+
+	return 0;
+}
+
+static int bpf_sched_policy_check_member(const struct btf_type *t,
+					 const struct btf_member *member)
+{
+	return 0;
+}
+
+static int bpf_sched_policy_reg(void *kdata)
+{
+	struct sched_policy_ops *ops = kdata;
+	int ret = 0;
+
+	mutex_lock(&sched_policy_mutex);
+	if (rcu_access_pointer(sched_policy)) {
+		ret = -EEXIST;
+		goto unlock;
+	}
+
+	rcu_assign_pointer(sched_policy, ops);
+	static_branch_enable(&sched_policy_enabled);
+	pr_debug("sched: BPF placement policy \"%s\" registered\n", ops->name);
+unlock:
+	mutex_unlock(&sched_policy_mutex);
+
+	return ret;
+}
+
+static void bpf_sched_policy_unreg(void *kdata)
+{
+	struct sched_policy_ops *ops = kdata;
+
+	mutex_lock(&sched_policy_mutex);
+	if (rcu_access_pointer(sched_policy) == ops) {
+		static_branch_disable(&sched_policy_enabled);
+		RCU_INIT_POINTER(sched_policy, NULL);
+		pr_debug("sched: BPF placement policy \"%s\" unregistered\n",
+			ops->name);
+	}
+	mutex_unlock(&sched_policy_mutex);
+
+	/* Wait for select_task_rq_fair() callers still using @ops */
+	synchronize_rcu();
+}
+
+struct bpf_struct_ops bpf_sched_policy_ops = {
+	.verifier_ops = &bpf_sched_policy_verifier_ops,
+	.reg = bpf_sched_policy_reg,
+	.unreg = bpf_sched_policy_unreg,
+	.check_member = bpf_sched_policy_check_member,
+	.init_member = bpf_sched_policy_init_member,
+	.init = bpf_sched_policy_init,
+	.name = "sched_policy_ops",
+};
@@ -866,6 +866,21 @@ static bool set_nr_if_polling(struct task_struct *p)
 #endif
 #endif
 
+/* Most wakeups wake_up_q() does with preemption disabled, per batch */
+#define TTWU_BATCH_MAX	32
+
+#ifdef CONFIG_SMP
+/* Wakelist IPI batching of wake_up_q(), see ttwu_batch_begin() */
+static DEFINE_PER_CPU(bool, ttwu_ipi_batch);
+static DEFINE_PER_CPU(cpumask_var_t, ttwu_ipi_mask);
+
+static bool ttwu_batch_begin(void);
+static void ttwu_batch_end(void);
+#else
+static inline bool ttwu_batch_begin(void) { return false; }
+static inline void ttwu_batch_end(void) { }
+#endif
+
 static bool __wake_q_add(struct wake_q_head *head, struct task_struct *task)
 {
 	struct wake_q_node *node = &task->wake_q;
@@ -934,6 +949,16 @@ void wake_q_add_safe(struct wake_q_head *head, struct task_struct *task)
 void wake_up_q(struct wake_q_head *head)
 {
 	struct wake_q_node *node = head->first;
+	unsigned int nr = 0;
+	bool batch;
+
+	/*
+	 * For fan-out wakeups, hold back the wakelist IPIs until a batch of
+	 * wakees is queued: each target then activates all of its wakees under
+	 * a single rq lock acquisition, instead of draining its wakelist and
+	 * getting IPI'ed again for every further wakee.
+	 */
+	batch = ttwu_batch_begin();
 
 	while (node != WAKE_Q_TAIL) {
 		struct task_struct *task;
@@ -949,7 +974,17 @@ void wake_up_q(struct wake_q_head *head)
 		 */
 		wake_up_process(task);
 		put_task_struct(task);
+
+		/* Do not hold off preemption for the whole of a long list */
+		if (batch && ++nr == TTWU_BATCH_MAX) {
+			ttwu_batch_end();
+			batch = ttwu_batch_begin();
+			nr = 0;
+		}
 	}
+
+	if (batch)
+		ttwu_batch_end();
 }
 
 /*
@@ -3537,6 +3572,9 @@ ttwu_stat(struct task_struct *p, int cpu, int wake_flags)
 		rcu_read_unlock();
 	}
 
+	if (cpus_share_cache(cpu, rq->cpu))
+		__schedstat_inc(p->stats.nr_wakeups_same_llc);
+
 	if (wake_flags & WF_MIGRATED)
 		__schedstat_inc(p->stats.nr_wakeups_migrate);
 #endif /* CONFIG_SMP */
@@ -3581,6 +3619,11 @@ static void ttwu_do_wakeup(struct rq *rq, struct task_struct *p, int wake_flags,
 		rq->wake_stamp = jiffies;
 		rq->wake_avg_idle = rq->avg_idle / 2;
 
+		if (rq->avg_wakeup_idle)
+			update_avg(&rq->avg_wakeup_idle, delta);
+		else
+			rq->avg_wakeup_idle = delta;
+
 		rq->idle_stamp = 0;
 	}
 #endif
@@ -3711,9 +3754,66 @@ static void __ttwu_queue_wakelist(struct task_struct *p, int cpu, int wake_flags
 	p->sched_remote_wakeup = !!(wake_flags & WF_MIGRATED);
 
 	WRITE_ONCE(rq->ttwu_pending, 1);
+
+	if (__this_cpu_read(ttwu_ipi_batch) && !in_interrupt()) {
+		if (__smp_call_single_queue_noipi(cpu, &p->wake_entry.llist))
+			__cpumask_set_cpu(cpu, this_cpu_cpumask_var_ptr(ttwu_ipi_mask));
+		return;
+	}
+
 	__smp_call_single_queue(cpu, &p->wake_entry.llist);
 }
 
+/*
+ * Start collecting the wakelist IPIs of this CPU's wakeups, rather than
+ * sending one per target. Returns false if batching is not possible;
+ * otherwise preemption stays disabled until ttwu_batch_end().
+ */
+static bool ttwu_batch_begin(void)
+{
+	if (!sched_feat(TTWU_BATCH_IPI) || in_interrupt())
+		return false;
+
+	preempt_disable();
+	if (__this_cpu_read(ttwu_ipi_batch)) {
+		preempt_enable();
+		return false;
+	}
+
+	__this_cpu_write(ttwu_ipi_batch, true);
+	return true;
+}
+
+/*
+ * Kick every CPU that got a wakelist entry queued during the batch, with a
+ * single multicast IPI where there are several. Polling idle CPUs only need
+ * TIF_NEED_RESCHED, exactly as in send_call_function_single_ipi().
+ */
+static void ttwu_batch_end(void)
+{
+	struct cpumask *mask = this_cpu_cpumask_var_ptr(ttwu_ipi_mask);
+	unsigned int nr;
+	int cpu;
+
+	__this_cpu_write(ttwu_ipi_batch, false);
+
+	for_each_cpu(cpu, mask) {
+		if (set_nr_if_polling(cpu_rq(cpu)->idle)) {
+			trace_sched_wake_idle_without_ipi(cpu);
+			__cpumask_clear_cpu(cpu, mask);
+		}
+	}
+
+	nr = cpumask_weight(mask);
+	if (nr == 1)
+		arch_send_call_function_single_ipi(cpumask_first(mask));
+	else if (nr > 1)
+		arch_send_call_function_ipi_mask(mask);
+
+	cpumask_clear(mask);
+	preempt_enable();
+}
+
 void wake_up_if_idle(int cpu)
 {
 	struct rq *rq = cpu_rq(cpu);
@@ -4273,7 +4373,9 @@ DEFINE_STATIC_KEY_FALSE(sched_numa_balancing);
 
 #ifdef CONFIG_NUMA_BALANCING
 
-void set_numabalancing_state(bool enabled)
+int sysctl_numa_balancing_mode;
+
+static void __set_numabalancing_state(bool enabled)
 {
 	if (enabled)
 		static_branch_enable(&sched_numa_balancing);
@@ -4281,13 +4383,22 @@ void set_numabalancing_state(bool enabled)
 		static_branch_disable(&sched_numa_balancing);
 }
 
+void set_numabalancing_state(bool enabled)
+{
+	if (enabled)
+		sysctl_numa_balancing_mode = NUMA_BALANCING_NORMAL;
+	else
+		sysctl_numa_balancing_mode = NUMA_BALANCING_DISABLED;
+	__set_numabalancing_state(enabled);
+}
+
 #ifdef CONFIG_PROC_SYSCTL
 int sysctl_numa_balancing(struct ctl_table *table, int write,
 			  void *buffer, size_t *lenp, loff_t *ppos)
 {
 	struct ctl_table t;
 	int err;
-	int state = static_branch_likely(&sched_numa_balancing);
+	int state = sysctl_numa_balancing_mode;
 
 	if (write && !capable(CAP_SYS_ADMIN))
 		return -EPERM;
@@ -4297,8 +4408,10 @@ int sysctl_numa_balancing(struct ctl_table *table, int write,
 	err = proc_dointvec_minmax(&t, write, buffer, lenp, ppos);
 	if (err < 0)
 		return err;
-	if (write)
-		set_numabalancing_state(state);
+	if (write) {
+		sysctl_numa_balancing_mode = state;
+		__set_numabalancing_state(state);
+	}
 	return err;
 }
 #endif
@@ -5088,6 +5201,40 @@ unsigned int nr_iowait_cpu(int cpu)
 	return atomic_read(&cpu_rq(cpu)->nr_iowait);
 }
 
+/*
+ * How long the scheduler expects @cpu, which is going idle, to stay idle
+ * before a task wakeup arrives: 0 if one is already queued, the average
+ * idle period ended by a task wakeup otherwise, and U64_MAX if it has no
+ * idea. The average is only trusted while the current idle period has
+ * not yet lasted twice as long; past that, whatever used to wake this CPU
+ * up is no longer doing so.
+ *
+ * Used by the cpuidle governors, which only see timers, to avoid entering
+ * a deep idle state right before a wakeup IPI.
+ */
+u64 sched_idle_wakeup_ns(int cpu)
+{
+#ifdef CONFIG_SMP
+	struct rq *rq = cpu_rq(cpu);
+	u64 avg, stamp;
+
+	if (!sched_feat(IDLE_WAKEUP_HINT))
+		return U64_MAX;
+
+	if (READ_ONCE(rq->ttwu_pending))
+		return 0;
+
+	avg = READ_ONCE(rq->avg_wakeup_idle);
+	stamp = READ_ONCE(rq->idle_stamp);
+	if (!avg || !stamp || sched_clock_cpu(cpu) - stamp > 2 * avg)
+		return U64_MAX;
+
+	return avg;
+#else
+	return U64_MAX;
+#endif
+}
+
 /*
  * IO-wait accounting, and how it's mostly bollocks (on SMP).
  *
@@ -9417,6 +9564,10 @@ void __init sched_init(void)
 			cpumask_size(), GFP_KERNEL, cpu_to_node(i));
 		per_cpu(select_idle_mask, i) = (cpumask_var_t)kzalloc_node(
 			cpumask_size(), GFP_KERNEL, cpu_to_node(i));
+#ifdef CONFIG_SMP
+		per_cpu(ttwu_ipi_mask, i) = (cpumask_var_t)kzalloc_node(
+			cpumask_size(), GFP_KERNEL, cpu_to_node(i));
+#endif
 	}
 #endif /* CONFIG_CPUMASK_OFFSTACK */
 
@@ -10632,6 +10783,18 @@ static int cpu_idle_write_s64(struct cgroup_subsys_state *css,
 {
 	return sched_group_set_idle(css_tg(css), idle);
 }
+
+static s64 cpu_latency_nice_read_s64(struct cgroup_subsys_state *css,
+				     struct cftype *cft)
+{
+	return css_tg(css)->latency_nice;
+}
+
+static int cpu_latency_nice_write_s64(struct cgroup_subsys_state *css,
+				      struct cftype *cft, s64 latency_nice)
+{
+	return sched_group_set_latency(css_tg(css), latency_nice);
+}
 #endif
 
 static struct cftype cpu_legacy_files[] = {
@@ -10646,6 +10809,11 @@ static struct cftype cpu_legacy_files[] = {
 		.read_s64 = cpu_idle_read_s64,
 		.write_s64 = cpu_idle_write_s64,
 	},
+	{
+		.name = "latency.nice",
+		.read_s64 = cpu_latency_nice_read_s64,
+		.write_s64 = cpu_latency_nice_write_s64,
+	},
 #endif
 #ifdef CONFIG_CFS_BANDWIDTH
 	{
@@ -10859,6 +11027,12 @@ static struct cftype cpu_files[] = {
 		.read_s64 = cpu_idle_read_s64,
 		.write_s64 = cpu_idle_write_s64,
 	},
+	{
+		.name = "latency.nice",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.read_s64 = cpu_latency_nice_read_s64,
+		.write_s64 = cpu_latency_nice_write_s64,
+	},
 #endif
 #ifdef CONFIG_CFS_BANDWIDTH
 	{
@@ -18,6 +18,7 @@
 struct sugov_tunables {
 	struct gov_attr_set	attr_set;
 	unsigned int		rate_limit_us;
+	bool			burst_boost;
 };
 
 struct sugov_policy {
@@ -42,6 +43,9 @@ struct sugov_policy {
 
 	bool			limits_changed;
 	bool			need_freq_update;
+
+	/* Time at which a burst asked for more capacity, 0 if none pending */
+	u64			burst_time;
 };
 
 struct sugov_cpu {
@@ -65,6 +69,12 @@ struct sugov_cpu {
 
 static DEFINE_PER_CPU(struct sugov_cpu, sugov_cpu);
 
+/*
+ * Number of tunables with burst_boost set. Not a static key, as tunables
+ * can be released from CPU hotplug callbacks.
+ */
+atomic_t sugov_nr_burst_boost = ATOMIC_INIT(0);
+
 /************************ Governor internals ***********************/
 
 static bool sugov_should_update_freq(struct sugov_policy *sg_policy, u64 time)
@@ -317,6 +327,45 @@ static inline void ignore_dl_rate_limit(struct sugov_cpu *sg_cpu)
 		sg_cpu->sg_policy->limits_changed = true;
 }
 
+/*
+ * A task starting a burst was enqueued (SCHED_CPUFREQ_BURST). If its uclamp_min
+ * boost or its estimated utilization, which util_est learns from the task's
+ * previous activations, raise the CPU's utilization above what the last
+ * frequency decision used, make sugov_should_update_freq() ignore the rate
+ * limit: short bursts would otherwise often be over before it expires.
+ */
+static inline void ignore_burst_rate_limit(struct sugov_cpu *sg_cpu, u64 time,
+					   unsigned int flags)
+{
+	struct sugov_policy *sg_policy = sg_cpu->sg_policy;
+	struct rq *rq = cpu_rq(sg_cpu->cpu);
+
+	if (!(flags & SCHED_CPUFREQ_BURST) ||
+	    !READ_ONCE(sg_policy->tunables->burst_boost))
+		return;
+
+	if (uclamp_rq_util_with(rq, cpu_util_cfs(rq), NULL) <= sg_cpu->util)
+		return;
+
+	if (!sg_policy->burst_time)
+		sg_policy->burst_time = time;
+	sg_policy->limits_changed = true;
+}
+
+/* Report how long a burst waited for the frequency decision serving it */
+static inline void sugov_burst_decided(struct sugov_cpu *sg_cpu, u64 time,
+				       unsigned long util)
+{
+	struct sugov_policy *sg_policy = sg_cpu->sg_policy;
+
+	if (!sg_policy->burst_time)
+		return;
+
+	trace_sugov_burst_decision(sg_cpu->cpu, util,
+				   time - sg_policy->burst_time);
+	sg_policy->burst_time = 0;
+}
+
 static inline bool sugov_update_single_common(struct sugov_cpu *sg_cpu,
 					      u64 time, unsigned int flags)
 {
@@ -324,12 +373,14 @@ static inline bool sugov_update_single_common(struct sugov_cpu *sg_cpu,
 	sg_cpu->last_update = time;
 
 	ignore_dl_rate_limit(sg_cpu);
+	ignore_burst_rate_limit(sg_cpu, time, flags);
 
 	if (!sugov_should_update_freq(sg_cpu->sg_policy, time))
 		return false;
 
 	sugov_get_util(sg_cpu);
 	sugov_iowait_apply(sg_cpu, time);
+	sugov_burst_decided(sg_cpu, time, sg_cpu->util);
 
 	return true;
 }
@@ -444,9 +495,11 @@ sugov_update_shared(struct update_util_data *hook, u64 time, unsigned int flags)
 	sg_cpu->last_update = time;
 
 	ignore_dl_rate_limit(sg_cpu);
+	ignore_burst_rate_limit(sg_cpu, time, flags);
 
 	if (sugov_should_update_freq(sg_policy, time)) {
 		next_f = sugov_next_freq_shared(sg_cpu, time);
+		sugov_burst_decided(sg_cpu, time, sg_cpu->util);
 
 		if (!sugov_update_next_freq(sg_policy, time, next_f))
 			goto unlock;
@@ -532,8 +585,40 @@ rate_limit_us_store(struct gov_attr_set *attr_set, const char *buf, size_t count
 
 static struct governor_attr rate_limit_us = __ATTR_RW(rate_limit_us);
 
+static ssize_t burst_boost_show(struct gov_attr_set *attr_set, char *buf)
+{
+	struct sugov_tunables *tunables = to_sugov_tunables(attr_set);
+
+	return sprintf(buf, "%u\n", tunables->burst_boost);
+}
+
+static ssize_t
+burst_boost_store(struct gov_attr_set *attr_set, const char *buf, size_t count)
+{
+	struct sugov_tunables *tunables = to_sugov_tunables(attr_set);
+	bool burst_boost;
+
+	if (kstrtobool(buf, &burst_boost))
+		return -EINVAL;
+
+	mutex_lock(&global_tunables_lock);
+	if (burst_boost != tunables->burst_boost) {
+		WRITE_ONCE(tunables->burst_boost, burst_boost);
+		if (burst_boost)
+			atomic_inc(&sugov_nr_burst_boost);
+		else
+			atomic_dec(&sugov_nr_burst_boost);
+	}
+	mutex_unlock(&global_tunables_lock);
+
+	return count;
+}
+
+static struct governor_attr burst_boost = __ATTR_RW(burst_boost);
+
 static struct attribute *sugov_attrs[] = {
 	&rate_limit_us.attr,
+	&burst_boost.attr,
 	NULL
 };
 ATTRIBUTE_GROUPS(sugov);
@@ -541,8 +626,12 @@ ATTRIBUTE_GROUPS(sugov);
 static void sugov_tunables_free(struct kobject *kobj)
 {
 	struct gov_attr_set *attr_set = container_of(kobj, struct gov_attr_set, kobj);
+	struct sugov_tunables *tunables = to_sugov_tunables(attr_set);
+
+	if (tunables->burst_boost)
+		atomic_dec(&sugov_nr_burst_boost);
 
-	kfree(to_sugov_tunables(attr_set));
+	kfree(tunables);
 }
 
 static struct kobj_type sugov_tunables_ktype = {
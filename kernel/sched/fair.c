@@ -1083,6 +1083,9 @@ unsigned int sysctl_numa_balancing_scan_size = 256;
 /* Scan @scan_size MB every @scan_period after an initial @scan_delay in ms */
 unsigned int sysctl_numa_balancing_scan_delay = 1000;
 
+/* Restrict the NUMA promotion throughput (MB/s) for each target node */
+unsigned int sysctl_numa_balancing_promote_rate_limit = 65536;
+
 struct numa_group {
 	refcount_t refcount;
 
@@ -1423,6 +1426,28 @@ static inline unsigned long group_weight(struct task_struct *p, int nid,
 	return 1000 * faults / total_faults;
 }
 
+/*
+ * Returns true if promoting @nr more pages into @pgdat in this one-second
+ * window would exceed @rate_limit pages.
+ */
+static bool numa_promotion_rate_limit(struct pglist_data *pgdat,
+				      unsigned long rate_limit, int nr)
+{
+	unsigned long nr_cand;
+	unsigned int now, start;
+
+	now = jiffies_to_msecs(jiffies);
+	mod_node_page_state(pgdat, PGPROMOTE_CANDIDATE, nr);
+	nr_cand = node_page_state(pgdat, PGPROMOTE_CANDIDATE);
+	start = pgdat->nbp_rl_start;
+	if (now - start > MSEC_PER_SEC &&
+	    cmpxchg(&pgdat->nbp_rl_start, start, now) == start)
+		pgdat->nbp_rl_nr_cand = nr_cand;
+	if (nr_cand - pgdat->nbp_rl_nr_cand >= rate_limit)
+		return true;
+	return false;
+}
+
 bool should_numa_migrate_memory(struct task_struct *p, struct page * page,
 				int src_nid, int dst_cpu)
 {
@@ -1430,6 +1455,22 @@ bool should_numa_migrate_memory(struct task_struct *p, struct page * page,
 	int dst_nid = cpu_to_node(dst_cpu);
 	int last_cpupid, this_cpupid;
 
+	/*
+	 * In memory tiering mode, a page on slow memory that is accessed
+	 * again is hot, whichever task touches it: promote it, but not
+	 * faster than the promotion rate limit allows.
+	 */
+	if ((sysctl_numa_balancing_mode & NUMA_BALANCING_MEMORY_TIERING) &&
+	    !node_is_toptier(src_nid)) {
+		unsigned long rate_limit;
+
+		rate_limit = sysctl_numa_balancing_promote_rate_limit <<
+			     (20 - PAGE_SHIFT);
+		return !numa_promotion_rate_limit(NODE_DATA(dst_nid),
+						  rate_limit,
+						  thp_nr_pages(page));
+	}
+
 	this_cpupid = cpu_pid_to_cpupid(dst_cpu, current->pid);
 	last_cpupid = page_cpupid_xchg_last(page, this_cpupid);
 
@@ -2650,6 +2691,14 @@ void task_numa_fault(int last_cpupid, int mem_node, int pages, int flags)
 	if (!p->mm)
 		return;
 
+	/*
+	 * In memory tiering mode, slow memory is promoted by hotness, not
+	 * by task placement, so its faults are not accounted to the task.
+	 */
+	if ((sysctl_numa_balancing_mode & NUMA_BALANCING_MEMORY_TIERING) &&
+	    !node_is_toptier(mem_node))
+		return;
+
 	/* Allocate buffer to track faults on a per-node basis */
 	if (unlikely(!p->numa_faults)) {
 		int size = sizeof(*p->numa_faults) *
@@ -4649,6 +4698,10 @@ check_preempt_tick(struct cfs_rq *cfs_rq, struct sched_entity *curr)
 	s64 delta;
 
 	ideal_runtime = sched_slice(cfs_rq, curr);
+	/* Latency sensitive entities run shorter slices, tolerant ones longer */
+	if (curr->latency_offset)
+		ideal_runtime = max_t(s64, (s64)ideal_runtime + curr->latency_offset,
+				      sysctl_sched_min_granularity);
 	delta_exec = curr->sum_exec_runtime - curr->prev_sum_exec_runtime;
 	if (delta_exec > ideal_runtime) {
 		resched_curr(rq_of(cfs_rq));
@@ -5817,10 +5870,19 @@ enqueue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 	/*
 	 * If in_iowait is set, the code below may not trigger any cpufreq
 	 * utilization updates, so do it here explicitly with the IOWAIT flag
-	 * passed.
+	 * passed. The same goes for a wakeup starting a burst, which
+	 * schedutil may want to ramp up for right away.
 	 */
-	if (p->in_iowait)
-		cpufreq_update_util(rq, SCHED_CPUFREQ_IOWAIT);
+	if (p->in_iowait || ((flags & ENQUEUE_WAKEUP) && sugov_burst_boost_enabled())) {
+		unsigned int cpufreq_flags = 0;
+
+		if (p->in_iowait)
+			cpufreq_flags |= SCHED_CPUFREQ_IOWAIT;
+		if ((flags & ENQUEUE_WAKEUP) && sugov_burst_boost_enabled())
+			cpufreq_flags |= SCHED_CPUFREQ_BURST;
+
+		cpufreq_update_util(rq, cpufreq_flags);
+	}
 
 	for_each_sched_entity(se) {
 		if (se->on_rq)
@@ -5982,6 +6044,9 @@ static void dequeue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 dequeue_throttle:
 	util_est_update(&rq->cfs, p, task_sleep);
 	hrtick_update(rq);
+
+	if (!rq->cfs.h_nr_running)
+		sched_rt_fair_idle(rq);
 }
 
 #ifdef CONFIG_SMP
@@ -6195,12 +6260,53 @@ wake_affine_weight(struct sched_domain *sd, struct task_struct *p,
 	return this_eff_load < prev_eff_load ? this_cpu : nr_cpumask_bits;
 }
 
+/*
+ * Tasks sharing an address space, or a wakee the waker keeps waking, are
+ * likely to share data with the waker. Must be evaluated before
+ * record_wakee() updates current->last_wakee.
+ */
+static int wake_cache_affine(struct task_struct *p)
+{
+	if (!sched_feat(WA_LLC))
+		return 0;
+
+	if (p->mm && p->mm == current->mm)
+		return 1;
+
+	return current->last_wakee == p;
+}
+
+/*
+ * Pack a data sharing wakee into the waker's LLC while that LLC still has an
+ * idle CPU the wakee may run on, instead of leaving it in another LLC on the
+ * strength of load alone. Once the LLC is saturated, placement is decided by
+ * load as usual.
+ */
+static bool wake_affine_llc(struct task_struct *p, int this_cpu, int prev_cpu)
+{
+	struct sched_domain_shared *sds;
+
+	if (cpus_share_cache(this_cpu, prev_cpu))
+		return false;
+
+	sds = rcu_dereference(per_cpu(sd_llc_shared, this_cpu));
+	if (!sds)
+		return false;
+
+	return cpumask_intersects(sds_idle_cpus(sds), p->cpus_ptr);
+}
+
 static int wake_affine(struct sched_domain *sd, struct task_struct *p,
-		       int this_cpu, int prev_cpu, int sync)
+		       int this_cpu, int prev_cpu, int sync, int cache_affine)
 {
 	int target = nr_cpumask_bits;
 
-	if (sched_feat(WA_IDLE))
+	if (cache_affine && wake_affine_llc(p, this_cpu, prev_cpu)) {
+		schedstat_inc(p->stats.nr_wakeups_llc_pack);
+		target = this_cpu;
+	}
+
+	if (sched_feat(WA_IDLE) && target == nr_cpumask_bits)
 		target = wake_affine_idle(this_cpu, prev_cpu, sync);
 
 	if (sched_feat(WA_WEIGHT) && target == nr_cpumask_bits)
@@ -6340,6 +6446,31 @@ static inline int __select_idle_cpu(int cpu, struct task_struct *p)
 	return -1;
 }
 
+/*
+ * Track whether this CPU is idle in sd_llc_shared->idle_cpus. Only the local
+ * CPU writes its own bit, and only when the state actually changes, so the
+ * shared cacheline is not dirtied on every pass through the idle loop.
+ */
+void update_idle_cpumask(struct rq *rq, bool idle)
+{
+	struct sched_domain_shared *sds;
+	int cpu = cpu_of(rq);
+
+	/*
+	 * Keep tracking with SIS_FILTER off too, so the mask is accurate as
+	 * soon as the feature gets turned back on.
+	 */
+	rcu_read_lock();
+	sds = rcu_dereference(per_cpu(sd_llc_shared, cpu));
+	if (sds && cpumask_test_cpu(cpu, sds_idle_cpus(sds)) != idle) {
+		if (idle)
+			cpumask_set_cpu(cpu, sds_idle_cpus(sds));
+		else
+			cpumask_clear_cpu(cpu, sds_idle_cpus(sds));
+	}
+	rcu_read_unlock();
+}
+
 #ifdef CONFIG_SCHED_SMT
 DEFINE_STATIC_KEY_FALSE(sched_smt_present);
 EXPORT_SYMBOL_GPL(sched_smt_present);
@@ -6491,6 +6622,12 @@ static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, bool
 
 	cpumask_and(cpus, sched_domain_span(sd), p->cpus_ptr);
 
+	if (sched_feat(SIS_FILTER)) {
+		sd_share = rcu_dereference(per_cpu(sd_llc_shared, target));
+		if (sd_share)
+			cpumask_and(cpus, cpus, sds_idle_cpus(sd_share));
+	}
+
 	if (sched_feat(SIS_PROP) && !has_idle_core) {
 		u64 avg_cost, avg_idle, span_avg;
 		unsigned long now = jiffies;
@@ -7160,6 +7297,7 @@ select_task_rq_fair(struct task_struct *p, int prev_cpu, int wake_flags)
 	int cpu = smp_processor_id();
 	int new_cpu = prev_cpu;
 	int want_affine = 0;
+	int cache_affine = 0;
 	/* SD_flags and WF_flags share the first nibble */
 	int sd_flag = wake_flags & 0xF;
 
@@ -7167,7 +7305,14 @@ select_task_rq_fair(struct task_struct *p, int prev_cpu, int wake_flags)
 	 * required for stable ->cpus_allowed
 	 */
 	lockdep_assert_held(&p->pi_lock);
+
+	new_cpu = sched_policy_select_cpu(p, prev_cpu, wake_flags);
+	if (new_cpu >= 0)
+		return new_cpu;
+	new_cpu = prev_cpu;
+
 	if (wake_flags & WF_TTWU) {
+		cache_affine = wake_cache_affine(p);
 		record_wakee(p);
 
 		if (sched_energy_enabled()) {
@@ -7189,7 +7334,8 @@ select_task_rq_fair(struct task_struct *p, int prev_cpu, int wake_flags)
 		if (want_affine && (tmp->flags & SD_WAKE_AFFINE) &&
 		    cpumask_test_cpu(prev_cpu, sched_domain_span(tmp))) {
 			if (cpu != prev_cpu)
-				new_cpu = wake_affine(tmp, p, cpu, prev_cpu, sync);
+				new_cpu = wake_affine(tmp, p, cpu, prev_cpu, sync,
+						      cache_affine);
 
 			sd = NULL; /* Prefer wake_affine over balance flags */
 			break;
@@ -7309,6 +7455,25 @@ static unsigned long wakeup_gran(struct sched_entity *se)
 	return calc_delta_fair(gran, se);
 }
 
+/*
+ * How much earlier than its vruntime says 'se' may preempt 'curr'.
+ *
+ * A negative latency offset is a latency requirement, so it is weighed
+ * against the one of 'curr'. A positive one only tells how much delay
+ * 'se' accepts, and makes it less eager to preempt.
+ */
+static long wakeup_latency_gran(struct sched_entity *curr,
+				struct sched_entity *se)
+{
+	long latency_offset = se->latency_offset;
+
+	if (latency_offset < 0 || curr->latency_offset < 0)
+		latency_offset -= curr->latency_offset;
+
+	return clamp_t(long, latency_offset, -(long)sysctl_sched_latency,
+		       (long)sysctl_sched_latency);
+}
+
 /*
  * Should 'se' preempt 'curr'.
  *
@@ -7328,6 +7493,9 @@ wakeup_preempt_entity(struct sched_entity *curr, struct sched_entity *se)
 {
 	s64 gran, vdiff = curr->vruntime - se->vruntime;
 
+	/* Take into account the latency offsets */
+	vdiff -= wakeup_latency_gran(curr, se);
+
 	if (vdiff <= 0)
 		return -1;
 
@@ -10575,6 +10743,31 @@ void update_max_interval(void)
 	max_load_balance_interval = HZ*num_online_cpus()/10;
 }
 
+static inline bool update_newidle_cost(struct sched_domain *sd, u64 cost)
+{
+	if (cost > sd->max_newidle_lb_cost) {
+		/*
+		 * Track max cost of a domain to make sure to not delay the
+		 * next wakeup on the CPU. Restart the decay period so that
+		 * a fresh maximum is not immediately decayed.
+		 */
+		sd->max_newidle_lb_cost = cost;
+		sd->next_decay_max_lb_cost = jiffies + HZ;
+	} else if (time_after(jiffies, sd->next_decay_max_lb_cost)) {
+		/*
+		 * Decay the newidle max times by ~1% per second to ensure that
+		 * it is not outdated and the current max cost is actually
+		 * shorter.
+		 */
+		sd->max_newidle_lb_cost = (sd->max_newidle_lb_cost * 253) / 256;
+		sd->next_decay_max_lb_cost = jiffies + HZ;
+
+		return true;
+	}
+
+	return false;
+}
+
 /*
  * It checks each scheduling domain to see if it is due to be balanced,
  * and initiates a balancing operation if so.
@@ -10598,14 +10791,10 @@ static void rebalance_domains(struct rq *rq, enum cpu_idle_type idle)
 	for_each_domain(cpu, sd) {
 		/*
 		 * Decay the newidle max times here because this is a regular
-		 * visit to all the domains. Decay ~1% per second.
+		 * visit to all the domains.
 		 */
-		if (time_after(jiffies, sd->next_decay_max_lb_cost)) {
-			sd->max_newidle_lb_cost =
-				(sd->max_newidle_lb_cost * 253) / 256;
-			sd->next_decay_max_lb_cost = jiffies + HZ;
+		if (update_newidle_cost(sd, 0))
 			need_decay = 1;
-		}
 		max_cost += sd->max_newidle_lb_cost;
 
 		/*
@@ -11162,9 +11351,9 @@ static int newidle_balance(struct rq *this_rq, struct rq_flags *rf)
 {
 	unsigned long next_balance = jiffies + HZ;
 	int this_cpu = this_rq->cpu;
+	u64 t0, t1, curr_cost = 0;
 	struct sched_domain *sd;
 	int pulled_task = 0;
-	u64 curr_cost = 0;
 
 	update_misfit_status(NULL, this_rq);
 
@@ -11195,47 +11384,61 @@ static int newidle_balance(struct rq *this_rq, struct rq_flags *rf)
 	 */
 	rq_unpin_lock(this_rq, rf);
 
-	if (this_rq->avg_idle < sysctl_sched_migration_cost ||
-	    !READ_ONCE(this_rq->rd->overload)) {
+	rcu_read_lock();
+	sd = rcu_dereference_check_sched_domain(this_rq->sd);
 
-		rcu_read_lock();
-		sd = rcu_dereference_check_sched_domain(this_rq->sd);
-		if (sd)
+	/*
+	 * Skip the whole balance, including the walk over the blocked
+	 * cfs_rqs in update_blocked_averages(), when our expected idle time
+	 * would not even cover the cost of balancing the lowest domain. That
+	 * cost includes update_blocked_averages(), which is what dominates on
+	 * hosts with many cgroups.
+	 */
+	if (!READ_ONCE(this_rq->rd->overload) ||
+	    (sd && this_rq->avg_idle < sd->max_newidle_lb_cost)) {
+
+		if (sd) {
+			if (READ_ONCE(this_rq->rd->overload))
+				schedstat_inc(sd->newidle_lb_skipped);
 			update_next_balance(sd, &next_balance);
+		}
 		rcu_read_unlock();
 
 		goto out;
 	}
+	rcu_read_unlock();
 
 	raw_spin_rq_unlock(this_rq);
 
+	t0 = sched_clock_cpu(this_cpu);
 	update_blocked_averages(this_cpu);
+
 	rcu_read_lock();
 	for_each_domain(this_cpu, sd) {
 		int continue_balancing = 1;
-		u64 t0, domain_cost;
+		u64 domain_cost;
+
+		update_next_balance(sd, &next_balance);
 
 		if (this_rq->avg_idle < curr_cost + sd->max_newidle_lb_cost) {
-			update_next_balance(sd, &next_balance);
+			schedstat_inc(sd->newidle_lb_skipped);
 			break;
 		}
 
 		if (sd->flags & SD_BALANCE_NEWIDLE) {
-			t0 = sched_clock_cpu(this_cpu);
 
 			pulled_task = load_balance(this_cpu, this_rq,
 						   sd, CPU_NEWLY_IDLE,
 						   &continue_balancing);
 
-			domain_cost = sched_clock_cpu(this_cpu) - t0;
-			if (domain_cost > sd->max_newidle_lb_cost)
-				sd->max_newidle_lb_cost = domain_cost;
+			t1 = sched_clock_cpu(this_cpu);
+			domain_cost = t1 - t0;
+			update_newidle_cost(sd, domain_cost);
 
 			curr_cost += domain_cost;
+			t0 = t1;
 		}
 
-		update_next_balance(sd, &next_balance);
-
 		/*
 		 * Stop searching for tasks to pull if there are
 		 * now runnable tasks on this rq.
@@ -12002,6 +12205,44 @@ int sched_group_set_idle(struct task_group *tg, long idle)
 	return 0;
 }
 
+/*
+ * Latency nice [-20, 19] maps to [-sysctl_sched_latency,
+ * sysctl_sched_latency) of wakeup preemption and slice bias.
+ */
+static long calc_latency_offset(long latency_nice)
+{
+	return div_s64((s64)sysctl_sched_latency * latency_nice,
+		       MAX_LATENCY_NICE + 1);
+}
+
+int sched_group_set_latency(struct task_group *tg, long latency_nice)
+{
+	long latency_offset;
+	int i;
+
+	if (tg == &root_task_group)
+		return -EINVAL;
+
+	if (latency_nice < MIN_LATENCY_NICE || latency_nice > MAX_LATENCY_NICE)
+		return -EINVAL;
+
+	mutex_lock(&shares_mutex);
+
+	if (tg->latency_nice == latency_nice) {
+		mutex_unlock(&shares_mutex);
+		return 0;
+	}
+
+	tg->latency_nice = latency_nice;
+	latency_offset = calc_latency_offset(latency_nice);
+
+	for_each_possible_cpu(i)
+		WRITE_ONCE(tg->se[i]->latency_offset, latency_offset);
+
+	mutex_unlock(&shares_mutex);
+	return 0;
+}
+
 #else /* CONFIG_FAIR_GROUP_SCHED */
 
 void free_fair_sched_group(struct task_group *tg) { }
@@ -52,12 +52,24 @@ SCHED_FEAT(NONTASK_CAPACITY, true)
  */
 SCHED_FEAT(TTWU_QUEUE, true)
 
+/*
+ * While wake_up_q() works through a batch of wakeups, collect the IPIs
+ * for the remote wakelists and send them together at the end.
+ */
+SCHED_FEAT(TTWU_BATCH_IPI, true)
+
 /*
  * When doing wakeups, attempt to limit superfluous scans of the LLC domain.
  */
 SCHED_FEAT(SIS_PROP, false)
 SCHED_FEAT(SIS_UTIL, true)
 
+/*
+ * Restrict the LLC scan in select_idle_cpu() to CPUs that are tracked as
+ * idle in sd_llc_shared->idle_cpus.
+ */
+SCHED_FEAT(SIS_FILTER, true)
+
 /*
  * Issue a WARN when we do multiple update_rq_clock() calls
  * in a single rq->lock section. Default disabled because the
@@ -79,13 +91,30 @@ SCHED_FEAT(RT_PUSH_IPI, true)
 #endif
 
 SCHED_FEAT(RT_RUNTIME_SHARE, false)
+/*
+ * Only throttle RT when there are fair tasks to give the CPU to.
+ */
+SCHED_FEAT(RT_THROTTLE_FAIR, true)
 SCHED_FEAT(LB_MIN, false)
 SCHED_FEAT(ATTACH_AGE_LOAD, true)
 
+/*
+ * Tell the cpuidle governors when a task wakeup is expected.
+ */
+SCHED_FEAT(IDLE_WAKEUP_HINT, true)
+
 SCHED_FEAT(WA_IDLE, true)
 SCHED_FEAT(WA_WEIGHT, true)
 SCHED_FEAT(WA_BIAS, true)
 
+/*
+ * Pull wakees that likely share data with the waker (same mm, or woken
+ * repeatedly by the same waker) into the waker's LLC while it still has
+ * idle CPUs, as tracked by the per-LLC idle cpumask, which is kept up to
+ * date whether or not SIS_FILTER is enabled.
+ */
+SCHED_FEAT(WA_LLC, false)
+
 /*
  * UtilEstimation. Use estimated CPU utilization.
  */
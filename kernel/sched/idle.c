@@ -189,7 +189,17 @@ static void cpuidle_idle_call(void)
 	 */
 
 	if (cpuidle_not_available(drv, dev)) {
-		tick_nohz_idle_stop_tick();
+		/*
+		 * There is no governor to tell whether stopping the tick pays
+		 * off, so go by how long idle has recently lasted on this CPU,
+		 * or already lasts this time: when the tick would fire before
+		 * we wake up anyway, stopping and restarting it only costs two
+		 * clockevent reprograms.
+		 */
+		if (tick_nohz_get_idle_prediction() < TICK_NSEC)
+			tick_nohz_idle_retain_tick();
+		else
+			tick_nohz_idle_stop_tick();
 
 		default_idle_call();
 		goto exit_idle;
@@ -431,10 +441,12 @@ static void check_preempt_curr_idle(struct rq *rq, struct task_struct *p, int fl
 
 static void put_prev_task_idle(struct rq *rq, struct task_struct *prev)
 {
+	update_idle_cpumask(rq, false);
 }
 
 static void set_next_task_idle(struct rq *rq, struct task_struct *next, bool first)
 {
+	update_idle_cpumask(rq, true);
 	update_idle_core(rq);
 	schedstat_inc(rq->sched_goidle);
 	queue_core_balance(rq);
@@ -195,6 +195,7 @@ static void group_init(struct psi_group *group)
 {
 	int cpu;
 
+	group->enabled = true;
 	for_each_possible_cpu(cpu)
 		seqcount_init(&per_cpu_ptr(group->pcpu, cpu)->seq);
 	group->avg_last_update = sched_clock();
@@ -709,8 +710,6 @@ static void psi_group_change(struct psi_group *group, int cpu,
 	 */
 	write_seqcount_begin(&groupc->seq);
 
-	record_times(groupc, now);
-
 	for (t = 0, m = clear; m; m &= ~(1 << t), t++) {
 		if (!(m & (1 << t)))
 			continue;
@@ -730,6 +729,26 @@ static void psi_group_change(struct psi_group *group, int cpu,
 		if (set & (1 << t))
 			groupc->tasks[t]++;
 
+	if (!group->enabled) {
+		/*
+		 * The task counts are kept up to date so that accounting
+		 * can be resumed at any time, but no stall times are
+		 * accumulated. On the first change after disabling,
+		 * conclude the current state and flush its time, so
+		 * that the aggregator does not see the live state go
+		 * backwards once accounting is re-enabled.
+		 */
+		if (unlikely(groupc->state_mask & (1 << PSI_NONIDLE)))
+			record_times(groupc, now);
+
+		groupc->state_mask = 0;
+
+		write_seqcount_end(&groupc->seq);
+		return;
+	}
+
+	record_times(groupc, now);
+
 	/* Calculate state mask representing active states */
 	for (s = 0; s < NR_PSI_STATES; s++) {
 		if (test_state(groupc->tasks, s))
@@ -956,6 +975,8 @@ void psi_memstall_leave(unsigned long *flags)
 #ifdef CONFIG_CGROUPS
 int psi_cgroup_alloc(struct cgroup *cgroup)
 {
+	struct cgroup *parent;
+
 	if (static_branch_likely(&psi_disabled))
 		return 0;
 
@@ -963,6 +984,12 @@ int psi_cgroup_alloc(struct cgroup *cgroup)
 	if (!cgroup->psi.pcpu)
 		return -ENOMEM;
 	group_init(&cgroup->psi);
+
+	/* Inherit the setting of a parent that has cgroup.pressure */
+	parent = cgroup_parent(cgroup);
+	if (parent && cgroup_parent(parent))
+		cgroup->psi.enabled = parent->psi.enabled;
+
 	return 0;
 }
 
@@ -977,6 +1004,40 @@ void psi_cgroup_free(struct cgroup *cgroup)
 	WARN_ONCE(cgroup->psi.poll_states, "psi: trigger leak\n");
 }
 
+/**
+ * psi_cgroup_set_enabled - turn stall time accounting of a cgroup on or off
+ * @cgroup: the cgroup
+ * @enabled: the new state
+ *
+ * The per-cpu task counts keep being maintained while accounting is off, so
+ * when turning it back on only the per-cpu states need to be recomputed from
+ * them, and the state times restarted from now. Caller holds cgroup_mutex.
+ */
+void psi_cgroup_set_enabled(struct cgroup *cgroup, bool enabled)
+{
+	struct psi_group *group = &cgroup->psi;
+	int cpu;
+
+	if (static_branch_likely(&psi_disabled))
+		return;
+
+	if (group->enabled == enabled)
+		return;
+
+	WRITE_ONCE(group->enabled, enabled);
+	if (!enabled)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		struct rq *rq = cpu_rq(cpu);
+		struct rq_flags rf;
+
+		rq_lock_irq(rq, &rf);
+		psi_group_change(group, cpu, 0, 0, cpu_clock(cpu), true);
+		rq_unlock_irq(rq, &rf);
+	}
+}
+
 /**
  * cgroup_move_task - move task to a different cgroup
  * @task: the task
@@ -1050,7 +1111,7 @@ int psi_show(struct seq_file *m, struct psi_group *group, enum psi_res res)
 	int full;
 	u64 now;
 
-	if (static_branch_likely(&psi_disabled))
+	if (static_branch_likely(&psi_disabled) || !group->enabled)
 		return -EOPNOTSUPP;
 
 	/* Update averages before reporting them */
@@ -1093,7 +1154,7 @@ struct psi_trigger *psi_trigger_create(struct psi_group *group,
 	u32 threshold_us;
 	u32 window_us;
 
-	if (static_branch_likely(&psi_disabled))
+	if (static_branch_likely(&psi_disabled) || !group->enabled)
 		return ERR_PTR(-EOPNOTSUPP);
 
 	if (sscanf(buf, "some %u %u", &threshold_us, &window_us) == 2)
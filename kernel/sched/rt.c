@@ -959,6 +959,41 @@ static inline int rt_se_prio(struct sched_rt_entity *rt_se)
 	return rt_task_of(rt_se)->prio;
 }
 
+/*
+ * Throttling the root RT runqueue only exists to leave some CPU time to
+ * the fair class. With no fair task runnable there is nobody to hand the
+ * time to, and throttling would just idle the CPU; let RT run on and
+ * throttle once a fair task shows up.
+ */
+static inline bool rt_rq_throttle_needed(struct rt_rq *rt_rq)
+{
+	struct rq *rq = rq_of_rt_rq(rt_rq);
+
+	if (!sched_feat(RT_THROTTLE_FAIR) || rt_rq != &rq->rt)
+		return true;
+
+	return rq->cfs.h_nr_running;
+}
+
+/*
+ * Called when the last fair task left @rq. If the root RT runqueue got
+ * throttled to make room for it, there is no point in waiting for the
+ * period timer to hand the CPU back.
+ */
+void sched_rt_fair_idle(struct rq *rq)
+{
+	struct rt_rq *rt_rq = &rq->rt;
+
+	if (!sched_feat(RT_THROTTLE_FAIR) || !rt_rq->rt_throttled)
+		return;
+
+	raw_spin_lock(&rt_rq->rt_runtime_lock);
+	rt_rq->rt_throttled = 0;
+	raw_spin_unlock(&rt_rq->rt_runtime_lock);
+
+	sched_rt_rq_enqueue(rt_rq);
+}
+
 static int sched_rt_runtime_exceeded(struct rt_rq *rt_rq)
 {
 	u64 runtime = sched_rt_runtime(rt_rq);
@@ -977,6 +1012,16 @@ static int sched_rt_runtime_exceeded(struct rt_rq *rt_rq)
 	if (rt_rq->rt_time > runtime) {
 		struct rt_bandwidth *rt_b = sched_rt_bandwidth(rt_rq);
 
+		if (!rt_rq_throttle_needed(rt_rq)) {
+			/*
+			 * Don't let the overrun pile up, or a fair task
+			 * showing up later would wait several periods
+			 * for do_sched_rt_period_timer() to pay it off.
+			 */
+			rt_rq->rt_time = runtime;
+			return 0;
+		}
+
 		/*
 		 * Don't actually throttle groups that have no runtime assigned
 		 * but accrue some time due to boosting.
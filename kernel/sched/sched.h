@@ -398,6 +398,9 @@ struct task_group {
 	/* A positive value indicates that this is a SCHED_IDLE group. */
 	int			idle;
 
+	/* Latency nice of the group's entities, see MAX_LATENCY_NICE */
+	int			latency_nice;
+
 #ifdef	CONFIG_SMP
 	/*
 	 * load_avg can be heavily contended at clock tick time, so put
@@ -509,6 +512,7 @@ extern void sched_move_task(struct task_struct *tsk);
 extern int sched_group_set_shares(struct task_group *tg, unsigned long shares);
 
 extern int sched_group_set_idle(struct task_group *tg, long idle);
+extern int sched_group_set_latency(struct task_group *tg, long latency_nice);
 
 #ifdef CONFIG_SMP
 extern void set_task_rq_fair(struct sched_entity *se,
@@ -1037,6 +1041,9 @@ struct rq {
 	unsigned long		wake_stamp;
 	u64			wake_avg_idle;
 
+	/* Uncapped avg_idle, for the cpuidle governors */
+	u64			avg_wakeup_idle;
+
 	/* This is used to determine avg_idle's max value */
 	u64			max_idle_balance_cost;
 
@@ -1370,6 +1377,43 @@ static inline void update_idle_core(struct rq *rq)
 static inline void update_idle_core(struct rq *rq) { }
 #endif
 
+#ifdef CONFIG_SMP
+extern void update_idle_cpumask(struct rq *rq, bool idle);
+#else
+static inline void update_idle_cpumask(struct rq *rq, bool idle) { }
+#endif
+
+#ifdef CONFIG_CPU_FREQ_GOV_SCHEDUTIL
+extern atomic_t sugov_nr_burst_boost;
+
+static inline bool sugov_burst_boost_enabled(void)
+{
+	return atomic_read(&sugov_nr_burst_boost);
+}
+#else
+static inline bool sugov_burst_boost_enabled(void)
+{
+	return false;
+}
+#endif
+
+#ifdef CONFIG_SCHED_BPF_POLICY
+DECLARE_STATIC_KEY_FALSE(sched_policy_enabled);
+extern int __sched_policy_select_cpu(struct task_struct *p, int prev_cpu, int wake_flags);
+
+static inline int sched_policy_select_cpu(struct task_struct *p, int prev_cpu, int wake_flags)
+{
+	if (static_branch_unlikely(&sched_policy_enabled))
+		return __sched_policy_select_cpu(p, prev_cpu, wake_flags);
+	return -1;
+}
+#else
+static inline int sched_policy_select_cpu(struct task_struct *p, int prev_cpu, int wake_flags)
+{
+	return -1;
+}
+#endif
+
 #ifdef CONFIG_FAIR_GROUP_SCHED
 static inline struct task_struct *task_of(struct sched_entity *se)
 {
@@ -2329,6 +2373,7 @@ extern void resched_cpu(int cpu);
 
 extern struct rt_bandwidth def_rt_bandwidth;
 extern void init_rt_bandwidth(struct rt_bandwidth *rt_b, u64 period, u64 runtime);
+extern void sched_rt_fair_idle(struct rq *rq);
 
 extern struct dl_bandwidth def_dl_bandwidth;
 extern void init_dl_bandwidth(struct dl_bandwidth *dl_b, u64 period, u64 runtime);
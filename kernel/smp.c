@@ -496,6 +496,16 @@ void __smp_call_single_queue(int cpu, struct llist_node *node)
 		send_call_function_single_ipi(cpu);
 }
 
+/*
+ * Like __smp_call_single_queue(), but leave the IPI to the caller, which
+ * must kick @cpu when this returns true, i.e. when @node was queued on an
+ * empty list. Used to batch the IPIs of several queued entries.
+ */
+bool __smp_call_single_queue_noipi(int cpu, struct llist_node *node)
+{
+	return llist_add(node, &per_cpu(call_single_queue, cpu));
+}
+
 /*
  * Insert a previously allocated call_single_data_t element
  * for execution on the given CPU. data must already have
@@ -916,8 +916,10 @@ static void tick_nohz_stop_tick(struct tick_sched *ts, int cpu)
 	/* Skip reprogram of event if its not changed */
 	if (ts->tick_stopped && (expires == ts->next_tick)) {
 		/* Sanity check: make sure clockevent is actually programmed */
-		if (tick == KTIME_MAX || ts->next_tick == hrtimer_get_expires(&ts->sched_timer))
+		if (tick == KTIME_MAX || ts->next_tick == hrtimer_get_expires(&ts->sched_timer)) {
+			ts->reprog_skipped++;
 			return;
+		}
 
 		WARN_ON_ONCE(1);
 		printk_once("basemono: %llu ts->next_tick: %llu dev->next_event: %llu timer->active: %d timer->expires: %llu\n",
@@ -1124,7 +1126,10 @@ void tick_nohz_idle_stop_tick(void)
 
 void tick_nohz_idle_retain_tick(void)
 {
-	tick_nohz_retain_tick(this_cpu_ptr(&tick_cpu_sched));
+	struct tick_sched *ts = this_cpu_ptr(&tick_cpu_sched);
+
+	tick_nohz_retain_tick(ts);
+	ts->idle_retained++;
 	/*
 	 * Undo the effect of get_next_timer_interrupt() called from
 	 * tick_nohz_next_event().
@@ -1151,6 +1156,7 @@ void tick_nohz_idle_enter(void)
 
 	ts->inidle = 1;
 	tick_nohz_start_idle(ts);
+	ts->idle_loop_entry = ts->idle_entrytime;
 
 	local_irq_enable();
 }
@@ -1187,6 +1193,41 @@ bool tick_nohz_idle_got_tick(void)
 	return false;
 }
 
+/**
+ * tick_nohz_get_idle_prediction - return the predicted idle duration
+ *
+ * The prediction is a running average of how long the recent idle loops on
+ * this CPU lasted, interrupts which did not end the idle loop included.
+ * Once the current idle loop has lasted longer than that, its elapsed time
+ * is returned instead, so a mispredicted long idle period still ends up
+ * with the tick stopped after about one tick.
+ * Callers which have no better estimate of their own can use it to decide
+ * whether stopping the tick is worth reprogramming the clockevent twice.
+ *
+ * Called with interrupts disabled from the idle task.
+ */
+ktime_t tick_nohz_get_idle_prediction(void)
+{
+	struct tick_sched *ts = this_cpu_ptr(&tick_cpu_sched);
+	ktime_t elapsed = ktime_sub(ktime_get(), ts->idle_loop_entry);
+
+	return max(ts->idle_predicted, elapsed);
+}
+
+/*
+ * Feed the length of the idle loop which just ended into the running
+ * average. Samples are capped at two ticks: all that matters is whether the
+ * next idle period is likely to outlast the tick, and a cap lets the average
+ * follow a workload switching back to short idle periods quickly.
+ */
+static void tick_nohz_update_idle_prediction(struct tick_sched *ts, ktime_t now)
+{
+	s64 sample = ktime_to_ns(ktime_sub(now, ts->idle_loop_entry));
+
+	sample = clamp_t(s64, sample, 0, 2 * TICK_NSEC);
+	ts->idle_predicted += (sample - ts->idle_predicted) >> 3;
+}
+
 /**
  * tick_nohz_get_next_hrtimer - return the next expiration time for the hrtimer
  * or the tick, whatever that expires first. Note that, if the tick has been
@@ -1335,8 +1376,10 @@ void tick_nohz_idle_exit(void)
 	if (idle_active || tick_stopped)
 		now = ktime_get();
 
-	if (idle_active)
+	if (idle_active) {
 		tick_nohz_stop_idle(ts, now);
+		tick_nohz_update_idle_prediction(ts, now);
+	}
 
 	if (tick_stopped)
 		tick_nohz_idle_update_tick(ts, now);
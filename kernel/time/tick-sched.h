@@ -68,6 +68,10 @@ struct tick_sched {
 	unsigned long			idle_jiffies;
 	unsigned long			idle_calls;
 	unsigned long			idle_sleeps;
+	unsigned long			idle_retained;
+	unsigned long			reprog_skipped;
+	ktime_t				idle_loop_entry;
+	ktime_t				idle_predicted;
 	ktime_t				idle_entrytime;
 	ktime_t				idle_waketime;
 	ktime_t				idle_exittime;
@@ -979,10 +979,14 @@ __mod_timer(struct timer_list *timer, unsigned long expires, unsigned int option
 		 */
 		long diff = timer->expires - expires;
 
-		if (!diff)
+		if (!diff) {
+			trace_timer_rearm(timer, expires, TIMER_REARM_UNCHANGED);
 			return 1;
-		if (options & MOD_TIMER_REDUCE && diff <= 0)
+		}
+		if (options & MOD_TIMER_REDUCE && diff <= 0) {
+			trace_timer_rearm(timer, expires, TIMER_REARM_KEPT);
 			return 1;
+		}
 
 		/*
 		 * We lock timer base and calculate the bucket index right
@@ -995,6 +999,7 @@ __mod_timer(struct timer_list *timer, unsigned long expires, unsigned int option
 
 		if (timer_pending(timer) && (options & MOD_TIMER_REDUCE) &&
 		    time_before_eq(timer->expires, expires)) {
+			trace_timer_rearm(timer, expires, TIMER_REARM_KEPT);
 			ret = 1;
 			goto out_unlock;
 		}
@@ -1012,6 +1017,7 @@ __mod_timer(struct timer_list *timer, unsigned long expires, unsigned int option
 				timer->expires = expires;
 			else if (time_after(timer->expires, expires))
 				timer->expires = expires;
+			trace_timer_rearm(timer, expires, TIMER_REARM_BUCKET);
 			ret = 1;
 			goto out_unlock;
 		}
@@ -1023,6 +1029,8 @@ __mod_timer(struct timer_list *timer, unsigned long expires, unsigned int option
 	ret = detach_if_pending(timer, base, false);
 	if (!ret && (options & MOD_TIMER_PENDING_ONLY))
 		goto out_unlock;
+	if (ret)
+		trace_timer_rearm(timer, expires, TIMER_REARM_REQUEUE);
 
 	new_base = get_target_base(base, timer->flags);
 
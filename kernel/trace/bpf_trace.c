@@ -17,6 +17,8 @@
 #include <linux/error-injection.h>
 #include <linux/btf_ids.h>
 #include <linux/bpf_lsm.h>
+#include <linux/sort.h>
+#include <linux/bsearch.h>
 
 #include <net/bpf_sk_storage.h>
 
@@ -77,6 +79,8 @@ u64 bpf_get_stack(u64 r1, u64 r2, u64 r3, u64 r4, u64 r5);
 static int bpf_btf_printf_prepare(struct btf_ptr *ptr, u32 btf_ptr_size,
 				  u64 flags, const struct btf **btf,
 				  s32 *btf_id);
+static u64 bpf_kprobe_multi_cookie(struct bpf_run_ctx *ctx);
+static u64 bpf_kprobe_multi_entry_ip(struct bpf_run_ctx *ctx);
 
 /**
  * trace_call_bpf - invoke BPF program
@@ -1008,6 +1012,30 @@ static const struct bpf_func_proto bpf_get_func_ip_proto_kprobe = {
 	.arg1_type	= ARG_PTR_TO_CTX,
 };
 
+BPF_CALL_1(bpf_get_func_ip_kprobe_multi, struct pt_regs *, regs)
+{
+	return bpf_kprobe_multi_entry_ip(current->bpf_ctx);
+}
+
+static const struct bpf_func_proto bpf_get_func_ip_proto_kprobe_multi = {
+	.func		= bpf_get_func_ip_kprobe_multi,
+	.gpl_only	= false,
+	.ret_type	= RET_INTEGER,
+	.arg1_type	= ARG_PTR_TO_CTX,
+};
+
+BPF_CALL_1(bpf_get_attach_cookie_kprobe_multi, struct pt_regs *, regs)
+{
+	return bpf_kprobe_multi_cookie(current->bpf_ctx);
+}
+
+static const struct bpf_func_proto bpf_get_attach_cookie_proto_kmulti = {
+	.func		= bpf_get_attach_cookie_kprobe_multi,
+	.gpl_only	= false,
+	.ret_type	= RET_INTEGER,
+	.arg1_type	= ARG_PTR_TO_CTX,
+};
+
 BPF_CALL_1(bpf_get_attach_cookie_trace, void *, ctx)
 {
 	struct bpf_trace_run_ctx *run_ctx;
@@ -1153,6 +1181,11 @@ bpf_tracing_func_proto(enum bpf_func_id func_id, const struct bpf_prog *prog)
 	}
 }
 
+static bool is_kprobe_multi(const struct bpf_prog *prog)
+{
+	return prog->expected_attach_type == BPF_TRACE_KPROBE_MULTI;
+}
+
 static const struct bpf_func_proto *
 kprobe_prog_func_proto(enum bpf_func_id func_id, const struct bpf_prog *prog)
 {
@@ -1165,12 +1198,19 @@ kprobe_prog_func_proto(enum bpf_func_id func_id, const struct bpf_prog *prog)
 		return &bpf_get_stack_proto;
 #ifdef CONFIG_BPF_KPROBE_OVERRIDE
 	case BPF_FUNC_override_return:
+		/* ftrace based multi attach doesn't support ip modification */
+		if (is_kprobe_multi(prog))
+			return NULL;
 		return &bpf_override_return_proto;
 #endif
 	case BPF_FUNC_get_func_ip:
-		return &bpf_get_func_ip_proto_kprobe;
+		return is_kprobe_multi(prog) ?
+			&bpf_get_func_ip_proto_kprobe_multi :
+			&bpf_get_func_ip_proto_kprobe;
 	case BPF_FUNC_get_attach_cookie:
-		return &bpf_get_attach_cookie_proto_trace;
+		return is_kprobe_multi(prog) ?
+			&bpf_get_attach_cookie_proto_kmulti :
+			&bpf_get_attach_cookie_proto_trace;
 	default:
 		return bpf_tracing_func_proto(func_id, prog);
 	}
@@ -2004,6 +2044,384 @@ int bpf_get_perf_event_info(const struct perf_event *event, u32 *prog_id,
 	return err;
 }
 
+#ifdef CONFIG_DYNAMIC_FTRACE_WITH_REGS
+#define MAX_KPROBE_MULTI_CNT (1U << 20)
+
+struct bpf_kprobe_multi_link {
+	struct bpf_link link;
+	struct ftrace_ops ops;
+	unsigned long *addrs;
+	u64 *cookies;
+	u32 cnt;
+};
+
+struct bpf_kprobe_multi_run_ctx {
+	struct bpf_run_ctx run_ctx;
+	struct bpf_kprobe_multi_link *link;
+	unsigned long entry_ip;
+};
+
+static void bpf_kprobe_multi_link_release(struct bpf_link *link)
+{
+	struct bpf_kprobe_multi_link *kmulti_link;
+
+	kmulti_link = container_of(link, struct bpf_kprobe_multi_link, link);
+	unregister_ftrace_function(&kmulti_link->ops);
+}
+
+static void bpf_kprobe_multi_link_dealloc(struct bpf_link *link)
+{
+	struct bpf_kprobe_multi_link *kmulti_link;
+
+	kmulti_link = container_of(link, struct bpf_kprobe_multi_link, link);
+	ftrace_free_filter(&kmulti_link->ops);
+	kvfree(kmulti_link->addrs);
+	kvfree(kmulti_link->cookies);
+	kfree(kmulti_link);
+}
+
+static const struct bpf_link_ops bpf_kprobe_multi_link_lops = {
+	.release = bpf_kprobe_multi_link_release,
+	.dealloc = bpf_kprobe_multi_link_dealloc,
+};
+
+struct bpf_kprobe_multi_cookie {
+	unsigned long addr;
+	u64 cookie;
+};
+
+static int bpf_kprobe_multi_addr_cmp(const void *a, const void *b)
+{
+	const unsigned long *addr_a = a, *addr_b = b;
+
+	if (*addr_a == *addr_b)
+		return 0;
+	return *addr_a < *addr_b ? -1 : 1;
+}
+
+/* Sort addrs and keep each cookie next to its address, so that
+ * bpf_get_attach_cookie() can find the cookie with a binary search
+ * on the entry ip.
+ */
+static int bpf_kprobe_multi_sort_cookies(unsigned long *addrs, u64 *cookies,
+					 u32 cnt)
+{
+	struct bpf_kprobe_multi_cookie *entries;
+	u32 i;
+
+	entries = kvmalloc_array(cnt, sizeof(*entries), GFP_KERNEL);
+	if (!entries)
+		return -ENOMEM;
+
+	for (i = 0; i < cnt; i++) {
+		entries[i].addr = addrs[i];
+		entries[i].cookie = cookies[i];
+	}
+	/* addr is the first member, so the address compare works on entries */
+	sort(entries, cnt, sizeof(*entries), bpf_kprobe_multi_addr_cmp, NULL);
+	for (i = 0; i < cnt; i++) {
+		addrs[i] = entries[i].addr;
+		cookies[i] = entries[i].cookie;
+	}
+
+	kvfree(entries);
+	return 0;
+}
+
+static u64 bpf_kprobe_multi_cookie(struct bpf_run_ctx *ctx)
+{
+	struct bpf_kprobe_multi_run_ctx *run_ctx;
+	struct bpf_kprobe_multi_link *link;
+	unsigned long *addr;
+
+	if (WARN_ON_ONCE(!ctx))
+		return 0;
+	run_ctx = container_of(ctx, struct bpf_kprobe_multi_run_ctx, run_ctx);
+	link = run_ctx->link;
+	if (!link->cookies)
+		return 0;
+	addr = bsearch(&run_ctx->entry_ip, link->addrs, link->cnt,
+		       sizeof(*link->addrs), bpf_kprobe_multi_addr_cmp);
+	if (!addr)
+		return 0;
+	return link->cookies[addr - link->addrs];
+}
+
+static u64 bpf_kprobe_multi_entry_ip(struct bpf_run_ctx *ctx)
+{
+	struct bpf_kprobe_multi_run_ctx *run_ctx;
+
+	if (WARN_ON_ONCE(!ctx))
+		return 0;
+	run_ctx = container_of(ctx, struct bpf_kprobe_multi_run_ctx, run_ctx);
+	return run_ctx->entry_ip;
+}
+
+static void
+kprobe_multi_link_handler(unsigned long ip, unsigned long parent_ip,
+			  struct ftrace_ops *ops, struct ftrace_regs *fregs)
+{
+	struct bpf_kprobe_multi_run_ctx run_ctx = {
+		.link = container_of(ops, struct bpf_kprobe_multi_link, ops),
+		.entry_ip = ip,
+	};
+	struct pt_regs *regs = ftrace_get_regs(fregs);
+	struct bpf_run_ctx *old_run_ctx;
+	int bit;
+
+	bit = ftrace_test_recursion_trylock(ip, parent_ip);
+	if (bit < 0)
+		return;
+
+	preempt_disable_notrace();
+	/* Same policy as trace_call_bpf(): don't nest BPF programs */
+	if (unlikely(__this_cpu_inc_return(bpf_prog_active) != 1))
+		goto out;
+
+	rcu_read_lock();
+	old_run_ctx = bpf_set_run_ctx(&run_ctx.run_ctx);
+	bpf_prog_run(run_ctx.link->link.prog, regs);
+	bpf_reset_run_ctx(old_run_ctx);
+	rcu_read_unlock();
+
+ out:
+	__this_cpu_dec(bpf_prog_active);
+	preempt_enable_notrace();
+	ftrace_test_recursion_unlock(bit);
+}
+
+struct kprobe_multi_resolve {
+	char **syms;
+	u32 *idx;
+	unsigned long *addrs;
+	u32 cnt;
+	u32 found;
+};
+
+static int kprobe_multi_sym_cmp(const void *a, const void *b, const void *priv)
+{
+	const struct kprobe_multi_resolve *res = priv;
+
+	return strcmp(res->syms[*(const u32 *)a], res->syms[*(const u32 *)b]);
+}
+
+static int kprobe_multi_resolve_cb(void *data, const char *name,
+				   struct module *mod, unsigned long addr)
+{
+	struct kprobe_multi_resolve *res = data;
+	u32 lo = 0, hi = res->cnt, mid;
+	int cmp;
+
+	/* res->idx is sorted by symbol name */
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		cmp = strcmp(name, res->syms[res->idx[mid]]);
+		if (!cmp) {
+			if (!res->addrs[res->idx[mid]]) {
+				res->addrs[res->idx[mid]] = addr;
+				res->found++;
+			}
+			break;
+		}
+		if (cmp < 0)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	/* stop the walk once every symbol is resolved */
+	return res->found == res->cnt;
+}
+
+/* Resolve all symbols with a single walk over the vmlinux symbol table;
+ * doing a kallsyms_lookup_name() per symbol is quadratic and takes
+ * seconds for a few thousand functions. Symbols not found in vmlinux,
+ * i.e. module functions, fall back to kallsyms_lookup_name().
+ */
+static int
+kprobe_multi_resolve_syms(const void __user *usyms, u32 cnt,
+			  unsigned long *addrs)
+{
+	struct kprobe_multi_resolve res = {
+		.addrs = addrs,
+		.cnt = cnt,
+	};
+	const char __user **syms;
+	unsigned long addr, size;
+	int err = -ENOMEM;
+	u32 i;
+
+	syms = kvmalloc_array(cnt, sizeof(*syms), GFP_KERNEL);
+	res.syms = kvcalloc(cnt, sizeof(*res.syms), GFP_KERNEL);
+	res.idx = kvmalloc_array(cnt, sizeof(*res.idx), GFP_KERNEL);
+	if (!syms || !res.syms || !res.idx)
+		goto error;
+
+	if (copy_from_user(syms, usyms, cnt * sizeof(*syms))) {
+		err = -EFAULT;
+		goto error;
+	}
+
+	for (i = 0; i < cnt; i++) {
+		res.syms[i] = strndup_user(syms[i], KSYM_NAME_LEN);
+		if (IS_ERR(res.syms[i])) {
+			err = PTR_ERR(res.syms[i]);
+			res.syms[i] = NULL;
+			goto error;
+		}
+		res.idx[i] = i;
+		addrs[i] = 0;
+		cond_resched();
+	}
+
+	sort_r(res.idx, cnt, sizeof(*res.idx), kprobe_multi_sym_cmp, NULL, &res);
+	kallsyms_on_each_symbol(kprobe_multi_resolve_cb, &res);
+
+	err = -EINVAL;
+	for (i = 0; i < cnt; i++) {
+		addr = addrs[i] ?: kallsyms_lookup_name(res.syms[i]);
+		if (!addr)
+			goto error;
+		if (!kallsyms_lookup_size_offset(addr, &size, NULL))
+			goto error;
+		addr = ftrace_location_range(addr, addr + size - 1);
+		if (!addr)
+			goto error;
+		addrs[i] = addr;
+	}
+	err = 0;
+
+error:
+	if (res.syms) {
+		for (i = 0; i < cnt; i++)
+			kfree(res.syms[i]);
+	}
+	kvfree(res.idx);
+	kvfree(res.syms);
+	kvfree(syms);
+	return err;
+}
+
+int bpf_kprobe_multi_link_attach(const union bpf_attr *attr, struct bpf_prog *prog)
+{
+	struct bpf_kprobe_multi_link *link = NULL;
+	struct bpf_link_primer link_primer;
+	void __user *ucookies;
+	unsigned long *addrs;
+	u32 flags, cnt, size;
+	void __user *uaddrs;
+	u64 *cookies = NULL;
+	void __user *usyms;
+	int err;
+
+	/* no support for 32bit archs yet */
+	if (sizeof(u64) != sizeof(void *))
+		return -EOPNOTSUPP;
+
+	if (prog->expected_attach_type != BPF_TRACE_KPROBE_MULTI)
+		return -EINVAL;
+
+	/* no return probes yet, flags are reserved */
+	flags = attr->link_create.kprobe_multi.flags;
+	if (flags)
+		return -EINVAL;
+
+	uaddrs = u64_to_user_ptr(attr->link_create.kprobe_multi.addrs);
+	usyms = u64_to_user_ptr(attr->link_create.kprobe_multi.syms);
+	if (!!uaddrs == !!usyms)
+		return -EINVAL;
+
+	cnt = attr->link_create.kprobe_multi.cnt;
+	if (!cnt)
+		return -EINVAL;
+	if (cnt > MAX_KPROBE_MULTI_CNT)
+		return -E2BIG;
+
+	size = cnt * sizeof(*addrs);
+	addrs = kvmalloc(size, GFP_KERNEL);
+	if (!addrs)
+		return -ENOMEM;
+
+	if (uaddrs) {
+		if (copy_from_user(addrs, uaddrs, size)) {
+			err = -EFAULT;
+			goto error;
+		}
+	} else {
+		err = kprobe_multi_resolve_syms(usyms, cnt, addrs);
+		if (err)
+			goto error;
+	}
+
+	ucookies = u64_to_user_ptr(attr->link_create.kprobe_multi.cookies);
+	if (ucookies) {
+		cookies = kvmalloc_array(cnt, sizeof(*cookies), GFP_KERNEL);
+		if (!cookies) {
+			err = -ENOMEM;
+			goto error;
+		}
+		if (copy_from_user(cookies, ucookies, cnt * sizeof(*cookies))) {
+			err = -EFAULT;
+			goto error;
+		}
+		err = bpf_kprobe_multi_sort_cookies(addrs, cookies, cnt);
+		if (err)
+			goto error;
+	}
+
+	link = kzalloc(sizeof(*link), GFP_KERNEL);
+	if (!link) {
+		err = -ENOMEM;
+		goto error;
+	}
+
+	bpf_link_init(&link->link, BPF_LINK_TYPE_KPROBE_MULTI,
+		      &bpf_kprobe_multi_link_lops, prog);
+
+	err = bpf_link_prime(&link->link, &link_primer);
+	if (err)
+		goto error;
+
+	link->ops.func = kprobe_multi_link_handler;
+	link->ops.flags = FTRACE_OPS_FL_SAVE_REGS;
+	link->addrs = addrs;
+	link->cookies = cookies;
+	link->cnt = cnt;
+
+	/* one filter hash update for all addresses, then one ops
+	 * registration, instead of one kprobe per function
+	 */
+	err = ftrace_set_filter_ips(&link->ops, addrs, cnt, 0, 0);
+	if (!err)
+		err = register_ftrace_function(&link->ops);
+	if (err) {
+		/* dealloc frees the filter, addrs and cookies */
+		bpf_link_cleanup(&link_primer);
+		return err;
+	}
+
+	return bpf_link_settle(&link_primer);
+
+error:
+	kfree(link);
+	kvfree(addrs);
+	kvfree(cookies);
+	return err;
+}
+#else /* !CONFIG_DYNAMIC_FTRACE_WITH_REGS */
+int bpf_kprobe_multi_link_attach(const union bpf_attr *attr, struct bpf_prog *prog)
+{
+	return -EOPNOTSUPP;
+}
+static u64 bpf_kprobe_multi_cookie(struct bpf_run_ctx *ctx)
+{
+	return 0;
+}
+static u64 bpf_kprobe_multi_entry_ip(struct bpf_run_ctx *ctx)
+{
+	return 0;
+}
+#endif
+
 static int __init send_signal_irq_work_init(void)
 {
 	int cpu;
@@ -26,8 +26,10 @@
 #include <linux/list.h>
 #include <linux/cpu.h>
 #include <linux/oom.h>
+#include <linux/mm.h>
 
 #include <asm/local.h>
+#include <asm/cacheflush.h>
 
 static void update_pages_handler(struct work_struct *work);
 
@@ -323,6 +325,7 @@ struct buffer_page {
 	unsigned	 read;		/* index for next read */
 	local_t		 entries;	/* entries on this page */
 	unsigned long	 real_end;	/* real end of data */
+	unsigned	 id;		/* ID for external mapping */
 	struct buffer_data_page *page;	/* Actual data page */
 };
 
@@ -529,6 +532,12 @@ struct ring_buffer_per_cpu {
 	struct completion		update_done;
 
 	struct rb_irq_work		irq_work;
+
+	/* user space mapping, see ring_buffer_map() */
+	unsigned int			mapped;
+	struct mutex			mapping_lock;
+	unsigned long			*subbuf_ids;	/* ID to subbuf VA */
+	struct trace_buffer_meta	*meta_page;
 };
 
 struct trace_buffer {
@@ -1702,6 +1711,7 @@ rb_allocate_cpu_buffer(struct trace_buffer *buffer, long nr_pages, int cpu)
 	init_irq_work(&cpu_buffer->irq_work.work, rb_wake_up_waiters);
 	init_waitqueue_head(&cpu_buffer->irq_work.waiters);
 	init_waitqueue_head(&cpu_buffer->irq_work.full_waiters);
+	mutex_init(&cpu_buffer->mapping_lock);
 
 	bpage = kzalloc_node(ALIGN(sizeof(*bpage), cache_line_size()),
 			    GFP_KERNEL, cpu_to_node(cpu));
@@ -4488,6 +4498,22 @@ rb_update_iter_read_stamp(struct ring_buffer_iter *iter,
 	return;
 }
 
+static void rb_update_meta_page(struct ring_buffer_per_cpu *cpu_buffer)
+{
+	struct trace_buffer_meta *meta = cpu_buffer->meta_page;
+
+	meta->reader.read = cpu_buffer->reader_page->read;
+	meta->reader.id = cpu_buffer->reader_page->id;
+	meta->reader.lost_events = cpu_buffer->lost_events;
+
+	meta->entries = local_read(&cpu_buffer->entries);
+	meta->overrun = local_read(&cpu_buffer->overrun);
+	meta->read = cpu_buffer->read;
+
+	/* Some archs do not have data cache coherency between kernel and user-space */
+	flush_dcache_page(virt_to_page(meta));
+}
+
 static struct buffer_page *
 rb_get_reader_page(struct ring_buffer_per_cpu *cpu_buffer)
 {
@@ -5251,6 +5277,9 @@ rb_reset_cpu(struct ring_buffer_per_cpu *cpu_buffer)
 
 	rb_head_page_activate(cpu_buffer);
 	cpu_buffer->pages_removed = 0;
+
+	if (cpu_buffer->mapped)
+		rb_update_meta_page(cpu_buffer);
 }
 
 /* Must have disabled the cpu buffer then done a synchronize_rcu */
@@ -5468,6 +5497,11 @@ int ring_buffer_swap_cpu(struct trace_buffer *buffer_a,
 	if (cpu_buffer_a->nr_pages != cpu_buffer_b->nr_pages)
 		goto out;
 
+	/* user space mappings point at the pages of a fixed cpu_buffer */
+	ret = -EBUSY;
+	if (READ_ONCE(cpu_buffer_a->mapped) || READ_ONCE(cpu_buffer_b->mapped))
+		goto out;
+
 	ret = -EAGAIN;
 
 	if (atomic_read(&buffer_a->record_disabled))
@@ -5692,12 +5726,14 @@ int ring_buffer_read_page(struct trace_buffer *buffer,
 	/*
 	 * If this page has been partially read or
 	 * if len is not big enough to read the rest of the page or
-	 * a writer is still on the page, then
+	 * a writer is still on the page or
+	 * the pages are mapped to user space, then
 	 * we must copy the data from the page to the buffer.
 	 * Otherwise, we can simply swap the page with the one passed in.
 	 */
 	if (read || (len < (commit - read)) ||
-	    cpu_buffer->reader_page == cpu_buffer->commit_page) {
+	    cpu_buffer->reader_page == cpu_buffer->commit_page ||
+	    cpu_buffer->mapped) {
 		struct buffer_data_page *rpage = cpu_buffer->reader_page->page;
 		unsigned int rpos = read;
 		unsigned int pos = 0;
@@ -5711,7 +5747,8 @@ int ring_buffer_read_page(struct trace_buffer *buffer,
 		 */
 		if (full &&
 		    (!read || (len < (commit - read)) ||
-		     cpu_buffer->reader_page == cpu_buffer->commit_page))
+		     cpu_buffer->reader_page == cpu_buffer->commit_page ||
+		     cpu_buffer->mapped))
 			goto out_unlock;
 
 		if (len > (commit - read))
@@ -5814,6 +5851,314 @@ int ring_buffer_read_page(struct trace_buffer *buffer,
 }
 EXPORT_SYMBOL_GPL(ring_buffer_read_page);
 
+static void rb_setup_ids_meta_page(struct ring_buffer_per_cpu *cpu_buffer,
+				   unsigned long *subbuf_ids)
+{
+	struct trace_buffer_meta *meta = cpu_buffer->meta_page;
+	unsigned int nr_subbufs = cpu_buffer->nr_pages + 1;
+	struct buffer_page *first_subbuf, *subbuf;
+	int id = 0;
+
+	/* The reader page is always ID 0, the ring follows from the head */
+	subbuf_ids[id] = (unsigned long)cpu_buffer->reader_page->page;
+	cpu_buffer->reader_page->id = id++;
+
+	first_subbuf = subbuf = rb_set_head_page(cpu_buffer);
+	do {
+		if (RB_WARN_ON(cpu_buffer, id >= nr_subbufs))
+			break;
+
+		subbuf_ids[id] = (unsigned long)subbuf->page;
+		subbuf->id = id;
+
+		rb_inc_page(&subbuf);
+		id++;
+	} while (subbuf != first_subbuf);
+
+	/* Data pages never leave the buffer while mapped, IDs are now stable */
+	cpu_buffer->subbuf_ids = subbuf_ids;
+
+	meta->meta_page_size = PAGE_SIZE;
+	meta->meta_struct_len = sizeof(*meta);
+	meta->nr_subbufs = nr_subbufs;
+	meta->subbuf_size = PAGE_SIZE;
+
+	rb_update_meta_page(cpu_buffer);
+}
+
+static int __rb_map_vma(struct ring_buffer_per_cpu *cpu_buffer,
+			struct vm_area_struct *vma)
+{
+	unsigned long nr_pages, pgoff = vma->vm_pgoff;
+	struct page **pages;
+	unsigned long i;
+	int err;
+
+	lockdep_assert_held(&cpu_buffer->mapping_lock);
+
+	if (vma->vm_flags & (VM_WRITE | VM_EXEC) ||
+	    !(vma->vm_flags & VM_MAYSHARE))
+		return -EPERM;
+
+	/*
+	 * Make sure the mapping cannot become writable later. Also tell the VM
+	 * to not touch these pages (VM_DONTCOPY | VM_DONTEXPAND).
+	 */
+	vma->vm_flags |= VM_DONTCOPY | VM_DONTEXPAND | VM_DONTDUMP;
+	vma->vm_flags &= ~VM_MAYWRITE;
+
+	/* meta-page + reader page + ring pages */
+	nr_pages = vma_pages(vma);
+	if (!nr_pages || pgoff > cpu_buffer->nr_pages + 1 ||
+	    nr_pages > cpu_buffer->nr_pages + 2 - pgoff)
+		return -EINVAL;
+
+	pages = kcalloc(nr_pages, sizeof(*pages), GFP_KERNEL);
+	if (!pages)
+		return -ENOMEM;
+
+	for (i = 0; i < nr_pages; i++) {
+		unsigned long off = pgoff + i;
+
+		if (!off)
+			pages[i] = virt_to_page(cpu_buffer->meta_page);
+		else
+			pages[i] = virt_to_page((void *)cpu_buffer->subbuf_ids[off - 1]);
+	}
+
+	err = vm_insert_pages(vma, vma->vm_start, pages, &nr_pages);
+	kfree(pages);
+
+	return err;
+}
+
+/**
+ * ring_buffer_map - map a per CPU buffer into user space
+ * @buffer: the buffer the CPU buffer belongs to
+ * @cpu: the CPU buffer to map
+ * @vma: the read-only, shared VMA to map the buffer into
+ *
+ * The first page of the mapping is a struct trace_buffer_meta. It is
+ * followed by the reader page and the ring pages, in the order of
+ * their IDs. While a CPU buffer is mapped, it can't be resized or
+ * swapped, and ring_buffer_read_page() always copies the data out
+ * instead of swapping pages.
+ *
+ * Returns 0 on success, a negative errno otherwise.
+ */
+int ring_buffer_map(struct trace_buffer *buffer, int cpu,
+		    struct vm_area_struct *vma)
+{
+	struct ring_buffer_per_cpu *cpu_buffer;
+	unsigned long flags, *subbuf_ids;
+	int err = 0;
+
+	if (!cpumask_test_cpu(cpu, buffer->cpumask))
+		return -EINVAL;
+
+	cpu_buffer = buffer->buffers[cpu];
+
+	mutex_lock(&cpu_buffer->mapping_lock);
+
+	if (cpu_buffer->mapped) {
+		if (cpu_buffer->mapped == UINT_MAX) {
+			err = -EBUSY;
+			goto unlock;
+		}
+
+		err = __rb_map_vma(cpu_buffer, vma);
+		if (!err)
+			cpu_buffer->mapped++;
+
+		goto unlock;
+	}
+
+	/* Serialize against ring_buffer_resize() */
+	mutex_lock(&buffer->mutex);
+	atomic_inc(&cpu_buffer->resize_disabled);
+	mutex_unlock(&buffer->mutex);
+
+	/* subbuf_ids include the reader page while nr_pages does not */
+	subbuf_ids = kcalloc(cpu_buffer->nr_pages + 1, sizeof(*subbuf_ids),
+			     GFP_KERNEL);
+	if (!subbuf_ids) {
+		err = -ENOMEM;
+		goto out_resize;
+	}
+
+	cpu_buffer->meta_page = (void *)get_zeroed_page(GFP_KERNEL);
+	if (!cpu_buffer->meta_page) {
+		kfree(subbuf_ids);
+		err = -ENOMEM;
+		goto out_resize;
+	}
+
+	raw_spin_lock_irqsave(&cpu_buffer->reader_lock, flags);
+	rb_setup_ids_meta_page(cpu_buffer, subbuf_ids);
+	raw_spin_unlock_irqrestore(&cpu_buffer->reader_lock, flags);
+
+	err = __rb_map_vma(cpu_buffer, vma);
+	if (err) {
+		raw_spin_lock_irqsave(&cpu_buffer->reader_lock, flags);
+		cpu_buffer->subbuf_ids = NULL;
+		raw_spin_unlock_irqrestore(&cpu_buffer->reader_lock, flags);
+
+		free_page((unsigned long)cpu_buffer->meta_page);
+		cpu_buffer->meta_page = NULL;
+		kfree(subbuf_ids);
+		goto out_resize;
+	}
+
+	raw_spin_lock_irqsave(&cpu_buffer->reader_lock, flags);
+	WRITE_ONCE(cpu_buffer->mapped, 1);
+	raw_spin_unlock_irqrestore(&cpu_buffer->reader_lock, flags);
+
+	goto unlock;
+
+ out_resize:
+	atomic_dec(&cpu_buffer->resize_disabled);
+ unlock:
+	mutex_unlock(&cpu_buffer->mapping_lock);
+
+	return err;
+}
+
+/**
+ * ring_buffer_unmap - drop a user space mapping of a per CPU buffer
+ * @buffer: the buffer the CPU buffer belongs to
+ * @cpu: the CPU buffer to unmap
+ *
+ * Called when a VMA set up by ring_buffer_map() goes away. The meta-page
+ * is freed and resizing allowed again once the last mapping is gone.
+ */
+int ring_buffer_unmap(struct trace_buffer *buffer, int cpu)
+{
+	struct ring_buffer_per_cpu *cpu_buffer;
+	unsigned long flags;
+	int err = 0;
+
+	if (!cpumask_test_cpu(cpu, buffer->cpumask))
+		return -EINVAL;
+
+	cpu_buffer = buffer->buffers[cpu];
+
+	mutex_lock(&cpu_buffer->mapping_lock);
+
+	if (!cpu_buffer->mapped) {
+		err = -ENODEV;
+		goto out;
+	} else if (cpu_buffer->mapped > 1) {
+		cpu_buffer->mapped--;
+		goto out;
+	}
+
+	raw_spin_lock_irqsave(&cpu_buffer->reader_lock, flags);
+	WRITE_ONCE(cpu_buffer->mapped, 0);
+	raw_spin_unlock_irqrestore(&cpu_buffer->reader_lock, flags);
+
+	free_page((unsigned long)cpu_buffer->meta_page);
+	cpu_buffer->meta_page = NULL;
+	kfree(cpu_buffer->subbuf_ids);
+	cpu_buffer->subbuf_ids = NULL;
+
+	atomic_dec(&cpu_buffer->resize_disabled);
+ out:
+	mutex_unlock(&cpu_buffer->mapping_lock);
+
+	return err;
+}
+
+/**
+ * ring_buffer_map_get_reader - hand the next page with data to user space
+ * @buffer: the buffer the CPU buffer belongs to
+ * @cpu: the mapped CPU buffer
+ *
+ * The caller is assumed to consume the whole reader page that is
+ * published in the meta-page, so the kernel reader is advanced to its
+ * end. If the current reader page was already fully consumed, it is
+ * swapped with the next page holding data. meta->reader.read tells
+ * where the unconsumed data of the published page starts.
+ *
+ * Returns 0 on success, -ENODEV if the CPU buffer is not mapped.
+ */
+int ring_buffer_map_get_reader(struct trace_buffer *buffer, int cpu)
+{
+	struct ring_buffer_per_cpu *cpu_buffer;
+	unsigned long missed_events = 0;
+	struct buffer_page *reader;
+	unsigned long reader_size;
+	unsigned int reader_read;
+	unsigned long flags;
+	int err = 0;
+
+	if (!cpumask_test_cpu(cpu, buffer->cpumask))
+		return -EINVAL;
+
+	cpu_buffer = buffer->buffers[cpu];
+
+	mutex_lock(&cpu_buffer->mapping_lock);
+
+	if (!cpu_buffer->mapped) {
+		err = -ENODEV;
+		goto unlock;
+	}
+
+	raw_spin_lock_irqsave(&cpu_buffer->reader_lock, flags);
+
+	reader_read = cpu_buffer->reader_page->read;
+	if (rb_per_cpu_empty(cpu_buffer))
+		goto out;
+
+	reader_size = rb_page_size(cpu_buffer->reader_page);
+
+	/* Data left on the current reader page, hand it over as it is */
+	if (cpu_buffer->reader_page->read >= reader_size) {
+		reader = rb_get_reader_page(cpu_buffer);
+		if (RB_WARN_ON(cpu_buffer, !reader))
+			goto out;
+
+		/* Record the events dropped before this page, like read_page does */
+		missed_events = cpu_buffer->lost_events;
+		if (missed_events && cpu_buffer->reader_page != cpu_buffer->commit_page) {
+			struct buffer_data_page *bpage = reader->page;
+			unsigned int commit;
+
+			if (reader->real_end)
+				local_set(&bpage->commit, reader->real_end);
+
+			commit = rb_page_size(reader);
+			if (BUF_PAGE_SIZE - commit >= sizeof(missed_events)) {
+				memcpy(&bpage->data[commit], &missed_events,
+				       sizeof(missed_events));
+				local_add(RB_MISSED_STORED, &bpage->commit);
+			}
+			local_add(RB_MISSED_EVENTS, &bpage->commit);
+		}
+		cpu_buffer->lost_events = 0;
+
+		reader_read = reader->read;
+		reader_size = rb_page_size(reader);
+	}
+
+	/* The caller consumes everything up to the current commit */
+	while (cpu_buffer->reader_page->read < reader_size)
+		rb_advance_reader(cpu_buffer);
+
+ out:
+	/* Some archs do not have data cache coherency between kernel and user-space */
+	flush_dcache_page(virt_to_page(cpu_buffer->reader_page->page));
+
+	rb_update_meta_page(cpu_buffer);
+	cpu_buffer->meta_page->reader.read = reader_read;
+	cpu_buffer->meta_page->reader.lost_events = missed_events;
+
+	raw_spin_unlock_irqrestore(&cpu_buffer->reader_lock, flags);
+ unlock:
+	mutex_unlock(&cpu_buffer->mapping_lock);
+
+	return err;
+}
+
 /*
  * We only allocate new buffers, never free them if the CPU goes down.
  * If we were to free the buffer, then the user would lose any trace that was in
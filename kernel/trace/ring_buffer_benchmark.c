@@ -349,6 +349,17 @@ static void ring_buffer_producer(void)
 		trace_printk("%ld ns per entry\n", avg);
 	}
 
+	if (consumer) {
+		/* Consumer throughput, in events consumed per millisec */
+		unsigned long consumed = read;
+
+		if (time)
+			consumed /= (long)time;
+
+		trace_printk("Reads per millisec:   %ld  (by %s)\n", consumed,
+			     read_events ? "events" : "pages");
+	}
+
 	if (missed) {
 		if (time)
 			missed /= (long)time;
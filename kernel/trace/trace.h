@@ -314,6 +314,15 @@ struct trace_array {
 	 */
 	struct array_buffer	max_buffer;
 	bool			allocated_snapshot;
+	/*
+	 * A snapshot swaps the whole buffer, which would pull the pages
+	 * from under a user space mapping of trace_pipe_raw. The two are
+	 * mutually exclusive: @mapped counts mappings, @snapshot counts
+	 * snapshot allocations in flight, both under snapshot_trigger_lock.
+	 */
+	spinlock_t		snapshot_trigger_lock;
+	unsigned int		snapshot;
+	unsigned int		mapped;
 #endif
 #ifdef CONFIG_TRACER_MAX_TRACE
 	unsigned long		max_latency;
@@ -829,6 +829,48 @@ static int __init crc32_combine_test(void)
 	return 0;
 }
 
+/* Bytes hashed per buffer size in crc32_bench() */
+#define CRC32_BENCH_BYTES	(1 << 22)
+
+static u32 __init crc32_bench_one(const char *name,
+				  u32 (*fn)(u32, unsigned char const *, size_t))
+{
+	static const unsigned int lens[] __initconst = { 64, 512, 4096 };
+	u32 crc = 0;
+	int i, j;
+
+	for (i = 0; i < ARRAY_SIZE(lens); i++) {
+		unsigned int loops = CRC32_BENCH_BYTES / lens[i];
+		u64 nsec;
+
+		/* pre-warm the cache */
+		crc ^= fn(crc, test_buf, lens[i]);
+
+		nsec = ktime_get_ns();
+		for (j = 0; j < loops; j++)
+			crc = fn(crc, test_buf, lens[i]);
+		nsec = ktime_get_ns() - nsec;
+
+		pr_info("%s: %4u byte buffers: %llu MB/s\n", name, lens[i],
+			div64_u64((u64)CRC32_BENCH_BYTES * 1000, nsec ?: 1));
+		cond_resched();
+	}
+
+	return crc;
+}
+
+static int __init crc32_bench(void)
+{
+	/* keep static to prevent the benchmark from being eliminated */
+	static u32 crc;
+
+	crc ^= crc32_bench_one("crc32_le", crc32_le);
+	crc ^= crc32_bench_one("crc32_be", crc32_be);
+	crc ^= crc32_bench_one("crc32c_le", __crc32c_le);
+
+	return 0;
+}
+
 static int __init crc32test_init(void)
 {
 	crc32_test();
@@ -837,6 +879,8 @@ static int __init crc32test_init(void)
 	crc32_combine_test();
 	crc32c_combine_test();
 
+	crc32_bench();
+
 	return 0;
 }
 
@@ -0,0 +1,193 @@
+// SPDX-License-Identifier: GPL-2.0 OR Linux-OpenIB
+/*
+ * Adaptive moderation of a single interrupt vector, driven by net_dim() or
+ * rdma_dim() and applied to the device through a driver callback.
+ */
+
+#include <linux/dim.h>
+#include <linux/interrupt.h>
+
+static u8 dim_irq_nr_profiles(const struct dim_irq_moder *m)
+{
+	if (m->type == DIM_IRQ_COMPLETIONS)
+		return RDMA_DIM_PARAMS_NUM_PROFILES;
+	return NET_DIM_PARAMS_NUM_PROFILES;
+}
+
+static void dim_irq_moder_work(struct work_struct *work)
+{
+	struct dim *dim = container_of(work, struct dim, work);
+	struct dim_irq_moder *m = container_of(dim, struct dim_irq_moder, dim);
+	struct dim_cq_moder moder = {};
+	int ix = READ_ONCE(m->fixed_ix);
+
+	if (ix < 0)
+		ix = dim->profile_ix;
+
+	switch (m->type) {
+	case DIM_IRQ_NET_RX:
+		moder = net_dim_get_rx_moderation(dim->mode, ix);
+		break;
+	case DIM_IRQ_NET_TX:
+		moder = net_dim_get_tx_moderation(dim->mode, ix);
+		break;
+	case DIM_IRQ_COMPLETIONS:
+		break;
+	}
+
+	m->set_moderation(m, ix, moder);
+	WRITE_ONCE(m->cur_ix, ix);
+	m->changes++;
+
+	dim->state = DIM_START_MEASURE;
+}
+
+/**
+ * dim_irq_moder_init - initialize the moderation state of an interrupt
+ * @m: moderation state
+ * @type: what the samples fed to dim_irq_moder_sample() count
+ * @cq_period_mode: CQ period mode used to look up net_dim profiles
+ * @set_moderation: callback programming the device with a new profile
+ *
+ * The device is expected to start out with the moderation of profile 0.
+ * Completion based moderation starts out tuning towards more coalescing,
+ * as rdma_dim() users always have.
+ * @set_moderation is called from process context whenever DIM, or the
+ * administrator through sysfs, picks a different profile.
+ */
+void dim_irq_moder_init(struct dim_irq_moder *m, enum dim_irq_type type,
+			u8 cq_period_mode, dim_irq_set_moder_t set_moderation)
+{
+	memset(m, 0, sizeof(*m));
+	INIT_WORK(&m->dim.work, dim_irq_moder_work);
+	m->dim.mode = cq_period_mode;
+	m->type = type;
+	m->set_moderation = set_moderation;
+	m->fixed_ix = -1;
+	m->irq = -1;
+	if (type == DIM_IRQ_COMPLETIONS)
+		m->dim.tune_state = DIM_GOING_RIGHT;
+}
+EXPORT_SYMBOL(dim_irq_moder_init);
+
+/**
+ * dim_irq_moder_register - expose the moderation state of an interrupt
+ * @m: moderation state set up by dim_irq_moder_init()
+ * @irq: the interrupt the moderation applies to
+ *
+ * Makes the current profile and the per-profile statistics available in
+ * /sys/kernel/irq/<irq>/ and allows pinning a profile from there.
+ *
+ * Return: 0 on success, -errno otherwise.
+ */
+int dim_irq_moder_register(struct dim_irq_moder *m, unsigned int irq)
+{
+	int ret = irq_set_moderation(irq, m);
+
+	if (!ret)
+		m->irq = irq;
+	return ret;
+}
+EXPORT_SYMBOL(dim_irq_moder_register);
+
+/**
+ * dim_irq_moder_unregister - stop moderating an interrupt
+ * @m: moderation state
+ *
+ * Removes @m from sysfs if it was registered and waits for a pending
+ * @set_moderation callback to finish. The caller must have stopped feeding
+ * samples already.
+ */
+void dim_irq_moder_unregister(struct dim_irq_moder *m)
+{
+	if (m->irq >= 0) {
+		irq_set_moderation(m->irq, NULL);
+		m->irq = -1;
+	}
+	cancel_work_sync(&m->dim.work);
+}
+EXPORT_SYMBOL(dim_irq_moder_unregister);
+
+/**
+ * dim_irq_moder_sample - account one interrupt and run the DIM algorithm
+ * @m: moderation state
+ * @items: packets or completions handled for this interrupt
+ * @bytes: bytes handled for this interrupt, ignored for completions
+ *
+ * Call once per interrupt, e.g. when completing a NAPI poll or after
+ * reaping a blk-mq completion queue. Calls for one @m must be serialized.
+ */
+void dim_irq_moder_sample(struct dim_irq_moder *m, u64 items, u64 bytes)
+{
+	struct dim_irq_hist *hist = &m->hist[READ_ONCE(m->cur_ix)];
+	struct dim_sample sample;
+
+	hist->events++;
+	hist->items += items;
+
+	if (READ_ONCE(m->fixed_ix) >= 0)
+		return;
+
+	if (m->type == DIM_IRQ_COMPLETIONS) {
+		rdma_dim(&m->dim, items);
+		return;
+	}
+
+	m->packets += items;
+	m->bytes += bytes;
+	dim_update_sample(++m->event_ctr, m->packets, m->bytes, &sample);
+	net_dim(&m->dim, sample);
+}
+EXPORT_SYMBOL(dim_irq_moder_sample);
+
+static const char * const dim_irq_type_names[] = {
+	[DIM_IRQ_NET_RX]	= "rx",
+	[DIM_IRQ_NET_TX]	= "tx",
+	[DIM_IRQ_COMPLETIONS]	= "completions",
+};
+
+/* sysfs helpers, called by the irq core with the descriptor's request_mutex held */
+ssize_t dim_irq_moder_show(struct dim_irq_moder *m, char *buf)
+{
+	return sysfs_emit(buf, "%s %d %s\n", dim_irq_type_names[m->type],
+			  READ_ONCE(m->cur_ix),
+			  READ_ONCE(m->fixed_ix) < 0 ? "auto" : "fixed");
+}
+
+ssize_t dim_irq_moder_store(struct dim_irq_moder *m, const char *buf)
+{
+	unsigned int ix;
+	int ret;
+
+	if (sysfs_streq(buf, "auto")) {
+		WRITE_ONCE(m->fixed_ix, -1);
+		return 0;
+	}
+
+	ret = kstrtouint(buf, 0, &ix);
+	if (ret)
+		return ret;
+	if (ix >= dim_irq_nr_profiles(m))
+		return -ERANGE;
+
+	WRITE_ONCE(m->fixed_ix, ix);
+	schedule_work(&m->dim.work);
+	return 0;
+}
+
+ssize_t dim_irq_moder_hist_show(struct dim_irq_moder *m, char *buf)
+{
+	ssize_t ret = 0;
+	int ix;
+
+	for (ix = 0; ix < dim_irq_nr_profiles(m); ix++) {
+		const struct dim_irq_hist *hist = &m->hist[ix];
+		u64 saved = hist->items > hist->events ?
+			    hist->items - hist->events : 0;
+
+		ret += sysfs_emit_at(buf, ret, "%d %llu %llu %llu\n", ix,
+				     hist->events, hist->items, saved);
+	}
+	ret += sysfs_emit_at(buf, ret, "changes %lu\n", m->changes);
+	return ret;
+}
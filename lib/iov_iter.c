@@ -16,6 +16,17 @@
 
 #define PIPE_PARANOIA /* for now */
 
+/*
+ * Without highmem, the pages of a multi-page bvec or of a large folio are
+ * contiguous in the direct map, so they can be copied in one step instead
+ * of one page at a time.
+ */
+#ifdef CONFIG_HIGHMEM
+#define iter_span_limit(offset)		(PAGE_SIZE - (offset) % PAGE_SIZE)
+#else
+#define iter_span_limit(offset)		SIZE_MAX
+#endif
+
 /* covers iovec and kvec alike */
 #define iterate_iovec(i, n, base, len, off, __p, STEP) {	\
 	size_t off = 0;						\
@@ -48,7 +59,7 @@
 					offset / PAGE_SIZE);	\
 		base = kaddr + offset % PAGE_SIZE;		\
 		len = min(min(n, (size_t)(p->bv_len - skip)),	\
-		     (size_t)(PAGE_SIZE - offset % PAGE_SIZE));	\
+		     (size_t)iter_span_limit(offset));		\
 		left = (STEP);					\
 		kunmap_local(kaddr);				\
 		len -= left;					\
@@ -87,11 +98,11 @@
 		if (WARN_ON(PageHuge(head)))			\
 			break;					\
 		for (j = (head->index < index) ? index - head->index : 0; \
-		     j < thp_nr_pages(head); j++) {		\
+		     j < thp_nr_pages(head);) {		\
 			void *kaddr = kmap_local_page(head + j);	\
 			base = kaddr + offset;			\
-			len = PAGE_SIZE - offset;		\
-			len = min(n, len);			\
+			len = (thp_nr_pages(head) - j) * PAGE_SIZE - offset; \
+			len = min3(n, len, (size_t)iter_span_limit(offset)); \
 			left = (STEP);				\
 			kunmap_local(kaddr);			\
 			len -= left;				\
@@ -99,6 +110,7 @@
 			n -= len;				\
 			if (left || n == 0)			\
 				goto __out;			\
+			j += (offset + len) / PAGE_SIZE;	\
 			offset = 0;				\
 		}						\
 	}							\
@@ -883,6 +895,10 @@ size_t copy_page_to_iter(struct page *page, size_t offset, size_t bytes,
 	size_t res = 0;
 	if (unlikely(!page_copy_sane(page, offset, bytes)))
 		return 0;
+	/* A compound page is contiguous in the direct map: copy it at once */
+	if (!IS_ENABLED(CONFIG_HIGHMEM) &&
+	    (iov_iter_is_bvec(i) || iov_iter_is_kvec(i) || iov_iter_is_xarray(i)))
+		return _copy_to_iter(page_address(page) + offset, bytes, i);
 	page += offset / PAGE_SIZE; // first subpage
 	offset %= PAGE_SIZE;
 	while (1) {
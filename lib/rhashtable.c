@@ -222,10 +222,10 @@ static struct bucket_table *rhashtable_last_table(struct rhashtable *ht,
 }
 
 static int rhashtable_rehash_one(struct rhashtable *ht,
+				 struct bucket_table *old_tbl,
 				 struct rhash_lock_head __rcu **bkt,
 				 unsigned int old_hash)
 {
-	struct bucket_table *old_tbl = rht_dereference(ht->tbl, ht);
 	struct bucket_table *new_tbl = rhashtable_last_table(ht, old_tbl);
 	int err = -EAGAIN;
 	struct rhash_head *head, *next, *entry;
@@ -271,6 +271,19 @@ static int rhashtable_rehash_one(struct rhashtable *ht,
 	return err;
 }
 
+static int __rhashtable_rehash_chain(struct rhashtable *ht,
+				     struct bucket_table *old_tbl,
+				     struct rhash_lock_head __rcu **bkt,
+				     unsigned int old_hash)
+{
+	int err;
+
+	while (!(err = rhashtable_rehash_one(ht, old_tbl, bkt, old_hash)))
+		;
+
+	return err == -ENOENT ? 0 : err;
+}
+
 static int rhashtable_rehash_chain(struct rhashtable *ht,
 				    unsigned int old_hash)
 {
@@ -281,12 +294,7 @@ static int rhashtable_rehash_chain(struct rhashtable *ht,
 	if (!bkt)
 		return 0;
 	rht_lock(old_tbl, bkt);
-
-	while (!(err = rhashtable_rehash_one(ht, bkt, old_hash)))
-		;
-
-	if (err == -ENOENT)
-		err = 0;
+	err = __rhashtable_rehash_chain(ht, old_tbl, bkt, old_hash);
 	rht_unlock(old_tbl, bkt);
 
 	return err;
@@ -608,6 +616,17 @@ static void *rhashtable_try_insert(struct rhashtable *ht, const void *key,
 			data = ERR_PTR(-EAGAIN);
 		} else {
 			rht_lock(tbl, bkt);
+			/*
+			 * Help the deferred worker along: while a resize is
+			 * in progress, move the chain we have locked anyway
+			 * to the new table, so that the rehash proceeds on
+			 * every inserting CPU rather than in the worker
+			 * alone.  Only the oldest table is ever rehashed,
+			 * and entries only leave it under its bucket lock.
+			 */
+			if (rcu_access_pointer(tbl->future_tbl) &&
+			    tbl == rcu_access_pointer(ht->tbl))
+				__rhashtable_rehash_chain(ht, tbl, bkt, hash);
 			data = rhashtable_lookup_one(ht, bkt, tbl,
 						     hash, key, obj);
 			new_tbl = rhashtable_insert_one(ht, bkt, tbl,
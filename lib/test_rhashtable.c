@@ -74,6 +74,7 @@ struct thread_data {
 	int id;
 	struct task_struct *task;
 	struct test_obj *objs;
+	u64 insert_ns;
 };
 
 static u32 my_hashfn(const void *data, u32 len, u32 seed)
@@ -633,6 +634,7 @@ static int threadfunc(void *data)
 {
 	int i, step, err = 0, insert_retries = 0;
 	struct thread_data *tdata = data;
+	u64 start;
 
 	if (atomic_dec_and_test(&startup_count))
 		wake_up(&startup_wait);
@@ -641,6 +643,7 @@ static int threadfunc(void *data)
 		goto out;
 	}
 
+	start = ktime_get_ns();
 	for (i = 0; i < tdata->entries; i++) {
 		tdata->objs[i].value.id = i;
 		tdata->objs[i].value.tid = tdata->id;
@@ -653,6 +656,7 @@ static int threadfunc(void *data)
 			goto out;
 		}
 	}
+	tdata->insert_ns = ktime_get_ns() - start;
 	if (insert_retries)
 		pr_info("  thread[%d]: %u insertions retried due to memory pressure\n",
 			tdata->id, insert_retries);
@@ -698,7 +702,7 @@ static int __init test_rht_init(void)
 {
 	unsigned int entries;
 	int i, err, started_threads = 0, failed_threads = 0;
-	u64 total_time = 0;
+	u64 total_time = 0, insert_ns = 0;
 	struct thread_data *tdata;
 	struct test_obj *objs;
 
@@ -804,7 +808,16 @@ static int __init test_rht_init(void)
 			        i, err);
 			failed_threads++;
 		}
+		insert_ns = max(insert_ns, tdata[i].insert_ns);
 	}
+	/*
+	 * The table starts out at the size hint, so the insert phase runs
+	 * concurrently with every resize on the way to its final size.
+	 */
+	if (insert_ns && !failed_threads)
+		pr_info("  %llu inserts/s from %d threads while resizing\n",
+			div64_u64((u64)started_threads * entries * NSEC_PER_SEC,
+				  insert_ns), started_threads);
 	rhashtable_destroy(&ht);
 	vfree(tdata);
 	vfree(objs);
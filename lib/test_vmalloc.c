@@ -50,6 +50,7 @@ __param(int, run_test_mask, INT_MAX,
 		"\t\tid: 128,  name: pcpu_alloc_test\n"
 		"\t\tid: 256,  name: kvfree_rcu_1_arg_vmalloc_test\n"
 		"\t\tid: 512,  name: kvfree_rcu_2_arg_vmalloc_test\n"
+		"\t\tid: 1024, name: small_size_burst_alloc_test\n"
 		/* Add a new test case description here. */
 );
 
@@ -357,6 +358,35 @@ kvfree_rcu_2_arg_vmalloc_test(void)
 	return 0;
 }
 
+/*
+ * Keep a batch of small areas busy and release them together, so that
+ * lazily-freed areas pile up and every worker goes through the purge and
+ * the reuse of purged areas concurrently.
+ */
+static int small_size_burst_alloc_test(void)
+{
+	void *ptr[64];
+	int rv = 0;
+	int i, j;
+
+	for (i = 0; i < test_loop_count / ARRAY_SIZE(ptr) && !rv; i++) {
+		for (j = 0; j < ARRAY_SIZE(ptr); j++) {
+			ptr[j] = vmalloc(((j % 4) + 1) * PAGE_SIZE);
+			if (!ptr[j]) {
+				rv = -1;
+				break;
+			}
+
+			*((__u8 *)ptr[j]) = 0;
+		}
+
+		while (j--)
+			vfree(ptr[j]);
+	}
+
+	return rv;
+}
+
 struct test_case_desc {
 	const char *test_name;
 	int (*test_func)(void);
@@ -373,6 +403,7 @@ static struct test_case_desc test_case_array[] = {
 	{ "pcpu_alloc_test", pcpu_alloc_test },
 	{ "kvfree_rcu_1_arg_vmalloc_test", kvfree_rcu_1_arg_vmalloc_test },
 	{ "kvfree_rcu_2_arg_vmalloc_test", kvfree_rcu_2_arg_vmalloc_test },
+	{ "small_size_burst_alloc_test", small_size_burst_alloc_test },
 	/* Add a new test case here. */
 };
 
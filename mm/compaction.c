@@ -1978,7 +1978,16 @@ static inline bool is_via_compact_memory(int order)
 
 static bool kswapd_is_running(pg_data_t *pgdat)
 {
-	return pgdat->kswapd && task_is_running(pgdat->kswapd);
+	int i;
+
+	for (i = 0; i < MAX_KSWAPD_THREADS; i++) {
+		struct task_struct *tsk = pgdat->kswapd[i].task;
+
+		if (tsk && task_is_running(tsk))
+			return true;
+	}
+
+	return false;
 }
 
 /*
@@ -2030,6 +2039,19 @@ static unsigned int fragmentation_score_node(pg_data_t *pgdat)
 	return score;
 }
 
+/*
+ * The node's own proactiveness if one was set through sysfs, the
+ * vm.compaction_proactiveness sysctl otherwise.
+ */
+static unsigned int compaction_proactiveness(pg_data_t *pgdat)
+{
+	int proactiveness = READ_ONCE(pgdat->compaction_proactiveness);
+
+	if (proactiveness < 0)
+		return sysctl_compaction_proactiveness;
+	return proactiveness;
+}
+
 static unsigned int fragmentation_score_wmark(pg_data_t *pgdat, bool low)
 {
 	unsigned int wmark_low;
@@ -2039,7 +2061,7 @@ static unsigned int fragmentation_score_wmark(pg_data_t *pgdat, bool low)
 	 * activity in case a user sets the proactiveness tunable
 	 * close to 100 (maximum).
 	 */
-	wmark_low = max(100U - sysctl_compaction_proactiveness, 5U);
+	wmark_low = max(100U - compaction_proactiveness(pgdat), 5U);
 	return low ? wmark_low : min(wmark_low + 10, 100U);
 }
 
@@ -2047,7 +2069,7 @@ static bool should_proactive_compact_node(pg_data_t *pgdat)
 {
 	int wmark_high;
 
-	if (!sysctl_compaction_proactiveness || kswapd_is_running(pgdat))
+	if (!compaction_proactiveness(pgdat) || kswapd_is_running(pgdat))
 		return false;
 
 	wmark_high = fragmentation_score_wmark(pgdat, false);
@@ -2088,6 +2110,10 @@ static enum compact_result __compact_finished(struct compact_control *cc)
 		if (kswapd_is_running(pgdat))
 			return COMPACT_PARTIAL_SKIPPED;
 
+		/* Out of CPU budget for this round, continue in the next */
+		if (cc->proactive_end && time_after(jiffies, cc->proactive_end))
+			return COMPACT_PARTIAL_SKIPPED;
+
 		score = fragmentation_score_zone(cc->zone);
 		wmark_low = fragmentation_score_wmark(pgdat, true);
 
@@ -2653,12 +2679,15 @@ enum compact_result try_to_compact_pages(gfp_t gfp_mask, unsigned int order,
  *
  * It is possible that the function returns before reaching score targets
  * due to various back-off conditions, such as, contention on per-node or
- * per-zone locks.
+ * per-zone locks, or the round running out of its CPU budget.
  */
 static void proactive_compact_node(pg_data_t *pgdat)
 {
 	int zoneid;
 	struct zone *zone;
+	unsigned int budget = READ_ONCE(sysctl_compaction_proactive_budget_ms);
+	unsigned long start = jiffies;
+	unsigned int msecs;
 	struct compact_control cc = {
 		.order = -1,
 		.mode = MIGRATE_SYNC_LIGHT,
@@ -2668,6 +2697,9 @@ static void proactive_compact_node(pg_data_t *pgdat)
 		.proactive_compaction = true,
 	};
 
+	if (budget)
+		cc.proactive_end = start + max(msecs_to_jiffies(budget), 1UL);
+
 	for (zoneid = 0; zoneid < MAX_NR_ZONES; zoneid++) {
 		zone = &pgdat->node_zones[zoneid];
 		if (!populated_zone(zone))
@@ -2680,6 +2712,14 @@ static void proactive_compact_node(pg_data_t *pgdat)
 		VM_BUG_ON(!list_empty(&cc.freepages));
 		VM_BUG_ON(!list_empty(&cc.migratepages));
 	}
+
+	msecs = jiffies_to_msecs(jiffies - start);
+	pgdat->proactive_compact_lat[min_t(unsigned int, fls(msecs),
+					   NR_PROACTIVE_COMPACT_LAT - 1)]++;
+	pgdat->proactive_compact_runs++;
+	if (fragmentation_score_node(pgdat) <=
+	    fragmentation_score_wmark(pgdat, true))
+		pgdat->proactive_compact_success++;
 }
 
 /* Compact all zones within a node */
@@ -2731,6 +2771,12 @@ static void compact_nodes(void)
  */
 unsigned int __read_mostly sysctl_compaction_proactiveness = 20;
 
+/*
+ * Upper bound, in milliseconds, on the time a single round of proactive
+ * compaction may spend on a node. 0 means no limit.
+ */
+unsigned int __read_mostly sysctl_compaction_proactive_budget_ms;
+
 int compaction_proactiveness_sysctl_handler(struct ctl_table *table, int write,
 		void *buffer, size_t *length, loff_t *ppos)
 {
@@ -2786,14 +2832,85 @@ static ssize_t compact_store(struct device *dev,
 }
 static DEVICE_ATTR_WO(compact);
 
+static ssize_t compaction_proactiveness_show(struct device *dev,
+					     struct device_attribute *attr,
+					     char *buf)
+{
+	pg_data_t *pgdat = NODE_DATA(dev->id);
+
+	return sysfs_emit(buf, "%d\n",
+			  READ_ONCE(pgdat->compaction_proactiveness));
+}
+
+static ssize_t compaction_proactiveness_store(struct device *dev,
+					      struct device_attribute *attr,
+					      const char *buf, size_t count)
+{
+	pg_data_t *pgdat = NODE_DATA(dev->id);
+	int val, ret;
+
+	ret = kstrtoint(buf, 0, &val);
+	if (ret)
+		return ret;
+	if (val < -1 || val > 100)
+		return -EINVAL;
+
+	WRITE_ONCE(pgdat->compaction_proactiveness, val);
+	if (compaction_proactiveness(pgdat) && pgdat->kcompactd &&
+	    !pgdat->proactive_compact_trigger) {
+		pgdat->proactive_compact_trigger = true;
+		wake_up_interruptible(&pgdat->kcompactd_wait);
+	}
+
+	return count;
+}
+static DEVICE_ATTR_RW(compaction_proactiveness);
+
+static ssize_t compaction_stats_show(struct device *dev,
+				     struct device_attribute *attr, char *buf)
+{
+	pg_data_t *pgdat = NODE_DATA(dev->id);
+	int len, i;
+
+	len = sysfs_emit(buf,
+			 "fragmentation_score %u\n"
+			 "fragmentation_target %u\n"
+			 "proactive_runs %lu\n"
+			 "proactive_success %lu\n",
+			 fragmentation_score_node(pgdat),
+			 fragmentation_score_wmark(pgdat, true),
+			 pgdat->proactive_compact_runs,
+			 pgdat->proactive_compact_success);
+
+	for (i = 0; i < NR_PROACTIVE_COMPACT_LAT - 1; i++)
+		len += sysfs_emit_at(buf, len, "proactive_lat_lt_%ums %lu\n",
+				     1U << i, pgdat->proactive_compact_lat[i]);
+	len += sysfs_emit_at(buf, len, "proactive_lat_ge_%ums %lu\n",
+			     1U << (i - 1), pgdat->proactive_compact_lat[i]);
+
+	return len;
+}
+static DEVICE_ATTR_RO(compaction_stats);
+
+static struct attribute *compaction_node_attrs[] = {
+	&dev_attr_compact.attr,
+	&dev_attr_compaction_proactiveness.attr,
+	&dev_attr_compaction_stats.attr,
+	NULL,
+};
+
+static const struct attribute_group compaction_node_group = {
+	.attrs = compaction_node_attrs,
+};
+
 int compaction_register_node(struct node *node)
 {
-	return device_create_file(&node->dev, &dev_attr_compact);
+	return sysfs_create_group(&node->dev.kobj, &compaction_node_group);
 }
 
 void compaction_unregister_node(struct node *node)
 {
-	return device_remove_file(&node->dev, &dev_attr_compact);
+	sysfs_remove_group(&node->dev.kobj, &compaction_node_group);
 }
 #endif /* CONFIG_SYSFS && CONFIG_NUMA */
 
@@ -2955,7 +3072,7 @@ static int kcompactd(void *p)
 		 * Avoid the unnecessary wakeup for proactive compaction
 		 * when it is disabled.
 		 */
-		if (!sysctl_compaction_proactiveness)
+		if (!compaction_proactiveness(pgdat))
 			timeout = MAX_SCHEDULE_TIMEOUT;
 		trace_mm_compaction_kcompactd_sleep(pgdat->node_id);
 		if (wait_event_freezable_timeout(pgdat->kcompactd_wait,
@@ -146,15 +146,18 @@ static void damon_test_merge_two(struct kunit *test)
 	t = damon_new_target(42);
 	r = damon_new_region(0, 100);
 	r->nr_accesses = 10;
+	r->age = 10;
 	damon_add_region(r, t);
 	r2 = damon_new_region(100, 300);
 	r2->nr_accesses = 20;
+	r2->age = 40;
 	damon_add_region(r2, t);
 
 	damon_merge_two_regions(t, r, r2);
 	KUNIT_EXPECT_EQ(test, r->ar.start, 0ul);
 	KUNIT_EXPECT_EQ(test, r->ar.end, 300ul);
 	KUNIT_EXPECT_EQ(test, r->nr_accesses, 16u);
+	KUNIT_EXPECT_EQ(test, r->age, 30u);
 
 	i = 0;
 	damon_for_each_region(r3, t) {
@@ -109,9 +109,36 @@ static void damon_dbgfs_test_set_targets(struct kunit *test)
 	dbgfs_destroy_ctx(ctx);
 }
 
+static void damon_dbgfs_test_set_schemes(struct kunit *test)
+{
+	struct damon_ctx *ctx = dbgfs_new_ctx();
+	struct damos **schemes;
+	ssize_t nr_schemes;
+	char *input = "4096 1048576 0 0 10 4294967295 2 10 0 1000 0 1\n";
+	char buf[128];
+
+	schemes = str_to_schemes(input, strlen(input), &nr_schemes);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, schemes);
+	KUNIT_EXPECT_EQ(test, (ssize_t)1, nr_schemes);
+
+	damon_set_schemes(ctx, schemes, nr_schemes);
+	kfree(schemes);
+	sprint_schemes(ctx, buf, 128);
+	KUNIT_EXPECT_STREQ(test, (char *)buf,
+			"4096 1048576 0 0 10 4294967295 2 10 0 1000 0 1 0 0 0 0 0\n");
+
+	/* min_sz_region larger than max_sz_region */
+	input = "8192 4096 0 0 10 20 2 0 0 0 0 0\n";
+	schemes = str_to_schemes(input, strlen(input), &nr_schemes);
+	KUNIT_EXPECT_PTR_EQ(test, schemes, (struct damos **)NULL);
+
+	dbgfs_destroy_ctx(ctx);
+}
+
 static struct kunit_case damon_test_cases[] = {
 	KUNIT_CASE(damon_dbgfs_test_str_to_target_ids),
 	KUNIT_CASE(damon_dbgfs_test_set_targets),
+	KUNIT_CASE(damon_dbgfs_test_set_schemes),
 	{},
 };
 
@@ -1219,20 +1219,52 @@ static long __get_user_pages(struct mm_struct *mm,
 			ret = PTR_ERR(page);
 			goto out;
 		}
+		page_increm = 1 + (~(start >> PAGE_SHIFT) & ctx.page_mask);
+		if (page_increm > nr_pages)
+			page_increm = nr_pages;
+
 		if (pages) {
-			pages[i] = page;
-			flush_anon_page(vma, page, start);
-			flush_dcache_page(page);
-			ctx.page_mask = 0;
+			unsigned int j;
+
+			/*
+			 * A THP is mapped: take the references for the rest
+			 * of the subpages in the range with one operation on
+			 * the head page, instead of walking the page tables
+			 * again for every subpage. We already hold one
+			 * reference, so this can't fail unless the refcount
+			 * would overflow. FOLL_LONGTERM is masked because
+			 * unpinnable pages are migrated by our caller, just
+			 * like the first subpage.
+			 */
+			if (page_increm > 1 &&
+			    unlikely(!try_grab_compound_head(page,
+					page_increm - 1,
+					foll_flags & ~FOLL_LONGTERM))) {
+				put_compound_head(compound_head(page), 1,
+						  foll_flags);
+				ret = -EFAULT;
+				goto out;
+			}
+
+			for (j = 0; j < page_increm; j++) {
+				struct page *subpage = nth_page(page, j);
+
+				pages[i + j] = subpage;
+				flush_anon_page(vma, subpage,
+						start + j * PAGE_SIZE);
+				flush_dcache_page(subpage);
+			}
 		}
 next_page:
-		if (vmas) {
-			vmas[i] = vma;
-			ctx.page_mask = 0;
-		}
 		page_increm = 1 + (~(start >> PAGE_SHIFT) & ctx.page_mask);
 		if (page_increm > nr_pages)
 			page_increm = nr_pages;
+		if (vmas) {
+			unsigned int j;
+
+			for (j = 0; j < page_increm; j++)
+				vmas[i + j] = vma;
+		}
 		i += page_increm;
 		start += page_increm * PAGE_SIZE;
 		nr_pages -= page_increm;
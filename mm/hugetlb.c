@@ -31,6 +31,7 @@
 #include <linux/llist.h>
 #include <linux/cma.h>
 #include <linux/migrate.h>
+#include <linux/padata.h>
 
 #include <asm/page.h>
 #include <asm/pgalloc.h>
@@ -2907,71 +2908,157 @@ int __alloc_bootmem_huge_page(struct hstate *h)
  * Put bootmem huge pages into the standard lists after mem_map is up.
  * Note: This only applies to gigantic (order > MAX_ORDER) pages.
  */
+static void __init gather_bootmem_prealloc_page(struct huge_bootmem_page *m)
+{
+	struct page *page = virt_to_page(m);
+	struct hstate *h = m->hstate;
+
+	VM_BUG_ON(!hstate_is_gigantic(h));
+	WARN_ON(page_count(page) != 1);
+	if (prep_compound_gigantic_page(page, huge_page_order(h))) {
+		WARN_ON(PageReserved(page));
+		prep_new_huge_page(h, page, page_to_nid(page));
+		put_page(page); /* add to the hugepage allocator */
+	} else {
+		/* VERY unlikely inflated ref count on a tail page */
+		free_gigantic_page(page, huge_page_order(h));
+	}
+
+	/*
+	 * We need to restore the 'stolen' pages to totalram_pages
+	 * in order to fix confusing memory reports from free(1) and
+	 * other side-effects, like CommitLimit going negative.
+	 */
+	adjust_managed_page_count(page, pages_per_huge_page(h));
+	cond_resched();
+}
+
+static void __init gather_bootmem_prealloc_range(unsigned long start,
+						 unsigned long end, void *arg)
+{
+	struct huge_bootmem_page **pages = arg;
+	unsigned long i;
+
+	for (i = start; i < end; i++)
+		gather_bootmem_prealloc_page(pages[i]);
+}
+
+/*
+ * Writing out the struct pages of a gigantic page and freeing its vmemmap
+ * dominates this, so spread it over the CPUs.  The list is snapshotted
+ * first: huge_bootmem_page lives inside the huge page, which is handed to
+ * the allocator as soon as it has been prepared.
+ */
 static void __init gather_bootmem_prealloc(void)
 {
-	struct huge_bootmem_page *m;
+	struct huge_bootmem_page *m, **pages;
+	struct padata_mt_job job = {};
+	unsigned long nr = 0, i = 0;
 
-	list_for_each_entry(m, &huge_boot_pages, list) {
-		struct page *page = virt_to_page(m);
-		struct hstate *h = m->hstate;
+	list_for_each_entry(m, &huge_boot_pages, list)
+		nr++;
+	if (!nr)
+		return;
 
-		VM_BUG_ON(!hstate_is_gigantic(h));
-		WARN_ON(page_count(page) != 1);
-		if (prep_compound_gigantic_page(page, huge_page_order(h))) {
-			WARN_ON(PageReserved(page));
-			prep_new_huge_page(h, page, page_to_nid(page));
-			put_page(page); /* add to the hugepage allocator */
-		} else {
-			/* VERY unlikely inflated ref count on a tail page */
-			free_gigantic_page(page, huge_page_order(h));
+	pages = kvmalloc_array(nr, sizeof(*pages), GFP_KERNEL);
+	if (!pages) {
+		list_for_each_entry(m, &huge_boot_pages, list)
+			gather_bootmem_prealloc_page(m);
+		return;
+	}
+	list_for_each_entry(m, &huge_boot_pages, list)
+		pages[i++] = m;
+
+	job.thread_fn	= gather_bootmem_prealloc_range;
+	job.fn_arg	= pages;
+	job.start	= 0;
+	job.size	= nr;
+	job.align	= 1;
+	job.min_chunk	= 1;
+	job.max_threads	= num_online_cpus();
+	padata_do_multithreaded(&job);
+
+	kvfree(pages);
+}
+
+/*
+ * Allocate [@start, @end) of the boot-time pool of a non-gigantic hstate,
+ * interleaved over the memory nodes.  Unless an allocation fails and moves
+ * the cursor on, page @i lands on memory node number i % nr_nodes, whichever
+ * chunk allocates it, so the pool is spread as by the serial loop.  Chunks
+ * keep their own cursor rather than sharing h->next_nid_to_alloc.
+ */
+static void __init hugetlb_pages_alloc_boot_range(unsigned long start,
+						  unsigned long end, void *arg)
+{
+	struct hstate *h = arg;
+	nodemask_t *nodes = &node_states[N_MEMORY];
+	gfp_t gfp_mask = htlb_alloc_mask(h) | __GFP_THISNODE;
+	nodemask_t node_alloc_noretry;
+	unsigned long i;
+	int node, skip;
+
+	/* bit mask controlling how hard we retry per-node allocations */
+	nodes_clear(node_alloc_noretry);
+
+	node = first_node(*nodes);
+	for (skip = start % nodes_weight(*nodes); skip; skip--)
+		node = next_node_in(node, *nodes);
+
+	for (i = start; i < end; i++) {
+		struct page *page = NULL;
+		int nr_nodes;
+
+		for (nr_nodes = nodes_weight(*nodes); nr_nodes; nr_nodes--) {
+			page = alloc_fresh_huge_page(h, gfp_mask, node, nodes,
+						     &node_alloc_noretry);
+			node = next_node_in(node, *nodes);
+			if (page)
+				break;
 		}
+		if (!page)
+			break;
 
-		/*
-		 * We need to restore the 'stolen' pages to totalram_pages
-		 * in order to fix confusing memory reports from free(1) and
-		 * other side-effects, like CommitLimit going negative.
-		 */
-		adjust_managed_page_count(page, pages_per_huge_page(h));
+		put_page(page); /* free it into the hugepage allocator */
 		cond_resched();
 	}
 }
 
+static unsigned long __init hugetlb_pages_alloc_boot(struct hstate *h)
+{
+	int nr_nodes = num_node_state(N_MEMORY);
+	struct padata_mt_job job = {
+		.thread_fn	= hugetlb_pages_alloc_boot_range,
+		.fn_arg		= h,
+		.start		= 0,
+		.size		= h->max_huge_pages,
+		.align		= 1,
+		.min_chunk	= max(h->max_huge_pages / nr_nodes / 2, 1UL),
+		.max_threads	= nr_nodes * 2,
+	};
+
+	padata_do_multithreaded(&job);
+
+	return h->nr_huge_pages;
+}
+
 static void __init hugetlb_hstate_alloc_pages(struct hstate *h)
 {
 	unsigned long i;
-	nodemask_t *node_alloc_noretry;
 
 	if (!hstate_is_gigantic(h)) {
-		/*
-		 * Bit mask controlling how hard we retry per-node allocations.
-		 * Ignore errors as lower level routines can deal with
-		 * node_alloc_noretry == NULL.  If this kmalloc fails at boot
-		 * time, we are likely in bigger trouble.
-		 */
-		node_alloc_noretry = kmalloc(sizeof(*node_alloc_noretry),
-						GFP_KERNEL);
+		i = hugetlb_pages_alloc_boot(h);
 	} else {
-		/* allocations done at boot time */
-		node_alloc_noretry = NULL;
-	}
-
-	/* bit mask controlling how hard we retry per-node allocations */
-	if (node_alloc_noretry)
-		nodes_clear(*node_alloc_noretry);
-
-	for (i = 0; i < h->max_huge_pages; ++i) {
-		if (hstate_is_gigantic(h)) {
+		/* allocations done at boot time, before other CPUs are up */
+		for (i = 0; i < h->max_huge_pages; ++i) {
 			if (hugetlb_cma_size) {
 				pr_warn_once("HugeTLB: hugetlb_cma is enabled, skip boot time allocation\n");
-				goto free;
+				return;
 			}
 			if (!alloc_bootmem_huge_page(h))
 				break;
-		} else if (!alloc_pool_huge_page(h,
-					 &node_states[N_MEMORY],
-					 node_alloc_noretry))
-			break;
-		cond_resched();
+			cond_resched();
+		}
 	}
 	if (i < h->max_huge_pages) {
 		char buf[32];
@@ -2981,8 +3068,6 @@ static void __init hugetlb_hstate_alloc_pages(struct hstate *h)
 			h->max_huge_pages, buf, i);
 		h->max_huge_pages = i;
 	}
-free:
-	kfree(node_alloc_noretry);
 }
 
 static void __init hugetlb_init_hstates(void)
@@ -3474,7 +3474,7 @@ static vm_fault_t remove_device_exclusive_entry(struct vm_fault *vmf)
 	if (!get_page_unless_zero(page))
 		return 0;
 
-	if (!lock_page_or_retry(page, vma->vm_mm, vmf->flags)) {
+	if (!lock_page_or_retry(page, vmf)) {
 		put_page(page);
 		return VM_FAULT_RETRY;
 	}
@@ -3524,6 +3524,16 @@ vm_fault_t do_swap_page(struct vm_fault *vmf)
 		if (is_migration_entry(entry)) {
 			migration_entry_wait(vma->vm_mm, vmf->pmd,
 					     vmf->address);
+		} else if ((vmf->flags & FAULT_FLAG_VMA_LOCK) &&
+			   (is_device_exclusive_entry(entry) ||
+			    is_device_private_entry(entry))) {
+			/*
+			 * Neither the device exclusive entry removal nor
+			 * ->migrate_to_ram() is ready to run without the
+			 * mmap_lock, retry the fault under it.
+			 */
+			vma_end_read(vma);
+			ret = VM_FAULT_RETRY;
 		} else if (is_device_exclusive_entry(entry)) {
 			vmf->page = pfn_swap_entry_to_page(entry);
 			ret = remove_device_exclusive_entry(vmf);
@@ -3609,7 +3619,7 @@ vm_fault_t do_swap_page(struct vm_fault *vmf)
 		goto out_release;
 	}
 
-	locked = lock_page_or_retry(page, vma->vm_mm, vmf->flags);
+	locked = lock_page_or_retry(page, vmf);
 
 	delayacct_clear_flag(current, DELAYACCT_PF_SWAPIN);
 	if (!locked) {
@@ -4884,6 +4894,102 @@ vm_fault_t handle_mm_fault(struct vm_area_struct *vma, unsigned long address,
 }
 EXPORT_SYMBOL_GPL(handle_mm_fault);
 
+#ifdef CONFIG_PER_VMA_LOCK
+/*
+ * Lockless version of find_vma(). Tree rotations done by a concurrent writer
+ * can make the walk miss a vma, but never loop, and vmas are freed by RCU, so
+ * the worst case is a spurious fallback to the mmap_lock.
+ */
+static struct vm_area_struct *find_vma_rcu(struct mm_struct *mm,
+					   unsigned long addr)
+{
+	struct rb_node *rb_node = rcu_dereference_raw(mm->mm_rb.rb_node);
+	struct vm_area_struct *vma = NULL;
+
+	while (rb_node) {
+		struct vm_area_struct *tmp;
+
+		tmp = rb_entry(rb_node, struct vm_area_struct, vm_rb);
+		if (READ_ONCE(tmp->vm_end) > addr) {
+			vma = tmp;
+			if (READ_ONCE(tmp->vm_start) <= addr)
+				break;
+			rb_node = rcu_dereference_raw(rb_node->rb_left);
+		} else {
+			rb_node = rcu_dereference_raw(rb_node->rb_right);
+		}
+	}
+	return vma;
+}
+
+/*
+ * Only vmas whose fault handling never needs more than the vma itself can be
+ * handled without the mmap_lock: anon_vma_prepare() looks at the
+ * neighbours to find a mergeable anon_vma, so private mappings must already
+ * have one, and of the file mappings only the ones going through the page
+ * cache are known to cope with FAULT_FLAG_VMA_LOCK.
+ */
+static bool vma_lock_fault_allowed(struct vm_area_struct *vma)
+{
+	if (!(vma->vm_flags & VM_SHARED) && !vma->anon_vma)
+		return false;
+	if (vma->vm_flags & (VM_HUGETLB | VM_PFNMAP | VM_MIXEDMAP))
+		return false;
+	if (!vma_is_anonymous(vma) && !vma->vm_ops->map_pages)
+		return false;
+	return true;
+}
+
+/*
+ * Look up and read-lock the vma covering @address without taking the
+ * mmap_lock. Returns NULL if the fault has to be handled the old way.
+ */
+struct vm_area_struct *lock_vma_under_rcu(struct mm_struct *mm,
+					  unsigned long address)
+{
+	struct vm_area_struct *vma;
+
+	rcu_read_lock();
+retry:
+	vma = find_vma_rcu(mm, address);
+	if (!vma || !vma_lock_fault_allowed(vma))
+		goto inval;
+
+	if (!vma_start_read(vma))
+		goto inval;
+
+	/*
+	 * Due to the possibility of userfault handler dropping mmap_lock, avoid
+	 * it for now and fall back to page fault handling under mmap_lock.
+	 */
+	if (userfaultfd_armed(vma)) {
+		vma_end_read(vma);
+		goto inval;
+	}
+
+	/* Check since vm_start/vm_end might change before we lock the VMA */
+	if (unlikely(address < vma->vm_start || address >= vma->vm_end)) {
+		vma_end_read(vma);
+		goto inval;
+	}
+
+	/* Check if the VMA got isolated after we found it */
+	if (vma->detached) {
+		vma_end_read(vma);
+		mmap_lock_trace_vma_fault(mm, address, VMA_LOCK_MISS);
+		/* The area was replaced with another one */
+		goto retry;
+	}
+
+	rcu_read_unlock();
+	return vma;
+inval:
+	rcu_read_unlock();
+	mmap_lock_trace_vma_fault(mm, address, VMA_LOCK_ABORT);
+	return NULL;
+}
+#endif /* CONFIG_PER_VMA_LOCK */
+
 #ifndef __PAGETABLE_P4D_FOLDED
 /*
  * Allocate p4d page table.
@@ -47,6 +47,7 @@
 #include <linux/page_idle.h>
 #include <linux/page_owner.h>
 #include <linux/sched/mm.h>
+#include <linux/sched/sysctl.h>
 #include <linux/ptrace.h>
 #include <linux/oom.h>
 #include <linux/memory.h>
@@ -2122,8 +2123,23 @@ static int numamigrate_isolate_page(pg_data_t *pgdat, struct page *page)
 		return 0;
 
 	/* Avoid migrating to a node that is nearly full */
-	if (!migrate_balanced_pgdat(pgdat, nr_pages))
+	if (!migrate_balanced_pgdat(pgdat, nr_pages)) {
+		int z;
+
+		if (!(sysctl_numa_balancing_mode & NUMA_BALANCING_MEMORY_TIERING))
+			return 0;
+		/*
+		 * Promotion target is full: have kswapd demote its coldest
+		 * pages to the slower tier so that hot pages can come in.
+		 */
+		for (z = pgdat->nr_zones - 1; z >= 0; z--) {
+			if (populated_zone(pgdat->node_zones + z))
+				break;
+		}
+		wakeup_kswapd(pgdat->node_zones + z, 0,
+			      compound_order(page), ZONE_MOVABLE);
 		return 0;
+	}
 
 	if (isolate_lru_page(page))
 		return 0;
@@ -2156,6 +2172,8 @@ int migrate_misplaced_page(struct page *page, struct vm_area_struct *vma,
 	new_page_t *new;
 	bool compound;
 	int nr_pages = thp_nr_pages(page);
+	bool promotion = !node_is_toptier(page_to_nid(page)) &&
+			 node_is_toptier(node);
 
 	/*
 	 * PTE mapped THP or HugeTLB page can't reach here so the page could
@@ -2199,8 +2217,12 @@ int migrate_misplaced_page(struct page *page, struct vm_area_struct *vma,
 			putback_lru_page(page);
 		}
 		isolated = 0;
-	} else
+	} else {
 		count_vm_numa_events(NUMA_PAGE_MIGRATE, nr_pages);
+		if (promotion)
+			mod_node_page_state(pgdat, PGPROMOTE_SUCCESS,
+					    nr_pages);
+	}
 	BUG_ON(!list_empty(&migratepages));
 	return isolated;
 
@@ -16,6 +16,7 @@
 EXPORT_TRACEPOINT_SYMBOL(mmap_lock_start_locking);
 EXPORT_TRACEPOINT_SYMBOL(mmap_lock_acquire_returned);
 EXPORT_TRACEPOINT_SYMBOL(mmap_lock_released);
+EXPORT_TRACEPOINT_SYMBOL(mmap_lock_vma_fault);
 
 #ifdef CONFIG_MEMCG
 
@@ -243,4 +244,12 @@ void __mmap_lock_do_trace_released(struct mm_struct *mm, bool write)
 	TRACE_MMAP_LOCK_EVENT(released, mm, write);
 }
 EXPORT_SYMBOL(__mmap_lock_do_trace_released);
+
+void __mmap_lock_do_trace_vma_fault(struct mm_struct *mm,
+				    unsigned long address,
+				    enum vma_lock_fault result)
+{
+	TRACE_MMAP_LOCK_EVENT(vma_fault, mm, address, result);
+}
+EXPORT_SYMBOL(__mmap_lock_do_trace_vma_fault);
 #endif /* CONFIG_TRACING */
@@ -1704,6 +1704,49 @@ static void pcpu_memcg_free_hook(struct pcpu_chunk *chunk, int off, size_t size)
 }
 #endif /* CONFIG_MEMCG_KMEM */
 
+/**
+ * pcpu_alloc_populated - allocate from already populated space
+ * @size: size of area to allocate in bytes
+ * @bits: size of area in bitmap bits
+ * @bit_align: alignment of area in bitmap bits
+ * @chunkp: out param for the chunk the area was allocated from
+ *
+ * Look for a fit in the populated parts of the normal chunks, the way an
+ * atomic allocation does.  Unlike the regular search, chunks without a
+ * populated fit are left in their slot as they may still have room.
+ *
+ * CONTEXT:
+ * pcpu_lock.
+ *
+ * RETURNS:
+ * Allocated offset in *@chunkp on success, -1 if no populated fit.
+ */
+static int pcpu_alloc_populated(size_t size, int bits, size_t bit_align,
+				struct pcpu_chunk **chunkp)
+{
+	struct pcpu_chunk *chunk;
+	int slot, off;
+
+	lockdep_assert_held(&pcpu_lock);
+
+	for (slot = pcpu_size_to_slot(size); slot <= pcpu_free_slot; slot++) {
+		list_for_each_entry(chunk, &pcpu_chunk_lists[slot], list) {
+			off = pcpu_find_block_fit(chunk, bits, bit_align, true);
+			if (off < 0)
+				continue;
+
+			off = pcpu_alloc_area(chunk, bits, bit_align, off);
+			if (off >= 0) {
+				pcpu_reintegrate_chunk(chunk);
+				*chunkp = chunk;
+				return off;
+			}
+		}
+	}
+
+	return -1;
+}
+
 /**
  * pcpu_alloc - the percpu allocator
  * @size: size of area to allocate in bytes
@@ -1725,6 +1768,7 @@ static void __percpu *pcpu_alloc(size_t size, size_t align, bool reserved,
 	gfp_t pcpu_gfp;
 	bool is_atomic;
 	bool do_warn;
+	bool locked = false;
 	struct obj_cgroup *objcg = NULL;
 	static int warn_limit = 10;
 	struct pcpu_chunk *chunk, *next;
@@ -1764,6 +1808,20 @@ static void __percpu *pcpu_alloc(size_t size, size_t align, bool reserved,
 		return NULL;
 
 	if (!is_atomic) {
+		/*
+		 * pcpu_alloc_mutex is held across chunk creation and
+		 * population, which can take a long time.  An area that is
+		 * already populated needs neither, so try that first and
+		 * only serialize when the slow path is really needed.
+		 */
+		if (!reserved) {
+			spin_lock_irqsave(&pcpu_lock, flags);
+			off = pcpu_alloc_populated(size, bits, bit_align, &chunk);
+			if (off >= 0)
+				goto area_found;
+			spin_unlock_irqrestore(&pcpu_lock, flags);
+		}
+
 		/*
 		 * pcpu_balance_workfn() allocates memory under this mutex,
 		 * and it may wait for memory reclaim. Allow current task
@@ -1775,6 +1833,7 @@ static void __percpu *pcpu_alloc(size_t size, size_t align, bool reserved,
 			pcpu_memcg_post_alloc_hook(objcg, NULL, 0, size);
 			return NULL;
 		}
+		locked = true;
 	}
 
 	spin_lock_irqsave(&pcpu_lock, flags);
@@ -1850,7 +1909,7 @@ static void __percpu *pcpu_alloc(size_t size, size_t align, bool reserved,
 	spin_unlock_irqrestore(&pcpu_lock, flags);
 
 	/* populate if not all pages are already there */
-	if (!is_atomic) {
+	if (locked) {
 		unsigned int page_start, page_end, rs, re;
 
 		page_start = PFN_DOWN(off);
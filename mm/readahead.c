@@ -23,6 +23,7 @@
 #include <linux/blk-cgroup.h>
 #include <linux/fadvise.h>
 #include <linux/sched/mm.h>
+#include <linux/cpuset.h>
 
 #include "internal.h"
 
@@ -124,6 +125,9 @@ static void read_pages(struct readahead_control *rac, struct list_head *pages,
 	if (!readahead_count(rac))
 		goto out;
 
+	atomic_long_add(readahead_count(rac),
+			&inode_to_bdi(rac->mapping->host)->ra_submitted);
+
 	blk_start_plug(&plug);
 
 	if (aops->readahead) {
@@ -157,6 +161,52 @@ static void read_pages(struct readahead_control *rac, struct list_head *pages,
 		rac->_index++;
 }
 
+/*
+ * Readahead takes its pages from the page allocator in batches of up to
+ * RA_BULK_PAGES, so that a large sequential read does not pay the full
+ * allocator entry cost for every page. Bulk allocation is local to the
+ * current node, so it is skipped when a cpuset spread or a task mempolicy
+ * would place the pages elsewhere.
+ */
+#define RA_BULK_PAGES	PAGEVEC_SIZE
+
+struct ra_page_pool {
+	unsigned int nr;
+	struct page *pages[RA_BULK_PAGES];
+};
+
+static bool ra_can_alloc_bulk(void)
+{
+#ifdef CONFIG_NUMA
+	if (cpuset_do_page_mem_spread() || current->mempolicy)
+		return false;
+#endif
+	return true;
+}
+
+static struct page *ra_alloc_page(struct ra_page_pool *pool, gfp_t gfp,
+				  unsigned long nr_wanted)
+{
+	struct page *page;
+
+	if (!pool->nr && nr_wanted > 1 && ra_can_alloc_bulk())
+		pool->nr = alloc_pages_bulk_array(gfp,
+				min_t(unsigned long, nr_wanted, RA_BULK_PAGES),
+				pool->pages);
+	if (!pool->nr)
+		return __page_cache_alloc(gfp);
+
+	page = pool->pages[--pool->nr];
+	pool->pages[pool->nr] = NULL;
+	return page;
+}
+
+static void ra_free_pool(struct ra_page_pool *pool)
+{
+	while (pool->nr)
+		put_page(pool->pages[--pool->nr]);
+}
+
 /**
  * page_cache_ra_unbounded - Start unchecked readahead.
  * @ractl: Readahead control.
@@ -177,6 +227,7 @@ void page_cache_ra_unbounded(struct readahead_control *ractl,
 	struct address_space *mapping = ractl->mapping;
 	unsigned long index = readahead_index(ractl);
 	LIST_HEAD(page_pool);
+	struct ra_page_pool pool = { };
 	gfp_t gfp_mask = readahead_gfp_mask(mapping);
 	unsigned long i;
 
@@ -213,7 +264,7 @@ void page_cache_ra_unbounded(struct readahead_control *ractl,
 			continue;
 		}
 
-		page = __page_cache_alloc(gfp_mask);
+		page = ra_alloc_page(&pool, gfp_mask, nr_to_read - i);
 		if (!page)
 			break;
 		if (mapping->a_ops->readpages) {
@@ -238,6 +289,7 @@ void page_cache_ra_unbounded(struct readahead_control *ractl,
 	 */
 	read_pages(ractl, &page_pool, false);
 	filemap_invalidate_unlock_shared(mapping);
+	ra_free_pool(&pool);
 	memalloc_nofs_restore(nofs);
 }
 EXPORT_SYMBOL_GPL(page_cache_ra_unbounded);
@@ -432,6 +484,58 @@ static int try_context_readahead(struct address_space *mapping,
 	return 1;
 }
 
+/*
+ * Readahead feedback.
+ *
+ * A sequential reader arriving at the end of the last readahead window has
+ * consumed it; a cache miss inside the last window means its pages were
+ * evicted before they were used.  Halve the file's ra_pages as soon as more
+ * than 1/RA_WASTE_RATIO of the readahead since the last adjustment went to
+ * waste, and double it, up to RA_MAX_SCALE times the bdi default, once
+ * RA_GROW_WINDOWS full windows have been consumed without that happening.
+ */
+#define RA_GROW_WINDOWS	8
+#define RA_WASTE_RATIO	8
+#define RA_MAX_SCALE	4
+#define RA_MIN_PAGES	4
+
+static void ra_feedback_reset(struct file_ra_state *ra)
+{
+	ra->consumed = 0;
+	ra->wasted = 0;
+}
+
+static void ra_account_consumed(struct backing_dev_info *bdi,
+				struct file_ra_state *ra, unsigned long nr)
+{
+	unsigned long max_pages = RA_MAX_SCALE * bdi->ra_pages;
+
+	atomic_long_add(nr, &bdi->ra_consumed);
+	ra->consumed += nr;
+	if (ra->consumed < RA_GROW_WINDOWS * ra->ra_pages)
+		return;
+
+	if (ra->wasted * RA_WASTE_RATIO <= ra->consumed &&
+	    ra->ra_pages < max_pages)
+		ra->ra_pages = min_t(unsigned long, ra->ra_pages * 2,
+				     max_pages);
+	ra_feedback_reset(ra);
+}
+
+static void ra_account_wasted(struct backing_dev_info *bdi,
+			      struct file_ra_state *ra, unsigned long nr)
+{
+	atomic_long_add(nr, &bdi->ra_wasted);
+	ra->wasted += nr;
+	if (ra->wasted * RA_WASTE_RATIO <= ra->consumed)
+		return;
+
+	if (ra->ra_pages > RA_MIN_PAGES)
+		ra->ra_pages = max_t(unsigned int, ra->ra_pages / 2,
+				     RA_MIN_PAGES);
+	ra_feedback_reset(ra);
+}
+
 /*
  * A minimal readahead algorithm for trivial sequential/random reads.
  */
@@ -464,12 +568,20 @@ static void ondemand_readahead(struct readahead_control *ractl,
 	 */
 	if ((index == (ra->start + ra->size - ra->async_size) ||
 	     index == (ra->start + ra->size))) {
+		ra_account_consumed(bdi, ra, ra->size);
 		ra->start += ra->size;
 		ra->size = get_next_ra_size(ra, max_pages);
 		ra->async_size = ra->size;
 		goto readit;
 	}
 
+	/*
+	 * A cache miss inside the last readahead window: those pages were
+	 * read ahead but evicted before the reader got to them.
+	 */
+	if (!hit_readahead_marker && ra_has_index(ra, index))
+		ra_account_wasted(bdi, ra, ra->start + ra->size - index);
+
 	/*
 	 * Hit a marked page without valid readahead state.
 	 * E.g. interleaved reads.
@@ -2620,6 +2620,13 @@ static inline void flush_slab(struct kmem_cache *s, struct kmem_cache_cpu *c)
 	}
 }
 
+struct slub_percpu_sheaves;
+
+static void __pcs_flush(struct kmem_cache *s, struct slub_percpu_sheaves *pcs);
+static bool pcs_has_objects(struct kmem_cache *s, int cpu);
+static void *alloc_from_pcs(struct kmem_cache *s, gfp_t gfp);
+static void free_to_pcs(struct kmem_cache *s, void *object);
+
 static inline void __flush_cpu_slab(struct kmem_cache *s, int cpu)
 {
 	struct kmem_cache_cpu *c = per_cpu_ptr(s->cpu_slab, cpu);
@@ -2664,13 +2671,21 @@ static void flush_cpu_slab(struct work_struct *w)
 		flush_slab(s, c);
 
 	unfreeze_partials(s);
+
+	if (s->cpu_sheaves) {
+		unsigned long flags;
+
+		local_lock_irqsave(&s->cpu_sheaves->lock, flags);
+		__pcs_flush(s, this_cpu_ptr(s->cpu_sheaves));
+		local_unlock_irqrestore(&s->cpu_sheaves->lock, flags);
+	}
 }
 
 static bool has_cpu_slab(int cpu, struct kmem_cache *s)
 {
 	struct kmem_cache_cpu *c = per_cpu_ptr(s->cpu_slab, cpu);
 
-	return c->page || slub_percpu_partial(c);
+	return c->page || slub_percpu_partial(c) || pcs_has_objects(s, cpu);
 }
 
 static DEFINE_MUTEX(flush_lock);
@@ -2722,8 +2737,11 @@ static int slub_cpu_dead(unsigned int cpu)
 	struct kmem_cache *s;
 
 	mutex_lock(&slab_mutex);
-	list_for_each_entry(s, &slab_caches, list)
+	list_for_each_entry(s, &slab_caches, list) {
 		__flush_cpu_slab(s, cpu);
+		if (s->cpu_sheaves)
+			__pcs_flush(s, per_cpu_ptr(s->cpu_sheaves, cpu));
+	}
 	mutex_unlock(&slab_mutex);
 	return 0;
 }
@@ -3139,6 +3157,12 @@ static __always_inline void *slab_alloc_node(struct kmem_cache *s,
 	if (unlikely(object))
 		goto out;
 
+	if (s->cpu_sheaves && node == NUMA_NO_NODE) {
+		object = alloc_from_pcs(s, gfpflags);
+		if (likely(object))
+			goto wipe;
+	}
+
 redo:
 	/*
 	 * Must read kmem_cache cpu data via this cpu ptr. Preemption is
@@ -3213,6 +3237,7 @@ static __always_inline void *slab_alloc_node(struct kmem_cache *s,
 		stat(s, ALLOC_FASTPATH);
 	}
 
+wipe:
 	maybe_wipe_obj_freeptr(s, object);
 	init = slab_want_init_on_alloc(gfpflags, s);
 
@@ -3496,8 +3521,17 @@ static __always_inline void slab_free(struct kmem_cache *s, struct page *page,
 	 * With KASAN enabled slab_free_freelist_hook modifies the freelist
 	 * to remove objects, whose reuse must be delayed.
 	 */
-	if (slab_free_freelist_hook(s, &head, &tail, &cnt))
-		do_slab_free(s, page, head, tail, cnt, addr);
+	if (!slab_free_freelist_hook(s, &head, &tail, &cnt))
+		return;
+
+	/* Single objects go to the percpu sheaf if the cache has one */
+	if (s->cpu_sheaves && !tail && !is_kfence_address(head)) {
+		memcg_slab_free_hook(s, &head, 1);
+		free_to_pcs(s, head);
+		return;
+	}
+
+	do_slab_free(s, page, head, tail, cnt, addr);
 }
 
 #ifdef CONFIG_KASAN_GENERIC
@@ -3642,18 +3676,18 @@ void kmem_cache_free_bulk(struct kmem_cache *s, size_t size, void **p)
 }
 EXPORT_SYMBOL(kmem_cache_free_bulk);
 
-/* Note that interrupts must be enabled when calling this function. */
-int kmem_cache_alloc_bulk(struct kmem_cache *s, gfp_t flags, size_t size,
-			  void **p)
+/*
+ * Allocate objects into the array without running the alloc hooks or KFENCE,
+ * return the number of objects allocated.
+ *
+ * Note that interrupts must be enabled when calling this function.
+ */
+static int __slab_alloc_bulk(struct kmem_cache *s, gfp_t flags, size_t size,
+			     void **p)
 {
 	struct kmem_cache_cpu *c;
 	int i;
-	struct obj_cgroup *objcg = NULL;
 
-	/* memcg and kmem_cache debug support */
-	s = slab_pre_alloc_hook(s, &objcg, size, flags);
-	if (unlikely(!s))
-		return false;
 	/*
 	 * Drain objects in the per cpu slab, while disabling local
 	 * IRQs, which protects against PREEMPT and interrupts
@@ -3663,14 +3697,8 @@ int kmem_cache_alloc_bulk(struct kmem_cache *s, gfp_t flags, size_t size,
 	local_lock_irq(&s->cpu_slab->lock);
 
 	for (i = 0; i < size; i++) {
-		void *object = kfence_alloc(s, s->object_size, flags);
+		void *object = c->freelist;
 
-		if (unlikely(object)) {
-			p[i] = object;
-			continue;
-		}
-
-		object = c->freelist;
 		if (unlikely(!object)) {
 			/*
 			 * We may have removed an object from c->freelist using
@@ -3689,8 +3717,10 @@ int kmem_cache_alloc_bulk(struct kmem_cache *s, gfp_t flags, size_t size,
 			 */
 			p[i] = ___slab_alloc(s, flags, NUMA_NO_NODE,
 					    _RET_IP_, c);
-			if (unlikely(!p[i]))
-				goto error;
+			if (unlikely(!p[i])) {
+				slub_put_cpu_ptr(s->cpu_slab);
+				return i;
+			}
 
 			c = this_cpu_ptr(s->cpu_slab);
 			maybe_wipe_obj_freeptr(s, p[i]);
@@ -3707,6 +3737,33 @@ int kmem_cache_alloc_bulk(struct kmem_cache *s, gfp_t flags, size_t size,
 	local_unlock_irq(&s->cpu_slab->lock);
 	slub_put_cpu_ptr(s->cpu_slab);
 
+	return i;
+}
+
+/* Note that interrupts must be enabled when calling this function. */
+int kmem_cache_alloc_bulk(struct kmem_cache *s, gfp_t flags, size_t size,
+			  void **p)
+{
+	struct obj_cgroup *objcg = NULL;
+	void *object;
+	int i = 0;
+
+	/* memcg and kmem_cache debug support */
+	s = slab_pre_alloc_hook(s, &objcg, size, flags);
+	if (unlikely(!s))
+		return false;
+
+	object = kfence_alloc(s, s->object_size, flags);
+	if (unlikely(object))
+		p[i++] = object;
+
+	i += __slab_alloc_bulk(s, flags, size - i, p + i);
+	if (unlikely(i < size)) {
+		slab_post_alloc_hook(s, objcg, flags, i, p, false);
+		__kmem_cache_free_bulk(s, i, p);
+		return 0;
+	}
+
 	/*
 	 * memcg and kmem_cache debug support and memory initialization.
 	 * Done outside of the IRQ disabled fastpath loop.
@@ -3714,14 +3771,335 @@ int kmem_cache_alloc_bulk(struct kmem_cache *s, gfp_t flags, size_t size,
 	slab_post_alloc_hook(s, objcg, flags, size, p,
 				slab_want_init_on_alloc(flags, s));
 	return i;
-error:
-	slub_put_cpu_ptr(s->cpu_slab);
-	slab_post_alloc_hook(s, objcg, flags, i, p, false);
-	__kmem_cache_free_bulk(s, i, p);
-	return 0;
 }
 EXPORT_SYMBOL(kmem_cache_alloc_bulk);
 
+/*
+ * Percpu sheaves, enabled with SLAB_PERCPU_SHEAVES.
+ *
+ * A sheaf is an array of free object pointers. Each cpu allocates from and
+ * frees to its main sheaf and keeps a spare one to swap in when the main sheaf
+ * runs empty or full. Only when that fails are the slabs touched, and then a
+ * whole sheaf is refilled or flushed with the bulk paths, so objects that
+ * move between cpus no longer cost a cmpxchg_double on a shared slab each.
+ *
+ * Objects in the main and spare sheaves have been through the free hooks and
+ * go through the alloc hooks again when handed out. The rcu_free sheaf
+ * collects objects passed to kfree_rcu(), which are freed together once a
+ * grace period has elapsed after the sheaf filled up or was flushed.
+ */
+struct slab_sheaf {
+	struct rcu_head rcu_head;
+	struct kmem_cache *cache;
+	unsigned int size;
+	void *objects[];
+};
+
+struct slub_percpu_sheaves {
+	local_lock_t lock;
+	struct slab_sheaf *main;	/* never NULL */
+	struct slab_sheaf *spare;	/* may be NULL */
+	struct slab_sheaf *rcu_free;	/* may be NULL */
+};
+
+static struct slab_sheaf *alloc_empty_sheaf(struct kmem_cache *s, gfp_t gfp)
+{
+	struct slab_sheaf *sheaf;
+
+	sheaf = kzalloc(struct_size(sheaf, objects, s->sheaf_capacity),
+			(gfp & GFP_RECLAIM_MASK) | __GFP_NOWARN);
+	if (sheaf)
+		sheaf->cache = s;
+
+	return sheaf;
+}
+
+static void free_empty_sheaf(struct slab_sheaf *sheaf)
+{
+	kfree(sheaf);
+}
+
+/*
+ * Return objects that already went through the free hooks to their slabs.
+ */
+static void __slab_free_bulk(struct kmem_cache *s, size_t size, void **p)
+{
+	do {
+		struct detached_freelist df;
+
+		size = build_detached_freelist(s, size, p, &df);
+		if (!df.page)
+			continue;
+
+		do_slab_free(df.s, df.page, df.freelist, df.tail, df.cnt, _RET_IP_);
+	} while (likely(size));
+}
+
+static void sheaf_flush(struct kmem_cache *s, struct slab_sheaf *sheaf)
+{
+	if (!sheaf->size)
+		return;
+
+	__slab_free_bulk(s, sheaf->size, sheaf->objects);
+	sheaf->size = 0;
+	stat(s, SHEAF_FLUSH);
+}
+
+static void rcu_free_sheaf(struct rcu_head *head)
+{
+	struct slab_sheaf *sheaf = container_of(head, struct slab_sheaf, rcu_head);
+	struct kmem_cache *s = sheaf->cache;
+	bool init = slab_want_init_on_free(s);
+	unsigned int i, j = 0;
+
+	/* Objects queued by kfree_rcu() have not seen the free hooks yet */
+	memcg_slab_free_hook(s, sheaf->objects, sheaf->size);
+	for (i = 0; i < sheaf->size; i++) {
+		void *object = sheaf->objects[i];
+
+		/* KASAN may delay the reuse of the object */
+		if (!slab_free_hook(s, object, init))
+			sheaf->objects[j++] = object;
+	}
+	sheaf->size = j;
+
+	sheaf_flush(s, sheaf);
+	free_empty_sheaf(sheaf);
+}
+
+/*
+ * Flush all sheaves of a cpu. Pending kfree_rcu() objects are submitted to
+ * RCU. The caller must hold the sheaves lock or the cpu must be dead.
+ */
+static void __pcs_flush(struct kmem_cache *s, struct slub_percpu_sheaves *pcs)
+{
+	sheaf_flush(s, pcs->main);
+
+	if (pcs->spare) {
+		sheaf_flush(s, pcs->spare);
+		free_empty_sheaf(pcs->spare);
+		pcs->spare = NULL;
+	}
+
+	if (pcs->rcu_free) {
+		call_rcu(&pcs->rcu_free->rcu_head, rcu_free_sheaf);
+		pcs->rcu_free = NULL;
+	}
+}
+
+static bool pcs_has_objects(struct kmem_cache *s, int cpu)
+{
+	struct slub_percpu_sheaves *pcs;
+
+	if (!s->cpu_sheaves)
+		return false;
+
+	pcs = per_cpu_ptr(s->cpu_sheaves, cpu);
+	return pcs->main->size || pcs->spare || pcs->rcu_free;
+}
+
+/*
+ * Both sheaves of this cpu are empty. Fill a new sheaf with the bulk path and
+ * make it the main sheaf. Returns NULL when the caller should fall back to
+ * the regular allocation path.
+ */
+static void *refill_pcs(struct kmem_cache *s, gfp_t gfp)
+{
+	struct slub_percpu_sheaves *pcs;
+	struct slab_sheaf *sheaf;
+	unsigned long flags;
+	void *object;
+
+	/* __slab_alloc_bulk() needs interrupts enabled */
+	if (irqs_disabled())
+		return NULL;
+
+	sheaf = alloc_empty_sheaf(s, gfp);
+	if (!sheaf)
+		return NULL;
+
+	sheaf->size = __slab_alloc_bulk(s, gfp, s->sheaf_capacity,
+					sheaf->objects);
+	if (!sheaf->size) {
+		free_empty_sheaf(sheaf);
+		return NULL;
+	}
+	stat(s, SHEAF_REFILL);
+
+	object = sheaf->objects[--sheaf->size];
+
+	local_lock_irqsave(&s->cpu_sheaves->lock, flags);
+	pcs = this_cpu_ptr(s->cpu_sheaves);
+
+	/* We may have migrated, or the sheaves changed under us */
+	if (!pcs->main->size)
+		swap(pcs->main, sheaf);
+	if (!pcs->spare) {
+		pcs->spare = sheaf;
+		sheaf = NULL;
+	}
+
+	local_unlock_irqrestore(&s->cpu_sheaves->lock, flags);
+
+	if (sheaf) {
+		sheaf_flush(s, sheaf);
+		free_empty_sheaf(sheaf);
+	}
+
+	return object;
+}
+
+static void *alloc_from_pcs(struct kmem_cache *s, gfp_t gfp)
+{
+	struct slub_percpu_sheaves *pcs;
+	unsigned long flags;
+	void *object;
+
+	local_lock_irqsave(&s->cpu_sheaves->lock, flags);
+	pcs = this_cpu_ptr(s->cpu_sheaves);
+
+	if (unlikely(!pcs->main->size)) {
+		if (!pcs->spare || !pcs->spare->size) {
+			local_unlock_irqrestore(&s->cpu_sheaves->lock, flags);
+			return refill_pcs(s, gfp);
+		}
+		swap(pcs->main, pcs->spare);
+	}
+
+	object = pcs->main->objects[--pcs->main->size];
+	local_unlock_irqrestore(&s->cpu_sheaves->lock, flags);
+
+	stat(s, ALLOC_PCS);
+	return object;
+}
+
+static void free_to_pcs(struct kmem_cache *s, void *object)
+{
+	struct slub_percpu_sheaves *pcs;
+	unsigned long flags;
+
+	local_lock_irqsave(&s->cpu_sheaves->lock, flags);
+	pcs = this_cpu_ptr(s->cpu_sheaves);
+
+	if (unlikely(pcs->main->size == s->sheaf_capacity)) {
+		if (!pcs->spare)
+			pcs->spare = alloc_empty_sheaf(s, GFP_NOWAIT);
+		if (pcs->spare && pcs->spare->size < s->sheaf_capacity)
+			swap(pcs->main, pcs->spare);
+		else
+			sheaf_flush(s, pcs->main);
+	}
+
+	pcs->main->objects[pcs->main->size++] = object;
+	local_unlock_irqrestore(&s->cpu_sheaves->lock, flags);
+
+	stat(s, FREE_PCS);
+}
+
+/*
+ * Queue an object passed to kfree_rcu() on the rcu_free sheaf of its cache,
+ * if the cache has sheaves. The whole sheaf is handed to call_rcu() once full.
+ */
+bool kfree_rcu_sheaf(void *obj)
+{
+	struct slub_percpu_sheaves *pcs;
+	struct slab_sheaf *rcu_sheaf;
+	struct kmem_cache *s;
+	unsigned long flags;
+	struct page *page;
+
+	if (is_vmalloc_addr(obj) || is_kfence_address(obj))
+		return false;
+
+	page = virt_to_head_page(obj);
+	if (unlikely(!PageSlab(page)))
+		return false;
+
+	s = page->slab_cache;
+	if (!s->cpu_sheaves)
+		return false;
+
+	local_lock_irqsave(&s->cpu_sheaves->lock, flags);
+	pcs = this_cpu_ptr(s->cpu_sheaves);
+
+	if (unlikely(!pcs->rcu_free)) {
+		pcs->rcu_free = alloc_empty_sheaf(s, GFP_NOWAIT);
+		if (!pcs->rcu_free) {
+			local_unlock_irqrestore(&s->cpu_sheaves->lock, flags);
+			return false;
+		}
+	}
+
+	rcu_sheaf = pcs->rcu_free;
+	rcu_sheaf->objects[rcu_sheaf->size++] = obj;
+	if (rcu_sheaf->size == s->sheaf_capacity)
+		pcs->rcu_free = NULL;
+	else
+		rcu_sheaf = NULL;
+
+	local_unlock_irqrestore(&s->cpu_sheaves->lock, flags);
+
+	if (rcu_sheaf)
+		call_rcu(&rcu_sheaf->rcu_head, rcu_free_sheaf);
+
+	stat(s, FREE_RCU_SHEAF);
+	return true;
+}
+
+/*
+ * Submit the partially filled rcu_free sheaves and wait for them, so that all
+ * objects queued by kfree_rcu() are back in their slabs.
+ */
+void flush_rcu_sheaves(struct kmem_cache *s)
+{
+	if (!s->cpu_sheaves)
+		return;
+
+	flush_all(s);
+	rcu_barrier();
+}
+
+static int init_percpu_sheaves(struct kmem_cache *s)
+{
+	int cpu;
+
+	s->cpu_sheaves = alloc_percpu(struct slub_percpu_sheaves);
+	if (!s->cpu_sheaves)
+		return 0;
+
+	for_each_possible_cpu(cpu) {
+		struct slub_percpu_sheaves *pcs;
+
+		pcs = per_cpu_ptr(s->cpu_sheaves, cpu);
+		local_lock_init(&pcs->lock);
+		pcs->main = alloc_empty_sheaf(s, GFP_KERNEL);
+		if (!pcs->main)
+			return 0;
+	}
+
+	return 1;
+}
+
+static void free_percpu_sheaves(struct kmem_cache *s)
+{
+	int cpu;
+
+	if (!s->cpu_sheaves)
+		return;
+
+	/* Any objects were flushed by __kmem_cache_shutdown() */
+	for_each_possible_cpu(cpu) {
+		struct slub_percpu_sheaves *pcs;
+
+		pcs = per_cpu_ptr(s->cpu_sheaves, cpu);
+		free_empty_sheaf(pcs->main);
+		free_empty_sheaf(pcs->spare);
+	}
+
+	free_percpu(s->cpu_sheaves);
+	s->cpu_sheaves = NULL;
+}
+
 
 /*
  * Object placement in a slab is made very easy because we always start at
@@ -3955,6 +4333,7 @@ static void free_kmem_cache_nodes(struct kmem_cache *s)
 void __kmem_cache_release(struct kmem_cache *s)
 {
 	cache_random_seq_destroy(s);
+	free_percpu_sheaves(s);
 	free_percpu(s->cpu_slab);
 	free_kmem_cache_nodes(s);
 }
@@ -4216,8 +4595,22 @@ static int kmem_cache_open(struct kmem_cache *s, slab_flags_t flags)
 	if (!init_kmem_cache_nodes(s))
 		goto error;
 
-	if (alloc_kmem_cache_cpus(s))
-		return 0;
+	if (!alloc_kmem_cache_cpus(s))
+		goto error;
+
+	/*
+	 * Sheaves are allocated with kmalloc() and would bypass the debug
+	 * checks done in the slow paths.
+	 */
+	if ((s->flags & SLAB_PERCPU_SHEAVES) && slab_state >= UP &&
+	    !(s->flags & SLAB_DEBUG_FLAGS)) {
+		/* Roughly one slab worth of objects per sheaf */
+		s->sheaf_capacity = clamp(oo_objects(s->oo), 4U, 32U);
+		if (!init_percpu_sheaves(s))
+			goto error;
+	}
+
+	return 0;
 
 error:
 	__kmem_cache_release(s);
@@ -5425,6 +5818,12 @@ static ssize_t cpu_partial_store(struct kmem_cache *s, const char *buf,
 }
 SLAB_ATTR(cpu_partial);
 
+static ssize_t sheaf_capacity_show(struct kmem_cache *s, char *buf)
+{
+	return sysfs_emit(buf, "%u\n", s->cpu_sheaves ? s->sheaf_capacity : 0);
+}
+SLAB_ATTR_RO(sheaf_capacity);
+
 static ssize_t ctor_show(struct kmem_cache *s, char *buf)
 {
 	if (!s->ctor)
@@ -5729,6 +6128,11 @@ STAT_ATTR(CPU_PARTIAL_ALLOC, cpu_partial_alloc);
 STAT_ATTR(CPU_PARTIAL_FREE, cpu_partial_free);
 STAT_ATTR(CPU_PARTIAL_NODE, cpu_partial_node);
 STAT_ATTR(CPU_PARTIAL_DRAIN, cpu_partial_drain);
+STAT_ATTR(ALLOC_PCS, alloc_cpu_sheaf);
+STAT_ATTR(FREE_PCS, free_cpu_sheaf);
+STAT_ATTR(SHEAF_REFILL, sheaf_refill);
+STAT_ATTR(SHEAF_FLUSH, sheaf_flush);
+STAT_ATTR(FREE_RCU_SHEAF, free_rcu_sheaf);
 #endif	/* CONFIG_SLUB_STATS */
 
 static struct attribute *slab_attrs[] = {
@@ -5738,6 +6142,7 @@ static struct attribute *slab_attrs[] = {
 	&order_attr.attr,
 	&min_partial_attr.attr,
 	&cpu_partial_attr.attr,
+	&sheaf_capacity_attr.attr,
 	&objects_attr.attr,
 	&objects_partial_attr.attr,
 	&partial_attr.attr,
@@ -5793,6 +6198,11 @@ static struct attribute *slab_attrs[] = {
 	&cpu_partial_free_attr.attr,
 	&cpu_partial_node_attr.attr,
 	&cpu_partial_drain_attr.attr,
+	&alloc_cpu_sheaf_attr.attr,
+	&free_cpu_sheaf_attr.attr,
+	&sheaf_refill_attr.attr,
+	&sheaf_flush_attr.attr,
+	&free_rcu_sheaf_attr.attr,
 #endif
 #ifdef CONFIG_FAILSLAB
 	&failslab_attr.attr,
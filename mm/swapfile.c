@@ -87,6 +87,23 @@ PLIST_HEAD(swap_active_head);
  */
 static struct plist_head *swap_avail_heads;
 static DEFINE_SPINLOCK(swap_avail_lock);
+/* bumped under swap_avail_lock whenever swap_avail_heads changes */
+static unsigned long swap_avail_gen;
+
+/*
+ * The swap device each CPU last allocated from. get_swap_pages() tries it
+ * first without swap_avail_lock, so that with several devices of the same
+ * priority the CPUs spread over the devices instead of all serializing on
+ * swap_avail_lock. It is only a hint: the device is rechecked under its
+ * own lock, and it is dropped when swap_avail_gen changes or when its lock
+ * is contended, in which case the slow path moves the CPU on to the next
+ * device of the same priority.
+ */
+struct swap_pcp_dev {
+	struct swap_info_struct *si;
+	unsigned long gen;
+};
+static DEFINE_PER_CPU(struct swap_pcp_dev, swap_pcp_dev);
 
 struct swap_info_struct *swap_info[MAX_SWAPFILES];
 
@@ -676,6 +693,7 @@ static void __del_from_avail_list(struct swap_info_struct *p)
 	assert_spin_locked(&p->lock);
 	for_each_node(nid)
 		plist_del(&p->avail_lists[nid], &swap_avail_heads[nid]);
+	WRITE_ONCE(swap_avail_gen, swap_avail_gen + 1);
 }
 
 static void del_from_avail_list(struct swap_info_struct *p)
@@ -711,6 +729,7 @@ static void add_to_avail_list(struct swap_info_struct *p)
 		WARN_ON(!plist_node_empty(&p->avail_lists[nid]));
 		plist_add(&p->avail_lists[nid], &swap_avail_heads[nid]);
 	}
+	WRITE_ONCE(swap_avail_gen, swap_avail_gen + 1);
 	spin_unlock(&swap_avail_lock);
 }
 
@@ -1037,34 +1056,69 @@ static void swap_free_cluster(struct swap_info_struct *si, unsigned long idx)
 	swap_range_free(si, offset, SWAPFILE_CLUSTER);
 }
 
+/*
+ * Allocate order-0 entries from this CPU's last device, if it is still
+ * usable and its lock is not contended.
+ */
+static int get_swap_pages_pcp(int n_goal, swp_entry_t swp_entries[])
+{
+	struct swap_info_struct *si = this_cpu_read(swap_pcp_dev.si);
+	int n_ret = 0;
+
+	if (!si || this_cpu_read(swap_pcp_dev.gen) != READ_ONCE(swap_avail_gen))
+		return 0;
+
+	if (!spin_trylock(&si->lock)) {
+		this_cpu_write(swap_pcp_dev.si, NULL);
+		return 0;
+	}
+	if (si->highest_bit && (si->flags & SWP_WRITEOK))
+		n_ret = scan_swap_map_slots(si, SWAP_HAS_CACHE, n_goal,
+					    swp_entries);
+	spin_unlock(&si->lock);
+
+	if (!n_ret)
+		this_cpu_write(swap_pcp_dev.si, NULL);
+	return n_ret;
+}
+
 int get_swap_pages(int n_goal, swp_entry_t swp_entries[], int entry_size)
 {
 	unsigned long size = swap_entry_size(entry_size);
 	struct swap_info_struct *si, *next;
-	long avail_pgs;
+	long avail, avail_pgs;
+	unsigned long gen;
+	int n_want = n_goal;
 	int n_ret = 0;
 	int node;
 
 	/* Only single cluster request supported */
 	WARN_ON_ONCE(n_goal > 1 && size == SWAPFILE_CLUSTER);
 
-	spin_lock(&swap_avail_lock);
-
-	avail_pgs = atomic_long_read(&nr_swap_pages) / size;
-	if (avail_pgs <= 0) {
-		spin_unlock(&swap_avail_lock);
-		goto noswap;
+	/* Reserve the entries up front, without taking swap_avail_lock */
+	avail = atomic_long_read(&nr_swap_pages);
+	do {
+		avail_pgs = avail / size;
+		if (avail_pgs <= 0)
+			goto noswap;
+		n_goal = min3((long)n_want, (long)SWAP_BATCH, avail_pgs);
+	} while (!atomic_long_try_cmpxchg(&nr_swap_pages, &avail,
+					  avail - n_goal * size));
+
+	if (size == 1) {
+		n_ret = get_swap_pages_pcp(n_goal, swp_entries);
+		if (n_ret)
+			goto check_out;
 	}
 
-	n_goal = min3((long)n_goal, (long)SWAP_BATCH, avail_pgs);
-
-	atomic_long_sub(n_goal * size, &nr_swap_pages);
+	spin_lock(&swap_avail_lock);
 
 start_over:
 	node = numa_node_id();
 	plist_for_each_entry_safe(si, next, &swap_avail_heads[node], avail_lists[node]) {
 		/* requeue si to after same-priority siblings */
 		plist_requeue(&si->avail_lists[node], &swap_avail_heads[node]);
+		gen = swap_avail_gen;
 		spin_unlock(&swap_avail_lock);
 		spin_lock(&si->lock);
 		if (!si->highest_bit || !(si->flags & SWP_WRITEOK)) {
@@ -1090,6 +1144,10 @@ int get_swap_pages(int n_goal, swp_entry_t swp_entries[], int entry_size)
 			n_ret = scan_swap_map_slots(si, SWAP_HAS_CACHE,
 						    n_goal, swp_entries);
 		spin_unlock(&si->lock);
+		if (n_ret && size == 1) {
+			this_cpu_write(swap_pcp_dev.si, si);
+			this_cpu_write(swap_pcp_dev.gen, gen);
+		}
 		if (n_ret || size == SWAPFILE_CLUSTER)
 			goto check_out;
 		pr_debug("scan_swap_map of si %d failed to find offset\n",
@@ -1503,6 +1503,146 @@ preload_this_cpu_lock(spinlock_t *lock, gfp_t gfp_mask, int node)
 		kmem_cache_free(vmap_area_cachep, va);
 }
 
+/*
+ * Small lazily-freed areas do not go back to the free tree once the purge
+ * has flushed their TLB entries. Instead they are parked, by exact size,
+ * in one of several pools, indexed by address on the way in and by CPU on
+ * the way out. A vmalloc() of a common small size is then satisfied from
+ * the local pool without taking free_vmap_area_lock at all.
+ */
+#define VMAP_POOL_MAX_PAGES	64
+#define VMAP_POOL_MAX_LEN	32
+#define VMAP_POOL_MAX_NR	32
+
+struct vmap_pool {
+	spinlock_t lock;
+	struct {
+		struct list_head head;
+		unsigned int len;
+	} size[VMAP_POOL_MAX_PAGES];
+};
+
+static struct vmap_pool *vmap_pools __read_mostly;
+static unsigned int nr_vmap_pools __read_mostly;
+
+static struct vmap_area *
+vmap_pool_get(unsigned long size, unsigned long align,
+	unsigned long vstart, unsigned long vend)
+{
+	unsigned long nr = size >> PAGE_SHIFT;
+	struct vmap_area *va;
+	struct vmap_pool *vp;
+
+	if (!nr_vmap_pools || nr > VMAP_POOL_MAX_PAGES ||
+			vstart != VMALLOC_START || vend != VMALLOC_END)
+		return NULL;
+
+	vp = &vmap_pools[raw_smp_processor_id() % nr_vmap_pools];
+
+	spin_lock(&vp->lock);
+	va = list_first_entry_or_null(&vp->size[nr - 1].head,
+		struct vmap_area, list);
+	if (va && IS_ALIGNED(va->va_start, align)) {
+		list_del(&va->list);
+		vp->size[nr - 1].len--;
+	} else {
+		va = NULL;
+	}
+	spin_unlock(&vp->lock);
+
+	return va;
+}
+
+/*
+ * Park a purged area, which must already be TLB-flushed. Returns false if
+ * the area does not fit into a pool, in which case it is left where it is.
+ */
+static bool vmap_pool_put(struct vmap_area *va)
+{
+	unsigned long nr = (va->va_end - va->va_start) >> PAGE_SHIFT;
+	struct vmap_pool *vp;
+	bool ret = false;
+
+	if (!nr_vmap_pools || nr > VMAP_POOL_MAX_PAGES ||
+			va->va_start < VMALLOC_START || va->va_end > VMALLOC_END)
+		return false;
+
+	vp = &vmap_pools[(va->va_start >> PAGE_SHIFT) % nr_vmap_pools];
+
+	spin_lock(&vp->lock);
+	if (vp->size[nr - 1].len < VMAP_POOL_MAX_LEN) {
+		list_move(&va->list, &vp->size[nr - 1].head);
+		vp->size[nr - 1].len++;
+		ret = true;
+	}
+	spin_unlock(&vp->lock);
+
+	return ret;
+}
+
+/*
+ * Give everything parked in the pools back to the free tree, so that
+ * an allocation that does not fit anywhere else can use that space.
+ */
+static void vmap_pools_drain(void)
+{
+	struct vmap_area *va, *n_va;
+	LIST_HEAD(local_list);
+	int i, j;
+
+	for (i = 0; i < nr_vmap_pools; i++) {
+		struct vmap_pool *vp = &vmap_pools[i];
+
+		spin_lock(&vp->lock);
+		for (j = 0; j < VMAP_POOL_MAX_PAGES; j++) {
+			list_splice_init(&vp->size[j].head, &local_list);
+			vp->size[j].len = 0;
+		}
+		spin_unlock(&vp->lock);
+	}
+
+	if (list_empty(&local_list))
+		return;
+
+	spin_lock(&free_vmap_area_lock);
+	list_for_each_entry_safe(va, n_va, &local_list, list) {
+		unsigned long orig_start = va->va_start;
+		unsigned long orig_end = va->va_end;
+
+		va = merge_or_add_vmap_area_augment(va, &free_vmap_area_root,
+				&free_vmap_area_list);
+		if (va)
+			kasan_release_vmalloc(orig_start, orig_end,
+					      va->va_start, va->va_end);
+	}
+	spin_unlock(&free_vmap_area_lock);
+}
+
+static void __init vmap_pools_init(void)
+{
+	unsigned int nr = min_t(unsigned int, num_possible_cpus(),
+				VMAP_POOL_MAX_NR);
+	int i, j;
+
+	/* A single pool would only move the contention elsewhere. */
+	if (nr < 2)
+		return;
+
+	vmap_pools = kmalloc_array(nr, sizeof(*vmap_pools), GFP_NOWAIT);
+	if (WARN_ON_ONCE(!vmap_pools))
+		return;
+
+	for (i = 0; i < nr; i++) {
+		spin_lock_init(&vmap_pools[i].lock);
+		for (j = 0; j < VMAP_POOL_MAX_PAGES; j++) {
+			INIT_LIST_HEAD(&vmap_pools[i].size[j].head);
+			vmap_pools[i].size[j].len = 0;
+		}
+	}
+
+	nr_vmap_pools = nr;
+}
+
 /*
  * Allocate a region of KVA of the specified size and alignment, within the
  * vstart and vend.
@@ -1528,6 +1668,12 @@ static struct vmap_area *alloc_vmap_area(unsigned long size,
 	might_sleep();
 	gfp_mask = gfp_mask & GFP_RECLAIM_MASK;
 
+	va = vmap_pool_get(size, align, vstart, vend);
+	if (va) {
+		addr = va->va_start;
+		goto insert;
+	}
+
 	va = kmem_cache_alloc_node(vmap_area_cachep, gfp_mask, node);
 	if (unlikely(!va))
 		return ERR_PTR(-ENOMEM);
@@ -1552,6 +1698,8 @@ static struct vmap_area *alloc_vmap_area(unsigned long size,
 
 	va->va_start = addr;
 	va->va_end = addr + size;
+
+insert:
 	va->vm = NULL;
 
 	spin_lock(&vmap_area_lock);
@@ -1683,6 +1831,23 @@ static bool __purge_vmap_area_lazy(unsigned long start, unsigned long end)
 	flush_tlb_kernel_range(start, end);
 	resched_threshold = lazy_max_pages() << 1;
 
+	/*
+	 * Park what fits into the pools first, that does not need
+	 * free_vmap_area_lock.
+	 */
+	list_for_each_entry_safe(va, n_va, &local_pure_list, list) {
+		unsigned long nr = (va->va_end - va->va_start) >> PAGE_SHIFT;
+		unsigned long orig_start = va->va_start;
+		unsigned long orig_end = va->va_end;
+
+		if (!vmap_pool_put(va))
+			continue;
+
+		kasan_release_vmalloc(orig_start, orig_end,
+				      orig_start, orig_end);
+		atomic_long_sub(nr, &vmap_lazy_nr);
+	}
+
 	spin_lock(&free_vmap_area_lock);
 	list_for_each_entry_safe(va, n_va, &local_pure_list, list) {
 		unsigned long nr = (va->va_end - va->va_start) >> PAGE_SHIFT;
@@ -1733,6 +1898,7 @@ static void purge_vmap_area_lazy(void)
 	mutex_lock(&vmap_purge_lock);
 	purge_fragmented_blocks_allcpus();
 	__purge_vmap_area_lazy(ULONG_MAX, 0);
+	vmap_pools_drain();
 	mutex_unlock(&vmap_purge_lock);
 }
 
@@ -2334,6 +2500,7 @@ void __init vmalloc_init(void)
 	 * Create the cache for vmap_area objects.
 	 */
 	vmap_area_cachep = KMEM_CACHE(vmap_area, SLAB_PANIC);
+	vmap_pools_init();
 
 	for_each_possible_cpu(i) {
 		struct vmap_block_queue *vbq;
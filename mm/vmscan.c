@@ -182,6 +182,11 @@ struct scan_control {
  */
 int vm_swappiness = 60;
 
+/*
+ * Number of kswapd threads per node, from 1 .. MAX_KSWAPD_THREADS.
+ */
+int kswapd_threads = 1;
+
 static void set_task_reclaim_state(struct task_struct *task,
 				   struct reclaim_state *rs)
 {
@@ -2534,7 +2539,7 @@ static void prepare_scan_count(pg_data_t *pgdat, struct scan_control *sc)
 	 * Flush the memory cgroup stats, so that we read accurate per-memcg
 	 * lruvec stats for heuristics.
 	 */
-	mem_cgroup_flush_stats();
+	mem_cgroup_flush_stats(sc->target_mem_cgroup);
 
 	/*
 	 * Determine the scan balance between anon and file LRUs.
@@ -6042,9 +6047,19 @@ static inline bool should_continue_reclaim(struct pglist_data *pgdat,
 static void shrink_node_memcgs(pg_data_t *pgdat, struct scan_control *sc)
 {
 	struct mem_cgroup *target_memcg = sc->target_mem_cgroup;
+	struct mem_cgroup_reclaim_cookie cookie = { .pgdat = pgdat };
+	struct mem_cgroup_reclaim_cookie *reclaim = NULL;
 	struct mem_cgroup *memcg;
 
-	memcg = mem_cgroup_iter(target_memcg, NULL, NULL);
+	/*
+	 * Multiple kswapd threads of a node share the per-node memcg
+	 * iterator, so that each of them reclaims from different memcgs
+	 * instead of all of them walking the whole hierarchy.
+	 */
+	if (current_is_kswapd() && READ_ONCE(kswapd_threads) > 1)
+		reclaim = &cookie;
+
+	memcg = mem_cgroup_iter(target_memcg, NULL, reclaim);
 	do {
 		struct lruvec *lruvec = mem_cgroup_lruvec(memcg, pgdat);
 		unsigned long reclaimed;
@@ -6093,7 +6108,7 @@ static void shrink_node_memcgs(pg_data_t *pgdat, struct scan_control *sc)
 			   sc->nr_scanned - scanned,
 			   sc->nr_reclaimed - reclaimed);
 
-	} while ((memcg = mem_cgroup_iter(target_memcg, memcg, NULL)));
+	} while ((memcg = mem_cgroup_iter(target_memcg, memcg, reclaim)));
 }
 
 static void shrink_node(pg_data_t *pgdat, struct scan_control *sc)
@@ -6924,8 +6939,10 @@ clear_reclaim_active(pg_data_t *pgdat, int highest_zoneidx)
  * or lower is eligible for reclaim until at least one usable zone is
  * balanced.
  */
-static int balance_pgdat(pg_data_t *pgdat, int order, int highest_zoneidx)
+static int balance_pgdat(struct kswapd_thread *kt, int order,
+			 int highest_zoneidx)
 {
+	pg_data_t *pgdat = kt->pgdat;
 	int i;
 	unsigned long nr_soft_reclaimed;
 	unsigned long nr_soft_scanned;
@@ -7056,6 +7073,7 @@ static int balance_pgdat(pg_data_t *pgdat, int order, int highest_zoneidx)
 		 */
 		if (kswapd_shrink_node(pgdat, &sc))
 			raise_priority = false;
+		WRITE_ONCE(kt->nr_scanned, kt->nr_scanned + sc.nr_scanned);
 
 		/*
 		 * If the low watermark is met there is no need for processes
@@ -7120,6 +7138,8 @@ static int balance_pgdat(pg_data_t *pgdat, int order, int highest_zoneidx)
 		wakeup_kcompactd(pgdat, pageblock_order, highest_zoneidx);
 	}
 
+	WRITE_ONCE(kt->nr_reclaimed, kt->nr_reclaimed + sc.nr_reclaimed);
+
 	snapshot_refaults(NULL, pgdat);
 	__fs_reclaim_release(_THIS_IP_);
 	psi_memstall_leave(&pflags);
@@ -7250,7 +7270,8 @@ static int kswapd(void *p)
 {
 	unsigned int alloc_order, reclaim_order;
 	unsigned int highest_zoneidx = MAX_NR_ZONES - 1;
-	pg_data_t *pgdat = (pg_data_t *)p;
+	struct kswapd_thread *kt = p;
+	pg_data_t *pgdat = kt->pgdat;
 	struct task_struct *tsk = current;
 	const struct cpumask *cpumask = cpumask_of_node(pgdat->node_id);
 
@@ -7313,7 +7334,8 @@ static int kswapd(void *p)
 		 */
 		trace_mm_vmscan_kswapd_wake(pgdat->node_id, highest_zoneidx,
 						alloc_order);
-		reclaim_order = balance_pgdat(pgdat, alloc_order,
+		WRITE_ONCE(kt->nr_wakeups, kt->nr_wakeups + 1);
+		reclaim_order = balance_pgdat(kt, alloc_order,
 						highest_zoneidx);
 		if (reclaim_order < alloc_order)
 			goto kswapd_try_sleep;
@@ -7416,22 +7438,46 @@ unsigned long shrink_all_memory(unsigned long nr_to_reclaim)
 #endif /* CONFIG_HIBERNATION */
 
 /*
- * This kswapd start function will be called by init and node-hot-add.
+ * This kswapd start function will be called by init, node-hot-add and when
+ * kswapd_threads changes. It starts or stops threads on the node until
+ * kswapd_threads are running. The first thread keeps the "kswapd<nid>" name.
  * On node-hot-add, kswapd will moved to proper cpus if cpus are hot-added.
  */
 void kswapd_run(int nid)
 {
 	pg_data_t *pgdat = NODE_DATA(nid);
+	int nr_threads = READ_ONCE(kswapd_threads);
+	int i;
 
-	if (pgdat->kswapd)
-		return;
+	for (i = MAX_KSWAPD_THREADS - 1; i >= nr_threads; i--) {
+		struct kswapd_thread *kt = &pgdat->kswapd[i];
 
-	pgdat->kswapd = kthread_run(kswapd, pgdat, "kswapd%d", nid);
-	if (IS_ERR(pgdat->kswapd)) {
-		/* failure at boot is fatal */
-		BUG_ON(system_state < SYSTEM_RUNNING);
-		pr_err("Failed to start kswapd on node %d\n", nid);
-		pgdat->kswapd = NULL;
+		if (kt->task) {
+			kthread_stop(kt->task);
+			WRITE_ONCE(kt->task, NULL);
+		}
+	}
+
+	for (i = 0; i < nr_threads; i++) {
+		struct kswapd_thread *kt = &pgdat->kswapd[i];
+		struct task_struct *tsk;
+
+		if (kt->task)
+			continue;
+
+		kt->pgdat = pgdat;
+		if (i)
+			tsk = kthread_run(kswapd, kt, "kswapd%d:%d", nid, i);
+		else
+			tsk = kthread_run(kswapd, kt, "kswapd%d", nid);
+		if (IS_ERR(tsk)) {
+			/* failure at boot is fatal */
+			BUG_ON(system_state < SYSTEM_RUNNING);
+			pr_err("Failed to start kswapd thread %d on node %d\n",
+			       i, nid);
+			break;
+		}
+		WRITE_ONCE(kt->task, tsk);
 	}
 }
 
@@ -7441,14 +7487,37 @@ void kswapd_run(int nid)
  */
 void kswapd_stop(int nid)
 {
-	struct task_struct *kswapd = NODE_DATA(nid)->kswapd;
+	pg_data_t *pgdat = NODE_DATA(nid);
+	int i;
 
-	if (kswapd) {
-		kthread_stop(kswapd);
-		NODE_DATA(nid)->kswapd = NULL;
+	for (i = 0; i < MAX_KSWAPD_THREADS; i++) {
+		struct kswapd_thread *kt = &pgdat->kswapd[i];
+
+		if (kt->task) {
+			kthread_stop(kt->task);
+			WRITE_ONCE(kt->task, NULL);
+		}
 	}
 }
 
+int kswapd_threads_sysctl_handler(struct ctl_table *table, int write,
+		void *buffer, size_t *length, loff_t *ppos)
+{
+	int nid;
+	int rc;
+
+	rc = proc_dointvec_minmax(table, write, buffer, length, ppos);
+	if (rc || !write)
+		return rc;
+
+	mem_hotplug_begin();
+	for_each_node_state(nid, N_MEMORY)
+		kswapd_run(nid);
+	mem_hotplug_done();
+
+	return 0;
+}
+
 static int __init kswapd_init(void)
 {
 	int nid;
@@ -826,9 +826,7 @@ static int refresh_cpu_vm_stats(bool do_pagesets)
 
 	for_each_populated_zone(zone) {
 		struct per_cpu_zonestat __percpu *pzstats = zone->per_cpu_zonestats;
-#ifdef CONFIG_NUMA
 		struct per_cpu_pages __percpu *pcp = zone->per_cpu_pageset;
-#endif
 
 		for (i = 0; i < NR_VM_ZONE_STAT_ITEMS; i++) {
 			int v;
@@ -844,10 +842,12 @@ static int refresh_cpu_vm_stats(bool do_pagesets)
 #endif
 			}
 		}
-#ifdef CONFIG_NUMA
 
 		if (do_pagesets) {
 			cond_resched();
+
+			changes += decay_pcp_high(zone, this_cpu_ptr(pcp));
+#ifdef CONFIG_NUMA
 			/*
 			 * Deal with draining the remote pageset of this
 			 * processor
@@ -874,8 +874,8 @@ static int refresh_cpu_vm_stats(bool do_pagesets)
 				drain_zone_pages(zone, this_cpu_ptr(pcp));
 				changes++;
 			}
-		}
 #endif
+		}
 	}
 
 	for_each_online_pgdat(pgdat) {
@@ -1236,6 +1236,10 @@ const char * const vmstat_text[] = {
 #ifdef CONFIG_SWAP
 	"nr_swapcached",
 #endif
+#ifdef CONFIG_NUMA_BALANCING
+	"pgpromote_success",
+	"pgpromote_candidate",
+#endif
 
 	/* enum writeback_stat_item counters */
 	"nr_dirty_threshold",
@@ -1365,6 +1369,8 @@ const char * const vmstat_text[] = {
 #ifdef CONFIG_DEBUG_TLBFLUSH
 	"nr_tlb_remote_flush",
 	"nr_tlb_remote_flush_received",
+	"nr_tlb_remote_flush_ipi",
+	"nr_tlb_remote_flush_lazy_skip",
 	"nr_tlb_local_flush_all",
 	"nr_tlb_local_flush_one",
 #endif /* CONFIG_DEBUG_TLBFLUSH */
@@ -1653,6 +1659,16 @@ static void zoneinfo_show_print(struct seq_file *m, pg_data_t *pgdat,
 			seq_printf(m, "\n      %-12s %lu", node_stat_name(i),
 				   pages);
 		}
+		for (i = 0; i < MAX_KSWAPD_THREADS; i++) {
+			struct kswapd_thread *kt = &pgdat->kswapd[i];
+
+			if (!READ_ONCE(kt->task))
+				continue;
+			seq_printf(m, "\n  kswapd %d wakeups %lu scanned %lu reclaimed %lu",
+				   i, READ_ONCE(kt->nr_wakeups),
+				   READ_ONCE(kt->nr_scanned),
+				   READ_ONCE(kt->nr_reclaimed));
+		}
 	}
 	seq_printf(m,
 		   "\n  pages free     %lu"
@@ -1705,10 +1721,14 @@ static void zoneinfo_show_print(struct seq_file *m, pg_data_t *pgdat,
 			   "\n    cpu: %i"
 			   "\n              count: %i"
 			   "\n              high:  %i"
+			   "\n              high_min: %i"
+			   "\n              high_max: %i"
 			   "\n              batch: %i",
 			   i,
 			   pcp->count,
 			   pcp->high,
+			   pcp->high_min,
+			   pcp->high_max,
 			   pcp->batch);
 #ifdef CONFIG_SMP
 		pzstats = per_cpu_ptr(zone->per_cpu_zonestats, i);
@@ -36,6 +36,8 @@
 #include <linux/pagemap.h>
 #include <linux/workqueue.h>
 
+#include "internal.h"
+
 /*********************************
 * statistics
 **********************************/
@@ -572,16 +574,39 @@ static struct zswap_pool *zswap_pool_find_get(char *type, char *compressor)
 	return NULL;
 }
 
+/*
+ * Write back the LRU entries of the pool until zswap can accept new pages
+ * again, so that stores don't have to be rejected while the pool is full.
+ */
 static void shrink_worker(struct work_struct *w)
 {
 	struct zswap_pool *pool = container_of(w, typeof(*pool),
 						shrink_work);
+	int ret, failures = 0;
 
-	if (zpool_shrink(pool->zpool, 1, NULL))
-		zswap_reject_reclaim_fail++;
+	do {
+		ret = zpool_shrink(pool->zpool, 1, NULL);
+		if (ret) {
+			zswap_reject_reclaim_fail++;
+			if (ret != -EAGAIN)
+				break;
+			if (++failures == MAX_RECLAIM_RETRIES)
+				break;
+		}
+		cond_resched();
+	} while (!zswap_can_accept());
 	zswap_pool_put(pool);
 }
 
+/* kick off the writeback of the oldest pool, unless already in flight */
+static void zswap_start_writeback(void)
+{
+	struct zswap_pool *pool = zswap_pool_last_get();
+
+	if (pool && !queue_work(shrink_wq, &pool->shrink_work))
+		zswap_pool_put(pool);
+}
+
 static struct zswap_pool *zswap_pool_create(char *type, char *compressor)
 {
 	struct zswap_pool *pool;
@@ -1105,27 +1130,6 @@ static int zswap_frontswap_store(unsigned type, pgoff_t offset,
 		goto reject;
 	}
 
-	/* reclaim space if needed */
-	if (zswap_is_full()) {
-		struct zswap_pool *pool;
-
-		zswap_pool_limit_hit++;
-		zswap_pool_reached_full = true;
-		pool = zswap_pool_last_get();
-		if (pool)
-			queue_work(shrink_wq, &pool->shrink_work);
-		ret = -ENOMEM;
-		goto reject;
-	}
-
-	if (zswap_pool_reached_full) {
-	       if (!zswap_can_accept()) {
-			ret = -ENOMEM;
-			goto reject;
-		} else
-			zswap_pool_reached_full = false;
-	}
-
 	/* allocate entry */
 	entry = zswap_entry_cache_alloc(GFP_KERNEL);
 	if (!entry) {
@@ -1134,6 +1138,10 @@ static int zswap_frontswap_store(unsigned type, pgoff_t offset,
 		goto reject;
 	}
 
+	/*
+	 * Same-filled pages take no space in the pool, so store them even if
+	 * the pool is full.
+	 */
 	if (zswap_same_filled_pages_enabled) {
 		src = kmap_atomic(page);
 		if (zswap_is_page_same_filled(src, &value)) {
@@ -1147,6 +1155,23 @@ static int zswap_frontswap_store(unsigned type, pgoff_t offset,
 		kunmap_atomic(src);
 	}
 
+	/* reclaim space if needed */
+	if (zswap_is_full()) {
+		zswap_pool_limit_hit++;
+		zswap_pool_reached_full = true;
+		zswap_start_writeback();
+		ret = -ENOMEM;
+		goto freepage;
+	}
+
+	if (zswap_pool_reached_full) {
+		if (!zswap_can_accept()) {
+			ret = -ENOMEM;
+			goto freepage;
+		} else
+			zswap_pool_reached_full = false;
+	}
+
 	/* if entry is successfully added, it keeps the reference */
 	entry->pool = zswap_pool_current_get();
 	if (!entry->pool) {
@@ -1229,6 +1254,13 @@ static int zswap_frontswap_store(unsigned type, pgoff_t offset,
 	atomic_inc(&zswap_stored_pages);
 	zswap_update_total_size();
 
+	/*
+	 * Start writing back the LRU entries before the pool is full, so
+	 * that new stores keep being accepted.
+	 */
+	if (!zswap_can_accept())
+		zswap_start_writeback();
+
 	return 0;
 
 put_dstmem:
@@ -72,6 +72,15 @@ static inline unsigned long hold_time(const struct net_bridge *br)
 	return br->topology_change ? br->forward_delay : br->ageing_time;
 }
 
+/* Ageing does not need jiffy resolution: only refresh fdb->updated once
+ * it is older than this, so that cpus forwarding frames from the same
+ * address do not keep dirtying the entry's cache line.
+ */
+static inline unsigned long fdb_update_delta(const struct net_bridge *br)
+{
+	return min_t(unsigned long, HZ / 10, hold_time(br) >> 4);
+}
+
 static inline int has_expired(const struct net_bridge *br,
 				  const struct net_bridge_fdb_entry *fdb)
 {
@@ -597,12 +606,12 @@ void br_fdb_update(struct net_bridge *br, struct net_bridge_port *source,
 					source->dev->name, addr, vid);
 		} else {
 			unsigned long now = jiffies;
-			bool fdb_modified = false;
+			bool fdb_modified;
 
-			if (now != fdb->updated) {
-				fdb->updated = now;
-				fdb_modified = __fdb_mark_active(fdb);
-			}
+			if (time_after(now, READ_ONCE(fdb->updated) +
+					    fdb_update_delta(br)))
+				WRITE_ONCE(fdb->updated, now);
+			fdb_modified = __fdb_mark_active(fdb);
 
 			/* fastpath: update of existing entry */
 			if (unlikely(source != READ_ONCE(fdb->dst) &&
@@ -123,6 +123,7 @@
 #include <linux/if_vlan.h>
 #include <linux/ip.h>
 #include <net/ip.h>
+#include <net/ipv6.h>
 #include <net/mpls.h>
 #include <linux/ipv6.h>
 #include <linux/in.h>
@@ -3520,6 +3521,14 @@ static netdev_features_t gso_features_check(const struct sk_buff *skb,
 	if (gso_segs > dev->gso_max_segs)
 		return features & ~NETIF_F_GSO_MASK;
 
+	/* Only devices which raised their tso_max_size know how to deal
+	 * with the jumbo payload option of a BIG TCP packet (e.g. one
+	 * built by GRO and being forwarded): segment it in software.
+	 */
+	if (unlikely(dev->tso_max_size <= GSO_LEGACY_MAX_SIZE &&
+		     ipv6_has_hopopt_jumbo(skb)))
+		return features & ~NETIF_F_GSO_MASK;
+
 	if (!skb_shinfo(skb)->gso_type) {
 		skb_warn_bad_offload(skb);
 		return features & ~NETIF_F_GSO_MASK;
@@ -4334,6 +4343,8 @@ int dev_rx_weight __read_mostly = 64;
 int dev_tx_weight __read_mostly = 64;
 /* Maximum number of GRO_NORMAL skbs to batch up for list-RX */
 int gro_normal_batch __read_mostly = 8;
+/* Maximum number of skbs other CPUs may queue for freeing on this one */
+int sysctl_skb_defer_max __read_mostly = 64;
 
 /* Called with irq disabled */
 static inline void ____napi_schedule(struct softnet_data *sd,
@@ -4363,6 +4374,7 @@ static inline void ____napi_schedule(struct softnet_data *sd,
 	}
 
 	list_add_tail(&napi->poll_list, &sd->poll_list);
+	WRITE_ONCE(napi->list_owner, smp_processor_id());
 	__raise_softirq_irqoff(NET_RX_SOFTIRQ);
 }
 
@@ -4379,6 +4391,21 @@ EXPORT_SYMBOL(rps_needed);
 struct static_key_false rfs_needed __read_mostly;
 EXPORT_SYMBOL(rfs_needed);
 
+#ifdef CONFIG_RFS_ACCEL
+/* A flow is considered active if the CPU it was last steered to has not
+ * processed more than ten times the table size worth of packets since.
+ */
+static bool rps_flow_is_active(struct rps_dev_flow *rflow,
+			       struct rps_dev_flow_table *flow_table,
+			       unsigned int cpu)
+{
+	return cpu < nr_cpu_ids &&
+	       ((int)(per_cpu(softnet_data, cpu).input_queue_head -
+		      READ_ONCE(rflow->last_qtail)) <
+		(int)(10 * flow_table->mask));
+}
+#endif
+
 static struct rps_dev_flow *
 set_rps_cpu(struct net_device *dev, struct sk_buff *skb,
 	    struct rps_dev_flow *rflow, u16 next_cpu)
@@ -4388,7 +4415,9 @@ set_rps_cpu(struct net_device *dev, struct sk_buff *skb,
 		struct netdev_rx_queue *rxqueue;
 		struct rps_dev_flow_table *flow_table;
 		struct rps_dev_flow *old_rflow;
-		u32 flow_id;
+		struct rps_dev_flow *tmp_rflow;
+		unsigned int tmp_cpu;
+		u32 flow_id, hash;
 		u16 rxq_index;
 		int rc;
 
@@ -4404,16 +4433,29 @@ set_rps_cpu(struct net_device *dev, struct sk_buff *skb,
 		flow_table = rcu_dereference(rxqueue->rps_flow_table);
 		if (!flow_table)
 			goto out;
-		flow_id = skb_get_hash(skb) & flow_table->mask;
+		hash = skb_get_hash(skb);
+		flow_id = hash & flow_table->mask;
+		tmp_rflow = &flow_table->flows[flow_id];
+		tmp_cpu = READ_ONCE(tmp_rflow->cpu);
+
+		/* Do not steal the slot of another flow that still has an
+		 * active hardware filter, nor reprogram one for no change.
+		 */
+		if (READ_ONCE(tmp_rflow->filter) != RPS_NO_FILTER &&
+		    rps_flow_is_active(tmp_rflow, flow_table, tmp_cpu) &&
+		    (hash != READ_ONCE(tmp_rflow->hash) || next_cpu == tmp_cpu))
+			goto out;
+
 		rc = dev->netdev_ops->ndo_rx_flow_steer(dev, skb,
 							rxq_index, flow_id);
 		if (rc < 0)
 			goto out;
 		old_rflow = rflow;
-		rflow = &flow_table->flows[flow_id];
-		rflow->filter = rc;
-		if (old_rflow->filter == rflow->filter)
-			old_rflow->filter = RPS_NO_FILTER;
+		rflow = tmp_rflow;
+		WRITE_ONCE(rflow->filter, rc);
+		WRITE_ONCE(rflow->hash, hash);
+		if (old_rflow->filter == rc)
+			WRITE_ONCE(old_rflow->filter, RPS_NO_FILTER);
 	out:
 #endif
 		rflow->last_qtail =
@@ -4553,10 +4595,8 @@ bool rps_may_expire_flow(struct net_device *dev, u16 rxq_index,
 	if (flow_table && flow_id <= flow_table->mask) {
 		rflow = &flow_table->flows[flow_id];
 		cpu = READ_ONCE(rflow->cpu);
-		if (rflow->filter == filter_id && cpu < nr_cpu_ids &&
-		    ((int)(per_cpu(softnet_data, cpu).input_queue_head -
-			   rflow->last_qtail) <
-		     (int)(10 * flow_table->mask)))
+		if (READ_ONCE(rflow->filter) == filter_id &&
+		    rps_flow_is_active(rflow, flow_table, cpu))
 			expire = false;
 	}
 	rcu_read_unlock();
@@ -4577,6 +4617,15 @@ static void rps_trigger_softirq(void *data)
 
 #endif /* CONFIG_RPS */
 
+/* Called from hardirq (IPI) context */
+static void trigger_rx_softirq(void *data)
+{
+	struct softnet_data *sd = data;
+
+	__raise_softirq_irqoff(NET_RX_SOFTIRQ);
+	smp_store_release(&sd->defer_ipi_scheduled, 0);
+}
+
 /*
  * Check if this softnet_data structure is another cpu one
  * If yes, queue it to our IPI list and return 1
@@ -6627,6 +6676,7 @@ bool napi_complete_done(struct napi_struct *n, int work_done)
 		list_del_init(&n->poll_list);
 		local_irq_restore(flags);
 	}
+	WRITE_ONCE(n->list_owner, -1);
 
 	do {
 		val = READ_ONCE(n->state);
@@ -6876,7 +6926,42 @@ static void init_gro_hash(struct napi_struct *napi)
 	napi->gro_bitmask = 0;
 }
 
-int dev_set_threaded(struct net_device *dev, bool threaded)
+/**
+ * napi_gro_init - set up a NAPI context used for GRO only
+ * @napi: NAPI context, not registered with any device
+ *
+ * For code feeding the stack from its own context rather than from a
+ * NAPI poll, e.g. the cpumap kthread, that still wants its packets to
+ * go through napi_gro_receive(). Packets held by GRO are passed up by
+ * napi_gro_flush_normal().
+ */
+void napi_gro_init(struct napi_struct *napi)
+{
+	init_gro_hash(napi);
+	napi->skb = NULL;
+	INIT_LIST_HEAD(&napi->rx_list);
+	napi->rx_count = 0;
+}
+EXPORT_SYMBOL(napi_gro_init);
+
+/**
+ * napi_gro_flush_normal - complete GRO packets and pass them up the stack
+ * @napi: NAPI context set up with napi_gro_init()
+ * @flush_old: only complete packets older than one jiffy
+ *
+ * The equivalent of what napi_complete_done() does for NAPI poll. Must
+ * be called with BHs disabled.
+ */
+void napi_gro_flush_normal(struct napi_struct *napi, bool flush_old)
+{
+	if (napi->gro_bitmask)
+		napi_gro_flush(napi, flush_old);
+	gro_normal_list(napi);
+}
+EXPORT_SYMBOL(napi_gro_flush_normal);
+
+int dev_set_threaded(struct net_device *dev,
+		      enum netdev_napi_threaded threaded)
 {
 	struct napi_struct *napi;
 	int err = 0;
@@ -6889,7 +6974,7 @@ int dev_set_threaded(struct net_device *dev, bool threaded)
 			if (!napi->thread) {
 				err = napi_kthread_create(napi);
 				if (err) {
-					threaded = false;
+					threaded = NETDEV_NAPI_THREADED_DISABLED;
 					break;
 				}
 			}
@@ -6910,10 +6995,9 @@ int dev_set_threaded(struct net_device *dev, bool threaded)
 	 * This should not cause hiccups/stalls to the live traffic.
 	 */
 	list_for_each_entry(napi, &dev->napi_list, dev_list) {
-		if (threaded)
-			set_bit(NAPI_STATE_THREADED, &napi->state);
-		else
-			clear_bit(NAPI_STATE_THREADED, &napi->state);
+		assign_bit(NAPI_STATE_THREADED_BUSY_POLL, &napi->state,
+			   threaded == NETDEV_NAPI_THREADED_BUSY_POLL);
+		assign_bit(NAPI_STATE_THREADED, &napi->state, threaded);
 	}
 
 	return err;
@@ -6943,6 +7027,7 @@ void netif_napi_add(struct net_device *dev, struct napi_struct *napi,
 #ifdef CONFIG_NETPOLL
 	napi->poll_owner = -1;
 #endif
+	napi->list_owner = -1;
 	set_bit(NAPI_STATE_SCHED, &napi->state);
 	set_bit(NAPI_STATE_NPSVC, &napi->state);
 	list_add_rcu(&napi->dev_list, &dev->napi_list);
@@ -6971,6 +7056,7 @@ void napi_disable(struct napi_struct *n)
 	clear_bit(NAPI_STATE_PREFER_BUSY_POLL, &n->state);
 	clear_bit(NAPI_STATE_DISABLE, &n->state);
 	clear_bit(NAPI_STATE_THREADED, &n->state);
+	clear_bit(NAPI_STATE_THREADED_BUSY_POLL, &n->state);
 }
 EXPORT_SYMBOL(napi_disable);
 
@@ -6992,6 +7078,9 @@ void napi_enable(struct napi_struct *n)
 		new = val & ~(NAPIF_STATE_SCHED | NAPIF_STATE_NPSVC);
 		if (n->dev->threaded && n->thread)
 			new |= NAPIF_STATE_THREADED;
+		if (n->dev->threaded == NETDEV_NAPI_THREADED_BUSY_POLL &&
+		    n->thread)
+			new |= NAPIF_STATE_THREADED_BUSY_POLL;
 	} while (cmpxchg(&n->state, val, new) != val);
 }
 EXPORT_SYMBOL(napi_enable);
@@ -7151,9 +7240,28 @@ static int napi_thread_wait(struct napi_struct *napi)
 static int napi_threaded_poll(void *data)
 {
 	struct napi_struct *napi = data;
+	bool want_busy_poll;
+	unsigned long val;
 	void *have;
 
 	while (!napi_thread_wait(napi)) {
+		/* In busy-poll mode the thread marks itself as the busy
+		 * poller, so napi_complete_done() keeps the instance
+		 * scheduled and the driver does not re-arm its interrupt;
+		 * with SCHED_THREADED left set, napi_thread_wait() returns
+		 * straight away and we poll again. Drop out of it as soon
+		 * as the mode is turned off or napi_disable() is pending,
+		 * so that the next completion really releases the instance.
+		 */
+		val = READ_ONCE(napi->state);
+		want_busy_poll = (val & NAPIF_STATE_THREADED_BUSY_POLL) &&
+				 !(val & NAPIF_STATE_DISABLE);
+		if (want_busy_poll && !(val & NAPIF_STATE_SCHED_THREADED))
+			set_bit(NAPI_STATE_SCHED_THREADED, &napi->state);
+		if (want_busy_poll != !!(val & NAPIF_STATE_IN_BUSY_POLL))
+			assign_bit(NAPI_STATE_IN_BUSY_POLL, &napi->state,
+				   want_busy_poll);
+
 		for (;;) {
 			bool repoll = false;
 
@@ -7163,17 +7271,49 @@ static int napi_threaded_poll(void *data)
 			__napi_poll(napi, &repoll);
 			netpoll_poll_unlock(have);
 
+			/* napi_complete_done() bailed out before flushing GRO,
+			 * and we still own the instance.
+			 */
+			if (want_busy_poll && !repoll) {
+				if (napi->gro_bitmask)
+					napi_gro_flush(napi, false);
+				gro_normal_list(napi);
+			}
+
 			local_bh_enable();
 
+			if (repoll || want_busy_poll)
+				cond_resched();
+
 			if (!repoll)
 				break;
-
-			cond_resched();
 		}
 	}
 	return 0;
 }
 
+static void skb_defer_free_flush(struct softnet_data *sd)
+{
+	struct sk_buff *skb, *next;
+	unsigned long flags;
+
+	/* Paired with WRITE_ONCE() in skb_attempt_defer_free() */
+	if (!READ_ONCE(sd->defer_list))
+		return;
+
+	spin_lock_irqsave(&sd->defer_lock, flags);
+	skb = sd->defer_list;
+	sd->defer_list = NULL;
+	sd->defer_count = 0;
+	spin_unlock_irqrestore(&sd->defer_lock, flags);
+
+	while (skb != NULL) {
+		next = skb->next;
+		napi_consume_skb(skb, 1);
+		skb = next;
+	}
+}
+
 static __latent_entropy void net_rx_action(struct softirq_action *h)
 {
 	struct softnet_data *sd = this_cpu_ptr(&softnet_data);
@@ -7190,6 +7330,8 @@ static __latent_entropy void net_rx_action(struct softirq_action *h)
 	for (;;) {
 		struct napi_struct *n;
 
+		skb_defer_free_flush(sd);
+
 		if (list_empty(&list)) {
 			if (!sd_has_rps_ipi_waiting(sd) && list_empty(&repoll))
 				return;
@@ -10917,8 +11059,10 @@ struct net_device *alloc_netdev_mqs(int sizeof_priv, const char *name,
 
 	dev_net_set(dev, &init_net);
 
-	dev->gso_max_size = GSO_MAX_SIZE;
+	dev->gso_max_size = GSO_LEGACY_MAX_SIZE;
+	dev->tso_max_size = GSO_LEGACY_MAX_SIZE;
 	dev->gso_max_segs = GSO_MAX_SEGS;
+	dev->gro_max_size = GRO_LEGACY_MAX_SIZE;
 	dev->upper_level = 1;
 	dev->lower_level = 1;
 #ifdef CONFIG_LOCKDEP
@@ -11413,6 +11557,19 @@ static int dev_cpu_dead(unsigned int oldcpu)
 		input_queue_head_incr(oldsd);
 	}
 
+	/* Free skbs other CPUs queued to the offline CPU */
+	spin_lock_irq(&oldsd->defer_lock);
+	skb = oldsd->defer_list;
+	oldsd->defer_list = NULL;
+	oldsd->defer_count = 0;
+	spin_unlock_irq(&oldsd->defer_lock);
+	while (skb) {
+		struct sk_buff *next = skb->next;
+
+		__kfree_skb(skb);
+		skb = next;
+	}
+
 	return 0;
 }
 
@@ -11734,6 +11891,8 @@ static int __init net_dev_init(void)
 		INIT_CSD(&sd->csd, rps_trigger_softirq, sd);
 		sd->cpu = i;
 #endif
+		INIT_CSD(&sd->defer_csd, trigger_rx_softirq, sd);
+		spin_lock_init(&sd->defer_lock);
 
 		init_gro_hash(&sd->backlog);
 		sd->backlog.poll = process_backlog;
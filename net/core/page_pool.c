@@ -19,6 +19,7 @@
 #include <linux/mm.h> /* for __put_page() */
 #include <linux/poison.h>
 #include <linux/ethtool.h>
+#include <linux/netdevice.h>
 
 #include <trace/events/page_pool.h>
 
@@ -868,6 +869,11 @@ void page_pool_destroy(struct page_pool *pool)
 	if (!page_pool_put(pool))
 		return;
 
+	/* The NAPI instance may go away before the last in-flight page
+	 * comes back; stop page_pool_return_skb_page() from looking at it.
+	 */
+	WRITE_ONCE(pool->p.napi, NULL);
+
 	page_pool_free_frag(pool);
 
 	if (!page_pool_release(pool))
@@ -899,7 +905,9 @@ EXPORT_SYMBOL(page_pool_update_nid);
 
 bool page_pool_return_skb_page(struct page *page)
 {
+	struct napi_struct *napi;
 	struct page_pool *pp;
+	bool allow_direct;
 
 	page = compound_head(page);
 
@@ -919,8 +927,16 @@ bool page_pool_return_skb_page(struct page *page)
 	 * This will *not* work for NIC using a split-page memory model.
 	 * The page will be returned to the pool here regardless of the
 	 * 'flipped' fragment being in use or not.
+	 *
+	 * When freed from softirq on the cpu currently running the pool's
+	 * NAPI instance, the page can go straight back to the lockless
+	 * alloc cache instead of the ptr_ring.
 	 */
-	page_pool_put_full_page(pp, page, false);
+	napi = READ_ONCE(pp->p.napi);
+	allow_direct = napi && in_softirq() &&
+		       READ_ONCE(napi->list_owner) == smp_processor_id();
+
+	page_pool_put_full_page(pp, page, allow_direct);
 
 	return true;
 }
@@ -137,6 +137,7 @@
 #include <trace/events/sock.h>
 
 #include <net/tcp.h>
+#include <net/ipv6.h>
 #include <net/busy_poll.h>
 
 #include <linux/ethtool.h>
@@ -2164,6 +2165,27 @@ void sk_free_unlock_clone(struct sock *sk)
 }
 EXPORT_SYMBOL_GPL(sk_free_unlock_clone);
 
+static u32 sk_dst_gso_max_size(struct sock *sk, struct dst_entry *dst)
+{
+	u32 max_size = READ_ONCE(dst->dev->gso_max_size);
+
+	/* Only TCP over (native) IPv6 can build packets above 64KB, using
+	 * a temporary jumbo payload option (BIG TCP).  Everybody else
+	 * keeps the legacy limit.
+	 */
+	if (max_size > GSO_LEGACY_MAX_SIZE) {
+#if IS_ENABLED(CONFIG_IPV6)
+		if (sk->sk_family == AF_INET6 &&
+		    sk->sk_protocol == IPPROTO_TCP &&
+		    !ipv6_addr_v4mapped(&sk->sk_v6_rcv_saddr) &&
+		    !rcu_access_pointer(inet6_sk(sk)->opt))
+			return max_size;
+#endif
+		max_size = GSO_LEGACY_MAX_SIZE;
+	}
+	return max_size;
+}
+
 void sk_setup_caps(struct sock *sk, struct dst_entry *dst)
 {
 	u32 max_segs = 1;
@@ -2177,7 +2199,7 @@ void sk_setup_caps(struct sock *sk, struct dst_entry *dst)
 			sk->sk_route_caps &= ~NETIF_F_GSO_MASK;
 		} else {
 			sk->sk_route_caps |= NETIF_F_SG | NETIF_F_HW_CSUM;
-			sk->sk_gso_max_size = dst->dev->gso_max_size;
+			sk->sk_gso_max_size = sk_dst_gso_max_size(sk, dst);
 			max_segs = max_t(u32, dst->dev->gso_max_segs, 1);
 		}
 	}
@@ -2762,9 +2784,12 @@ EXPORT_SYMBOL(sk_wait_data);
 int __sk_mem_raise_allocated(struct sock *sk, int size, int amt, int kind)
 {
 	struct proto *prot = sk->sk_prot;
-	long allocated = sk_memory_allocated_add(sk, amt);
 	bool memcg_charge = mem_cgroup_sockets_enabled && sk->sk_memcg;
 	bool charged = true;
+	long allocated;
+
+	sk_memory_allocated_add(sk, amt);
+	allocated = sk_memory_allocated(sk);
 
 	if (memcg_charge &&
 	    !(charged = mem_cgroup_charge_skmem(sk->sk_memcg, amt,
@@ -3118,6 +3143,19 @@ void sk_reset_timer(struct sock *sk, struct timer_list* timer,
 }
 EXPORT_SYMBOL(sk_reset_timer);
 
+/*
+ * Like sk_reset_timer(), but leave a pending timer alone unless @expires
+ * is earlier. Only for timers whose handler checks for, and re-arms on,
+ * an early expiry.
+ */
+void sk_reduce_timer(struct sock *sk, struct timer_list *timer,
+		     unsigned long expires)
+{
+	if (!timer_reduce(timer, expires))
+		sock_hold(sk);
+}
+EXPORT_SYMBOL(sk_reduce_timer);
+
 void sk_stop_timer(struct sock *sk, struct timer_list* timer)
 {
 	if (del_timer(timer))
@@ -28,6 +28,13 @@ void reuseport_has_conns_set(struct sock *sk)
 	if (!rcu_access_pointer(sk->sk_reuseport_cb))
 		return;
 
+	/* Every connect() on a member socket ends up here; once the flag
+	 * is set for the group, there is no need to take the global lock
+	 * again.  has_conns is never cleared while the group exists.
+	 */
+	if (reuseport_has_conns(sk))
+		return;
+
 	spin_lock_bh(&reuseport_lock);
 	reuse = rcu_dereference_protected(sk->sk_reuseport_cb,
 					  lockdep_is_held(&reuseport_lock));
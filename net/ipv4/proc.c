@@ -297,6 +297,9 @@ static const struct snmp_mib snmp4_net_list[] = {
 	SNMP_MIB_ITEM("TCPDSACKIgnoredDubious", LINUX_MIB_TCPDSACKIGNOREDDUBIOUS),
 	SNMP_MIB_ITEM("TCPMigrateReqSuccess", LINUX_MIB_TCPMIGRATEREQSUCCESS),
 	SNMP_MIB_ITEM("TCPMigrateReqFailure", LINUX_MIB_TCPMIGRATEREQFAILURE),
+	SNMP_MIB_ITEM("TCPZeroCopyRxMapped", LINUX_MIB_TCPZEROCOPYRXMAPPED),
+	SNMP_MIB_ITEM("TCPZeroCopyRxCopied", LINUX_MIB_TCPZEROCOPYRXCOPIED),
+	SNMP_MIB_ITEM("TCPTSQThrottled", LINUX_MIB_TCPTSQTHROTTLED),
 	SNMP_MIB_SENTINEL
 };
 
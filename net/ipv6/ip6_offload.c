@@ -91,6 +91,27 @@ static struct sk_buff *ipv6_gso_segment(struct sk_buff *skb,
 	if (unlikely(!pskb_may_pull(skb, sizeof(*ipv6h))))
 		goto out;
 
+	/* Remove the temporary jumbo payload option of a BIG TCP packet,
+	 * the segments are all small enough to go without it.
+	 */
+	if (unlikely(skb->len > IPV6_MAXPLEN &&
+		     pskb_may_pull(skb, sizeof(*ipv6h) +
+				   sizeof(struct hop_jumbo_hdr)) &&
+		     ipv6_has_hopopt_jumbo(skb))) {
+		const int hophdr_len = sizeof(struct hop_jumbo_hdr);
+
+		if (skb_cow_head(skb, 0))
+			goto out;
+
+		memmove(skb_mac_header(skb) + hophdr_len, skb_mac_header(skb),
+			nhoff + sizeof(*ipv6h));
+		__skb_pull(skb, hophdr_len);
+		skb->mac_header += hophdr_len;
+		skb->network_header += hophdr_len;
+		ipv6h = ipv6_hdr(skb);
+		ipv6h->nexthdr = IPPROTO_TCP;
+	}
+
 	encap = SKB_GSO_CB(skb)->encap_level > 0;
 	if (encap)
 		features &= skb->dev->hw_enc_features;
@@ -323,15 +344,45 @@ static struct sk_buff *ip4ip6_gro_receive(struct list_head *head,
 INDIRECT_CALLABLE_SCOPE int ipv6_gro_complete(struct sk_buff *skb, int nhoff)
 {
 	const struct net_offload *ops;
-	struct ipv6hdr *iph = (struct ipv6hdr *)(skb->data + nhoff);
+	struct ipv6hdr *iph;
 	int err = -ENOSYS;
+	u32 payload_len;
 
 	if (skb->encapsulation) {
 		skb_set_inner_protocol(skb, cpu_to_be16(ETH_P_IPV6));
 		skb_set_inner_network_header(skb, nhoff);
 	}
 
-	iph->payload_len = htons(skb->len - nhoff - sizeof(*iph));
+	payload_len = skb->len - nhoff - sizeof(*iph);
+	if (unlikely(payload_len > IPV6_MAXPLEN)) {
+		struct hop_jumbo_hdr *hop_jumbo;
+		int hoplen = sizeof(*hop_jumbo);
+
+		/* Move network header left, skb_gro_receive() made sure
+		 * there is headroom for it.
+		 */
+		memmove(skb_mac_header(skb) - hoplen, skb_mac_header(skb),
+			skb->transport_header - skb->mac_header);
+		skb->data -= hoplen;
+		skb->len += hoplen;
+		skb->mac_header -= hoplen;
+		skb->network_header -= hoplen;
+		iph = (struct ipv6hdr *)(skb->data + nhoff);
+		hop_jumbo = (struct hop_jumbo_hdr *)(iph + 1);
+
+		/* Build hop-by-hop options */
+		hop_jumbo->nexthdr = iph->nexthdr;
+		hop_jumbo->hdrlen = 0;
+		hop_jumbo->tlv_type = IPV6_TLV_JUMBO;
+		hop_jumbo->tlv_len = 4;
+		hop_jumbo->jumbo_payload_len = htonl(payload_len + hoplen);
+
+		iph->nexthdr = NEXTHDR_HOP;
+		iph->payload_len = 0;
+	} else {
+		iph = (struct ipv6hdr *)(skb->data + nhoff);
+		iph->payload_len = htons(payload_len);
+	}
 
 	rcu_read_lock();
 
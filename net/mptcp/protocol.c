@@ -1417,7 +1417,7 @@ static int mptcp_sendmsg_frag(struct sock *sk, struct sock *ssk,
 
 struct subflow_send_info {
 	struct sock *ssk;
-	u64 ratio;
+	u64 linger_time;
 };
 
 void mptcp_subflow_set_active(struct mptcp_subflow_context *subflow)
@@ -1452,9 +1452,11 @@ static struct sock *mptcp_subflow_get_send(struct mptcp_sock *msk)
 	struct mptcp_subflow_context *subflow;
 	struct sock *sk = (struct sock *)msk;
 	int i, nr_active = 0;
+	u64 linger_time;
 	struct sock *ssk;
 	long tout = 0;
-	u64 ratio;
+	int burst;
+	u32 wmem;
 	u32 pace;
 
 	sock_owned_by_me(sk);
@@ -1473,10 +1475,12 @@ static struct sock *mptcp_subflow_get_send(struct mptcp_sock *msk)
 		return msk->last_snd;
 	}
 
-	/* pick the subflow with the lower wmem/wspace ratio */
+	/* pick the subflow with the shortest estimated time to flush the
+	 * queued data
+	 */
 	for (i = 0; i < 2; ++i) {
 		send_info[i].ssk = NULL;
-		send_info[i].ratio = -1;
+		send_info[i].linger_time = -1;
 	}
 	mptcp_for_each_subflow(msk, subflow) {
 		trace_mptcp_subflow_get_send(subflow);
@@ -1486,18 +1490,20 @@ static struct sock *mptcp_subflow_get_send(struct mptcp_sock *msk)
 
 		tout = max(tout, mptcp_timeout_from_subflow(subflow));
 		nr_active += !subflow->backup;
-		if (!sk_stream_memory_free(subflow->tcp_sock) || !tcp_sk(ssk)->snd_wnd)
-			continue;
-
-		pace = READ_ONCE(ssk->sk_pacing_rate);
-		if (!pace)
-			continue;
+		pace = subflow->avg_pacing_rate;
+		if (unlikely(!pace)) {
+			/* init pacing rate from socket */
+			subflow->avg_pacing_rate = READ_ONCE(ssk->sk_pacing_rate);
+			pace = subflow->avg_pacing_rate;
+			if (!pace)
+				continue;
+		}
 
-		ratio = div_u64((u64)READ_ONCE(ssk->sk_wmem_queued) << 32,
-				pace);
-		if (ratio < send_info[subflow->backup].ratio) {
+		linger_time = div_u64((u64)READ_ONCE(ssk->sk_wmem_queued) << 32,
+				      pace);
+		if (linger_time < send_info[subflow->backup].linger_time) {
 			send_info[subflow->backup].ssk = ssk;
-			send_info[subflow->backup].ratio = ratio;
+			send_info[subflow->backup].linger_time = linger_time;
 		}
 	}
 	__mptcp_set_timeout(sk, tout);
@@ -1506,14 +1512,30 @@ static struct sock *mptcp_subflow_get_send(struct mptcp_sock *msk)
 	if (!nr_active)
 		send_info[0].ssk = send_info[1].ssk;
 
-	if (send_info[0].ssk) {
-		msk->last_snd = send_info[0].ssk;
-		msk->snd_burst = min_t(int, MPTCP_SEND_BURST_SIZE,
-				       tcp_sk(msk->last_snd)->snd_wnd);
-		return msk->last_snd;
-	}
+	/* Following BLEST, to avoid HoL blocking the faster flow, data must
+	 * not be pushed on a slower subflow when the faster one would flush
+	 * its queue and take the data sooner.  Selecting the subflow with the
+	 * shortest estimated time to flush its queue, full or not, ensures
+	 * that: when that subflow has no room left just wait for it instead
+	 * of falling back to a slower one.
+	 */
+	ssk = send_info[0].ssk;
+	if (!ssk || !sk_stream_memory_free(ssk) || !tcp_sk(ssk)->snd_wnd)
+		return NULL;
 
-	return NULL;
+	burst = min_t(int, MPTCP_SEND_BURST_SIZE, tcp_sk(ssk)->snd_wnd);
+	wmem = READ_ONCE(ssk->sk_wmem_queued);
+	subflow = mptcp_subflow_ctx(ssk);
+
+	/* the pacing rate of the queued data is the average of the rates
+	 * at the time each chunk was queued, weighted by the chunk size
+	 */
+	subflow->avg_pacing_rate = div_u64((u64)subflow->avg_pacing_rate * wmem +
+					   (u64)READ_ONCE(ssk->sk_pacing_rate) * burst,
+					   burst + wmem);
+	msk->last_snd = ssk;
+	msk->snd_burst = burst;
+	return ssk;
 }
 
 static void mptcp_push_release(struct sock *sk, struct sock *ssk,
@@ -3241,6 +3263,7 @@ static struct proto mptcp_prot = {
 	.get_port	= mptcp_get_port,
 	.sockets_allocated	= &mptcp_sockets_allocated,
 	.memory_allocated	= &tcp_memory_allocated,
+	.per_cpu_fw_alloc	= &tcp_memory_per_cpu_fw_alloc,
 	.memory_pressure	= &tcp_memory_pressure,
 	.sysctl_wmem_offset	= offsetof(struct net, ipv4.sysctl_tcp_wmem),
 	.sysctl_rmem_offset	= offsetof(struct net, ipv4.sysctl_tcp_rmem),
@@ -315,6 +315,12 @@ static unsigned int nf_flow_queue_xmit(struct net *net, struct sk_buff *skb,
 	return NF_STOLEN;
 }
 
+/* No flow has been offloaded yet: skip parsing the packet headers. */
+static bool nf_flow_table_empty(const struct nf_flowtable *flow_table)
+{
+	return atomic_read(&flow_table->rhashtable.nelems) == 0;
+}
+
 unsigned int
 nf_flow_offload_ip_hook(void *priv, struct sk_buff *skb,
 			const struct nf_hook_state *state)
@@ -332,6 +338,9 @@ nf_flow_offload_ip_hook(void *priv, struct sk_buff *skb,
 	__be32 nexthop;
 	int ret;
 
+	if (nf_flow_table_empty(flow_table))
+		return NF_ACCEPT;
+
 	if (skb->protocol != htons(ETH_P_IP) &&
 	    !nf_flow_skb_encap_protocol(skb, htons(ETH_P_IP), &offset))
 		return NF_ACCEPT;
@@ -573,6 +582,9 @@ nf_flow_offload_ipv6_hook(void *priv, struct sk_buff *skb,
 	struct rt6_info *rt;
 	int ret;
 
+	if (nf_flow_table_empty(flow_table))
+		return NF_ACCEPT;
+
 	if (skb->protocol != htons(ETH_P_IPV6) &&
 	    !nf_flow_skb_encap_protocol(skb, htons(ETH_P_IPV6), &offset))
 		return NF_ACCEPT;
@@ -43,8 +43,8 @@ static int nft_last_init(const struct nft_ctx *ctx, const struct nft_expr *expr,
 	return 0;
 }
 
-static void nft_last_eval(const struct nft_expr *expr,
-			  struct nft_regs *regs, const struct nft_pktinfo *pkt)
+void nft_last_eval(const struct nft_expr *expr,
+		   struct nft_regs *regs, const struct nft_pktinfo *pkt)
 {
 	struct nft_last_priv *priv = nft_expr_priv(expr);
 
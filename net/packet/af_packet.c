@@ -2322,17 +2322,24 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 		}
 	}
 	spin_lock(&sk->sk_receive_queue.lock);
-	h.raw = packet_current_rx_frame(po, skb,
-					TP_STATUS_KERNEL, (macoff+snaplen));
-	if (!h.raw)
-		goto drop_n_account;
-
 	if (po->tp_version <= TPACKET_V2) {
+		/* Slots are released without the queue lock.  Test the owner
+		 * bit before reading the slot status: the smp_rmb() in
+		 * __packet_get_status() pairs with the smp_wmb() between the
+		 * status update and the bit release at the end of this
+		 * function.
+		 */
 		slot_id = po->rx_ring.head;
 		if (test_bit(slot_id, po->rx_ring.rx_owner_map))
 			goto drop_n_account;
-		__set_bit(slot_id, po->rx_ring.rx_owner_map);
 	}
+	h.raw = packet_current_rx_frame(po, skb,
+					TP_STATUS_KERNEL, (macoff+snaplen));
+	if (!h.raw)
+		goto drop_n_account;
+
+	if (po->tp_version <= TPACKET_V2)
+		set_bit(slot_id, po->rx_ring.rx_owner_map);
 
 	if (do_vnet &&
 	    virtio_net_hdr_from_skb(skb, h.raw + macoff -
@@ -2447,10 +2454,8 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 #endif
 
 	if (po->tp_version <= TPACKET_V2) {
-		spin_lock(&sk->sk_receive_queue.lock);
 		__packet_set_status(po, h.raw, status);
-		__clear_bit(slot_id, po->rx_ring.rx_owner_map);
-		spin_unlock(&sk->sk_receive_queue.lock);
+		clear_bit(slot_id, po->rx_ring.rx_owner_map);
 		sk->sk_data_ready(sk);
 	} else if (po->tp_version == TPACKET_V3) {
 		prb_clear_blk_fill_status(&po->rx_ring);
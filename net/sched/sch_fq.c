@@ -98,7 +98,7 @@ struct fq_sched_data {
 
 	struct fq_flow_head old_flows;
 
-	struct rb_root	delayed;	/* for rate limited flows */
+	struct rb_root_cached delayed;	/* for rate limited flows */
 	u64		time_next_delayed_flow;
 	u64		ktime_cache;	/* copy of last ktime_get_ns() */
 	unsigned long	unthrottle_latency_ns;
@@ -171,27 +171,30 @@ static void fq_flow_add_tail(struct fq_flow_head *head, struct fq_flow *flow)
 
 static void fq_flow_unset_throttled(struct fq_sched_data *q, struct fq_flow *f)
 {
-	rb_erase(&f->rate_node, &q->delayed);
+	rb_erase_cached(&f->rate_node, &q->delayed);
 	q->throttled_flows--;
 	fq_flow_add_tail(&q->old_flows, f);
 }
 
 static void fq_flow_set_throttled(struct fq_sched_data *q, struct fq_flow *f)
 {
-	struct rb_node **p = &q->delayed.rb_node, *parent = NULL;
+	struct rb_node **p = &q->delayed.rb_root.rb_node, *parent = NULL;
+	bool leftmost = true;
 
 	while (*p) {
 		struct fq_flow *aux;
 
 		parent = *p;
 		aux = rb_entry(parent, struct fq_flow, rate_node);
-		if (f->time_next_packet >= aux->time_next_packet)
+		if (f->time_next_packet >= aux->time_next_packet) {
 			p = &parent->rb_right;
-		else
+			leftmost = false;
+		} else {
 			p = &parent->rb_left;
+		}
 	}
 	rb_link_node(&f->rate_node, parent, p);
-	rb_insert_color(&f->rate_node, &q->delayed);
+	rb_insert_color_cached(&f->rate_node, &q->delayed, leftmost);
 	q->throttled_flows++;
 	q->stat_throttled++;
 
@@ -512,7 +515,7 @@ static void fq_check_throttled(struct fq_sched_data *q, u64 now)
 	q->unthrottle_latency_ns += sample >> 3;
 
 	q->time_next_delayed_flow = ~0ULL;
-	while ((p = rb_first(&q->delayed)) != NULL) {
+	while ((p = rb_first_cached(&q->delayed)) != NULL) {
 		struct fq_flow *f = rb_entry(p, struct fq_flow, rate_node);
 
 		if (f->time_next_packet > now) {
@@ -688,7 +691,7 @@ static void fq_reset(struct Qdisc *sch)
 	}
 	q->new_flows.first	= NULL;
 	q->old_flows.first	= NULL;
-	q->delayed		= RB_ROOT;
+	q->delayed		= RB_ROOT_CACHED;
 	q->flows		= 0;
 	q->inactive_flows	= 0;
 	q->throttled_flows	= 0;
@@ -943,7 +946,7 @@ static int fq_init(struct Qdisc *sch, struct nlattr *opt,
 	q->rate_enable		= 1;
 	q->new_flows.first	= NULL;
 	q->old_flows.first	= NULL;
-	q->delayed		= RB_ROOT;
+	q->delayed		= RB_ROOT_CACHED;
 	q->fq_root		= NULL;
 	q->fq_trees_log		= ilog2(1024);
 	q->orphan_mask		= 1024 - 1;
@@ -143,7 +143,7 @@ struct htb_class {
 };
 
 struct htb_level {
-	struct rb_root	wait_pq;
+	struct rb_root_cached wait_pq;
 	struct htb_prio hprio[TC_HTB_NUMPRIO];
 };
 
@@ -313,7 +313,8 @@ static void htb_add_to_id_tree(struct rb_root *root,
 static void htb_add_to_wait_tree(struct htb_sched *q,
 				 struct htb_class *cl, s64 delay)
 {
-	struct rb_node **p = &q->hlevel[cl->level].wait_pq.rb_node, *parent = NULL;
+	struct rb_node **p = &q->hlevel[cl->level].wait_pq.rb_root.rb_node, *parent = NULL;
+	bool leftmost = true;
 
 	cl->pq_key = q->now + delay;
 	if (cl->pq_key == q->now)
@@ -327,13 +328,16 @@ static void htb_add_to_wait_tree(struct htb_sched *q,
 		struct htb_class *c;
 		parent = *p;
 		c = rb_entry(parent, struct htb_class, pq_node);
-		if (cl->pq_key >= c->pq_key)
+		if (cl->pq_key >= c->pq_key) {
 			p = &parent->rb_right;
-		else
+			leftmost = false;
+		} else {
 			p = &parent->rb_left;
+		}
 	}
 	rb_link_node(&cl->pq_node, parent, p);
-	rb_insert_color(&cl->pq_node, &q->hlevel[cl->level].wait_pq);
+	rb_insert_color_cached(&cl->pq_node, &q->hlevel[cl->level].wait_pq,
+			       leftmost);
 }
 
 /**
@@ -379,6 +383,17 @@ static void htb_safe_rb_erase(struct rb_node *rb, struct rb_root *root)
 	}
 }
 
+static void htb_safe_rb_erase_cached(struct rb_node *rb,
+				     struct rb_root_cached *root)
+{
+	if (RB_EMPTY_NODE(rb)) {
+		WARN_ON(1);
+	} else {
+		rb_erase_cached(rb, root);
+		RB_CLEAR_NODE(rb);
+	}
+}
+
 
 /**
  * htb_remove_class_from_row - removes class from its row
@@ -717,7 +732,7 @@ static void htb_charge_class(struct htb_sched *q, struct htb_class *cl,
 		htb_change_class_mode(q, cl, &diff);
 		if (old_mode != cl->cmode) {
 			if (old_mode != HTB_CAN_SEND)
-				htb_safe_rb_erase(&cl->pq_node, &q->hlevel[cl->level].wait_pq);
+				htb_safe_rb_erase_cached(&cl->pq_node, &q->hlevel[cl->level].wait_pq);
 			if (cl->cmode != HTB_CAN_SEND)
 				htb_add_to_wait_tree(q, cl, diff);
 		}
@@ -748,12 +763,12 @@ static s64 htb_do_events(struct htb_sched *q, const int level,
 	 * too soon
 	 */
 	unsigned long stop_at = start + 2;
-	struct rb_root *wait_pq = &q->hlevel[level].wait_pq;
+	struct rb_root_cached *wait_pq = &q->hlevel[level].wait_pq;
 
 	while (time_before(jiffies, stop_at)) {
 		struct htb_class *cl;
 		s64 diff;
-		struct rb_node *p = rb_first(wait_pq);
+		struct rb_node *p = rb_first_cached(wait_pq);
 
 		if (!p)
 			return 0;
@@ -762,7 +777,7 @@ static s64 htb_do_events(struct htb_sched *q, const int level,
 		if (cl->pq_key > q->now)
 			return cl->pq_key;
 
-		htb_safe_rb_erase(p, wait_pq);
+		htb_safe_rb_erase_cached(p, wait_pq);
 		diff = min_t(s64, q->now - cl->t_c, cl->mbuffer);
 		htb_change_class_mode(q, cl, &diff);
 		if (cl->cmode != HTB_CAN_SEND)
@@ -1527,8 +1542,8 @@ static void htb_parent_to_leaf(struct Qdisc *sch, struct htb_class *cl,
 	WARN_ON(cl->level || !cl->leaf.q || cl->prio_activity);
 
 	if (parent->cmode != HTB_CAN_SEND)
-		htb_safe_rb_erase(&parent->pq_node,
-				  &q->hlevel[parent->level].wait_pq);
+		htb_safe_rb_erase_cached(&parent->pq_node,
+					 &q->hlevel[parent->level].wait_pq);
 
 	parent->level = 0;
 	memset(&parent->inner, 0, sizeof(parent->inner));
@@ -1762,8 +1777,8 @@ static int htb_delete(struct Qdisc *sch, unsigned long arg,
 		htb_deactivate(q, cl);
 
 	if (cl->cmode != HTB_CAN_SEND)
-		htb_safe_rb_erase(&cl->pq_node,
-				  &q->hlevel[cl->level].wait_pq);
+		htb_safe_rb_erase_cached(&cl->pq_node,
+					 &q->hlevel[cl->level].wait_pq);
 
 	if (last_child)
 		htb_parent_to_leaf(sch, cl, new_q);
@@ -1976,7 +1991,7 @@ static int htb_change_class(struct Qdisc *sch, u32 classid,
 
 			/* remove from evt list because of level change */
 			if (parent->cmode != HTB_CAN_SEND) {
-				htb_safe_rb_erase(&parent->pq_node, &q->hlevel[0].wait_pq);
+				htb_safe_rb_erase_cached(&parent->pq_node, &q->hlevel[0].wait_pq);
 				parent->cmode = HTB_CAN_SEND;
 			}
 			parent->level = (parent->parent ? parent->parent->level
@@ -451,18 +451,34 @@ void svc_xprt_do_enqueue(struct svc_xprt *xprt)
 	pool->sp_stats.sockets_queued++;
 	spin_unlock_bh(&pool->sp_lock);
 
+	/*
+	 * Don't walk (and dirty) every thread of a busy pool just to find
+	 * that none is idle.  Pairs with the barrier in svc_get_next_xprt():
+	 * either we see the idle thread, or it sees the queued xprt.
+	 */
+	smp_mb();
+	if (!atomic_read(&pool->sp_nidle))
+		goto out_congested;
+
 	/* find a thread for this xprt */
 	rcu_read_lock();
 	list_for_each_entry_rcu(rqstp, &pool->sp_all_threads, rq_all) {
-		if (test_and_set_bit(RQ_BUSY, &rqstp->rq_flags))
+		if (test_bit(RQ_BUSY, &rqstp->rq_flags) ||
+		    test_and_set_bit(RQ_BUSY, &rqstp->rq_flags))
 			continue;
+		atomic_dec(&pool->sp_nidle);
 		atomic_long_inc(&pool->sp_stats.threads_woken);
 		rqstp->rq_qtime = ktime_get();
 		wake_up_process(rqstp->rq_task);
 		goto out_unlock;
 	}
+	rcu_read_unlock();
+out_congested:
 	set_bit(SP_CONGESTED, &pool->sp_flags);
 	rqstp = NULL;
+	put_cpu();
+	trace_svc_xprt_do_enqueue(xprt, rqstp);
+	return;
 out_unlock:
 	rcu_read_unlock();
 	put_cpu();
@@ -758,6 +774,7 @@ static struct svc_xprt *svc_get_next_xprt(struct svc_rqst *rqstp, long timeout)
 	smp_mb__before_atomic();
 	clear_bit(SP_CONGESTED, &pool->sp_flags);
 	clear_bit(RQ_BUSY, &rqstp->rq_flags);
+	atomic_inc(&pool->sp_nidle);
 	smp_mb__after_atomic();
 
 	if (likely(rqst_should_sleep(rqstp)))
@@ -767,8 +784,8 @@ static struct svc_xprt *svc_get_next_xprt(struct svc_rqst *rqstp, long timeout)
 
 	try_to_freeze();
 
-	set_bit(RQ_BUSY, &rqstp->rq_flags);
-	smp_mb__after_atomic();
+	if (!test_and_set_bit(RQ_BUSY, &rqstp->rq_flags))
+		atomic_dec(&pool->sp_nidle);
 	rqstp->rq_xprt = svc_xprt_dequeue(pool);
 	if (rqstp->rq_xprt)
 		goto out_found;
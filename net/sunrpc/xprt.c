@@ -1212,6 +1212,8 @@ void xprt_complete_rqst(struct rpc_task *task, int copied)
 	struct rpc_xprt *xprt = req->rq_xprt;
 
 	xprt->stat.recvs++;
+	xprt->stat.bytes_recv += copied;
+	xprt->stat.rtt_us += ktime_to_us(req->rq_rtt);
 
 	req->rq_private_buf.len = copied;
 	/* Ensure all writes are done before we update */
@@ -1560,6 +1562,7 @@ xprt_request_transmit(struct rpc_rqst *req, struct rpc_task *snd_task)
 	spin_lock(&xprt->transport_lock);
 
 	xprt->stat.sends++;
+	xprt->stat.bytes_sent += req->rq_slen;
 	xprt->stat.req_u += xprt->stat.sends - xprt->stat.recvs;
 	xprt->stat.bklog_u += xprt->backlog.qlen;
 	xprt->stat.sending_u += xprt->sending.qlen;
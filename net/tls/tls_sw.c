@@ -1570,6 +1570,10 @@ static int decrypt_skb_update(struct sock *sk, struct sk_buff *skb,
 		if (!ctx->decrypted) {
 			err = decrypt_internal(sk, skb, dest, NULL, chunk, zc,
 					       async);
+			if (!err || err == -EINPROGRESS)
+				TLS_INC_STATS(sock_net(sk), *zc ?
+					      LINUX_MIB_TLSRXDECRYPTZC :
+					      LINUX_MIB_TLSRXDECRYPTCOPY);
 			if (err < 0) {
 				if (err == -EINPROGRESS)
 					tls_advance_record_sn(sk, prot,
@@ -45,12 +45,10 @@ EXPORT_SYMBOL(unix_get_socket);
 /* Keep the number of times in flight count for the file
  * descriptor if it is for an AF_UNIX socket.
  */
-void unix_inflight(struct user_struct *user, struct file *fp)
+static void __unix_inflight(struct user_struct *user, struct file *fp)
 {
 	struct sock *s = unix_get_socket(fp);
 
-	spin_lock(&unix_gc_lock);
-
 	if (s) {
 		struct unix_sock *u = unix_sk(s);
 
@@ -64,15 +62,19 @@ void unix_inflight(struct user_struct *user, struct file *fp)
 		WRITE_ONCE(unix_tot_inflight, unix_tot_inflight + 1);
 	}
 	user->unix_inflight++;
+}
+
+void unix_inflight(struct user_struct *user, struct file *fp)
+{
+	spin_lock(&unix_gc_lock);
+	__unix_inflight(user, fp);
 	spin_unlock(&unix_gc_lock);
 }
 
-void unix_notinflight(struct user_struct *user, struct file *fp)
+static void __unix_notinflight(struct user_struct *user, struct file *fp)
 {
 	struct sock *s = unix_get_socket(fp);
 
-	spin_lock(&unix_gc_lock);
-
 	if (s) {
 		struct unix_sock *u = unix_sk(s);
 
@@ -85,6 +87,12 @@ void unix_notinflight(struct user_struct *user, struct file *fp)
 		WRITE_ONCE(unix_tot_inflight, unix_tot_inflight - 1);
 	}
 	user->unix_inflight--;
+}
+
+void unix_notinflight(struct user_struct *user, struct file *fp)
+{
+	spin_lock(&unix_gc_lock);
+	__unix_notinflight(user, fp);
 	spin_unlock(&unix_gc_lock);
 }
 
@@ -119,8 +127,11 @@ int unix_attach_fds(struct scm_cookie *scm, struct sk_buff *skb)
 	if (!UNIXCB(skb).fp)
 		return -ENOMEM;
 
+	/* Account all the files of the message under one lock hold */
+	spin_lock(&unix_gc_lock);
 	for (i = scm->fp->count - 1; i >= 0; i--)
-		unix_inflight(scm->fp->user, scm->fp->fp[i]);
+		__unix_inflight(scm->fp->user, scm->fp->fp[i]);
+	spin_unlock(&unix_gc_lock);
 	return 0;
 }
 EXPORT_SYMBOL(unix_attach_fds);
@@ -132,8 +143,10 @@ void unix_detach_fds(struct scm_cookie *scm, struct sk_buff *skb)
 	scm->fp = UNIXCB(skb).fp;
 	UNIXCB(skb).fp = NULL;
 
+	spin_lock(&unix_gc_lock);
 	for (i = scm->fp->count-1; i >= 0; i--)
-		unix_notinflight(scm->fp->user, scm->fp->fp[i]);
+		__unix_notinflight(scm->fp->user, scm->fp->fp[i]);
+	spin_unlock(&unix_gc_lock);
 }
 EXPORT_SYMBOL(unix_detach_fds);
 
@@ -358,59 +358,54 @@ bool xsk_tx_peek_desc(struct xsk_buff_pool *pool, struct xdp_desc *desc)
 }
 EXPORT_SYMBOL(xsk_tx_peek_desc);
 
-static u32 xsk_tx_peek_release_fallback(struct xsk_buff_pool *pool, u32 max_entries)
+u32 xsk_tx_peek_release_desc_batch(struct xsk_buff_pool *pool, u32 max_entries)
 {
 	struct xdp_desc *descs = pool->tx_descs;
-	u32 nb_pkts = 0;
-
-	while (nb_pkts < max_entries && xsk_tx_peek_desc(pool, &descs[nb_pkts]))
-		nb_pkts++;
-
-	xsk_tx_release(pool);
-	return nb_pkts;
-}
-
-u32 xsk_tx_peek_release_desc_batch(struct xsk_buff_pool *pool, u32 nb_pkts)
-{
 	struct xdp_sock *xs;
+	u32 nb_pkts = 0;
 
+	/* Sockets sharing the pool are drained one after the other, each
+	 * with a single batched read of its Tx ring.
+	 */
 	rcu_read_lock();
-	if (!list_is_singular(&pool->xsk_tx_list)) {
-		/* Fallback to the non-batched version */
-		rcu_read_unlock();
-		return xsk_tx_peek_release_fallback(pool, nb_pkts);
-	}
+	list_for_each_entry_rcu(xs, &pool->xsk_tx_list, tx_list) {
+		u32 nb_entries;
 
-	xs = list_first_or_null_rcu(&pool->xsk_tx_list, struct xdp_sock, tx_list);
-	if (!xs) {
-		nb_pkts = 0;
-		goto out;
-	}
+		nb_entries = xskq_cons_nb_entries(xs->tx, max_entries - nb_pkts);
+		if (!nb_entries) {
+			xs->tx->queue_empty_descs++;
+			continue;
+		}
 
-	nb_pkts = xskq_cons_nb_entries(xs->tx, nb_pkts);
+		/* This is the backpressure mechanism for the Tx path. Try to
+		 * reserve space in the completion queue for all packets, but
+		 * if there are fewer slots available, just process that many
+		 * packets. This avoids having to implement any buffering in
+		 * the Tx path.
+		 */
+		nb_entries = xskq_prod_nb_free(pool->cq, nb_entries);
+		if (!nb_entries)
+			break;
+
+		nb_entries = xskq_cons_read_desc_batch(xs->tx, pool,
+						       descs + nb_pkts,
+						       nb_entries);
+		if (!nb_entries) {
+			xs->tx->queue_empty_descs++;
+			continue;
+		}
 
-	/* This is the backpressure mechanism for the Tx path. Try to
-	 * reserve space in the completion queue for all packets, but
-	 * if there are fewer slots available, just process that many
-	 * packets. This avoids having to implement any buffering in
-	 * the Tx path.
-	 */
-	nb_pkts = xskq_prod_nb_free(pool->cq, nb_pkts);
-	if (!nb_pkts)
-		goto out;
+		__xskq_cons_release(xs->tx);
+		xskq_prod_write_addr_batch(pool->cq, descs + nb_pkts,
+					   nb_entries);
+		xs->sk.sk_write_space(&xs->sk);
 
-	nb_pkts = xskq_cons_read_desc_batch(xs->tx, pool, nb_pkts);
-	if (!nb_pkts) {
-		xs->tx->queue_empty_descs++;
-		goto out;
+		nb_pkts += nb_entries;
+		if (nb_pkts == max_entries)
+			break;
 	}
-
-	__xskq_cons_release(xs->tx);
-	xskq_prod_write_addr_batch(pool->cq, pool->tx_descs, nb_pkts);
-	xs->sk.sk_write_space(&xs->sk);
-
-out:
 	rcu_read_unlock();
+
 	return nb_pkts;
 }
 EXPORT_SYMBOL(xsk_tx_peek_release_desc_batch);
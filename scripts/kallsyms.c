@@ -99,6 +99,7 @@ static bool is_ignored_symbol(const char *name, char type)
 		"kallsyms_markers",
 		"kallsyms_token_table",
 		"kallsyms_token_index",
+		"kallsyms_seqs_of_names",
 		/* Exclude linker generated symbols which vary between passes */
 		"_SDA_BASE_",		/* ppc */
 		"_SDA2_BASE_",		/* ppc */
@@ -384,6 +385,74 @@ static int symbol_absolute(const struct sym_entry *s)
 	return s->percpu_absolute;
 }
 
+static char **expanded_names;
+
+static int compare_names(const void *a, const void *b)
+{
+	unsigned int sa = *(const unsigned int *)a;
+	unsigned int sb = *(const unsigned int *)b;
+	int ret;
+
+	/* skip the symbol type, the kernel does not compare it either */
+	ret = strcmp(expanded_names[sa] + 1, expanded_names[sb] + 1);
+	if (ret)
+		return ret;
+
+	/* keep duplicates in address order, so the first match wins */
+	return sa < sb ? -1 : sa > sb;
+}
+
+/*
+ * Emit the index of every symbol, in the order of the symbol names, so that
+ * kallsyms_lookup_name() can do a binary search instead of a linear scan.
+ * Indexes are stored in three bytes each, which covers 16M symbols.
+ */
+static void write_seqs_of_names(void)
+{
+	unsigned int *seqs;
+	/* the type char, up to KSYM_NAME_LEN - 1 name chars and the NUL */
+	char buf[KSYM_NAME_LEN + 1];
+	unsigned int i;
+
+	if (table_cnt > 0xFFFFFF) {
+		fprintf(stderr, "kallsyms failure: too many symbols\n");
+		exit(EXIT_FAILURE);
+	}
+
+	seqs = malloc(sizeof(*seqs) * table_cnt);
+	expanded_names = malloc(sizeof(*expanded_names) * table_cnt);
+	if (!seqs || !expanded_names) {
+		fprintf(stderr, "kallsyms failure: "
+			"unable to allocate required memory\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for (i = 0; i < table_cnt; i++) {
+		expand_symbol(table[i]->sym, table[i]->len, buf);
+		expanded_names[i] = strdup(buf);
+		if (!expanded_names[i]) {
+			fprintf(stderr, "kallsyms failure: "
+				"unable to allocate required memory\n");
+			exit(EXIT_FAILURE);
+		}
+		seqs[i] = i;
+	}
+
+	qsort(seqs, table_cnt, sizeof(*seqs), compare_names);
+
+	output_label("kallsyms_seqs_of_names");
+	for (i = 0; i < table_cnt; i++)
+		printf("\t.byte 0x%02x, 0x%02x, 0x%02x\n",
+		       (seqs[i] >> 16) & 0xFF, (seqs[i] >> 8) & 0xFF,
+		       seqs[i] & 0xFF);
+	printf("\n");
+
+	for (i = 0; i < table_cnt; i++)
+		free(expanded_names[i]);
+	free(expanded_names);
+	free(seqs);
+}
+
 static void write_src(void)
 {
 	unsigned int i, k, off;
@@ -500,6 +569,8 @@ static void write_src(void)
 	for (i = 0; i < 256; i++)
 		printf("\t.short\t%d\n", best_idx[i]);
 	printf("\n");
+
+	write_seqs_of_names();
 }
 
 
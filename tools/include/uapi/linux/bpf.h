@@ -604,6 +604,17 @@ union bpf_iter_link_info {
  *			Look up the value of a spin-locked map without
  *			returning the lock. This must be specified if the
  *			elements contain a spinlock.
+ *		**BPF_F_PERCPU_SUM**
+ *			For **BPF_MAP_TYPE_PERCPU_ARRAY** only, whose
+ *			*value_size* must be a multiple of 8. Treat each value
+ *			as an array of u64 counters and return their sum over
+ *			all possible CPUs. The *values* buffer then holds a
+ *			single *value_size* value per element instead of one
+ *			per CPU.
+ *		**BPF_F_PERCPU_MIN**, **BPF_F_PERCPU_MAX**
+ *			Like **BPF_F_PERCPU_SUM**, but return the smallest or
+ *			largest value of each u64 counter over all possible
+ *			CPUs. At most one of the three flags may be given.
  *
  *		On success, *count* elements from the map are copied into the
  *		user buffer, with the keys copied into *keys* and the values
@@ -634,6 +645,12 @@ union bpf_iter_link_info {
  *		  *count* elements may be deleted without returning the keys
  *		  and values of the deleted elements.
  *
+ *		Elements of a **BPF_MAP_TYPE_PERCPU_ARRAY** can't be deleted;
+ *		their values are reset to zero on all CPUs instead. The
+ *		reset is exact only for counters updated with atomic adds on
+ *		64-bit kernels; plain updates racing with it may be lost or
+ *		counted twice.
+ *
  *	Return
  *		Returns zero on success. On error, -1 is returned and *errno*
  *		is set appropriately.
@@ -906,6 +923,8 @@ enum bpf_map_type {
 	BPF_MAP_TYPE_RINGBUF,
 	BPF_MAP_TYPE_INODE_STORAGE,
 	BPF_MAP_TYPE_TASK_STORAGE,
+	BPF_MAP_TYPE_BLOOM_FILTER,
+	BPF_MAP_TYPE_USER_RINGBUF,
 };
 
 /* Note that tracing related programs such as
@@ -994,6 +1013,7 @@ enum bpf_attach_type {
 	BPF_SK_REUSEPORT_SELECT,
 	BPF_SK_REUSEPORT_SELECT_OR_MIGRATE,
 	BPF_PERF_EVENT,
+	BPF_TRACE_KPROBE_MULTI,
 	__MAX_BPF_ATTACH_TYPE
 };
 
@@ -1008,6 +1028,7 @@ enum bpf_link_type {
 	BPF_LINK_TYPE_NETNS = 5,
 	BPF_LINK_TYPE_XDP = 6,
 	BPF_LINK_TYPE_PERF_EVENT = 7,
+	BPF_LINK_TYPE_KPROBE_MULTI = 8,
 
 	MAX_BPF_LINK_TYPE,
 };
@@ -1170,6 +1191,9 @@ enum {
 	BPF_NOEXIST	= 1, /* create new element if it didn't exist */
 	BPF_EXIST	= 2, /* update existing element */
 	BPF_F_LOCK	= 4, /* spin_lock-ed map_lookup/map_update */
+	BPF_F_PERCPU_SUM = 8, /* sum percpu array values across CPUs */
+	BPF_F_PERCPU_MIN = 16, /* min of percpu array values across CPUs */
+	BPF_F_PERCPU_MAX = 32, /* max of percpu array values across CPUs */
 };
 
 /* flags for BPF_MAP_CREATE command */
@@ -1274,6 +1298,13 @@ union bpf_attr {
 						   * struct stored as the
 						   * map value
 						   */
+		__u64	map_extra;	/* Any per-map-type extra fields
+					 *
+					 * BPF_MAP_TYPE_BLOOM_FILTER - the lowest 4 bits
+					 * indicate the number of hash functions
+					 * (if 0, the bloom filter will default
+					 * to using 5 hash functions).
+					 */
 	};
 
 	struct { /* anonymous struct used by BPF_MAP_*_ELEM commands */
@@ -1455,6 +1486,13 @@ union bpf_attr {
 				 */
 				__u64		bpf_cookie;
 			} perf_event;
+			struct {
+				__u32		flags;
+				__u32		cnt;
+				__aligned_u64	syms;
+				__aligned_u64	addrs;
+				__aligned_u64	cookies;
+			} kprobe_multi;
 		};
 	} link_create;
 
@@ -3368,6 +3406,9 @@ union bpf_attr {
  * 		**BPF_EXIST**
  * 			If the queue/stack is full, the oldest element is
  * 			removed to make room for this.
+ *
+ * 		For a **BPF_MAP_TYPE_BLOOM_FILTER** map, *flags* must be
+ * 		**BPF_ANY**.
  * 	Return
  * 		0 on success, or a negative error in case of failure.
  *
@@ -3380,9 +3421,15 @@ union bpf_attr {
  * long bpf_map_peek_elem(struct bpf_map *map, void *value)
  * 	Description
  * 		Get an element from *map* without removing it.
+ *
+ * 		For a **BPF_MAP_TYPE_BLOOM_FILTER** map, check whether *value*
+ * 		may be in *map* instead.
  * 	Return
  * 		0 on success, or a negative error in case of failure.
  *
+ * 		For a **BPF_MAP_TYPE_BLOOM_FILTER** map, **-ENOENT** means
+ * 		*value* is definitely not in *map*, 0 means it may be.
+ *
  * long bpf_msg_push_data(struct sk_msg_buff *msg, u32 start, u32 len, u64 flags)
  *	Description
  *		For socket policies, insert *len* bytes into *msg* at offset
@@ -4877,6 +4924,49 @@ union bpf_attr {
  *		Get the struct pt_regs associated with **task**.
  *	Return
  *		A pointer to struct pt_regs.
+ *
+ * long bpf_user_ringbuf_drain(struct bpf_map *map, void *callback_fn, void *ctx, u64 flags)
+ *	Description
+ *		Drain samples from the specified user ring buffer, and invoke
+ *		the provided callback for each such sample:
+ *
+ *		long (\*callback_fn)(void \*sample, u32 size, void \*ctx);
+ *
+ *		*sample* points to the read-only sample data and *size* is
+ *		its length in bytes. The callback may access up to the map's
+ *		*value_size* bytes at *sample*, of which only the first *size*
+ *		bytes belong to the sample.
+ *
+ *		If **callback_fn** returns 0, the helper will continue to try
+ *		and drain the next sample, up to a maximum of
+ *		BPF_MAX_USER_RINGBUF_SAMPLES samples. If the return value is 1,
+ *		the helper will skip the rest of the samples and return. Other
+ *		return values are not used now, and will be rejected by the
+ *		verifier.
+ *	Return
+ *		The number of drained samples if no error was encountered while
+ *		draining samples, or 0 if no samples were present in the ring
+ *		buffer. If a user-space producer was epoll-waiting on this map,
+ *		and at least one sample was drained, they will receive an event
+ *		notification notifying them of available space in the ring
+ *		buffer. If the BPF_RB_NO_WAKEUP flag is passed to this
+ *		function, no wakeup notification will be sent. If the
+ *		BPF_RB_FORCE_WAKEUP flag is passed, a wakeup notification will
+ *		be sent even if no sample was drained.
+ *
+ *		On failure, the returned value is one of the following:
+ *
+ *		**-EBUSY** if the ring buffer is contended, and another calling
+ *		context was concurrently draining the ring buffer.
+ *
+ *		**-EINVAL** if user-space is not properly tracking the ring
+ *		buffer due to the producer position not being aligned to 8
+ *		bytes, a sample not being aligned to 8 bytes, or the producer
+ *		position not matching the advertised length of a sample.
+ *
+ *		**-E2BIG** if user-space has tried to publish a sample which is
+ *		larger than the size of the ring buffer, or larger than the
+ *		map's *value_size*.
  */
 #define __BPF_FUNC_MAPPER(FN)		\
 	FN(unspec),			\
@@ -5055,6 +5145,7 @@ union bpf_attr {
 	FN(get_func_ip),		\
 	FN(get_attach_cookie),		\
 	FN(task_pt_regs),		\
+	FN(user_ringbuf_drain),		\
 	/* */
 
 /* integer value in 'imm' field of BPF_CALL instruction selects which helper
@@ -5474,6 +5565,13 @@ struct bpf_cpumap_val {
 		int   fd;	/* prog fd on map write */
 		__u32 id;	/* prog id on map read */
 	} bpf_prog;
+	__u32 batch;	/* frames handled per kthread round, 0 for default */
+	__u32 :32;	/* alignment pad */
+	struct {
+		__u64 packets;		/* frames and skbs dequeued */
+		__u64 drops;		/* dropped on the remote CPU */
+		__u64 gro_merged;	/* packets merged by GRO */
+	} stats;	/* filled in by the kernel on map read */
 };
 
 enum sk_action {
@@ -5595,6 +5693,8 @@ struct bpf_map_info {
 	__u32 btf_id;
 	__u32 btf_key_type_id;
 	__u32 btf_value_type_id;
+	__u32 :32;	/* alignment pad */
+	__u64 map_extra;
 } __attribute__((aligned(8)));
 
 struct bpf_btf_info {
@@ -1112,6 +1112,7 @@ struct kvm_ppc_resize_hpt {
 #define KVM_CAP_BINARY_STATS_FD 203
 #define KVM_CAP_EXIT_ON_EMULATION_FAILURE 204
 #define KVM_CAP_ARM_MTE 205
+#define KVM_CAP_DIRTY_LOG_RING_NOTIFY 206
 
 #ifdef KVM_CAP_IRQ_ROUTING
 
@@ -1881,6 +1882,10 @@ struct kvm_hyperv_eventfd {
 #define KVM_DIRTY_LOG_MANUAL_PROTECT_ENABLE    (1 << 0)
 #define KVM_DIRTY_LOG_INITIALLY_SET            (1 << 1)
 
+/* Available with KVM_CAP_HALT_POLL */
+#define KVM_HALT_POLL_PARAMS                   (1 << 0)
+#define KVM_HALT_POLL_ADAPTIVE                 (1 << 1)
+
 /*
  * Arch needs to define the macro after implementing the dirty ring
  * feature.  KVM_DIRTY_LOG_PAGE_OFFSET should be defined as the
@@ -2007,4 +2012,7 @@ struct kvm_stats_desc {
 
 #define KVM_GET_STATS_FD  _IO(KVMIO,  0xce)
 
+/* Available with KVM_CAP_DIRTY_LOG_RING_NOTIFY */
+#define KVM_RESET_DIRTY_RING  _IO(KVMIO,  0xcf)
+
 #endif /* __LINUX_KVM_H */
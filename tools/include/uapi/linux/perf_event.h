@@ -490,6 +490,36 @@ struct perf_event_query_bpf {
 	__u32	ids[0];
 };
 
+/*
+ * Structure used by below PERF_EVENT_IOC_ATTACH_CGROUP command
+ * to count a CPU-wide event separately for each of the given cgroups.
+ */
+struct perf_event_attach_cgroup {
+	/*
+	 * The below ids array length
+	 */
+	__u32	nr;
+	__u32	reserved;
+	/*
+	 * Cgroup ids, as returned by name_to_handle_at() on the cgroup
+	 * directory of the hierarchy the perf_event controller is on
+	 */
+	__u64	ids[0];
+};
+
+/*
+ * Structure used by below PERF_EVENT_IOC_READ_CGROUP command
+ * to read the count of a cgroup attached to a CPU-wide event.
+ */
+struct perf_event_cgroup_read {
+	__u64	cgroup_id;
+	/*
+	 * Set by the kernel to the count of the event while the cgroup
+	 * or one of its descendants was running on the event's CPU
+	 */
+	__u64	count;
+};
+
 /*
  * Ioctls that can be done on a perf event fd:
  */
@@ -505,6 +535,8 @@ struct perf_event_query_bpf {
 #define PERF_EVENT_IOC_PAUSE_OUTPUT		_IOW('$', 9, __u32)
 #define PERF_EVENT_IOC_QUERY_BPF		_IOWR('$', 10, struct perf_event_query_bpf *)
 #define PERF_EVENT_IOC_MODIFY_ATTRIBUTES	_IOW('$', 11, struct perf_event_attr *)
+#define PERF_EVENT_IOC_ATTACH_CGROUP		_IOW('$', 12, struct perf_event_attach_cgroup *)
+#define PERF_EVENT_IOC_READ_CGROUP		_IOWR('$', 13, struct perf_event_cgroup_read *)
 
 enum perf_event_ioc_flags {
 	PERF_IOC_FLAG_GROUP		= 1U << 0,
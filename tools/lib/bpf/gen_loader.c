@@ -413,6 +413,8 @@ void bpf_gen__map_create(struct bpf_gen *gen,
 	case BPF_MAP_TYPE_QUEUE:
 	case BPF_MAP_TYPE_STACK:
 	case BPF_MAP_TYPE_RINGBUF:
+	case BPF_MAP_TYPE_BLOOM_FILTER:
+	case BPF_MAP_TYPE_USER_RINGBUF:
 		break;
 	default:
 		attr.btf_key_type_id = map_attr->btf_key_type_id;
@@ -7932,6 +7932,8 @@ void bpf_program__set_expected_attach_type(struct bpf_program *prog,
 
 static struct bpf_link *attach_kprobe(const struct bpf_sec_def *sec,
 				      struct bpf_program *prog);
+static struct bpf_link *attach_kprobe_multi(const struct bpf_sec_def *sec,
+					    struct bpf_program *prog);
 static struct bpf_link *attach_tp(const struct bpf_sec_def *sec,
 				  struct bpf_program *prog);
 static struct bpf_link *attach_raw_tp(const struct bpf_sec_def *sec,
@@ -7954,6 +7956,9 @@ static const struct bpf_sec_def section_defs[] = {
 	BPF_PROG_SEC("uprobe/",			BPF_PROG_TYPE_KPROBE),
 	SEC_DEF("kretprobe/", KPROBE,
 		.attach_fn = attach_kprobe),
+	SEC_DEF("kprobe.multi/", KPROBE,
+		.expected_attach_type = BPF_TRACE_KPROBE_MULTI,
+		.attach_fn = attach_kprobe_multi),
 	BPF_PROG_SEC("uretprobe/",		BPF_PROG_TYPE_KPROBE),
 	BPF_PROG_SEC("classifier",		BPF_PROG_TYPE_SCHED_CLS),
 	BPF_PROG_SEC("action",			BPF_PROG_TYPE_SCHED_ACT),
@@ -9314,6 +9319,205 @@ static struct bpf_link *attach_kprobe(const struct bpf_sec_def *sec,
 	return link;
 }
 
+/* Adapted from perf/util/string.c */
+static bool glob_match(const char *str, const char *pat)
+{
+	while (*str && *pat && *pat != '*') {
+		if (*pat == '?') {      /* Matches any single character */
+			str++;
+			pat++;
+			continue;
+		}
+		if (*str != *pat)
+			return false;
+		str++;
+		pat++;
+	}
+	/* Check wild card */
+	if (*pat == '*') {
+		while (*pat == '*')
+			pat++;
+		if (!*pat) /* Tail wild card matches all */
+			return true;
+		while (*str)
+			if (glob_match(str++, pat))
+				return true;
+	}
+	return !*str && !*pat;
+}
+
+struct kprobe_multi_resolve {
+	char **syms;
+	size_t cap;
+	size_t cnt;
+};
+
+static void kprobe_multi_resolve_free(struct kprobe_multi_resolve *res)
+{
+	size_t i;
+
+	for (i = 0; i < res->cnt; i++)
+		free(res->syms[i]);
+	free(res->syms);
+}
+
+static int kprobe_multi_sym_cmp(const void *a, const void *b)
+{
+	return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+/* Collect functions matching @pattern from available_filter_functions,
+ * which only lists functions ftrace can attach to. Static functions can
+ * show up several times under the same name, attach to each name once.
+ */
+static int resolve_kprobe_multi_pattern(const char *pattern,
+					struct kprobe_multi_resolve *res)
+{
+	static const char * const paths[] = {
+		"/sys/kernel/tracing/available_filter_functions",
+		"/sys/kernel/debug/tracing/available_filter_functions",
+	};
+	char sym_name[500];
+	size_t i, j;
+	FILE *f = NULL;
+	int err = 0;
+
+	for (i = 0; i < ARRAY_SIZE(paths) && !f; i++)
+		f = fopen(paths[i], "r");
+	if (!f) {
+		err = -errno;
+		pr_warn("failed to open available_filter_functions: %d\n", err);
+		return err;
+	}
+
+	while (fscanf(f, "%499s%*[^\n]\n", sym_name) == 1) {
+		if (!glob_match(sym_name, pattern))
+			continue;
+		err = libbpf_ensure_mem((void **)&res->syms, &res->cap,
+					sizeof(*res->syms), res->cnt + 1);
+		if (err)
+			goto out;
+		res->syms[res->cnt] = strdup(sym_name);
+		if (!res->syms[res->cnt]) {
+			err = -ENOMEM;
+			goto out;
+		}
+		res->cnt++;
+	}
+
+	if (!res->cnt)
+		goto out;
+
+	qsort(res->syms, res->cnt, sizeof(*res->syms), kprobe_multi_sym_cmp);
+	for (i = 1, j = 1; i < res->cnt; i++) {
+		if (strcmp(res->syms[i], res->syms[j - 1]) == 0) {
+			free(res->syms[i]);
+			continue;
+		}
+		res->syms[j++] = res->syms[i];
+	}
+	res->cnt = j;
+out:
+	fclose(f);
+	return err;
+}
+
+struct bpf_link *
+bpf_program__attach_kprobe_multi_opts(struct bpf_program *prog,
+				      const char *pattern,
+				      const struct bpf_kprobe_multi_opts *opts)
+{
+	DECLARE_LIBBPF_OPTS(bpf_link_create_opts, lopts);
+	struct kprobe_multi_resolve res = {};
+	const unsigned long *addrs;
+	char errmsg[STRERR_BUFSIZE];
+	struct bpf_link *link = NULL;
+	const __u64 *cookies;
+	int err, link_fd, prog_fd;
+	const char **syms;
+	size_t cnt;
+
+	if (!OPTS_VALID(opts, bpf_kprobe_multi_opts))
+		return libbpf_err_ptr(-EINVAL);
+
+	syms    = OPTS_GET(opts, syms, NULL);
+	addrs   = OPTS_GET(opts, addrs, NULL);
+	cnt     = OPTS_GET(opts, cnt, 0);
+	cookies = OPTS_GET(opts, cookies, NULL);
+
+	if (!pattern && !addrs && !syms)
+		return libbpf_err_ptr(-EINVAL);
+	if (pattern && (addrs || syms || cookies || cnt))
+		return libbpf_err_ptr(-EINVAL);
+	if (!pattern && !cnt)
+		return libbpf_err_ptr(-EINVAL);
+	if (addrs && syms)
+		return libbpf_err_ptr(-EINVAL);
+
+	prog_fd = bpf_program__fd(prog);
+	if (prog_fd < 0) {
+		pr_warn("prog '%s': can't attach before loaded\n", prog->name);
+		return libbpf_err_ptr(-EINVAL);
+	}
+
+	if (pattern) {
+		err = resolve_kprobe_multi_pattern(pattern, &res);
+		if (err)
+			goto error;
+		if (!res.cnt) {
+			pr_warn("prog '%s': no functions match '%s'\n",
+				prog->name, pattern);
+			err = -ENOENT;
+			goto error;
+		}
+		syms = (const char **)res.syms;
+		cnt = res.cnt;
+	}
+
+	lopts.kprobe_multi.syms = syms;
+	lopts.kprobe_multi.addrs = addrs;
+	lopts.kprobe_multi.cookies = cookies;
+	lopts.kprobe_multi.cnt = cnt;
+
+	link = calloc(1, sizeof(*link));
+	if (!link) {
+		err = -ENOMEM;
+		goto error;
+	}
+	link->detach = &bpf_link__detach_fd;
+
+	link_fd = bpf_link_create(prog_fd, 0, BPF_TRACE_KPROBE_MULTI, &lopts);
+	if (link_fd < 0) {
+		err = -errno;
+		pr_warn("prog '%s': failed to attach %zu kprobes: %s\n",
+			prog->name, cnt,
+			libbpf_strerror_r(err, errmsg, sizeof(errmsg)));
+		goto error;
+	}
+	link->fd = link_fd;
+	kprobe_multi_resolve_free(&res);
+	return link;
+
+error:
+	free(link);
+	kprobe_multi_resolve_free(&res);
+	return libbpf_err_ptr(err);
+}
+
+static struct bpf_link *attach_kprobe_multi(const struct bpf_sec_def *sec,
+					    struct bpf_program *prog)
+{
+	const char *pattern = prog->sec_name + sec->len;
+
+	if (!*pattern) {
+		pr_warn("prog '%s': kprobe.multi needs a function pattern\n",
+			prog->name);
+		return libbpf_err_ptr(-EINVAL);
+	}
+
+	return bpf_program__attach_kprobe_multi_opts(prog, pattern, NULL);
+}
+
 LIBBPF_API struct bpf_link *
 bpf_program__attach_uprobe_opts(struct bpf_program *prog, pid_t pid,
 				const char *binary_path, size_t func_offset,
@@ -228,6 +228,7 @@ bool bpf_probe_map_type(enum bpf_map_type map_type, __u32 ifindex)
 		break;
 	case BPF_MAP_TYPE_QUEUE:
 	case BPF_MAP_TYPE_STACK:
+	case BPF_MAP_TYPE_BLOOM_FILTER:
 		key_size	= 0;
 		break;
 	case BPF_MAP_TYPE_SK_STORAGE:
@@ -247,6 +248,11 @@ bool bpf_probe_map_type(enum bpf_map_type map_type, __u32 ifindex)
 		value_size = 0;
 		max_entries = sysconf(_SC_PAGE_SIZE);
 		break;
+	case BPF_MAP_TYPE_USER_RINGBUF:
+		key_size = 0;
+		value_size = 8;
+		max_entries = sysconf(_SC_PAGE_SIZE);
+		break;
 	case BPF_MAP_TYPE_UNSPEC:
 	case BPF_MAP_TYPE_HASH:
 	case BPF_MAP_TYPE_ARRAY:
@@ -42,7 +42,10 @@
  *
  * Note that because fds are private to each thread, this workload does
  * not stress scenarios where multiple tasks are awoken per ready IO; ie:
- * EPOLLEXCLUSIVE semantics.
+ * EPOLLEXCLUSIVE semantics. The fds can however be registered with
+ * EPOLLEXCLUSIVE (--exclusive), and the number of events harvested per
+ * epoll_wait(2) call can be raised (--maxevents), to see how the single
+ * queue model scales when many workers share the instance.
  *
  * The end result/metric is throughput: number of ops/second where an
  * operation consists of:
@@ -104,11 +107,15 @@ static bool noaffinity;
 static unsigned int nested = 0;
 static bool et; /* edge-trigger */
 static bool oneshot;
+static bool exclusive;
 static bool multiq; /* use an epoll instance per thread */
 
 /* amount of fds to monitor, per thread */
 static unsigned int nfds = 64;
 
+/* events harvested per epoll_wait(2) call */
+static unsigned int maxevents = 1;
+
 static pthread_mutex_t thread_lock;
 static unsigned int threads_starting;
 static struct stats throughput_stats;
@@ -137,6 +144,8 @@ static const struct option options[] = {
 	OPT_UINTEGER( 'N', "nested",  &nested,   "Nesting level epoll hierarchy (default is 0, no nesting)"),
 	OPT_BOOLEAN( 'S', "oneshot",  &oneshot,   "Use EPOLLONESHOT semantics"),
 	OPT_BOOLEAN( 'E', "edge",  &et,   "Use Edge-triggered interface (default is LT)"),
+	OPT_BOOLEAN( 'x', "exclusive",  &exclusive,   "Use EPOLLEXCLUSIVE semantics"),
+	OPT_UINTEGER('M', "maxevents", &maxevents, "Events harvested per epoll_wait(2) call (default is 1)"),
 
 	OPT_END()
 };
@@ -181,14 +190,18 @@ static void shuffle(void *array, size_t n, size_t size)
 
 static void *workerfn(void *arg)
 {
-	int fd, ret, r;
+	int fd, ret, r, i;
 	struct worker *w = (struct worker *) arg;
 	unsigned long ops = w->ops;
-	struct epoll_event ev;
+	struct epoll_event ev, *evs;
 	uint64_t val;
 	int to = nonblocking? 0 : -1;
 	int efd = multiq ? w->epollfd : epollfd;
 
+	evs = calloc(maxevents, sizeof(*evs));
+	if (!evs)
+		err(EXIT_FAILURE, "calloc");
+
 	pthread_mutex_lock(&thread_lock);
 	threads_starting--;
 	if (!threads_starting)
@@ -200,38 +213,44 @@ static void *workerfn(void *arg)
 		/*
 		 * Block indefinitely waiting for the IN event.
 		 * In order to stress the epoll_wait(2) syscall,
-		 * call it event per event, instead of a larger
-		 * batch (max)limit.
+		 * call it event per event by default, instead of
+		 * a larger batch (max)limit.
 		 */
 		do {
-			ret = epoll_wait(efd, &ev, 1, to);
+			ret = epoll_wait(efd, evs, maxevents, to);
 		} while (ret < 0 && errno == EINTR);
 		if (ret < 0)
 			err(EXIT_FAILURE, "epoll_wait");
 
-		fd = ev.data.fd;
+		for (i = 0; i < ret; i++) {
+			fd = evs[i].data.fd;
+			ev = evs[i];
 
-		do {
-			r = read(fd, &val, sizeof(val));
-		} while (!done && (r < 0 && errno == EAGAIN));
+			do {
+				r = read(fd, &val, sizeof(val));
+			} while (!done && (r < 0 && errno == EAGAIN));
 
-		if (et) {
-			ev.events = EPOLLIN | EPOLLET;
-			ret = epoll_ctl(efd, EPOLL_CTL_ADD, fd, &ev);
-		}
+			if (et) {
+				ev.events = EPOLLIN | EPOLLET;
+				if (exclusive)
+					ev.events |= EPOLLEXCLUSIVE;
+				epoll_ctl(efd, EPOLL_CTL_ADD, fd, &ev);
+			}
 
-		if (oneshot) {
-			/* rearm the file descriptor with a new event mask */
-			ev.events |= EPOLLIN | EPOLLONESHOT;
-			ret = epoll_ctl(efd, EPOLL_CTL_MOD, fd, &ev);
-		}
+			if (oneshot) {
+				/* rearm the file descriptor with a new event mask */
+				ev.events |= EPOLLIN | EPOLLONESHOT;
+				epoll_ctl(efd, EPOLL_CTL_MOD, fd, &ev);
+			}
 
-		ops++;
+			ops++;
+		}
 	}  while (!done);
 
 	if (multiq)
 		close(w->epollfd);
 
+	free(evs);
 	w->ops = ops;
 	return NULL;
 }
@@ -299,6 +318,8 @@ static int do_threads(struct worker *worker, struct perf_cpu_map *cpu)
 		events |= EPOLLONESHOT;
 	if (et)
 		events |= EPOLLET;
+	if (exclusive)
+		events |= EPOLLEXCLUSIVE;
 
 	printinfo("starting worker/consumer %sthreads%s\n",
 		  noaffinity ?  "":"CPU affinity ",
@@ -425,6 +446,14 @@ int bench_epoll_wait(int argc, const char **argv)
 		exit(EXIT_FAILURE);
 	}
 
+	/* EPOLLEXCLUSIVE can neither be rearmed nor used on epoll fds */
+	if (exclusive && (oneshot || nested)) {
+		usage_with_options(bench_epoll_wait_usage, options);
+		exit(EXIT_FAILURE);
+	}
+	if (!maxevents)
+		maxevents = 1;
+
 	memset(&act, 0, sizeof(act));
 	sigfillset(&act.sa_mask);
 	act.sa_sigaction = toggle_done;
@@ -467,9 +496,11 @@ int bench_epoll_wait(int argc, const char **argv)
 	if (setrlimit(RLIMIT_NOFILE, &rl) < 0)
 		err(EXIT_FAILURE, "setrlimit");
 
-	printf("Run summary [PID %d]: %d threads monitoring%s on "
-	       "%d file-descriptors for %d secs.\n\n",
-	       getpid(), nthreads, oneshot ? " (EPOLLONESHOT semantics)": "", nfds, nsecs);
+	printf("Run summary [PID %d]: %d threads monitoring%s%s on "
+	       "%d file-descriptors for %d secs (%d events per call).\n\n",
+	       getpid(), nthreads, oneshot ? " (EPOLLONESHOT semantics)": "",
+	       exclusive ? " (EPOLLEXCLUSIVE semantics)": "", nfds, nsecs,
+	       maxevents);
 
 	init_stats(&throughput_stats);
 	pthread_mutex_init(&thread_lock, NULL);
@@ -7,6 +7,9 @@
  * This program is particularly useful to measure the latency of nthread wakeups
  * in non-error situations:  all waiters are queued and all wake calls wakeup
  * one or more tasks, and thus the waitqueue is never empty.
+ *
+ * With --latency, also measure the fan-out latency: the time from the first
+ * wake call until the last woken thread is running again.
  */
 
 /* For the CLR_() macros */
@@ -33,10 +36,12 @@
 static u_int32_t futex1 = 0;
 
 static pthread_t *worker;
+static struct timeval *worker_woken;
 static bool done = false;
+static bool measure_latency = false;
 static pthread_mutex_t thread_lock;
 static pthread_cond_t thread_parent, thread_worker;
-static struct stats waketime_stats, wakeup_stats;
+static struct stats waketime_stats, wakeup_stats, wakelat_stats;
 static unsigned int threads_starting;
 static int futex_flag = 0;
 
@@ -54,6 +59,7 @@ static const struct option options[] = {
 	OPT_BOOLEAN( 's', "silent",  &params.silent, "Silent mode: do not display data/details"),
 	OPT_BOOLEAN( 'S', "shared",  &params.fshared, "Use shared futexes instead of private ones"),
 	OPT_BOOLEAN( 'm', "mlockall", &params.mlockall, "Lock all current and future memory"),
+	OPT_BOOLEAN( 'l', "latency", &measure_latency, "Measure the time until the last woken thread runs"),
 
 	OPT_END()
 };
@@ -63,8 +69,10 @@ static const char * const bench_futex_wake_usage[] = {
 	NULL
 };
 
-static void *workerfn(void *arg __maybe_unused)
+static void *workerfn(void *arg)
 {
+	long idx = (long)arg;
+
 	pthread_mutex_lock(&thread_lock);
 	threads_starting--;
 	if (!threads_starting)
@@ -77,6 +85,9 @@ static void *workerfn(void *arg __maybe_unused)
 			break;
 	}
 
+	if (measure_latency)
+		gettimeofday(&worker_woken[idx], NULL);
+
 	pthread_exit(NULL);
 	return NULL;
 }
@@ -92,6 +103,32 @@ static void print_summary(void)
 	       params.nthreads,
 	       waketime_avg / USEC_PER_MSEC,
 	       rel_stddev_stats(waketime_stddev, waketime_avg));
+
+	if (measure_latency) {
+		double wakelat_avg = avg_stats(&wakelat_stats);
+		double wakelat_stddev = stddev_stats(&wakelat_stats);
+
+		printf("Last woken thread running after %.4f ms (+-%.2f%%)\n",
+		       wakelat_avg / USEC_PER_MSEC,
+		       rel_stddev_stats(wakelat_stddev, wakelat_avg));
+	}
+}
+
+/* Time from @start until the last worker got to run again, in usecs */
+static unsigned long last_woken_usecs(struct timeval *start)
+{
+	unsigned long usecs, max = 0;
+	struct timeval delta;
+	unsigned int i;
+
+	for (i = 0; i < params.nthreads; i++) {
+		timersub(&worker_woken[i], start, &delta);
+		usecs = delta.tv_sec * USEC_PER_SEC + delta.tv_usec;
+		if (usecs > max)
+			max = usecs;
+	}
+
+	return max;
 }
 
 static void block_threads(pthread_t *w,
@@ -110,7 +147,7 @@ static void block_threads(pthread_t *w,
 		if (pthread_attr_setaffinity_np(&thread_attr, sizeof(cpu_set_t), &cpuset))
 			err(EXIT_FAILURE, "pthread_attr_setaffinity_np");
 
-		if (pthread_create(&w[i], &thread_attr, workerfn, NULL))
+		if (pthread_create(&w[i], &thread_attr, workerfn, (void *)(long)i))
 			err(EXIT_FAILURE, "pthread_create");
 	}
 }
@@ -157,6 +194,10 @@ int bench_futex_wake(int argc, const char **argv)
 	if (!worker)
 		err(EXIT_FAILURE, "calloc");
 
+	worker_woken = calloc(params.nthreads, sizeof(*worker_woken));
+	if (!worker_woken)
+		err(EXIT_FAILURE, "calloc");
+
 	if (!params.fshared)
 		futex_flag = FUTEX_PRIVATE_FLAG;
 
@@ -167,6 +208,7 @@ int bench_futex_wake(int argc, const char **argv)
 
 	init_stats(&wakeup_stats);
 	init_stats(&waketime_stats);
+	init_stats(&wakelat_stats);
 	pthread_attr_init(&thread_attr);
 	pthread_mutex_init(&thread_lock, NULL);
 	pthread_cond_init(&thread_parent, NULL);
@@ -211,6 +253,15 @@ int bench_futex_wake(int argc, const char **argv)
 				err(EXIT_FAILURE, "pthread_join");
 		}
 
+		if (measure_latency) {
+			unsigned long wakelat = last_woken_usecs(&start);
+
+			update_stats(&wakelat_stats, wakelat);
+			if (!params.silent)
+				printf("[Run %d]: Last woken thread running after %.4f ms\n",
+				       j + 1, wakelat / (double)USEC_PER_MSEC);
+		}
+
 	}
 
 	/* cleanup & report results */
@@ -221,6 +272,7 @@ int bench_futex_wake(int argc, const char **argv)
 
 	print_summary();
 
+	free(worker_woken);
 	free(worker);
 	perf_cpu_map__put(cpu);
 	return ret;
@@ -0,0 +1,350 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * io_uring.c
+ *
+ * io_uring: Benchmarks for io_uring submission and completion throughput
+ *
+ * Every thread sets up its own ring and keeps --depth requests in flight:
+ *  - nop:  IORING_OP_NOP, the cost of the io_uring core alone;
+ *  - read: IORING_OP_READ of a file which stays in the page cache.
+ * The rings are driven with the raw system calls, perf does not link
+ * against liburing.
+ */
+#include <subcmd/parse-options.h>
+#include "../util/string2.h"
+#include "bench.h"
+
+#include <err.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/compiler.h>
+#include <linux/io_uring.h>
+#include <linux/time64.h>
+#include <linux/types.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+
+#ifndef __NR_io_uring_setup
+#define __NR_io_uring_setup	425
+#endif
+#ifndef __NR_io_uring_enter
+#define __NR_io_uring_enter	426
+#endif
+
+static unsigned int nthreads;
+static unsigned int runtime = 5;
+static unsigned int depth = 32;
+static const char *size_str = "16MB";
+static const char *block_str = "4KB";
+
+static const struct option nop_options[] = {
+	OPT_UINTEGER('t', "threads", &nthreads, "Specify amount of threads (default: online CPUs)"),
+	OPT_UINTEGER('r', "runtime", &runtime, "Specify runtime (in seconds)"),
+	OPT_UINTEGER('d', "depth", &depth, "Specify number of requests in flight per thread"),
+	OPT_END()
+};
+
+static const struct option read_options[] = {
+	OPT_UINTEGER('t', "threads", &nthreads, "Specify amount of threads (default: online CPUs)"),
+	OPT_UINTEGER('r', "runtime", &runtime, "Specify runtime (in seconds)"),
+	OPT_UINTEGER('d', "depth", &depth, "Specify number of requests in flight per thread"),
+	OPT_STRING('s', "size", &size_str, "16MB", "Specify size of the file to read (e.g. 1MB, 1GB)"),
+	OPT_STRING('b', "block", &block_str, "4KB", "Specify size of each read"),
+	OPT_END()
+};
+
+static const char * const bench_io_uring_nop_usage[] = {
+	"perf bench io_uring nop <options>",
+	NULL
+};
+
+static const char * const bench_io_uring_read_usage[] = {
+	"perf bench io_uring read <options>",
+	NULL
+};
+
+struct ring {
+	int fd;
+	void *sq;
+	void *cq;
+	size_t sq_len;
+	size_t cq_len;
+	size_t sqes_len;
+	unsigned int *sq_tail;
+	unsigned int *sq_mask;
+	unsigned int *sq_array;
+	unsigned int *cq_head;
+	unsigned int *cq_tail;
+	unsigned int *cq_mask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+};
+
+struct worker {
+	pthread_t thread;
+	unsigned int id;
+	struct ring ring;
+	char *buf;
+	u64 ops;
+};
+
+static int opcode;
+static size_t size;
+static size_t block;
+static int fd = -1;
+static volatile bool done;
+static pthread_barrier_t barrier;
+
+static int ring_setup(struct ring *r, unsigned int entries)
+{
+	struct io_uring_params p;
+	void *sq, *cq;
+
+	memset(&p, 0, sizeof(p));
+	r->fd = syscall(__NR_io_uring_setup, entries, &p);
+	if (r->fd < 0)
+		return -1;
+
+	r->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+	r->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	r->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+
+	sq = mmap(NULL, r->sq_len, PROT_READ | PROT_WRITE,
+		  MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+	cq = mmap(NULL, r->cq_len, PROT_READ | PROT_WRITE,
+		  MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+	r->sqes = mmap(NULL, r->sqes_len, PROT_READ | PROT_WRITE,
+		       MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+	if (sq == MAP_FAILED || cq == MAP_FAILED || r->sqes == MAP_FAILED)
+		return -1;
+
+	r->sq = sq;
+	r->cq = cq;
+
+	r->sq_tail = sq + p.sq_off.tail;
+	r->sq_mask = sq + p.sq_off.ring_mask;
+	r->sq_array = sq + p.sq_off.array;
+	r->cq_head = cq + p.cq_off.head;
+	r->cq_tail = cq + p.cq_off.tail;
+	r->cq_mask = cq + p.cq_off.ring_mask;
+	r->cqes = cq + p.cq_off.cqes;
+	return 0;
+}
+
+static void ring_exit(struct ring *r)
+{
+	munmap(r->sqes, r->sqes_len);
+	munmap(r->cq, r->cq_len);
+	munmap(r->sq, r->sq_len);
+	close(r->fd);
+}
+
+static unsigned int ring_reap(struct ring *r)
+{
+	unsigned int head = *r->cq_head;
+	unsigned int tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+	unsigned int nr = tail - head;
+
+	for (; head != tail; head++) {
+		struct io_uring_cqe *cqe = &r->cqes[head & *r->cq_mask];
+
+		if (cqe->res < 0) {
+			errno = -cqe->res;
+			err(EXIT_FAILURE, "io_uring request");
+		}
+	}
+	__atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+	return nr;
+}
+
+static void *workerfn(void *arg)
+{
+	struct worker *w = arg;
+	struct ring *r = &w->ring;
+	size_t idx = w->id;
+	unsigned int i, inflight;
+
+	pthread_barrier_wait(&barrier);
+
+	while (!done) {
+		unsigned int tail = *r->sq_tail;
+
+		for (i = 0; i < depth; i++, tail++) {
+			unsigned int slot = tail & *r->sq_mask;
+			struct io_uring_sqe *sqe = &r->sqes[slot];
+
+			memset(sqe, 0, sizeof(*sqe));
+			sqe->opcode = opcode;
+			if (opcode == IORING_OP_READ) {
+				sqe->fd = fd;
+				sqe->addr = (unsigned long)(w->buf + i * block);
+				sqe->len = block;
+				sqe->off = (idx % (size / block)) * block;
+				idx += nthreads;
+			}
+			r->sq_array[slot] = slot;
+		}
+		__atomic_store_n(r->sq_tail, tail, __ATOMIC_RELEASE);
+
+		if (syscall(__NR_io_uring_enter, r->fd, depth, depth,
+			    IORING_ENTER_GETEVENTS, NULL, 0) < 0)
+			err(EXIT_FAILURE, "io_uring_enter");
+
+		for (inflight = depth; inflight; ) {
+			inflight -= ring_reap(r);
+			if (inflight &&
+			    syscall(__NR_io_uring_enter, r->fd, 0, inflight,
+				    IORING_ENTER_GETEVENTS, NULL, 0) < 0)
+				err(EXIT_FAILURE, "io_uring_enter");
+		}
+		w->ops += depth;
+	}
+
+	return NULL;
+}
+
+/* write the whole file once, so that reads are served from the page cache */
+static FILE *open_file(void)
+{
+	size_t off;
+	char *buf;
+	FILE *f;
+
+	f = tmpfile();
+	if (!f)
+		err(EXIT_FAILURE, "tmpfile");
+	fd = fileno(f);
+
+	buf = malloc(block);
+	if (!buf)
+		err(EXIT_FAILURE, "malloc");
+	memset(buf, 0xaa, block);
+
+	for (off = 0; off < size; off += block) {
+		if (pwrite(fd, buf, block, off) != (ssize_t)block)
+			err(EXIT_FAILURE, "pwrite");
+	}
+	free(buf);
+	return f;
+}
+
+static int do_run(const char *name)
+{
+	struct worker *workers;
+	struct timeval start, stop, diff;
+	FILE *f = NULL;
+	u64 ops = 0;
+	unsigned int i;
+	double secs;
+
+	if (!depth || !runtime) {
+		fprintf(stderr, "Invalid depth or runtime\n");
+		return 1;
+	}
+
+	if (!nthreads)
+		nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (opcode == IORING_OP_READ)
+		f = open_file();
+	done = false;
+
+	workers = calloc(nthreads, sizeof(*workers));
+	if (!workers)
+		err(EXIT_FAILURE, "calloc");
+
+	pthread_barrier_init(&barrier, NULL, nthreads + 1);
+	for (i = 0; i < nthreads; i++) {
+		workers[i].id = i;
+		if (ring_setup(&workers[i].ring, depth))
+			err(EXIT_FAILURE, "io_uring_setup");
+		if (opcode == IORING_OP_READ) {
+			workers[i].buf = malloc(depth * block);
+			if (!workers[i].buf)
+				err(EXIT_FAILURE, "malloc");
+		}
+
+		if (pthread_create(&workers[i].thread, NULL, workerfn,
+				   &workers[i]))
+			err(EXIT_FAILURE, "pthread_create");
+	}
+
+	gettimeofday(&start, NULL);
+	pthread_barrier_wait(&barrier);
+	sleep(runtime);
+	done = true;
+
+	for (i = 0; i < nthreads; i++) {
+		pthread_join(workers[i].thread, NULL);
+		ops += workers[i].ops;
+		ring_exit(&workers[i].ring);
+		free(workers[i].buf);
+	}
+	gettimeofday(&stop, NULL);
+	timersub(&stop, &start, &diff);
+	pthread_barrier_destroy(&barrier);
+	free(workers);
+	if (f)
+		fclose(f);
+
+	secs = diff.tv_sec + (double)diff.tv_usec / USEC_PER_SEC;
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf("# %u threads, %u %s requests in flight each\n\n",
+		       nthreads, depth, name);
+		printf(" %14s: %lu.%03lu [sec]\n\n", "Total time",
+		       (unsigned long)diff.tv_sec,
+		       (unsigned long)(diff.tv_usec / USEC_PER_MSEC));
+		printf(" %14.0lf IOPS\n", ops / secs);
+		printf(" %14.0lf IOPS (per thread)\n", ops / secs / nthreads);
+		break;
+
+	case BENCH_FORMAT_SIMPLE:
+		/* IOPS and per thread IOPS */
+		printf("%.0lf %.0lf\n", ops / secs, ops / secs / nthreads);
+		break;
+
+	default:
+		/* reaching here is something disaster */
+		fprintf(stderr, "Unknown format:%d\n", bench_format);
+		exit(1);
+		break;
+	}
+
+	return 0;
+}
+
+int bench_io_uring_nop(int argc, const char **argv)
+{
+	argc = parse_options(argc, argv, nop_options, bench_io_uring_nop_usage, 0);
+	if (argc)
+		usage_with_options(bench_io_uring_nop_usage, nop_options);
+
+	opcode = IORING_OP_NOP;
+	return do_run("nop");
+}
+
+int bench_io_uring_read(int argc, const char **argv)
+{
+	argc = parse_options(argc, argv, read_options, bench_io_uring_read_usage, 0);
+	if (argc)
+		usage_with_options(bench_io_uring_read_usage, read_options);
+
+	size = (size_t)perf_atoll(size_str);
+	block = (size_t)perf_atoll(block_str);
+	if ((s64)size <= 0 || (s64)block <= 0 || block > size) {
+		fprintf(stderr, "Invalid size or block size\n");
+		return 1;
+	}
+	size -= size % block;
+
+	opcode = IORING_OP_READ;
+	return do_run("read");
+}
@@ -0,0 +1,205 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * page-cache.c
+ *
+ * page-cache: Benchmark for page cache read/write scaling
+ *
+ * All threads pread() or pwrite() blocks of one shared file which stays in
+ * the page cache, so this measures how the buffered I/O paths and the page
+ * cache lookups behind them scale with threads, not the speed of the disk.
+ */
+#include <subcmd/parse-options.h>
+#include "../util/string2.h"
+#include "bench.h"
+
+#include <err.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/compiler.h>
+#include <linux/time64.h>
+#include <linux/types.h>
+#include <sys/time.h>
+
+static unsigned int nthreads;
+static unsigned int runtime = 5;
+static const char *size_str = "16MB";
+static const char *block_str = "4KB";
+static const char *mode_str = "read";
+
+static const struct option options[] = {
+	OPT_UINTEGER('t', "threads", &nthreads, "Specify amount of threads (default: online CPUs)"),
+	OPT_UINTEGER('r', "runtime", &runtime, "Specify runtime (in seconds)"),
+	OPT_STRING('s', "size", &size_str, "16MB", "Specify size of the shared file (e.g. 1MB, 1GB)"),
+	OPT_STRING('b', "block", &block_str, "4KB", "Specify size of each read or write"),
+	OPT_STRING('m', "mode", &mode_str, "read", "Specify I/O mode: read or write"),
+	OPT_END()
+};
+
+static const char * const bench_page_cache_usage[] = {
+	"perf bench mem page-cache <options>",
+	NULL
+};
+
+struct worker {
+	pthread_t thread;
+	unsigned int id;
+	char *buf;
+	u64 ops;
+};
+
+static bool write_mode;
+static size_t size;
+static size_t block;
+static int fd;
+static volatile bool done;
+static pthread_barrier_t barrier;
+
+static void *workerfn(void *arg)
+{
+	struct worker *w = arg;
+	size_t nr_blocks = size / block;
+	size_t idx = w->id % nr_blocks;
+	ssize_t ret;
+
+	pthread_barrier_wait(&barrier);
+
+	while (!done) {
+		/* threads interleave over the file, so each hits all of it */
+		if (write_mode)
+			ret = pwrite(fd, w->buf, block, idx * block);
+		else
+			ret = pread(fd, w->buf, block, idx * block);
+		if (ret != (ssize_t)block)
+			err(EXIT_FAILURE, write_mode ? "pwrite" : "pread");
+
+		w->ops++;
+		idx += nthreads;
+		if (idx >= nr_blocks)
+			idx %= nr_blocks;
+	}
+
+	return NULL;
+}
+
+/* write the whole file once, so that reads are served from the page cache */
+static void fill_file(void)
+{
+	size_t off;
+	char *buf;
+
+	buf = malloc(block);
+	if (!buf)
+		err(EXIT_FAILURE, "malloc");
+	memset(buf, 0xaa, block);
+
+	for (off = 0; off < size; off += block) {
+		if (pwrite(fd, buf, block, off) != (ssize_t)block)
+			err(EXIT_FAILURE, "pwrite");
+	}
+	free(buf);
+}
+
+int bench_mem_page_cache(int argc, const char **argv)
+{
+	struct worker *workers;
+	struct timeval start, stop, diff;
+	u64 ops = 0;
+	unsigned int i;
+	double secs;
+	FILE *f;
+
+	argc = parse_options(argc, argv, options, bench_page_cache_usage, 0);
+	if (argc)
+		usage_with_options(bench_page_cache_usage, options);
+
+	if (!strcmp(mode_str, "read"))
+		write_mode = false;
+	else if (!strcmp(mode_str, "write"))
+		write_mode = true;
+	else
+		usage_with_options(bench_page_cache_usage, options);
+
+	size = (size_t)perf_atoll(size_str);
+	block = (size_t)perf_atoll(block_str);
+	if ((s64)size <= 0 || (s64)block <= 0 || block > size || !runtime) {
+		fprintf(stderr, "Invalid size, block size or runtime\n");
+		return 1;
+	}
+	size -= size % block;
+
+	if (!nthreads)
+		nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+
+	f = tmpfile();
+	if (!f)
+		err(EXIT_FAILURE, "tmpfile");
+	fd = fileno(f);
+	fill_file();
+	done = false;
+
+	workers = calloc(nthreads, sizeof(*workers));
+	if (!workers)
+		err(EXIT_FAILURE, "calloc");
+
+	pthread_barrier_init(&barrier, NULL, nthreads + 1);
+	for (i = 0; i < nthreads; i++) {
+		workers[i].id = i;
+		workers[i].buf = malloc(block);
+		if (!workers[i].buf)
+			err(EXIT_FAILURE, "malloc");
+		memset(workers[i].buf, 0x55, block);
+
+		if (pthread_create(&workers[i].thread, NULL, workerfn,
+				   &workers[i]))
+			err(EXIT_FAILURE, "pthread_create");
+	}
+
+	gettimeofday(&start, NULL);
+	pthread_barrier_wait(&barrier);
+	sleep(runtime);
+	done = true;
+
+	for (i = 0; i < nthreads; i++) {
+		pthread_join(workers[i].thread, NULL);
+		ops += workers[i].ops;
+		free(workers[i].buf);
+	}
+	gettimeofday(&stop, NULL);
+	timersub(&stop, &start, &diff);
+	pthread_barrier_destroy(&barrier);
+	free(workers);
+	fclose(f);
+
+	secs = diff.tv_sec + (double)diff.tv_usec / USEC_PER_SEC;
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf("# %u threads, %s of %zu bytes from a %zu bytes file\n\n",
+		       nthreads, mode_str, block, size);
+		printf(" %14s: %lu.%03lu [sec]\n\n", "Total time",
+		       (unsigned long)diff.tv_sec,
+		       (unsigned long)(diff.tv_usec / USEC_PER_MSEC));
+		printf(" %14.0lf ops/sec\n", ops / secs);
+		printf(" %14.0lf ops/sec (per thread)\n", ops / secs / nthreads);
+		printf(" %14.3lf MB/sec\n", ops * block / secs / (1 << 20));
+		break;
+
+	case BENCH_FORMAT_SIMPLE:
+		/* ops/sec, per thread ops/sec and MB/sec */
+		printf("%.0lf %.0lf %.3lf\n", ops / secs, ops / secs / nthreads,
+		       ops * block / secs / (1 << 20));
+		break;
+
+	default:
+		/* reaching here is something disaster */
+		fprintf(stderr, "Unknown format:%d\n", bench_format);
+		exit(1);
+		break;
+	}
+
+	return 0;
+}
@@ -0,0 +1,220 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * page-fault.c
+ *
+ * page-fault: Benchmark for parallel page fault throughput
+ *
+ * Every thread repeatedly maps a private region, touches each page of it
+ * and unmaps it again. All threads share one mm, so this measures the
+ * scalability of the fault path, of the mmap/munmap paths and of the TLB
+ * shootdowns munmap has to do while other threads run.
+ */
+#include <subcmd/parse-options.h>
+#include "../util/string2.h"
+#include "bench.h"
+
+#include <err.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/compiler.h>
+#include <linux/time64.h>
+#include <linux/types.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+
+static unsigned int nthreads;
+static unsigned int loops = 10;
+static const char *size_str = "4MB";
+static const char *type_str = "anon";
+
+static const struct option options[] = {
+	OPT_UINTEGER('t', "threads", &nthreads, "Specify amount of threads (default: online CPUs)"),
+	OPT_UINTEGER('l', "loop", &loops, "Specify number of map/touch/unmap loops per thread"),
+	OPT_STRING('s', "size", &size_str, "4MB", "Specify size of the region each thread maps (e.g. 4KB, 1MB, 1GB)"),
+	OPT_STRING('T', "type", &type_str, "anon", "Specify region type: anon, file or thp"),
+	OPT_END()
+};
+
+static const char * const bench_page_fault_usage[] = {
+	"perf bench mem page-fault <options>",
+	NULL
+};
+
+enum region_type {
+	REGION_ANON,
+	REGION_FILE,
+	REGION_THP,
+};
+
+struct worker {
+	pthread_t thread;
+	int fd;
+	u64 fault_usec;
+	u64 unmap_usec;
+};
+
+static enum region_type type;
+static size_t size;
+static long page_size;
+static pthread_barrier_t barrier;
+
+static u64 usec_since(const struct timeval *start)
+{
+	struct timeval now, diff;
+
+	gettimeofday(&now, NULL);
+	timersub(&now, start, &diff);
+	return diff.tv_sec * USEC_PER_SEC + diff.tv_usec;
+}
+
+static void *workerfn(void *arg)
+{
+	struct worker *w = arg;
+	unsigned int i;
+
+	pthread_barrier_wait(&barrier);
+
+	for (i = 0; i < loops; i++) {
+		struct timeval start;
+		char *p;
+		size_t off;
+
+		gettimeofday(&start, NULL);
+		if (type == REGION_FILE)
+			p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+				 w->fd, 0);
+		else
+			p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+				 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (p == MAP_FAILED)
+			err(EXIT_FAILURE, "mmap");
+		if (type == REGION_THP)
+			madvise(p, size, MADV_HUGEPAGE);
+
+		for (off = 0; off < size; off += page_size)
+			p[off] = 1;
+		w->fault_usec += usec_since(&start);
+
+		gettimeofday(&start, NULL);
+		if (munmap(p, size))
+			err(EXIT_FAILURE, "munmap");
+		w->unmap_usec += usec_since(&start);
+	}
+
+	return NULL;
+}
+
+static int worker_open_file(struct worker *w)
+{
+	FILE *f = tmpfile();
+
+	if (!f)
+		return -1;
+	w->fd = dup(fileno(f));
+	fclose(f);
+	if (w->fd < 0)
+		return -1;
+	return ftruncate(w->fd, size);
+}
+
+int bench_mem_page_fault(int argc, const char **argv)
+{
+	struct worker *workers;
+	u64 fault_usec = 0, unmap_usec = 0, pages;
+	struct timeval start, stop, diff;
+	unsigned int i;
+	double secs;
+
+	argc = parse_options(argc, argv, options, bench_page_fault_usage, 0);
+	if (argc)
+		usage_with_options(bench_page_fault_usage, options);
+
+	if (!strcmp(type_str, "anon"))
+		type = REGION_ANON;
+	else if (!strcmp(type_str, "file"))
+		type = REGION_FILE;
+	else if (!strcmp(type_str, "thp"))
+		type = REGION_THP;
+	else
+		usage_with_options(bench_page_fault_usage, options);
+
+	size = (size_t)perf_atoll(size_str);
+	page_size = sysconf(_SC_PAGESIZE);
+	if ((s64)size <= 0 || !loops) {
+		fprintf(stderr, "Invalid size or loop count\n");
+		return 1;
+	}
+	size = (size + page_size - 1) & ~(page_size - 1);
+
+	if (!nthreads)
+		nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+
+	workers = calloc(nthreads, sizeof(*workers));
+	if (!workers)
+		err(EXIT_FAILURE, "calloc");
+
+	for (i = 0; i < nthreads; i++) {
+		workers[i].fd = -1;
+		if (type == REGION_FILE && worker_open_file(&workers[i]))
+			err(EXIT_FAILURE, "tmpfile");
+	}
+
+	pthread_barrier_init(&barrier, NULL, nthreads + 1);
+	for (i = 0; i < nthreads; i++) {
+		if (pthread_create(&workers[i].thread, NULL, workerfn,
+				   &workers[i]))
+			err(EXIT_FAILURE, "pthread_create");
+	}
+
+	gettimeofday(&start, NULL);
+	pthread_barrier_wait(&barrier);
+	for (i = 0; i < nthreads; i++) {
+		pthread_join(workers[i].thread, NULL);
+		fault_usec += workers[i].fault_usec;
+		unmap_usec += workers[i].unmap_usec;
+		if (workers[i].fd >= 0)
+			close(workers[i].fd);
+	}
+	gettimeofday(&stop, NULL);
+	timersub(&stop, &start, &diff);
+	pthread_barrier_destroy(&barrier);
+	free(workers);
+
+	pages = (u64)nthreads * loops * (size / page_size);
+	secs = diff.tv_sec + (double)diff.tv_usec / USEC_PER_SEC;
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf("# %u threads, %u loops of %zu bytes (%s) each\n\n",
+		       nthreads, loops, size, type_str);
+		printf(" %14s: %lu.%03lu [sec]\n\n", "Total time",
+		       (unsigned long)diff.tv_sec,
+		       (unsigned long)(diff.tv_usec / USEC_PER_MSEC));
+		printf(" %14.0lf pages touched/sec\n", pages / secs);
+		printf(" %14.3lf usecs/page touch (per thread)\n",
+		       (double)fault_usec / pages);
+		printf(" %14.3lf usecs/munmap (per thread)\n",
+		       (double)unmap_usec / ((u64)nthreads * loops));
+		break;
+
+	case BENCH_FORMAT_SIMPLE:
+		/* pages/sec, usecs per touch and per munmap */
+		printf("%.0lf %.3lf %.3lf\n", pages / secs,
+		       (double)fault_usec / pages,
+		       (double)unmap_usec / ((u64)nthreads * loops));
+		break;
+
+	default:
+		/* reaching here is something disaster */
+		fprintf(stderr, "Unknown format:%d\n", bench_format);
+		exit(1);
+		break;
+	}
+
+	return 0;
+}
@@ -35,6 +35,7 @@ static bool use_pipes = false;
 static unsigned int nr_loops = 100;
 static bool thread_mode = false;
 static unsigned int num_groups = 10;
+static unsigned int num_fds = 20;
 
 struct sender_context {
 	unsigned int num_fds;
@@ -190,7 +191,6 @@ static void reap_worker(pthread_t id)
 
 /* One group of senders and receivers */
 static unsigned int group(pthread_t *pth,
-		unsigned int num_fds,
 		int ready_out,
 		int wakefd)
 {
@@ -249,6 +249,7 @@ static const struct option options[] = {
 	OPT_BOOLEAN('t', "thread", &thread_mode,
 		    "Be multi thread instead of multi process"),
 	OPT_UINTEGER('g', "group", &num_groups, "Specify number of groups"),
+	OPT_UINTEGER('f', "fds", &num_fds, "Specify number of senders and receivers per group (default: 20)"),
 	OPT_UINTEGER('l', "nr_loops", &nr_loops, "Specify the number of loops to run (default: 100)"),
 	OPT_END()
 };
@@ -262,7 +263,6 @@ int bench_sched_messaging(int argc, const char **argv)
 {
 	unsigned int i, total_children;
 	struct timeval start, stop, diff;
-	unsigned int num_fds = 20;
 	int readyfds[2], wakefds[2];
 	char dummy;
 	pthread_t *pth_tab;
@@ -270,6 +270,9 @@ int bench_sched_messaging(int argc, const char **argv)
 	argc = parse_options(argc, argv, options,
 			     bench_sched_message_usage, 0);
 
+	if (!num_fds)
+		errx(EXIT_FAILURE, "number of fds per group must be non-zero");
+
 	pth_tab = malloc(num_fds * 2 * num_groups * sizeof(pthread_t));
 	if (!pth_tab)
 		err(EXIT_FAILURE, "main:malloc()");
@@ -279,7 +282,7 @@ int bench_sched_messaging(int argc, const char **argv)
 
 	total_children = 0;
 	for (i = 0; i < num_groups; i++)
-		total_children += group(pth_tab+total_children, num_fds,
+		total_children += group(pth_tab+total_children,
 					readyfds[1], wakefds[0]);
 
 	/* Wait for everyone to be ready */
@@ -0,0 +1,301 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * tcp-loopback.c
+ *
+ * tcp-loopback: Benchmarks for TCP over the loopback device
+ *
+ * Every pair of threads shares one TCP connection over 127.0.0.1:
+ *  - rr:     the client sends a message and waits for the server to send it
+ *            back, which measures the latency of a request/response;
+ *  - stream: the client keeps sending and the server keeps receiving, which
+ *            measures the bulk throughput of the stack.
+ * No NIC is involved, so this is the cost of the TCP/IP stack itself.
+ */
+#include <subcmd/parse-options.h>
+#include "../util/string2.h"
+#include "bench.h"
+
+#include <err.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <linux/compiler.h>
+#include <linux/time64.h>
+#include <linux/types.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+static unsigned int npairs = 1;
+static unsigned int runtime = 5;
+static const char *rr_size_str = "1";
+static const char *stream_size_str = "64KB";
+
+static const struct option rr_options[] = {
+	OPT_UINTEGER('p', "pairs", &npairs, "Specify amount of client/server thread pairs"),
+	OPT_UINTEGER('r', "runtime", &runtime, "Specify runtime (in seconds)"),
+	OPT_STRING('s', "size", &rr_size_str, "1", "Specify size of the request and of the response"),
+	OPT_END()
+};
+
+static const struct option stream_options[] = {
+	OPT_UINTEGER('p', "pairs", &npairs, "Specify amount of client/server thread pairs"),
+	OPT_UINTEGER('r', "runtime", &runtime, "Specify runtime (in seconds)"),
+	OPT_STRING('s', "size", &stream_size_str, "64KB", "Specify size of each send"),
+	OPT_END()
+};
+
+static const char * const bench_tcp_rr_usage[] = {
+	"perf bench net tcp-rr <options>",
+	NULL
+};
+
+static const char * const bench_tcp_stream_usage[] = {
+	"perf bench net tcp-stream <options>",
+	NULL
+};
+
+struct pair {
+	pthread_t client;
+	pthread_t server;
+	int client_fd;
+	int server_fd;
+	char *client_buf;
+	char *server_buf;
+	u64 trans;
+	u64 bytes;
+};
+
+static bool rr;
+static size_t size;
+static volatile bool done;
+static pthread_barrier_t barrier;
+
+/* returns false once the peer went away */
+static bool recv_full(int fd, char *buf, size_t len)
+{
+	while (len) {
+		ssize_t ret = recv(fd, buf, len, 0);
+
+		if (ret <= 0)
+			return false;
+		buf += ret;
+		len -= ret;
+	}
+	return true;
+}
+
+static bool send_full(int fd, const char *buf, size_t len)
+{
+	while (len) {
+		ssize_t ret = send(fd, buf, len, MSG_NOSIGNAL);
+
+		if (ret <= 0)
+			return false;
+		buf += ret;
+		len -= ret;
+	}
+	return true;
+}
+
+static void *clientfn(void *arg)
+{
+	struct pair *p = arg;
+
+	pthread_barrier_wait(&barrier);
+
+	while (!done) {
+		if (!send_full(p->client_fd, p->client_buf, size))
+			break;
+		if (rr) {
+			if (!recv_full(p->client_fd, p->client_buf, size))
+				break;
+			p->trans++;
+		}
+	}
+
+	return NULL;
+}
+
+static void *serverfn(void *arg)
+{
+	struct pair *p = arg;
+	ssize_t ret;
+
+	pthread_barrier_wait(&barrier);
+
+	if (rr) {
+		while (recv_full(p->server_fd, p->server_buf, size) &&
+		       send_full(p->server_fd, p->server_buf, size))
+			;
+		return NULL;
+	}
+
+	/* count what was received, that is what made it through the stack */
+	while ((ret = recv(p->server_fd, p->server_buf, size, 0)) > 0)
+		p->bytes += ret;
+
+	return NULL;
+}
+
+static void pair_connect(struct pair *p, int listen_fd,
+			 const struct sockaddr_in *addr)
+{
+	int one = 1;
+
+	p->client_fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (p->client_fd < 0)
+		err(EXIT_FAILURE, "socket");
+	if (connect(p->client_fd, (const struct sockaddr *)addr, sizeof(*addr)))
+		err(EXIT_FAILURE, "connect");
+
+	p->server_fd = accept(listen_fd, NULL, NULL);
+	if (p->server_fd < 0)
+		err(EXIT_FAILURE, "accept");
+
+	/* do not let Nagle batch the small requests of the rr test */
+	if (rr) {
+		setsockopt(p->client_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+		setsockopt(p->server_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	}
+
+	p->client_buf = calloc(1, size);
+	p->server_buf = calloc(1, size);
+	if (!p->client_buf || !p->server_buf)
+		err(EXIT_FAILURE, "calloc");
+}
+
+static int do_run(const char *name)
+{
+	struct sockaddr_in addr;
+	socklen_t addrlen = sizeof(addr);
+	struct timeval start, stop, diff;
+	struct pair *pairs;
+	u64 trans = 0, bytes = 0;
+	unsigned int i;
+	int listen_fd;
+	double secs;
+
+	if ((s64)size <= 0 || !npairs || !runtime) {
+		fprintf(stderr, "Invalid size, pair count or runtime\n");
+		return 1;
+	}
+
+	listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (listen_fd < 0)
+		err(EXIT_FAILURE, "socket");
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = 0;
+	if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) ||
+	    listen(listen_fd, npairs) ||
+	    getsockname(listen_fd, (struct sockaddr *)&addr, &addrlen))
+		err(EXIT_FAILURE, "listen");
+
+	pairs = calloc(npairs, sizeof(*pairs));
+	if (!pairs)
+		err(EXIT_FAILURE, "calloc");
+
+	done = false;
+	pthread_barrier_init(&barrier, NULL, 2 * npairs + 1);
+	for (i = 0; i < npairs; i++) {
+		pair_connect(&pairs[i], listen_fd, &addr);
+
+		if (pthread_create(&pairs[i].server, NULL, serverfn, &pairs[i]) ||
+		    pthread_create(&pairs[i].client, NULL, clientfn, &pairs[i]))
+			err(EXIT_FAILURE, "pthread_create");
+	}
+	close(listen_fd);
+
+	gettimeofday(&start, NULL);
+	pthread_barrier_wait(&barrier);
+	sleep(runtime);
+	done = true;
+	gettimeofday(&stop, NULL);
+	timersub(&stop, &start, &diff);
+
+	/* wake up both ends of every connection */
+	for (i = 0; i < npairs; i++)
+		shutdown(pairs[i].client_fd, SHUT_RDWR);
+
+	for (i = 0; i < npairs; i++) {
+		pthread_join(pairs[i].client, NULL);
+		pthread_join(pairs[i].server, NULL);
+		trans += pairs[i].trans;
+		bytes += pairs[i].bytes;
+		close(pairs[i].client_fd);
+		close(pairs[i].server_fd);
+		free(pairs[i].client_buf);
+		free(pairs[i].server_buf);
+	}
+	pthread_barrier_destroy(&barrier);
+	free(pairs);
+
+	secs = diff.tv_sec + (double)diff.tv_usec / USEC_PER_SEC;
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf("# %u connections, %s with %zu bytes messages\n\n",
+		       npairs, name, size);
+		printf(" %14s: %lu.%03lu [sec]\n\n", "Total time",
+		       (unsigned long)diff.tv_sec,
+		       (unsigned long)(diff.tv_usec / USEC_PER_MSEC));
+		if (rr) {
+			printf(" %14.0lf transactions/sec\n", trans / secs);
+			printf(" %14.3lf usecs/transaction (per connection)\n",
+			       trans ? secs * USEC_PER_SEC * npairs / trans : 0);
+		} else {
+			printf(" %14.3lf MB/sec\n", bytes / secs / (1 << 20));
+			printf(" %14.3lf MB/sec (per connection)\n",
+			       bytes / secs / (1 << 20) / npairs);
+		}
+		break;
+
+	case BENCH_FORMAT_SIMPLE:
+		/* transactions/sec and usecs per transaction, or MB/sec */
+		if (rr)
+			printf("%.0lf %.3lf\n", trans / secs,
+			       trans ? secs * USEC_PER_SEC * npairs / trans : 0);
+		else
+			printf("%.3lf\n", bytes / secs / (1 << 20));
+		break;
+
+	default:
+		/* reaching here is something disaster */
+		fprintf(stderr, "Unknown format:%d\n", bench_format);
+		exit(1);
+		break;
+	}
+
+	return 0;
+}
+
+int bench_net_tcp_rr(int argc, const char **argv)
+{
+	argc = parse_options(argc, argv, rr_options, bench_tcp_rr_usage, 0);
+	if (argc)
+		usage_with_options(bench_tcp_rr_usage, rr_options);
+
+	rr = true;
+	size = (size_t)perf_atoll(rr_size_str);
+	return do_run("request/response");
+}
+
+int bench_net_tcp_stream(int argc, const char **argv)
+{
+	argc = parse_options(argc, argv, stream_options, bench_tcp_stream_usage, 0);
+	if (argc)
+		usage_with_options(bench_tcp_stream_usage, stream_options);
+
+	rr = false;
+	size = (size_t)perf_atoll(stream_size_str);
+	return do_run("stream");
+}
@@ -16,6 +16,8 @@
  *  numa  ... NUMA scheduling and MM performance
  *  futex ... Futex performance
  *  epoll ... Event poll performance
+ *  io_uring ... io_uring submission and completion performance
+ *  net   ... Loopback TCP performance
  */
 #include <subcmd/parse-options.h>
 #include "builtin.h"
@@ -61,6 +63,8 @@ static struct bench mem_benchmarks[] = {
 	{ "memcpy",	"Benchmark for memcpy() functions",		bench_mem_memcpy	},
 	{ "memset",	"Benchmark for memset() functions",		bench_mem_memset	},
 	{ "find_bit",	"Benchmark for find_bit() functions",		bench_mem_find_bit	},
+	{ "page-fault",	"Benchmark for parallel page faults and munmap",	bench_mem_page_fault	},
+	{ "page-cache",	"Benchmark for page cache read/write scaling",	bench_mem_page_cache	},
 	{ "all",	"Run all memory access benchmarks",		NULL			},
 	{ NULL,		NULL,						NULL			}
 };
@@ -85,6 +89,20 @@ static struct bench epoll_benchmarks[] = {
 };
 #endif // HAVE_EVENTFD_SUPPORT
 
+static struct bench io_uring_benchmarks[] = {
+	{ "nop",	"Benchmark for io_uring NOP requests",		bench_io_uring_nop	},
+	{ "read",	"Benchmark for io_uring reads from the page cache",	bench_io_uring_read	},
+	{ "all",	"Run all io_uring benchmarks",			NULL			},
+	{ NULL,		NULL,						NULL			}
+};
+
+static struct bench net_benchmarks[] = {
+	{ "tcp-rr",	"Benchmark for loopback TCP request/response",	bench_net_tcp_rr	},
+	{ "tcp-stream",	"Benchmark for loopback TCP streaming",		bench_net_tcp_stream	},
+	{ "all",	"Run all network benchmarks",			NULL			},
+	{ NULL,		NULL,						NULL			}
+};
+
 static struct bench internals_benchmarks[] = {
 	{ "synthesize", "Benchmark perf event synthesis",	bench_synthesize	},
 	{ "kallsyms-parse", "Benchmark kallsyms parsing",	bench_kallsyms_parse	},
@@ -110,6 +128,8 @@ static struct collection collections[] = {
 #ifdef HAVE_EVENTFD_SUPPORT
 	{"epoll",       "Epoll stressing benchmarks",                   epoll_benchmarks        },
 #endif
+	{ "io_uring",	"io_uring benchmarks",				io_uring_benchmarks	},
+	{ "net",	"Loopback networking benchmarks",		net_benchmarks		},
 	{ "internals",	"Perf-internals benchmarks",			internals_benchmarks	},
 	{ "all",	"All benchmarks",				NULL			},
 	{ NULL,		NULL,						NULL			}
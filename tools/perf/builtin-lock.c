@@ -9,6 +9,10 @@
 #include "util/symbol.h"
 #include "util/thread.h"
 #include "util/header.h"
+#include "util/target.h"
+#include "util/callchain.h"
+#include "util/lock-contention.h"
+#include "util/map.h"
 
 #include <subcmd/pager.h>
 #include <subcmd/parse-options.h>
@@ -25,14 +29,21 @@
 #include <pthread.h>
 #include <math.h>
 #include <limits.h>
+#include <signal.h>
+#include <unistd.h>
 
 #include <linux/list.h>
 #include <linux/hash.h>
 #include <linux/kernel.h>
 #include <linux/zalloc.h>
 #include <linux/err.h>
+#include <linux/string.h>
+#include <linux/time64.h>
 
 static struct perf_session *session;
+static struct target target = {
+	.uid = UINT_MAX,
+};
 
 /* based on kernel/lockdep.c */
 #define LOCKHASH_BITS		12
@@ -43,35 +54,6 @@ static struct list_head lockhash_table[LOCKHASH_SIZE];
 #define __lockhashfn(key)	hash_long((unsigned long)key, LOCKHASH_BITS)
 #define lockhashentry(key)	(lockhash_table + __lockhashfn((key)))
 
-struct lock_stat {
-	struct list_head	hash_entry;
-	struct rb_node		rb;		/* used for sorting */
-
-	/*
-	 * FIXME: evsel__intval() returns u64,
-	 * so address of lockdep_map should be treated as 64bit.
-	 * Is there more better solution?
-	 */
-	void			*addr;		/* address of lockdep_map, used as ID */
-	char			*name;		/* for strcpy(), we cannot use const */
-
-	unsigned int		nr_acquire;
-	unsigned int		nr_acquired;
-	unsigned int		nr_contended;
-	unsigned int		nr_release;
-
-	unsigned int		nr_readlock;
-	unsigned int		nr_trylock;
-
-	/* these times are in nano sec. */
-	u64                     avg_wait_time;
-	u64			wait_time_total;
-	u64			wait_time_min;
-	u64			wait_time_max;
-
-	int			discard; /* flag of blacklist */
-};
-
 /*
  * States of lock_seq_stat
  *
@@ -109,6 +91,7 @@ struct lock_seq_stat {
 	void                    *addr;
 
 	int                     read_count;
+	struct lock_stat	*contended;	/* caller of contention_begin */
 };
 
 struct thread_stat {
@@ -359,6 +342,12 @@ struct trace_lock_handler {
 
 	int (*release_event)(struct evsel *evsel,
 			     struct perf_sample *sample);
+
+	int (*contention_begin_event)(struct evsel *evsel,
+				      struct perf_sample *sample);
+
+	int (*contention_end_event)(struct evsel *evsel,
+				    struct perf_sample *sample);
 };
 
 static struct lock_seq_stat *get_seq(struct thread_stat *ts, void *addr)
@@ -655,6 +644,210 @@ static struct trace_lock_handler report_lock_ops  = {
 	.release_event		= report_lock_release_event,
 };
 
+static u64 sched_text_start;
+static u64 sched_text_end;
+static u64 lock_text_start;
+static u64 lock_text_end;
+
+static u64 kernel_symbol_addr(struct machine *machine, const char *name)
+{
+	struct map *kmap;
+	struct symbol *sym;
+
+	sym = machine__find_kernel_symbol_by_name(machine, name, &kmap);
+	if (!sym)
+		return 0;
+
+	return kmap->unmap_ip(kmap, sym->start);
+}
+
+bool is_lock_function(struct machine *machine, u64 addr)
+{
+	if (!sched_text_start) {
+		sched_text_start = kernel_symbol_addr(machine, "__sched_text_start");
+		sched_text_end = kernel_symbol_addr(machine, "__sched_text_end");
+		lock_text_start = kernel_symbol_addr(machine, "__lock_text_start");
+		lock_text_end = kernel_symbol_addr(machine, "__lock_text_end");
+
+		/* to avoid retry */
+		if (!sched_text_start)
+			sched_text_start = 1;
+	}
+
+	/* mutex, rwsem and rtmutex functions are in sched text section */
+	if (sched_text_start <= addr && addr < sched_text_end)
+		return true;
+
+	/* spinlock functions are in lock text section */
+	if (lock_text_start <= addr && addr < lock_text_end)
+		return true;
+
+	return false;
+}
+
+/*
+ * Find the first function in the callchain which is not a lock function
+ * and print it to @buf.  Returns its address, or 0 when the sample has no
+ * usable callchain.
+ */
+static u64 lock_contention_caller(struct evsel *evsel, struct perf_sample *sample,
+				  char *buf, int size)
+{
+	struct thread *thread;
+	struct callchain_cursor *cursor = &callchain_cursor;
+	struct machine *machine = &session->machines.host;
+	int ret;
+
+	if (!sample->callchain)
+		return 0;
+
+	thread = machine__findnew_thread(machine, -1, sample->pid);
+	if (thread == NULL)
+		return 0;
+
+	ret = thread__resolve_callchain(thread, cursor, evsel, sample,
+					NULL, NULL, CONTENTION_STACK_DEPTH);
+	thread__put(thread);
+	if (ret != 0)
+		return 0;
+
+	callchain_cursor_commit(cursor);
+
+	while (true) {
+		struct callchain_cursor_node *node;
+		struct symbol *sym;
+
+		node = callchain_cursor_current(cursor);
+		if (node == NULL)
+			break;
+
+		sym = node->ms.sym;
+		if (sym && !is_lock_function(machine, node->ip)) {
+			struct map *map = node->ms.map;
+			u64 offset;
+
+			offset = map->map_ip(map, node->ip) - sym->start;
+
+			if (offset)
+				scnprintf(buf, size, "%s+%#" PRIx64, sym->name, offset);
+			else
+				scnprintf(buf, size, "%s", sym->name);
+			return node->ip;
+		}
+
+		callchain_cursor_advance(cursor);
+	}
+	return 0;
+}
+
+static int report_lock_contention_begin_event(struct evsel *evsel,
+					      struct perf_sample *sample)
+{
+	void *addr;
+	struct lock_stat *ls;
+	struct thread_stat *ts;
+	struct lock_seq_stat *seq;
+	u64 tmp = evsel__intval(evsel, sample, "lock_addr");
+	unsigned int flags = evsel__intval(evsel, sample, "flags");
+	char buf[128];
+	u64 caller;
+
+	memcpy(&addr, &tmp, sizeof(void *));
+
+	/* aggregate by the caller, or by the lock without callchains */
+	caller = lock_contention_caller(evsel, sample, buf, sizeof(buf));
+	if (!caller) {
+		caller = tmp;
+		scnprintf(buf, sizeof(buf), "%#" PRIx64, tmp);
+	}
+
+	ls = lock_stat_findnew((void *)(unsigned long)caller, buf);
+	if (!ls)
+		return -ENOMEM;
+	if (!ls->flags)
+		ls->flags = flags;
+
+	ts = thread_stat_findnew(sample->tid);
+	if (!ts)
+		return -ENOMEM;
+
+	seq = get_seq(ts, addr);
+	if (!seq)
+		return -ENOMEM;
+
+	switch (seq->state) {
+	case SEQ_STATE_UNINITIALIZED:
+		break;
+	case SEQ_STATE_CONTENDED:
+		/*
+		 * A mutex emits a second begin when it stops spinning and
+		 * goes to sleep.  Keep the time of the first one.
+		 */
+		return 0;
+	default:
+		BUG_ON("Unknown state of lock sequence found!\n");
+		break;
+	}
+
+	seq->state = SEQ_STATE_CONTENDED;
+	seq->contended = ls;
+	seq->prev_event_time = sample->time;
+	return 0;
+}
+
+static int report_lock_contention_end_event(struct evsel *evsel,
+					    struct perf_sample *sample)
+{
+	void *addr;
+	struct lock_stat *ls;
+	struct thread_stat *ts;
+	struct lock_seq_stat *seq;
+	u64 contended_term;
+	u64 tmp = evsel__intval(evsel, sample, "lock_addr");
+
+	memcpy(&addr, &tmp, sizeof(void *));
+
+	ts = thread_stat_findnew(sample->tid);
+	if (!ts)
+		return -ENOMEM;
+
+	seq = get_seq(ts, addr);
+	if (!seq)
+		return -ENOMEM;
+
+	switch (seq->state) {
+	case SEQ_STATE_UNINITIALIZED:
+		/* orphan event, the begin was before the recording */
+		goto free_seq;
+	case SEQ_STATE_CONTENDED:
+		break;
+	default:
+		BUG_ON("Unknown state of lock sequence found!\n");
+		break;
+	}
+
+	ls = seq->contended;
+	contended_term = sample->time - seq->prev_event_time;
+	ls->nr_contended++;
+	ls->wait_time_total += contended_term;
+	if (contended_term < ls->wait_time_min)
+		ls->wait_time_min = contended_term;
+	if (ls->wait_time_max < contended_term)
+		ls->wait_time_max = contended_term;
+	ls->avg_wait_time = ls->wait_time_total / ls->nr_contended;
+
+free_seq:
+	list_del_init(&seq->list);
+	free(seq);
+	return 0;
+}
+
+/* lock contention handlers, for lock:contention_begin/end */
+static struct trace_lock_handler contention_lock_ops  = {
+	.contention_begin_event	= report_lock_contention_begin_event,
+	.contention_end_event	= report_lock_contention_end_event,
+};
+
 static struct trace_lock_handler *trace_handler;
 
 static int evsel__process_lock_acquire(struct evsel *evsel, struct perf_sample *sample)
@@ -685,6 +878,20 @@ static int evsel__process_lock_release(struct evsel *evsel, struct perf_sample *
 	return 0;
 }
 
+static int evsel__process_contention_begin(struct evsel *evsel, struct perf_sample *sample)
+{
+	if (trace_handler->contention_begin_event)
+		return trace_handler->contention_begin_event(evsel, sample);
+	return 0;
+}
+
+static int evsel__process_contention_end(struct evsel *evsel, struct perf_sample *sample)
+{
+	if (trace_handler->contention_end_event)
+		return trace_handler->contention_end_event(evsel, sample);
+	return 0;
+}
+
 static void print_bad_events(int bad, int total)
 {
 	/* Output for debug, this have to be removed */
@@ -754,6 +961,72 @@ static void print_result(void)
 	print_bad_events(bad, total);
 }
 
+/* should match the LCB_F_* flags in include/trace/events/lock.h */
+#define LCB_F_SPIN	(1U << 0)
+#define LCB_F_READ	(1U << 1)
+#define LCB_F_WRITE	(1U << 2)
+#define LCB_F_RT	(1U << 3)
+#define LCB_F_PERCPU	(1U << 4)
+#define LCB_F_MUTEX	(1U << 5)
+
+static const struct {
+	unsigned int flags;
+	const char *name;
+} lock_type_table[] = {
+	{ LCB_F_SPIN,			"spinlock" },
+	{ LCB_F_SPIN | LCB_F_READ,	"rwlock:R" },
+	{ LCB_F_SPIN | LCB_F_WRITE,	"rwlock:W" },
+	{ LCB_F_READ,			"rwsem:R" },
+	{ LCB_F_WRITE,			"rwsem:W" },
+	{ LCB_F_RT,			"rtmutex" },
+	{ LCB_F_PERCPU | LCB_F_READ,	"pcpu-sem:R" },
+	{ LCB_F_PERCPU | LCB_F_WRITE,	"pcpu-sem:W" },
+	{ LCB_F_MUTEX,			"mutex" },
+	{ LCB_F_MUTEX | LCB_F_SPIN,	"mutex" },
+};
+
+static const char *get_type_str(struct lock_stat *st)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(lock_type_table); i++) {
+		if (lock_type_table[i].flags == st->flags)
+			return lock_type_table[i].name;
+	}
+	return "unknown";
+}
+
+static void print_contention_time(u64 nsec)
+{
+	if (nsec < NSEC_PER_USEC)
+		pr_info("%7" PRIu64 " ns ", nsec);
+	else if (nsec < NSEC_PER_MSEC)
+		pr_info("%7.2f us ", (double)nsec / NSEC_PER_USEC);
+	else if (nsec < NSEC_PER_SEC)
+		pr_info("%7.2f ms ", (double)nsec / NSEC_PER_MSEC);
+	else
+		pr_info("%7.2f  s ", (double)nsec / NSEC_PER_SEC);
+}
+
+static void print_contention_result(void)
+{
+	struct lock_stat *st;
+
+	pr_info("%10s ", "contended");
+	pr_info("%10s ", "total wait");
+	pr_info("%10s ", "max wait");
+	pr_info("%10s ", "avg wait");
+	pr_info("  %-12s %s\n\n", "type", "caller");
+
+	while ((st = pop_from_result())) {
+		pr_info("%10u ", st->nr_contended);
+		print_contention_time(st->wait_time_total);
+		print_contention_time(st->wait_time_max);
+		print_contention_time(st->avg_wait_time);
+		pr_info("  %-12s %s\n", get_type_str(st), st->name);
+	}
+}
+
 static bool info_threads, info_map;
 
 static void dump_threads(void)
@@ -851,7 +1124,14 @@ static const struct evsel_str_handler lock_tracepoints[] = {
 	{ "lock:lock_release",	 evsel__process_lock_release,   }, /* CONFIG_LOCKDEP */
 };
 
+static const struct evsel_str_handler contention_tracepoints[] = {
+	{ "lock:contention_begin", evsel__process_contention_begin, },
+	{ "lock:contention_end",   evsel__process_contention_end,   },
+};
+
 static bool force;
+static bool use_bpf;
+static unsigned long bpf_map_entries = 10240;
 
 static int __cmd_report(bool display_info)
 {
@@ -904,26 +1184,178 @@ static int __cmd_report(bool display_info)
 	return err;
 }
 
+static void sighandler(int sig __maybe_unused)
+{
+}
+
+static int __cmd_contention(int argc, const char **argv)
+{
+	int err = -EINVAL;
+	struct perf_tool eops = {
+		.sample		 = process_sample_event,
+		.comm		 = perf_event__process_comm,
+		.mmap		 = perf_event__process_mmap,
+		.namespaces	 = perf_event__process_namespaces,
+		.ordered_events	 = true,
+	};
+	struct perf_data data = {
+		.path  = input_name,
+		.mode  = PERF_DATA_MODE_READ,
+		.force = force,
+	};
+	struct lock_contention con = {
+		.target = &target,
+		.result = &lockhash_table[0],
+		.map_nr_entries = bpf_map_entries,
+	};
+
+	session = perf_session__new(use_bpf ? NULL : &data, &eops);
+	if (IS_ERR(session)) {
+		pr_err("Initializing perf session failed\n");
+		return PTR_ERR(session);
+	}
+
+	/* for lock function check */
+	symbol_conf.sort_by_name = true;
+	symbol__init(&session->header.env);
+
+	if (use_bpf) {
+		err = target__validate(&target);
+		if (err) {
+			char errbuf[512];
+
+			target__strerror(&target, err, errbuf, 512);
+			pr_err("%s\n", errbuf);
+			goto out_delete;
+		}
+
+		signal(SIGINT, sighandler);
+		signal(SIGCHLD, sighandler);
+		signal(SIGTERM, sighandler);
+
+		con.machine = &session->machines.host;
+
+		con.evlist = evlist__new();
+		if (con.evlist == NULL) {
+			err = -ENOMEM;
+			goto out_delete;
+		}
+
+		err = evlist__create_maps(con.evlist, &target);
+		if (err < 0)
+			goto out_delete;
+
+		if (argc) {
+			err = evlist__prepare_workload(con.evlist, &target,
+						       argv, false, NULL);
+			if (err < 0)
+				goto out_delete;
+		}
+
+		err = lock_contention_prepare(&con);
+		if (err < 0) {
+			pr_err("lock contention BPF setup failed\n");
+			goto out_delete;
+		}
+	} else {
+		if (!perf_session__has_traces(session, "lock record"))
+			goto out_delete;
+
+		if (!evlist__find_evsel_by_str(session->evlist,
+					       "lock:contention_begin")) {
+			pr_err("lock contention evsel not found\n");
+			goto out_delete;
+		}
+
+		if (perf_session__set_tracepoints_handlers(session,
+							   contention_tracepoints)) {
+			pr_err("Initializing perf session tracepoint handlers failed\n");
+			goto out_delete;
+		}
+	}
+
+	err = select_key();
+	if (err)
+		goto out_delete;
+
+	if (use_bpf) {
+		lock_contention_start();
+		if (argc)
+			evlist__start_workload(con.evlist);
+
+		/* wait for signal */
+		pause();
+
+		lock_contention_stop();
+		err = lock_contention_read(&con);
+		if (err)
+			goto out_delete;
+	} else {
+		err = perf_session__process_events(session);
+		if (err)
+			goto out_delete;
+	}
+
+	setup_pager();
+
+	sort_result();
+	print_contention_result();
+
+	if (con.lost)
+		pr_warning("lost %lu contention events, try a larger --map-nr-entries\n",
+			   con.lost);
+
+out_delete:
+	evlist__delete(con.evlist);
+	lock_contention_finish();
+	perf_session__delete(session);
+	return err;
+}
+
 static int __cmd_record(int argc, const char **argv)
 {
 	const char *record_args[] = {
 		"record", "-R", "-m", "1024", "-c", "1",
 	};
+	const char *callgraph_args[] = {
+		"--call-graph=fp",
+	};
+	const struct evsel_str_handler *tracepoints = lock_tracepoints;
+	unsigned int nr_tracepoints = ARRAY_SIZE(lock_tracepoints);
+	unsigned int nr_callgraph_args = 0;
 	unsigned int rec_argc, i, j, ret;
 	const char **rec_argv;
 
 	for (i = 0; i < ARRAY_SIZE(lock_tracepoints); i++) {
 		if (!is_valid_tracepoint(lock_tracepoints[i].name)) {
-				pr_err("tracepoint %s is not enabled. "
-				       "Are CONFIG_LOCKDEP and CONFIG_LOCK_STAT enabled?\n",
-				       lock_tracepoints[i].name);
+			pr_debug("tracepoint %s is not enabled. "
+				 "Are CONFIG_LOCKDEP and CONFIG_LOCK_STAT enabled?\n",
+				 lock_tracepoints[i].name);
+			tracepoints = NULL;
+			break;
+		}
+	}
+
+	/*
+	 * Without lockdep, record the contention tracepoints with callchains
+	 * so that 'perf lock contention' can find the callers.
+	 */
+	if (!tracepoints) {
+		for (i = 0; i < ARRAY_SIZE(contention_tracepoints); i++) {
+			if (!is_valid_tracepoint(contention_tracepoints[i].name)) {
+				pr_err("tracepoint %s is not enabled.\n",
+				       contention_tracepoints[i].name);
 				return 1;
+			}
 		}
+		tracepoints = contention_tracepoints;
+		nr_tracepoints = ARRAY_SIZE(contention_tracepoints);
+		nr_callgraph_args = ARRAY_SIZE(callgraph_args);
 	}
 
-	rec_argc = ARRAY_SIZE(record_args) + argc - 1;
+	rec_argc = ARRAY_SIZE(record_args) + nr_callgraph_args + argc - 1;
 	/* factor of 2 is for -e in front of each tracepoint */
-	rec_argc += 2 * ARRAY_SIZE(lock_tracepoints);
+	rec_argc += 2 * nr_tracepoints;
 
 	rec_argv = calloc(rec_argc + 1, sizeof(char *));
 	if (!rec_argv)
@@ -932,11 +1364,14 @@ static int __cmd_record(int argc, const char **argv)
 	for (i = 0; i < ARRAY_SIZE(record_args); i++)
 		rec_argv[i] = strdup(record_args[i]);
 
-	for (j = 0; j < ARRAY_SIZE(lock_tracepoints); j++) {
+	for (j = 0; j < nr_tracepoints; j++) {
 		rec_argv[i++] = "-e";
-		rec_argv[i++] = strdup(lock_tracepoints[j].name);
+		rec_argv[i++] = strdup(tracepoints[j].name);
 	}
 
+	for (j = 0; j < nr_callgraph_args; j++, i++)
+		rec_argv[i] = callgraph_args[j];
+
 	for (j = 1; j < (unsigned int)argc; j++, i++)
 		rec_argv[i] = argv[j];
 
@@ -972,12 +1407,29 @@ int cmd_lock(int argc, const char **argv)
 	OPT_PARENT(lock_options)
 	};
 
+	struct option contention_options[] = {
+	OPT_STRING('k', "key", &sort_key, "wait_total",
+		    "key for sorting (contended / wait_total / wait_max / wait_min / avg_wait)"),
+	OPT_BOOLEAN('b', "use-bpf", &use_bpf, "use BPF program to collect lock contention stats"),
+	OPT_BOOLEAN('a', "all-cpus", &target.system_wide,
+		    "System-wide collection from all CPUs"),
+	OPT_STRING('C', "cpu", &target.cpu_list, "cpu",
+		    "List of cpus to monitor"),
+	OPT_STRING('p', "pid", &target.pid, "pid",
+		   "Trace on existing process id"),
+	OPT_STRING(0, "tid", &target.tid, "tid",
+		   "Trace on existing thread id (exclusive to --pid)"),
+	OPT_ULONG('M', "map-nr-entries", &bpf_map_entries,
+		  "Max number of BPF map entries"),
+	OPT_PARENT(lock_options)
+	};
+
 	const char * const info_usage[] = {
 		"perf lock info [<options>]",
 		NULL
 	};
 	const char *const lock_subcommands[] = { "record", "report", "script",
-						 "info", NULL };
+						 "info", "contention", NULL };
 	const char *lock_usage[] = {
 		NULL,
 		NULL
@@ -986,6 +1438,10 @@ int cmd_lock(int argc, const char **argv)
 		"perf lock report [<options>]",
 		NULL
 	};
+	const char * const contention_usage[] = {
+		"perf lock contention [<options>]",
+		NULL
+	};
 	unsigned int i;
 	int rc = 0;
 
@@ -1021,6 +1477,21 @@ int cmd_lock(int argc, const char **argv)
 		/* recycling report_lock_ops */
 		trace_handler = &report_lock_ops;
 		rc = __cmd_report(true);
+	} else if (strlen(argv[0]) > 2 && strstarts("contention", argv[0])) {
+		trace_handler = &contention_lock_ops;
+		sort_key = "wait_total";
+#ifndef HAVE_BPF_SKEL
+		set_option_nobuild(contention_options, 'b', "use-bpf",
+				   "no BUILD_BPF_SKEL=1", false);
+#endif
+		if (argc) {
+			argc = parse_options(argc, argv, contention_options,
+					     contention_usage,
+					     PARSE_OPT_STOP_AT_NON_OPTION);
+		}
+		if (argc && !use_bpf)
+			usage_with_options(contention_usage, contention_options);
+		rc = __cmd_contention(argc, argv);
 	} else {
 		usage_with_options(lock_usage, lock_options);
 	}
@@ -323,6 +323,8 @@ extern const struct bench bench_rb_libbpf;
 extern const struct bench bench_rb_custom;
 extern const struct bench bench_pb_libbpf;
 extern const struct bench bench_pb_custom;
+extern const struct bench bench_lru_update;
+extern const struct bench bench_lru_update_no_common;
 
 static const struct bench *benchs[] = {
 	&bench_count_global,
@@ -344,6 +346,8 @@ static const struct bench *benchs[] = {
 	&bench_rb_custom,
 	&bench_pb_libbpf,
 	&bench_pb_custom,
+	&bench_lru_update,
+	&bench_lru_update_no_common,
 };
 
 static void setup_benchmark()
@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "bench.h"
+#include "lru_bench.skel.h"
+
+/* LRU hash map update benchmarks. Every producer thread triggers a BPF
+ * program that updates a random key of a full LRU hash map, so that most
+ * updates have to evict an element.
+ */
+static struct lru_ctx {
+	struct lru_bench *skel;
+} ctx;
+
+static void lru_validate()
+{
+	if (env.consumer_cnt != 1) {
+		fprintf(stderr, "benchmark doesn't support multi-consumer!\n");
+		exit(1);
+	}
+}
+
+static void setup_ctx()
+{
+	setup_libbpf();
+
+	ctx.skel = lru_bench__open_and_load();
+	if (!ctx.skel) {
+		fprintf(stderr, "failed to open skeleton\n");
+		exit(1);
+	}
+}
+
+static void attach_bpf(struct bpf_program *prog)
+{
+	struct bpf_link *link;
+
+	link = bpf_program__attach(prog);
+	if (!link) {
+		fprintf(stderr, "failed to attach program!\n");
+		exit(1);
+	}
+}
+
+static void lru_common_setup()
+{
+	setup_ctx();
+	attach_bpf(ctx.skel->progs.bench_lru_update);
+}
+
+static void lru_no_common_setup()
+{
+	setup_ctx();
+	attach_bpf(ctx.skel->progs.bench_lru_update_no_common);
+}
+
+static void *lru_producer(void *input)
+{
+	while (true)
+		(void)syscall(__NR_getpgid);
+	return NULL;
+}
+
+static void *lru_consumer(void *input)
+{
+	return NULL;
+}
+
+static void lru_measure(struct bench_res *res)
+{
+	res->hits = atomic_swap(&ctx.skel->bss->hits, 0);
+}
+
+const struct bench bench_lru_update = {
+	.name = "lru-update",
+	.validate = lru_validate,
+	.setup = lru_common_setup,
+	.producer_thread = lru_producer,
+	.consumer_thread = lru_consumer,
+	.measure = lru_measure,
+	.report_progress = hits_drops_report_progress,
+	.report_final = hits_drops_report_final,
+};
+
+const struct bench bench_lru_update_no_common = {
+	.name = "lru-update-no-common",
+	.validate = lru_validate,
+	.setup = lru_no_common_setup,
+	.producer_thread = lru_producer,
+	.consumer_thread = lru_consumer,
+	.measure = lru_measure,
+	.report_progress = hits_drops_report_progress,
+	.report_final = hits_drops_report_final,
+};
@@ -0,0 +1,12 @@
+#!/bin/bash
+
+set -eufo pipefail
+
+for t in update update-no-common
+do
+	for p in 1 4 16 32 64
+	do
+		summary=$(sudo ./bench -w2 -d5 -a -p$p lru-$t | tail -n1 | cut -d'(' -f1 | cut -d' ' -f3-)
+		printf "%-18s %2d producers: %s\n" $t $p "$summary"
+	done
+done
@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <errno.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <bpf/bpf.h>
 #include <bpf/libbpf.h>
@@ -146,6 +147,109 @@ static void __test_map_lookup_and_update_batch(bool is_pcpu)
 	free(visited);
 }
 
+static void array_percpu_map_sum_and_reset(void)
+{
+	struct bpf_create_map_attr xattr = {
+		.name = "array_map",
+		.map_type = BPF_MAP_TYPE_PERCPU_ARRAY,
+		.key_size = sizeof(int),
+		.value_size = sizeof(__s64),
+	};
+	const __u32 max_entries = 10;
+	__s64 *values, *sums, expected;
+	int map_fd, *keys, err, i;
+	__u32 count;
+	__u64 batch = 0;
+	DECLARE_LIBBPF_OPTS(bpf_map_batch_opts, opts,
+		.elem_flags = BPF_F_PERCPU_SUM,
+		.flags = 0,
+	);
+
+	xattr.max_entries = max_entries;
+	map_fd = bpf_create_map_xattr(&xattr);
+	CHECK(map_fd == -1,
+	      "bpf_create_map_xattr()", "error:%s\n", strerror(errno));
+
+	keys = calloc(max_entries, sizeof(*keys));
+	values = calloc(max_entries * nr_cpus, sizeof(*values));
+	sums = calloc(max_entries, sizeof(*sums));
+	CHECK(!keys || !values || !sums, "malloc()", "error:%s\n",
+	      strerror(errno));
+
+	map_batch_update(map_fd, max_entries, keys, values, true);
+
+	/* the values of key i are i + 1 + cpu, see map_batch_update() */
+	count = max_entries;
+	err = bpf_map_lookup_and_delete_batch(map_fd, NULL, &batch, keys,
+					      sums, &count, &opts);
+	CHECK(err, "lookup_and_delete with sum", "error: %s\n",
+	      strerror(errno));
+	CHECK(count != max_entries, "lookup_and_delete with sum",
+	      "count = %u, max_entries = %u\n", count, max_entries);
+	for (i = 0; i < max_entries; i++) {
+		expected = (__s64)nr_cpus * (keys[i] + 1) +
+			   (__s64)nr_cpus * (nr_cpus - 1) / 2;
+		CHECK(sums[i] != expected, "sum checking",
+		      "error: key %d sum %lld expected %lld\n", keys[i],
+		      sums[i], expected);
+	}
+
+	/* the values were reset on every CPU */
+	count = max_entries;
+	err = bpf_map_lookup_batch(map_fd, NULL, &batch, keys, sums, &count,
+				   &opts);
+	CHECK(err, "lookup after reset", "error: %s\n", strerror(errno));
+	for (i = 0; i < max_entries; i++)
+		CHECK(sums[i], "reset checking",
+		      "error: key %d sum %lld\n", keys[i], sums[i]);
+
+	/* min and max over the CPUs are i + 1 and i + nr_cpus */
+	map_batch_update(map_fd, max_entries, keys, values, true);
+	opts.elem_flags = BPF_F_PERCPU_MIN;
+	count = max_entries;
+	err = bpf_map_lookup_batch(map_fd, NULL, &batch, keys, sums, &count,
+				   &opts);
+	CHECK(err, "lookup with min", "error: %s\n", strerror(errno));
+	for (i = 0; i < max_entries; i++)
+		CHECK(sums[i] != keys[i] + 1, "min checking",
+		      "error: key %d min %lld\n", keys[i], sums[i]);
+
+	opts.elem_flags = BPF_F_PERCPU_MAX;
+	count = max_entries;
+	err = bpf_map_lookup_batch(map_fd, NULL, &batch, keys, sums, &count,
+				   &opts);
+	CHECK(err, "lookup with max", "error: %s\n", strerror(errno));
+	for (i = 0; i < max_entries; i++)
+		CHECK(sums[i] != keys[i] + nr_cpus, "max checking",
+		      "error: key %d max %lld\n", keys[i], sums[i]);
+
+	/* only one reduction at a time */
+	opts.elem_flags = BPF_F_PERCPU_MIN | BPF_F_PERCPU_MAX;
+	count = max_entries;
+	err = bpf_map_lookup_batch(map_fd, NULL, &batch, keys, sums, &count,
+				   &opts);
+	CHECK(!err || errno != EINVAL, "lookup with min and max",
+	      "unexpected success or error: %s\n", strerror(errno));
+	opts.elem_flags = BPF_F_PERCPU_SUM;
+
+	/* reduction needs u64 sized counters */
+	close(map_fd);
+	xattr.value_size = sizeof(int);
+	map_fd = bpf_create_map_xattr(&xattr);
+	CHECK(map_fd == -1,
+	      "bpf_create_map_xattr()", "error:%s\n", strerror(errno));
+	count = max_entries;
+	err = bpf_map_lookup_batch(map_fd, NULL, &batch, keys, sums, &count,
+				   &opts);
+	CHECK(!err || errno != EINVAL, "sum of unaligned value",
+	      "unexpected success or error: %s\n", strerror(errno));
+
+	close(map_fd);
+	free(keys);
+	free(values);
+	free(sums);
+}
+
 static void array_map_batch_ops(void)
 {
 	__test_map_lookup_and_update_batch(false);
@@ -155,6 +259,7 @@ static void array_map_batch_ops(void)
 static void array_percpu_map_batch_ops(void)
 {
 	__test_map_lookup_and_update_batch(true);
+	array_percpu_map_sum_and_reset();
 	printf("test_%s:PASS\n", __func__);
 }
 
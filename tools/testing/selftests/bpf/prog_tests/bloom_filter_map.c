@@ -0,0 +1,122 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <test_progs.h>
+#include <network_helpers.h>
+#include "bloom_filter_map.skel.h"
+
+#define NR_VALS 100
+
+static unsigned int duration;
+
+static void test_fail_cases(void)
+{
+	__u32 value;
+	int fd, err;
+
+	/* Invalid key size */
+	fd = bpf_create_map(BPF_MAP_TYPE_BLOOM_FILTER, 4, sizeof(value), 100, 0);
+	if (!ASSERT_LT(fd, 0, "bpf_create_map bloom filter invalid key size"))
+		close(fd);
+
+	/* Invalid value size */
+	fd = bpf_create_map(BPF_MAP_TYPE_BLOOM_FILTER, 0, 0, 100, 0);
+	if (!ASSERT_LT(fd, 0, "bpf_create_map bloom filter invalid value size 0"))
+		close(fd);
+
+	/* Invalid max entries size */
+	fd = bpf_create_map(BPF_MAP_TYPE_BLOOM_FILTER, 0, sizeof(value), 0, 0);
+	if (!ASSERT_LT(fd, 0, "bpf_create_map bloom filter invalid max entries size"))
+		close(fd);
+
+	/* Bloom filter maps do not support BPF_F_NO_PREALLOC */
+	fd = bpf_create_map(BPF_MAP_TYPE_BLOOM_FILTER, 0, sizeof(value), 100,
+			    BPF_F_NO_PREALLOC);
+	if (!ASSERT_LT(fd, 0, "bpf_create_map bloom filter invalid flags"))
+		close(fd);
+
+	fd = bpf_create_map(BPF_MAP_TYPE_BLOOM_FILTER, 0, sizeof(value), 100, 0);
+	if (!ASSERT_GE(fd, 0, "bpf_create_map bloom filter"))
+		return;
+
+	/* Test invalid flags */
+	err = bpf_map_update_elem(fd, NULL, &value, -1);
+	ASSERT_ERR(err, "bpf_map_update_elem bloom filter invalid flags");
+
+	err = bpf_map_update_elem(fd, NULL, &value, BPF_EXIST);
+	ASSERT_ERR(err, "bpf_map_update_elem bloom filter invalid flags");
+
+	err = bpf_map_update_elem(fd, NULL, &value, BPF_F_LOCK);
+	ASSERT_ERR(err, "bpf_map_update_elem bloom filter invalid flags");
+
+	err = bpf_map_update_elem(fd, NULL, &value, BPF_NOEXIST);
+	ASSERT_ERR(err, "bpf_map_update_elem bloom filter invalid flags");
+
+	/* Nothing was pushed, so the lookup must miss */
+	value = 1;
+	err = bpf_map_lookup_elem(fd, NULL, &value);
+	ASSERT_TRUE(err && errno == ENOENT, "bpf_map_lookup_elem bloom filter empty");
+
+	/* Deletion is not supported */
+	err = bpf_map_delete_elem(fd, NULL);
+	ASSERT_ERR(err, "bpf_map_delete_elem bloom filter");
+
+	close(fd);
+}
+
+static void test_check_bloom(void)
+{
+	struct bloom_filter_map *skel;
+	__u32 vals[NR_VALS], retval;
+	int i, err, prog_fd, map_fd;
+
+	skel = bloom_filter_map__open_and_load();
+	if (!ASSERT_OK_PTR(skel, "bloom_filter_map__open_and_load"))
+		return;
+
+	prog_fd = bpf_program__fd(skel->progs.check_bloom);
+	map_fd = bpf_map__fd(skel->maps.map_bloom);
+
+	for (i = 0; i < NR_VALS; i++) {
+		vals[i] = rand();
+		err = bpf_map_update_elem(map_fd, NULL, &vals[i], BPF_ANY);
+		if (!ASSERT_OK(err, "bpf_map_update_elem bloom filter"))
+			goto out;
+	}
+
+	/* Values pushed from user space must be found by the program */
+	for (i = 0; i < NR_VALS; i++) {
+		skel->bss->value_peek = vals[i];
+		skel->bss->value_push = vals[i];
+		err = bpf_prog_test_run(prog_fd, 1, &pkt_v4, sizeof(pkt_v4),
+					NULL, NULL, &retval, &duration);
+		if (CHECK(err || retval, "check_bloom", "err %d errno %d retval %d\n",
+			  err, errno, retval))
+			goto out;
+		if (!ASSERT_OK(skel->bss->peek_err, "peek_err"))
+			goto out;
+	}
+
+	/* Values pushed from the program must be found from user space */
+	for (i = 0; i < NR_VALS; i++) {
+		skel->bss->value_push = vals[i] ^ 0x5a5a5a5a;
+		err = bpf_prog_test_run(prog_fd, 1, &pkt_v4, sizeof(pkt_v4),
+					NULL, NULL, &retval, &duration);
+		if (CHECK(err || retval, "check_bloom", "err %d errno %d retval %d\n",
+			  err, errno, retval))
+			goto out;
+
+		err = bpf_map_lookup_elem(map_fd, NULL, &skel->bss->value_push);
+		if (!ASSERT_OK(err, "bpf_map_lookup_elem bloom filter"))
+			goto out;
+	}
+
+out:
+	bloom_filter_map__destroy(skel);
+}
+
+void test_bloom_filter_map(void)
+{
+	if (test__start_subtest("fail_cases"))
+		test_fail_cases();
+	if (test__start_subtest("check_bloom"))
+		test_check_bloom();
+}
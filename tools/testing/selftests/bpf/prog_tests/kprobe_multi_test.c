@@ -0,0 +1,166 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <test_progs.h>
+#include "kprobe_multi.skel.h"
+#include "trace_helpers.h"
+
+static void kprobe_multi_test_run(struct kprobe_multi *skel)
+{
+	__u32 duration = 0, retval;
+	int err, prog_fd;
+
+	prog_fd = bpf_program__fd(skel->progs.trigger);
+	err = bpf_prog_test_run(prog_fd, 1, NULL, 0,
+				NULL, NULL, &retval, &duration);
+	ASSERT_OK(err, "test_run");
+	ASSERT_EQ(retval, 0, "test_run");
+
+	ASSERT_EQ(skel->bss->kprobe_test1_result, 1, "kprobe_test1_result");
+	ASSERT_EQ(skel->bss->kprobe_test2_result, 1, "kprobe_test2_result");
+	ASSERT_EQ(skel->bss->kprobe_test3_result, 1, "kprobe_test3_result");
+	ASSERT_EQ(skel->bss->kprobe_test4_result, 1, "kprobe_test4_result");
+	ASSERT_EQ(skel->bss->kprobe_test5_result, 1, "kprobe_test5_result");
+	ASSERT_EQ(skel->bss->kprobe_test6_result, 1, "kprobe_test6_result");
+	ASSERT_EQ(skel->bss->kprobe_test7_result, 1, "kprobe_test7_result");
+	ASSERT_EQ(skel->bss->kprobe_test8_result, 1, "kprobe_test8_result");
+}
+
+static void test_skel_api(void)
+{
+	struct kprobe_multi *skel = NULL;
+	int err;
+
+	skel = kprobe_multi__open_and_load();
+	if (!ASSERT_OK_PTR(skel, "kprobe_multi__open_and_load"))
+		goto cleanup;
+
+	skel->bss->pid = getpid();
+	err = kprobe_multi__attach(skel);
+	if (!ASSERT_OK(err, "kprobe_multi__attach"))
+		goto cleanup;
+
+	kprobe_multi_test_run(skel);
+
+cleanup:
+	kprobe_multi__destroy(skel);
+}
+
+static const char * const test_syms[] = {
+	"bpf_fentry_test2",
+	"bpf_fentry_test1",
+	"bpf_fentry_test3",
+	"bpf_fentry_test4",
+	"bpf_fentry_test5",
+	"bpf_fentry_test6",
+	"bpf_fentry_test7",
+	"bpf_fentry_test8",
+};
+
+/* deliberately not in address order, the kernel sorts them */
+static const __u64 test_cookies[] = { 2, 1, 3, 4, 5, 6, 7, 8 };
+
+static void test_attach_api(const char *pattern,
+			    struct bpf_kprobe_multi_opts *opts)
+{
+	struct bpf_link *link = NULL;
+	struct kprobe_multi *skel;
+
+	skel = kprobe_multi__open_and_load();
+	if (!ASSERT_OK_PTR(skel, "kprobe_multi__open_and_load"))
+		return;
+
+	skel->bss->pid = getpid();
+	skel->bss->test_cookie = opts && opts->cookies;
+	link = bpf_program__attach_kprobe_multi_opts(skel->progs.test_kprobe,
+						     pattern, opts);
+	if (!ASSERT_OK_PTR(link, "bpf_program__attach_kprobe_multi_opts"))
+		goto cleanup;
+
+	kprobe_multi_test_run(skel);
+
+cleanup:
+	bpf_link__destroy(link);
+	kprobe_multi__destroy(skel);
+}
+
+static void test_attach_api_pattern(void)
+{
+	test_attach_api("bpf_fentry_test*", NULL);
+	test_attach_api("bpf_fentry_test?", NULL);
+}
+
+static void test_attach_api_syms(void)
+{
+	DECLARE_LIBBPF_OPTS(bpf_kprobe_multi_opts, opts);
+
+	opts.syms = (const char **)test_syms;
+	opts.cookies = test_cookies;
+	opts.cnt = ARRAY_SIZE(test_syms);
+	test_attach_api(NULL, &opts);
+}
+
+static void test_attach_api_addrs(void)
+{
+	DECLARE_LIBBPF_OPTS(bpf_kprobe_multi_opts, opts);
+	unsigned long addrs[ARRAY_SIZE(test_syms)];
+	int i;
+
+	if (!ASSERT_OK(load_kallsyms(), "load_kallsyms"))
+		return;
+
+	for (i = 0; i < ARRAY_SIZE(test_syms); i++) {
+		addrs[i] = ksym_get_addr(test_syms[i]);
+		if (!ASSERT_NEQ(addrs[i], 0, "ksym_get_addr"))
+			return;
+	}
+
+	opts.addrs = addrs;
+	opts.cookies = test_cookies;
+	opts.cnt = ARRAY_SIZE(addrs);
+	test_attach_api(NULL, &opts);
+}
+
+static void test_attach_api_fails(void)
+{
+	DECLARE_LIBBPF_OPTS(bpf_kprobe_multi_opts, opts);
+	struct kprobe_multi *skel;
+	struct bpf_link *link;
+
+	skel = kprobe_multi__open_and_load();
+	if (!ASSERT_OK_PTR(skel, "kprobe_multi__open_and_load"))
+		return;
+
+	/* pattern and explicit symbols are mutually exclusive */
+	opts.syms = (const char **)test_syms;
+	opts.cnt = ARRAY_SIZE(test_syms);
+	link = bpf_program__attach_kprobe_multi_opts(skel->progs.test_kprobe,
+						     "bpf_fentry_test*", &opts);
+	ASSERT_ERR_PTR(link, "pattern_and_syms");
+
+	/* unknown symbol fails the whole attachment */
+	opts.syms = (const char *[]) { "bpf_fentry_test1", "no_such_function_123" };
+	opts.cnt = 2;
+	link = bpf_program__attach_kprobe_multi_opts(skel->progs.test_kprobe,
+						     NULL, &opts);
+	ASSERT_ERR_PTR(link, "unknown_sym");
+
+	/* nothing matches */
+	link = bpf_program__attach_kprobe_multi_opts(skel->progs.test_kprobe,
+						     "no_such_function_*", NULL);
+	ASSERT_ERR_PTR(link, "no_match");
+
+	kprobe_multi__destroy(skel);
+}
+
+void test_kprobe_multi_test(void)
+{
+	if (test__start_subtest("skel_api"))
+		test_skel_api();
+	if (test__start_subtest("attach_api_pattern"))
+		test_attach_api_pattern();
+	if (test__start_subtest("attach_api_syms"))
+		test_attach_api_syms();
+	if (test__start_subtest("attach_api_addrs"))
+		test_attach_api_addrs();
+	if (test__start_subtest("attach_api_fails"))
+		test_attach_api_fails();
+}
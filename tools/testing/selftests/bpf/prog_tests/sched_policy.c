@@ -0,0 +1,32 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <unistd.h>
+#include <test_progs.h>
+#include "sched_policy.skel.h"
+
+void test_sched_policy(void)
+{
+	struct sched_policy *skel;
+	struct bpf_link *link;
+	int i;
+
+	skel = sched_policy__open_and_load();
+	if (!ASSERT_OK_PTR(skel, "sched_policy__open_and_load"))
+		return;
+
+	skel->bss->target_pid = getpid();
+
+	link = bpf_map__attach_struct_ops(skel->maps.prev_cpu_policy);
+	if (!ASSERT_OK_PTR(link, "bpf_map__attach_struct_ops"))
+		goto out;
+
+	/* Every timed sleep ends in a wakeup going through select_cpu */
+	for (i = 0; i < 10; i++)
+		usleep(1000);
+
+	ASSERT_GT(skel->bss->nr_selects, 0, "nr_selects");
+
+	bpf_link__destroy(link);
+out:
+	sched_policy__destroy(skel);
+}
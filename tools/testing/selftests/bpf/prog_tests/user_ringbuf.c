@@ -0,0 +1,153 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <sys/mman.h>
+#include <test_progs.h>
+#include <network_helpers.h>
+#include "user_ringbuf.skel.h"
+
+#define NR_SAMPLES 32
+
+struct sample {
+	__u64 seq;
+	__u64 val;
+};
+
+static unsigned int duration;
+
+static int drain(struct user_ringbuf *skel)
+{
+	__u32 retval;
+	int err;
+
+	err = bpf_prog_test_run(bpf_program__fd(skel->progs.drain_user_ringbuf),
+				1, &pkt_v4, sizeof(pkt_v4), NULL, NULL,
+				&retval, &duration);
+	if (CHECK(err || retval, "drain_user_ringbuf", "err %d errno %d retval %d\n",
+		  err, errno, retval))
+		return -1;
+	return 0;
+}
+
+static void test_fail_cases(void)
+{
+	struct user_ring_buffer *ringbuf;
+	struct user_ringbuf *skel;
+	int fd, page_size;
+	void *mem;
+
+	page_size = getpagesize();
+
+	/* value_size is the largest sample the program can access */
+	fd = bpf_create_map(BPF_MAP_TYPE_USER_RINGBUF, 0, 0, page_size, 0);
+	if (!ASSERT_LT(fd, 0, "bpf_create_map user ringbuf zero value size"))
+		close(fd);
+
+	fd = bpf_create_map(BPF_MAP_TYPE_USER_RINGBUF, 0, page_size, page_size, 0);
+	if (!ASSERT_LT(fd, 0, "bpf_create_map user ringbuf value size too big"))
+		close(fd);
+
+	skel = user_ringbuf__open_and_load();
+	if (!ASSERT_OK_PTR(skel, "user_ringbuf__open_and_load"))
+		return;
+
+	fd = bpf_map__fd(skel->maps.user_ringbuf);
+
+	/* The consumer position is only written by the kernel */
+	mem = mmap(NULL, page_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (!ASSERT_EQ(mem, MAP_FAILED, "mmap writable consumer page"))
+		munmap(mem, page_size);
+
+	mem = mmap(NULL, page_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+		   page_size);
+	if (ASSERT_NEQ(mem, MAP_FAILED, "mmap writable producer page"))
+		munmap(mem, page_size);
+
+	ringbuf = user_ring_buffer__new(fd, NULL);
+	if (!ASSERT_OK_PTR(ringbuf, "user_ring_buffer__new"))
+		goto out;
+
+	mem = user_ring_buffer__reserve(ringbuf, sizeof(struct sample) + 8);
+	ASSERT_TRUE(!mem && errno == E2BIG, "reserve larger than value_size");
+
+	user_ring_buffer__free(ringbuf);
+out:
+	user_ringbuf__destroy(skel);
+}
+
+static void test_drain(void)
+{
+	struct user_ring_buffer *ringbuf;
+	struct user_ringbuf *skel;
+	__u64 expected_sum = 0;
+	struct sample *s;
+	int i;
+
+	skel = user_ringbuf__open_and_load();
+	if (!ASSERT_OK_PTR(skel, "user_ringbuf__open_and_load"))
+		return;
+
+	ringbuf = user_ring_buffer__new(bpf_map__fd(skel->maps.user_ringbuf), NULL);
+	if (!ASSERT_OK_PTR(ringbuf, "user_ring_buffer__new"))
+		goto out;
+
+	for (i = 1; i <= NR_SAMPLES; i++) {
+		s = user_ring_buffer__reserve(ringbuf, sizeof(*s));
+		if (!ASSERT_OK_PTR(s, "user_ring_buffer__reserve"))
+			goto out;
+		s->seq = i;
+		s->val = i * 3;
+		/* discarded samples are skipped by the kernel */
+		if (i % 4 == 0) {
+			user_ring_buffer__discard(ringbuf, s);
+			continue;
+		}
+		expected_sum += s->val;
+		user_ring_buffer__submit(ringbuf, s);
+	}
+
+	if (drain(skel))
+		goto out;
+	ASSERT_EQ(skel->bss->drain_ret, NR_SAMPLES - NR_SAMPLES / 4, "drain_ret");
+	ASSERT_EQ(skel->bss->read_samples, NR_SAMPLES - NR_SAMPLES / 4, "read_samples");
+	ASSERT_EQ(skel->bss->sum, expected_sum, "sum");
+	ASSERT_EQ(skel->bss->last_seq, NR_SAMPLES - 1, "last_seq");
+
+	/* An empty drain is not an error */
+	if (drain(skel))
+		goto out;
+	ASSERT_EQ(skel->bss->drain_ret, 0, "drain_ret empty");
+
+	/* Returning 1 from the callback stops the drain after that sample */
+	skel->bss->read_samples = 0;
+	skel->bss->stop_at_seq = 2;
+	for (i = 1; i <= 3; i++) {
+		s = user_ring_buffer__reserve_blocking(ringbuf, sizeof(*s), 0);
+		if (!ASSERT_OK_PTR(s, "user_ring_buffer__reserve_blocking"))
+			goto out;
+		s->seq = i;
+		s->val = 0;
+		user_ring_buffer__submit(ringbuf, s);
+	}
+
+	if (drain(skel))
+		goto out;
+	ASSERT_EQ(skel->bss->read_samples, 2, "read_samples stop");
+	ASSERT_EQ(skel->bss->last_seq, 2, "last_seq stop");
+
+	skel->bss->stop_at_seq = 0;
+	if (drain(skel))
+		goto out;
+	ASSERT_EQ(skel->bss->read_samples, 3, "read_samples rest");
+	ASSERT_EQ(skel->bss->last_seq, 3, "last_seq rest");
+
+out:
+	user_ring_buffer__free(ringbuf);
+	user_ringbuf__destroy(skel);
+}
+
+void test_user_ringbuf(void)
+{
+	if (test__start_subtest("fail_cases"))
+		test_fail_cases();
+	if (test__start_subtest("drain"))
+		test_drain();
+}
@@ -43,6 +43,21 @@ void test_xdp_cpumap_attach(void)
 	err = bpf_map_lookup_elem(map_fd, &idx, &val);
 	ASSERT_OK(err, "Read cpumap entry");
 	ASSERT_EQ(info.id, val.bpf_prog.id, "Match program id to cpumap entry prog_id");
+	ASSERT_EQ(val.batch, 8, "Default cpumap entry batch");
+
+	val.bpf_prog.fd = prog_fd;
+	val.batch = 1000;
+	err = bpf_map_update_elem(map_fd, &idx, &val, 0);
+	ASSERT_NEQ(err, 0, "Add cpumap entry with too large batch");
+
+	val.batch = 32;
+	err = bpf_map_update_elem(map_fd, &idx, &val, 0);
+	ASSERT_OK(err, "Add cpumap entry with batch");
+
+	err = bpf_map_lookup_elem(map_fd, &idx, &val);
+	ASSERT_OK(err, "Read cpumap entry with batch");
+	ASSERT_EQ(val.batch, 32, "Match cpumap entry batch");
+	ASSERT_EQ(val.stats.packets, 0, "No packets on new cpumap entry");
 
 	/* can not attach BPF_XDP_CPUMAP program to a device */
 	err = bpf_set_link_xdp_fd(IFINDEX_LO, prog_fd, XDP_FLAGS_SKB_MODE);
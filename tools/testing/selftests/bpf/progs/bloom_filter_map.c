@@ -0,0 +1,25 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <linux/bpf.h>
+#include <bpf/bpf_helpers.h>
+
+struct {
+	__uint(type, BPF_MAP_TYPE_BLOOM_FILTER);
+	__uint(key_size, 0);
+	__uint(value_size, sizeof(__u32));
+	__uint(max_entries, 1000);
+} map_bloom SEC(".maps");
+
+__u32 value_push;
+__u32 value_peek;
+int peek_err;
+
+SEC("classifier")
+int check_bloom(struct __sk_buff *skb)
+{
+	peek_err = bpf_map_peek_elem(&map_bloom, &value_peek);
+	bpf_map_push_elem(&map_bloom, &value_push, BPF_ANY);
+
+	return 0;
+}
+
+char _license[] SEC("license") = "GPL";
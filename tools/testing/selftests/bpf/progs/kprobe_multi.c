@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <linux/bpf.h>
+#include <bpf/bpf_helpers.h>
+#include <bpf/bpf_tracing.h>
+#include <stdbool.h>
+
+char _license[] SEC("license") = "GPL";
+
+extern const void bpf_fentry_test1 __ksym;
+extern const void bpf_fentry_test2 __ksym;
+extern const void bpf_fentry_test3 __ksym;
+extern const void bpf_fentry_test4 __ksym;
+extern const void bpf_fentry_test5 __ksym;
+extern const void bpf_fentry_test6 __ksym;
+extern const void bpf_fentry_test7 __ksym;
+extern const void bpf_fentry_test8 __ksym;
+
+int pid = 0;
+bool test_cookie = false;
+
+__u64 kprobe_test1_result = 0;
+__u64 kprobe_test2_result = 0;
+__u64 kprobe_test3_result = 0;
+__u64 kprobe_test4_result = 0;
+__u64 kprobe_test5_result = 0;
+__u64 kprobe_test6_result = 0;
+__u64 kprobe_test7_result = 0;
+__u64 kprobe_test8_result = 0;
+
+static void kprobe_multi_check(void *ctx)
+{
+	__u64 cookie = test_cookie ? bpf_get_attach_cookie(ctx) : 0;
+	__u64 addr = bpf_get_func_ip(ctx);
+
+	if (bpf_get_current_pid_tgid() >> 32 != pid)
+		return;
+
+#define SET(__var, __addr, __cookie) ({			\
+	if (((const void *) addr == __addr) &&		\
+	     (!test_cookie || (cookie == __cookie)))	\
+		__var = 1;				\
+})
+
+	SET(kprobe_test1_result, &bpf_fentry_test1, 1);
+	SET(kprobe_test2_result, &bpf_fentry_test2, 2);
+	SET(kprobe_test3_result, &bpf_fentry_test3, 3);
+	SET(kprobe_test4_result, &bpf_fentry_test4, 4);
+	SET(kprobe_test5_result, &bpf_fentry_test5, 5);
+	SET(kprobe_test6_result, &bpf_fentry_test6, 6);
+	SET(kprobe_test7_result, &bpf_fentry_test7, 7);
+	SET(kprobe_test8_result, &bpf_fentry_test8, 8);
+
+#undef SET
+}
+
+SEC("kprobe.multi/bpf_fentry_tes??")
+int test_kprobe(struct pt_regs *ctx)
+{
+	kprobe_multi_check(ctx);
+	return 0;
+}
+
+/* running this program calls all bpf_fentry_test* functions */
+SEC("fentry/bpf_modify_return_test")
+int BPF_PROG(trigger)
+{
+	return 0;
+}
@@ -0,0 +1,50 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <linux/bpf.h>
+#include <bpf/bpf_helpers.h>
+
+#define LRU_MAP_SIZE	16384
+/* Four times the map size, so that most updates evict an element */
+#define LRU_KEY_SPACE	(4 * LRU_MAP_SIZE)
+
+char _license[] SEC("license") = "GPL";
+
+struct {
+	__uint(type, BPF_MAP_TYPE_LRU_HASH);
+	__uint(max_entries, LRU_MAP_SIZE);
+	__type(key, __u32);
+	__type(value, __u64);
+} lru_map SEC(".maps");
+
+struct {
+	__uint(type, BPF_MAP_TYPE_LRU_HASH);
+	__uint(map_flags, BPF_F_NO_COMMON_LRU);
+	__uint(max_entries, LRU_MAP_SIZE);
+	__type(key, __u32);
+	__type(value, __u64);
+} lru_map_no_common SEC(".maps");
+
+long hits = 0;
+
+static __always_inline void lru_update(void *map)
+{
+	__u32 key = bpf_get_prandom_u32() % LRU_KEY_SPACE;
+	__u64 val = key;
+
+	if (!bpf_map_update_elem(map, &key, &val, BPF_ANY))
+		__sync_add_and_fetch(&hits, 1);
+}
+
+SEC("tp/syscalls/sys_enter_getpgid")
+int bench_lru_update(void *ctx)
+{
+	lru_update(&lru_map);
+	return 0;
+}
+
+SEC("tp/syscalls/sys_enter_getpgid")
+int bench_lru_update_no_common(void *ctx)
+{
+	lru_update(&lru_map_no_common);
+	return 0;
+}
@@ -0,0 +1,28 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include "vmlinux.h"
+#include <bpf/bpf_helpers.h>
+#include <bpf/bpf_tracing.h>
+
+char _license[] SEC("license") = "GPL";
+
+int target_pid = 0;
+int nr_selects = 0;
+
+/* Keep the test process on its previous CPU, let CFS place everyone else */
+SEC("struct_ops/prev_cpu_select")
+int BPF_PROG(prev_cpu_select, struct task_struct *p, int prev_cpu,
+	     int wake_flags)
+{
+	if (p->tgid != target_pid)
+		return -1;
+
+	__sync_fetch_and_add(&nr_selects, 1);
+	return prev_cpu;
+}
+
+SEC(".struct_ops")
+struct sched_policy_ops prev_cpu_policy = {
+	.select_cpu	= (void *)prev_cpu_select,
+	.name		= "prev_cpu",
+};
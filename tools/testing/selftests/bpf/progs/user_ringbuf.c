@@ -0,0 +1,44 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <linux/bpf.h>
+#include <bpf/bpf_helpers.h>
+
+struct sample {
+	__u64 seq;
+	__u64 val;
+};
+
+struct {
+	__uint(type, BPF_MAP_TYPE_USER_RINGBUF);
+	__uint(value_size, sizeof(struct sample));
+	__uint(max_entries, 4096);
+} user_ringbuf SEC(".maps");
+
+long read_samples;
+long drain_ret;
+__u64 sum;
+__u64 last_seq;
+__u64 stop_at_seq;
+
+static long read_sample(void *data, __u32 size, void *ctx)
+{
+	struct sample *s = data;
+
+	if (size != sizeof(*s))
+		return 1;
+
+	read_samples++;
+	sum += s->val;
+	last_seq = s->seq;
+
+	return stop_at_seq && s->seq == stop_at_seq;
+}
+
+SEC("classifier")
+int drain_user_ringbuf(struct __sk_buff *skb)
+{
+	drain_ret = bpf_user_ringbuf_drain(&user_ringbuf, read_sample, NULL, 0);
+
+	return 0;
+}
+
+char _license[] SEC("license") = "GPL";
@@ -0,0 +1,159 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * SysV semaphore scalability test
+ *
+ * Runs one thread per online CPU against a single large semaphore array.
+ * Each thread increments and decrements its own semaphore, first with
+ * single-sop semop() calls, which only take the per-semaphore lock, then
+ * with two-sop calls, which take the global array lock.  The throughput
+ * of both phases is reported; the test fails if any semaphore does not
+ * end up back at zero.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ipc.h>
+#include <sys/sem.h>
+
+#include "../kselftest.h"
+
+#define NSEMS		250
+#define RUNTIME_SEC	1
+
+union semun {
+	int val;
+	struct semid_ds *buf;
+	unsigned short *array;
+};
+
+struct worker {
+	pthread_t thread;
+	int semid;
+	unsigned short semnum;
+	int nsops;
+	unsigned long ops;
+	int err;
+};
+
+static volatile bool stop;
+
+static void *worker_fn(void *arg)
+{
+	struct worker *w = arg;
+	struct sembuf up[2] = {
+		{ .sem_num = w->semnum, .sem_op = 1 },
+		{ .sem_num = w->semnum, .sem_op = 1 },
+	};
+	struct sembuf down[2] = {
+		{ .sem_num = w->semnum, .sem_op = -1 },
+		{ .sem_num = w->semnum, .sem_op = -1 },
+	};
+
+	while (!stop) {
+		if (semop(w->semid, up, w->nsops) ||
+		    semop(w->semid, down, w->nsops)) {
+			w->err = errno;
+			break;
+		}
+		w->ops += 2;
+	}
+
+	return NULL;
+}
+
+static int run_phase(int semid, struct worker *workers, int nr, int nsops)
+{
+	unsigned short vals[NSEMS];
+	unsigned long ops = 0;
+	union semun arg;
+	int i, ret = 0;
+
+	stop = false;
+	for (i = 0; i < nr; i++) {
+		workers[i] = (struct worker) {
+			.semid = semid,
+			.semnum = i % NSEMS,
+			.nsops = nsops,
+		};
+		if (pthread_create(&workers[i].thread, NULL, worker_fn,
+				   &workers[i])) {
+			ksft_print_msg("pthread_create failed\n");
+			nr = i;
+			ret = -1;
+			break;
+		}
+	}
+
+	if (!ret)
+		sleep(RUNTIME_SEC);
+	stop = true;
+
+	/* join every thread, even after a failure, before touching the set */
+	for (i = 0; i < nr; i++) {
+		pthread_join(workers[i].thread, NULL);
+		if (workers[i].err) {
+			ksft_print_msg("semop failed: %s\n",
+				       strerror(workers[i].err));
+			ret = -1;
+		}
+		ops += workers[i].ops;
+	}
+	if (ret)
+		return ret;
+
+	arg.array = vals;
+	if (semctl(semid, 0, GETALL, arg)) {
+		ksft_print_msg("semctl(GETALL) failed: %s\n", strerror(errno));
+		return -1;
+	}
+	for (i = 0; i < NSEMS; i++) {
+		if (vals[i]) {
+			ksft_print_msg("semaphore %d left at %u\n", i, vals[i]);
+			return -1;
+		}
+	}
+
+	ksft_print_msg("%d threads, %d sop(s) per call: %lu semops/s\n",
+		       nr, nsops, ops / RUNTIME_SEC);
+	return 0;
+}
+
+int main(void)
+{
+	struct worker *workers;
+	int semid, nr, ret;
+
+	nr = sysconf(_SC_NPROCESSORS_ONLN);
+	if (nr < 1)
+		nr = 1;
+
+	semid = semget(IPC_PRIVATE, NSEMS, IPC_CREAT | 0600);
+	if (semid < 0) {
+		if (errno == ENOSYS || errno == EPERM)
+			ksft_exit_skip("SysV semaphores not available\n");
+		ksft_exit_fail_msg("semget failed: %s\n", strerror(errno));
+	}
+
+	workers = calloc(nr, sizeof(*workers));
+	if (!workers) {
+		semctl(semid, 0, IPC_RMID);
+		ksft_exit_fail_msg("out of memory\n");
+	}
+
+	ret = run_phase(semid, workers, nr, 1);
+	if (!ret)
+		ret = run_phase(semid, workers, nr, 2);
+
+	semctl(semid, 0, IPC_RMID);
+	free(workers);
+
+	if (ret)
+		ksft_exit_fail();
+	ksft_exit_pass();
+}
@@ -21,6 +21,10 @@ KSELFTEST_SKIP=4
 TESTS="reported_issues correctness concurrency timeout"
 [ "${quicktest}" != "1" ] && TESTS="${TESTS} performance"
 
+# Number of set entries for performance tests, overrides perf_entries of every
+# set type if set, e.g. to compare matching rates for different set sizes
+PERF_ENTRIES="${PERF_ENTRIES:-}"
+
 # Set types, defined by TYPE_ variables below
 TYPES="net_port port_net net6_port port_proto net6_port_mac net6_port_mac_proto
        net_port_net net_mac net_mac_icmp net6_mac_icmp net6_port_net6_port
@@ -1554,6 +1558,7 @@ for name in ${TESTS}; do
 		done
 		IFS=' 	
 '
+		[ -n "${PERF_ENTRIES}" ] && perf_entries="${PERF_ENTRIES}"
 
 		if [ "${name}" = "concurrency" ] && \
 		   [ "${race_repeat}" = "0" ]; then
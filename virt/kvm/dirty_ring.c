@@ -7,6 +7,7 @@
 #include <linux/kvm_host.h>
 #include <linux/kvm.h>
 #include <linux/vmalloc.h>
+#include <linux/eventfd.h>
 #include <linux/kvm_dirty_ring.h>
 #include <trace/events/kvm.h>
 #include "mmu_lock.h"
@@ -76,7 +77,10 @@ int kvm_dirty_ring_alloc(struct kvm_dirty_ring *ring, int index, u32 size)
 	ring->soft_limit = ring->size - kvm_dirty_ring_get_rsvd_entries();
 	ring->dirty_index = 0;
 	ring->reset_index = 0;
+	ring->notify_limit = 0;
+	ring->notify = NULL;
 	ring->index = index;
+	mutex_init(&ring->reset_lock);
 
 	return 0;
 }
@@ -108,6 +112,8 @@ int kvm_dirty_ring_reset(struct kvm *kvm, struct kvm_dirty_ring *ring)
 	/* This is only needed to make compilers happy */
 	cur_slot = cur_offset = mask = 0;
 
+	mutex_lock(&ring->reset_lock);
+
 	while (true) {
 		entry = &ring->dirty_gfns[ring->reset_index & (ring->size - 1)];
 
@@ -153,6 +159,8 @@ int kvm_dirty_ring_reset(struct kvm *kvm, struct kvm_dirty_ring *ring)
 
 	trace_kvm_dirty_ring_reset(ring);
 
+	mutex_unlock(&ring->reset_lock);
+
 	return count;
 }
 
@@ -175,6 +183,10 @@ void kvm_dirty_ring_push(struct kvm_dirty_ring *ring, u32 slot, u64 offset)
 	kvm_dirty_gfn_set_dirtied(entry);
 	ring->dirty_index++;
 	trace_kvm_dirty_ring_push(ring, slot, offset);
+
+	/* Fires once each time the ring fills past the threshold */
+	if (ring->notify && kvm_dirty_ring_used(ring) == ring->notify_limit)
+		eventfd_signal(ring->notify, 1);
 }
 
 struct page *kvm_dirty_ring_get_page(struct kvm_dirty_ring *ring, u32 offset)
@@ -52,6 +52,7 @@
 #include <linux/lockdep.h>
 #include <linux/kthread.h>
 #include <linux/suspend.h>
+#include <linux/eventfd.h>
 
 #include <asm/processor.h>
 #include <asm/ioctl.h>
@@ -1250,6 +1251,8 @@ static void kvm_destroy_vm(struct kvm *kvm)
 #endif
 	kvm_arch_destroy_vm(kvm);
 	kvm_destroy_devices(kvm);
+	if (kvm->dirty_ring_notify)
+		eventfd_ctx_put(kvm->dirty_ring_notify);
 	for (i = 0; i < KVM_ADDRESS_SPACE_NUM; i++)
 		kvm_free_memslots(kvm, __kvm_memslots(kvm, i));
 	cleanup_srcu_struct(&kvm->irq_srcu);
@@ -2149,7 +2152,19 @@ static int kvm_vm_ioctl_clear_dirty_log(struct kvm *kvm,
 
 struct kvm_memory_slot *gfn_to_memslot(struct kvm *kvm, gfn_t gfn)
 {
-	return __gfn_to_memslot(kvm_memslots(kvm), gfn);
+	struct kvm_memslots *slots = kvm_memslots(kvm);
+	struct kvm_vcpu *vcpu = kvm_get_running_vcpu();
+
+	/*
+	 * Most lookups come from vCPU context through helpers that only
+	 * have the struct kvm at hand.  Route them through the per-vCPU
+	 * cache, which is both more likely to hit than the VM-wide
+	 * last_used_slot and avoids bouncing its cache line between vCPUs.
+	 */
+	if (vcpu && vcpu->kvm == kvm && kvm_vcpu_memslots(vcpu) == slots)
+		return kvm_vcpu_gfn_to_memslot(vcpu, gfn);
+
+	return __gfn_to_memslot(slots, gfn);
 }
 EXPORT_SYMBOL_GPL(gfn_to_memslot);
 
@@ -3229,13 +3244,38 @@ void kvm_sigset_deactivate(struct kvm_vcpu *vcpu)
 	sigemptyset(&current->real_blocked);
 }
 
+/*
+ * The grow/shrink parameters come from the module parameters unless
+ * userspace has set per-VM values with KVM_CAP_HALT_POLL.
+ */
+static unsigned int kvm_halt_poll_grow(struct kvm *kvm)
+{
+	if (READ_ONCE(kvm->override_halt_poll_params))
+		return READ_ONCE(kvm->halt_poll_grow);
+	return READ_ONCE(halt_poll_ns_grow);
+}
+
+static unsigned int kvm_halt_poll_grow_start(struct kvm *kvm)
+{
+	if (READ_ONCE(kvm->override_halt_poll_params))
+		return READ_ONCE(kvm->halt_poll_grow_start);
+	return READ_ONCE(halt_poll_ns_grow_start);
+}
+
+static unsigned int kvm_halt_poll_shrink(struct kvm *kvm)
+{
+	if (READ_ONCE(kvm->override_halt_poll_params))
+		return READ_ONCE(kvm->halt_poll_shrink);
+	return READ_ONCE(halt_poll_ns_shrink);
+}
+
 static void grow_halt_poll_ns(struct kvm_vcpu *vcpu)
 {
 	unsigned int old, val, grow, grow_start;
 
 	old = val = vcpu->halt_poll_ns;
-	grow_start = READ_ONCE(halt_poll_ns_grow_start);
-	grow = READ_ONCE(halt_poll_ns_grow);
+	grow_start = kvm_halt_poll_grow_start(vcpu->kvm);
+	grow = kvm_halt_poll_grow(vcpu->kvm);
 	if (!grow)
 		goto out;
 
@@ -3256,8 +3296,8 @@ static void shrink_halt_poll_ns(struct kvm_vcpu *vcpu)
 	unsigned int old, val, shrink, grow_start;
 
 	old = val = vcpu->halt_poll_ns;
-	shrink = READ_ONCE(halt_poll_ns_shrink);
-	grow_start = READ_ONCE(halt_poll_ns_grow_start);
+	shrink = kvm_halt_poll_shrink(vcpu->kvm);
+	grow_start = kvm_halt_poll_grow_start(vcpu->kvm);
 	if (shrink == 0)
 		val = 0;
 	else
@@ -3270,6 +3310,57 @@ static void shrink_halt_poll_ns(struct kvm_vcpu *vcpu)
 	trace_kvm_halt_poll_ns_shrink(vcpu->vcpu_id, val, old);
 }
 
+/* Histogram samples are halved after this many wakeups. */
+#define HALT_POLL_ADAPTIVE_DECAY	64
+/* Percentage of recent wakeups the poll window should cover. */
+#define HALT_POLL_ADAPTIVE_PCT		50
+
+/*
+ * Adaptive policy: instead of stepping halt_poll_ns up and down by fixed
+ * factors, keep a decaying log2 histogram of how long the vCPU stayed
+ * halted and poll for just long enough to catch HALT_POLL_ADAPTIVE_PCT
+ * percent of wakeups.  If that window exceeds the VM's max_halt_poll_ns,
+ * most wakeups would be missed anyway, so don't poll at all.
+ */
+static void adapt_halt_poll_ns(struct kvm_vcpu *vcpu, u64 block_ns)
+{
+	unsigned int old = vcpu->halt_poll_ns, val = 0;
+	u32 *hist = vcpu->halt_block_hist;
+	u32 total = 0, sum = 0;
+	int i, bucket;
+
+	if (++vcpu->halt_block_samples >= HALT_POLL_ADAPTIVE_DECAY) {
+		for (i = 0; i < HALT_POLL_HIST_COUNT; i++)
+			hist[i] >>= 1;
+		vcpu->halt_block_samples = 0;
+	}
+
+	bucket = block_ns ? fls64(block_ns) - 1 : 0;
+	if (bucket >= HALT_POLL_HIST_COUNT)
+		bucket = HALT_POLL_HIST_COUNT - 1;
+	hist[bucket]++;
+
+	for (i = 0; i < HALT_POLL_HIST_COUNT; i++)
+		total += hist[i];
+
+	for (i = 0; i < HALT_POLL_HIST_COUNT; i++) {
+		sum += hist[i];
+		if ((u64)sum * 100 >= (u64)total * HALT_POLL_ADAPTIVE_PCT)
+			break;
+	}
+
+	/* Upper bound of bucket i is 2^(i + 1) ns. */
+	if (i < HALT_POLL_HIST_COUNT &&
+	    (1ULL << (i + 1)) <= vcpu->kvm->max_halt_poll_ns)
+		val = 1U << (i + 1);
+
+	vcpu->halt_poll_ns = val;
+	if (val > old)
+		trace_kvm_halt_poll_ns_grow(vcpu->vcpu_id, val, old);
+	else if (val < old)
+		trace_kvm_halt_poll_ns_shrink(vcpu->vcpu_id, val, old);
+}
+
 static int kvm_vcpu_check_block(struct kvm_vcpu *vcpu)
 {
 	int ret = -EINTR;
@@ -3372,7 +3463,11 @@ void kvm_vcpu_block(struct kvm_vcpu *vcpu)
 	if (halt_poll_allowed) {
 		if (!vcpu_valid_wakeup(vcpu)) {
 			shrink_halt_poll_ns(vcpu);
-		} else if (vcpu->kvm->max_halt_poll_ns) {
+		} else if (!vcpu->kvm->max_halt_poll_ns) {
+			vcpu->halt_poll_ns = 0;
+		} else if (READ_ONCE(vcpu->kvm->halt_poll_adaptive)) {
+			adapt_halt_poll_ns(vcpu, block_ns);
+		} else {
 			if (block_ns <= vcpu->halt_poll_ns)
 				;
 			/* we had a long block, shrink polling */
@@ -3383,8 +3478,6 @@ void kvm_vcpu_block(struct kvm_vcpu *vcpu)
 			else if (vcpu->halt_poll_ns < vcpu->kvm->max_halt_poll_ns &&
 					block_ns < vcpu->kvm->max_halt_poll_ns)
 				grow_halt_poll_ns(vcpu);
-		} else {
-			vcpu->halt_poll_ns = 0;
 		}
 	}
 
@@ -3730,6 +3823,9 @@ static int kvm_vm_ioctl_create_vcpu(struct kvm *kvm, u32 id)
 					 id, kvm->dirty_ring_size);
 		if (r)
 			goto arch_vcpu_destroy;
+
+		vcpu->dirty_ring.notify = kvm->dirty_ring_notify;
+		vcpu->dirty_ring.notify_limit = kvm->dirty_ring_notify_limit;
 	}
 
 	mutex_lock(&kvm->lock);
@@ -3844,6 +3940,30 @@ static int kvm_vcpu_ioctl_get_stats_fd(struct kvm_vcpu *vcpu)
 	return fd;
 }
 
+/*
+ * Reset only this vcpu's ring.  Unlike KVM_RESET_DIRTY_RINGS this does not
+ * take slots_lock, so a vcpu thread that exited with
+ * KVM_EXIT_DIRTY_RING_FULL can recycle its own ring without waiting for,
+ * or stalling, the harvesting of the other vcpus.
+ */
+static int kvm_vcpu_ioctl_reset_dirty_ring(struct kvm_vcpu *vcpu)
+{
+	struct kvm *kvm = vcpu->kvm;
+	int cleared, idx;
+
+	if (!kvm->dirty_ring_size)
+		return -EINVAL;
+
+	idx = srcu_read_lock(&kvm->srcu);
+	cleared = kvm_dirty_ring_reset(kvm, &vcpu->dirty_ring);
+	srcu_read_unlock(&kvm->srcu, idx);
+
+	if (cleared)
+		kvm_flush_remote_tlbs(kvm);
+
+	return cleared;
+}
+
 static long kvm_vcpu_ioctl(struct file *filp,
 			   unsigned int ioctl, unsigned long arg)
 {
@@ -4045,6 +4165,9 @@ static long kvm_vcpu_ioctl(struct file *filp,
 		r = kvm_vcpu_ioctl_get_stats_fd(vcpu);
 		break;
 	}
+	case KVM_RESET_DIRTY_RING:
+		r = kvm_vcpu_ioctl_reset_dirty_ring(vcpu);
+		break;
 	default:
 		r = kvm_arch_vcpu_ioctl(filp, ioctl, arg);
 	}
@@ -4306,6 +4429,8 @@ static long kvm_vm_ioctl_check_extension_generic(struct kvm *kvm, long arg)
 #else
 		return 0;
 #endif
+	case KVM_CAP_DIRTY_LOG_RING_NOTIFY:
+		return KVM_DIRTY_LOG_PAGE_OFFSET > 0;
 	case KVM_CAP_BINARY_STATS_FD:
 		return 1;
 	default:
@@ -4374,6 +4499,47 @@ static int kvm_vm_ioctl_reset_dirty_pages(struct kvm *kvm)
 	return cleared;
 }
 
+/*
+ * Register an eventfd that is signalled whenever a vcpu's dirty ring fills
+ * up to @limit entries, ahead of the soft limit that forces an exit.  Like
+ * the ring size, it has to be set up before any vcpu is created.
+ */
+static int kvm_vm_ioctl_enable_dirty_ring_notify(struct kvm *kvm, int fd,
+						 u32 limit)
+{
+	struct eventfd_ctx *ctx;
+	u32 entries;
+	int r;
+
+	if (!kvm->dirty_ring_size)
+		return -EINVAL;
+
+	entries = kvm->dirty_ring_size / sizeof(struct kvm_dirty_gfn);
+	if (!limit || limit >= entries - kvm_dirty_ring_get_rsvd_entries())
+		return -EINVAL;
+
+	ctx = eventfd_ctx_fdget(fd);
+	if (IS_ERR(ctx))
+		return PTR_ERR(ctx);
+
+	mutex_lock(&kvm->lock);
+
+	if (kvm->created_vcpus || kvm->dirty_ring_notify) {
+		r = -EINVAL;
+	} else {
+		kvm->dirty_ring_notify = ctx;
+		kvm->dirty_ring_notify_limit = limit;
+		ctx = NULL;
+		r = 0;
+	}
+
+	mutex_unlock(&kvm->lock);
+
+	if (ctx)
+		eventfd_ctx_put(ctx);
+	return r;
+}
+
 int __attribute__((weak)) kvm_vm_ioctl_enable_cap(struct kvm *kvm,
 						  struct kvm_enable_cap *cap)
 {
@@ -4398,14 +4564,44 @@ static int kvm_vm_ioctl_enable_cap_generic(struct kvm *kvm,
 	}
 #endif
 	case KVM_CAP_HALT_POLL: {
-		if (cap->flags || cap->args[0] != (unsigned int)cap->args[0])
+		int i, nr_args = 1;
+
+		if (cap->flags & ~(KVM_HALT_POLL_PARAMS | KVM_HALT_POLL_ADAPTIVE))
 			return -EINVAL;
 
+		if (cap->flags & KVM_HALT_POLL_PARAMS)
+			nr_args = 4;
+
+		for (i = 0; i < nr_args; i++)
+			if (cap->args[i] != (unsigned int)cap->args[i])
+				return -EINVAL;
+
+		/*
+		 * args[0] is the maximum poll time.  With KVM_HALT_POLL_PARAMS,
+		 * args[1..3] override the halt_poll_ns_grow, _grow_start and
+		 * _shrink module parameters for this VM.
+		 */
+		mutex_lock(&kvm->lock);
 		kvm->max_halt_poll_ns = cap->args[0];
+		if (cap->flags & KVM_HALT_POLL_PARAMS) {
+			WRITE_ONCE(kvm->halt_poll_grow, cap->args[1]);
+			WRITE_ONCE(kvm->halt_poll_grow_start, cap->args[2]);
+			WRITE_ONCE(kvm->halt_poll_shrink, cap->args[3]);
+		}
+		WRITE_ONCE(kvm->override_halt_poll_params,
+			   !!(cap->flags & KVM_HALT_POLL_PARAMS));
+		WRITE_ONCE(kvm->halt_poll_adaptive,
+			   !!(cap->flags & KVM_HALT_POLL_ADAPTIVE));
+		mutex_unlock(&kvm->lock);
 		return 0;
 	}
 	case KVM_CAP_DIRTY_LOG_RING:
 		return kvm_vm_ioctl_enable_dirty_log_ring(kvm, cap->args[0]);
+	case KVM_CAP_DIRTY_LOG_RING_NOTIFY:
+		if (cap->flags || cap->args[1] != (u32)cap->args[1])
+			return -EINVAL;
+		return kvm_vm_ioctl_enable_dirty_ring_notify(kvm, cap->args[0],
+							     cap->args[1]);
 	default:
 		return kvm_vm_ioctl_enable_cap(kvm, cap);
 	}